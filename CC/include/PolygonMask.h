@@ -0,0 +1,109 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the  #
+//#  License.                                                              #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_POLYGON_MASK_HEADER
+#define CC_POLYGON_MASK_HEADER
+
+//Local
+#include "CCGeom.h"
+
+//System
+#include <vector>
+
+namespace CCLib
+{
+
+class GenericIndexedCloud;
+
+//! Rasterized 2D polygon (for fast 'point inside polygon' tests)
+/** The polygon bounding-box is divided in a regular grid. Each cell is
+	either fully inside the polygon, fully outside or crossed by its border.
+	Only the points falling in the border cells are tested against the
+	polygon edges. Rectangles (e.g. the projection of a bounding-box) can
+	also be classified at once (with summed-area tables).
+
+	The results are the same as ManualSegmentationTools::isPointInsidePoly
+	(even-odd rule).
+**/
+class CC_CORE_LIB_API PolygonMask
+{
+public:
+
+	//! Cell/rectangle state
+	enum State
+	{
+		OUTSIDE = 0,	/**< Fully outside the polygon **/
+		INSIDE = 1,		/**< Fully inside the polygon **/
+		STRADDLING = 2,	/**< Crossed by the polygon border **/
+	};
+
+	//! Default constructor
+	PolygonMask();
+
+	//! Initializes the mask
+	/** \param polyVertices polygon vertices (considered as ordered 2D polyline vertices)
+		\param cellSize grid step (e.g. 1 pixel)
+		\param maxGridSize max number of cells along each dimension (the grid step is increased if necessary)
+		\return success
+	**/
+	bool init(const GenericIndexedCloud* polyVertices, PointCoordinateType cellSize = 1, unsigned maxGridSize = 1024);
+
+	//! Returns whether the mask is initialized or not
+	bool isValid() const { return !m_vertices.empty(); }
+
+	//! Tests if a point is inside the polygon
+	bool isInside(const CCVector2& P) const;
+
+	//! Classifies a rectangle
+	/** \param minCorner min corner
+		\param maxCorner max corner
+		\return INSIDE (resp. OUTSIDE) if all the rectangle is inside (resp. outside) the polygon, STRADDLING otherwise
+	**/
+	State classify(const CCVector2& minCorner, const CCVector2& maxCorner) const;
+
+protected:
+
+	//! Returns the cell column of a coordinate (not clamped)
+	inline int column(PointCoordinateType x) const { return static_cast<int>(floor((x - m_origin.x) / m_cellSize)); }
+	//! Returns the cell row of a coordinate (not clamped)
+	inline int row(PointCoordinateType y) const { return static_cast<int>(floor((y - m_origin.y) / m_cellSize)); }
+
+	//! Returns the number of cells with a given state in a (valid) range of cells
+	unsigned count(const std::vector<unsigned>& sums, int c0, int r0, int c1, int r1) const;
+
+	//! Polygon vertices
+	std::vector<CCVector2> m_vertices;
+	//! Grid origin
+	CCVector2 m_origin;
+	//! Grid step
+	PointCoordinateType m_cellSize;
+	//! Grid width
+	int m_width;
+	//! Grid height
+	int m_height;
+	//! Cells state
+	std::vector<unsigned char> m_cells;
+	//! Summed-area table of the 'inside' cells ((m_width+1) x (m_height+1))
+	std::vector<unsigned> m_insideSums;
+	//! Summed-area table of the 'outside' cells ((m_width+1) x (m_height+1))
+	std::vector<unsigned> m_outsideSums;
+};
+
+}
+
+#endif //CC_POLYGON_MASK_HEADER
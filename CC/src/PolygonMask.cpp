@@ -0,0 +1,273 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the  #
+//#  License.                                                              #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#include "PolygonMask.h"
+
+//local
+#include "GenericIndexedCloud.h"
+#include "ManualSegmentationTools.h"
+
+//system
+#include <assert.h>
+#include <algorithm>
+
+using namespace CCLib;
+
+//! Relative margin used to flag the cells crossed by the polygon border (conservative rasterization)
+static const PointCoordinateType c_borderMargin = static_cast<PointCoordinateType>(1.0e-3);
+
+PolygonMask::PolygonMask()
+	: m_origin(0, 0)
+	, m_cellSize(1)
+	, m_width(0)
+	, m_height(0)
+{
+}
+
+bool PolygonMask::init(const GenericIndexedCloud* polyVertices, PointCoordinateType cellSize/*=1*/, unsigned maxGridSize/*=1024*/)
+{
+	m_vertices.clear();
+	m_cells.clear();
+	m_insideSums.clear();
+	m_outsideSums.clear();
+	m_width = m_height = 0;
+
+	unsigned vertCount = (polyVertices ? polyVertices->size() : 0);
+	if (vertCount < 2 || cellSize <= 0 || maxGridSize == 0)
+	{
+		return false;
+	}
+
+	try
+	{
+		m_vertices.resize(vertCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	//polygon bounding-box
+	CCVector2 bbMin, bbMax;
+	for (unsigned i = 0; i < vertCount; ++i)
+	{
+		CCVector3 P;
+		polyVertices->getPoint(i, P);
+		m_vertices[i] = CCVector2(P.x, P.y);
+		if (i == 0)
+		{
+			bbMin = bbMax = m_vertices[0];
+		}
+		else
+		{
+			bbMin.x = std::min(bbMin.x, P.x);
+			bbMin.y = std::min(bbMin.y, P.y);
+			bbMax.x = std::max(bbMax.x, P.x);
+			bbMax.y = std::max(bbMax.y, P.y);
+		}
+	}
+
+	//grid dimensions
+	PointCoordinateType maxDim = std::max(bbMax.x - bbMin.x, bbMax.y - bbMin.y);
+	m_cellSize = std::max(cellSize, maxDim / maxGridSize);
+	m_origin = bbMin;
+	m_width = column(bbMax.x) + 1;
+	m_height = row(bbMax.y) + 1;
+
+	try
+	{
+		m_cells.resize(static_cast<size_t>(m_width) * m_height, OUTSIDE);
+		m_insideSums.resize(static_cast<size_t>(m_width + 1) * (m_height + 1), 0);
+		m_outsideSums.resize(static_cast<size_t>(m_width + 1) * (m_height + 1), 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		m_vertices.clear();
+		m_cells.clear();
+		m_insideSums.clear();
+		m_outsideSums.clear();
+		return false;
+	}
+
+	//flag the cells crossed by the polygon edges
+	PointCoordinateType margin = c_borderMargin * m_cellSize;
+	for (unsigned i = 0; i < vertCount; ++i)
+	{
+		const CCVector2& A = m_vertices[i];
+		const CCVector2& B = m_vertices[(i + 1) % vertCount];
+
+		int c0 = std::max(column(std::min(A.x, B.x) - margin), 0);
+		int c1 = std::min(column(std::max(A.x, B.x) + margin), m_width - 1);
+		for (int c = c0; c <= c1; ++c)
+		{
+			//part of the edge inside the current column
+			PointCoordinateType yMin = std::min(A.y, B.y);
+			PointCoordinateType yMax = std::max(A.y, B.y);
+			PointCoordinateType dx = B.x - A.x;
+			if (dx != 0)
+			{
+				PointCoordinateType x0 = std::max(m_origin.x + c * m_cellSize, std::min(A.x, B.x));
+				PointCoordinateType x1 = std::min(m_origin.x + (c + 1) * m_cellSize, std::max(A.x, B.x));
+				PointCoordinateType y0 = A.y + (x0 - A.x) * (B.y - A.y) / dx;
+				PointCoordinateType y1 = A.y + (x1 - A.x) * (B.y - A.y) / dx;
+				yMin = std::max(yMin, std::min(y0, y1));
+				yMax = std::min(yMax, std::max(y0, y1));
+			}
+
+			int r0 = std::max(row(yMin - margin), 0);
+			int r1 = std::min(row(yMax + margin), m_height - 1);
+			for (int r = r0; r <= r1; ++r)
+			{
+				m_cells[static_cast<size_t>(r) * m_width + c] = STRADDLING;
+			}
+		}
+	}
+
+	//the other cells are either fully inside or fully outside: we test their center (scanlines)
+	std::vector<PointCoordinateType> crossings;
+	for (int r = 0; r < m_height; ++r)
+	{
+		PointCoordinateType y = m_origin.y + (r + static_cast<PointCoordinateType>(0.5)) * m_cellSize;
+
+		//same rule as ManualSegmentationTools::isPointInsidePoly
+		crossings.clear();
+		for (unsigned i = 0; i < vertCount; ++i)
+		{
+			const CCVector2& A = m_vertices[i];
+			const CCVector2& B = m_vertices[(i + 1) % vertCount];
+			if ((B.y <= y && y < A.y) || (A.y <= y && y < B.y))
+			{
+				crossings.push_back(A.x + (y - A.y) * (B.x - A.x) / (B.y - A.y));
+			}
+		}
+		std::sort(crossings.begin(), crossings.end());
+
+		//a point is inside if the number of crossings on its right is odd
+		size_t crossingIndex = 0;
+		unsigned char* cells = &m_cells[static_cast<size_t>(r) * m_width];
+		for (int c = 0; c < m_width; ++c)
+		{
+			PointCoordinateType x = m_origin.x + (c + static_cast<PointCoordinateType>(0.5)) * m_cellSize;
+			while (crossingIndex < crossings.size() && crossings[crossingIndex] <= x)
+			{
+				++crossingIndex;
+			}
+
+			if (cells[c] != STRADDLING)
+			{
+				cells[c] = (((crossings.size() - crossingIndex) & 1) ? INSIDE : OUTSIDE);
+			}
+		}
+	}
+
+	//summed-area tables
+	for (int r = 0; r < m_height; ++r)
+	{
+		const unsigned char* cells = &m_cells[static_cast<size_t>(r) * m_width];
+		unsigned insideRowSum = 0;
+		unsigned outsideRowSum = 0;
+		for (int c = 0; c < m_width; ++c)
+		{
+			if (cells[c] == INSIDE)
+				++insideRowSum;
+			else if (cells[c] == OUTSIDE)
+				++outsideRowSum;
+
+			size_t index = static_cast<size_t>(r + 1) * (m_width + 1) + (c + 1);
+			size_t upIndex = static_cast<size_t>(r) * (m_width + 1) + (c + 1);
+			m_insideSums[index] = m_insideSums[upIndex] + insideRowSum;
+			m_outsideSums[index] = m_outsideSums[upIndex] + outsideRowSum;
+		}
+	}
+
+	return true;
+}
+
+bool PolygonMask::isInside(const CCVector2& P) const
+{
+	int c = column(P.x);
+	int r = row(P.y);
+	if (c < 0 || r < 0 || c >= m_width || r >= m_height)
+	{
+		//outside of the polygon bounding-box
+		return false;
+	}
+
+	switch (m_cells[static_cast<size_t>(r) * m_width + c])
+	{
+	case INSIDE:
+		return true;
+	case OUTSIDE:
+		return false;
+	default:
+		break;
+	}
+
+	//the cell is crossed by the polygon border
+	return ManualSegmentationTools::isPointInsidePoly(P, m_vertices);
+}
+
+unsigned PolygonMask::count(const std::vector<unsigned>& sums, int c0, int r0, int c1, int r1) const
+{
+	assert(c0 <= c1 && r0 <= r1);
+	size_t w = static_cast<size_t>(m_width) + 1;
+	return	  sums[(r1 + 1) * w + (c1 + 1)]
+			- sums[r0 * w + (c1 + 1)]
+			- sums[(r1 + 1) * w + c0]
+			+ sums[r0 * w + c0];
+}
+
+PolygonMask::State PolygonMask::classify(const CCVector2& minCorner, const CCVector2& maxCorner) const
+{
+	if (m_cells.empty())
+	{
+		return OUTSIDE;
+	}
+
+	int c0 = column(minCorner.x);
+	int r0 = row(minCorner.y);
+	int c1 = column(maxCorner.x);
+	int r1 = row(maxCorner.y);
+
+	if (c1 < 0 || r1 < 0 || c0 >= m_width || r0 >= m_height)
+	{
+		//outside of the polygon bounding-box
+		return OUTSIDE;
+	}
+
+	//the part of the rectangle outside of the polygon bounding-box is outside of the polygon
+	bool clipped = (c0 < 0 || r0 < 0 || c1 >= m_width || r1 >= m_height);
+	c0 = std::max(c0, 0);
+	r0 = std::max(r0, 0);
+	c1 = std::min(c1, m_width - 1);
+	r1 = std::min(r1, m_height - 1);
+
+	unsigned cellCount = static_cast<unsigned>((c1 - c0 + 1) * (r1 - r0 + 1));
+	if (!clipped && count(m_insideSums, c0, r0, c1, r1) == cellCount)
+	{
+		return INSIDE;
+	}
+	if (count(m_outsideSums, c0, r0, c1, r1) == cellCount)
+	{
+		return OUTSIDE;
+	}
+
+	return STRADDLING;
+}
@@ -23,9 +23,13 @@
 //Local
 #include "ccMaterial.h"
 
+//Qt
+#include <QElapsedTimer>
+
 class ccGenericGLDisplay;
 class ccScalarField;
 class ccColorRampShader;
+class ccNormalDecodeShader;
 class ccShader;
 
 //! Display parameters of a 3D entity
@@ -40,6 +44,46 @@ struct glDrawParams
 	bool showNorms;
 };
 
+//! Rendering statistics (filled by the entities during a frame)
+struct ccGLDrawStats
+{
+	//! Default constructor
+	ccGLDrawStats() { reset(); }
+
+	//! Resets all counters
+	void reset()
+	{
+		drawnEntityCount = 0;
+		submittedPointCount = 0;
+		lodSelectionTime_ns = 0;
+		vboUpdateTime_ns = 0;
+		sfColorTime_ns = 0;
+	}
+
+	//! Number of entities drawn (3D pass)
+	unsigned drawnEntityCount;
+	//! Number of points sent to the GPU by the clouds
+	unsigned submittedPointCount;
+	//! Time spent selecting the LOD points to display (in ns)
+	qint64 lodSelectionTime_ns;
+	//! Time spent updating the VBOs (in ns - includes sfColorTime_ns)
+	qint64 vboUpdateTime_ns;
+	//! Time spent converting scalar values to colors (in ns)
+	qint64 sfColorTime_ns;
+
+	//! Adds the time spent in a scope to a counter (if any)
+	class ScopedTimer
+	{
+	public:
+		explicit ScopedTimer(qint64* counter) : m_counter(counter) { if (m_counter) m_timer.start(); }
+		~ScopedTimer() { if (m_counter) *m_counter += m_timer.nsecsElapsed(); }
+
+	protected:
+		qint64* m_counter;
+		QElapsedTimer m_timer;
+	};
+};
+
 // Drawing flags (type: short)
 enum CC_DRAWING_FLAGS
 {
@@ -132,6 +176,15 @@ struct ccGLDrawContext
 	//  ǷиߵĲ㼶
 	bool higherLODLevelsAvailable;
 
+	//! Number of points sent to the GPU by the clouds displayed with the LOD structure (current frame)
+	unsigned lodSubmittedPointCount;
+
+	//! Number of points of the clouds displayed with the LOD structure that remain visible after culling (current LOD cycle)
+	unsigned lodVisiblePointCount;
+
+	//! Rendering statistics (null if they are not collected)
+	ccGLDrawStats* stats;
+
 	//! Whether to decimate big meshes when rotating the camera
 	bool decimateMeshOnMove;
 
@@ -144,6 +197,8 @@ struct ccGLDrawContext
 	
 	//! Shader for fast dynamic color ramp lookup
 	ccColorRampShader* colorRampShader;
+	//! Shader to decode the compressed normals on the GPU side
+	ccNormalDecodeShader* normalDecodeShader;
 	//! Custom rendering shader (OpenGL 3.3+)
 	ccShader* customRenderingShader;
 
@@ -195,10 +250,14 @@ struct ccGLDrawContext
 		, currentLODLevel(0)
 		, moreLODPointsAvailable(false)
 		, higherLODLevelsAvailable(false)
+		, lodSubmittedPointCount(0)
+		, lodVisiblePointCount(0)
+		, stats(0)
 		, decimateMeshOnMove(true)
 		, minLODTriangleCount(2500000)
 		, sfColorScaleToDisplay(0)
 		, colorRampShader(0)
+		, normalDecodeShader(0)
 		, customRenderingShader(0)
 		, useVBOs(true)
 		, labelMarkerSize(5)
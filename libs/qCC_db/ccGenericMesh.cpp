@@ -900,6 +900,38 @@ void ccGenericMesh::computeInterpolationWeights(unsigned triIndex, const CCVecto
 	weights /= sum;
 }
 
+void ccGenericMesh::notifyGeometryUpdate()
+{
+	ccHObject::notifyGeometryUpdate();
+
+	//the BVH is deprecated
+	clearBVH();
+}
+
+ccTriangleBVH::Shared ccGenericMesh::getBVH(bool autoCompute/*=true*/)
+{
+	if (m_bvh && !m_bvh->isValidFor(this))
+	{
+		//the triangles or the vertices have changed in the meantime
+		m_bvh.clear();
+	}
+
+	if (!m_bvh && autoCompute && size() != 0)
+	{
+		ccTriangleBVH::Shared bvh(new ccTriangleBVH);
+		if (bvh->build(this))
+		{
+			m_bvh = bvh;
+		}
+		else
+		{
+			ccLog::Warning(QString("[Mesh %1] Failed to compute the triangles BVH (not enough memory?)").arg(getName()));
+		}
+	}
+
+	return m_bvh;
+}
+
 bool ccGenericMesh::trianglePicking(const CCVector2d& clickPos,
 									const ccGLCameraParameters& camera,
 									int& nearestTriIndex,
@@ -928,65 +960,137 @@ bool ccGenericMesh::trianglePicking(const CCVector2d& clickPos,
 		return false;
 	}
 
-#if defined(_OPENMP)
-	#pragma omp parallel for
-#endif
-	for (int i = 0; i < static_cast<int>(size()); ++i)
+	//we can use the BVH to cast a ray (much faster)
+	ccTriangleBVH::Shared bvh = getBVH(true);
+	if (bvh)
 	{
-		CCLib::VerticesIndexes* tsi = getTriangleVertIndexes(i);
-		const CCVector3* A3D = vertices->getPoint(tsi->i1);
-		const CCVector3* B3D = vertices->getPoint(tsi->i2);
-		const CCVector3* C3D = vertices->getPoint(tsi->i3);
+		//compute 3D picking 'ray'
+		CCVector3d clickPosd2(clickPos.x, clickPos.y, 1.0);
+		CCVector3d Y(0, 0, 0);
+		if (!camera.unproject(clickPosd2, Y))
+		{
+			return false;
+		}
 
-		CCVector3d A2D,B2D,C2D; 
-		if (noGLTrans)
+		//the ray must be expressed in the local coordinate system
+		CCVector3d rayOrigin = X;
+		CCVector3d rayAxis = Y - X;
+		if (!noGLTrans)
 		{
-			camera.project(*A3D, A2D);
-			camera.project(*B3D, B2D);
-			camera.project(*C3D, C2D);
+			ccGLMatrix iTrans = trans.inverse();
+			iTrans.applyRotation(rayAxis);
+			iTrans.apply(rayOrigin);
 		}
-		else
+
+		unsigned triIndex = 0;
+		CCVector3d P;
+		if (bvh->raycast(this, rayOrigin, rayAxis, triIndex, P))
 		{
-			CCVector3 A3Dp = *A3D;
-			CCVector3 B3Dp = *B3D;
-			CCVector3 C3Dp = *C3D;
-			trans.apply(A3Dp);
-			trans.apply(B3Dp);
-			trans.apply(C3Dp);
-			camera.project(A3Dp, A2D);
-			camera.project(B3Dp, B2D);
-			camera.project(C3Dp, C2D);
+			CCVector3d Pglobal = P;
+			if (!noGLTrans)
+			{
+				trans.apply(Pglobal);
+			}
+
+			nearestTriIndex = static_cast<int>(triIndex);
+			nearestSquareDist = (X - Pglobal).norm2d();
+			nearestPoint = P;
 		}
 
-		//barycentric coordinates
-		GLdouble detT =  (B2D.y-C2D.y) *      (A2D.x-C2D.x) + (C2D.x-B2D.x) *      (A2D.y-C2D.y);
-		GLdouble l1   = ((B2D.y-C2D.y) * (clickPos.x-C2D.x) + (C2D.x-B2D.x) * (clickPos.y-C2D.y)) / detT;
-		GLdouble l2   = ((C2D.y-A2D.y) * (clickPos.x-C2D.x) + (A2D.x-C2D.x) * (clickPos.y-C2D.y)) / detT;
+		return (nearestTriIndex >= 0);
+	}
 
-		//does the point falls inside the triangle?
-		if (l1 >= 0 && l1 <= 1.0 && l2 >= 0.0 && l2 <= 1.0)
+	//otherwise we go 'brute force'
+#if defined(_OPENMP)
+	#pragma omp parallel
+#endif
+	{
+		//each thread looks for its own nearest triangle
+		int localTriIndex = -1;
+		double localSquareDist = -1.0;
+		CCVector3d localPoint(0, 0, 0);
+
+#if defined(_OPENMP)
+		#pragma omp for
+#endif
+		for (int i = 0; i < static_cast<int>(size()); ++i)
 		{
-			double l1l2 = l1+l2;
-			assert(l1l2 >= 0);
-			if (l1l2 > 1.0)
+			CCLib::VerticesIndexes* tsi = getTriangleVertIndexes(i);
+			const CCVector3* A3D = vertices->getPoint(tsi->i1);
+			const CCVector3* B3D = vertices->getPoint(tsi->i2);
+			const CCVector3* C3D = vertices->getPoint(tsi->i3);
+
+			CCVector3d A2D, B2D, C2D;
+			if (noGLTrans)
+			{
+				camera.project(*A3D, A2D);
+				camera.project(*B3D, B2D);
+				camera.project(*C3D, C2D);
+			}
+			else
 			{
-				l1 /= l1l2;
-				l2 /= l1l2;
+				CCVector3 A3Dp = *A3D;
+				CCVector3 B3Dp = *B3D;
+				CCVector3 C3Dp = *C3D;
+				trans.apply(A3Dp);
+				trans.apply(B3Dp);
+				trans.apply(C3Dp);
+				camera.project(A3Dp, A2D);
+				camera.project(B3Dp, B2D);
+				camera.project(C3Dp, C2D);
 			}
 
-			GLdouble l3 = 1.0 - l1 - l2;
-			assert(l3 >= -1.0e-12);
+			//barycentric coordinates
+			GLdouble detT =  (B2D.y-C2D.y) *      (A2D.x-C2D.x) + (C2D.x-B2D.x) *      (A2D.y-C2D.y);
+			GLdouble l1   = ((B2D.y-C2D.y) * (clickPos.x-C2D.x) + (C2D.x-B2D.x) * (clickPos.y-C2D.y)) / detT;
+			GLdouble l2   = ((C2D.y-A2D.y) * (clickPos.x-C2D.x) + (A2D.x-C2D.x) * (clickPos.y-C2D.y)) / detT;
+
+			//does the point falls inside the triangle?
+			if (l1 >= 0 && l1 <= 1.0 && l2 >= 0.0 && l2 <= 1.0)
+			{
+				double l1l2 = l1+l2;
+				assert(l1l2 >= 0);
+				if (l1l2 > 1.0)
+				{
+					l1 /= l1l2;
+					l2 /= l1l2;
+				}
+
+				GLdouble l3 = 1.0 - l1 - l2;
+				assert(l3 >= -1.0e-12);
 
-			//now deduce the 3D position
-			CCVector3d P(	l1 * A3D->x + l2 * B3D->x + l3 * C3D->x,
-							l1 * A3D->y + l2 * B3D->y + l3 * C3D->y,
-							l1 * A3D->z + l2 * B3D->z + l3 * C3D->z);
-			double squareDist = (X-P).norm2d();
-			if (nearestTriIndex < 0 || squareDist < nearestSquareDist)
+				//now deduce the 3D position
+				CCVector3d P(	l1 * A3D->x + l2 * B3D->x + l3 * C3D->x,
+								l1 * A3D->y + l2 * B3D->y + l3 * C3D->y,
+								l1 * A3D->z + l2 * B3D->z + l3 * C3D->z);
+				CCVector3d Pglobal = P;
+				if (!noGLTrans)
+				{
+					trans.apply(Pglobal);
+				}
+				double squareDist = (X - Pglobal).norm2d();
+				if (localTriIndex < 0 || squareDist < localSquareDist)
+				{
+					localSquareDist = squareDist;
+					localTriIndex = static_cast<int>(i);
+					localPoint = P;
+				}
+			}
+		}
+
+		//merge the per-thread results (smallest distance, then smallest index for a deterministic result)
+#if defined(_OPENMP)
+		#pragma omp critical
+#endif
+		{
+			if (localTriIndex >= 0
+				&&	(	nearestTriIndex < 0
+					||	localSquareDist < nearestSquareDist
+					||	(localSquareDist == nearestSquareDist && localTriIndex < nearestTriIndex)))
 			{
-				nearestSquareDist = squareDist;
-				nearestTriIndex = static_cast<int>(i);
-				nearestPoint = P;
+				nearestSquareDist = localSquareDist;
+				nearestTriIndex = localTriIndex;
+				nearestPoint = localPoint;
 			}
 		}
 	}
@@ -26,6 +26,7 @@
 //Local
 #include "ccGenericGLDisplay.h"
 #include "ccAdvancedTypes.h"
+#include "ccTriangleBVH.h"
 
 class ccGenericPointCloud;
 class ccPointCloud;
@@ -50,6 +51,7 @@ public:
 
 	//inherited methods (ccHObject)
 	virtual bool isSerializable() const override { return true; }
+	virtual void notifyGeometryUpdate() override;
 
 	//! Returns the vertices cloud
 	virtual ccGenericPointCloud* getAssociatedCloud() const = 0;
@@ -182,13 +184,33 @@ public:
 	**/
 	void importParametersFrom(const ccGenericMesh* mesh);
 
-	//! Brute force triangle picking
+	//! Triangle picking
+	/** Casts a ray through the clicked pixel. The BVH of the triangles is
+		computed the first time (see getBVH). Falls back to the brute force
+		approach if it can't be computed.
+		\param clickPos clicked pixel
+		\param camera camera parameters
+		\param[out] nearestTriIndex picked triangle index
+		\param[out] nearestSquareDist square distance between the picked point and the near plane
+		\param[out] nearestPoint picked point (in the mesh local coordinate system)
+		\return whether a triangle has been picked
+	**/
 	virtual bool trianglePicking(	const CCVector2d& clickPos,
 									const ccGLCameraParameters& camera,
 									int& nearestTriIndex,
 									double& nearestSquareDist,
 									CCVector3d& nearestPoint);
 
+	//! Returns the BVH of the triangles (computes it if necessary)
+	/** The BVH is automatically released when the geometry changes.
+		\param autoCompute whether to compute the BVH if it doesn't exist (or is deprecated)
+		\return BVH (or a null pointer if it doesn't exist or couldn't be computed)
+	**/
+	ccTriangleBVH::Shared getBVH(bool autoCompute = true);
+
+	//! Releases the BVH of the triangles (if any)
+	void clearBVH() { m_bvh.clear(); }
+
 protected:
 
 	//inherited from ccHObject
@@ -225,6 +247,9 @@ protected:
 
 	//! Polygon stippling state
 	bool m_stippling;
+
+	//! BVH of the triangles (for picking)
+	ccTriangleBVH::Shared m_bvh;
 };
 
 #endif //CC_GENERIC_MESH_HEADER
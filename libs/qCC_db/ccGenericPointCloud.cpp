@@ -374,7 +374,7 @@ bool ccGenericPointCloud::pointPicking(	const CCVector2d& clickPos,
 	//can we use the octree to accelerate the point picking process?
 	if (pickWidth == pickHeight)
 	{
-		ccOctree::Shared octree = getOctree();
+		ccOctree::Shared octree = getPickingOctree();
 		if (!octree && autoComputeOctree)
 		{
 			ccProgressDialog pDlg(false, getDisplay() ? getDisplay()->asWidget() : 0);
@@ -469,38 +469,62 @@ bool ccGenericPointCloud::pointPicking(	const CCVector2d& clickPos,
 		}
 
 #if defined(_OPENMP)
-#pragma omp parallel for
+#pragma omp parallel
 #endif
-		for (int i=0; i<static_cast<int>(size()); ++i)
 		{
-			//we shouldn't test points that are actually hidden!
-			if (	(!visTable || visTable->getValue(i) == POINT_VISIBLE)
-				&&	(!activeSF || activeSF->getColor(activeSF->getValue(i)))
-				)
-			{
-				const CCVector3* P = getPoint(i);
+			//each thread looks for its own nearest point
+			int localPointIndex = -1;
+			double localSquareDist = -1.0;
 
-				CCVector3d Q2D;
-				if (noGLTrans)
-				{
-					camera.project(*P, Q2D);
-				}
-				else
+#if defined(_OPENMP)
+#pragma omp for
+#endif
+			for (int i=0; i<static_cast<int>(size()); ++i)
+			{
+				//we shouldn't test points that are actually hidden!
+				if (	(!visTable || visTable->getValue(i) == POINT_VISIBLE)
+					&&	(!activeSF || activeSF->getColor(activeSF->getValue(i)))
+					)
 				{
-					CCVector3 P3D = *P;
-					trans.apply(P3D);
-					camera.project(P3D, Q2D);
-				}
+					const CCVector3* P = getPoint(i);
 
-				if (	fabs(Q2D.x-clickPos.x) <= pickWidth
-					&&	fabs(Q2D.y-clickPos.y) <= pickHeight)
-				{
-					double squareDist = CCVector3d(X.x-P->x, X.y-P->y, X.z-P->z).norm2d();
-					if (nearestPointIndex < 0 || squareDist < nearestSquareDist)
+					CCVector3d Q2D;
+					if (noGLTrans)
+					{
+						camera.project(*P, Q2D);
+					}
+					else
 					{
-						nearestSquareDist = squareDist;
-						nearestPointIndex = static_cast<int>(i);
+						CCVector3 P3D = *P;
+						trans.apply(P3D);
+						camera.project(P3D, Q2D);
 					}
+
+					if (	fabs(Q2D.x-clickPos.x) <= pickWidth
+						&&	fabs(Q2D.y-clickPos.y) <= pickHeight)
+					{
+						double squareDist = CCVector3d(X.x-P->x, X.y-P->y, X.z-P->z).norm2d();
+						if (localPointIndex < 0 || squareDist < localSquareDist)
+						{
+							localSquareDist = squareDist;
+							localPointIndex = static_cast<int>(i);
+						}
+					}
+				}
+			}
+
+			//merge the per-thread results (smallest distance, then smallest index for a deterministic result)
+#if defined(_OPENMP)
+#pragma omp critical
+#endif
+			{
+				if (localPointIndex >= 0
+					&&	(	nearestPointIndex < 0
+						||	localSquareDist < nearestSquareDist
+						||	(localSquareDist == nearestSquareDist && localPointIndex < nearestPointIndex)))
+				{
+					nearestSquareDist = localSquareDist;
+					nearestPointIndex = localPointIndex;
 				}
 			}
 		}
@@ -115,6 +115,16 @@ public:
 	//! Erases the octree
 	virtual void deleteOctree();
 
+	//! Returns the octree used to accelerate point picking (if any)
+	/** By default, the associated octree (see getOctree).
+	**/
+	virtual ccOctree::Shared getPickingOctree() const { return getOctree(); }
+
+	//! Starts computing the octree used for point picking in the background (if necessary)
+	/** \return whether the computation has been started (or is already running)
+	**/
+	virtual bool computePickingOctreeInBackground() { return false; }
+
 
 	/***************************************************
 					Features getters
@@ -220,9 +230,10 @@ public:
 	/** \warning Always returns a selection (potentially empty) if successful.
 		\param box croping box
 		\param inside whether selected points are inside or outside the box
+		\param progressCb optional progress callback (the process can then be cancelled)
 		\return points falling inside (or outside) as a selection
 	**/
-	virtual CCLib::ReferenceCloud* crop(const ccBBox& box, bool inside = true) = 0;
+	virtual CCLib::ReferenceCloud* crop(const ccBBox& box, bool inside = true, CCLib::GenericProgressCallback* progressCb = 0) = 0;
 
 	//! Multiplies all coordinates by constant factors (one per dimension)
 	/** WARNING: attached octree may be deleted.
@@ -254,7 +265,8 @@ public:
 	void importParametersFrom(const ccGenericPointCloud* cloud);
 
 	//! Point picking (brute force or octree-driven)
-	/** \warning the octree-driven method only works if pickWidth == pickHeight
+	/** The octree returned by getPickingOctree is used if available.
+		\warning the octree-driven method only works if pickWidth == pickHeight
 	**/
 	bool pointPicking(	const CCVector2d& clickPos,
 						const ccGLCameraParameters& camera,
@@ -674,8 +674,8 @@ void ccHObject::draw(CC_DRAW_CONTEXT& context)
 		if (	context.decimateCloudOnMove
 			&&	context.currentLODLevel > 0)
 		{
-			//only for real clouds
-			drawInThisContext &= isA(CC_TYPES::POINT_CLOUD);
+			//only for real clouds (and out-of-core ones)
+			drawInThisContext &= (isA(CC_TYPES::POINT_CLOUD) || isA(CC_TYPES::OUT_OF_CORE_CLOUD));
 		}
 	}
 
@@ -697,6 +697,12 @@ void ccHObject::draw(CC_DRAW_CONTEXT& context)
 
 			drawMeOnly(context);
 
+			//statistics
+			if (draw3D && context.stats && !isA(CC_TYPES::HIERARCHY_OBJECT))
+			{
+				++context.stats->drawnEntityCount;
+			}
+
 			//disable clipping planes (if any)
 			if (useClipPlanes)
 			{
@@ -28,6 +28,8 @@
 #include <QUuid>
 #include <QFileInfo>
 #include <QDataStream>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QOpenGLTexture>
 
 //System
@@ -36,6 +38,8 @@
 //Textures DB
 QMap<QString, QImage> s_textureDB;
 QMap<QString, QSharedPointer<QOpenGLTexture>> s_openGLTextureDB;
+//Textures DB mutex (textures can be loaded by background threads - e.g. with OBJ files)
+static QMutex s_textureDBMutex;
 
 ccMaterial::ccMaterial(QString name)
 	: m_name(name)
@@ -121,7 +125,13 @@ bool ccMaterial::loadAndSetTexture(QString absoluteFilename)
 	}
 	ccLog::PrintDebug(QString("[ccMaterial::loadAndSetTexture] absolute filename = %1").arg(absoluteFilename));
 
-	if (s_textureDB.contains(absoluteFilename))
+	bool alreadyLoaded = false;
+	{
+		QMutexLocker locker(&s_textureDBMutex);
+		alreadyLoaded = s_textureDB.contains(absoluteFilename);
+	}
+
+	if (alreadyLoaded)
 	{
 		//if the image is already in memory, we simply update the texture filename for this amterial
 		m_textureFilename = absoluteFilename;
@@ -148,6 +158,8 @@ void ccMaterial::setTexture(QImage image, QString absoluteFilename/*=QString()*/
 {
 	ccLog::PrintDebug(QString("[ccMaterial::setTexture] absoluteFilename = '%1' / size = %2 x %3").arg(absoluteFilename).arg(image.width()).arg(image.height()));
 
+	QMutexLocker locker(&s_textureDBMutex);
+
 	if (absoluteFilename.isEmpty())
 	{
 		//if the user hasn't provided any filename, we generate a fake one
@@ -177,7 +189,8 @@ void ccMaterial::setTexture(QImage image, QString absoluteFilename/*=QString()*/
 
 const QImage ccMaterial::getTexture() const
 {
-	return s_textureDB[m_textureFilename];
+	QMutexLocker locker(&s_textureDBMutex);
+	return s_textureDB.value(m_textureFilename);
 }
 
 GLuint ccMaterial::getTextureID() const
@@ -211,7 +224,11 @@ GLuint ccMaterial::getTextureID() const
 
 bool ccMaterial::hasTexture() const
 {
-	return m_textureFilename.isEmpty() ? false : !s_textureDB[m_textureFilename].isNull();
+	if (m_textureFilename.isEmpty())
+		return false;
+
+	QMutexLocker locker(&s_textureDBMutex);
+	return !s_textureDB.value(m_textureFilename).isNull();
 }
 
 void ccMaterial::MakeLightsNeutral(const QOpenGLContext* context)
@@ -251,11 +268,13 @@ void ccMaterial::MakeLightsNeutral(const QOpenGLContext* context)
 
 QImage ccMaterial::GetTexture(QString absoluteFilename)
 {
-	return s_textureDB[absoluteFilename];
+	QMutexLocker locker(&s_textureDBMutex);
+	return s_textureDB.value(absoluteFilename);
 }
 
 void ccMaterial::AddTexture(QImage image, QString absoluteFilename)
 {
+	QMutexLocker locker(&s_textureDBMutex);
 	s_textureDB[absoluteFilename] = image;
 }
 
@@ -280,7 +299,10 @@ void ccMaterial::releaseTexture()
 
 	assert(QOpenGLContext::currentContext());
 
-	s_textureDB.remove(m_textureFilename);
+	{
+		QMutexLocker locker(&s_textureDBMutex);
+		s_textureDB.remove(m_textureFilename);
+	}
 	s_openGLTextureDB.remove(m_textureFilename);
 	m_textureFilename.clear();
 }
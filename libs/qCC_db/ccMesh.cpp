@@ -44,6 +44,8 @@
 #include <string.h>
 #include <assert.h>
 #include <cmath> //for std::modf
+#include <algorithm>
+#include <limits>
 
 static CCVector3 s_blankNorm(0,0,0);
 
@@ -106,6 +108,8 @@ ccMesh::ccMesh(CCLib::GenericIndexedMesh* giMesh, ccGenericPointCloud* giVertice
 
 ccMesh::~ccMesh()
 {
+	releaseVBOs();
+
 	clearTriNormals();
 	setMaterialSet(0);
 	setTexCoordinatesTable(0);
@@ -437,6 +441,9 @@ void ccMesh::setTriNormsTable(NormsIndexesTableType* triNormsTable, bool autoRel
 	{
 		removePerTriangleNormalIndexes(); //auto-remove per-triangle indexes (we don't need them anymore)
 	}
+
+	//We must update the VBOs
+	m_vboManager.updateFlags |= vboSet::UPDATE_NORMALS;
 }
 
 void ccMesh::setMaterialSet(ccMaterialSet* materialSet, bool autoReleaseOldMaterialSet/*=true*/)
@@ -466,6 +473,9 @@ void ccMesh::setMaterialSet(ccMaterialSet* materialSet, bool autoReleaseOldMater
 		removePerTriangleMtlIndexes(); //auto-remove per-triangle indexes (we don't need them anymore)
 	}
 
+	//We must update the VBOs (the triangles are sorted by material)
+	m_vboManager.updateFlags |= vboSet::UPDATE_ALL;
+
 	//update display (for textures!)
 	setDisplay(m_currentDisplay);
 }
@@ -540,6 +550,9 @@ void ccMesh::transformTriNormals(const ccGLMatrix& trans)
                 m_triNormals->forwardIterator();
             }
         }
+
+		//We must update the VBOs
+		m_vboManager.updateFlags |= vboSet::UPDATE_NORMALS;
 	}
 }
 
@@ -641,6 +654,9 @@ bool ccMesh::laplacianSmooth(	unsigned nbIteration,
 	}
 
 	m_associatedCloud->notifyGeometryUpdate();
+	//the mesh itself may not be registered as a dependent of its vertices
+	m_bBox.setValidity(false);
+	notifyGeometryUpdate();
 
 	if (hasNormals())
 		computeNormals(!hasTriNormals());
@@ -1547,6 +1563,13 @@ const ccGLMatrix& ccMesh::getGLTransformationHistory() const
 	return m_associatedCloud ? m_associatedCloud->getGLTransformationHistory() : m_glTransHistory;
 }
 
+void ccMesh::notifyGeometryUpdate()
+{
+	ccGenericMesh::notifyGeometryUpdate();
+
+	releaseVBOs();
+}
+
 //specific methods
 void ccMesh::addTriangle(unsigned i1, unsigned i2, unsigned i3)
 {
@@ -1610,6 +1633,9 @@ void ccMesh::swapTriangles(unsigned index1, unsigned index2)
 		m_texCoordIndexes->swap(index1,index2);
 	if (m_triNormalIndexes)
 		m_triNormalIndexes->swap(index1,index2);
+
+	//We must update the VBOs
+	m_vboManager.updateFlags |= vboSet::UPDATE_ALL;
 }
 
 CCLib::VerticesIndexes* ccMesh::getTriangleVertIndexes(unsigned triangleIndex)
@@ -1787,7 +1813,28 @@ void ccMesh::drawMeOnly(CC_DRAW_CONTEXT& context)
 			EnableGLStippleMask(context.qGLContext, true);
 		}
 
-		if (!visFiltering && !(applyMaterials || showTextures) && (!glParams.showSF || greyForNanScalarValues))
+		//VBOs (the mesh is only sent to the GPU when it changes)
+		bool useVBOs = false;
+		if (	context.useVBOs
+			&&	!pushName
+			&&	!visFiltering
+			&&	!isShownAsWire()
+			&&	(!glParams.showSF || greyForNanScalarValues))
+		{
+			//no need for LOD with VBOs: the whole mesh is displayed
+			bool vboTextures = (hasTextures() && materialsShown());
+			useVBOs = updateVBOs(context, glParams, showTriNormals, vboTextures);
+			if (useVBOs)
+			{
+				drawWithVBOs(context, glParams, applyMaterials || vboTextures, vboTextures);
+			}
+		}
+
+		if (useVBOs)
+		{
+			//already displayed
+		}
+		else if (!visFiltering && !(applyMaterials || showTextures) && (!glParams.showSF || greyForNanScalarValues))
 		{
 #define OPTIM_MEM_CPY //use optimized mem. transfers
 #ifdef OPTIM_MEM_CPY
@@ -2233,6 +2280,601 @@ void ccMesh::drawMeOnly(CC_DRAW_CONTEXT& context)
 	}
 }
 
+//! Creates or resizes a GPU buffer
+/** \warning the buffer content is undefined afterwards (it must be entirely rewritten)
+	\param buffer buffer
+	\param sizeBytes buffer size (in bytes)
+	\return success
+**/
+static bool InitGLBuffer(QGLBuffer& buffer, size_t sizeBytes)
+{
+	//QGLBuffer sizes are expressed with 'int'
+	if (sizeBytes == 0 || sizeBytes > static_cast<size_t>(std::numeric_limits<int>::max()))
+	{
+		return false;
+	}
+
+	if (!buffer.isCreated())
+	{
+		if (!buffer.create())
+		{
+			//no message as it will probably happen on a lof of (old) graphic cards
+			return false;
+		}
+
+		//the mesh data is only updated occasionally
+		buffer.setUsagePattern(QGLBuffer::StaticDraw);
+	}
+
+	if (!buffer.bind())
+	{
+		ccLog::Warning("[ccMesh::InitGLBuffer] Failed to bind VBO to active context!");
+		buffer.destroy();
+		return false;
+	}
+
+	int size = static_cast<int>(sizeBytes);
+	if (buffer.size() != size)
+	{
+		buffer.allocate(size);
+
+		if (buffer.size() != size)
+		{
+			ccLog::Warning("[ccMesh::InitGLBuffer] Not enough (GPU) memory!");
+			buffer.release();
+			buffer.destroy();
+			return false;
+		}
+	}
+
+	buffer.release();
+
+	return true;
+}
+
+bool ccMesh::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams& glParams, bool showTriNormals, bool showTextures)
+{
+	if (m_vboManager.state == vboSet::FAILED)
+	{
+		//we won't try to update them again (until the geometry changes)
+		return false;
+	}
+
+	if (!m_currentDisplay)
+	{
+		ccLog::Warning(QString("[ccMesh::updateVBOs] Need an associated GL context! (mesh '%1')").arg(getName()));
+		assert(false);
+		return false;
+	}
+
+	//colors and normals are handled by real point clouds only
+	if (!m_associatedCloud || !m_associatedCloud->isA(CC_TYPES::POINT_CLOUD))
+	{
+		return false;
+	}
+	ccPointCloud* cloud = static_cast<ccPointCloud*>(m_associatedCloud);
+
+	QOpenGLFunctions_2_1* glFunc = context.glFunctions<QOpenGLFunctions_2_1>();
+	assert(glFunc != nullptr);
+	if (!glFunc)
+	{
+		return false;
+	}
+
+	unsigned triNum = size();
+	unsigned vertNum = cloud->size();
+	//per-triangle attributes can't be used with shared vertices
+	bool perTriangleVertices = (showTriNormals || showTextures);
+	bool showColors = (glParams.showSF || glParams.showColors);
+	ccScalarField* sf = (glParams.showSF ? cloud->getCurrentDisplayedScalarField() : nullptr);
+	if (glParams.showSF && !sf)
+	{
+		assert(false);
+		return false;
+	}
+	const ccMaterialSet* materials = (hasMaterials() ? m_materials : nullptr);
+
+	if (m_vboManager.state == vboSet::INITIALIZED)
+	{
+		//let's check if something has changed
+		if (	m_vboManager.perTriangleVertices != perTriangleVertices
+			||	m_vboManager.triCount != triNum
+			||	m_vboManager.vertCount != vertNum
+			||	m_vboManager.cloudVersion != cloud->getDisplayDataVersion()
+			||	m_vboManager.materials != materials)
+		{
+			m_vboManager.updateFlags = vboSet::UPDATE_ALL;
+		}
+
+		if (showColors
+			&& (	!m_vboManager.hasColors
+				||	 m_vboManager.colorIsSF != glParams.showSF
+				||	(sf && (m_vboManager.sourceSF != sf || m_vboManager.sourceSFVersion != sf->getModificationCount()))))
+		{
+			m_vboManager.updateFlags |= vboSet::UPDATE_COLORS;
+		}
+
+		if (glParams.showNorms && (!m_vboManager.hasNormals || m_vboManager.normalsArePerTriangle != showTriNormals))
+		{
+			m_vboManager.updateFlags |= vboSet::UPDATE_NORMALS;
+		}
+
+		if (showTextures && !m_vboManager.hasTexCoords)
+		{
+			m_vboManager.updateFlags |= vboSet::UPDATE_TEXCOORDS;
+		}
+
+		//nothing to do?
+		if (m_vboManager.updateFlags == 0)
+		{
+			return true;
+		}
+	}
+	else
+	{
+		m_vboManager.updateFlags = vboSet::UPDATE_ALL;
+	}
+
+	int updateFlags = m_vboManager.updateFlags;
+	//the outdated buffers that are not displayed now will be updated once they are
+	//(if the points are updated, the other buffers will have to be updated as well)
+	if (updateFlags & (vboSet::UPDATE_POINTS | vboSet::UPDATE_COLORS))
+	{
+		m_vboManager.hasColors = false;
+	}
+	if (updateFlags & (vboSet::UPDATE_POINTS | vboSet::UPDATE_NORMALS))
+	{
+		m_vboManager.hasNormals = false;
+	}
+	if (updateFlags & (vboSet::UPDATE_POINTS | vboSet::UPDATE_TEXCOORDS))
+	{
+		m_vboManager.hasTexCoords = false;
+	}
+
+	//number of vertices in the VBOs
+	size_t vboVertCount = (perTriangleVertices ? static_cast<size_t>(triNum) * 3 : static_cast<size_t>(vertNum));
+
+	//triangles sorted by material (only required to (re)build the index buffer or the duplicated vertices)
+	std::vector<unsigned> triOrder;
+	if (perTriangleVertices || (updateFlags & vboSet::UPDATE_INDEXES))
+	{
+		try
+		{
+			triOrder.resize(triNum);
+		}
+		catch (const std::bad_alloc&)
+		{
+			ccLog::Warning(QString("[ccMesh::updateVBOs] Not enough memory! (mesh '%1')").arg(getName()));
+			releaseVBOs();
+			m_vboManager.state = vboSet::FAILED;
+			return false;
+		}
+
+		m_vboManager.groups.clear();
+		if (materials)
+		{
+			//counting sort (material indexes start at -1)
+			std::vector<unsigned> firstIndexes(materials->size() + 2, 0);
+			for (unsigned i = 0; i < triNum; ++i)
+			{
+				int mtlIndex = m_triMtlIndexes->getValue(i);
+				assert(mtlIndex >= -1 && mtlIndex < static_cast<int>(materials->size()));
+				++firstIndexes[mtlIndex + 2];
+			}
+			for (size_t j = 1; j < firstIndexes.size(); ++j)
+			{
+				//number of triangles with material 'j-2'
+				unsigned count = firstIndexes[j];
+				if (count != 0)
+				{
+					MaterialGroup group = { static_cast<int>(j) - 2, firstIndexes[j - 1], count };
+					m_vboManager.groups.push_back(group);
+				}
+				firstIndexes[j] += firstIndexes[j - 1];
+			}
+			for (unsigned i = 0; i < triNum; ++i)
+			{
+				int mtlIndex = m_triMtlIndexes->getValue(i);
+				triOrder[firstIndexes[mtlIndex + 1]++] = i;
+			}
+		}
+		else
+		{
+			for (unsigned i = 0; i < triNum; ++i)
+			{
+				triOrder[i] = i;
+			}
+			MaterialGroup group = { -1, 0, triNum };
+			m_vboManager.groups.push_back(group);
+		}
+	}
+
+	//returns the index of the cloud vertex corresponding to a VBO vertex
+	auto vertexIndex = [&](unsigned vboIndex) -> unsigned
+	{
+		return perTriangleVertices ? m_triVertIndexes->getValue(triOrder[vboIndex / 3])[vboIndex % 3] : vboIndex;
+	};
+
+	//the data is sent by blocks (with the static buffers)
+	const unsigned blockSize = MAX_NUMBER_OF_ELEMENTS_PER_CHUNK * 3;
+	bool success = true;
+
+	//vertices
+	if (success && (updateFlags & vboSet::UPDATE_POINTS))
+	{
+		success = InitGLBuffer(m_vboManager.vertices, vboVertCount * 3 * sizeof(PointCoordinateType));
+		if (success)
+		{
+			m_vboManager.vertices.bind();
+			for (unsigned first = 0; first < vboVertCount; first += blockSize)
+			{
+				unsigned count = std::min(blockSize, static_cast<unsigned>(vboVertCount) - first);
+				PointCoordinateType* _vertices = GetVertexBuffer();
+				for (unsigned i = first; i < first + count; ++i)
+				{
+					const CCVector3* P = m_associatedCloud->getPoint(vertexIndex(i));
+					*(_vertices)++ = P->x;
+					*(_vertices)++ = P->y;
+					*(_vertices)++ = P->z;
+				}
+				m_vboManager.vertices.write(static_cast<int>(first * 3 * sizeof(PointCoordinateType)), GetVertexBuffer(), static_cast<int>(count * 3 * sizeof(PointCoordinateType)));
+			}
+			m_vboManager.vertices.release();
+		}
+	}
+
+	//colors
+	if (success && showColors && (updateFlags & vboSet::UPDATE_COLORS))
+	{
+		success = InitGLBuffer(m_vboManager.colors, vboVertCount * 3 * sizeof(ColorCompType));
+		if (success)
+		{
+			ColorsTableType* rgbColors = cloud->rgbColors();
+			assert(sf || rgbColors);
+
+			m_vboManager.colors.bind();
+			for (unsigned first = 0; first < vboVertCount; first += blockSize)
+			{
+				unsigned count = std::min(blockSize, static_cast<unsigned>(vboVertCount) - first);
+				ColorCompType* _rgbColors = GetColorsBuffer();
+				for (unsigned i = first; i < first + count; ++i)
+				{
+					unsigned index = vertexIndex(i);
+					const ColorCompType* col = (sf ? sf->getValueColor(index) : rgbColors->getValue(index));
+					if (!col)
+						col = ccColor::lightGrey.rgba;
+					*(_rgbColors)++ = col[0];
+					*(_rgbColors)++ = col[1];
+					*(_rgbColors)++ = col[2];
+				}
+				m_vboManager.colors.write(static_cast<int>(first * 3 * sizeof(ColorCompType)), GetColorsBuffer(), static_cast<int>(count * 3 * sizeof(ColorCompType)));
+			}
+			m_vboManager.colors.release();
+
+			m_vboManager.hasColors = true;
+			m_vboManager.colorIsSF = glParams.showSF;
+			m_vboManager.sourceSF = sf;
+			m_vboManager.sourceSFVersion = (sf ? sf->getModificationCount() : 0);
+		}
+	}
+
+	//normals (decoded)
+	if (success && glParams.showNorms && (updateFlags & vboSet::UPDATE_NORMALS))
+	{
+		success = InitGLBuffer(m_vboManager.normals, vboVertCount * 3 * sizeof(PointCoordinateType));
+		if (success)
+		{
+			NormsIndexesTableType* normalsIndexesTable = (showTriNormals ? nullptr : cloud->normals());
+			assert(showTriNormals || normalsIndexesTable);
+
+			m_vboManager.normals.bind();
+			for (unsigned first = 0; first < vboVertCount; first += blockSize)
+			{
+				unsigned count = std::min(blockSize, static_cast<unsigned>(vboVertCount) - first);
+				PointCoordinateType* _normals = GetNormalsBuffer();
+				for (unsigned i = first; i < first + count; ++i)
+				{
+					if (showTriNormals)
+					{
+						const int* idx = m_triNormalIndexes->getValue(triOrder[i / 3]);
+						int normIndex = idx[i % 3];
+						assert(normIndex < static_cast<int>(m_triNormals->currentSize()));
+						const CCVector3& N = (normIndex >= 0 ? ccNormalVectors::GetNormal(m_triNormals->getValue(normIndex)) : s_blankNorm);
+						*(_normals)++ = N.x;
+						*(_normals)++ = N.y;
+						*(_normals)++ = N.z;
+					}
+					else
+					{
+						const CCVector3& N = ccNormalVectors::GetNormal(normalsIndexesTable->getValue(vertexIndex(i)));
+						*(_normals)++ = N.x;
+						*(_normals)++ = N.y;
+						*(_normals)++ = N.z;
+					}
+				}
+				m_vboManager.normals.write(static_cast<int>(first * 3 * sizeof(PointCoordinateType)), GetNormalsBuffer(), static_cast<int>(count * 3 * sizeof(PointCoordinateType)));
+			}
+			m_vboManager.normals.release();
+
+			m_vboManager.hasNormals = true;
+			m_vboManager.normalsArePerTriangle = showTriNormals;
+		}
+	}
+
+	//texture coordinates
+	if (success && showTextures && (updateFlags & vboSet::UPDATE_TEXCOORDS))
+	{
+		assert(perTriangleVertices);
+		success = InitGLBuffer(m_vboManager.texCoords, vboVertCount * 2 * sizeof(float));
+		if (success)
+		{
+			try
+			{
+				std::vector<float> texCoords(2 * static_cast<size_t>(std::min(blockSize, static_cast<unsigned>(vboVertCount))));
+
+				m_vboManager.texCoords.bind();
+				for (unsigned first = 0; first < vboVertCount; first += blockSize)
+				{
+					unsigned count = std::min(blockSize, static_cast<unsigned>(vboVertCount) - first);
+					float* _texCoords = &(texCoords[0]);
+					for (unsigned i = first; i < first + count; ++i)
+					{
+						const int* txInd = m_texCoordIndexes->getValue(triOrder[i / 3]);
+						int txIndex = txInd[i % 3];
+						assert(txIndex < static_cast<int>(m_texCoords->currentSize()));
+						const float* Tx = (txIndex >= 0 ? m_texCoords->getValue(txIndex) : 0);
+						*(_texCoords)++ = (Tx ? Tx[0] : 0.0f);
+						*(_texCoords)++ = (Tx ? Tx[1] : 0.0f);
+					}
+					m_vboManager.texCoords.write(static_cast<int>(first * 2 * sizeof(float)), &(texCoords[0]), static_cast<int>(count * 2 * sizeof(float)));
+				}
+				m_vboManager.texCoords.release();
+
+				m_vboManager.hasTexCoords = true;
+			}
+			catch (const std::bad_alloc&)
+			{
+				success = false;
+			}
+		}
+	}
+
+	//triangle indexes (shared vertices only)
+	if (perTriangleVertices)
+	{
+		if (m_vboManager.indexes.isCreated())
+		{
+			m_vboManager.indexes.destroy();
+		}
+	}
+	else if (success && (updateFlags & vboSet::UPDATE_INDEXES))
+	{
+		success = InitGLBuffer(m_vboManager.indexes, static_cast<size_t>(triNum) * 3 * sizeof(GLuint));
+		if (success)
+		{
+			try
+			{
+				const unsigned triBlockSize = blockSize / 3;
+				std::vector<GLuint> indexes(3 * static_cast<size_t>(std::min(triBlockSize, triNum)));
+
+				m_vboManager.indexes.bind();
+				for (unsigned first = 0; first < triNum; first += triBlockSize)
+				{
+					unsigned count = std::min(triBlockSize, triNum - first);
+					GLuint* _indexes = &(indexes[0]);
+					for (unsigned i = first; i < first + count; ++i)
+					{
+						const unsigned* tri = m_triVertIndexes->getValue(triOrder[i]);
+						*(_indexes)++ = tri[0];
+						*(_indexes)++ = tri[1];
+						*(_indexes)++ = tri[2];
+					}
+					m_vboManager.indexes.write(static_cast<int>(first * 3 * sizeof(GLuint)), &(indexes[0]), static_cast<int>(count * 3 * sizeof(GLuint)));
+				}
+				m_vboManager.indexes.release();
+			}
+			catch (const std::bad_alloc&)
+			{
+				success = false;
+			}
+		}
+	}
+
+	//if an error is detected
+	if (success && glFunc->glGetError() != GL_NO_ERROR)
+	{
+		success = false;
+	}
+
+	if (!success)
+	{
+		ccLog::Warning(QString("[ccMesh::updateVBOs] Failed to initialize VBOs (not enough memory?) (mesh '%1')").arg(getName()));
+		releaseVBOs();
+		m_vboManager.state = vboSet::FAILED;
+		return false;
+	}
+
+	m_vboManager.perTriangleVertices = perTriangleVertices;
+	m_vboManager.materials = materials;
+	m_vboManager.cloudVersion = cloud->getDisplayDataVersion();
+	m_vboManager.vertCount = vertNum;
+	m_vboManager.triCount = triNum;
+
+	int totalSizeBytesBefore = m_vboManager.totalMemSizeBytes;
+	m_vboManager.totalMemSizeBytes = 0;
+	{
+		const QGLBuffer* buffers[5] = { &m_vboManager.vertices, &m_vboManager.colors, &m_vboManager.normals, &m_vboManager.texCoords, &m_vboManager.indexes };
+		for (const QGLBuffer* buffer : buffers)
+		{
+			if (buffer->isCreated())
+				m_vboManager.totalMemSizeBytes += buffer->size();
+		}
+	}
+
+	if (m_vboManager.totalMemSizeBytes != totalSizeBytesBefore)
+		ccLog::Print(QString("[VBO] VBO(s) (re)initialized for mesh '%1' (%2 Mb - %3 vertices)")
+			.arg(getName())
+			.arg(static_cast<double>(m_vboManager.totalMemSizeBytes) / (1 << 20), 0, 'f', 2)
+			.arg(perTriangleVertices ? "duplicated" : "shared"));
+
+	m_vboManager.state = vboSet::INITIALIZED;
+	m_vboManager.updateFlags = 0;
+
+	return true;
+}
+
+void ccMesh::drawWithVBOs(CC_DRAW_CONTEXT& context, const glDrawParams& glParams, bool applyMaterials, bool showTextures)
+{
+	assert(m_vboManager.state == vboSet::INITIALIZED);
+
+	QOpenGLFunctions_2_1* glFunc = context.glFunctions<QOpenGLFunctions_2_1>();
+	assert(glFunc != nullptr);
+
+	//the GL type depends on the PointCoordinateType 'size' (float or double)
+	GLenum GL_COORD_TYPE = sizeof(PointCoordinateType) == 4 ? GL_FLOAT : GL_DOUBLE;
+
+	glFunc->glEnableClientState(GL_VERTEX_ARRAY);
+	m_vboManager.vertices.bind();
+	glFunc->glVertexPointer(3, GL_COORD_TYPE, 0, 0);
+	m_vboManager.vertices.release();
+
+	if (glParams.showNorms)
+	{
+		assert(m_vboManager.hasNormals);
+		glFunc->glEnableClientState(GL_NORMAL_ARRAY);
+		m_vboManager.normals.bind();
+		glFunc->glNormalPointer(GL_COORD_TYPE, 0, 0);
+		m_vboManager.normals.release();
+	}
+	if (glParams.showSF || glParams.showColors)
+	{
+		assert(m_vboManager.hasColors);
+		glFunc->glEnableClientState(GL_COLOR_ARRAY);
+		m_vboManager.colors.bind();
+		glFunc->glColorPointer(3, GL_UNSIGNED_BYTE, 0, 0);
+		m_vboManager.colors.release();
+	}
+	if (showTextures)
+	{
+		assert(m_vboManager.hasTexCoords);
+		glFunc->glPushAttrib(GL_ENABLE_BIT);
+		glFunc->glEnable(GL_TEXTURE_2D);
+		glFunc->glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		m_vboManager.texCoords.bind();
+		glFunc->glTexCoordPointer(2, GL_FLOAT, 0, 0);
+		m_vboManager.texCoords.release();
+	}
+
+	if (!m_vboManager.perTriangleVertices)
+	{
+		m_vboManager.indexes.bind();
+	}
+
+	//draws a set of consecutive triangles
+	auto drawTriangles = [&](unsigned start, unsigned count)
+	{
+		if (m_vboManager.perTriangleVertices)
+		{
+			glFunc->glDrawArrays(GL_TRIANGLES, static_cast<GLint>(start * 3), static_cast<GLsizei>(count * 3));
+		}
+		else
+		{
+			size_t offset = static_cast<size_t>(start) * 3 * sizeof(GLuint);
+			glFunc->glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(count * 3), GL_UNSIGNED_INT, reinterpret_cast<const GLvoid*>(offset));
+		}
+	};
+
+	if (applyMaterials)
+	{
+		GLuint currentTexID = 0;
+		for (const MaterialGroup& group : m_vboManager.groups)
+		{
+			assert(group.mtlIndex < 0 || (m_materials && group.mtlIndex < static_cast<int>(m_materials->size())));
+
+			if (showTextures)
+			{
+				GLuint texID = (group.mtlIndex >= 0 ? m_materials->at(group.mtlIndex)->getTextureID() : 0);
+				if (texID != currentTexID)
+				{
+					glFunc->glBindTexture(GL_TEXTURE_2D, texID);
+					currentTexID = texID;
+				}
+			}
+
+			//if we don't have any current material, we apply default one
+			if (group.mtlIndex >= 0)
+				(*m_materials)[group.mtlIndex]->applyGL(context.qGLContext, glParams.showNorms, false);
+			else
+				context.defaultMat->applyGL(context.qGLContext, glParams.showNorms, false);
+
+			drawTriangles(group.start, group.count);
+		}
+
+		if (currentTexID)
+		{
+			glFunc->glBindTexture(GL_TEXTURE_2D, 0);
+		}
+	}
+	else
+	{
+		//all the triangles at once
+		drawTriangles(0, m_vboManager.triCount);
+	}
+
+	if (!m_vboManager.perTriangleVertices)
+	{
+		m_vboManager.indexes.release();
+	}
+
+	//disable arrays
+	glFunc->glDisableClientState(GL_VERTEX_ARRAY);
+	if (glParams.showNorms)
+		glFunc->glDisableClientState(GL_NORMAL_ARRAY);
+	if (glParams.showSF || glParams.showColors)
+		glFunc->glDisableClientState(GL_COLOR_ARRAY);
+	if (showTextures)
+	{
+		glFunc->glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		glFunc->glPopAttrib();
+	}
+}
+
+void ccMesh::releaseVBOs()
+{
+	if (m_vboManager.state == vboSet::NEW)
+		return;
+
+	//'destroy' all buffers
+	QGLBuffer* buffers[5] = { &m_vboManager.vertices, &m_vboManager.colors, &m_vboManager.normals, &m_vboManager.texCoords, &m_vboManager.indexes };
+	for (QGLBuffer* buffer : buffers)
+	{
+		if (buffer->isCreated())
+			buffer->destroy();
+	}
+
+	m_vboManager.groups.clear();
+	m_vboManager.hasColors = false;
+	m_vboManager.hasNormals = false;
+	m_vboManager.hasTexCoords = false;
+	m_vboManager.colorIsSF = false;
+	m_vboManager.sourceSF = nullptr;
+	m_vboManager.materials = nullptr;
+	m_vboManager.totalMemSizeBytes = 0;
+	m_vboManager.updateFlags = 0;
+	m_vboManager.state = vboSet::NEW;
+}
+
+void ccMesh::removeFromDisplay(const ccGenericGLDisplay* win)
+{
+	if (win == m_currentDisplay)
+	{
+		releaseVBOs();
+	}
+
+	//call parent's method
+	ccGenericMesh::removeFromDisplay(win);
+}
+
 ccMesh* ccMesh::createNewMeshFromSelection(bool removeSelectedFaces)
 {
 	if (!m_associatedCloud)
@@ -2663,6 +3305,9 @@ void ccMesh::shiftTriangleIndexes(unsigned shift)
 		ti[2] += shift;
 		m_triVertIndexes->forwardIterator();
 	}
+
+	//We must update the VBOs
+	m_vboManager.updateFlags |= vboSet::UPDATE_ALL;
 }
 
 /*********************************************************/
@@ -2707,6 +3352,9 @@ void ccMesh::setTriangleNormalIndexes(unsigned triangleIndex, int i1, int i2, in
 	assert(m_triNormalIndexes && m_triNormalIndexes->currentSize() > triangleIndex);
 	int indexes[3] = { i1, i2, i3 };
 	m_triNormalIndexes->setValue(triangleIndex, indexes);
+
+	//We must update the VBOs
+	m_vboManager.updateFlags |= vboSet::UPDATE_NORMALS;
 }
 
 void ccMesh::getTriangleNormalIndexes(unsigned triangleIndex, int& i1, int& i2, int& i3) const
@@ -2783,6 +3431,9 @@ void ccMesh::setTexCoordinatesTable(TextureCoordsContainer* texCoordsTable, bool
 	{
 		removePerTriangleTexCoordIndexes(); //auto-remove per-triangle indexes (we don't need them anymore)
 	}
+
+	//We must update the VBOs
+	m_vboManager.updateFlags |= vboSet::UPDATE_TEXCOORDS;
 }
 
 void ccMesh::getTriangleTexCoordinates(unsigned triIndex, float* &tx1, float* &tx2, float* &tx3) const
@@ -2835,6 +3486,9 @@ void ccMesh::setTriangleTexCoordIndexes(unsigned triangleIndex, int i1, int i2,
 	assert(m_texCoordIndexes && m_texCoordIndexes->currentSize() > triangleIndex);
 	int indexes[3] = { i1, i2, i3 };
 	m_texCoordIndexes->setValue(triangleIndex,indexes);
+
+	//We must update the VBOs
+	m_vboManager.updateFlags |= vboSet::UPDATE_TEXCOORDS;
 }
 
 void ccMesh::getTriangleTexCoordinatesIndexes(unsigned triangleIndex, int& i1, int& i2, int& i3) const
@@ -2877,6 +3531,9 @@ void ccMesh::setTriangleMtlIndexesTable(triangleMaterialIndexesSet* matIndexesTa
 	{
 		m_triMtlIndexes->link();
 	}
+
+	//We must update the VBOs (the triangles are sorted by material)
+	m_vboManager.updateFlags |= vboSet::UPDATE_ALL;
 }
 
 bool ccMesh::reservePerTriangleMtlIndexes()
@@ -2910,6 +3567,9 @@ void ccMesh::setTriangleMtlIndex(unsigned triangleIndex, int mtlIndex)
 {
 	assert(m_triMtlIndexes && m_triMtlIndexes->currentSize() > triangleIndex);
 	m_triMtlIndexes->setValue(triangleIndex,mtlIndex);
+
+	//We must update the VBOs (the triangles are sorted by material)
+	m_vboManager.updateFlags |= vboSet::UPDATE_ALL;
 }
 
 int ccMesh::getTriangleMtlIndex(unsigned triangleIndex) const
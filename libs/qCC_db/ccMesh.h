@@ -25,8 +25,12 @@
 //Local
 #include "ccGenericMesh.h"
 
+//Qt
+#include <QGLBuffer>
+
 class ccProgressDialog;
 class ccPolyline;
+class ccScalarField;
 
 //! Triangular mesh
 class QCC_DB_LIB_API ccMesh : public ccGenericMesh
@@ -89,6 +93,7 @@ public:
 	virtual ccBBox getOwnBB(bool withGLFeatures = false) override;
 	virtual bool isSerializable() const override { return true; }
 	virtual const ccGLMatrix& getGLTransformationHistory() const override;
+	virtual void notifyGeometryUpdate() override; //for proper VBO release
 
 	//inherited methods (ccGenericMesh)
 	inline virtual ccGenericPointCloud* getAssociatedCloud() const override { return m_associatedCloud; }
@@ -121,6 +126,7 @@ public:
 	virtual bool hasDisplayedScalarField() const override;
 	virtual bool normalsShown() const override;
 	virtual void toggleMaterials() override { showMaterials(!materialsShown()); }
+	virtual void removeFromDisplay(const ccGenericGLDisplay* win) override; //for proper VBO release
 
 	//! Shifts all triangles indexes
 	/** \param shift index shift (positive)
@@ -458,6 +464,108 @@ protected:
 	typedef GenericChunkedArray<3,int> triangleNormalsIndexesSet;
 	//! Mesh normals indexes (per-triangle)
 	triangleNormalsIndexesSet* m_triNormalIndexes;
+
+protected: // VBO
+
+	//! Init/updates VBOs
+	/** \param context draw context
+		\param glParams display parameters
+		\param showTriNormals whether per-triangle normals are displayed
+		\param showTextures whether textures are displayed
+		\return whether the VBOs can be used for display
+	**/
+	bool updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams& glParams, bool showTriNormals, bool showTextures);
+
+	//! Release VBOs
+	void releaseVBOs();
+
+	//! Draws the triangles with the VBOs (see updateVBOs)
+	void drawWithVBOs(CC_DRAW_CONTEXT& context, const glDrawParams& glParams, bool applyMaterials, bool showTextures);
+
+	//! Consecutive triangles sharing the same material (in the VBOs)
+	struct MaterialGroup
+	{
+		//! Material index (-1 = none)
+		int mtlIndex;
+		//! First triangle
+		unsigned start;
+		//! Number of triangles
+		unsigned count;
+	};
+
+	//! VBO set
+	/** By default the vertices are shared and the triangles are drawn with an
+		index buffer. If per-triangle normals or texture coordinates are required,
+		the vertices are duplicated instead (3 per triangle). In both cases, the
+		triangles are sorted by material.
+	**/
+	struct vboSet
+	{
+		//! States of th VBO(s)
+		enum STATES { NEW, INITIALIZED, FAILED };
+
+		//! Update flags
+		enum UPDATE_FLAGS {
+			UPDATE_POINTS = 1,
+			UPDATE_COLORS = 2,
+			UPDATE_NORMALS = 4,
+			UPDATE_TEXCOORDS = 8,
+			UPDATE_INDEXES = 16,
+			UPDATE_ALL = UPDATE_POINTS | UPDATE_COLORS | UPDATE_NORMALS | UPDATE_TEXCOORDS | UPDATE_INDEXES
+		};
+
+		vboSet()
+			: vertices(QGLBuffer::VertexBuffer)
+			, colors(QGLBuffer::VertexBuffer)
+			, normals(QGLBuffer::VertexBuffer)
+			, texCoords(QGLBuffer::VertexBuffer)
+			, indexes(QGLBuffer::IndexBuffer)
+			, perTriangleVertices(false)
+			, hasColors(false)
+			, colorIsSF(false)
+			, sourceSF(nullptr)
+			, sourceSFVersion(0)
+			, hasNormals(false)
+			, normalsArePerTriangle(false)
+			, hasTexCoords(false)
+			, materials(nullptr)
+			, cloudVersion(0)
+			, vertCount(0)
+			, triCount(0)
+			, totalMemSizeBytes(0)
+			, updateFlags(0)
+			, state(NEW)
+		{}
+
+		QGLBuffer vertices;
+		QGLBuffer colors;
+		QGLBuffer normals;
+		QGLBuffer texCoords;
+		QGLBuffer indexes;
+		//! Triangles (sorted by material)
+		std::vector<MaterialGroup> groups;
+
+		bool perTriangleVertices;
+		bool hasColors;
+		bool colorIsSF;
+		ccScalarField* sourceSF;
+		unsigned sourceSFVersion;
+		bool hasNormals;
+		bool normalsArePerTriangle;
+		bool hasTexCoords;
+		const ccMaterialSet* materials;
+		unsigned cloudVersion;
+		unsigned vertCount;
+		unsigned triCount;
+		int totalMemSizeBytes;
+		int updateFlags;
+
+		//! Current state
+		STATES state;
+	};
+
+	//! Set of VBOs attached to this mesh
+	vboSet m_vboManager;
 };
 
 #endif //CC_MESH_HEADER
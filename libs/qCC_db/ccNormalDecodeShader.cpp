@@ -0,0 +1,182 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#include "ccNormalDecodeShader.h"
+
+//Local
+#include "ccLog.h"
+#include "ccNormalVectors.h"
+
+//Qt
+#include <QOpenGLTexture>
+
+//system
+#include <assert.h>
+#include <vector>
+
+//! Width of the table of normals (in texels)
+static const int c_tableWidth = 2048;
+//! Texture unit used for the table of normals
+static const unsigned c_tableTextureUnit = 1;
+
+ccNormalDecodeShader::ccNormalDecodeShader()
+	: ccShader()
+	, m_table(nullptr)
+	, m_normalCodeAttribute(-1)
+{
+}
+
+ccNormalDecodeShader::~ccNormalDecodeShader()
+{
+	if (m_table)
+	{
+		delete m_table;
+		m_table = nullptr;
+	}
+}
+
+bool ccNormalDecodeShader::IsSupported(QOpenGLFunctions_2_1* glFunc)
+{
+	if (!glFunc)
+	{
+		assert(false);
+		return false;
+	}
+
+	//the table is read in the vertex shader
+	GLint vertexTextureUnits = 0;
+	glFunc->glGetIntegerv(GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS, &vertexTextureUnits);
+	if (vertexTextureUnits < 1)
+	{
+		return false;
+	}
+
+	GLint maxTextureSize = 0;
+	glFunc->glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	return (maxTextureSize >= c_tableWidth);
+}
+
+bool ccNormalDecodeShader::initTable()
+{
+	if (m_table)
+	{
+		//already initialized
+		return true;
+	}
+
+	m_normalCodeAttribute = attributeLocation("a_normalCode");
+	if (m_normalCodeAttribute < 0)
+	{
+		return false;
+	}
+
+	const ccNormalVectors* normalVectors = ccNormalVectors::GetUniqueInstance();
+	unsigned normalCount = ccNormalVectors::GetNumberOfVectors();
+	if (!normalVectors || normalCount == 0)
+	{
+		return false;
+	}
+	int tableHeight = static_cast<int>((normalCount + c_tableWidth - 1) / c_tableWidth);
+
+	//normals are stored as 16 bits unsigned values: (N + 1) / 2
+	std::vector<GLushort> texels;
+	try
+	{
+		texels.resize(static_cast<size_t>(c_tableWidth) * tableHeight * 3, 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+	for (unsigned i = 0; i < normalCount; ++i)
+	{
+		const CCVector3& N = normalVectors->getNormal(i);
+		for (unsigned d = 0; d < 3; ++d)
+		{
+			texels[i * 3 + d] = static_cast<GLushort>((N.u[d] + 1) / 2 * 65535 + 0.5);
+		}
+	}
+
+	QOpenGLTexture* table = new QOpenGLTexture(QOpenGLTexture::Target2D);
+	table->setSize(c_tableWidth, tableHeight);
+	table->setFormat(QOpenGLTexture::RGB16_UNorm);
+	table->setMipLevels(1);
+	table->setMinMagFilters(QOpenGLTexture::Nearest, QOpenGLTexture::Nearest);
+	table->setWrapMode(QOpenGLTexture::ClampToEdge);
+	table->allocateStorage();
+	if (!table->isStorageAllocated())
+	{
+		delete table;
+		return false;
+	}
+	table->setData(QOpenGLTexture::RGB, QOpenGLTexture::UInt16, texels.data());
+
+	ccLog::PrintDebug(QString("[ccNormalDecodeShader] Table of normals loaded (%1 x %2 texels)").arg(c_tableWidth).arg(tableHeight));
+
+	m_table = table;
+	return true;
+}
+
+bool ccNormalDecodeShader::start(QOpenGLFunctions_2_1* glFunc)
+{
+	if (!glFunc || !m_table || m_normalCodeAttribute < 0)
+	{
+		assert(false);
+		return false;
+	}
+
+	if (!bind())
+	{
+		return false;
+	}
+
+	m_table->bind(c_tableTextureUnit, QOpenGLTexture::ResetTextureUnit);
+
+	setUniformValue("s_normalTable", static_cast<GLint>(c_tableTextureUnit));
+	setUniformValue("uf_tableWidth", static_cast<GLfloat>(m_table->width()));
+	setUniformValue("uf_tableHeight", static_cast<GLfloat>(m_table->height()));
+	setUniformValue("uf_colorMaterial", glFunc->glIsEnabled(GL_COLOR_MATERIAL) ? 1.0f : 0.0f);
+	setUniformValue("uv_lightEnabled",	glFunc->glIsEnabled(GL_LIGHT0) ? 1.0f : 0.0f,
+										glFunc->glIsEnabled(GL_LIGHT1) ? 1.0f : 0.0f);
+
+	glFunc->glEnableVertexAttribArray(static_cast<GLuint>(m_normalCodeAttribute));
+
+	return true;
+}
+
+void ccNormalDecodeShader::stop(QOpenGLFunctions_2_1* glFunc)
+{
+	if (glFunc && m_normalCodeAttribute >= 0)
+	{
+		glFunc->glDisableVertexAttribArray(static_cast<GLuint>(m_normalCodeAttribute));
+	}
+	if (m_table)
+	{
+		m_table->release(c_tableTextureUnit, QOpenGLTexture::ResetTextureUnit);
+	}
+
+	release();
+}
+
+void ccNormalDecodeShader::setNormalCodePointer(QOpenGLFunctions_2_1* glFunc, GLsizei stride, const GLvoid* pointer)
+{
+	assert(glFunc && m_normalCodeAttribute >= 0);
+
+	//the codes are converted to floats by the GPU (exact as they are lower than 2^24)
+	glFunc->glVertexAttribPointer(static_cast<GLuint>(m_normalCodeAttribute), 1, GL_UNSIGNED_INT, GL_FALSE, stride, pointer);
+}
@@ -0,0 +1,78 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_NORMAL_DECODE_SHADER_HEADER
+#define CC_NORMAL_DECODE_SHADER_HEADER
+
+//Always on top!
+#include "ccIncludeGL.h"
+
+//CCFbo
+#include <ccShader.h>
+
+//Local
+#include "qCC_db.h"
+
+class QOpenGLTexture;
+
+//! Shader to display compressed normals without decoding them on the CPU side
+/** The compressed normals (see ccNormalVectors) are sent as they are (as a vertex
+	attribute) and decoded in the vertex shader with a lookup in a texture containing
+	all the possible normals. The lighting is the same as the fixed-function pipeline
+	(lights 0 and 1, color material on the diffuse component).
+	Requires the 'vertex texture fetch' feature.
+**/
+class QCC_DB_LIB_API ccNormalDecodeShader : public ccShader
+{
+public:
+
+	//! Default constructor
+	ccNormalDecodeShader();
+
+	//! Destructor
+	/** The GL context should be active.
+	**/
+	virtual ~ccNormalDecodeShader();
+
+	//! Returns whether the GPU supports this shader or not
+	static bool IsSupported(QOpenGLFunctions_2_1* glFunc);
+
+	//! Uploads the table of normals (as a texture)
+	/** Should be called once after the program has been loaded (with an active GL context).
+	**/
+	bool initTable();
+
+	//! Starts the shader (binds the program and the table of normals)
+	/** Should be called after the lights and the material have been set up.
+	**/
+	bool start(QOpenGLFunctions_2_1* glFunc);
+
+	//! Stops the shader
+	void stop(QOpenGLFunctions_2_1* glFunc);
+
+	//! Sets the compressed normals array (client-side array or offset in the currently bound VBO)
+	void setNormalCodePointer(QOpenGLFunctions_2_1* glFunc, GLsizei stride, const GLvoid* pointer);
+
+protected:
+
+	//! Table of normals
+	QOpenGLTexture* m_table;
+	//! Location of the compressed normal attribute
+	int m_normalCodeAttribute;
+};
+
+#endif //CC_NORMAL_DECODE_SHADER_HEADER
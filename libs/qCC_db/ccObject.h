@@ -23,6 +23,7 @@
 
 //Qt
 #include <qglobal.h>
+#include <QAtomicInteger>
 #include <QVariant>
 #include <QSharedPointer>
 
@@ -68,7 +69,7 @@ enum CC_OBJECT_FLAG {	//CC_UNUSED			= 1, //DGM: not used anymore (former CC_FATH
 #define CC_TEX_COORDS_BIT				0x00000080000000	//Texture coordinates (u,v)
 #define CC_CAMERA_BIT					0x00000100000080	//For camera sensors (projective sensors)
 #define CC_QUADRIC_BIT					0x00000200000080	//Quadric (primitive)
-//#define CC_FREE_BIT					0x00000400000080
+#define CC_OUT_OF_CORE_BIT				0x00000400000000	//Out-of-core (on-disk) data
 //#define CC_FREE_BIT					0x00000800000080
 //#define CC_FREE_BIT					0x00000400000080
 //#define CC_FREE_BIT					0x00001000000080
@@ -125,6 +126,7 @@ public:
 	static const CC_CLASS_ENUM VIEWPORT_2D_LABEL	=	VIEWPORT_2D_OBJECT	| CC_LABEL_BIT;
 	static const CC_CLASS_ENUM CLIPPING_BOX			=	CC_CLIP_BOX_BIT		| CC_LEAF_BIT;
 	static const CC_CLASS_ENUM TRANS_BUFFER			=	HIERARCHY_OBJECT	| CC_TRANS_BUFFER_BIT		| CC_LEAF_BIT;
+	static const CC_CLASS_ENUM OUT_OF_CORE_CLOUD	=	HIERARCHY_OBJECT	| CC_OUT_OF_CORE_BIT		| CC_LEAF_BIT;
 
 	//  Custom types
 	/** Custom objects are typically defined by plugins. They can be inserted in an object
@@ -160,16 +162,24 @@ public:
 	ccUniqueIDGenerator() : m_lastUniqueID(0) {}
 
 	//! Resets the unique ID
-	void reset() { m_lastUniqueID = 0; }
+	void reset() { m_lastUniqueID.store(0); }
 	//! Returns a (new) unique ID
-	unsigned fetchOne() { return ++m_lastUniqueID; }
+	unsigned fetchOne() { return m_lastUniqueID.fetchAndAddOrdered(1) + 1; }
 	//! Returns the value of the last generated unique ID
-	unsigned getLast() const { return m_lastUniqueID; }
+	unsigned getLast() const { return m_lastUniqueID.load(); }
 	//! Updates the value of the last generated unique ID with the current one
-	void update(unsigned ID) { if (ID > m_lastUniqueID) m_lastUniqueID = ID; }
+	void update(unsigned ID)
+	{
+		unsigned lastID = m_lastUniqueID.load();
+		while (ID > lastID && !m_lastUniqueID.testAndSetOrdered(lastID, ID))
+		{
+			lastID = m_lastUniqueID.load();
+		}
+	}
 
 protected:
-	unsigned m_lastUniqueID;
+	//! Last generated unique ID (thread-safe, as entities can be created by background threads - e.g. when loading files)
+	QAtomicInteger<unsigned> m_lastUniqueID;
 };
 
 //! Generic "CloudCompare Object" template
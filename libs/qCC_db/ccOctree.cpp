@@ -31,6 +31,12 @@
 #include <ScalarFieldTools.h>
 #include <RayAndBox.h>
 
+//Qt
+#include <QFile>
+
+//system
+#include <string.h>
+
 #ifdef QT_DEBUG
 //#define DEBUG_PICKING_MECHANISM
 #endif
@@ -97,6 +103,177 @@ void ccOctree::clear()
 	DgmOctree::clear();
 }
 
+//! Size of a saved (index, code) record
+static const unsigned c_codeRecordSize = sizeof(unsigned) + sizeof(DgmOctree::CellCode);
+//! Number of (index, code) records written or read at once
+static const unsigned c_codeRecordsPerBlock = 65536;
+
+bool ccOctree::toFile(QFile& out) const
+{
+	//octree settings (the codes can only be reloaded by a compatible version)
+	uint8_t settings[3] = {	static_cast<uint8_t>(MAX_OCTREE_LEVEL),
+							static_cast<uint8_t>(sizeof(CellCode)),
+							static_cast<uint8_t>(c_codeRecordSize) };
+	if (out.write((const char*)settings, 3) < 0)
+		return false;
+
+	uint32_t codeCount = static_cast<uint32_t>(m_thePointsAndTheirCellCodes.size());
+	uint32_t projectedPointCount = static_cast<uint32_t>(m_numberOfProjectedPoints);
+	if (	out.write((const char*)&codeCount, 4) < 0
+		||	out.write((const char*)&projectedPointCount, 4) < 0)
+		return false;
+
+	//bounding-boxes
+	double bbs[12];
+	for (unsigned d = 0; d < 3; ++d)
+	{
+		bbs[d] = m_dimMin.u[d];
+		bbs[3 + d] = m_dimMax.u[d];
+		bbs[6 + d] = m_pointsMin.u[d];
+		bbs[9 + d] = m_pointsMax.u[d];
+	}
+	if (out.write((const char*)bbs, sizeof(double) * 12) < 0)
+		return false;
+
+	//fill indexes
+	if (out.write((const char*)m_fillIndexes, sizeof(m_fillIndexes)) < 0)
+		return false;
+
+	//codes (written member by member, so that the structure padding is not saved)
+	std::vector<char> buffer;
+	try
+	{
+		buffer.resize(static_cast<size_t>(std::min(codeCount, c_codeRecordsPerBlock)) * c_codeRecordSize);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+	for (uint32_t first = 0; first < codeCount; first += c_codeRecordsPerBlock)
+	{
+		uint32_t count = std::min(c_codeRecordsPerBlock, codeCount - first);
+		char* record = buffer.data();
+		for (uint32_t i = first; i < first + count; ++i)
+		{
+			const IndexAndCode& ic = m_thePointsAndTheirCellCodes[i];
+			memcpy(record, &ic.theIndex, sizeof(unsigned));
+			memcpy(record + sizeof(unsigned), &ic.theCode, sizeof(CellCode));
+			record += c_codeRecordSize;
+		}
+		if (out.write(buffer.data(), static_cast<qint64>(count) * c_codeRecordSize) < 0)
+			return false;
+	}
+
+	return true;
+}
+
+bool ccOctree::fromFile(QFile& in)
+{
+	uint8_t settings[3] = { 0, 0, 0 };
+	if (in.read((char*)settings, 3) < 0)
+		return false;
+
+	if (	settings[0] != MAX_OCTREE_LEVEL
+		||	settings[1] != sizeof(CellCode)
+		||	settings[2] != c_codeRecordSize)
+	{
+		//incompatible octree
+		return false;
+	}
+
+	uint32_t codeCount = 0;
+	uint32_t projectedPointCount = 0;
+	if (	in.read((char*)&codeCount, 4) < 0
+		||	in.read((char*)&projectedPointCount, 4) < 0)
+		return false;
+
+	//there's one code per projected point (and at most one per point of the cloud)
+	const unsigned cloudSize = m_theAssociatedCloud ? m_theAssociatedCloud->size() : 0;
+	if (codeCount != projectedPointCount || codeCount > cloudSize)
+	{
+		return false;
+	}
+
+	double bbs[12];
+	if (in.read((char*)bbs, sizeof(double) * 12) < 0)
+		return false;
+
+	int fillIndexes[(MAX_OCTREE_LEVEL + 1) * 6];
+	if (in.read((char*)fillIndexes, sizeof(fillIndexes)) < 0)
+		return false;
+
+	//the fill indexes are cell positions
+	for (int level = 0; level <= MAX_OCTREE_LEVEL; ++level)
+	{
+		for (int i = 0; i < 6; ++i)
+		{
+			int pos = fillIndexes[level * 6 + i];
+			if (pos < 0 || pos >= (1 << level))
+			{
+				return false;
+			}
+		}
+	}
+
+	cellsContainer codes;
+	std::vector<char> buffer;
+	try
+	{
+		codes.resize(codeCount);
+		buffer.resize(static_cast<size_t>(std::min(codeCount, c_codeRecordsPerBlock)) * c_codeRecordSize);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+	for (uint32_t first = 0; first < codeCount; first += c_codeRecordsPerBlock)
+	{
+		uint32_t count = std::min(c_codeRecordsPerBlock, codeCount - first);
+		if (in.read(buffer.data(), static_cast<qint64>(count) * c_codeRecordSize) < 0)
+			return false;
+		const char* record = buffer.data();
+		for (uint32_t i = first; i < first + count; ++i)
+		{
+			IndexAndCode& ic = codes[i];
+			memcpy(&ic.theIndex, record, sizeof(unsigned));
+			memcpy(&ic.theCode, record + sizeof(unsigned), sizeof(CellCode));
+			record += c_codeRecordSize;
+
+			//the point indexes must be valid and the codes sorted (the octree relies on binary searches)
+			if (	ic.theIndex >= cloudSize
+				||	(ic.theCode >> (3 * MAX_OCTREE_LEVEL)) != 0
+				||	(i != 0 && ic.theCode < codes[i - 1].theCode))
+			{
+				return false;
+			}
+		}
+	}
+
+	//we can now replace the current structure
+	m_thePointsAndTheirCellCodes.swap(codes);
+	m_numberOfProjectedPoints = projectedPointCount;
+	for (unsigned d = 0; d < 3; ++d)
+	{
+		m_dimMin.u[d] = static_cast<PointCoordinateType>(bbs[d]);
+		m_dimMax.u[d] = static_cast<PointCoordinateType>(bbs[3 + d]);
+		m_pointsMin.u[d] = static_cast<PointCoordinateType>(bbs[6 + d]);
+		m_pointsMax.u[d] = static_cast<PointCoordinateType>(bbs[9 + d]);
+	}
+	for (int i = 0; i < (MAX_OCTREE_LEVEL + 1) * 6; ++i)
+	{
+		m_fillIndexes[i] = fillIndexes[i];
+	}
+
+	updateCellSizeTable();
+	updateCellCountTable();
+
+	m_glListIsDeprecated = true;
+
+	return true;
+}
+
 ccBBox ccOctree::getSquareBB() const
 {
 	return ccBBox(m_dimMin, m_dimMax);
@@ -33,6 +33,7 @@
 //system
 #include <vector>
 
+class QFile;
 class ccGenericPointCloud;
 class ccOctreeFrustumIntersector;
 class ccCameraSensor;
@@ -80,6 +81,18 @@ public: //GENERAL METHODS
 	//inherited from DgmOctree
 	virtual void clear() override;
 
+	//! Saves the octree structure (codes and bounding-boxes) to a file
+	bool toFile(QFile& out) const;
+
+	//! Loads the octree structure from a file
+	/** The associated cloud must be the same as when the octree was saved.
+		\return false if the file couldn't be read, if the octree was saved
+		with different settings (max level, code size), if the saved data is
+		not consistent with the cloud (point indexes out of range, unsorted
+		codes, etc.) or if there's not enough memory
+	**/
+	bool fromFile(QFile& in);
+
 public: //RENDERING
 	
 	//! Returns the currently displayed octree level
@@ -0,0 +1,689 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#include "ccOutOfCoreCloud.h"
+
+//Local
+#include "ccFrustum.h"
+#include "ccGenericGLDisplay.h"
+#include "ccIncludeGL.h"
+#include "ccLog.h"
+
+//Qt
+#include <QDataStream>
+#include <QFile>
+#include <QMutexLocker>
+
+//System
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+//! File signature
+static const char s_magic[8] = { 'C', 'C', '_', 'O', 'O', 'C', 'L', 'D' };
+//! Current file format version
+static const quint32 s_currentVersion = 1;
+
+static_assert(sizeof(ccOutOfCoreCloud::FilePoint) == 16, "Points are stored as 16 bytes records");
+
+//! Default max number of points displayed at once
+static const unsigned s_defaultPointBudget = 10000000;
+//! Default max amount of memory used to cache the nodes (1 Gb)
+static const size_t s_defaultCacheSize = (static_cast<size_t>(1) << 30);
+//! Max number of points drawn during a single LOD render pass
+static const unsigned s_maxPointCountPerLODPass = (1 << 20);
+//! Nodes are refined until the projected spacing between their points is below this value (in pixels)
+static const double s_maxProjectedSpacing = 1.0;
+
+static void InitDataStream(QDataStream& stream)
+{
+	stream.setByteOrder(QDataStream::LittleEndian);
+	stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+}
+
+ccOutOfCoreCloud::Header::Header()
+	: version(s_currentVersion)
+	, flags(0)
+	, pointCount(0)
+	, nodeCount(0)
+	, maxLevel(0)
+	, gridResolution(0)
+	, hierarchyOffset(0)
+	, bbMin(0, 0, 0)
+	, bbMax(0, 0, 0)
+	, cubeOrigin(0, 0, 0)
+	, cubeSize(0)
+	, globalShift(0, 0, 0)
+	, globalScale(1.0)
+{
+}
+
+bool ccOutOfCoreCloud::Header::toFile(QIODevice& out) const
+{
+	QDataStream stream(&out);
+	InitDataStream(stream);
+
+	stream.writeRawData(s_magic, sizeof(s_magic));
+	stream << version << flags << pointCount << nodeCount << maxLevel << gridResolution << hierarchyOffset;
+	stream << bbMin.x << bbMin.y << bbMin.z;
+	stream << bbMax.x << bbMax.y << bbMax.z;
+	stream << cubeOrigin.x << cubeOrigin.y << cubeOrigin.z << cubeSize;
+	stream << globalShift.x << globalShift.y << globalShift.z << globalScale;
+
+	return (stream.status() == QDataStream::Ok);
+}
+
+bool ccOutOfCoreCloud::Header::fromFile(QIODevice& in)
+{
+	QDataStream stream(&in);
+	InitDataStream(stream);
+
+	char magic[sizeof(s_magic)];
+	if (stream.readRawData(magic, sizeof(magic)) != sizeof(magic) || memcmp(magic, s_magic, sizeof(magic)) != 0)
+	{
+		//not an out-of-core cloud file
+		return false;
+	}
+
+	stream >> version;
+	if (version > s_currentVersion)
+	{
+		ccLog::Warning(QString("[Out-of-core] Unhandled file version (%1)").arg(version));
+		return false;
+	}
+
+	stream >> flags >> pointCount >> nodeCount >> maxLevel >> gridResolution >> hierarchyOffset;
+	stream >> bbMin.x >> bbMin.y >> bbMin.z;
+	stream >> bbMax.x >> bbMax.y >> bbMax.z;
+	stream >> cubeOrigin.x >> cubeOrigin.y >> cubeOrigin.z >> cubeSize;
+	stream >> globalShift.x >> globalShift.y >> globalShift.z >> globalScale;
+
+	return (stream.status() == QDataStream::Ok);
+}
+
+ccOutOfCoreCloud::FileNode::FileNode()
+	: dataOffset(0)
+	, code(0)
+	, pointCount(0)
+	, level(0)
+{
+	std::fill(children, children + 8, -1);
+}
+
+bool ccOutOfCoreCloud::FileNode::toFile(QIODevice& out) const
+{
+	QDataStream stream(&out);
+	InitDataStream(stream);
+
+	stream << dataOffset << code << pointCount;
+	for (unsigned i = 0; i < 8; ++i)
+	{
+		stream << children[i];
+	}
+	stream << level;
+
+	return (stream.status() == QDataStream::Ok);
+}
+
+bool ccOutOfCoreCloud::FileNode::fromFile(QIODevice& in)
+{
+	QDataStream stream(&in);
+	InitDataStream(stream);
+
+	stream >> dataOffset >> code >> pointCount;
+	for (unsigned i = 0; i < 8; ++i)
+	{
+		stream >> children[i];
+	}
+	stream >> level;
+
+	return (stream.status() == QDataStream::Ok);
+}
+
+ccOutOfCoreCloud::ccOutOfCoreCloud(QString name/*=QString()*/)
+	: ccShiftedObject(name)
+	, m_rootIndex(-1)
+	, m_selectionIndex(0)
+	, m_cacheMemory(0)
+	, m_pointBudget(s_defaultPointBudget)
+	, m_cacheSize(s_defaultCacheSize)
+	, m_loader(0)
+	, m_redrawWhenLoaded(false)
+{
+	showColors(true);
+}
+
+ccOutOfCoreCloud::~ccOutOfCoreCloud()
+{
+	//waits for the node being loaded (if any)
+	delete m_loader;
+	m_loader = 0;
+}
+
+bool ccOutOfCoreCloud::open(const QString& filename)
+{
+	QFile file(filename);
+	if (!file.open(QFile::ReadOnly))
+	{
+		return false;
+	}
+
+	Header header;
+	if (	!header.fromFile(file)
+		||	header.nodeCount == 0
+		||	header.cubeSize <= 0
+		||	header.maxLevel > MAX_CODE_LEVEL
+		||	!file.seek(header.hierarchyOffset))
+	{
+		return false;
+	}
+
+	std::vector<Node> nodes;
+	try
+	{
+		nodes.resize(header.nodeCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	for (Node& node : nodes)
+	{
+		FileNode fileNode;
+		if (!fileNode.fromFile(file) || fileNode.level > header.maxLevel)
+		{
+			return false;
+		}
+
+		node.dataOffset = fileNode.dataOffset;
+		node.pointCount = fileNode.pointCount;
+		node.level = fileNode.level;
+		for (unsigned i = 0; i < 8; ++i)
+		{
+			if (fileNode.children[i] >= static_cast<qint32>(header.nodeCount))
+			{
+				//corrupted file
+				return false;
+			}
+			node.children[i] = fileNode.children[i];
+		}
+
+		//cell position (from its code)
+		unsigned cellPos[3] = { 0, 0, 0 };
+		for (unsigned l = 0; l < fileNode.level; ++l)
+		{
+			unsigned childIndex = static_cast<unsigned>(fileNode.code >> (3 * (fileNode.level - 1 - l))) & 7;
+			for (unsigned d = 0; d < 3; ++d)
+			{
+				cellPos[d] = (cellPos[d] << 1) | ((childIndex >> d) & 1);
+			}
+		}
+		double cellSize = header.cubeSize / (1 << fileNode.level);
+		CCVector3d center = header.cubeOrigin + CCVector3d(cellPos[0] + 0.5, cellPos[1] + 0.5, cellPos[2] + 0.5) * cellSize;
+		node.center = CCVector3f(static_cast<float>(center.x), static_cast<float>(center.y), static_cast<float>(center.z));
+		node.radius = static_cast<float>(cellSize * sqrt(3.0) / 2);
+		node.spacing = static_cast<float>(cellSize / std::max<quint32>(1, header.gridResolution));
+	}
+
+	//release the previous file (if any)
+	delete m_loader;
+	m_loader = 0;
+	m_cache.clear();
+	m_cacheMemory = 0;
+	m_selection.clear();
+
+	m_filename = filename;
+	m_header = header;
+	m_nodes.swap(nodes);
+	m_rootIndex = static_cast<int32_t>(m_nodes.size()) - 1;
+	m_failed.assign(m_nodes.size(), false);
+
+	setGlobalShift(header.globalShift);
+	setGlobalScale(header.globalScale);
+
+	//the loader will be created by the main thread (see updateSelection)
+	return true;
+}
+
+ccBBox ccOutOfCoreCloud::getOwnBB(bool withGLFeatures/*=false*/)
+{
+	if (m_nodes.empty())
+	{
+		return ccBBox();
+	}
+
+	return ccBBox(	CCVector3::fromArray(m_header.bbMin.u),
+					CCVector3::fromArray(m_header.bbMax.u));
+}
+
+void ccOutOfCoreCloud::onNodesLoaded()
+{
+	if (!m_redrawWhenLoaded)
+	{
+		//the nodes will be fetched during the next redraw (or LOD render pass)
+		return;
+	}
+
+	ccGenericGLDisplay* display = getDisplay();
+	if (display)
+	{
+		m_redrawWhenLoaded = false;
+		display->redraw(false, false);
+	}
+}
+
+void ccOutOfCoreCloud::fetchLoadedNodes()
+{
+	if (!m_loader)
+	{
+		return;
+	}
+
+	std::vector<ccOutOfCoreLoader::Result> results;
+	m_loader->takeResults(results);
+
+	for (ccOutOfCoreLoader::Result& result : results)
+	{
+		assert(result.nodeIndex >= 0 && result.nodeIndex < static_cast<int32_t>(m_nodes.size()));
+		if (!result.success)
+		{
+			ccLog::Warning(QString("[Out-of-core] Failed to load node #%1 of '%2'").arg(result.nodeIndex).arg(m_filename));
+			m_failed[result.nodeIndex] = true;
+			continue;
+		}
+
+		if (m_cache.find(result.nodeIndex) != m_cache.end())
+		{
+			//already loaded
+			continue;
+		}
+
+		CachedNode& cached = m_cache[result.nodeIndex];
+		cached.points.swap(result.points);
+		cached.lastUsed = m_selectionIndex;
+		m_cacheMemory += cached.points.capacity() * sizeof(FilePoint);
+	}
+}
+
+void ccOutOfCoreCloud::trimCache()
+{
+	if (m_cacheMemory <= m_cacheSize)
+	{
+		return;
+	}
+
+	//the nodes of the current selection can't be removed
+	std::vector< std::pair<unsigned, int32_t> > candidates;
+	for (const auto& it : m_cache)
+	{
+		if (it.second.lastUsed != m_selectionIndex)
+		{
+			candidates.push_back(std::make_pair(it.second.lastUsed, it.first));
+		}
+	}
+	std::sort(candidates.begin(), candidates.end());
+
+	for (const auto& candidate : candidates)
+	{
+		if (m_cacheMemory <= m_cacheSize)
+		{
+			break;
+		}
+
+		auto it = m_cache.find(candidate.second);
+		assert(it != m_cache.end());
+		m_cacheMemory -= it->second.points.capacity() * sizeof(FilePoint);
+		m_cache.erase(it);
+	}
+}
+
+void ccOutOfCoreCloud::updateSelection(const ccGLCameraParameters& camera)
+{
+	m_selection.clear();
+	++m_selectionIndex;
+
+	if (m_rootIndex < 0)
+	{
+		return;
+	}
+
+	Frustum frustum(camera.modelViewMat, camera.projectionMat);
+	CCVector3d cameraCenter = camera.modelViewMat.inverse().getTranslationAsVec3D();
+
+	//size of a pixel at a distance of 1 (perspective) or everywhere (orthographic)
+	double projScale = camera.projectionMat.data()[5] * std::max(1, camera.viewport[3]);
+	double unitPixelSize = (projScale > 0 ? 2.0 / projScale : 1.0);
+
+	//size of a pixel at the position of a node
+	auto pixelSizeAt = [&](const Node& node) -> double
+	{
+		if (!camera.perspective)
+		{
+			return unitPixelSize;
+		}
+		CCVector3d C(node.center.x, node.center.y, node.center.z);
+		double dist = (C - cameraCenter).norm() - node.radius;
+		return (dist > 0 ? unitPixelSize * dist : 0);
+	};
+
+	//the nodes with the largest size on screen come first
+	typedef std::pair<double, int32_t> Candidate;
+	std::priority_queue<Candidate> candidates;
+	if (frustum.sphereInFrustum(m_nodes[m_rootIndex].center, m_nodes[m_rootIndex].radius) != Frustum::OUTSIDE)
+	{
+		candidates.push(Candidate(std::numeric_limits<double>::max(), m_rootIndex));
+	}
+
+	uint64_t selectedPointCount = 0;
+	while (!candidates.empty())
+	{
+		int32_t nodeIndex = candidates.top().second;
+		candidates.pop();
+
+		const Node& node = m_nodes[nodeIndex];
+		if (!m_selection.empty() && selectedPointCount + node.pointCount > m_pointBudget)
+		{
+			//budget exhausted
+			break;
+		}
+		m_selection.push_back(nodeIndex);
+		selectedPointCount += node.pointCount;
+
+		//do we need more points in this cell?
+		double pixelSize = pixelSizeAt(node);
+		if (pixelSize > 0 && node.spacing < s_maxProjectedSpacing * pixelSize)
+		{
+			continue;
+		}
+
+		for (unsigned i = 0; i < 8; ++i)
+		{
+			int32_t childIndex = node.children[i];
+			if (childIndex < 0)
+				continue;
+
+			const Node& child = m_nodes[childIndex];
+			if (frustum.sphereInFrustum(child.center, child.radius) == Frustum::OUTSIDE)
+				continue;
+
+			double childPixelSize = pixelSizeAt(child);
+			double priority = (childPixelSize > 0 ? child.radius / childPixelSize : std::numeric_limits<double>::max());
+			candidates.push(Candidate(priority, childIndex));
+		}
+	}
+
+	//flag the selected nodes (so that they stay in the cache) and request the missing ones
+	std::vector<ccOutOfCoreLoader::Request> requests;
+	for (int32_t nodeIndex : m_selection)
+	{
+		auto it = m_cache.find(nodeIndex);
+		if (it != m_cache.end())
+		{
+			it->second.lastUsed = m_selectionIndex;
+		}
+		else if (!m_failed[nodeIndex])
+		{
+			const Node& node = m_nodes[nodeIndex];
+			ccOutOfCoreLoader::Request request = { nodeIndex, node.dataOffset, node.pointCount };
+			requests.push_back(request);
+		}
+	}
+
+	if (!m_loader && !requests.empty())
+	{
+		//the file may have been opened by another thread: the loader must live in the main (display) thread
+		m_loader = new ccOutOfCoreLoader(m_filename);
+		QObject::connect(m_loader, &ccOutOfCoreLoader::nodesLoaded, m_loader, [this]() { onNodesLoaded(); }, Qt::QueuedConnection);
+	}
+	if (m_loader)
+	{
+		m_loader->setRequests(requests);
+	}
+}
+
+void ccOutOfCoreCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
+{
+	if (m_nodes.empty() || !MACRO_Draw3D(context))
+		return;
+
+	//points can't be picked
+	if (MACRO_DrawEntityNames(context))
+		return;
+
+	//get the set of OpenGL functions (version 2.1)
+	QOpenGLFunctions_2_1* glFunc = context.glFunctions<QOpenGLFunctions_2_1>();
+	assert(glFunc != nullptr);
+
+	if (glFunc == nullptr)
+		return;
+
+	fetchLoadedNodes();
+
+	//during a LOD cycle, the nodes are drawn level by level (and only once)
+	bool lodCycle = (MACRO_LODActivated(context) && context.decimateCloudOnMove);
+
+	if (!lodCycle || context.currentLODLevel == 0)
+	{
+		//get the current viewport and OpenGL matrices
+		ccGLCameraParameters camera;
+		context.display->getGLCameraParameters(camera);
+		//replace the viewport and matrices by the real ones
+		glFunc->glGetIntegerv(GL_VIEWPORT, camera.viewport);
+		glFunc->glGetDoublev(GL_PROJECTION_MATRIX, camera.projectionMat.data());
+		glFunc->glGetDoublev(GL_MODELVIEW_MATRIX, camera.modelViewMat.data());
+
+		updateSelection(camera);
+		trimCache();
+
+		for (auto& it : m_cache)
+		{
+			it.second.drawn = false;
+		}
+	}
+
+	bool showColors = hasColors() && colorsShown();
+
+	glFunc->glEnableClientState(GL_VERTEX_ARRAY);
+	if (showColors)
+	{
+		glFunc->glEnableClientState(GL_COLOR_ARRAY);
+	}
+
+	unsigned drawnPointCount = 0;
+	bool missingNodes = false;
+	bool deeperNodes = false;
+	bool passIsFull = false;
+	for (int32_t nodeIndex : m_selection)
+	{
+		const Node& node = m_nodes[nodeIndex];
+		if (lodCycle && node.level > context.currentLODLevel)
+		{
+			deeperNodes = true;
+			continue;
+		}
+
+		auto it = m_cache.find(nodeIndex);
+		if (it == m_cache.end())
+		{
+			//not loaded yet
+			missingNodes |= !m_failed[nodeIndex];
+			continue;
+		}
+
+		CachedNode& cached = it->second;
+		if (cached.points.empty())
+		{
+			continue;
+		}
+
+		if (lodCycle)
+		{
+			if (cached.drawn)
+			{
+				continue;
+			}
+			if (drawnPointCount != 0 && drawnPointCount + cached.points.size() > s_maxPointCountPerLODPass)
+			{
+				passIsFull = true;
+				continue;
+			}
+			cached.drawn = true;
+		}
+
+		glFunc->glVertexPointer(3, GL_FLOAT, sizeof(FilePoint), &(cached.points[0].x));
+		if (showColors)
+		{
+			glFunc->glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(FilePoint), cached.points[0].rgba);
+		}
+		glFunc->glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(cached.points.size()));
+		drawnPointCount += static_cast<unsigned>(cached.points.size());
+	}
+
+	glFunc->glDisableClientState(GL_VERTEX_ARRAY);
+	if (showColors)
+	{
+		glFunc->glDisableClientState(GL_COLOR_ARRAY);
+	}
+
+	if (lodCycle)
+	{
+		//the LOD cycle will come back for the nodes being loaded and the deeper ones
+		context.moreLODPointsAvailable |= (passIsFull || missingNodes);
+		context.higherLODLevelsAvailable |= deeperNodes;
+		m_redrawWhenLoaded = false;
+	}
+	else
+	{
+		m_redrawWhenLoaded = missingNodes;
+	}
+}
+
+ccOutOfCoreLoader::ccOutOfCoreLoader(const QString& filename)
+	: QThread()
+	, m_filename(filename)
+	, m_currentNode(-1)
+	, m_stop(false)
+{
+}
+
+ccOutOfCoreLoader::~ccOutOfCoreLoader()
+{
+	{
+		QMutexLocker locker(&m_mutex);
+		m_stop = true;
+		m_requests.clear();
+		m_wakeUp.wakeAll();
+	}
+	wait();
+}
+
+void ccOutOfCoreLoader::setRequests(const std::vector<Request>& requests)
+{
+	{
+		QMutexLocker locker(&m_mutex);
+		m_requests.clear();
+		for (const Request& request : requests)
+		{
+			//the node being loaded will be sent anyway
+			if (request.nodeIndex != m_currentNode)
+			{
+				m_requests.push_back(request);
+			}
+		}
+		if (!m_requests.empty())
+		{
+			m_wakeUp.wakeAll();
+		}
+	}
+
+	if (!requests.empty() && !isRunning())
+	{
+		start();
+	}
+}
+
+void ccOutOfCoreLoader::takeResults(std::vector<Result>& results)
+{
+	QMutexLocker locker(&m_mutex);
+	results.swap(m_results);
+	m_results.clear();
+}
+
+void ccOutOfCoreLoader::run()
+{
+	//the thread has its own file handle
+	QFile file(m_filename);
+	bool fileIsOpen = file.open(QFile::ReadOnly);
+
+	while (true)
+	{
+		Request request;
+		{
+			QMutexLocker locker(&m_mutex);
+			while (!m_stop && m_requests.empty())
+			{
+				m_wakeUp.wait(&m_mutex);
+			}
+			if (m_stop)
+			{
+				break;
+			}
+			request = m_requests.front();
+			m_requests.pop_front();
+			m_currentNode = request.nodeIndex;
+		}
+
+		Result result;
+		result.nodeIndex = request.nodeIndex;
+		result.success = false;
+		if (fileIsOpen && file.seek(static_cast<qint64>(request.dataOffset)))
+		{
+			try
+			{
+				result.points.resize(request.pointCount);
+				qint64 byteCount = static_cast<qint64>(request.pointCount) * sizeof(ccOutOfCoreCloud::FilePoint);
+				result.success = (file.read(reinterpret_cast<char*>(result.points.data()), byteCount) == byteCount);
+			}
+			catch (const std::bad_alloc&)
+			{
+				//not enough memory
+			}
+		}
+		if (!result.success)
+		{
+			std::vector<ccOutOfCoreCloud::FilePoint>().swap(result.points);
+		}
+
+		bool notify = false;
+		{
+			QMutexLocker locker(&m_mutex);
+			m_currentNode = -1;
+			notify = m_results.empty();
+			m_results.push_back(std::move(result));
+		}
+
+		if (notify)
+		{
+			emit nodesLoaded();
+		}
+	}
+}
@@ -0,0 +1,316 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_OUT_OF_CORE_CLOUD_HEADER
+#define CC_OUT_OF_CORE_CLOUD_HEADER
+
+//Local
+#include "ccShiftedObject.h"
+
+//Qt
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+//System
+#include <stdint.h>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+class QIODevice;
+class ccOutOfCoreLoader;
+struct ccGLCameraParameters;
+
+//! Out-of-core point cloud
+/** The points are stored in a (Potree-like) hierarchical file: each node of
+	an octree holds a subset of the points of its cell (coarse points in the
+	upper levels, the remaining ones in the deeper levels) as a contiguous
+	block. Only the hierarchy is kept in memory. The nodes are loaded on demand
+	by a background thread, depending on their size on screen, and are kept
+	in a LRU cache of limited size.
+
+	Such files are created by the 'ooc' stream writer (see OocFilter).
+**/
+class QCC_DB_LIB_API ccOutOfCoreCloud : public ccShiftedObject
+{
+public: //file format
+
+	//! Point record (points are stored in the local - shifted - coordinate system)
+	struct FilePoint
+	{
+		float x, y, z;
+		uint8_t rgba[4];
+	};
+
+	//! Header flags
+	enum HeaderFlags
+	{
+		HAS_COLORS = 1,
+	};
+
+	//! File header
+	/** The points of each node are stored right after the header (as contiguous
+		blocks of FilePoint records). The node table is stored at the end of the
+		file (see hierarchyOffset).
+	**/
+	struct Header
+	{
+		//! Default constructor
+		Header();
+
+		//! Writes the header (always the same size)
+		bool toFile(QIODevice& out) const;
+		//! Reads the header
+		bool fromFile(QIODevice& in);
+
+		//! Format version
+		quint32 version;
+		//! Flags (see HeaderFlags)
+		quint32 flags;
+		//! Total number of points
+		quint64 pointCount;
+		//! Number of nodes
+		quint32 nodeCount;
+		//! Deepest level (its nodes contain all the remaining points)
+		quint32 maxLevel;
+		//! Resolution of the grid used to select the points of a node (per dimension)
+		quint32 gridResolution;
+		//! Position of the node table in the file
+		quint64 hierarchyOffset;
+		//! Bounding-box (local coordinates)
+		CCVector3d bbMin, bbMax;
+		//! Root cell origin (local coordinates)
+		CCVector3d cubeOrigin;
+		//! Root cell size
+		double cubeSize;
+		//! Global shift
+		CCVector3d globalShift;
+		//! Global scale
+		double globalScale;
+	};
+
+	//! Node record
+	/** Nodes are stored in post-order (the root is the last one).
+	**/
+	struct FileNode
+	{
+		//! Default constructor
+		FileNode();
+
+		//! Writes the node
+		bool toFile(QIODevice& out) const;
+		//! Reads the node
+		bool fromFile(QIODevice& in);
+
+		//! Position of the first point in the file
+		quint64 dataOffset;
+		//! Cell code (3 bits per level - the root code is 0)
+		quint64 code;
+		//! Number of points
+		quint32 pointCount;
+		//! Child nodes indexes (-1 if none)
+		qint32 children[8];
+		//! Level
+		quint8 level;
+	};
+
+	//! Max octree level of the cell codes
+	static const unsigned MAX_CODE_LEVEL = 21;
+
+public:
+
+	//! Default constructor
+	ccOutOfCoreCloud(QString name = QString());
+
+	//! Destructor
+	virtual ~ccOutOfCoreCloud();
+
+	//! Opens a file
+	/** Only the header and the node hierarchy are loaded.
+	**/
+	bool open(const QString& filename);
+
+	//! Returns the associated file
+	const QString& getFilename() const { return m_filename; }
+
+	//! Returns the total number of points
+	quint64 pointCount() const { return m_header.pointCount; }
+
+	//! Sets the max number of points displayed at once
+	void setPointBudget(unsigned count) { m_pointBudget = count; }
+	//! Returns the max number of points displayed at once
+	unsigned getPointBudget() const { return m_pointBudget; }
+
+	//! Sets the max amount of memory used to cache the nodes (in bytes)
+	void setCacheSize(size_t bytes) { m_cacheSize = bytes; }
+	//! Returns the max amount of memory used to cache the nodes (in bytes)
+	size_t getCacheSize() const { return m_cacheSize; }
+
+	//! Returns the amount of memory currently used to cache the nodes (in bytes)
+	size_t cacheMemory() const { return m_cacheMemory; }
+
+	//inherited from ccHObject
+	virtual CC_CLASS_ENUM getClassID() const override { return CC_TYPES::OUT_OF_CORE_CLOUD; }
+	virtual ccBBox getOwnBB(bool withGLFeatures = false) override;
+
+	//inherited from ccDrawableObject
+	virtual bool hasColors() const override { return (m_header.flags & HAS_COLORS) != 0; }
+
+protected:
+
+	//inherited from ccHObject
+	virtual void drawMeOnly(CC_DRAW_CONTEXT& context) override;
+
+	//! Called (in the main thread) when nodes have been loaded
+	void onNodesLoaded();
+
+	//! Selects the nodes to display (by decreasing size on screen)
+	void updateSelection(const ccGLCameraParameters& camera);
+
+	//! Moves the loaded nodes to the cache
+	void fetchLoadedNodes();
+
+	//! Removes the least recently used nodes from the cache (if necessary)
+	void trimCache();
+
+	//! In-memory node
+	struct Node
+	{
+		//! Position of the first point in the file
+		uint64_t dataOffset;
+		//! Cell center
+		CCVector3f center;
+		//! Cell (half-diagonal) radius
+		float radius;
+		//! Approximate spacing between the points
+		float spacing;
+		//! Child nodes indexes (-1 if none)
+		int32_t children[8];
+		//! Number of points
+		uint32_t pointCount;
+		//! Level
+		uint8_t level;
+	};
+
+	//! Cached node
+	struct CachedNode
+	{
+		CachedNode() : lastUsed(0), drawn(false) {}
+
+		//! Points
+		std::vector<FilePoint> points;
+		//! Index of the last selection in which the node was used
+		unsigned lastUsed;
+		//! Whether the node has already been drawn during the current LOD cycle
+		bool drawn;
+	};
+
+	//! File
+	QString m_filename;
+	//! File header
+	Header m_header;
+	//! Nodes
+	std::vector<Node> m_nodes;
+	//! Root node index
+	int32_t m_rootIndex;
+
+	//! Selected nodes (by decreasing priority)
+	std::vector<int32_t> m_selection;
+	//! Selection index (incremented each time the selection is updated)
+	unsigned m_selectionIndex;
+
+	//! Cached nodes
+	std::unordered_map<int32_t, CachedNode> m_cache;
+	//! Nodes that couldn't be loaded
+	std::vector<bool> m_failed;
+	//! Memory used by the cached nodes (in bytes)
+	size_t m_cacheMemory;
+
+	//! Max number of points displayed at once
+	unsigned m_pointBudget;
+	//! Max amount of memory used to cache the nodes (in bytes)
+	size_t m_cacheSize;
+
+	//! Background loader
+	ccOutOfCoreLoader* m_loader;
+	//! Whether the display should be refreshed once nodes are loaded
+	bool m_redrawWhenLoaded;
+};
+
+//! Loads the nodes of an out-of-core cloud in a background thread
+class ccOutOfCoreLoader : public QThread
+{
+	Q_OBJECT
+
+public:
+
+	//! Load request
+	struct Request
+	{
+		int32_t nodeIndex;
+		uint64_t dataOffset;
+		uint32_t pointCount;
+	};
+
+	//! Loaded node
+	struct Result
+	{
+		int32_t nodeIndex;
+		bool success;
+		std::vector<ccOutOfCoreCloud::FilePoint> points;
+	};
+
+	//! Default constructor
+	explicit ccOutOfCoreLoader(const QString& filename);
+
+	//! Destructor (waits for the current node to be loaded)
+	virtual ~ccOutOfCoreLoader();
+
+	//! Replaces the pending requests (by decreasing priority)
+	void setRequests(const std::vector<Request>& requests);
+
+	//! Returns the loaded nodes (since the last call)
+	void takeResults(std::vector<Result>& results);
+
+signals:
+
+	//! Emitted when nodes have been loaded (and were not taken yet)
+	void nodesLoaded();
+
+protected:
+
+	//inherited from QThread
+	virtual void run() override;
+
+	//! File
+	QString m_filename;
+	//! Mutex
+	QMutex m_mutex;
+	//! To wake up the thread
+	QWaitCondition m_wakeUp;
+	//! Pending requests
+	std::deque<Request> m_requests;
+	//! Node being loaded (or -1)
+	int32_t m_currentNode;
+	//! Loaded nodes
+	std::vector<Result> m_results;
+	//! Whether the thread should stop
+	bool m_stop;
+};
+
+#endif //CC_OUT_OF_CORE_CLOUD_HEADER
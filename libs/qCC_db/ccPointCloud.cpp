@@ -37,6 +37,7 @@
 #include "cc2DLabel.h"
 #include "ccMaterial.h"
 #include "ccColorRampShader.h"
+#include "ccNormalDecodeShader.h"
 #include "ccPolyline.h"
 #include "ccScalarField.h"
 #include "ccGenericGLDisplay.h"
@@ -51,6 +52,7 @@
 #include <QElapsedTimer>
 #include <QSharedPointer>
 #include <QCoreApplication>
+#include <QThread>
 
 //system
 #include <assert.h>
@@ -175,6 +177,9 @@ void UpdateGridIndexes(const std::vector<int>& newIndexMap, std::vector<ccPointC
 	}
 }
 
+//! Number of elements per block for the partial clone gathers
+static const unsigned c_gatherBlockSize = 4096;
+
 ccPointCloud* ccPointCloud::partialClone(const CCLib::ReferenceCloud* selection, int* warnings/*=0*/) const
 {
 	if (warnings)
@@ -195,23 +200,57 @@ ccPointCloud* ccPointCloud::partialClone(const CCLib::ReferenceCloud* selection,
 		return 0;
 	}
 
-	ccPointCloud* result = new ccPointCloud(getName() + QString(".extract"));
+	//the columns are copied by blocks of consecutive elements
+	const int blockCount = static_cast<int>((n + c_gatherBlockSize - 1) / c_gatherBlockSize);
 
-	if (!result->reserveThePointsTable(n))
+	//we retrieve the global indexes once and for all
+	std::vector<unsigned> globalIndexes;
+	try
+	{
+		globalIndexes.resize(n);
+	}
+	catch (const std::bad_alloc&)
 	{
 		ccLog::Error("[ccPointCloud::partialClone] Not enough memory to duplicate cloud!");
-		delete result;
 		return 0;
 	}
 
-	//import points
+#if defined(_OPENMP)
+	#pragma omp parallel for
+#endif
+	for (int b = 0; b < blockCount; ++b)
 	{
-		for (unsigned i = 0; i < n; i++)
+		unsigned blockStart = static_cast<unsigned>(b) * c_gatherBlockSize;
+		unsigned blockStop = std::min(n, blockStart + c_gatherBlockSize);
+		for (unsigned i = blockStart; i < blockStop; ++i)
 		{
-			result->addPoint(*getPointPersistentPtr(selection->getPointGlobalIndex(i)));
+			globalIndexes[i] = selection->getPointGlobalIndex(i);
 		}
 	}
 
+	ccPointCloud* result = new ccPointCloud(getName() + QString(".extract"));
+
+	if (!result->reserveThePointsTable(n) || !result->resize(n))
+	{
+		ccLog::Error("[ccPointCloud::partialClone] Not enough memory to duplicate cloud!");
+		delete result;
+		return 0;
+	}
+
+	//columns to copy (all the destination arrays are allocated first, then they are filled concurrently)
+	enum ColumnType { POINTS_COLUMN, COLORS_COLUMN, NORMALS_COLUMN, FWF_COLUMN, SF_COLUMN };
+	struct Column
+	{
+		Column(ColumnType t, const ccScalarField* s = 0, ccScalarField* d = 0) : type(t), sourceSF(s), destSF(d) {}
+
+		ColumnType type;
+		const ccScalarField* sourceSF;
+		ccScalarField* destSF;
+	};
+	std::vector<Column> columns;
+	columns.reserve(4 + getNumberOfScalarFields());
+	columns.push_back(Column(POINTS_COLUMN));
+
 	//visibility
 	result->setVisible(isVisible());
 	result->setDisplay(getDisplay());
@@ -220,16 +259,14 @@ ccPointCloud* ccPointCloud::partialClone(const CCLib::ReferenceCloud* selection,
 	//RGB colors
 	if (hasColors())
 	{
-		if (result->reserveTheRGBTable())
+		if (result->reserveTheRGBTable() && result->rgbColors()->resize(n))
 		{
-			for (unsigned i = 0; i < n; i++)
-			{
-				result->addRGBColor(getPointColor(selection->getPointGlobalIndex(i)));
-			}
+			columns.push_back(Column(COLORS_COLUMN));
 			result->showColors(colorsShown());
 		}
 		else
 		{
+			result->unallocateColors();
 			ccLog::Warning("[ccPointCloud::partialClone] Not enough memory to copy RGB colors!");
 			if (warnings)
 				*warnings |= WRN_OUT_OF_MEM_FOR_COLORS;
@@ -239,16 +276,14 @@ ccPointCloud* ccPointCloud::partialClone(const CCLib::ReferenceCloud* selection,
 	//normals
 	if (hasNormals())
 	{
-		if (result->reserveTheNormsTable())
+		if (result->reserveTheNormsTable() && result->normals()->resize(n))
 		{
-			for (unsigned i = 0; i < n; i++)
-			{
-				result->addNormIndex(getPointNormalIndex(selection->getPointGlobalIndex(i)));
-			}
+			columns.push_back(Column(NORMALS_COLUMN));
 			result->showNormals(normalsShown());
 		}
 		else
 		{
+			result->unallocateNorms();
 			ccLog::Warning("[ccPointCloud::partialClone] Not enough memory to copy normals!");
 			if (warnings)
 				*warnings |= WRN_OUT_OF_MEM_FOR_NORMALS;
@@ -258,34 +293,27 @@ ccPointCloud* ccPointCloud::partialClone(const CCLib::ReferenceCloud* selection,
 	//waveform
 	if (hasFWF())
 	{
+		bool success = false;
 		if (result->reserveTheFWFTable())
 		{
 			try
 			{
-				for (unsigned i = 0; i < n; i++)
-				{
-					const ccWaveform& w = m_fwfWaveforms[selection->getPointGlobalIndex(i)];
-					if (!result->fwfDescriptors().contains(w.descriptorID()))
-					{
-						//copy only the necessary descriptors
-						result->fwfDescriptors().insert(w.descriptorID(), m_fwfDescriptors[w.descriptorID()]);
-					}
-					result->waveforms().push_back(w);
-				}
-				//we will use the same FWF data container
-				result->fwfData() = fwfData();
+				result->waveforms().resize(n);
+				success = true;
 			}
 			catch (const std::bad_alloc&)
 			{
-				ccLog::Warning("[ccPointCloud::partialClone] Not enough memory to copy waveform signals!");
-				result->clearFWFData();
-				if (warnings)
-					*warnings |= WRN_OUT_OF_MEM_FOR_FWF;
 			}
 		}
+
+		if (success)
+		{
+			columns.push_back(Column(FWF_COLUMN));
+		}
 		else
 		{
 			ccLog::Warning("[ccPointCloud::partialClone] Not enough memory to copy waveform signals!");
+			result->clearFWFData();
 			if (warnings)
 				*warnings |= WRN_OUT_OF_MEM_FOR_FWF;
 		}
@@ -293,44 +321,99 @@ ccPointCloud* ccPointCloud::partialClone(const CCLib::ReferenceCloud* selection,
 
 	//scalar fields
 	unsigned sfCount = getNumberOfScalarFields();
-	if (sfCount != 0)
+	for (unsigned k = 0; k < sfCount; ++k)
 	{
-		for (unsigned k = 0; k < sfCount; ++k)
+		const ccScalarField* sf = static_cast<ccScalarField*>(getScalarField(k));
+		assert(sf);
+		if (sf)
 		{
-			const ccScalarField* sf = static_cast<ccScalarField*>(getScalarField(k));
-			assert(sf);
-			if (sf)
+			//we create a new scalar field with same name
+			int sfIdx = result->addScalarField(sf->getName());
+			if (sfIdx >= 0) //success
 			{
-				//we create a new scalar field with same name
-				int sfIdx = result->addScalarField(sf->getName());
-				if (sfIdx >= 0) //success
+				ccScalarField* currentScalarField = static_cast<ccScalarField*>(result->getScalarField(sfIdx));
+				assert(currentScalarField);
+				if (currentScalarField->resize(n))
 				{
-					ccScalarField* currentScalarField = static_cast<ccScalarField*>(result->getScalarField(sfIdx));
-					assert(currentScalarField);
-					if (currentScalarField->resize(n))
-					{
-						currentScalarField->setGlobalShift(sf->getGlobalShift());
-
-						//we copy data to new SF
-						for (unsigned i = 0; i < n; i++)
-							currentScalarField->setValue(i, sf->getValue(selection->getPointGlobalIndex(i)));
-
-						currentScalarField->computeMinAndMax();
-						//copy display parameters
-						currentScalarField->importParametersFrom(sf);
-					}
-					else
-					{
-						//if we don't have enough memory, we cancel SF creation
-						result->deleteScalarField(sfIdx);
-						ccLog::Warning(QString("[ccPointCloud::partialClone] Not enough memory to copy scalar field '%1'!").arg(sf->getName()));
-						if (warnings)
-							*warnings |= WRN_OUT_OF_MEM_FOR_SFS;
-					}
+					currentScalarField->setGlobalShift(sf->getGlobalShift());
+					columns.push_back(Column(SF_COLUMN, sf, currentScalarField));
+				}
+				else
+				{
+					//if we don't have enough memory, we cancel SF creation
+					result->deleteScalarField(sfIdx);
+					ccLog::Warning(QString("[ccPointCloud::partialClone] Not enough memory to copy scalar field '%1'!").arg(sf->getName()));
+					if (warnings)
+						*warnings |= WRN_OUT_OF_MEM_FOR_SFS;
 				}
 			}
 		}
+	}
+
+	//now we can copy the data (each block of each column is an independent task)
+	const int taskCount = static_cast<int>(columns.size()) * blockCount;
+#if defined(_OPENMP)
+	#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int t = 0; t < taskCount; ++t)
+	{
+		const Column& column = columns[t / blockCount];
+		unsigned blockStart = static_cast<unsigned>(t % blockCount) * c_gatherBlockSize;
+		unsigned blockStop = std::min(n, blockStart + c_gatherBlockSize);
+		const unsigned* _globalIndex = &(globalIndexes[blockStart]);
 
+		switch (column.type)
+		{
+		case POINTS_COLUMN:
+			for (unsigned i = blockStart; i < blockStop; ++i, ++_globalIndex)
+				*result->point(i) = *point(*_globalIndex);
+			break;
+		case COLORS_COLUMN:
+			for (unsigned i = blockStart; i < blockStop; ++i, ++_globalIndex)
+				result->m_rgbColors->setValue(i, m_rgbColors->getValue(*_globalIndex));
+			break;
+		case NORMALS_COLUMN:
+			for (unsigned i = blockStart; i < blockStop; ++i, ++_globalIndex)
+				result->m_normals->setValue(i, m_normals->getValue(*_globalIndex));
+			break;
+		case FWF_COLUMN:
+			for (unsigned i = blockStart; i < blockStop; ++i, ++_globalIndex)
+				result->m_fwfWaveforms[i] = m_fwfWaveforms[*_globalIndex];
+			break;
+		case SF_COLUMN:
+			for (unsigned i = blockStart; i < blockStop; ++i, ++_globalIndex)
+				column.destSF->setValue(i, column.sourceSF->getValue(*_globalIndex));
+			break;
+		}
+	}
+
+	//finalize the columns
+	for (size_t c = 0; c < columns.size(); ++c)
+	{
+		const Column& column = columns[c];
+		if (column.type == FWF_COLUMN)
+		{
+			//copy only the necessary descriptors
+			//(read-only access, as several clones of the same cloud may be created concurrently)
+			bool usedDescriptors[256] = { false };
+			for (unsigned i = 0; i < n; ++i)
+				usedDescriptors[result->m_fwfWaveforms[i].descriptorID()] = true;
+			for (unsigned id = 0; id < 256; ++id)
+				if (usedDescriptors[id])
+					result->fwfDescriptors().insert(static_cast<uint8_t>(id), m_fwfDescriptors.value(static_cast<uint8_t>(id)));
+			//we will use the same FWF data container
+			result->fwfData() = fwfData();
+		}
+		else if (column.type == SF_COLUMN)
+		{
+			column.destSF->computeMinAndMax();
+			//copy display parameters
+			column.destSF->importParametersFrom(column.sourceSF);
+		}
+	}
+
+	if (sfCount != 0)
+	{
 		unsigned copiedSFCount = getNumberOfScalarFields();
 		if (copiedSFCount)
 		{
@@ -357,7 +440,7 @@ ccPointCloud* ccPointCloud::partialClone(const CCLib::ReferenceCloud* selection,
 			std::vector<int> newIndexMap(size(), -1);
 			{
 				for (unsigned i = 0; i < n; i++)
-					newIndexMap[selection->getPointGlobalIndex(i)] = i;
+					newIndexMap[globalIndexes[i]] = i;
 			}
 
 			//duplicate the grid structure(s)
@@ -1406,6 +1489,7 @@ void ccPointCloud::setPointColor(unsigned pointIndex, const ColorCompType* col)
 
 	//We must update the VBOs
 	m_vboManager.updateFlags |= vboSet::UPDATE_COLORS;
+	++m_vboManager.dataVersion;
 }
 
 void ccPointCloud::setPointNormalIndex(unsigned pointIndex, CompressedNormType norm)
@@ -1416,6 +1500,7 @@ void ccPointCloud::setPointNormalIndex(unsigned pointIndex, CompressedNormType n
 
 	//We must update the VBOs
 	m_vboManager.updateFlags |= vboSet::UPDATE_NORMALS;
+	++m_vboManager.dataVersion;
 }
 
 void ccPointCloud::setPointNormal(unsigned pointIndex, const CCVector3& N)
@@ -2177,9 +2262,39 @@ static const unsigned MAX_POINT_COUNT_PER_LOD_RENDER_PASS = (MAX_NUMBER_OF_ELEME
 //Vertex indexes for OpenGL "arrays" drawing
 static PointCoordinateType s_pointBuffer [MAX_POINT_COUNT_PER_LOD_RENDER_PASS*3];
 static PointCoordinateType s_normalBuffer[MAX_POINT_COUNT_PER_LOD_RENDER_PASS*3];
+static CompressedNormType  s_normalCodeBuffer[MAX_POINT_COUNT_PER_LOD_RENDER_PASS];
 static ColorCompType       s_rgbBuffer3ub[MAX_POINT_COUNT_PER_LOD_RENDER_PASS*3];
 static float               s_rgbBuffer3f [MAX_POINT_COUNT_PER_LOD_RENDER_PASS*3];
 
+//! Min number of scalar values to convert to colors in parallel
+static const int MIN_SF_COUNT_FOR_PARALLEL_CONVERSION = 4096;
+
+//! Converts scalar values to RGB colors (in parallel)
+/** \param sf scalar field (with its color scale, saturation, etc.)
+	\param values first scalar value
+	\param count number of values to convert
+	\param step step between two consecutive values
+	\param rgb output array (3 x count)
+**/
+static void ConvertSFValuesToRGB(const ccScalarField* sf, const ScalarType* values, int count, unsigned step, ColorCompType* rgb)
+{
+	assert(sf && values && rgb);
+
+#if defined(_OPENMP)
+	#pragma omp parallel for if (count >= MIN_SF_COUNT_FOR_PARALLEL_CONVERSION)
+#endif
+	for (int j = 0; j < count; ++j)
+	{
+		const ColorCompType* col = sf->getColor(values[static_cast<size_t>(j) * step]);
+		if (!col)
+			col = ccColor::lightGrey.rgba;
+		ColorCompType* _rgb = rgb + 3 * j;
+		_rgb[0] = col[0];
+		_rgb[1] = col[1];
+		_rgb[2] = col[2];
+	}
+}
+
 void ccPointCloud::glChunkNormalPointer(const CC_DRAW_CONTEXT& context, unsigned chunkIndex, unsigned decimStep, bool useVBOs)
 {
 	assert(m_normals);
@@ -2187,6 +2302,36 @@ void ccPointCloud::glChunkNormalPointer(const CC_DRAW_CONTEXT& context, unsigned
 	QOpenGLFunctions_2_1* glFunc = context.glFunctions<QOpenGLFunctions_2_1>();
 	assert(glFunc != nullptr);
 
+	//VBOs only contain the compressed normals (see glChunkNormalCodePointer)
+	Q_UNUSED(useVBOs);
+
+	assert(m_normals && m_normals->chunkStartPtr(chunkIndex));
+	//we must decode normals in a dedicated static array
+	PointCoordinateType* _normals = s_normalBuffer;
+	const CompressedNormType* _normalsIndexes = m_normals->chunkStartPtr(chunkIndex);
+	unsigned chunkSize = m_normals->chunkSize(chunkIndex);
+
+	//compressed normals set
+	const ccNormalVectors* compressedNormals = ccNormalVectors::GetUniqueInstance();
+	assert(compressedNormals);
+
+	for (unsigned j = 0; j < chunkSize; j += decimStep, _normalsIndexes += decimStep)
+	{
+		const CCVector3& N = compressedNormals->getNormal(*_normalsIndexes);
+		*(_normals)++ = N.x;
+		*(_normals)++ = N.y;
+		*(_normals)++ = N.z;
+	}
+	glFunc->glNormalPointer(GL_COORD_TYPE, 0, s_normalBuffer);
+}
+
+void ccPointCloud::glChunkNormalCodePointer(const CC_DRAW_CONTEXT& context, ccNormalDecodeShader* shader, unsigned chunkIndex, unsigned decimStep, bool useVBOs)
+{
+	assert(m_normals && shader);
+
+	QOpenGLFunctions_2_1* glFunc = context.glFunctions<QOpenGLFunctions_2_1>();
+	assert(glFunc != nullptr);
+
 	if (	useVBOs
 		&&	m_vboManager.state == vboSet::INITIALIZED
 		&&	m_vboManager.hasNormals
@@ -2199,7 +2344,7 @@ void ccPointCloud::glChunkNormalPointer(const CC_DRAW_CONTEXT& context, unsigned
 		{
 			const GLbyte* start = 0; //fake pointer used to prevent warnings on Linux
 			int normalDataShift = m_vboManager.vbos[chunkIndex]->normalShift;
-			glFunc->glNormalPointer(GL_COORD_TYPE, decimStep * 3 * sizeof(PointCoordinateType), (const GLvoid*)(start + normalDataShift));
+			shader->setNormalCodePointer(glFunc, decimStep * sizeof(CompressedNormType), (const GLvoid*)(start + normalDataShift));
 			m_vboManager.vbos[chunkIndex]->release();
 		}
 		else
@@ -2207,29 +2352,14 @@ void ccPointCloud::glChunkNormalPointer(const CC_DRAW_CONTEXT& context, unsigned
 			ccLog::Warning("[VBO] Failed to bind VBO?! We'll deactivate them then...");
 			m_vboManager.state = vboSet::FAILED;
 			//recall the method
-			glChunkNormalPointer(context, chunkIndex, decimStep, false);
+			glChunkNormalCodePointer(context, shader, chunkIndex, decimStep, false);
 		}
 	}
 	else
 	{
-		assert(m_normals && m_normals->chunkStartPtr(chunkIndex));
-		//we must decode normals in a dedicated static array
-		PointCoordinateType* _normals = s_normalBuffer;
-		const CompressedNormType* _normalsIndexes = m_normals->chunkStartPtr(chunkIndex);
-		unsigned chunkSize = m_normals->chunkSize(chunkIndex);
-
-		//compressed normals set
-		const ccNormalVectors* compressedNormals = ccNormalVectors::GetUniqueInstance();
-		assert(compressedNormals);
-
-		for (unsigned j = 0; j < chunkSize; j += decimStep, _normalsIndexes += decimStep)
-		{
-			const CCVector3& N = compressedNormals->getNormal(*_normalsIndexes);
-			*(_normals)++ = N.x;
-			*(_normals)++ = N.y;
-			*(_normals)++ = N.z;
-		}
-		glFunc->glNormalPointer(GL_COORD_TYPE, 0, s_normalBuffer);
+		assert(m_normals->chunkStartPtr(chunkIndex));
+		//the compressed normals are sent as they are
+		shader->setNormalCodePointer(glFunc, decimStep * sizeof(CompressedNormType), m_normals->chunkStartPtr(chunkIndex));
 	}
 }
 
@@ -2308,17 +2438,12 @@ void ccPointCloud::glChunkSFPointer(const CC_DRAW_CONTEXT& context, unsigned chu
 	{
 		assert(m_currentDisplayedScalarField && m_currentDisplayedScalarField->chunkStartPtr(chunkIndex));
 		//we must convert the scalar values to RGB colors in a dedicated static array
-		ScalarType* _sf = m_currentDisplayedScalarField->chunkStartPtr(chunkIndex);
-		ColorCompType* _sfColors = s_rgbBuffer3ub;
+		const ScalarType* _sf = m_currentDisplayedScalarField->chunkStartPtr(chunkIndex);
 		unsigned chunkSize = m_currentDisplayedScalarField->chunkSize(chunkIndex);
-		for (unsigned j = 0; j < chunkSize; j += decimStep, _sf += decimStep)
+		int count = static_cast<int>((chunkSize + decimStep - 1) / decimStep);
 		{
-			//convert the scalar value to a RGB color
-			const ColorCompType* col = m_currentDisplayedScalarField->getColor(*_sf);
-			assert(col);
-			*_sfColors++ = *col++;
-			*_sfColors++ = *col++;
-			*_sfColors++ = *col++;
+			ccGLDrawStats::ScopedTimer timer(context.stats ? &context.stats->sfColorTime_ns : 0);
+			ConvertSFValuesToRGB(m_currentDisplayedScalarField, _sf, count, decimStep, s_rgbBuffer3ub);
 		}
 		glFunc->glColorPointer(3, GL_UNSIGNED_BYTE, 0, s_rgbBuffer3ub);
 	}
@@ -2373,6 +2498,26 @@ template <class QOpenGLFunctions> void glLODChunkNormalPointer(	NormsIndexesTabl
 	glFunc->glNormalPointer(GL_COORD_TYPE, 0, s_normalBuffer);
 }
 
+template <class QOpenGLFunctions> void glLODChunkNormalCodePointer(	NormsIndexesTableType* normals,
+																	ccNormalDecodeShader* shader,
+																	QOpenGLFunctions* glFunc,
+																	const LODIndexSet& indexMap,
+																	unsigned startIndex,
+																	unsigned stopIndex)
+{
+	assert(startIndex < indexMap.currentSize() && stopIndex <= indexMap.currentSize());
+	assert(normals && shader && glFunc);
+
+	//no need to decode the normals, we only gather them
+	CompressedNormType* _normalCodes = s_normalCodeBuffer;
+	for (unsigned j = startIndex; j < stopIndex; j++)
+	{
+		unsigned pointIndex = indexMap.getValue(j);
+		*(_normalCodes)++ = normals->getValue(pointIndex);
+	}
+	shader->setNormalCodePointer(glFunc, 0, s_normalCodeBuffer);
+}
+
 template <class QOpenGLFunctions> void glLODChunkColorPointer(	ColorsTableType* colors,
 																QOpenGLFunctions* glFunc, 
 																const LODIndexSet& indexMap,
@@ -2408,16 +2553,20 @@ template <class QOpenGLFunctions> void glLODChunkSFPointer(	ccScalarField* sf,
 	assert(sizeof(ColorCompType) == 1);
 
 	//we must re-order and convert SF values to RGB colors in a dedicated static array
-	ColorCompType* _sfColors = s_rgbBuffer3ub;
-	for (unsigned j = startIndex; j < stopIndex; j++)
+	int count = static_cast<int>(stopIndex - startIndex);
+#if defined(_OPENMP)
+	#pragma omp parallel for if (count >= MIN_SF_COUNT_FOR_PARALLEL_CONVERSION)
+#endif
+	for (int j = 0; j < count; ++j)
 	{
-		unsigned pointIndex = indexMap.getValue(j);
+		unsigned pointIndex = indexMap.getValue(startIndex + j);
 		//convert the scalar value to a RGB color
 		const ColorCompType* col = sf->getColor(sf->getValue(pointIndex));
 		assert(col);
-		*_sfColors++ = *col++;
-		*_sfColors++ = *col++;
-		*_sfColors++ = *col++;
+		ColorCompType* _sfColors = s_rgbBuffer3ub + 3 * j;
+		_sfColors[0] = col[0];
+		_sfColors[1] = col[1];
+		_sfColors[2] = col[2];
 	}
 	//standard OpenGL copy
 	glFunc->glColorPointer(3, GL_UNSIGNED_BYTE, 0, s_rgbBuffer3ub);
@@ -2544,6 +2693,8 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 						}
 						else if (context.stereoPassIndex == 0)
 						{
+							ccGLDrawStats::ScopedTimer timer(context.stats ? &context.stats->lodSelectionTime_ns : 0);
+
 							if (context.currentLODLevel == 0)
 							{
 								//get the current viewport and OpenGL matrices
@@ -2556,8 +2707,12 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 								//camera frustum
 								Frustum frustum(camera.modelViewMat, camera.projectionMat);
 
+								//occlusion culling can't be used if some points may be hidden
+								bool occlusionCulling = (	!isVisibilityTableInstantiated()
+														&&	!(glParams.showSF && m_currentDisplayedScalarField->mayHaveHiddenValues()) );
+
 								//first time: we flag the cells visibility and count the number of visible points
-								m_lod->flagVisibility(frustum, m_clipPlanes.empty() ? 0 : &m_clipPlanes);
+								m_lod->flagVisibility(frustum, m_clipPlanes.empty() ? 0 : &m_clipPlanes, &camera, occlusionCulling);
 							}
 
 							unsigned remainingPointsAtThisLevel = 0;
@@ -2575,6 +2730,10 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 								toDisplay.endIndex = toDisplay.startIndex + toDisplay.count;
 							}
 
+							//statistics
+							context.lodSubmittedPointCount += toDisplay.count;
+							context.lodVisiblePointCount += m_lod->visiblePointCount();
+
 							//could we draw more points at the next level?
 							context.moreLODPointsAvailable = (remainingPointsAtThisLevel != 0);
 							context.higherLODLevelsAvailable = (!m_lod->allDisplayed() && context.currentLODLevel + 1 <= maxLevel);
@@ -2609,6 +2768,12 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 			}
 		}
 
+		//statistics
+		if (context.stats)
+		{
+			context.stats->submittedPointCount += (toDisplay.indexMap ? toDisplay.count : (toDisplay.count + toDisplay.decimStep - 1) / toDisplay.decimStep);
+		}
+
 		//ccLog::Print(QString("Rendering %1 points starting from index %2 (LoD = %3 / PN = %4)").arg(toDisplay.count).arg(toDisplay.startIndex).arg(toDisplay.indexMap ? "yes" : "no").arg(pushName ? "yes" : "no"));
 		bool colorMaterialEnabled = false;
 
@@ -2824,9 +2989,16 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 				//if all points should be displayed (fastest case)
 				if (!hiddenPoints)
 				{
+					//compressed normals can be decoded by the GPU (if the color ramp shader is not used)
+					ccNormalDecodeShader* normalDecodeShader = (glParams.showNorms && !colorRampShader ? context.normalDecodeShader : 0);
+					if (normalDecodeShader && !normalDecodeShader->start(glFunc))
+					{
+						normalDecodeShader = 0;
+					}
+
 					glFunc->glEnableClientState(GL_VERTEX_ARRAY);
 					glFunc->glEnableClientState(GL_COLOR_ARRAY);
-					if (glParams.showNorms)
+					if (glParams.showNorms && !normalDecodeShader)
 					{
 						glFunc->glEnableClientState(GL_NORMAL_ARRAY);
 					}
@@ -2842,7 +3014,11 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 							//points
 							glLODChunkVertexPointer<QOpenGLFunctions_2_1>(this, glFunc, *toDisplay.indexMap, s, e);
 							//normals
-							if (glParams.showNorms)
+							if (normalDecodeShader)
+							{
+								glLODChunkNormalCodePointer<QOpenGLFunctions_2_1>(m_normals, normalDecodeShader, glFunc, *toDisplay.indexMap, s, e);
+							}
+							else if (glParams.showNorms)
 							{
 								glLODChunkNormalPointer<QOpenGLFunctions_2_1>(m_normals, glFunc, *toDisplay.indexMap, s, e);
 							}
@@ -2866,6 +3042,7 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 							}
 							else
 							{
+								ccGLDrawStats::ScopedTimer timer(context.stats ? &context.stats->sfColorTime_ns : 0);
 								glLODChunkSFPointer<QOpenGLFunctions_2_1>(m_currentDisplayedScalarField, glFunc, *toDisplay.indexMap, s, e);
 							}
 
@@ -2884,7 +3061,11 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 							//points
 							glChunkVertexPointer(context, k, toDisplay.decimStep, useVBOs);
 							//normals
-							if (glParams.showNorms)
+							if (normalDecodeShader)
+							{
+								glChunkNormalCodePointer(context, normalDecodeShader, k, toDisplay.decimStep, useVBOs);
+							}
+							else if (glParams.showNorms)
 							{
 								glChunkNormalPointer(context, k, toDisplay.decimStep, useVBOs);
 							}
@@ -2918,12 +3099,17 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 						}
 					}
 
-					if (glParams.showNorms)
+					if (glParams.showNorms && !normalDecodeShader)
 					{
 						glFunc->glDisableClientState(GL_NORMAL_ARRAY);
 					}
 					glFunc->glDisableClientState(GL_COLOR_ARRAY);
 					glFunc->glDisableClientState(GL_VERTEX_ARRAY);
+
+					if (normalDecodeShader)
+					{
+						normalDecodeShader->stop(glFunc);
+					}
 				}
 				else //potentially hidden points
 				{
@@ -3049,10 +3235,17 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 			{
 				bool useVBOs = context.useVBOs && !toDisplay.indexMap ? updateVBOs(context, glParams) : false; //VBOs are not compatible with LoD
 
+				//compressed normals can be decoded by the GPU
+				ccNormalDecodeShader* normalDecodeShader = (glParams.showNorms ? context.normalDecodeShader : 0);
+				if (normalDecodeShader && !normalDecodeShader->start(glFunc))
+				{
+					normalDecodeShader = 0;
+				}
+
 				unsigned chunks = m_points->chunksCount();
 
 				glFunc->glEnableClientState(GL_VERTEX_ARRAY);
-				if (glParams.showNorms)
+				if (glParams.showNorms && !normalDecodeShader)
 					glFunc->glEnableClientState(GL_NORMAL_ARRAY);
 				if (glParams.showColors)
 					glFunc->glEnableClientState(GL_COLOR_ARRAY);
@@ -3068,7 +3261,9 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 						//points
 						glLODChunkVertexPointer<QOpenGLFunctions_2_1>(this, glFunc, *toDisplay.indexMap, s, e);
 						//normals
-						if (glParams.showNorms)
+						if (normalDecodeShader)
+							glLODChunkNormalCodePointer<QOpenGLFunctions_2_1>(m_normals, normalDecodeShader, glFunc, *toDisplay.indexMap, s, e);
+						else if (glParams.showNorms)
 							glLODChunkNormalPointer<QOpenGLFunctions_2_1>(m_normals, glFunc, *toDisplay.indexMap, s, e);
 						//colors
 						if (glParams.showColors)
@@ -3087,7 +3282,9 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 						//points
 						glChunkVertexPointer(context, k, toDisplay.decimStep, useVBOs);
 						//normals
-						if (glParams.showNorms)
+						if (normalDecodeShader)
+							glChunkNormalCodePointer(context, normalDecodeShader, k, toDisplay.decimStep, useVBOs);
+						else if (glParams.showNorms)
 							glChunkNormalPointer(context, k, toDisplay.decimStep, useVBOs);
 						//colors
 						if (glParams.showColors)
@@ -3102,10 +3299,15 @@ void ccPointCloud::drawMeOnly(CC_DRAW_CONTEXT& context)
 				}
 
 				glFunc->glDisableClientState(GL_VERTEX_ARRAY);
-				if (glParams.showNorms)
+				if (glParams.showNorms && !normalDecodeShader)
 					glFunc->glDisableClientState(GL_NORMAL_ARRAY);
 				if (glParams.showColors)
 					glFunc->glDisableClientState(GL_COLOR_ARRAY);
+
+				if (normalDecodeShader)
+				{
+					normalDecodeShader->stop(glFunc);
+				}
 			}
 		}
 
@@ -3948,6 +4150,19 @@ int ccPointCloud::addScalarField(ccScalarField* sf)
 	return static_cast<int>(m_scalarFields.size())-1;
 }
 
+//! Whether the LOD structure is saved with the clouds (see ccPointCloud::SetLODSavedWithCloud)
+static bool s_saveLODWithCloud = false;
+
+void ccPointCloud::SetLODSavedWithCloud(bool state)
+{
+	s_saveLODWithCloud = state;
+}
+
+bool ccPointCloud::IsLODSavedWithCloud()
+{
+	return s_saveLODWithCloud;
+}
+
 bool ccPointCloud::toFile_MeOnly(QFile& out) const
 {
 	if (!ccGenericPointCloud::toFile_MeOnly(out))
@@ -4121,6 +4336,17 @@ bool ccPointCloud::toFile_MeOnly(QFile& out) const
 		}
 	}
 
+	//LOD structure (dataVersion >= 48)
+	bool withLOD = (s_saveLODWithCloud && m_lod && m_lod->isInitialized());
+	if (out.write((const char*)&withLOD, sizeof(bool)) < 0)
+	{
+		return WriteError();
+	}
+	if (withLOD && !m_lod->toFile(out))
+	{
+		return WriteError();
+	}
+
 	return true;
 }
 
@@ -4443,6 +4669,28 @@ bool ccPointCloud::fromFile_MeOnly(QFile& in, short dataVersion, int flags)
 		}
 	}
 
+	//LOD structure (dataVersion >= 48)
+	if (dataVersion >= 48)
+	{
+		//saved so that it doesn't have to be computed again
+		bool withLOD = false;
+		if (in.read((char*)&withLOD, sizeof(bool)) < 0)
+		{
+			return ReadError();
+		}
+		if (withLOD)
+		{
+			if (!m_lod)
+			{
+				m_lod = new ccPointCloudLOD;
+			}
+			if (!m_lod->fromFile(in, this))
+			{
+				return ReadError();
+			}
+		}
+	}
+
 	//notifyGeometryUpdate(); //FIXME: we can't call it now as the dependent 'pointers' are not valid yet!
 
 	//We should update the VBOs (just in case)
@@ -4459,53 +4707,366 @@ unsigned ccPointCloud::getUniqueIDForDisplay() const
 		return getUniqueID();
 }
 
-CCLib::ReferenceCloud* ccPointCloud::crop(const ccBBox& box, bool inside/*=true*/)
+//! Number of points per chunk (see SelectPoints)
+static const unsigned c_selectionChunkSize = (1 << 16);
+
+//! Selects the points of a cloud that satisfy a given predicate
+/** The cloud is split in chunks of points that are tested in parallel (by
+	batches, so that the process can be cancelled in between). Each chunk gets
+	its own index buffer and the buffers are then concatenated in order, so
+	that the selection is the same as with a sequential scan.
+	\return the selection (potentially empty) or 0 if there's not enough memory or if the process has been cancelled
+**/
+template <class Predicate> static CCLib::ReferenceCloud* SelectPoints(	ccPointCloud* cloud,
+																		const Predicate& predicate,
+																		CCLib::GenericProgressCallback* progressCb,
+																		const char* context)
 {
-	if (!box.isValid())
+	const unsigned count = cloud->size();
+	const unsigned chunkCount = (count + c_selectionChunkSize - 1) / c_selectionChunkSize;
+
+	//selected indexes of each chunk (the buffer of the chunks that are fully selected is released)
+	std::vector< std::vector<unsigned> > chunkIndexes;
+	//chunk status (0 = partial selection, 1 = all points selected, -1 = not enough memory)
+	std::vector<int> chunkStatus;
+	try
 	{
-		ccLog::Warning("[ccPointCloud::crop] Invalid bounding-box");
+		chunkIndexes.resize(chunkCount);
+		chunkStatus.resize(chunkCount, 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning(QString("[%1] Not enough memory!").arg(context));
 		return 0;
 	}
 
-	unsigned count = size();
-	if (count == 0)
+	if (progressCb)
 	{
-		ccLog::Warning("[ccPointCloud::crop] Cloud is empty!");
+		if (progressCb->textCanBeEdited())
+		{
+			progressCb->setMethodTitle("Crop");
+			progressCb->setInfo(qPrintable(QString("Number of points = %1").arg(count)));
+		}
+		progressCb->update(0);
+		progressCb->start();
+	}
+	CCLib::NormalizedProgress nProgress(progressCb, chunkCount);
+
+	//the chunks are processed by batches (so that we can check for cancellation)
+	const int batchSize = std::max(1, QThread::idealThreadCount()) * 16;
+	bool error = false;
+	bool cancelled = false;
+	for (unsigned firstChunk = 0; firstChunk < chunkCount; firstChunk += static_cast<unsigned>(batchSize))
+	{
+		int currentBatchSize = static_cast<int>(std::min(chunkCount - firstChunk, static_cast<unsigned>(batchSize)));
+
+#if defined(_OPENMP)
+		#pragma omp parallel for schedule(dynamic)
+#endif
+		for (int b = 0; b < currentBatchSize; ++b)
+		{
+			unsigned c = firstChunk + static_cast<unsigned>(b);
+			unsigned chunkStart = c * c_selectionChunkSize;
+			unsigned chunkStop = std::min(count, chunkStart + c_selectionChunkSize);
+
+			std::vector<unsigned>& indexes = chunkIndexes[c];
+			try
+			{
+				indexes.reserve(chunkStop - chunkStart);
+			}
+			catch (const std::bad_alloc&)
+			{
+				chunkStatus[c] = -1;
+				continue;
+			}
+
+			for (unsigned i = chunkStart; i < chunkStop; ++i)
+			{
+				if (predicate(*cloud->getPoint(i)))
+				{
+					indexes.push_back(i);
+				}
+			}
+
+			if (indexes.size() == chunkStop - chunkStart)
+			{
+				//no need to keep the indexes
+				chunkStatus[c] = 1;
+				std::vector<unsigned>().swap(indexes);
+			}
+			else
+			{
+				//release the unused memory
+				std::vector<unsigned>(indexes).swap(indexes);
+			}
+		}
+
+		for (int b = 0; b < currentBatchSize; ++b)
+		{
+			if (chunkStatus[firstChunk + static_cast<unsigned>(b)] < 0)
+			{
+				error = true;
+				break;
+			}
+		}
+		if (error)
+			break;
+
+		if (progressCb && !nProgress.steps(static_cast<unsigned>(currentBatchSize)))
+		{
+			cancelled = true;
+			break;
+		}
+	}
+
+	if (progressCb)
+	{
+		progressCb->stop();
+	}
+
+	if (error)
+	{
+		ccLog::Warning(QString("[%1] Not enough memory!").arg(context));
+		return 0;
+	}
+	else if (cancelled)
+	{
+		ccLog::Warning(QString("[%1] Process cancelled by user").arg(context));
 		return 0;
 	}
 
-	CCLib::ReferenceCloud* ref = new CCLib::ReferenceCloud(this);
-	if (!ref->reserve(count))
+	//count the selected points
+	unsigned selectedCount = 0;
+	for (unsigned c = 0; c < chunkCount; ++c)
 	{
-		ccLog::Warning("[ccPointCloud::crop] Not enough memory!");
+		if (chunkStatus[c] > 0)
+			selectedCount += std::min(count - c * c_selectionChunkSize, c_selectionChunkSize);
+		else
+			selectedCount += static_cast<unsigned>(chunkIndexes[c].size());
+	}
+
+	CCLib::ReferenceCloud* ref = new CCLib::ReferenceCloud(cloud);
+	if (selectedCount == 0)
+	{
+		//no points inside selection!
+		return ref;
+	}
+
+	if (!ref->reserve(selectedCount))
+	{
+		ccLog::Warning(QString("[%1] Not enough memory!").arg(context));
 		delete ref;
 		return 0;
 	}
 
-	for (unsigned i=0; i<count; ++i)
+	//concatenate the chunks indexes (in order)
+	for (unsigned c = 0; c < chunkCount; ++c)
 	{
-		const CCVector3* P = point(i);
-		bool pointIsInside = box.contains(*P);
-		if (inside == pointIsInside)
+		if (chunkStatus[c] > 0)
 		{
-			ref->addPointIndex(i);
+			unsigned chunkStart = c * c_selectionChunkSize;
+			ref->addPointIndex(chunkStart, std::min(count, chunkStart + c_selectionChunkSize));
+		}
+		else
+		{
+			const std::vector<unsigned>& indexes = chunkIndexes[c];
+			for (size_t k = 0; k < indexes.size(); ++k)
+			{
+				ref->addPointIndex(indexes[k]);
+			}
 		}
 	}
+	assert(ref->size() == selectedCount);
+
+	return ref;
+}
 
-	if (ref->size() == 0)
+CCLib::ReferenceCloud* ccPointCloud::crop(const ccBBox& box, bool inside/*=true*/, CCLib::GenericProgressCallback* progressCb/*=0*/)
+{
+	if (!box.isValid())
 	{
-		//no points inside selection!
-		ref->clear(true);
+		ccLog::Warning("[ccPointCloud::crop] Invalid bounding-box");
+		return 0;
 	}
-	else
+
+	unsigned count = size();
+	if (count == 0)
 	{
-		ref->resize(ref->size());
+		ccLog::Warning("[ccPointCloud::crop] Cloud is empty!");
+		return 0;
 	}
 
-	return ref;
+	return SelectPoints(this, [&box, inside](const CCVector3& P) { return box.contains(P) == inside; }, progressCb, "ccPointCloud::crop");
 }
 
-CCLib::ReferenceCloud* ccPointCloud::crop2D(const ccPolyline* poly, unsigned char orthoDim, bool inside/*=true*/)
+//! Edges of a 2D polygon sorted in horizontal buckets
+/** Speeds up the point-in-polygon test for polygons with many vertices:
+	only the edges overlapping the bucket of the point (along Y) are tested.
+	The result is exactly the same as ManualSegmentationTools::isPointInsidePoly.
+**/
+class PolygonEdgeBuckets
+{
+public:
+
+	//! Default constructor
+	PolygonEdgeBuckets()
+		: m_bucketCount(0)
+		, m_bucketHeight(0)
+		, m_minY(0)
+		, m_maxY(0)
+	{}
+
+	//! Initializes the structure with the polygon vertices (only X and Y are considered)
+	/** \return success (false if there's not enough memory)
+	**/
+	bool init(const CCLib::GenericIndexedCloud* polyVertices)
+	{
+		m_edges.clear();
+		m_bucketStart.clear();
+		m_bucketEdges.clear();
+
+		unsigned vertCount = (polyVertices ? polyVertices->size() : 0);
+		if (vertCount < 2)
+			return true;
+
+		try
+		{
+			//we only keep the non-horizontal edges (they can't be crossed)
+			m_edges.reserve(vertCount);
+			CCVector3 A;
+			polyVertices->getPoint(0, A);
+			for (unsigned i = 1; i <= vertCount; ++i)
+			{
+				CCVector3 B;
+				polyVertices->getPoint(i % vertCount, B);
+				if (A.y != B.y)
+				{
+					Edge e;
+					e.A = CCVector2(A.x, A.y);
+					e.B = CCVector2(B.x, B.y);
+					m_edges.push_back(e);
+				}
+				A = B;
+			}
+
+			if (m_edges.empty())
+				return true;
+
+			m_minY = m_maxY = m_edges.front().A.y;
+			for (size_t i = 0; i < m_edges.size(); ++i)
+			{
+				const Edge& e = m_edges[i];
+				m_minY = std::min(m_minY, std::min(e.A.y, e.B.y));
+				m_maxY = std::max(m_maxY, std::max(e.A.y, e.B.y));
+			}
+
+			m_bucketCount = static_cast<unsigned>(std::min<size_t>(m_edges.size(), 1 << 16));
+			m_bucketHeight = (m_maxY - m_minY) / m_bucketCount;
+
+			//count the edges of each bucket
+			m_bucketStart.resize(m_bucketCount + 1, 0);
+			for (size_t i = 0; i < m_edges.size(); ++i)
+			{
+				unsigned b0, b1;
+				getBucketRange(m_edges[i], b0, b1);
+				for (unsigned b = b0; b <= b1; ++b)
+					++m_bucketStart[b + 1];
+			}
+			for (unsigned b = 0; b < m_bucketCount; ++b)
+				m_bucketStart[b + 1] += m_bucketStart[b];
+
+			//then store them (CSR layout)
+			m_bucketEdges.resize(m_bucketStart.back());
+			std::vector<unsigned> fillPos(m_bucketStart.begin(), m_bucketStart.end() - 1);
+			for (size_t i = 0; i < m_edges.size(); ++i)
+			{
+				unsigned b0, b1;
+				getBucketRange(m_edges[i], b0, b1);
+				for (unsigned b = b0; b <= b1; ++b)
+					m_bucketEdges[fillPos[b]++] = static_cast<unsigned>(i);
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			m_edges.clear();
+			m_bucketStart.clear();
+			m_bucketEdges.clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	//! Returns whether a point is inside the polygon or not
+	inline bool isInside(const CCVector2& P) const
+	{
+		//an horizontal line outside of the polygon range can't cross any edge
+		if (m_edges.empty() || P.y < m_minY || P.y >= m_maxY)
+			return false;
+
+		bool inside = false;
+		unsigned b = getBucketIndex(P.y);
+		for (unsigned k = m_bucketStart[b]; k < m_bucketStart[b + 1]; ++k)
+		{
+			const Edge& e = m_edges[m_bucketEdges[k]];
+			const CCVector2& A = e.A;
+			const CCVector2& B = e.B;
+
+			//same test as ManualSegmentationTools::isPointInsidePoly
+			if ((B.y <= P.y && P.y < A.y) || (A.y <= P.y && P.y < B.y))
+			{
+				PointCoordinateType t = (P.x - B.x)*(A.y - B.y) - (A.x - B.x)*(P.y - B.y);
+				if (A.y < B.y)
+					t = -t;
+				if (t < 0)
+					inside = !inside;
+			}
+		}
+
+		return inside;
+	}
+
+protected:
+
+	//! Polygon edge
+	struct Edge
+	{
+		CCVector2 A, B;
+	};
+
+	//! Returns the bucket of a given Y value (monotonic)
+	inline unsigned getBucketIndex(PointCoordinateType y) const
+	{
+		if (m_bucketHeight <= 0 || y <= m_minY)
+			return 0;
+		unsigned b = static_cast<unsigned>((y - m_minY) / m_bucketHeight);
+		return std::min(b, m_bucketCount - 1);
+	}
+
+	//! Returns the range of buckets overlapped by an edge
+	inline void getBucketRange(const Edge& e, unsigned& b0, unsigned& b1) const
+	{
+		b0 = getBucketIndex(std::min(e.A.y, e.B.y));
+		b1 = getBucketIndex(std::max(e.A.y, e.B.y));
+	}
+
+	//! Non-horizontal edges
+	std::vector<Edge> m_edges;
+	//! Index of the first edge of each bucket (+ the total number of entries)
+	std::vector<unsigned> m_bucketStart;
+	//! Edge indexes (sorted by bucket)
+	std::vector<unsigned> m_bucketEdges;
+	//! Number of buckets
+	unsigned m_bucketCount;
+	//! Buckets height
+	PointCoordinateType m_bucketHeight;
+	//! Min Y
+	PointCoordinateType m_minY;
+	//! Max Y
+	PointCoordinateType m_maxY;
+};
+
+CCLib::ReferenceCloud* ccPointCloud::crop2D(const ccPolyline* poly, unsigned char orthoDim, bool inside/*=true*/, CCLib::GenericProgressCallback* progressCb/*=0*/)
 {
 	if (!poly)
 	{
@@ -4525,40 +5086,17 @@ CCLib::ReferenceCloud* ccPointCloud::crop2D(const ccPolyline* poly, unsigned cha
 		return 0;
 	}
 
-	CCLib::ReferenceCloud* ref = new CCLib::ReferenceCloud(this);
-	if (!ref->reserve(count))
+	PolygonEdgeBuckets buckets;
+	if (!buckets.init(poly))
 	{
 		ccLog::Warning("[ccPointCloud::crop] Not enough memory!");
-		delete ref;
 		return 0;
 	}
 
-	unsigned char X = ((orthoDim+1) % 3);
-	unsigned char Y = ((X+1) % 3);
-
-	for (unsigned i=0; i<count; ++i)
-	{
-		const CCVector3* P = point(i);
-
-		CCVector2 P2D( P->u[X], P->u[Y] );
-		bool pointIsInside = CCLib::ManualSegmentationTools::isPointInsidePoly(P2D, poly);
-		if (inside == pointIsInside)
-		{
-			ref->addPointIndex(i);
-		}
-	}
-
-	if (ref->size() == 0)
-	{
-		//no points inside selection!
-		ref->clear(true);
-	}
-	else
-	{
-		ref->resize(ref->size());
-	}
+	const unsigned char X = ((orthoDim+1) % 3);
+	const unsigned char Y = ((X+1) % 3);
 
-	return ref;
+	return SelectPoints(this, [&buckets, X, Y, inside](const CCVector3& P) { return buckets.isInside(CCVector2(P.u[X], P.u[Y])) == inside; }, progressCb, "ccPointCloud::crop2D");
 }
 
 static bool CatchGLErrors(GLenum err, const char* context)
@@ -4597,11 +5135,10 @@ static bool CatchGLErrors(GLenum err, const char* context)
 	return true;
 }
 
-//DGM: normals are so slow that it's a waste of memory and time to load them in VBOs!
-#define DONT_LOAD_NORMALS_IN_VBOS
-
 bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams& glParams)
 {
+	ccGLDrawStats::ScopedTimer timer(context.stats ? &context.stats->vboUpdateTime_ns : 0);
+
 	if (isColorOverriden())
 	{
 		//nothing to do (we don't display true colors, SF or normals!)
@@ -4638,12 +5175,12 @@ bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams
 			m_vboManager.updateFlags |= vboSet::UPDATE_COLORS;
 		}
 
-#ifndef DONT_LOAD_NORMALS_IN_VBOS
-		if ( glParams.showNorms && !m_vboManager.hasNormals )
+		//normals are only loaded in VBOs when they are decoded by the GPU (they are
+		//loaded as they are, i.e. compressed - decoding them on the CPU would be too slow)
+		if ( glParams.showNorms && context.normalDecodeShader && !m_vboManager.hasNormals )
 		{
-			updateFlags |= UPDATE_NORMALS;
+			m_vboManager.updateFlags |= vboSet::UPDATE_NORMALS;
 		}
-#endif
 		//nothing to do?
 		if (m_vboManager.updateFlags == 0)
 		{
@@ -4692,18 +5229,28 @@ bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams
 
 		assert(!glParams.showSF		|| (m_currentDisplayedScalarField && m_currentDisplayedScalarField->chunksCount() >= chunksCount));
 		assert(!glParams.showColors	|| (m_rgbColors && m_rgbColors->chunksCount() >= chunksCount));
-#ifndef DONT_LOAD_NORMALS_IN_VBOS
 		assert(!glParams.showNorms	|| (m_normals && m_normals->chunksCount() >= chunksCount));
-#endif
 
 		m_vboManager.hasColors  = glParams.showSF || glParams.showColors;
 		m_vboManager.colorIsSF  = glParams.showSF;
 		m_vboManager.sourceSF   = glParams.showSF ? m_currentDisplayedScalarField : 0;
-#ifndef DONT_LOAD_NORMALS_IN_VBOS
-		m_vboManager.hasNormals = glParams.showNorms;
-#else
-		m_vboManager.hasNormals  = false;
-#endif
+		m_vboManager.hasNormals = glParams.showNorms && context.normalDecodeShader;
+
+		//chunks for which the scalar values must be converted to colors
+		std::vector<unsigned> sfChunks;
+		if (glParams.showSF && (m_vboManager.updateFlags & vboSet::UPDATE_COLORS))
+		{
+			try
+			{
+				sfChunks.reserve(chunksCount);
+			}
+			catch (const std::bad_alloc&)
+			{
+				ccLog::Warning(QString("[ccPointCloud::updateVBOs] Not enough memory! (cloud '%1')").arg(getName()));
+				m_vboManager.state = vboSet::FAILED;
+				return false;
+			}
+		}
 
 		//process each chunk
 		for (unsigned i=0; i<chunksCount; ++i)
@@ -4748,50 +5295,20 @@ bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams
 				{
 					if (glParams.showSF)
 					{
-						//copy SF colors in static array
-						{
-							assert(m_vboManager.sourceSF);
-							ColorCompType* _sfColors = s_rgbBuffer3ub;
-							ScalarType* _sf = m_vboManager.sourceSF->chunkStartPtr(i);
-							assert(m_vboManager.sourceSF->chunkSize(i) == chunkSize);
-							for (int j=0; j<chunkSize; j++,_sf++)
-							{
-								//we need to convert scalar value to color into a temporary structure
-								const ColorCompType* col = m_vboManager.sourceSF->getColor(*_sf);
-								if (!col)
-									col = ccColor::lightGrey.rgba;
-								*_sfColors++ = *col++;
-								*_sfColors++ = *col++;
-								*_sfColors++ = *col++;
-							}
-						}
-						//then send them in VRAM
-						m_vboManager.vbos[i]->write(m_vboManager.vbos[i]->rgbShift, s_rgbBuffer3ub, sizeof(ColorCompType)*chunkSize * 3);
-						//upadte 'modification' flag for current displayed SF
-						m_vboManager.sourceSF->setModificationFlag(false);
+						//the scalar values will be converted afterwards (see below)
+						assert(m_vboManager.sourceSF && m_vboManager.sourceSF->chunkSize(i) == chunkSize);
+						sfChunks.push_back(i);
 					}
 					else if (glParams.showColors)
 					{
 						m_vboManager.vbos[i]->write(m_vboManager.vbos[i]->rgbShift, m_rgbColors->chunkStartPtr(i), sizeof(ColorCompType)*chunkSize * 3);
 					}
 				}
-#ifndef DONT_LOAD_NORMALS_IN_VBOS
-				//load normals
-				if (glParams.showNorms && (chunkUpdateFlags & UPDATE_NORMALS))
+				//load normals (compressed - see ccNormalDecodeShader)
+				if (m_vboManager.hasNormals && (chunkUpdateFlags & vboSet::UPDATE_NORMALS))
 				{
-					//we must decode the normals first!
-					CompressedNormType* inNorms = m_normals->chunkStartPtr(i);
-					PointCoordinateType* outNorms = s_normalBuffer;
-					for (int j=0; j<chunkSize; ++j)
-					{
-						const CCVector3& N = ccNormalVectors::GetNormal(*inNorms++);
-						*(outNorms)++ = N.x;
-						*(outNorms)++ = N.y;
-						*(outNorms)++ = N.z;
-					}
-					m_vboManager.vbos[i]->write(m_vboManager.vbos[i]->normalShift, s_normalBuffer, sizeof(PointCoordinateType)*chunkSize * 3);
+					m_vboManager.vbos[i]->write(m_vboManager.vbos[i]->normalShift, m_normals->chunkStartPtr(i), sizeof(CompressedNormType)*chunkSize);
 				}
-#endif
 				m_vboManager.vbos[i]->release();
 
 				//if an error is detected
@@ -4829,6 +5346,14 @@ bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams
 				}
 			}
 		}
+
+		//convert the scalar values to colors
+		if (!sfChunks.empty())
+		{
+			convertSFToVBOColors(context, sfChunks);
+			//update 'modification' flag for current displayed SF
+			m_vboManager.sourceSF->setModificationFlag(false);
+		}
 	}
 
 	//Display vbo(s) status
@@ -4852,6 +5377,81 @@ bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams
 	return true;
 }
 
+void ccPointCloud::convertSFToVBOColors(const CC_DRAW_CONTEXT& context, const std::vector<unsigned>& chunkIndexes)
+{
+	ccGLDrawStats::ScopedTimer timer(context.stats ? &context.stats->sfColorTime_ns : 0);
+
+	ccScalarField* sf = m_vboManager.sourceSF;
+	assert(sf);
+
+	//the VBOs are mapped (in batches) so that the colors can be written directly in their memory by several threads
+	static const size_t MAX_MAPPED_VBO_COUNT = 64;
+	
+	for (size_t first = 0; first < chunkIndexes.size(); first += MAX_MAPPED_VBO_COUNT)
+	{
+		size_t last = std::min(first + MAX_MAPPED_VBO_COUNT, chunkIndexes.size());
+
+		//map the VBOs
+		ColorCompType* mappedColors[MAX_MAPPED_VBO_COUNT];
+		for (size_t k = first; k < last; ++k)
+		{
+			ColorCompType*& colors = mappedColors[k - first];
+			colors = 0;
+
+			VBO* vbo = m_vboManager.vbos[chunkIndexes[k]];
+			if (!vbo) //the VBO initialization may have failed
+				continue;
+
+			if (vbo->bind())
+			{
+				void* data = vbo->map(QGLBuffer::WriteOnly);
+				if (data)
+				{
+					colors = reinterpret_cast<ColorCompType*>(static_cast<char*>(data) + vbo->rgbShift);
+				}
+				vbo->release();
+			}
+		}
+
+		//convert the scalar values (one chunk per thread)
+		int batchSize = static_cast<int>(last - first);
+#if defined(_OPENMP)
+		#pragma omp parallel for schedule(dynamic)
+#endif
+		for (int k = 0; k < batchSize; ++k)
+		{
+			if (mappedColors[k])
+			{
+				unsigned chunkIndex = chunkIndexes[first + k];
+				ConvertSFValuesToRGB(sf, sf->chunkStartPtr(chunkIndex), static_cast<int>(sf->chunkSize(chunkIndex)), 1, mappedColors[k]);
+			}
+		}
+
+		//unmap the VBOs (or update them the standard way if they couldn't be mapped)
+		for (size_t k = first; k < last; ++k)
+		{
+			unsigned chunkIndex = chunkIndexes[k];
+			VBO* vbo = m_vboManager.vbos[chunkIndex];
+			if (!vbo || !vbo->bind())
+				continue;
+
+			if (!mappedColors[k - first] || !vbo->unmap())
+			{
+				int chunkSize = static_cast<int>(sf->chunkSize(chunkIndex));
+				ConvertSFValuesToRGB(sf, sf->chunkStartPtr(chunkIndex), chunkSize, 1, s_rgbBuffer3ub);
+				vbo->write(vbo->rgbShift, s_rgbBuffer3ub, sizeof(ColorCompType) * chunkSize * 3);
+			}
+			vbo->release();
+		}
+	}
+
+	QOpenGLFunctions_2_1* glFunc = context.glFunctions<QOpenGLFunctions_2_1>();
+	if (glFunc)
+	{
+		CatchGLErrors(glFunc->glGetError(), "ccPointCloud::convertSFToVBOColors");
+	}
+}
+
 int ccPointCloud::VBO::init(int count, bool withColors, bool withNormals, bool* reallocated/*=0*/)
 {
 	//required memory
@@ -4863,8 +5463,9 @@ int ccPointCloud::VBO::init(int count, bool withColors, bool withNormals, bool*
 	}
 	if (withNormals)
 	{
+		//compressed normals
 		normalShift = totalSizeBytes;
-		totalSizeBytes += sizeof(PointCoordinateType) * count * 3;
+		totalSizeBytes += sizeof(CompressedNormType) * count;
 	}
 
 	if (!isCreated())
@@ -4912,6 +5513,9 @@ int ccPointCloud::VBO::init(int count, bool withColors, bool withNormals, bool*
 
 void ccPointCloud::releaseVBOs()
 {
+	//this method is called each time the data to display is modified
+	++m_vboManager.dataVersion;
+
 	if (m_vboManager.state == vboSet::NEW)
 		return;
 
@@ -5422,6 +6026,48 @@ void ccPointCloud::clearLOD()
 	}
 }
 
+ccOctree::Shared ccPointCloud::getPickingOctree() const
+{
+	ccOctree::Shared octree = getOctree();
+	if (!octree && m_lod && m_lod->isInitialized())
+	{
+		octree = m_lod->octree();
+	}
+	return octree;
+}
+
+bool ccPointCloud::computePickingOctreeInBackground()
+{
+	if (size() == 0 || getOctree())
+	{
+		return false;
+	}
+
+	if (m_lod && !m_lod->isNull())
+	{
+		//already computed, under construction or broken
+		return !m_lod->isBroken();
+	}
+
+	return initLOD();
+}
+
+ccOctree::Shared ccPointCloud::computeOctree(CCLib::GenericProgressCallback* progressCb/*=0*/, bool autoAddChild/*=true*/)
+{
+	//the LOD structure may have already computed one
+	if (m_lod && m_lod->isInitialized())
+	{
+		ccOctree::Shared octree = m_lod->octree();
+		if (octree && octree->getNumberOfProjectedPoints() == size())
+		{
+			setOctree(octree, autoAddChild);
+			return octree;
+		}
+	}
+
+	return ccGenericPointCloud::computeOctree(progressCb, autoAddChild);
+}
+
 void ccPointCloud::clearFWFData()
 {
 	m_fwfWaveforms.clear();
@@ -40,6 +40,7 @@ class ccMesh;
 class QGLBuffer;
 class ccProgressDialog;
 class ccPointCloudLOD;
+class ccNormalDecodeShader;
 
 /***************************************************
 				ccPointCloud
@@ -441,7 +442,7 @@ public: //other methods
 	virtual const ColorCompType* getPointColor(unsigned pointIndex) const override;
 	virtual const CompressedNormType& getPointNormalIndex(unsigned pointIndex) const override;
 	virtual const CCVector3& getPointNormal(unsigned pointIndex) const override;
-	CCLib::ReferenceCloud* crop(const ccBBox& box, bool inside = true) override;
+	CCLib::ReferenceCloud* crop(const ccBBox& box, bool inside = true, CCLib::GenericProgressCallback* progressCb = 0) override;
 	virtual void scale(PointCoordinateType fx, PointCoordinateType fy, PointCoordinateType fz, CCVector3 center = CCVector3(0,0,0)) override;
 	/** \warning if removeSelectedPoints is true, any attached octree will be deleted. **/
 	virtual ccGenericPointCloud* createNewCloudFromVisibilitySelection(bool removeSelectedPoints = false, VisibilityTableType* visTable = 0) override;
@@ -663,9 +664,10 @@ public: //other methods
 		\param poly croping polyline
 		\param orthoDim dimension orthogonal to the plane in which the segmentation should occur (X=0, Y=1, Z=2)
 		\param inside whether selected points are inside or outside the polyline
+		\param progressCb optional progress callback (the process can then be cancelled)
 		\return points falling inside (or outside) as a selection
 	**/
-	CCLib::ReferenceCloud* crop2D(const ccPolyline* poly, unsigned char orthoDim, bool inside = true);
+	CCLib::ReferenceCloud* crop2D(const ccPolyline* poly, unsigned char orthoDim, bool inside = true, CCLib::GenericProgressCallback* progressCb = 0);
 
 	//! Appends a cloud to this one
 	/** Same as the += operator with pointCountBefore == size()
@@ -719,6 +721,15 @@ protected:
 	**/
 	bool m_visibilityCheckEnabled;
 
+public: //display data
+
+	//! Returns a counter incremented each time the data to display is modified
+	/** I.e. the coordinates, the colors or the normals. Entities displaying this
+		data by themselves (e.g. meshes) can use it to know when their own VBOs
+		must be updated.
+	**/
+	unsigned getDisplayDataVersion() const { return m_vboManager.dataVersion; }
+
 protected: // VBO
 
 	//! Init/updates VBOs
@@ -767,6 +778,7 @@ protected: // VBO
 			, totalMemSizeBytes(0)
 			, updateFlags(0)
 			, state(NEW)
+			, dataVersion(0)
 		{}
 
 		std::vector<VBO*> vbos;
@@ -779,6 +791,9 @@ protected: // VBO
 
 		//! Current state
 		STATES state;
+
+		//! Display data version (see ccPointCloud::getDisplayDataVersion)
+		unsigned dataVersion;
 	};
 
 	//! Set of VBOs attached to this cloud
@@ -789,6 +804,11 @@ protected: // VBO
 	void glChunkColorPointer (const CC_DRAW_CONTEXT& context, unsigned chunkIndex, unsigned decimStep, bool useVBOs);
 	void glChunkSFPointer    (const CC_DRAW_CONTEXT& context, unsigned chunkIndex, unsigned decimStep, bool useVBOs);
 	void glChunkNormalPointer(const CC_DRAW_CONTEXT& context, unsigned chunkIndex, unsigned decimStep, bool useVBOs);
+	//! Sends the compressed normals to the GPU (to be decoded by the shader)
+	void glChunkNormalCodePointer(const CC_DRAW_CONTEXT& context, ccNormalDecodeShader* shader, unsigned chunkIndex, unsigned decimStep, bool useVBOs);
+
+	//! Converts the displayed scalar field values to colors directly in the VBOs (multi-threaded)
+	void convertSFToVBOColors(const CC_DRAW_CONTEXT& context, const std::vector<unsigned>& chunkIndexes);
 
 public: //Level of Detail (LOD)
 
@@ -800,6 +820,26 @@ public: //Level of Detail (LOD)
 	//! Clears the LOD structure
 	void clearLOD();
 
+	//! Returns the associated octree or the octree of the LOD structure (if ready)
+	virtual ccOctree::Shared getPickingOctree() const override;
+
+	//! Starts computing the LOD structure (and its octree) in the background (if necessary)
+	virtual bool computePickingOctreeInBackground() override;
+
+	//! Computes the cloud octree
+	/** Reuses the octree of the LOD structure if it is ready.
+	**/
+	virtual ccOctree::Shared computeOctree(CCLib::GenericProgressCallback* progressCb = 0, bool autoAddChild = true) override;
+
+	//! Sets whether the LOD structure (and its octree) should be saved with the clouds in BIN files
+	/** Disabled by default: the octree codes and the LOD nodes take around
+		12 bytes per point, i.e. as much as the points themselves.
+	**/
+	static void SetLODSavedWithCloud(bool state);
+
+	//! Returns whether the LOD structure (and its octree) is saved with the clouds in BIN files
+	static bool IsLODSavedWithCloud();
+
 protected: //Level of Detail (LOD)
 
 	//! L.O.D. structure
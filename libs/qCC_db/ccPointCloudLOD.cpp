@@ -19,10 +19,18 @@
 
 //Local
 #include "ccPointCloud.h"
+#include "ccGenericGLDisplay.h"
 
 //Qt
 #include <QThread>
 #include <QElapsedTimer>
+#include <QFile>
+
+//system
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string.h>
 
 //! Thread for background computation
 //̨ڼ߳
@@ -49,121 +57,249 @@ public:
 
 protected:
 
-	//! Fills a node (and returns its relative position) + recursive
-	uint8_t fillNode(ccPointCloudLOD::Node& node) const
+	typedef ccPointCloudLOD::Node Node;
+	typedef std::vector<Node> NodeVector;
+
+	//! Subtree (built independently from the others)
+	struct SubTree
+	{
+		//! Default constructor
+		SubTree(uint8_t _rootLevel = 0, int32_t _rootIndex = 0)
+			: rootLevel(_rootLevel)
+			, rootIndex(_rootIndex)
+			, failed(false)
+		{}
+
+		//! Level of the root node (in the LOD structure)
+		uint8_t rootLevel;
+		//! Index of the root node (in the LOD structure)
+		int32_t rootIndex;
+		//! Nodes per level (the root node is the single node of level 'rootLevel')
+		/** Child indexes are local to this subtree.
+		**/
+		std::vector<NodeVector> levels;
+		//! Whether the construction has failed (not enough memory)
+		bool failed;
+	};
+
+	//! Returns the index of the first code after the cell (at a given level) starting at 'firstCodeIndex'
+	uint32_t cellEnd(uint32_t firstCodeIndex, uint32_t lastCodeIndex, unsigned char level) const
 	{
 		const ccOctree::cellsContainer& cellCodes = m_octree->pointsAndTheirCellCodes();
-		const unsigned char bitDec = CCLib::DgmOctree::GET_BIT_SHIFT(node.level);
-		const CCLib::DgmOctree::CellCode currentTruncatedCellCode = (cellCodes[node.firstCodeIndex].theCode >> bitDec);
+		const unsigned char bitDec = CCLib::DgmOctree::GET_BIT_SHIFT(level);
+		const CCLib::DgmOctree::CellCode truncatedCellCode = (cellCodes[firstCodeIndex].theCode >> bitDec);
+
+		//the codes are sorted: no need to scan the points
+		ccOctree::cellsContainer::const_iterator it = std::upper_bound(	cellCodes.begin() + firstCodeIndex,
+																		cellCodes.begin() + lastCodeIndex,
+																		truncatedCellCode,
+																		[bitDec](CCLib::DgmOctree::CellCode code, const CCLib::DgmOctree::IndexAndCode& ic) { return code < (ic.theCode >> bitDec); });
 
-		//first count the number of points and compute their center
+		return static_cast<uint32_t>(it - cellCodes.begin());
+	}
+
+	//! Creates the children of a node (appended to 'childLevel')
+	void subdivide(Node& node, NodeVector& childLevel) const
+	{
+		const ccOctree::cellsContainer& cellCodes = m_octree->pointsAndTheirCellCodes();
+		const unsigned char childLevelIndex = node.level + 1;
+		const unsigned char bitDec = CCLib::DgmOctree::GET_BIT_SHIFT(childLevelIndex);
+		const uint32_t lastCodeIndex = node.firstCodeIndex + node.pointCount;
+
+		for (uint32_t i = node.firstCodeIndex; i < lastCodeIndex; )
 		{
-			node.pointCount = 0;
-#ifdef COMPUTE_REAL_RADIUS
-			CCVector3d sumP(0, 0, 0);
-#else //otherwise we use the bounding box
-			ccBBox bbox;
-#endif
-			for (uint32_t codeIndex = node.firstCodeIndex; codeIndex < cellCodes.size() && (cellCodes[codeIndex].theCode >> bitDec) == currentTruncatedCellCode; ++codeIndex)
-			{
-				++node.pointCount;
-				const CCVector3* P = m_cloud.getPoint(cellCodes[codeIndex].theIndex);
-#ifdef COMPUTE_REAL_RADIUS
-				sumP += CCVector3d::fromArray(P->u);
-#else
-				bbox.add(*P);
-#endif
+			Node childNode(childLevelIndex);
+			childNode.firstCodeIndex = i;
+			uint32_t childEnd = cellEnd(i, lastCodeIndex, childLevelIndex);
+			childNode.pointCount = childEnd - i;
+
+			uint8_t childPos = static_cast<uint8_t>((cellCodes[i].theCode >> bitDec) & 7);
+			childLevel.push_back(childNode);
+			node.childIndexes[childPos] = static_cast<int32_t>(childLevel.size()) - 1;
+			node.childCount++;
+
+			i = childEnd;
+		}
+	}
+
+	//! Subdivides the leaf nodes of a subtree with more than 'maxCount' points (down to 'lastLevel')
+	void subdivideLeaves(SubTree& subTree, uint32_t maxCount, uint8_t lastLevel) const
+	{
+		for (uint8_t currentLevel = subTree.rootLevel; currentLevel < lastLevel; ++currentLevel)
+		{
+			NodeVector& level = subTree.levels[currentLevel];
+			if (level.empty())
+			{
+				break;
 			}
 
-			//compute the radius
-#ifdef COMPUTE_REAL_RADIUS
-			if (node.pointCount > 1)
+			for (Node& node : level)
 			{
-				sumP /= node.pointCount;
-				double maxSquareRadius = 0;
-				for (uint32_t i = 0; i < node.pointCount; ++i)
+				if (node.childCount == 0 && node.pointCount > maxCount)
 				{
-					const CCVector3* P = m_cloud.getPoint(cellCodes[node.firstCodeIndex + i].theIndex);
-					double squareRadius = (CCVector3d::fromArray(P->u) - sumP).norm2();
-					if (squareRadius > maxSquareRadius)
-					{
-						maxSquareRadius = squareRadius;
-					}
+					subdivide(node, subTree.levels[currentLevel + 1]);
 				}
-				node.radius = static_cast<float>(sqrt(maxSquareRadius));
 			}
-			//update the center
-			node.center = CCVector3f::fromArray(sumP.u);
-#else
-			if (node.pointCount > 1)
+		}
+	}
+
+	//! Computes the bounding sphere of a leaf node (from its points)
+	void computeLeafSphere(Node& node) const
+	{
+		const ccOctree::cellsContainer& cellCodes = m_octree->pointsAndTheirCellCodes();
+
+		CCVector3d sumP(0, 0, 0);
+		for (uint32_t i = 0; i < node.pointCount; ++i)
+		{
+			const CCVector3* P = m_cloud.getPoint(cellCodes[node.firstCodeIndex + i].theIndex);
+			sumP += CCVector3d::fromArray(P->u);
+		}
+
+		//compute the radius
+		if (node.pointCount > 1)
+		{
+			sumP /= node.pointCount;
+			double maxSquareRadius = 0;
+			for (uint32_t i = 0; i < node.pointCount; ++i)
 			{
-				node.radius = static_cast<float>(bbox.getDiagNormd());
+				const CCVector3* P = m_cloud.getPoint(cellCodes[node.firstCodeIndex + i].theIndex);
+				double squareRadius = (CCVector3d::fromArray(P->u) - sumP).norm2();
+				if (squareRadius > maxSquareRadius)
+				{
+					maxSquareRadius = squareRadius;
+				}
 			}
-			node.center = CCVector3f::fromArray(bbox.getCenter().u);
-#endif
+			node.radius = static_cast<float>(sqrt(maxSquareRadius));
 		}
 
-		//do we need to subdivide this cell?
-		if (node.pointCount > m_maxCountPerCell && node.level + 1 <= m_maxLevel)
+		node.center = CCVector3f::fromArray(sumP.u);
+	}
+
+	//! Computes the bounding sphere of a node from the spheres of its children
+	/** The center is the barycenter of the points (as for the leaves).
+	**/
+	static void mergeChildSpheres(Node& node, const NodeVector& childLevel)
+	{
+		CCVector3d sumC(0, 0, 0);
+		for (int i = 0; i < 8; ++i)
 		{
-			for (uint32_t i = 0; i < node.pointCount; )
+			if (node.childIndexes[i] >= 0)
 			{
-				int32_t childNodeIndex = m_lod.newCell(node.level + 1);
-				ccPointCloudLOD::Node& childNode = m_lod.node(childNodeIndex, node.level + 1);
-				childNode.firstCodeIndex = node.firstCodeIndex + i;
+				const Node& childNode = childLevel[node.childIndexes[i]];
+				sumC += CCVector3d::fromArray(childNode.center.u) * childNode.pointCount;
+			}
+		}
+		CCVector3d C = sumC / node.pointCount;
 
-				uint8_t childIndex = fillNode(childNode);
-				node.childIndexes[childIndex] = childNodeIndex;
-				node.childCount++;
-				i += childNode.pointCount;
+		double radius = 0;
+		for (int i = 0; i < 8; ++i)
+		{
+			if (node.childIndexes[i] >= 0)
+			{
+				const Node& childNode = childLevel[node.childIndexes[i]];
+				double childRadius = (CCVector3d::fromArray(childNode.center.u) - C).norm() + childNode.radius;
+				if (childRadius > radius)
+				{
+					radius = childRadius;
+				}
 			}
 		}
 
-		//return the node relative position
-		return static_cast<uint8_t>(currentTruncatedCellCode & 7);
+		node.center = CCVector3f::fromArray(C.u);
+		node.radius = static_cast<float>(radius);
 	}
 
-	//! Fills a node (and returns its relative position)
-	uint8_t fillNode_flat(ccPointCloudLOD::Node& node) const
+	//! Computes the bounding spheres of all the nodes of a subtree (leaves first)
+	void computeSpheres(SubTree& subTree) const
 	{
-		const ccOctree::cellsContainer& cellCodes = m_octree->pointsAndTheirCellCodes();
-		const unsigned char bitDec = CCLib::DgmOctree::GET_BIT_SHIFT(node.level);
-		const CCLib::DgmOctree::CellCode currentTruncatedCellCode = (cellCodes[node.firstCodeIndex].theCode >> bitDec);
+		for (size_t l = subTree.levels.size(); l > subTree.rootLevel; --l)
+		{
+			NodeVector& level = subTree.levels[l - 1];
+			for (Node& node : level)
+			{
+				if (node.childCount == 0)
+				{
+					computeLeafSphere(node);
+				}
+				else
+				{
+					mergeChildSpheres(node, subTree.levels[l]);
+				}
+			}
+		}
+	}
 
-		//first count the number of points and compute their center
+	//! Returns the number of cells per level (for the whole structure)
+	std::vector<size_t> cellCountPerLevel(const std::vector<SubTree>& subTrees) const
+	{
+		std::vector<size_t> cellCounts(m_lod.m_levels.size(), 0);
+		for (size_t l = 0; l < cellCounts.size(); ++l)
 		{
-			node.pointCount = 0;
-			CCVector3d sumP(0, 0, 0);
-			for (uint32_t codeIndex = node.firstCodeIndex; codeIndex < cellCodes.size() && (cellCodes[codeIndex].theCode >> bitDec) == currentTruncatedCellCode; ++codeIndex)
+			cellCounts[l] = m_lod.m_levels[l].data.size();
+		}
+		for (const SubTree& subTree : subTrees)
+		{
+			for (size_t l = subTree.rootLevel + 1; l < subTree.levels.size(); ++l)
 			{
-				++node.pointCount;
-				const CCVector3* P = m_cloud.getPoint(cellCodes[codeIndex].theIndex);
-				sumP += CCVector3d::fromArray(P->u);
+				cellCounts[l] += subTree.levels[l].size();
+			}
+		}
+		return cellCounts;
+	}
+
+	//! Moves the nodes of the subtrees in the LOD structure
+	void mergeSubTrees(std::vector<SubTree>& subTrees)
+	{
+		std::vector<size_t> levelSizes = cellCountPerLevel(subTrees);
+		for (size_t l = 0; l < levelSizes.size(); ++l)
+		{
+			m_lod.m_levels[l].data.reserve(levelSizes[l]);
+		}
+
+		for (SubTree& subTree : subTrees)
+		{
+			//position of the subtree nodes in each level
+			std::vector<int32_t> offsets(subTree.levels.size(), 0);
+			for (size_t l = subTree.rootLevel + 1u; l < subTree.levels.size(); ++l)
+			{
+				offsets[l] = static_cast<int32_t>(m_lod.m_levels[l].data.size());
 			}
 
-			//compute the radius
-			if (node.pointCount > 1)
+			for (size_t l = subTree.rootLevel; l < subTree.levels.size(); ++l)
 			{
-				sumP /= node.pointCount;
-				double maxSquareRadius = 0;
-				for (uint32_t i = 0; i < node.pointCount; ++i)
+				NodeVector& level = subTree.levels[l];
+
+				//the child indexes must now refer to the whole structure
+				if (l + 1 < subTree.levels.size())
 				{
-					const CCVector3* P = m_cloud.getPoint(cellCodes[node.firstCodeIndex + i].theIndex);
-					double squareRadius = (CCVector3d::fromArray(P->u) - sumP).norm2();
-					if (squareRadius > maxSquareRadius)
+					for (Node& node : level)
 					{
-						maxSquareRadius = squareRadius;
+						if (node.childCount)
+						{
+							for (int i = 0; i < 8; ++i)
+							{
+								if (node.childIndexes[i] >= 0)
+								{
+									node.childIndexes[i] += offsets[l + 1];
+								}
+							}
+						}
 					}
 				}
-				node.radius = static_cast<float>(sqrt(maxSquareRadius));
+
+				if (l == subTree.rootLevel)
+				{
+					m_lod.m_levels[l].data[subTree.rootIndex] = level.front();
+				}
+				else
+				{
+					m_lod.m_levels[l].data.insert(m_lod.m_levels[l].data.end(), level.begin(), level.end());
+				}
 			}
 
-			//update the center
-			node.center = CCVector3f::fromArray(sumP.u);
+			//release the memory as soon as possible
+			std::vector<NodeVector>().swap(subTree.levels);
 		}
-
-		//return the node relative position
-		return static_cast<uint8_t>(currentTruncatedCellCode & 7);
 	}
 
 	//reimplemented from QThread
@@ -184,7 +320,7 @@ protected:
 		QElapsedTimer timer;
 		timer.start();
 
-		//first we need an octree
+		//first we need an octree (we reuse the cloud's one if any)
 		m_octree = m_cloud.getOctree();
 		if (!m_octree)
 		{
@@ -197,10 +333,9 @@ protected:
 				return;
 			}
 
-			if (!m_cloud.getOctree()) //be sure that it hasn't been built in the meantime!
-			{
-				m_cloud.setOctree(m_octree);
-			}
+			//we don't attach the octree to the cloud here, as it would modify the DB tree
+			//from this thread. It is used for picking (see ccPointCloud::getPickingOctree) and
+			//attached later by the main thread if necessary (see ccPointCloud::computeOctree).
 		}
 
 		//init LoD structure
@@ -213,142 +348,161 @@ protected:
 		}
 
 		//make sure we deprecate the LOD structure when this octree is modified!
-		QObject::connect(m_octree.data(), &ccOctree::updated, [&]() { m_cloud.clearLOD(); });
+		m_lod.watchOctree(&m_cloud);
 
 		m_maxLevel = static_cast<uint8_t>(std::max<size_t>(1, m_lod.m_levels.size())) - 1;
 		assert(m_maxLevel <= CCLib::DgmOctree::MAX_OCTREE_LEVEL);
 
-#if 0 //recursive path
-		//recursive
-		fillNode(m_lod.root());
+		//the codes are sorted, so the points of each cell are contiguous: the cells are
+		//split by binary search, and the bounding spheres are computed from the points
+		//(leaves) or from the children spheres (other nodes) in a single bottom-up pass
 
-		m_lod.shrink_to_fit();
-		//m_lod.updateMaxRadii();
-		//m_lod.setMaxLevel(m_maxLevel);
+		//the first levels are built sequentially, then each remaining leaf cell
+		//is the root of a subtree that is built independently (in parallel)
+		static const uint8_t s_subTreeLevel = 3;
+		const uint8_t topLevel = std::min<uint8_t>(s_subTreeLevel, m_maxLevel > 1 ? m_maxLevel - 1 : 0);
 
-		for (size_t i = 1; i < m_lod.m_levels.size(); ++i)
+		std::vector<SubTree> subTrees;
+		try
 		{
-			ccLog::Print(QString("[LoD] Level %1: %2 cells").arg(i).arg(m_lod.m_levels[i].data.size()));
-		}
-
-#else //layer by layer
+			Node& root = m_lod.root();
+			root.firstCodeIndex = 0;
+			root.pointCount = static_cast<uint32_t>(m_octree->pointsAndTheirCellCodes().size());
 
-		//init with root node
-		fillNode_flat(m_lod.root());
-
-		//first we allow the division of nodes as deep as possible but with a minimum number of points per cell
-		for (uint8_t currentLevel = 0; currentLevel < m_maxLevel; ++currentLevel)
-		{
-			ccPointCloudLOD::Level& level = m_lod.m_levels[currentLevel];
-			if (level.data.empty())
+			//we allow the division of nodes as deep as possible but with a minimum number of points per cell
+			for (uint8_t currentLevel = 0; currentLevel < topLevel; ++currentLevel)
 			{
-				break;
+				for (Node& node : m_lod.m_levels[currentLevel].data)
+				{
+					if (node.pointCount > m_maxCountPerCell)
+					{
+						subdivide(node, m_lod.m_levels[currentLevel + 1].data);
+					}
+				}
 			}
 
-			//update maxRadius for the previous level
-			//{
-			//	float maxRadius = 0;
-			//	for (ccPointCloudLOD::Node& n : level.data)
-			//	{
-			//		if (n.radius > maxRadius)
-			//		{
-			//			maxRadius = n.radius;
-			//		}
-			//	}
-			//	level.maxRadius = maxRadius;
-			//}
-
-			//the previous level is now ready!
-			ccLog::Print(QString("[LoD] Level %1: %2 cells").arg(currentLevel).arg(level.data.size()));
-
-			//now we can create the next level
-			if (currentLevel + 1 < m_maxLevel)
+			for (uint8_t currentLevel = 0; currentLevel <= topLevel; ++currentLevel)
 			{
-				for (ccPointCloudLOD::Node& node : level.data)
+				const NodeVector& level = m_lod.m_levels[currentLevel].data;
+				for (size_t i = 0; i < level.size(); ++i)
 				{
-					//do we need to subdivide this cell?
-					if (node.pointCount > m_maxCountPerCell)
+					if (level[i].childCount == 0)
 					{
-						for (uint32_t i = 0; i < node.pointCount;)
-						{
-							int32_t childNodeIndex = m_lod.newCell(node.level + 1);
-							ccPointCloudLOD::Node& childNode = m_lod.node(childNodeIndex, node.level + 1);
-							childNode.firstCodeIndex = node.firstCodeIndex + i;
-
-							uint8_t childIndex = fillNode_flat(childNode);
-							node.childIndexes[childIndex] = childNodeIndex;
-							node.childCount++;
-							i += childNode.pointCount;
-						}
+						SubTree subTree(currentLevel, static_cast<int32_t>(i));
+						subTree.levels.resize(m_maxLevel + 1);
+						subTree.levels[currentLevel].push_back(level[i]);
+						subTrees.push_back(subTree);
 					}
 				}
 			}
 		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			ccLog::Warning(QString("[LoD] Failed to compute LOD structure on cloud '%1' (not enough memory)").arg(m_cloud.getName()));
+			m_lod.setState(ccPointCloudLOD::BROKEN);
+			return;
+		}
 
-		m_lod.shrink_to_fit();
-		m_maxLevel = static_cast<uint8_t>(std::max<size_t>(1, m_lod.m_levels.size())) - 1;
+		//first pass (same rule as above)
+		int subTreeCount = static_cast<int>(subTrees.size());
+#if defined(_OPENMP)
+		#pragma omp parallel for schedule(dynamic)
+#endif
+		for (int i = 0; i < subTreeCount; ++i)
+		{
+			try
+			{
+				subdivideLeaves(subTrees[i], m_maxCountPerCell, static_cast<uint8_t>(m_maxLevel - 1));
+			}
+			catch (const std::bad_alloc&)
+			{
+				subTrees[i].failed = true;
+			}
+		}
 
-		//refinement step
-		if (true)
+		//we look at the 'main' depth level (with the most cells)
+		uint8_t biggestLevel = 0;
+		std::vector<size_t> cellCounts = cellCountPerLevel(subTrees);
 		{
-			//we look at the 'main' depth level (with the most point)
-			uint8_t biggestLevel = 0;
-			for (uint8_t i = 1; i <= m_maxLevel; ++i)
+			for (uint8_t currentLevel = 0; currentLevel < cellCounts.size() && cellCounts[currentLevel] != 0; ++currentLevel)
 			{
-				if (m_lod.m_levels[i].data.size() > m_lod.m_levels[biggestLevel].data.size())
+				ccLog::Print(QString("[LoD] Level %1: %2 cells").arg(currentLevel).arg(cellCounts[currentLevel]));
+				if (cellCounts[currentLevel] > cellCounts[biggestLevel])
 				{
-					biggestLevel = i;
+					biggestLevel = currentLevel;
 				}
 			}
+			biggestLevel = std::min<uint8_t>(biggestLevel, 10);
+		}
+
+		//refinement step: we divide again the cells (with a lower limit on the number of points)
+		//then we compute the bounding spheres
+#if defined(_OPENMP)
+		#pragma omp parallel for schedule(dynamic)
+#endif
+		for (int i = 0; i < subTreeCount; ++i)
+		{
+			if (subTrees[i].failed)
+			{
+				continue;
+			}
 
-			//now compute the mean radius for this level
-			//double meanRadius = 0;
-			//{
-			//	const ccPointCloudLOD::Level& level = m_lod.m_levels[biggestLevel];
-			//	size_t cellCount = level.data.size();
-			//	for (size_t i = 0; i < cellCount; ++i)
-			//	{
-			//		meanRadius += level.data[i].radius;
-			//	}
+			try
+			{
+				subdivideLeaves(subTrees[i], 16, biggestLevel);
+				computeSpheres(subTrees[i]);
+			}
+			catch (const std::bad_alloc&)
+			{
+				subTrees[i].failed = true;
+			}
+		}
 
-			//	meanRadius /= cellCount;
-			//}
+		for (const SubTree& subTree : subTrees)
+		{
+			if (subTree.failed)
+			{
+				ccLog::Warning(QString("[LoD] Failed to compute LOD structure on cloud '%1' (not enough memory)").arg(m_cloud.getName()));
+				m_lod.setState(ccPointCloudLOD::BROKEN);
+				return;
+			}
+		}
 
-			//and divide again the cells (with a lower limit on the number of points)
-			biggestLevel = std::min<uint8_t>(biggestLevel, 10);
-			for (uint8_t currentLevel = 0; currentLevel < biggestLevel; ++currentLevel)
+		{
+			std::vector<size_t> cellCountsAfter = cellCountPerLevel(subTrees);
+			for (uint8_t currentLevel = 1; currentLevel <= biggestLevel; ++currentLevel)
 			{
-				ccPointCloudLOD::Level& level = m_lod.m_levels[currentLevel];
-				assert(!level.data.empty());
+				ccLog::Print(QString("[LoD][pass 2] Level %1: %2 cells (+%3)").arg(currentLevel).arg(cellCountsAfter[currentLevel]).arg(cellCountsAfter[currentLevel] - cellCounts[currentLevel]));
+			}
+		}
 
-				size_t cellCountBefore = m_lod.m_levels[currentLevel + 1].data.size();
-				for (ccPointCloudLOD::Node& node : level.data)
+		try
+		{
+			mergeSubTrees(subTrees);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			ccLog::Warning(QString("[LoD] Failed to compute LOD structure on cloud '%1' (not enough memory)").arg(m_cloud.getName()));
+			m_lod.setState(ccPointCloudLOD::BROKEN);
+			return;
+		}
+
+		//eventually we compute the spheres of the first levels
+		for (uint8_t currentLevel = topLevel; currentLevel > 0; --currentLevel)
+		{
+			for (Node& node : m_lod.m_levels[currentLevel - 1].data)
+			{
+				if (node.childCount)
 				{
-					//do we need to subdivide this cell?
-					if (node.childCount == 0 && node.pointCount > 16)
-					{
-						for (uint32_t i = 0; i < node.pointCount;)
-						{
-							int32_t childNodeIndex = m_lod.newCell(node.level + 1);
-							ccPointCloudLOD::Node& childNode = m_lod.node(childNodeIndex, node.level + 1);
-							childNode.firstCodeIndex = node.firstCodeIndex + i;
-
-							uint8_t childIndex = fillNode_flat(childNode);
-							node.childIndexes[childIndex] = childNodeIndex;
-							node.childCount++;
-							i += childNode.pointCount;
-						}
-					}
+					mergeChildSpheres(node, m_lod.m_levels[currentLevel].data);
 				}
-
-				size_t cellCountAfter = m_lod.m_levels[currentLevel + 1].data.size();
-				ccLog::Print(QString("[LoD][pass 2] Level %1: %2 cells (+%3)").arg(currentLevel + 1).arg(cellCountAfter).arg(cellCountAfter - cellCountBefore));
 			}
-
-			m_lod.shrink_to_fit();
-			m_maxLevel = static_cast<uint8_t>(std::max<size_t>(1, m_lod.m_levels.size())) - 1;
 		}
-#endif
+
+		m_lod.shrink_to_fit();
+		m_maxLevel = static_cast<uint8_t>(std::max<size_t>(1, m_lod.m_levels.size())) - 1;
 
 		m_lod.setState(ccPointCloudLOD::INITIALIZED);
 
@@ -466,6 +620,222 @@ bool ccPointCloudLOD::initInternal(ccOctree::Shared octree)
 	return true;
 }
 
+void ccPointCloudLOD::watchOctree(ccPointCloud* cloud)
+{
+	QObject::disconnect(m_octreeConnection);
+
+	if (m_octree && cloud)
+	{
+		m_octreeConnection = QObject::connect(m_octree.data(), &ccOctree::updated, [cloud]() { cloud->clearLOD(); });
+	}
+}
+
+//! Size of a saved node record (the members are saved one by one, without the structure padding)
+static const unsigned c_nodeRecordSize = 4 + 4 + 12 + 32 + 4 + 4 + 1 + 1 + 1;
+//! Number of node records written or read at once
+static const uint32_t c_nodeRecordsPerBlock = 256;
+
+//! Writes a node record
+static void WriteNodeRecord(const ccPointCloudLOD::Node& node, char* record)
+{
+	memcpy(record, &node.pointCount, 4);				record += 4;
+	memcpy(record, &node.radius, 4);					record += 4;
+	memcpy(record, node.center.u, 12);					record += 12;
+	memcpy(record, node.childIndexes.data(), 32);		record += 32;
+	memcpy(record, &node.firstCodeIndex, 4);			record += 4;
+	memcpy(record, &node.displayedPointCount, 4);		record += 4;
+	*record++ = static_cast<char>(node.level);
+	*record++ = static_cast<char>(node.childCount);
+	*record++ = static_cast<char>(node.intersection);
+}
+
+//! Reads a node record
+static void ReadNodeRecord(const char* record, ccPointCloudLOD::Node& node)
+{
+	memcpy(&node.pointCount, record, 4);				record += 4;
+	memcpy(&node.radius, record, 4);					record += 4;
+	memcpy(node.center.u, record, 12);					record += 12;
+	memcpy(node.childIndexes.data(), record, 32);		record += 32;
+	memcpy(&node.firstCodeIndex, record, 4);			record += 4;
+	memcpy(&node.displayedPointCount, record, 4);		record += 4;
+	node.level = static_cast<uint8_t>(*record++);
+	node.childCount = static_cast<uint8_t>(*record++);
+	node.intersection = static_cast<uint8_t>(*record++);
+}
+
+bool ccPointCloudLOD::toFile(QFile& out)
+{
+	QMutexLocker locker(&m_mutex);
+
+	if (m_state != INITIALIZED || !m_octree)
+	{
+		assert(false);
+		return false;
+	}
+
+	//we write the block size first (so that it can be skipped if it can't be used)
+	qint64 blockSizePos = out.pos();
+	uint64_t blockSize = 0;
+	if (out.write((const char*)&blockSize, 8) < 0)
+		return false;
+
+	uint32_t nodeSize = c_nodeRecordSize;
+	if (out.write((const char*)&nodeSize, 4) < 0)
+		return false;
+
+	//octree
+	if (!m_octree->toFile(out))
+		return false;
+
+	//nodes
+	char buffer[c_nodeRecordsPerBlock * c_nodeRecordSize];
+	uint8_t levelCount = static_cast<uint8_t>(m_levels.size());
+	if (out.write((const char*)&levelCount, 1) < 0)
+		return false;
+	for (const Level& level : m_levels)
+	{
+		uint32_t nodeCount = static_cast<uint32_t>(level.data.size());
+		if (out.write((const char*)&nodeCount, 4) < 0)
+			return false;
+		for (uint32_t first = 0; first < nodeCount; first += c_nodeRecordsPerBlock)
+		{
+			uint32_t count = std::min(c_nodeRecordsPerBlock, nodeCount - first);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				WriteNodeRecord(level.data[first + i], buffer + i * c_nodeRecordSize);
+			}
+			if (out.write(buffer, static_cast<qint64>(count) * c_nodeRecordSize) < 0)
+				return false;
+		}
+	}
+
+	//eventually we update the block size
+	qint64 blockEndPos = out.pos();
+	blockSize = static_cast<uint64_t>(blockEndPos - blockSizePos - 8);
+	if (	!out.seek(blockSizePos)
+		||	out.write((const char*)&blockSize, 8) < 0
+		||	!out.seek(blockEndPos))
+		return false;
+
+	return true;
+}
+
+bool ccPointCloudLOD::fromFile(QFile& in, ccPointCloud* cloud)
+{
+	if (!cloud)
+	{
+		assert(false);
+		return false;
+	}
+
+	clear();
+
+	uint64_t blockSize = 0;
+	if (in.read((char*)&blockSize, 8) < 0)
+		return false;
+	qint64 blockEndPos = in.pos() + static_cast<qint64>(blockSize);
+
+	ccOctree::Shared octree(new ccOctree(cloud));
+	std::vector<Level> levels;
+	char buffer[c_nodeRecordsPerBlock * c_nodeRecordSize];
+	bool valid = false;
+	{
+		uint32_t nodeSize = 0;
+		if (in.read((char*)&nodeSize, 4) < 0)
+			return false;
+
+		if (nodeSize == c_nodeRecordSize && octree->fromFile(in))
+		{
+			uint8_t levelCount = 0;
+			if (in.read((char*)&levelCount, 1) < 0)
+				return false;
+
+			valid = (levelCount != 0);
+			try
+			{
+				levels.resize(levelCount);
+				for (Level& level : levels)
+				{
+					uint32_t nodeCount = 0;
+					if (in.read((char*)&nodeCount, 4) < 0)
+						return false;
+					level.data.resize(nodeCount);
+					for (uint32_t first = 0; first < nodeCount; first += c_nodeRecordsPerBlock)
+					{
+						uint32_t count = std::min(c_nodeRecordsPerBlock, nodeCount - first);
+						if (in.read(buffer, static_cast<qint64>(count) * c_nodeRecordSize) < 0)
+							return false;
+						for (uint32_t i = 0; i < count; ++i)
+						{
+							ReadNodeRecord(buffer + i * c_nodeRecordSize, level.data[first + i]);
+						}
+					}
+				}
+			}
+			catch (const std::bad_alloc&)
+			{
+				//not enough memory
+				valid = false;
+			}
+
+			//consistency check
+			const size_t codeCount = octree->pointsAndTheirCellCodes().size();
+			valid = valid
+				&&	levels.size() <= static_cast<size_t>(CCLib::DgmOctree::MAX_OCTREE_LEVEL) + 1
+				&&	levels.front().data.size() == 1
+				&&	levels.front().data.front().pointCount == codeCount
+				&&	octree->getNumberOfProjectedPoints() <= cloud->size();
+
+			//the nodes must only refer to existing codes and children
+			for (size_t l = 0; valid && l < levels.size(); ++l)
+			{
+				const size_t childLevelSize = (l + 1 < levels.size() ? levels[l + 1].data.size() : 0);
+				for (const Node& node : levels[l].data)
+				{
+					unsigned childCount = 0;
+					for (int32_t childIndex : node.childIndexes)
+					{
+						if (childIndex < 0)
+							continue;
+						if (static_cast<size_t>(childIndex) >= childLevelSize)
+						{
+							valid = false;
+							break;
+						}
+						++childCount;
+					}
+
+					if (	!valid
+						||	node.level != l
+						||	node.childCount != childCount
+						||	static_cast<size_t>(node.firstCodeIndex) + node.pointCount > codeCount)
+					{
+						valid = false;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	if (!valid)
+	{
+		ccLog::Warning(QString("[LoD] Saved LoD structure can't be used for cloud '%1' (it will be computed again)").arg(cloud->getName()));
+		//skip the remaining data
+		return in.seek(blockEndPos);
+	}
+
+	m_mutex.lock();
+	m_levels.swap(levels);
+	m_octree = octree;
+	m_state = INITIALIZED;
+	m_mutex.unlock();
+
+	watchOctree(cloud);
+
+	return true;
+}
+
 int32_t ccPointCloudLOD::newCell(unsigned char level)
 {
 	assert(level != 0);
@@ -523,6 +893,8 @@ void ccPointCloudLOD::clear()
 {
 	m_mutex.lock();
 
+	QObject::disconnect(m_octreeConnection);
+
 	if (m_thread)
 	{
 		delete m_thread;
@@ -554,6 +926,188 @@ void ccPointCloudLOD::resetVisibility()
 	}
 }
 
+//! Min radius of a cell on screen (in pixels) to display its children
+static const double c_minNodePixelRadius = 0.75;
+//! Max radius of an occluder cell on screen (in pixels)
+static const double c_maxOccluderPixelRadius = 16.0;
+//! Max number of occluder cells
+static const size_t c_maxOccluderCount = 2048;
+//! Number of points sampled in each occluder cell
+static const uint32_t c_occluderSampleCount = 32;
+//! Size of the occlusion depth buffer cells (in pixels)
+static const int c_depthCellSize = 8;
+//! Min (estimated) number of points per pixel for a depth buffer cell to be considered as opaque
+static const double c_minOpaqueCellDensity = 2.0;
+
+//! Projection of a 3D point (or of a cell center) in the viewport
+struct LODProjection
+{
+	//! Position (relatively to the viewport origin)
+	double x, y;
+	//! Depth (along the viewing direction)
+	double depth;
+	//! Scale (number of pixels per unit at this depth)
+	double scale;
+};
+
+//! Projects a 3D point in the viewport
+/** \return false if the point is behind the camera
+**/
+static bool ProjectInViewport(const ccGLCameraParameters& camera, double X, double Y, double Z, LODProjection& proj)
+{
+	const double* MV = camera.modelViewMat.data();
+	const double* P = camera.projectionMat.data();
+
+	//eye coordinates
+	double ex = MV[0] * X + MV[4] * Y + MV[8]  * Z + MV[12];
+	double ey = MV[1] * X + MV[5] * Y + MV[9]  * Z + MV[13];
+	double ez = MV[2] * X + MV[6] * Y + MV[10] * Z + MV[14];
+
+	//clip coordinates
+	double cx = P[0] * ex + P[4] * ey + P[8]  * ez + P[12];
+	double cy = P[1] * ex + P[5] * ey + P[9]  * ez + P[13];
+	double cw = P[3] * ex + P[7] * ey + P[11] * ez + P[15];
+	if (cw <= 0)
+	{
+		return false;
+	}
+
+	proj.x = (cx / cw + 1.0) / 2 * camera.viewport[2];
+	proj.y = (cy / cw + 1.0) / 2 * camera.viewport[3];
+	proj.depth = -ez;
+	proj.scale = std::abs(P[0]) * camera.viewport[2] / (2 * cw);
+
+	return true;
+}
+
+//! Coarse (software) depth buffer for occlusion culling
+class LODDepthBuffer
+{
+public:
+
+	LODDepthBuffer()
+		: m_width(0)
+		, m_height(0)
+	{}
+
+	//! Builds the depth buffer with a sample of the points of the occluder cells
+	bool build(const ccPointCloudLOD& lod, const std::vector<ccPointCloudLOD::Occluder>& occluders, const ccGLCameraParameters& camera)
+	{
+		const ccOctree::Shared& octree = lod.octree();
+		if (!octree || !octree->associatedCloud() || camera.viewport[2] <= 0 || camera.viewport[3] <= 0)
+		{
+			return false;
+		}
+		CCLib::GenericIndexedCloudPersist* cloud = octree->associatedCloud();
+		const ccOctree::cellsContainer& cellCodes = octree->pointsAndTheirCellCodes();
+
+		m_width = (camera.viewport[2] + c_depthCellSize - 1) / c_depthCellSize;
+		m_height = (camera.viewport[3] + c_depthCellSize - 1) / c_depthCellSize;
+		std::vector<double> coverage;
+		try
+		{
+			m_depth.assign(static_cast<size_t>(m_width) * m_height, 0.0f);
+			coverage.assign(m_depth.size(), 0.0);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			m_width = m_height = 0;
+			m_depth.clear();
+			return false;
+		}
+
+		for (const ccPointCloudLOD::Occluder& occluder : occluders)
+		{
+			const ccPointCloudLOD::Node& node = lod.node(occluder.index, occluder.level);
+			if (node.pointCount == 0)
+			{
+				continue;
+			}
+
+			//each sampled point stands for 'weight' points (of 1 pixel)
+			uint32_t sampleCount = std::min(node.pointCount, c_occluderSampleCount);
+			uint32_t step = node.pointCount / sampleCount;
+			double weight = static_cast<double>(node.pointCount) / sampleCount;
+
+			for (uint32_t i = 0; i < sampleCount; ++i)
+			{
+				const CCVector3* P = cloud->getPoint(cellCodes[node.firstCodeIndex + i * step].theIndex);
+				LODProjection proj;
+				if (!ProjectInViewport(camera, P->x, P->y, P->z, proj))
+				{
+					continue;
+				}
+
+				int ci = static_cast<int>(floor(proj.x / c_depthCellSize));
+				int cj = static_cast<int>(floor(proj.y / c_depthCellSize));
+				if (ci < 0 || ci >= m_width || cj < 0 || cj >= m_height)
+				{
+					continue;
+				}
+
+				//we keep the farthest depth (conservative)
+				size_t k = static_cast<size_t>(cj) * m_width + ci;
+				m_depth[k] = std::max(m_depth[k], static_cast<float>(proj.depth));
+				coverage[k] += weight;
+			}
+		}
+
+		//the cells that are not covered enough can't hide anything
+		const double minCoverage = c_minOpaqueCellDensity * c_depthCellSize * c_depthCellSize;
+		for (size_t k = 0; k < m_depth.size(); ++k)
+		{
+			if (coverage[k] < minCoverage)
+			{
+				m_depth[k] = std::numeric_limits<float>::max();
+			}
+		}
+
+		return true;
+	}
+
+	//! Returns whether a disc (on screen) is entirely hidden or not
+	/** \param proj projected center of the disc
+		\param pixelRadius radius of the disc (in pixels)
+		\param nearDepth depth of the nearest point of the corresponding 3D object
+	**/
+	bool isOccluded(const LODProjection& proj, double pixelRadius, double nearDepth) const
+	{
+		int iMin = std::max(0, static_cast<int>(floor((proj.x - pixelRadius) / c_depthCellSize)));
+		int iMax = std::min(m_width - 1, static_cast<int>(floor((proj.x + pixelRadius) / c_depthCellSize)));
+		int jMin = std::max(0, static_cast<int>(floor((proj.y - pixelRadius) / c_depthCellSize)));
+		int jMax = std::min(m_height - 1, static_cast<int>(floor((proj.y + pixelRadius) / c_depthCellSize)));
+		if (iMin > iMax || jMin > jMax)
+		{
+			//out of the screen (should have been rejected by the frustum test)
+			return false;
+		}
+
+		for (int j = jMin; j <= jMax; ++j)
+		{
+			const float* depth = m_depth.data() + static_cast<size_t>(j) * m_width;
+			for (int i = iMin; i <= iMax; ++i)
+			{
+				if (depth[i] >= nearDepth)
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+protected:
+
+	//! Grid width
+	int m_width;
+	//! Grid height
+	int m_height;
+	//! Depth of each cell (farthest depth of the cell points, or FLT_MAX if the cell is not opaque)
+	std::vector<float> m_depth;
+};
+
 class PointCloudLODVisibilityFlagger
 {
 public:
@@ -565,6 +1119,9 @@ public:
 		, m_frustum(frustum)
 		, m_maxLevel(maxLevel)
 		, m_hasClipPlanes(false)
+		, m_camera(0)
+		, m_depthBuffer(0)
+		, m_collectOccluders(false)
 	{}
 
 	void setClipPlanes(const ccClipPlaneSet& clipPlanes)
@@ -581,6 +1138,47 @@ public:
 		m_hasClipPlanes = !m_clipPlanes.empty();
 	}
 
+	//! Enables the screen-space size culling
+	void setCamera(const ccGLCameraParameters* camera) { m_camera = camera; }
+
+	//! Enables the occlusion culling
+	/** \param depthBuffer depth buffer (can be null if the occluders should only be collected)
+	**/
+	void setOcclusionCulling(const LODDepthBuffer* depthBuffer)
+	{
+		m_depthBuffer = depthBuffer;
+		m_collectOccluders = true;
+	}
+
+	//! Returns the front-most occluders (found during the last call to 'flag')
+	void getOccluders(std::vector<ccPointCloudLOD::Occluder>& occluders, size_t maxCount)
+	{
+		occluders.clear();
+
+		if (m_occluderCandidates.size() > maxCount)
+		{
+			std::nth_element(	m_occluderCandidates.begin(),
+								m_occluderCandidates.begin() + maxCount,
+								m_occluderCandidates.end(),
+								[](const OccluderCandidate& a, const OccluderCandidate& b) { return a.depth < b.depth; });
+			m_occluderCandidates.resize(maxCount);
+		}
+
+		try
+		{
+			occluders.reserve(m_occluderCandidates.size());
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory: no occlusion culling next time
+			return;
+		}
+		for (const OccluderCandidate& candidate : m_occluderCandidates)
+		{
+			occluders.push_back(candidate.occluder);
+		}
+	}
+
 	void propagateFlag(ccPointCloudLOD::Node& node, uint8_t flag)
 	{
 		node.intersection = flag;
@@ -597,7 +1195,7 @@ public:
 		}
 	}
 
-	uint32_t flag(ccPointCloudLOD::Node& node)
+	uint32_t flag(ccPointCloudLOD::Node& node, int32_t nodeIndex, bool lookForOccluders = true)
 	{
 		node.intersection = m_frustum.sphereInFrustum(node.center, node.radius);
 		if (m_hasClipPlanes && node.intersection != Frustum::OUTSIDE)
@@ -624,13 +1222,85 @@ public:
 			}
 		}
 
+		//screen-space size and occlusion culling
+		bool fullyVisible = (node.intersection == Frustum::INSIDE);
+		LODProjection proj;
+		double pixelRadius = 0;
+		bool projected = false;
+		if (m_camera && node.intersection != Frustum::OUTSIDE)
+		{
+			//if the camera is inside the cell (perspective mode), its size on screen is meaningless
+			projected = ProjectInViewport(*m_camera, node.center.x, node.center.y, node.center.z, proj)
+						&& (!m_camera->perspective || proj.depth > node.radius);
+			if (projected)
+			{
+				pixelRadius = node.radius * proj.scale;
+				if (m_depthBuffer && m_depthBuffer->isOccluded(proj, pixelRadius, proj.depth - node.radius))
+				{
+					node.intersection = Frustum::OUTSIDE;
+				}
+				else if (node.childCount && pixelRadius < c_minNodePixelRadius)
+				{
+					node.intersection = ccPointCloudLOD::TOO_SMALL;
+				}
+			}
+		}
+
+		//the front-most visible cells will be used as occluders for the next visibility test
+		if (	m_collectOccluders
+			&&	lookForOccluders
+			&&	projected
+			&&	fullyVisible
+			&&	node.intersection != Frustum::OUTSIDE
+			&&	(pixelRadius <= c_maxOccluderPixelRadius || ccPointCloudLOD::IsDisplayedAsLeaf(node)))
+		{
+			OccluderCandidate candidate;
+			candidate.occluder.index = nodeIndex;
+			candidate.occluder.level = node.level;
+			candidate.depth = proj.depth - node.radius;
+			try
+			{
+				m_occluderCandidates.push_back(candidate);
+			}
+			catch (const std::bad_alloc&)
+			{
+				//not enough memory: we'll have less occluders
+			}
+			lookForOccluders = false;
+		}
+
 		uint32_t visibleCount = 0;
 		switch (node.intersection)
 		{
+		case ccPointCloudLOD::TOO_SMALL:
+		{
+			//we only display a few points (one per pixel)
+			uint32_t pointCount = static_cast<uint32_t>(ceil(M_PI * pixelRadius * pixelRadius));
+			visibleCount = std::min(node.pointCount, std::max<uint32_t>(1, pointCount));
+			//we simply flag the others as already displayed (as they are sorted, the displayed ones will
+			//be close to each other, but the cell is too small for this to be visible)
+			node.displayedPointCount = node.pointCount - visibleCount;
+
+			//the children won't be displayed
+			for (int i = 0; i < 8; ++i)
+			{
+				if (node.childIndexes[i] >= 0)
+				{
+					propagateFlag(m_lod.node(node.childIndexes[i], node.level + 1), Frustum::OUTSIDE);
+				}
+			}
+		}
+		break;
+
 		case Frustum::INSIDE:
-			visibleCount = node.pointCount;
-			//no need to propagate the visibility to the children as the default value should already be 'INSIDE'
-			break;
+			if (!m_camera)
+			{
+				visibleCount = node.pointCount;
+				//no need to propagate the visibility to the children as the default value should already be 'INSIDE'
+				break;
+			}
+			//otherwise we have to test the children as well (they may be too small or hidden)
+			//(no break)
 
 		case Frustum::INTERSECT:
 			//we have to test the children
@@ -642,7 +1312,7 @@ public:
 					if (node.childIndexes[i] >= 0)
 					{
 						ccPointCloudLOD::Node& childNode = m_lod.node(node.childIndexes[i], node.level + 1);
-						visibleCount += flag(childNode);
+						visibleCount += flag(childNode, node.childIndexes[i], lookForOccluders);
 					}
 				}
 
@@ -674,9 +1344,28 @@ public:
 	unsigned char m_maxLevel;
 	ccClipPlaneSet m_clipPlanes;
 	bool m_hasClipPlanes;
+
+	//! Camera parameters (for screen-space size culling)
+	const ccGLCameraParameters* m_camera;
+	//! Depth buffer (for occlusion culling)
+	const LODDepthBuffer* m_depthBuffer;
+	//! Whether the occluders should be collected or not
+	bool m_collectOccluders;
+
+	//! Occluder candidate
+	struct OccluderCandidate
+	{
+		ccPointCloudLOD::Occluder occluder;
+		double depth;
+	};
+	//! Occluder candidates
+	std::vector<OccluderCandidate> m_occluderCandidates;
 };
 
-uint32_t ccPointCloudLOD::flagVisibility(const Frustum& frustum, ccClipPlaneSet* clipPlanes/*=0*/)
+uint32_t ccPointCloudLOD::flagVisibility(	const Frustum& frustum,
+											ccClipPlaneSet* clipPlanes/*=0*/,
+											const ccGLCameraParameters* camera/*=0*/,
+											bool occlusionCulling/*=false*/)
 {
 	if (m_state != INITIALIZED)
 	{
@@ -693,7 +1382,35 @@ uint32_t ccPointCloudLOD::flagVisibility(const Frustum& frustum, ccClipPlaneSet*
 		lodVisibility.setClipPlanes(*clipPlanes);
 	}
 
-	m_currentState.visiblePoints = lodVisibility.flag(root());
+	LODDepthBuffer depthBuffer;
+	if (camera)
+	{
+		lodVisibility.setCamera(camera);
+
+		if (occlusionCulling)
+		{
+			//remove the occluders that don't exist anymore (just in case)
+			m_occluders.erase(std::remove_if(	m_occluders.begin(),
+												m_occluders.end(),
+												[this](const Occluder& o) { return o.level >= m_levels.size() || o.index < 0 || static_cast<size_t>(o.index) >= m_levels[o.level].data.size(); }),
+								m_occluders.end());
+
+			//the depth buffer is built with the front-most cells of the previous test
+			bool withDepthBuffer = (!m_occluders.empty() && depthBuffer.build(*this, m_occluders, *camera));
+			lodVisibility.setOcclusionCulling(withDepthBuffer ? &depthBuffer : 0);
+		}
+	}
+
+	m_currentState.visiblePoints = lodVisibility.flag(root(), 0);
+
+	if (camera && occlusionCulling)
+	{
+		lodVisibility.getOccluders(m_occluders, c_maxOccluderCount);
+	}
+	else
+	{
+		m_occluders.clear();
+	}
 
 	return m_currentState.visiblePoints;
 }
@@ -708,7 +1425,7 @@ uint32_t ccPointCloudLOD::addNPointsToIndexMap(Node& node, uint32_t count)
 
 	uint32_t displayedCount = 0;
 
-	if (node.childCount)
+	if (!IsDisplayedAsLeaf(node))
 	{
 		uint32_t thisNodeRemainingCount = (node.pointCount - node.displayedPointCount);
 		assert(count <= thisNodeRemainingCount);
@@ -830,7 +1547,7 @@ LODIndexSet* ccPointCloudLOD::getIndexMap(unsigned char level, unsigned& maxCoun
 		{
 			Node& node = l.data[i];
 
-			if (node.childCount) //skip non leaf cells
+			if (!IsDisplayedAsLeaf(node)) //skip non leaf cells
 				continue;
 			assert(node.intersection != UNDEFINED);
 			if (node.intersection == Frustum::OUTSIDE)
@@ -902,7 +1619,7 @@ LODIndexSet* ccPointCloudLOD::getIndexMap(unsigned char level, unsigned& maxCoun
 			{
 				nodeMaxCount = nodeRemainingCount;
 			}
-			else if (node.childCount)
+			else if (!IsDisplayedAsLeaf(node))
 			{
 				double ratio = static_cast<double>(nodeRemainingCount) / totalRemainingCount;
 				nodeMaxCount = static_cast<uint32_t>(ceil(ratio * mapFreeSize));
@@ -925,7 +1642,7 @@ LODIndexSet* ccPointCloudLOD::getIndexMap(unsigned char level, unsigned& maxCoun
 			thisPassDisplayCount += nodeDisplayCount;
 			assert(thisPassDisplayCount == m_indexMap->currentSize());
 
-			if (node.childCount == 0)
+			if (IsDisplayedAsLeaf(node))
 			{
 				remainingPointsAtThisLevel += (node.pointCount - node.displayedPointCount);
 			}
@@ -942,7 +1659,7 @@ LODIndexSet* ccPointCloudLOD::getIndexMap(unsigned char level, unsigned& maxCoun
 		{
 			Node& node = l.data[i];
 
-			if (node.childCount) //skip non leaf nodes
+			if (!IsDisplayedAsLeaf(node)) //skip non leaf nodes
 				continue;
 			assert(node.intersection != UNDEFINED);
 			if (node.intersection == Frustum::OUTSIDE)
@@ -33,8 +33,10 @@
 #include <array>
 #include <functional>
 
+class QFile;
 class ccPointCloud;
 class ccPointCloudLODThread;
+struct ccGLCameraParameters;
 
 //! Level descriptor
 struct LODLevelDesc
@@ -120,6 +122,8 @@ public:
 
 	//! Undefined visibility flag
 	static const unsigned char UNDEFINED = 255;
+	//! Visibility flag of the nodes that are too small on screen (only a few of their points are displayed, as for a leaf)
+	static const unsigned char TOO_SMALL = 254;
 	
 	//! Octree 'tree' node
 	struct Node
@@ -166,6 +170,16 @@ public:
 
 	inline Node& root() { return node(0, 0); }
 
+	//! Occluder (front-most visible cell - see flagVisibility)
+	struct Occluder
+	{
+		int32_t index;
+		uint8_t level;
+	};
+
+	//! Returns whether a node is displayed as a leaf (i.e. without its children) or not
+	static inline bool IsDisplayedAsLeaf(const Node& node) { return node.childCount == 0 || node.intersection == TOO_SMALL; }
+
 	inline const Node& root() const { return node(0, 0); }
 
 	//inline float maxRadius(unsigned char level) const
@@ -175,9 +189,27 @@ public:
 	//}
 
 	//! Test all cells visibility with a given frustum
-	/** Automatically calls resetVisibility
+	/** Automatically calls resetVisibility.
+
+		If the camera parameters are provided, the cells that are too small on
+		screen are displayed with only a few points (their children are skipped).
+		If occlusion culling is enabled as well, the cells hidden behind the
+		front-most cells of the previous call are skipped (a coarse depth buffer
+		is built with a sample of the points of these cells). Occlusion culling
+		shouldn't be used if some points may be hidden (visibility table, etc.).
+		\param frustum camera frustum
+		\param clipPlanes clipping planes (optional)
+		\param camera camera parameters (optional)
+		\param occlusionCulling whether occlusion culling should be used or not (only if the camera parameters are provided)
+		\return the number of visible points
 	**/
-	uint32_t flagVisibility(const Frustum& frustum, ccClipPlaneSet* clipPlanes = 0);
+	uint32_t flagVisibility(const Frustum& frustum,
+							ccClipPlaneSet* clipPlanes = 0,
+							const ccGLCameraParameters* camera = 0,
+							bool occlusionCulling = false);
+
+	//! Returns the number of visible points (for the last visibility test)
+	inline uint32_t visiblePointCount() const { return m_currentState.visiblePoints; }
 
 	//! Builds an index map with the remaining visible points
 	LODIndexSet* getIndexMap(unsigned char level, unsigned& maxCount, unsigned& remainingPointsAtThisLevel);
@@ -191,6 +223,21 @@ public:
 	//! Returns the memory used by the structure (in bytes)
 	size_t memory() const;
 
+	//! Saves the structure (and its octree) to a file
+	/** The structure must be initialized.
+	**/
+	bool toFile(QFile& out);
+
+	//! Loads the structure (and its octree) from a file
+	/** If the saved structure can't be used (different octree settings,
+		not enough memory, etc.) it is skipped and the structure stays
+		uninitialized (it will be computed again when necessary).
+		\param in input file
+		\param cloud associated cloud (must be the same as when the structure was saved)
+		\return false if the file couldn't be read
+	**/
+	bool fromFile(QFile& in, ccPointCloud* cloud);
+
 protected: //methods
 
 	friend ccPointCloudLODThread;
@@ -207,6 +254,9 @@ protected: //methods
 	//! Clears the internal (nodes) data
 	void clearData();
 
+	//! Makes sure the structure is cleared when the octree is modified
+	void watchOctree(ccPointCloud* cloud);
+
 	//! Reserves a new cell at a given level
 	/** \return the new cell index in the array corresponding to this level (see m_levels)
 	**/
@@ -264,6 +314,9 @@ protected: //members
 	//! Current rendering state
 	RenderParams m_currentState;
 
+	//! Occluders of the last visibility test (used to build the depth buffer of the next one)
+	std::vector<Occluder> m_occluders;
+
 	//! Index map
 	LODIndexSet* m_indexMap;
 
@@ -273,6 +326,9 @@ protected: //members
 	//! Associated octree
 	ccOctree::Shared m_octree;
 
+	//! Connection to the octree 'updated' signal
+	QMetaObject::Connection m_octreeConnection;
+
 	//! Computing thread
 	//	ټLOD߳
 	ccPointCloudLODThread* m_thread;
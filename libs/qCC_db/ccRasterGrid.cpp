@@ -30,9 +30,12 @@
 //Qt
 #include <QCoreApplication>
 #include <QMap>
+#include <QThread>
 
 //System
 #include <assert.h>
+#include <stdint.h>
+#include <algorithm>
 
 //default field names
 struct DefaultFieldNames : public QMap<ccRasterGrid::ExportableFields, QString>
@@ -68,6 +71,7 @@ ccRasterGrid::ccRasterGrid()
 	, validCellCount(0)
 	, hasColors(false)
 	, valid(false)
+	, projectionPercentile(50.0)
 {}
 
 ccRasterGrid::~ccRasterGrid()
@@ -120,6 +124,7 @@ void ccRasterGrid::clear()
 	minHeight = maxHeight = meanHeight = 0;
 	nonEmptyCellCount = validCellCount = 0;
 	hasColors = false;
+	fillState = FillState();
 
 	setValid(false);
 }
@@ -168,242 +173,546 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 		return false;
 	}
 
-	unsigned gridTotalSize = width * height;
-	if (gridTotalSize == 0)
+	//input cloud as a ccPointCloud
+	unsigned sfCount = 0;
+	if (cloud->isA(CC_TYPES::POINT_CLOUD))
+	{
+		sfCount = static_cast<ccPointCloud*>(cloud)->getNumberOfScalarFields();
+	}
+
+	if (!beginFill(Z, projectionType, sfInterpolation, sfCount, cloud->hasColors()))
 	{
-		assert(false);
 		return false;
 	}
 
-	//input cloud as a ccPointCloud
-	ccPointCloud* pc = 0;
-	if (cloud && cloud->isA(CC_TYPES::POINT_CLOUD))
+	//filling the grid
+	unsigned pointCount = cloud->size();
+
+	if (progressDialog)
+	{
+		progressDialog->setMethodTitle(QObject::tr("Grid generation"));
+		progressDialog->setInfo(QObject::tr("Points: %1\nCells: %2 x %3").arg(pointCount).arg(width).arg(height));
+		progressDialog->start();
+		progressDialog->show();
+		QCoreApplication::processEvents();
+	}
+
+	if (!addPoints(cloud, 0, progressDialog))
 	{
-		pc = static_cast<ccPointCloud*>(cloud);
+		//process cancelled by the user (or not enough memory)
+		fillState = FillState();
+		return false;
+	}
+
+	return endFill(interpolateEmptyCells);
+}
+
+bool ccRasterGrid::beginFill(	unsigned char Z,
+								ProjectionType projectionType,
+								ProjectionType sfInterpolation/*=INVALID_PROJECTION_TYPE*/,
+								unsigned sfCount/*=0*/,
+								bool withColors/*=false*/)
+{
+	unsigned gridTotalSize = width * height;
+	if (gridTotalSize == 0 || Z > 2)
+	{
+		assert(false);
+		return false;
 	}
 
+	fillState = FillState();
+	setValid(false);
+
 	//do we need to interpolate scalar fields?
-	bool interpolateSF = (sfInterpolation != INVALID_PROJECTION_TYPE);
-	if (interpolateSF)
+	scalarFields.clear();
+	if (sfInterpolation != INVALID_PROJECTION_TYPE && sfCount != 0)
 	{
-		if (pc && pc->hasScalarFields())
+		if (	sfInterpolation != PROJ_MINIMUM_VALUE
+			&&	sfInterpolation != PROJ_AVERAGE_VALUE
+			&&	sfInterpolation != PROJ_MAXIMUM_VALUE)
 		{
-			unsigned sfCount = pc->getNumberOfScalarFields();
-			try
-			{
-				scalarFields.resize(sfCount);
-				for (unsigned i = 0; i < sfCount; ++i)
-				{
-					scalarFields[i].resize(gridTotalSize, std::numeric_limits<SF::value_type>::quiet_NaN());
-				}
-			}
-			catch (const std::bad_alloc&)
+			ccLog::Warning("[Rasterize] Scalar fields can only be projected with the minimum, average or maximum strategies (average will be used)");
+			sfInterpolation = PROJ_AVERAGE_VALUE;
+		}
+
+		try
+		{
+			scalarFields.resize(sfCount);
+			for (unsigned i = 0; i < sfCount; ++i)
 			{
-				//not enough memory
-				scalarFields.clear();
-				ccLog::Warning("[Rasterize] Failed to allocate memory for scalar fields!");
+				scalarFields[i].resize(gridTotalSize, std::numeric_limits<SF::value_type>::quiet_NaN());
 			}
 		}
-		else
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			scalarFields.clear();
+			ccLog::Warning("[Rasterize] Failed to allocate memory for scalar fields!");
+		}
+	}
+	if (scalarFields.empty())
+	{
+		sfInterpolation = INVALID_PROJECTION_TYPE;
+	}
+
+	if (	projectionType == PROJ_AVERAGE_VALUE
+		||	projectionType == PROJ_MEDIAN_VALUE
+		||	projectionType == PROJ_PERCENTILE_VALUE)
+	{
+		try
 		{
-			interpolateSF = false;
+			fillState.nearestSquareDist.resize(gridTotalSize, 0);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			ccLog::Warning("[Rasterize] Not enough memory!");
+			return false;
 		}
 	}
 
-	//filling the grid
+	//we always handle the colors (if any)
+	hasColors = withColors;
+
+	fillState.Z = Z;
+	fillState.projectionType = projectionType;
+	fillState.sfInterpolation = sfInterpolation;
+	fillState.active = true;
+
+	return true;
+}
+
+//! Number of points projected between two progress updates
+static const unsigned RASTER_POINTS_PER_CHUNK = (1 << 20);
+
+bool ccRasterGrid::addPoints(	ccGenericPointCloud* cloud,
+								unsigned indexOffset/*=0*/,
+								ccProgressDialog* progressDialog/*=0*/)
+{
+	if (!cloud || !fillState.active)
+	{
+		assert(false);
+		return false;
+	}
+
+	if (hasColors && !cloud->hasColors())
+	{
+		ccLog::Warning("[Rasterize] Input block has no colors!");
+		return false;
+	}
+	if (!scalarFields.empty())
+	{
+		if (!cloud->isA(CC_TYPES::POINT_CLOUD) || static_cast<ccPointCloud*>(cloud)->getNumberOfScalarFields() < scalarFields.size())
+		{
+			ccLog::Warning("[Rasterize] Input block doesn't have the expected scalar fields!");
+			return false;
+		}
+	}
+
+	//the median and percentile projections keep all the heights: they can't be streamed
+	if (	fillState.blockCount != 0
+		&&	(fillState.projectionType == PROJ_MEDIAN_VALUE || fillState.projectionType == PROJ_PERCENTILE_VALUE))
+	{
+		ccLog::Warning("[Rasterize] The median and percentile projections can't be computed block by block (use another projection type or load the whole cloud)");
+		return false;
+	}
+	++fillState.blockCount;
+
 	unsigned pointCount = cloud->size();
+	unsigned chunkCount = (pointCount + RASTER_POINTS_PER_CHUNK - 1) / RASTER_POINTS_PER_CHUNK;
+	CCLib::NormalizedProgress nProgress(progressDialog, chunkCount);
 
-	if (progressDialog)
+	try
 	{
-		progressDialog->setMethodTitle(QObject::tr("Grid generation"));
-		progressDialog->setInfo(QObject::tr("Points: %1\nCells: %2 x %3").arg(pointCount).arg(width).arg(height));
-		progressDialog->start();
-		progressDialog->show();
-		QCoreApplication::processEvents();
+		std::vector<int> cellIndexes;
+		std::vector<unsigned> sortedIndexes;
+		for (unsigned firstIndex = 0; firstIndex < pointCount; firstIndex += RASTER_POINTS_PER_CHUNK)
+		{
+			unsigned count = std::min(RASTER_POINTS_PER_CHUNK, pointCount - firstIndex);
+			if (!projectPoints(cloud, firstIndex, count, indexOffset, cellIndexes, sortedIndexes))
+			{
+				return false;
+			}
+
+			if (!nProgress.oneStep())
+			{
+				//process cancelled by the user
+				return false;
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		ccLog::Warning("[Rasterize] Not enough memory!");
+		return false;
 	}
-	CCLib::NormalizedProgress nProgress(progressDialog, pointCount);
 
+	return true;
+}
+
+bool ccRasterGrid::projectPoints(	ccGenericPointCloud* cloud,
+									unsigned firstIndex,
+									unsigned count,
+									unsigned indexOffset,
+									std::vector<int>& cellIndexes,
+									std::vector<unsigned>& sortedIndexes)
+{
 	//vertical dimension
-	assert(Z >= 0 && Z <= 2);
+	const unsigned char Z = fillState.Z;
 	const unsigned char X = Z == 2 ? 0 : Z + 1;
 	const unsigned char Y = X == 2 ? 0 : X + 1;
 
-	//we always handle the colors (if any)
-	hasColors = cloud->hasColors();
+	const ProjectionType projectionType = fillState.projectionType;
+	const ProjectionType sfInterpolation = fillState.sfInterpolation;
+	const bool keepNearestPoint = !fillState.nearestSquareDist.empty();
+	const bool keepHeights = (projectionType == PROJ_MEDIAN_VALUE || projectionType == PROJ_PERCENTILE_VALUE);
+
+	//input cloud as a ccPointCloud (for scalar fields)
+	ccPointCloud* pc = (scalarFields.empty() ? 0 : static_cast<ccPointCloud*>(cloud));
+
+	//the points are processed by horizontal bands of rows (one thread per band at a time)
+	//so that each cell is updated by a single thread, in the original order of the points
+	const int sliceCount = std::max(1, QThread::idealThreadCount()) * 4;
+	const unsigned bandCount = std::min(height, static_cast<unsigned>(sliceCount));
 
-	for (unsigned n = 0; n<pointCount; ++n)
+	//step 1: compute the cell index of each point (in parallel)
+	cellIndexes.resize(count);
+	sortedIndexes.resize(count);
+	std::vector<unsigned> bandPopulations(static_cast<size_t>(sliceCount) * bandCount, 0);
+
+#if defined(_OPENMP)
+	#pragma omp parallel for
+#endif
+	for (int s = 0; s < sliceCount; ++s)
 	{
-		//for each point
-		const CCVector3* P = cloud->getPoint(n);
+		unsigned* sliceBandPopulations = &bandPopulations[static_cast<size_t>(s) * bandCount];
+		unsigned sliceStart = static_cast<unsigned>((static_cast<uint64_t>(count) * s) / sliceCount);
+		unsigned sliceStop = static_cast<unsigned>((static_cast<uint64_t>(count) * (s + 1)) / sliceCount);
+		for (unsigned n = sliceStart; n < sliceStop; ++n)
+		{
+			const CCVector3* P = cloud->getPoint(firstIndex + n);
+
+			//project it inside the grid
+			CCVector3d relativePos = CCVector3d::fromArray(P->u) - minCorner;
+			int i = static_cast<int>((relativePos.u[X] / gridStep + 0.5));
+			int j = static_cast<int>((relativePos.u[Y] / gridStep + 0.5));
+
+			//we skip points that fall outside of the grid!
+			if (	i < 0 || i >= static_cast<int>(width)
+				||	j < 0 || j >= static_cast<int>(height) )
+			{
+				cellIndexes[n] = -1;
+				continue;
+			}
+
+			cellIndexes[n] = j * static_cast<int>(width) + i;
+			++sliceBandPopulations[(static_cast<uint64_t>(j) * bandCount) / height];
+		}
+	}
 
-		//project it inside the grid
-		CCVector3d relativePos = CCVector3d::fromArray(P->u) - minCorner;
-		int i = static_cast<int>((relativePos.u[X] / gridStep + 0.5));
-		int j = static_cast<int>((relativePos.u[Y] / gridStep + 0.5));
+	//step 2: sort the points by band (counting sort, stable)
+	std::vector<unsigned> bandStarts(bandCount + 1, 0);
+	{
+		//compute the start position of each (band, slice) pair
+		unsigned position = 0;
+		for (unsigned b = 0; b < bandCount; ++b)
+		{
+			bandStarts[b] = position;
+			for (int s = 0; s < sliceCount; ++s)
+			{
+				unsigned& population = bandPopulations[static_cast<size_t>(s) * bandCount + b];
+				unsigned sliceBandCount = population;
+				population = position;
+				position += sliceBandCount;
+			}
+		}
+		bandStarts[bandCount] = position;
+	}
 
-		//we skip points that fall outside of the grid!
-		if (	i < 0 || i >= static_cast<int>(width)
-			||	j < 0 || j >= static_cast<int>(height) )
+#if defined(_OPENMP)
+	#pragma omp parallel for
+#endif
+	for (int s = 0; s < sliceCount; ++s)
+	{
+		unsigned* sliceBandPositions = &bandPopulations[static_cast<size_t>(s) * bandCount];
+		unsigned sliceStart = static_cast<unsigned>((static_cast<uint64_t>(count) * s) / sliceCount);
+		unsigned sliceStop = static_cast<unsigned>((static_cast<uint64_t>(count) * (s + 1)) / sliceCount);
+		for (unsigned n = sliceStart; n < sliceStop; ++n)
 		{
-			if (!nProgress.oneStep())
+			int pos = cellIndexes[n];
+			if (pos >= 0)
 			{
-				//process cancelled by the user
-				return false;
+				unsigned j = static_cast<unsigned>(pos) / width;
+				sortedIndexes[sliceBandPositions[(static_cast<uint64_t>(j) * bandCount) / height]++] = n;
 			}
-			continue;
 		}
-		assert(i >= 0 && j >= 0);
+	}
+
+	//heights storage (for the median and percentile projections)
+	size_t heightsOffset = fillState.cellHeights.size();
+	if (keepHeights)
+	{
+		fillState.cellHeights.resize(heightsOffset + bandStarts[bandCount]);
+	}
 
-		//update the cell statistics
-		ccRasterCell& aCell = rows[j][i];
-		if (aCell.nbPoints)
+	//step 3: update the cells (each band is processed by a single thread)
+#if defined(_OPENMP)
+	#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int b = 0; b < static_cast<int>(bandCount); ++b)
+	{
+		for (unsigned k = bandStarts[b]; k < bandStarts[b + 1]; ++k)
 		{
-			if (P->u[Z] < aCell.minHeight)
+			unsigned n = sortedIndexes[k];
+			unsigned pointIndex = firstIndex + n;
+			const CCVector3* P = cloud->getPoint(pointIndex);
+
+			//absolute position of the cell (e.g. in the 2D SF grid(s))
+			int pos = cellIndexes[n];
+			int i = pos % static_cast<int>(width);
+			int j = pos / static_cast<int>(width);
+			CCVector3d relativePos = CCVector3d::fromArray(P->u) - minCorner;
+
+			//update the cell statistics
+			ccRasterCell& aCell = rows[j][i];
+			if (aCell.nbPoints)
 			{
-				aCell.minHeight = P->u[Z];
-				if (projectionType == PROJ_MINIMUM_VALUE)
+				if (P->u[Z] < aCell.minHeight)
 				{
-					//we keep track of the lowest point
-					aCell.pointIndex = n;
+					aCell.minHeight = P->u[Z];
+					if (projectionType == PROJ_MINIMUM_VALUE)
+					{
+						//we keep track of the lowest point
+						aCell.pointIndex = indexOffset + pointIndex;
 
-					if (hasColors)
+						if (hasColors)
+						{
+							const ColorCompType* col = cloud->getPointColor(pointIndex);
+							aCell.color = CCVector3d(col[0], col[1], col[2]);
+						}
+					}
+				}
+				else if (P->u[Z] > aCell.maxHeight)
+				{
+					aCell.maxHeight = P->u[Z];
+					if (projectionType == PROJ_MAXIMUM_VALUE)
 					{
-						assert(cloud->hasColors());
-						const ColorCompType* col = cloud->getPointColor(n);
-						aCell.color = CCVector3d(col[0], col[1], col[2]);
+						//we keep track of the highest point
+						aCell.pointIndex = indexOffset + pointIndex;
+
+						if (hasColors)
+						{
+							const ColorCompType* col = cloud->getPointColor(pointIndex);
+							aCell.color = CCVector3d(col[0], col[1], col[2]);
+						}
 					}
 				}
-			}
-			else if (P->u[Z] > aCell.maxHeight)
-			{
-				aCell.maxHeight = P->u[Z];
-				if (projectionType == PROJ_MAXIMUM_VALUE)
+
+				if (keepNearestPoint)
 				{
-					//we keep track of the highest point
-					aCell.pointIndex = n;
+					//we keep track of the point which is the closest to the cell center (in 2D)
+					CCVector2d C((i + 0.5) * gridStep, (j + 0.5) * gridStep);
+					double distToP = (C - CCVector2d(relativePos.u[X], relativePos.u[Y])).norm2();
+					if (distToP < fillState.nearestSquareDist[pos])
+					{
+						aCell.pointIndex = indexOffset + pointIndex;
+						fillState.nearestSquareDist[pos] = distToP;
+					}
 
 					if (hasColors)
 					{
-						assert(cloud->hasColors());
-						const ColorCompType* col = cloud->getPointColor(n);
-						aCell.color = CCVector3d(col[0], col[1], col[2]);
+						const ColorCompType* col = cloud->getPointColor(pointIndex);
+						aCell.color += CCVector3d(col[0], col[1], col[2]);
 					}
 				}
 			}
-
-			if (projectionType == PROJ_AVERAGE_VALUE)
+			else
 			{
-				//we keep track of the point which is the closest to the cell center (in 2D)
-				CCVector2d C((i + 0.5) * gridStep, (j + 0.5) * gridStep);
-				const CCVector3* Q = cloud->getPoint(aCell.pointIndex); //former closest point
-				CCVector3d relativePosQ = CCVector3d::fromArray(Q->u) - minCorner;
-
-				double distToP = (C - CCVector2d(relativePos .u[X], relativePos .u[Y])).norm2();
-				double distToQ = (C - CCVector2d(relativePosQ.u[X], relativePosQ.u[Y])).norm2();
-				if (distToP < distToQ)
+				aCell.minHeight = aCell.maxHeight = P->u[Z];
+				aCell.pointIndex = indexOffset + pointIndex;
+
+				if (keepNearestPoint)
 				{
-					aCell.pointIndex = n;
+					CCVector2d C((i + 0.5) * gridStep, (j + 0.5) * gridStep);
+					fillState.nearestSquareDist[pos] = (C - CCVector2d(relativePos.u[X], relativePos.u[Y])).norm2();
 				}
 
 				if (hasColors)
 				{
-					assert(cloud->hasColors());
-					const ColorCompType* col = cloud->getPointColor(n);
-					aCell.color += CCVector3d(col[0], col[1], col[2]);
+					const ColorCompType* col = cloud->getPointColor(pointIndex);
+					aCell.color = CCVector3d(col[0], col[1], col[2]);
 				}
-
 			}
-		}
-		else
-		{
-			aCell.minHeight = aCell.maxHeight = P->u[Z];
-			aCell.pointIndex = n;
 
-			if (hasColors)
+			//sum the points heights
+			double Pz = P->u[Z];
+			aCell.avgHeight += Pz;
+			aCell.stdDevHeight += Pz * Pz;
+
+			if (keepHeights)
 			{
-				assert(cloud->hasColors());
-				const ColorCompType* col = cloud->getPointColor(n);
-				aCell.color = CCVector3d(col[0], col[1], col[2]);
+				fillState.cellHeights[heightsOffset + k] = std::pair<unsigned, PointCoordinateType>(static_cast<unsigned>(pos), P->u[Z]);
 			}
-		}
-		
-		//sum the points heights
-		double Pz = P->u[Z];
-		aCell.avgHeight += Pz;
-		aCell.stdDevHeight += Pz * Pz;
-
-		//scalar fields
-		if (interpolateSF)
-		{
-			assert(pc);
 
-			//absolute position of the cell (e.g. in the 2D SF grid(s))
-			int pos = j * static_cast<int>(width)+i;
-			assert(pos < static_cast<int>(gridTotalSize));
-
-			for (size_t k = 0; k < scalarFields.size(); ++k)
+			//scalar fields
+			if (pc)
 			{
-				assert(!scalarFields[k].empty());
+				for (size_t sfIndex = 0; sfIndex < scalarFields.size(); ++sfIndex)
+				{
+					assert(!scalarFields[sfIndex].empty());
 
-				CCLib::ScalarField* sf = pc->getScalarField(static_cast<unsigned>(k));
-				assert(sf && pos < static_cast<int>(sf->currentSize()));
+					CCLib::ScalarField* sf = pc->getScalarField(static_cast<unsigned>(sfIndex));
+					assert(sf && pointIndex < sf->currentSize());
 
-				ScalarType sfValue = sf->getValue(n);
+					ScalarType sfValue = sf->getValue(pointIndex);
 
-				if (ccScalarField::ValidValue(sfValue))
-				{
-					SF::value_type formerValue = scalarFields[k][pos];
-					if (aCell.nbPoints && std::isfinite(formerValue))
+					if (ccScalarField::ValidValue(sfValue))
 					{
-						switch (sfInterpolation)
+						SF::value_type formerValue = scalarFields[sfIndex][pos];
+						if (aCell.nbPoints && std::isfinite(formerValue))
 						{
-						case PROJ_MINIMUM_VALUE:
-							// keep the minimum value
-							scalarFields[k][pos] = std::min<SF::value_type>(formerValue, sfValue);
-							break;
-						case PROJ_AVERAGE_VALUE:
-							//we sum all values (we will divide them later)
-							scalarFields[k][pos] += sfValue;
-							break;
-						case PROJ_MAXIMUM_VALUE:
-							// keep the maximum value
-							scalarFields[k][pos] = std::max<SF::value_type>(formerValue, sfValue);
-							break;
-						default:
-							assert(false);
-							break;
+							switch (sfInterpolation)
+							{
+							case PROJ_MINIMUM_VALUE:
+								// keep the minimum value
+								scalarFields[sfIndex][pos] = std::min<SF::value_type>(formerValue, sfValue);
+								break;
+							case PROJ_AVERAGE_VALUE:
+								//we sum all values (we will divide them later)
+								scalarFields[sfIndex][pos] += sfValue;
+								break;
+							case PROJ_MAXIMUM_VALUE:
+								// keep the maximum value
+								scalarFields[sfIndex][pos] = std::max<SF::value_type>(formerValue, sfValue);
+								break;
+							default:
+								assert(false);
+								break;
+							}
+						}
+						else
+						{
+							//for the first (valid) point, we simply have to store its SF value (in any case)
+							scalarFields[sfIndex][pos] = sfValue;
 						}
-					}
-					else
-					{
-						//for the first (valid) point, we simply have to store its SF value (in any case)
-						scalarFields[k][pos] = sfValue;
 					}
 				}
 			}
+
+			//update the number of points in the cell
+			++aCell.nbPoints;
 		}
+	}
 
-		//update the number of points in the cell
-		++aCell.nbPoints;
+	return true;
+}
+
+bool ccRasterGrid::computeHeightPercentiles(double percentile)
+{
+	std::vector< std::pair<unsigned, PointCoordinateType> >& cellHeights = fillState.cellHeights;
+	unsigned gridTotalSize = width * height;
+
+	//sort the heights by cell (counting sort)
+	std::vector<PointCoordinateType> heights;
+	std::vector<size_t> cellStarts;
+	try
+	{
+		heights.resize(cellHeights.size());
+		cellStarts.resize(static_cast<size_t>(gridTotalSize) + 1, 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	{
+		size_t position = 0;
+		for (unsigned j = 0; j < height; ++j)
+		{
+			const Row& row = rows[j];
+			for (unsigned i = 0; i < width; ++i)
+			{
+				cellStarts[j * width + i] = position;
+				position += row[i].nbPoints;
+			}
+		}
+		cellStarts[gridTotalSize] = position;
+		assert(position == cellHeights.size());
+	}
 
-		if (!nProgress.oneStep())
+	{
+		std::vector<size_t> cellPositions(cellStarts.begin(), cellStarts.end() - 1);
+		for (const std::pair<unsigned, PointCoordinateType>& cellHeight : cellHeights)
 		{
-			//process cancelled by user
-			return false;
+			heights[cellPositions[cellHeight.first]++] = cellHeight.second;
 		}
 	}
 
+	//we don't need the pairs anymore
+	cellHeights.clear();
+	cellHeights.shrink_to_fit();
+
+	double relativeRank = std::max(0.0, std::min(percentile, 100.0)) / 100.0;
+
+	//select the right value in each cell (linear interpolation between the closest ranks)
+#if defined(_OPENMP)
+	#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int j = 0; j < static_cast<int>(height); ++j)
+	{
+		Row& row = rows[j];
+		for (unsigned i = 0; i < width; ++i)
+		{
+			ccRasterCell& cell = row[i];
+			if (cell.nbPoints == 0)
+			{
+				continue;
+			}
+
+			PointCoordinateType* cellValues = &heights[cellStarts[j * width + i]];
+			double rank = relativeRank * (cell.nbPoints - 1);
+			unsigned lowerRank = static_cast<unsigned>(floor(rank));
+			std::nth_element(cellValues, cellValues + lowerRank, cellValues + cell.nbPoints);
+			double h = cellValues[lowerRank];
+			if (lowerRank + 1 < cell.nbPoints && rank > lowerRank)
+			{
+				//the next value is the smallest of the upper part
+				double nextH = *std::min_element(cellValues + lowerRank + 1, cellValues + cell.nbPoints);
+				h += (rank - lowerRank) * (nextH - h);
+			}
+			cell.h = h;
+		}
+	}
+
+	return true;
+}
+
+bool ccRasterGrid::endFill(bool interpolateEmptyCells)
+{
+	if (!fillState.active)
+	{
+		assert(false);
+		return false;
+	}
+
+	const ProjectionType projectionType = fillState.projectionType;
+
 	//update SF grids for 'average' cases
-	if (sfInterpolation == PROJ_AVERAGE_VALUE)
+	if (fillState.sfInterpolation == PROJ_AVERAGE_VALUE)
 	{
 		for (size_t k = 0; k < scalarFields.size(); ++k)
 		{
 			assert(!scalarFields[k].empty());
 
-			double* _gridSF = &scalarFields[k].front();
-			for (unsigned j = 0; j < height; ++j)
+#if defined(_OPENMP)
+			#pragma omp parallel for
+#endif
+			for (int j = 0; j < static_cast<int>(height); ++j)
 			{
-				Row& row = rows[j];
+				const Row& row = rows[j];
+				double* _gridSF = &scalarFields[k][j * width];
 				for (unsigned i = 0; i < width; ++i, ++_gridSF)
 				{
 					if (row[i].nbPoints > 1)
@@ -420,7 +729,12 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 
 	//update the main grid (average height and std.dev. computation + current 'height' value)
 	{
-		for (unsigned j = 0; j < height; ++j)
+		bool averageColors = (hasColors && !fillState.nearestSquareDist.empty());
+
+#if defined(_OPENMP)
+		#pragma omp parallel for
+#endif
+		for (int j = 0; j < static_cast<int>(height); ++j)
 		{
 			Row& row = rows[j];
 			for (unsigned i = 0; i < width; ++i)
@@ -430,7 +744,7 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 				{
 					cell.avgHeight /= cell.nbPoints;
 					cell.stdDevHeight = sqrt(fabs(cell.stdDevHeight / cell.nbPoints - cell.avgHeight*cell.avgHeight));
-					if (hasColors && projectionType == PROJ_AVERAGE_VALUE)
+					if (averageColors)
 					{
 						cell.color /= cell.nbPoints;
 					}
@@ -454,6 +768,10 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 					case PROJ_MAXIMUM_VALUE:
 						cell.h = cell.maxHeight;
 						break;
+					case PROJ_MEDIAN_VALUE:
+					case PROJ_PERCENTILE_VALUE:
+						//see below
+						break;
 					default:
 						assert(false);
 						break;
@@ -463,6 +781,20 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 		}
 	}
 
+	//median or percentile heights
+	if (projectionType == PROJ_MEDIAN_VALUE || projectionType == PROJ_PERCENTILE_VALUE)
+	{
+		if (!computeHeightPercentiles(projectionType == PROJ_MEDIAN_VALUE ? 50.0 : projectionPercentile))
+		{
+			ccLog::Warning("[Rasterize] Not enough memory to compute the per-cell median/percentile heights!");
+			fillState = FillState();
+			return false;
+		}
+	}
+
+	//release the filling state
+	fillState = FillState();
+
 	//compute the number of non empty cells
 	nonEmptyCellCount = 0;
 	{
@@ -24,6 +24,7 @@
 
 //system
 #include <limits>
+#include <vector>
 
 class ccGenericPointCloud;
 class ccPointCloud;
@@ -119,12 +120,16 @@ struct QCC_DB_LIB_API ccRasterGrid
 	enum ProjectionType {	PROJ_MINIMUM_VALUE			= 0,
 							PROJ_AVERAGE_VALUE			= 1,
 							PROJ_MAXIMUM_VALUE			= 2,
+							PROJ_MEDIAN_VALUE			= 3,
+							PROJ_PERCENTILE_VALUE		= 4, //see 'projectionPercentile'
 							INVALID_PROJECTION_TYPE		= 255,
 	};
 
 	//! Fills the grid with a point cloud
 	/** Since version 2.8, we now use the "PixelIsArea" convention by default (as GDAL)
 	This means that the height is computed at the center of the grid cell.
+	Equivalent to beginFill + addPoints + endFill.
+	Scalar fields can only be projected with the minimum, average or maximum strategies.
 	**/
 	bool fillWith(	ccGenericPointCloud* cloud,
 					unsigned char projectionDimension,
@@ -133,6 +138,41 @@ struct QCC_DB_LIB_API ccRasterGrid
 					ProjectionType sfInterpolation = INVALID_PROJECTION_TYPE,
 					ccProgressDialog* progressDialog = 0);
 
+	//! Starts filling the grid incrementally (i.e. with a stream of point blocks)
+	/** The grid must have been initialized first (see init). Points are then
+		projected block by block with addPoints and the grid is finalized by endFill.
+		This way, clouds that don't fit in memory can be rasterized.
+		Warning: the median and percentile projections need all the heights of
+		each cell (8 bytes per point are kept until endFill). Therefore they can't
+		be used with several blocks (addPoints will fail).
+		\param projectionDimension projection dimension
+		\param projectionType height projection type
+		\param sfInterpolation scalar fields projection type (or INVALID_PROJECTION_TYPE to ignore them)
+		\param sfCount number of scalar fields (each block must have at least this number of SFs)
+		\param withColors whether colors should be projected (each block must have colors)
+		\return success
+	**/
+	bool beginFill(	unsigned char projectionDimension,
+					ProjectionType projectionType,
+					ProjectionType sfInterpolation = INVALID_PROJECTION_TYPE,
+					unsigned sfCount = 0,
+					bool withColors = false);
+
+	//! Projects a block of points in the grid (see beginFill)
+	/** Points are binned in parallel. The result doesn't depend on the number of threads.
+		Only one block can be projected with the median and percentile projections (see beginFill).
+		\param block block of points
+		\param indexOffset index of the block first point in the whole input (stored as 'pointIndex' in the cells)
+		\param progressDialog optional progress dialog
+		\return false if the process was cancelled or if an error occurred
+	**/
+	bool addPoints(	ccGenericPointCloud* block,
+					unsigned indexOffset = 0,
+					ccProgressDialog* progressDialog = 0);
+
+	//! Finalizes the grid once all the blocks have been projected (see beginFill)
+	bool endFill(bool interpolateEmptyCells);
+
 	//! Option for handling empty cells
 	enum EmptyCellFillOption {	LEAVE_EMPTY				= 0,
 								FILL_MINIMUM_HEIGHT		= 1,
@@ -206,6 +246,57 @@ struct QCC_DB_LIB_API ccRasterGrid
 
 	//! Whether the grid is valid/up-to-date
 	bool valid;
+
+	//! Percentile (between 0 and 100) used by the PROJ_PERCENTILE_VALUE projection
+	double projectionPercentile;
+
+	//! Incremental filling state (see beginFill)
+	struct FillState
+	{
+		FillState()
+			: active(false)
+			, Z(2)
+			, projectionType(INVALID_PROJECTION_TYPE)
+			, sfInterpolation(INVALID_PROJECTION_TYPE)
+			, blockCount(0)
+		{}
+
+		//! Whether a filling process is in progress
+		bool active;
+		//! Projection dimension
+		unsigned char Z;
+		//! Height projection type
+		ProjectionType projectionType;
+		//! Scalar fields projection type
+		ProjectionType sfInterpolation;
+		//! Number of blocks projected so far
+		unsigned blockCount;
+		//! Squared 2D distance between the current 'nearest' point of each cell and its center
+		/** Only used for the average, median and percentile projections.
+		**/
+		std::vector<double> nearestSquareDist;
+		//! Projected (cell index, height) pairs
+		/** Only used for the median and percentile projections (one pair per
+			input point: the memory consumption is not bounded by the grid size).
+		**/
+		std::vector< std::pair<unsigned, PointCoordinateType> > cellHeights;
+	};
+
+	//! Current incremental filling state
+	FillState fillState;
+
+protected:
+
+	//! Projects a chunk of points (see addPoints)
+	bool projectPoints(	ccGenericPointCloud* cloud,
+						unsigned firstIndex,
+						unsigned count,
+						unsigned indexOffset,
+						std::vector<int>& cellIndexes,
+						std::vector<unsigned>& sortedIndexes);
+
+	//! Computes the per-cell median or percentile heights
+	bool computeHeightPercentiles(double percentile);
 };
 
 #endif //CC_RASTER_GRID_HEADER
@@ -40,6 +40,7 @@ ccScalarField::ccScalarField(const char* name/*=0*/)
 	, m_colorScale(0)
 	, m_colorRampSteps(0)
 	, m_modified(true)
+	, m_modificationCount(0)
 	, m_globalShift(0)
 {
 	setColorRampSteps(ccColorScale::DEFAULT_STEPS);
@@ -59,6 +60,7 @@ ccScalarField::ccScalarField(const ccScalarField& sf)
 	, m_colorRampSteps(sf.m_colorRampSteps)
 	, m_histogram(sf.m_histogram)
 	, m_modified(sf.m_modified)
+	, m_modificationCount(0)
 	, m_globalShift(sf.m_globalShift)
 {
 	computeMinAndMax();
@@ -132,6 +134,7 @@ void ccScalarField::setColorScale(ccColorScale::Shared scale)
 			updateSaturationBounds();
 
 		m_modified = true;
+		++m_modificationCount;
 	}
 }
 
@@ -143,6 +146,7 @@ void ccScalarField::setSymmetricalScale(bool state)
 		updateSaturationBounds();
 
 		m_modified = true;
+		++m_modificationCount;
 	}
 }
 
@@ -157,6 +161,7 @@ void ccScalarField::setLogScale(bool state)
 		}
 
 		m_modified = true;
+		++m_modificationCount;
 	}
 }
 
@@ -215,6 +220,7 @@ void ccScalarField::computeMinAndMax()
 	}
 
 	m_modified = true;
+	++m_modificationCount;
 
 	updateSaturationBounds();
 }
@@ -264,18 +270,21 @@ void ccScalarField::updateSaturationBounds()
 	}
 
 	m_modified = true;
+	++m_modificationCount;
 }
 
 void ccScalarField::setMinDisplayed(ScalarType val)
 {
 	m_displayRange.setStart(val);
 	m_modified = true;
+	++m_modificationCount;
 }
 	
 void ccScalarField::setMaxDisplayed(ScalarType val)
 {
 	m_displayRange.setStop(val);
 	m_modified = true;
+	++m_modificationCount;
 }
 
 void ccScalarField::setSaturationStart(ScalarType val)
@@ -289,6 +298,7 @@ void ccScalarField::setSaturationStart(ScalarType val)
 		m_saturationRange.setStart(val);
 	}
 	m_modified = true;
+	++m_modificationCount;
 }
 
 void ccScalarField::setSaturationStop(ScalarType val)
@@ -302,6 +312,7 @@ void ccScalarField::setSaturationStop(ScalarType val)
 		m_saturationRange.setStop(val);
 	}
 	m_modified = true;
+	++m_modificationCount;
 }
 
 void ccScalarField::setColorRampSteps(unsigned steps)
@@ -314,6 +325,7 @@ void ccScalarField::setColorRampSteps(unsigned steps)
 		m_colorRampSteps = steps;
 
 	m_modified = true;
+	++m_modificationCount;
 }
 
 bool ccScalarField::toFile(QFile& out) const
@@ -602,6 +614,7 @@ bool ccScalarField::fromFile(QFile& in, short dataVersion, int flags)
 	m_logSaturationRange.setStop((ScalarType)maxLogSaturation);
 
 	m_modified = true;
+	++m_modificationCount;
 
 	return true;
 }
@@ -620,12 +633,14 @@ void ccScalarField::showNaNValuesInGrey(bool state)
 {
 	m_showNaNValuesInGrey = state;
 	m_modified = true;
+	++m_modificationCount;
 }
 
 void ccScalarField::alwaysShowZero(bool state)
 {
 	m_alwaysShowZero = state;
 	m_modified = true;
+	++m_modificationCount;
 }
 
 void ccScalarField::importParametersFrom(const ccScalarField* sf)
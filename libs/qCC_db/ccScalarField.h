@@ -208,9 +208,15 @@ public:
 	bool mayHaveHiddenValues() const;
 
 	//! Sets modification flag state
-	void setModificationFlag(bool state) { m_modified = state; }
+	void setModificationFlag(bool state) { m_modified = state; if (state) ++m_modificationCount; }
 	//! Returns modification flag state
 	bool getModificationFlag() const { return m_modified; }
+	//! Returns the number of modifications so far
+	/** Contrary to the modification flag, this counter is never reset. It
+		can be used by several 'consumers' (e.g. VBOs of different entities)
+		to detect changes independently.
+	**/
+	unsigned getModificationCount() const { return m_modificationCount; }
 
 	//! Imports the parameters from another scalar field
 	void importParametersFrom(const ccScalarField* sf);
@@ -282,6 +288,8 @@ protected:
 		will turn this flag on.
 	**/
 	bool m_modified;
+	//! Modification counter (see getModificationCount)
+	unsigned m_modificationCount;
 
 	//! Global shift
 	double m_globalShift;
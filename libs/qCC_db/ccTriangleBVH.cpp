@@ -0,0 +1,342 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "ccTriangleBVH.h"
+
+//local
+#include "ccGenericMesh.h"
+#include "ccPointCloud.h"
+
+//CCLib
+#include <RayAndBox.h>
+
+//system
+#include <assert.h>
+#include <algorithm>
+#include <limits>
+
+//! Max number of triangles per leaf
+static const unsigned c_leafSize = 8;
+//! Tolerance on the barycentric coordinates (to avoid missing a triangle along the shared edges)
+static const double c_baryTolerance = 1.0e-7;
+
+//! Returns the display data version of the mesh vertices (0 if they are not a real point cloud)
+static unsigned GetVerticesVersion(ccGenericMesh* mesh)
+{
+	ccGenericPointCloud* vertices = mesh->getAssociatedCloud();
+	if (vertices && vertices->isA(CC_TYPES::POINT_CLOUD))
+	{
+		return static_cast<ccPointCloud*>(vertices)->getDisplayDataVersion();
+	}
+	return 0;
+}
+
+ccTriangleBVH::ccTriangleBVH()
+	: m_verticesVersion(0)
+{
+}
+
+bool ccTriangleBVH::isValidFor(ccGenericMesh* mesh) const
+{
+	return mesh && !m_nodes.empty() && m_triIndexes.size() == mesh->size() && m_verticesVersion == GetVerticesVersion(mesh);
+}
+
+size_t ccTriangleBVH::memory() const
+{
+	return m_nodes.capacity() * sizeof(Node) + m_triIndexes.capacity() * sizeof(unsigned);
+}
+
+bool ccTriangleBVH::build(ccGenericMesh* mesh)
+{
+	m_nodes.clear();
+	m_triIndexes.clear();
+
+	if (!mesh)
+	{
+		assert(false);
+		return false;
+	}
+
+	ccGenericPointCloud* vertices = mesh->getAssociatedCloud();
+	unsigned triCount = mesh->size();
+	if (!vertices || triCount == 0)
+	{
+		return false;
+	}
+	m_verticesVersion = GetVerticesVersion(mesh);
+
+	//triangle centers (only used during the construction)
+	std::vector<CCVector3> centers;
+	try
+	{
+		centers.resize(triCount);
+		m_triIndexes.resize(triCount);
+		m_nodes.reserve(2 * (triCount / c_leafSize) + 1);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		m_nodes.clear();
+		m_triIndexes.clear();
+		return false;
+	}
+
+#if defined(_OPENMP)
+	#pragma omp parallel for
+#endif
+	for (int i = 0; i < static_cast<int>(triCount); ++i)
+	{
+		const CCLib::VerticesIndexes* tsi = mesh->getTriangleVertIndexes(i);
+		const CCVector3* A = vertices->getPoint(tsi->i1);
+		const CCVector3* B = vertices->getPoint(tsi->i2);
+		const CCVector3* C = vertices->getPoint(tsi->i3);
+		centers[i] = (*A + *B + *C) / 3;
+		m_triIndexes[i] = static_cast<unsigned>(i);
+	}
+
+	//top-down construction (median split along the largest dimension of the centers)
+	struct BuildTask
+	{
+		unsigned nodeIndex;
+		unsigned first;
+		unsigned last; //excluded
+	};
+
+	try
+	{
+		std::vector<BuildTask> tasks;
+		m_nodes.resize(1);
+		BuildTask rootTask = { 0, 0, triCount };
+		tasks.push_back(rootTask);
+
+		while (!tasks.empty())
+		{
+			BuildTask task = tasks.back();
+			tasks.pop_back();
+
+			//bounding-boxes of the triangles and of their centers
+			CCVector3 bbMin = *vertices->getPoint(mesh->getTriangleVertIndexes(m_triIndexes[task.first])->i1);
+			CCVector3 bbMax = bbMin;
+			CCVector3 cMin = centers[m_triIndexes[task.first]];
+			CCVector3 cMax = cMin;
+			for (unsigned k = task.first; k < task.last; ++k)
+			{
+				unsigned triIndex = m_triIndexes[k];
+				const CCLib::VerticesIndexes* tsi = mesh->getTriangleVertIndexes(triIndex);
+				const CCVector3* P[3] = {	vertices->getPoint(tsi->i1),
+											vertices->getPoint(tsi->i2),
+											vertices->getPoint(tsi->i3) };
+				for (unsigned j = 0; j < 3; ++j)
+				{
+					for (unsigned d = 0; d < 3; ++d)
+					{
+						bbMin.u[d] = std::min(bbMin.u[d], P[j]->u[d]);
+						bbMax.u[d] = std::max(bbMax.u[d], P[j]->u[d]);
+					}
+				}
+				const CCVector3& center = centers[triIndex];
+				for (unsigned d = 0; d < 3; ++d)
+				{
+					cMin.u[d] = std::min(cMin.u[d], center.u[d]);
+					cMax.u[d] = std::max(cMax.u[d], center.u[d]);
+				}
+			}
+
+			Node& node = m_nodes[task.nodeIndex];
+			node.bbMin = bbMin;
+			node.bbMax = bbMax;
+
+			//split dimension
+			CCVector3 cDiag = cMax - cMin;
+			unsigned char dim = (cDiag.x >= cDiag.y ? (cDiag.x >= cDiag.z ? 0 : 2) : (cDiag.y >= cDiag.z ? 1 : 2));
+
+			unsigned count = task.last - task.first;
+			if (count <= c_leafSize || cDiag.u[dim] <= 0)
+			{
+				//leaf
+				node.index = task.first;
+				node.count = count;
+				continue;
+			}
+
+			unsigned middle = task.first + count / 2;
+			std::nth_element(	m_triIndexes.begin() + task.first,
+								m_triIndexes.begin() + middle,
+								m_triIndexes.begin() + task.last,
+								[&](unsigned a, unsigned b) { return centers[a].u[dim] < centers[b].u[dim]; });
+
+			//the two children are stored next to each other
+			unsigned childIndex = static_cast<unsigned>(m_nodes.size());
+			node.index = childIndex;
+			node.count = 0;
+			m_nodes.resize(m_nodes.size() + 2); //warning: invalidates 'node'
+
+			BuildTask leftTask = { childIndex, task.first, middle };
+			BuildTask rightTask = { childIndex + 1, middle, task.last };
+			tasks.push_back(rightTask);
+			tasks.push_back(leftTask);
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		m_nodes.clear();
+		m_triIndexes.clear();
+		return false;
+	}
+
+	m_nodes.shrink_to_fit();
+
+	return true;
+}
+
+bool ccTriangleBVH::raycast(ccGenericMesh* mesh,
+							const CCVector3d& rayOrigin,
+							const CCVector3d& rayAxis,
+							unsigned& triIndex,
+							CCVector3d& hitPoint) const
+{
+	if (!isValidFor(mesh))
+	{
+		assert(false);
+		return false;
+	}
+
+	ccGenericPointCloud* vertices = mesh->getAssociatedCloud();
+	if (!vertices)
+	{
+		assert(false);
+		return false;
+	}
+
+	CCVector3d dir = rayAxis;
+	dir.normalize();
+	Ray<double> ray(dir, rayOrigin);
+
+	double bestT = std::numeric_limits<double>::max();
+	bool found = false;
+
+	//returns the distance (along the ray) at which the ray enters a node (or -1 if it misses it)
+	auto enter = [&](const Node& node) -> double
+	{
+		AABB<double> box(	CCVector3d(node.bbMin.x, node.bbMin.y, node.bbMin.z),
+							CCVector3d(node.bbMax.x, node.bbMax.y, node.bbMax.z));
+		double t0 = 0, t1 = 0;
+		if (!box.intersects(ray, &t0, &t1) || t1 < 0 || t0 > bestT)
+		{
+			return -1.0;
+		}
+		return std::max(0.0, t0);
+	};
+
+	if (enter(m_nodes[0]) < 0)
+	{
+		return false;
+	}
+
+	std::vector<std::pair<unsigned, double> > stack;
+	stack.reserve(64);
+	stack.push_back(std::make_pair(0u, 0.0));
+
+	while (!stack.empty())
+	{
+		std::pair<unsigned, double> current = stack.back();
+		stack.pop_back();
+		if (current.second > bestT)
+		{
+			//a closer triangle has been found in the meantime
+			continue;
+		}
+
+		const Node& node = m_nodes[current.first];
+		if (node.count != 0)
+		{
+			//leaf: Moller-Trumbore ray/triangle intersection
+			for (unsigned k = node.index; k < node.index + node.count; ++k)
+			{
+				const CCLib::VerticesIndexes* tsi = mesh->getTriangleVertIndexes(m_triIndexes[k]);
+				const CCVector3* A3D = vertices->getPoint(tsi->i1);
+				const CCVector3* B3D = vertices->getPoint(tsi->i2);
+				const CCVector3* C3D = vertices->getPoint(tsi->i3);
+				CCVector3d A(A3D->x, A3D->y, A3D->z);
+				CCVector3d AB = CCVector3d(B3D->x, B3D->y, B3D->z) - A;
+				CCVector3d AC = CCVector3d(C3D->x, C3D->y, C3D->z) - A;
+
+				CCVector3d p = ray.dir.cross(AC);
+				double det = AB.dot(p);
+				if (det == 0)
+				{
+					//ray parallel to the triangle (or degenerate triangle)
+					continue;
+				}
+				double invDet = 1.0 / det;
+
+				CCVector3d s = ray.origin - A;
+				double u = s.dot(p) * invDet;
+				if (u < -c_baryTolerance || u > 1.0 + c_baryTolerance)
+					continue;
+
+				CCVector3d q = s.cross(AB);
+				double v = ray.dir.dot(q) * invDet;
+				if (v < -c_baryTolerance || u + v > 1.0 + c_baryTolerance)
+					continue;
+
+				double t = AC.dot(q) * invDet;
+				if (t >= 0 && t < bestT)
+				{
+					bestT = t;
+					triIndex = m_triIndexes[k];
+					found = true;
+				}
+			}
+		}
+		else
+		{
+			//visit the nearest child first
+			double tLeft = enter(m_nodes[node.index]);
+			double tRight = enter(m_nodes[node.index + 1]);
+			if (tLeft >= 0 && tRight >= 0)
+			{
+				if (tLeft <= tRight)
+				{
+					stack.push_back(std::make_pair(node.index + 1, tRight));
+					stack.push_back(std::make_pair(node.index, tLeft));
+				}
+				else
+				{
+					stack.push_back(std::make_pair(node.index, tLeft));
+					stack.push_back(std::make_pair(node.index + 1, tRight));
+				}
+			}
+			else if (tLeft >= 0)
+			{
+				stack.push_back(std::make_pair(node.index, tLeft));
+			}
+			else if (tRight >= 0)
+			{
+				stack.push_back(std::make_pair(node.index + 1, tRight));
+			}
+		}
+	}
+
+	if (found)
+	{
+		hitPoint = ray.origin + ray.dir * bestT;
+	}
+
+	return found;
+}
@@ -0,0 +1,103 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_TRIANGLE_BVH_HEADER
+#define CC_TRIANGLE_BVH_HEADER
+
+//Local
+#include "qCC_db.h"
+
+//CCLib
+#include <CCGeom.h>
+
+//Qt
+#include <QSharedPointer>
+
+//System
+#include <vector>
+
+class ccGenericMesh;
+
+//! Bounding Volume Hierarchy of the triangles of a mesh
+/** Used to accelerate ray casting (i.e. triangle picking). The hierarchy is
+	expressed in the mesh local coordinate system and only stores triangle
+	indexes: it must be rebuilt each time the mesh geometry changes.
+**/
+class QCC_DB_LIB_API ccTriangleBVH
+{
+public:
+
+	//! Shared pointer
+	typedef QSharedPointer<ccTriangleBVH> Shared;
+
+	//! Default constructor
+	ccTriangleBVH();
+
+	//! Builds the hierarchy
+	/** \param mesh mesh
+		\return success (may fail if not enough memory)
+	**/
+	bool build(ccGenericMesh* mesh);
+
+	//! Returns whether the hierarchy can be used with a given mesh
+	/** Only a quick consistency check is performed: the triangle count and,
+		if the vertices are a real point cloud, its display data version
+		(see ccPointCloud::getDisplayDataVersion).
+	**/
+	bool isValidFor(ccGenericMesh* mesh) const;
+
+	//! Returns the nearest triangle hit by a ray
+	/** The ray is expressed in the mesh local coordinate system.
+		Both faces of the triangles are considered.
+		\param mesh mesh (the same as the one used to build the hierarchy)
+		\param rayOrigin ray origin
+		\param rayAxis ray direction (doesn't need to be normalized)
+		\param[out] triIndex nearest triangle index
+		\param[out] hitPoint intersection point
+		\return whether a triangle has been hit
+	**/
+	bool raycast(	ccGenericMesh* mesh,
+					const CCVector3d& rayOrigin,
+					const CCVector3d& rayAxis,
+					unsigned& triIndex,
+					CCVector3d& hitPoint) const;
+
+	//! Returns the approximate memory used by the hierarchy (in bytes)
+	size_t memory() const;
+
+protected:
+
+	//! Hierarchy node
+	struct Node
+	{
+		//! Bounding-box
+		CCVector3 bbMin, bbMax;
+		//! Index of the first triangle (leaf) or of the second child (inner node - the first one is the next node)
+		unsigned index;
+		//! Number of triangles (0 for inner nodes)
+		unsigned count;
+	};
+
+	//! Nodes (the first one is the root)
+	std::vector<Node> m_nodes;
+	//! Triangle indexes (sorted by leaf)
+	std::vector<unsigned> m_triIndexes;
+	//! Display data version of the vertices when the hierarchy was built
+	unsigned m_verticesVersion;
+};
+
+#endif //CC_TRIANGLE_BVH_HEADER
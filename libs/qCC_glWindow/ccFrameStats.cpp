@@ -0,0 +1,507 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#include "ccFrameStats.h"
+
+//Qt
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QOpenGLTimeMonitor>
+
+//System
+#include <assert.h>
+#include <algorithm>
+
+//! Max number of GPU timers waiting for their results
+static const size_t MAX_PENDING_GPU_TIMERS = 4;
+
+const char* ccFrameStats::GetPassName(Pass pass)
+{
+	switch (pass)
+	{
+	case BACKGROUND_PASS:
+		return "Background";
+	case SCENE_3D_PASS:
+		return "3D scene";
+	case GL_FILTER_PASS:
+		return "GL filter";
+	case FOREGROUND_PASS:
+		return "Foreground";
+	default:
+		assert(false);
+		break;
+	}
+	return "Unknown";
+}
+
+ccFrameStats::Frame::Frame()
+	: index(0)
+	, start_ns(0)
+	, cpuTime_ns(0)
+	, lodLevel(0)
+{
+	for (int i = 0; i < PASS_COUNT; ++i)
+	{
+		passStart_ns[i] = -1;
+		passCpuTime_ns[i] = 0;
+		passGpuTime_ns[i] = -1;
+	}
+}
+
+ccFrameStats::ccFrameStats(size_t capacity/*=1024*/)
+	: m_frames(std::max<size_t>(capacity, 1))
+	, m_first(0)
+	, m_count(0)
+	, m_current(0)
+	, m_nextIndex(0)
+	, m_inFrame(false)
+	, m_currentPass(-1)
+	, m_passStart_ns(0)
+	, m_gpuTimersSupported(false)
+	, m_gpuTimersTested(false)
+{
+	m_timer.start();
+}
+
+ccFrameStats::~ccFrameStats()
+{
+	//the timers should have been released with the right context being current
+	assert(m_pendingGPUTimers.empty() && m_freeGPUTimers.empty() && !m_currentGPUTimer.monitor);
+}
+
+void ccFrameStats::clear()
+{
+	if (m_currentGPUTimer.monitor)
+	{
+		//its results will be ignored
+		m_pendingGPUTimers.push_back(m_currentGPUTimer);
+		m_currentGPUTimer = GPUTimer();
+	}
+
+	m_first = m_count = m_current = 0;
+	m_inFrame = false;
+	m_currentPass = -1;
+}
+
+ccFrameStats::Frame* ccFrameStats::findFrame(quint64 index)
+{
+	if (m_count == 0)
+	{
+		return 0;
+	}
+
+	quint64 firstIndex = at(0).index;
+	if (index < firstIndex || index >= firstIndex + m_count)
+	{
+		return 0;
+	}
+
+	Frame& frame = m_frames[(m_first + static_cast<size_t>(index - firstIndex)) % m_frames.size()];
+	assert(frame.index == index);
+	return &frame;
+}
+
+ccFrameStats::Frame& ccFrameStats::beginFrame(unsigned char lodLevel, int gpuPassCount/*=0*/)
+{
+	if (m_inFrame)
+	{
+		//previous frame was not properly ended
+		endFrame();
+	}
+
+	//add a new record (and overwrite the oldest one if necessary)
+	if (m_count == m_frames.size())
+	{
+		m_first = (m_first + 1) % m_frames.size();
+		--m_count;
+	}
+	m_current = (m_first + m_count) % m_frames.size();
+	++m_count;
+
+	Frame& frame = m_frames[m_current];
+	frame = Frame();
+	frame.index = m_nextIndex++;
+	frame.start_ns = m_timer.nsecsElapsed();
+	frame.lodLevel = lodLevel;
+
+	m_inFrame = true;
+	m_currentPass = -1;
+
+	//GPU timer
+	assert(!m_currentGPUTimer.monitor);
+	m_currentGPUTimer = GPUTimer();
+	if (gpuPassCount > 0)
+	{
+		if (!m_gpuTimersTested)
+		{
+			m_gpuTimersTested = true;
+			QOpenGLTimeMonitor testMonitor;
+			testMonitor.setSampleCount(2);
+			m_gpuTimersSupported = testMonitor.create();
+			testMonitor.destroy();
+		}
+
+		int sampleCount = 2 * PASS_COUNT * gpuPassCount;
+		if (m_gpuTimersSupported && m_pendingGPUTimers.size() < MAX_PENDING_GPU_TIMERS)
+		{
+			GPUTimer timer;
+			if (!m_freeGPUTimers.empty())
+			{
+				timer = m_freeGPUTimers.back();
+				m_freeGPUTimers.pop_back();
+				if (timer.monitor->sampleCount() != sampleCount)
+				{
+					timer.monitor->destroy();
+					timer.monitor->setSampleCount(sampleCount);
+					if (!timer.monitor->create())
+					{
+						delete timer.monitor;
+						timer.monitor = 0;
+					}
+				}
+			}
+			else
+			{
+				timer.monitor = new QOpenGLTimeMonitor;
+				timer.monitor->setSampleCount(sampleCount);
+				if (!timer.monitor->create())
+				{
+					delete timer.monitor;
+					timer.monitor = 0;
+				}
+			}
+
+			if (timer.monitor)
+			{
+				timer.frameIndex = frame.index;
+				timer.passCount = gpuPassCount;
+				timer.samplePasses.clear();
+				m_currentGPUTimer = timer;
+			}
+		}
+	}
+
+	return frame;
+}
+
+void ccFrameStats::recordGPUSample()
+{
+	if (!m_currentGPUTimer.monitor)
+	{
+		return;
+	}
+
+	if (static_cast<int>(m_currentGPUTimer.samplePasses.size()) >= m_currentGPUTimer.monitor->sampleCount())
+	{
+		//too many samples
+		assert(false);
+		return;
+	}
+
+	m_currentGPUTimer.monitor->recordSample();
+	m_currentGPUTimer.samplePasses.push_back(m_currentPass);
+}
+
+void ccFrameStats::beginPass(Pass pass)
+{
+	if (!m_inFrame)
+	{
+		return;
+	}
+	if (m_currentPass >= 0)
+	{
+		endPass();
+	}
+
+	m_currentPass = pass;
+	m_passStart_ns = m_timer.nsecsElapsed();
+
+	Frame& frame = m_frames[m_current];
+	if (frame.passStart_ns[pass] < 0)
+	{
+		frame.passStart_ns[pass] = m_passStart_ns - frame.start_ns;
+	}
+
+	recordGPUSample();
+}
+
+void ccFrameStats::endPass()
+{
+	if (!m_inFrame || m_currentPass < 0)
+	{
+		return;
+	}
+
+	m_frames[m_current].passCpuTime_ns[m_currentPass] += m_timer.nsecsElapsed() - m_passStart_ns;
+
+	m_currentPass = -1;
+	recordGPUSample();
+}
+
+void ccFrameStats::endFrame()
+{
+	if (!m_inFrame)
+	{
+		return;
+	}
+	if (m_currentPass >= 0)
+	{
+		endPass();
+	}
+
+	Frame& frame = m_frames[m_current];
+	frame.cpuTime_ns = m_timer.nsecsElapsed() - frame.start_ns;
+	m_inFrame = false;
+
+	if (m_currentGPUTimer.monitor)
+	{
+		if (m_currentGPUTimer.samplePasses.size() >= 2)
+		{
+			//the results will be retrieved later (see collectGPUResults)
+			m_pendingGPUTimers.push_back(m_currentGPUTimer);
+		}
+		else
+		{
+			//nothing recorded
+			m_currentGPUTimer.monitor->reset();
+			m_freeGPUTimers.push_back(m_currentGPUTimer);
+		}
+		m_currentGPUTimer = GPUTimer();
+	}
+}
+
+void ccFrameStats::collectGPUResults()
+{
+	//the results are retrieved in order (queries complete in order)
+	while (!m_pendingGPUTimers.empty())
+	{
+		GPUTimer& timer = m_pendingGPUTimers.front();
+		if (!timer.monitor->isResultAvailable())
+		{
+			break;
+		}
+
+		QVector<GLuint64> samples = timer.monitor->waitForSamples();
+		Frame* frame = findFrame(timer.frameIndex);
+		if (frame)
+		{
+			size_t sampleCount = std::min<size_t>(timer.samplePasses.size(), samples.size());
+			for (size_t i = 0; i + 1 < sampleCount; ++i)
+			{
+				//a 'begin' sample (flagged with the pass index) is always followed by an 'end' sample
+				int pass = timer.samplePasses[i];
+				if (pass >= 0 && samples[static_cast<int>(i + 1)] >= samples[static_cast<int>(i)])
+				{
+					qint64 duration_ns = static_cast<qint64>(samples[static_cast<int>(i + 1)] - samples[static_cast<int>(i)]);
+					if (frame->passGpuTime_ns[pass] < 0)
+						frame->passGpuTime_ns[pass] = duration_ns;
+					else
+						frame->passGpuTime_ns[pass] += duration_ns;
+				}
+			}
+		}
+
+		timer.monitor->reset();
+		m_freeGPUTimers.push_back(timer);
+		m_pendingGPUTimers.erase(m_pendingGPUTimers.begin());
+	}
+}
+
+void ccFrameStats::releaseGPUTimers()
+{
+	if (m_currentGPUTimer.monitor)
+	{
+		m_pendingGPUTimers.push_back(m_currentGPUTimer);
+		m_currentGPUTimer = GPUTimer();
+	}
+
+	for (GPUTimer& timer : m_pendingGPUTimers)
+	{
+		delete timer.monitor;
+	}
+	m_pendingGPUTimers.clear();
+
+	for (GPUTimer& timer : m_freeGPUTimers)
+	{
+		delete timer.monitor;
+	}
+	m_freeGPUTimers.clear();
+}
+
+QStringList ccFrameStats::summary(size_t frameCount/*=60*/) const
+{
+	QStringList lines;
+
+	//we skip the frame in progress (if any)
+	size_t available = (m_inFrame ? m_count - 1 : m_count);
+	frameCount = std::min(frameCount, available);
+	if (frameCount == 0)
+	{
+		lines << "Frame stats: no frame recorded yet";
+		return lines;
+	}
+
+	double frameTime_ms = 0;
+	double cpuTime_ms[PASS_COUNT] = { 0 };
+	double gpuTime_ms[PASS_COUNT] = { 0 };
+	size_t gpuCount[PASS_COUNT] = { 0 };
+	double lodTime_ms = 0;
+	double vboTime_ms = 0;
+	double sfTime_ms = 0;
+	double entityCount = 0;
+	double pointCount = 0;
+
+	for (size_t i = available - frameCount; i < available; ++i)
+	{
+		const Frame& frame = at(i);
+		frameTime_ms += frame.cpuTime_ns / 1.0e6;
+		for (int p = 0; p < PASS_COUNT; ++p)
+		{
+			cpuTime_ms[p] += frame.passCpuTime_ns[p] / 1.0e6;
+			if (frame.passGpuTime_ns[p] >= 0)
+			{
+				gpuTime_ms[p] += frame.passGpuTime_ns[p] / 1.0e6;
+				++gpuCount[p];
+			}
+		}
+		lodTime_ms += frame.draw.lodSelectionTime_ns / 1.0e6;
+		vboTime_ms += frame.draw.vboUpdateTime_ns / 1.0e6;
+		sfTime_ms += frame.draw.sfColorTime_ns / 1.0e6;
+		entityCount += frame.draw.drawnEntityCount;
+		pointCount += frame.draw.submittedPointCount;
+	}
+
+	double n = static_cast<double>(frameCount);
+	lines << QString("Frame stats (average of %1 frames)").arg(frameCount);
+	lines << QString("CPU frame time: %1 ms").arg(frameTime_ms / n, 0, 'f', 2);
+	for (int p = 0; p < PASS_COUNT; ++p)
+	{
+		QString gpuStr = (gpuCount[p] != 0 ? QString::number(gpuTime_ms[p] / gpuCount[p], 'f', 2) : QString("-"));
+		lines << QString("%1: %2 / %3 ms").arg(GetPassName(static_cast<Pass>(p))).arg(cpuTime_ms[p] / n, 0, 'f', 2).arg(gpuStr);
+	}
+	lines << QString("LOD selection: %1 ms").arg(lodTime_ms / n, 0, 'f', 2);
+	lines << QString("VBO update: %1 ms").arg(vboTime_ms / n, 0, 'f', 2);
+	lines << QString("SF colors: %1 ms").arg(sfTime_ms / n, 0, 'f', 2);
+	lines << QString("Entities: %1").arg(entityCount / n, 0, 'f', 0);
+	lines << QString("Points: %1").arg(pointCount / n, 0, 'f', 0);
+
+	return lines;
+}
+
+bool ccFrameStats::saveTrace(const QString& filename) const
+{
+	QFile file(filename);
+	if (!file.open(QFile::WriteOnly | QFile::Truncate))
+	{
+		return false;
+	}
+
+	static const int PID = 1;
+	static const int CPU_TID = 1;
+
+	QJsonArray events;
+	for (size_t i = 0; i < m_count; ++i)
+	{
+		const Frame& frame = at(i);
+		if (m_inFrame && i + 1 == m_count)
+		{
+			//frame in progress
+			break;
+		}
+
+		double frameStart_us = frame.start_ns / 1.0e3;
+
+		//whole frame
+		{
+			QJsonObject args;
+			args["index"] = static_cast<double>(frame.index);
+			args["lodLevel"] = frame.lodLevel;
+			args["entities"] = static_cast<int>(frame.draw.drawnEntityCount);
+			args["points"] = static_cast<double>(frame.draw.submittedPointCount);
+			args["lodSelection_ms"] = frame.draw.lodSelectionTime_ns / 1.0e6;
+			args["vboUpdate_ms"] = frame.draw.vboUpdateTime_ns / 1.0e6;
+			args["sfColors_ms"] = frame.draw.sfColorTime_ns / 1.0e6;
+
+			QJsonObject event;
+			event["name"] = "Frame";
+			event["cat"] = "frame";
+			event["ph"] = "X";
+			event["ts"] = frameStart_us;
+			event["dur"] = frame.cpuTime_ns / 1.0e3;
+			event["pid"] = PID;
+			event["tid"] = CPU_TID;
+			event["args"] = args;
+			events.append(event);
+		}
+
+		//passes
+		QJsonObject gpuTimes;
+		for (int p = 0; p < PASS_COUNT; ++p)
+		{
+			if (frame.passStart_ns[p] >= 0)
+			{
+				QJsonObject event;
+				event["name"] = GetPassName(static_cast<Pass>(p));
+				event["cat"] = "pass";
+				event["ph"] = "X";
+				event["ts"] = frameStart_us + frame.passStart_ns[p] / 1.0e3;
+				event["dur"] = frame.passCpuTime_ns[p] / 1.0e3;
+				event["pid"] = PID;
+				event["tid"] = CPU_TID;
+				events.append(event);
+			}
+			if (frame.passGpuTime_ns[p] >= 0)
+			{
+				gpuTimes[GetPassName(static_cast<Pass>(p))] = frame.passGpuTime_ns[p] / 1.0e6;
+			}
+		}
+
+		//GPU times (as counters: timer queries don't give absolute times)
+		if (!gpuTimes.isEmpty())
+		{
+			QJsonObject event;
+			event["name"] = "GPU time (ms)";
+			event["ph"] = "C";
+			event["ts"] = frameStart_us;
+			event["pid"] = PID;
+			event["args"] = gpuTimes;
+			events.append(event);
+		}
+
+		//points
+		{
+			QJsonObject args;
+			args["points"] = static_cast<double>(frame.draw.submittedPointCount);
+
+			QJsonObject event;
+			event["name"] = "Submitted points";
+			event["ph"] = "C";
+			event["ts"] = frameStart_us;
+			event["pid"] = PID;
+			event["args"] = args;
+			events.append(event);
+		}
+	}
+
+	QJsonObject root;
+	root["traceEvents"] = events;
+	root["displayTimeUnit"] = "ms";
+
+	return file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) >= 0;
+}
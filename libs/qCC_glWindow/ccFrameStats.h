@@ -0,0 +1,196 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_FRAME_STATS_HEADER
+#define CC_FRAME_STATS_HEADER
+
+//qCC_db
+#include <ccGLDrawContext.h>
+
+//Qt
+#include <QElapsedTimer>
+#include <QStringList>
+
+//System
+#include <vector>
+
+class QOpenGLTimeMonitor;
+
+//! Rendering statistics of the last frames displayed by a 3D view
+/** The statistics are kept in a ring buffer: CPU time of each rendering pass,
+	GPU time of each pass (with timer queries, if supported), number of
+	entities drawn, number of points sent to the GPU, etc.
+
+	GPU results are only available a few frames later: they are retrieved
+	without stalling the pipeline (frames for which no timer query was
+	available don't get any GPU time).
+**/
+class ccFrameStats
+{
+public:
+
+	//! Rendering passes
+	enum Pass
+	{
+		BACKGROUND_PASS = 0,
+		SCENE_3D_PASS,
+		GL_FILTER_PASS,
+		FOREGROUND_PASS,
+		PASS_COUNT
+	};
+
+	//! Returns the name of a pass
+	static const char* GetPassName(Pass pass);
+
+	//! Frame record
+	struct Frame
+	{
+		//! Default constructor
+		Frame();
+
+		//! Frame index
+		quint64 index;
+		//! Start time (in ns, relative to the creation of the statistics)
+		qint64 start_ns;
+		//! Total CPU time (in ns)
+		qint64 cpuTime_ns;
+		//! Start time of each pass (in ns, relative to the frame start - first occurrence in stereo mode)
+		qint64 passStart_ns[PASS_COUNT];
+		//! CPU time of each pass (in ns)
+		qint64 passCpuTime_ns[PASS_COUNT];
+		//! GPU time of each pass (in ns - negative if not available)
+		qint64 passGpuTime_ns[PASS_COUNT];
+		//! Entities statistics
+		ccGLDrawStats draw;
+		//! LOD level
+		unsigned char lodLevel;
+	};
+
+	//! Default constructor
+	/** \param capacity max number of frames kept in memory
+	**/
+	explicit ccFrameStats(size_t capacity = 1024);
+
+	//! Destructor
+	/** \warning releaseGPUTimers should be called before (with the right context being current)
+	**/
+	virtual ~ccFrameStats();
+
+	//! Clears all the records
+	void clear();
+
+	//! Returns the number of recorded frames
+	size_t size() const { return m_count; }
+
+	//! Returns a recorded frame (0 = oldest)
+	const Frame& at(size_t i) const { return m_frames[(m_first + i) % m_frames.size()]; }
+
+	//! Starts a new frame
+	/** \param lodLevel current LOD level
+		\param gpuPassCount number of rendering passes to time on the GPU side (0 = no GPU timing)
+		\return the new frame record (valid until the next call)
+	**/
+	Frame& beginFrame(unsigned char lodLevel, int gpuPassCount = 0);
+
+	//! Starts a pass (of the current frame)
+	void beginPass(Pass pass);
+
+	//! Ends the current pass
+	void endPass();
+
+	//! Ends the current frame
+	void endFrame();
+
+	//! Returns whether a frame is in progress
+	bool frameInProgress() const { return m_inFrame; }
+
+	//! Returns the statistics of the current frame (to be filled by the entities)
+	ccGLDrawStats* currentDrawStats() { return m_inFrame ? &m_frames[m_current].draw : 0; }
+
+	//! Retrieves the available GPU results (the OpenGL context must be current)
+	void collectGPUResults();
+
+	//! Releases the GPU timer queries (the OpenGL context must be current)
+	void releaseGPUTimers();
+
+	//! Returns whether GPU timer queries are supported (once the first frame has been rendered)
+	bool gpuTimersSupported() const { return m_gpuTimersSupported; }
+
+	//! Returns a summary of the last frames (one line per item)
+	QStringList summary(size_t frameCount = 60) const;
+
+	//! Saves the recorded frames as a trace file
+	/** The 'Trace Event' JSON format is used (it can be loaded in
+		chrome://tracing or Perfetto for instance).
+	**/
+	bool saveTrace(const QString& filename) const;
+
+protected:
+
+	//! Returns the frame with a given index (if it's still in the buffer)
+	Frame* findFrame(quint64 index);
+
+	//! Records a GPU timestamp (if a timer is active)
+	void recordGPUSample();
+
+	//! GPU timer
+	struct GPUTimer
+	{
+		GPUTimer() : monitor(0), frameIndex(0), passCount(0) {}
+
+		//! Time monitor (one sample per pass boundary)
+		QOpenGLTimeMonitor* monitor;
+		//! Pass index of each 'begin' sample (-1 for 'end' samples)
+		std::vector<int> samplePasses;
+		//! Frame index
+		quint64 frameIndex;
+		//! Number of rendering passes
+		int passCount;
+	};
+
+	//! Recorded frames (ring buffer)
+	std::vector<Frame> m_frames;
+	//! Index of the oldest frame
+	size_t m_first;
+	//! Number of recorded frames
+	size_t m_count;
+	//! Index of the current frame in the buffer
+	size_t m_current;
+	//! Index of the next frame
+	quint64 m_nextIndex;
+	//! Whether a frame is in progress
+	bool m_inFrame;
+	//! Current pass
+	int m_currentPass;
+	//! Current pass start (in ns)
+	qint64 m_passStart_ns;
+	//! Timer
+	QElapsedTimer m_timer;
+
+	//! Whether GPU timer queries are supported
+	bool m_gpuTimersSupported;
+	//! Whether GPU timer queries support has been tested
+	bool m_gpuTimersTested;
+	//! GPU timers waiting for their results
+	std::vector<GPUTimer> m_pendingGPUTimers;
+	//! Available GPU timers
+	std::vector<GPUTimer> m_freeGPUTimers;
+	//! GPU timer of the current frame (if any)
+	GPUTimer m_currentGPUTimer;
+};
+
+#endif //CC_FRAME_STATS_HEADER
@@ -31,6 +31,7 @@
 #include <ccPolyline.h>
 #include <ccPointCloud.h>
 #include <ccColorRampShader.h>
+#include <ccNormalDecodeShader.h>
 #include <ccClipBox.h>
 #include <ccSubMesh.h>
 
@@ -46,7 +47,7 @@
 #include <QMessageBox>
 #include <QMimeData>
 #include <QMouseEvent>
-#include <QPushButton>
+#include <QOffscreenSurface>
 #include <QSettings>
 #ifdef CC_GL_WINDOW_USE_QWINDOW
 #include <QOpenGLPaintDevice>
@@ -240,7 +241,10 @@ ccGLWindow::ccGLWindow(QSurfaceFormat* format/*=0*/,
 	, m_context(0)
 	, m_device(new QOpenGLPaintDevice)
 	, m_parentWidget(0)
+#else
+	, m_offscreenContext(0)
 #endif
+	, m_offscreenSurface(0)
 	, m_uniqueID(++s_GlWindowNumber) //GL window unique ID
 	, m_initialized(false)
 	, m_trihedronGLList(GL_INVALID_LIST_ID)
@@ -273,6 +277,7 @@ ccGLWindow::ccGLWindow(QSurfaceFormat* format/*=0*/,
 	, m_alwaysUseFBO(false)
 	, m_updateFBO(true)
 	, m_colorRampShader(0)
+	, m_normalDecodeShader(0)
 	, m_customRenderingShader(0)
 	, m_activeGLFilter(0)
 	, m_glFiltersEnabled(false)
@@ -301,6 +306,7 @@ ccGLWindow::ccGLWindow(QSurfaceFormat* format/*=0*/,
 	, m_formerParent(0)
 	, m_exclusiveFullscreen(false)
 	, m_showDebugTraces(false)
+	, m_frameStatsEnabled(false)
 	, m_pickRadius(DefaultPickRadius)
 	, m_glExtFuncSupported(false)
 	, m_autoRefresh(false)
@@ -446,12 +452,24 @@ ccGLWindow::~ccGLWindow()
 	if (m_colorRampShader)
 		delete m_colorRampShader;
 
+	if (m_normalDecodeShader)
+	{
+		makeCurrent(); //to release the table of normals
+		delete m_normalDecodeShader;
+	}
+
 	if (m_customRenderingShader)
 		delete m_customRenderingShader;
 
 	if (m_activeShader)
 		delete m_activeShader;
 
+	if (m_frameStatsEnabled)
+	{
+		makeCurrent(); //to release the GPU timers
+		m_frameStats.releaseGPUTimers();
+	}
+
 	if (m_fbo)
 		delete m_fbo;
 	if (m_fbo2)
@@ -465,6 +483,15 @@ ccGLWindow::~ccGLWindow()
 		delete m_device;
 #endif
 
+	if (m_offscreenSurface)
+	{
+		//the context must be released before its surface
+		if (context())
+			context()->doneCurrent();
+		delete m_offscreenSurface;
+		m_offscreenSurface = 0;
+	}
+
 	if (m_hotZone)
 		delete m_hotZone;
 }
@@ -491,10 +518,16 @@ void ccGLWindow::makeCurrent()
 #ifdef CC_GL_WINDOW_USE_QWINDOW
 	if (m_context)
 	{
-		m_context->makeCurrent(this);
+		if (m_offscreenSurface)
+			m_context->makeCurrent(m_offscreenSurface);
+		else
+			m_context->makeCurrent(this);
 	}
 #else
-	QOpenGLWidget::makeCurrent();
+	if (m_offscreenContext)
+		m_offscreenContext->makeCurrent(m_offscreenSurface);
+	else
+		QOpenGLWidget::makeCurrent();
 #endif
 
 	if (m_activeFbo)
@@ -666,7 +699,10 @@ bool ccGLWindow::initialize()
 	{
 		return false;
 	}
-	m_context->makeCurrent(this);
+	if (m_offscreenSurface)
+		m_context->makeCurrent(m_offscreenSurface);
+	else
+		m_context->makeCurrent(this);
 #endif
 
 	ccQOpenGLFunctions* glFunc = functions();
@@ -812,6 +848,42 @@ bool ccGLWindow::initialize()
 				}
 			}
 
+			//normal decoding shader
+			if (!m_normalDecodeShader)
+			{
+				if (!ccNormalDecodeShader::IsSupported(glFunc))
+				{
+					if (!m_silentInitialization)
+						ccLog::Warning("[3D View %i] Normals will be decoded on the CPU side (vertex texture fetch not supported)", m_uniqueID);
+				}
+				else
+				{
+					ccNormalDecodeShader* normalDecodeShader = new ccNormalDecodeShader();
+					QString shadersPath = ccGLWindow::getShadersPath();
+					QString error;
+					if (!normalDecodeShader->loadProgram(shadersPath + QString("/NormalDecode/normal_decode.vert"), QString(), error))
+					{
+						if (!m_silentInitialization)
+							ccLog::Warning(QString("[3D View %1] Failed to load normal decoding shader: '%2'").arg(m_uniqueID).arg(error));
+						delete normalDecodeShader;
+						normalDecodeShader = 0;
+					}
+					else if (!normalDecodeShader->initTable())
+					{
+						if (!m_silentInitialization)
+							ccLog::Warning(QString("[3D View %1] Failed to load the table of normals on the GPU (not enough memory?)").arg(m_uniqueID));
+						delete normalDecodeShader;
+						normalDecodeShader = 0;
+					}
+					else
+					{
+						if (!m_silentInitialization)
+							ccLog::Print("[3D View %i] Normal decoding shader loaded successfully", m_uniqueID);
+						m_normalDecodeShader = normalDecodeShader;
+					}
+				}
+			}
+
 			//stereo mode
 			if (!m_silentInitialization)
 			{
@@ -901,6 +973,74 @@ bool ccGLWindow::initialize()
 	return true;
 }
 
+bool ccGLWindow::initializeOffscreen(int width, int height)
+{
+	if (m_initialized || m_offscreenSurface || isVisible())
+	{
+		//the view must be brand new
+		assert(false);
+		return false;
+	}
+
+	if (width <= 0 || height <= 0)
+	{
+		assert(false);
+		return false;
+	}
+
+	//the context is created here (and not by Qt when the view is shown)
+	QOpenGLContext* offscreenContext = new QOpenGLContext(this);
+#ifdef CC_GL_WINDOW_USE_QWINDOW
+	offscreenContext->setFormat(m_format);
+#else
+	offscreenContext->setFormat(format());
+#endif
+	offscreenContext->setShareContext(QOpenGLContext::globalShareContext());
+	if (!offscreenContext->create())
+	{
+		ccLog::Warning("[ccGLWindow] Failed to create the offscreen OpenGL context");
+		delete offscreenContext;
+		return false;
+	}
+
+	m_offscreenSurface = new QOffscreenSurface;
+	m_offscreenSurface->setFormat(offscreenContext->format());
+	m_offscreenSurface->create();
+	if (!m_offscreenSurface->isValid())
+	{
+		ccLog::Warning("[ccGLWindow] Failed to create the offscreen surface");
+		delete m_offscreenSurface;
+		m_offscreenSurface = 0;
+		delete offscreenContext;
+		return false;
+	}
+
+#ifdef CC_GL_WINDOW_USE_QWINDOW
+	m_context = offscreenContext;
+#else
+	m_offscreenContext = offscreenContext;
+#endif
+
+	//the view is never shown: its size is only used by the rendering methods
+	resize(width, height);
+
+	makeCurrent();
+	if (!initialize())
+	{
+		return false;
+	}
+	setGLViewport(0, 0, width, height);
+
+	//there's no default framebuffer: everything is rendered in FBOs
+	if (!m_glExtFuncSupported)
+	{
+		ccLog::Warning("[ccGLWindow] Offscreen rendering requires FBO support");
+		return false;
+	}
+
+	return true;
+}
+
 void ccGLWindow::uninitializeGL()
 {
 	if (!m_initialized)
@@ -1179,6 +1319,42 @@ void ccGLWindow::stopFrameRateTest()
 	redraw();
 }
 
+void ccGLWindow::enableFrameStats(bool state)
+{
+	if (m_frameStatsEnabled == state)
+	{
+		return;
+	}
+
+	if (!state && m_initialized)
+	{
+		makeCurrent(); //to release the GPU timers
+		m_frameStats.releaseGPUTimers();
+	}
+	m_frameStats.clear();
+	m_frameStatsEnabled = state;
+
+	redraw(true, false);
+}
+
+bool ccGLWindow::saveFrameStats(const QString& filename) const
+{
+	if (m_frameStats.size() == 0)
+	{
+		ccLog::Warning("[ccGLWindow] No rendering statistics to save");
+		return false;
+	}
+
+	if (!m_frameStats.saveTrace(filename))
+	{
+		ccLog::Error(QString("Failed to save the rendering statistics to '%1'").arg(filename));
+		return false;
+	}
+
+	ccLog::Print(QString("[ccGLWindow] Rendering statistics of %1 frames saved to '%2'").arg(m_frameStats.size()).arg(filename));
+	return true;
+}
+
 void ccGLWindow::drawClickableItems(int xStart0, int& yStart)
 {
 	//we init the necessary parameters the first time we need them
@@ -1361,7 +1537,12 @@ GLuint ccGLWindow::defaultQtFBO() const
 
 #else
 
-	if (m_stereoModeEnabled && m_stereoParams.glassType == StereoParams::NVIDIA_VISION)
+	if (m_offscreenSurface)
+	{
+		//no widget FBO in offscreen mode
+		return 0;
+	}
+	else if (m_stereoModeEnabled && m_stereoParams.glassType == StereoParams::NVIDIA_VISION)
 	{
 		return 0;
 	}
@@ -1404,6 +1585,12 @@ void ccGLWindow::paintGL()
 
 	qint64 startTime_ms = m_currentLODState.inProgress ? m_timer.elapsed() : 0;
 
+	if (m_frameStatsEnabled)
+	{
+		m_frameStats.collectGPUResults();
+		m_frameStats.beginFrame(m_currentLODState.level, m_stereoModeEnabled ? 2 : 1);
+	}
+
 	if (m_scheduledFullRedrawTime != 0)
 	{
 		//scheduled redraw is (about to be) done
@@ -1416,6 +1603,7 @@ void ccGLWindow::paintGL()
 	//context initialization
 	CC_DRAW_CONTEXT CONTEXT;
 	getContext(CONTEXT);
+	CONTEXT.stats = (m_frameStatsEnabled ? m_frameStats.currentDrawStats() : 0);
 
 	//rendering parameters
 	RenderingParams renderingParams;
@@ -1477,6 +1665,11 @@ void ccGLWindow::paintGL()
 	}
 #endif
 
+	if (m_frameStatsEnabled)
+	{
+		m_frameStats.endFrame();
+	}
+
 	m_shouldBeRefreshed = false;
 
 	if (!m_stereoModeEnabled && m_autoPickPivotAtCenter && !m_mouseMoved && m_autoPivotCandidate.norm2d() != 0)
@@ -1665,6 +1858,10 @@ void ccGLWindow::fullRenderingPass(CC_DRAW_CONTEXT& CONTEXT, RenderingParams& re
 		diagStrings << QString("GL filter %1").arg(m_fbo && renderingParams.useFBO && m_activeGLFilter ? "ON" : "OFF");
 		diagStrings << QString("LOD %1 (level %2)").arg(m_currentLODState.inProgress ? "ON" : "OFF").arg(m_currentLODState.level);
 	}
+	if (m_frameStatsEnabled && renderingParams.passIndex == 0)
+	{
+		diagStrings << m_frameStats.summary();
+	}
 
 	ccQOpenGLFunctions* glFunc = functions();
 	assert(glFunc);
@@ -1806,7 +2003,9 @@ void ccGLWindow::fullRenderingPass(CC_DRAW_CONTEXT& CONTEXT, RenderingParams& re
 			renderingParams.clearColorLayer = false;
 		}
 
+		m_frameStats.beginPass(ccFrameStats::BACKGROUND_PASS);
 		drawBackground(CONTEXT, renderingParams);
+		m_frameStats.endPass();
 	}
 
 	/*********************/
@@ -1854,7 +2053,14 @@ void ccGLWindow::fullRenderingPass(CC_DRAW_CONTEXT& CONTEXT, RenderingParams& re
 			}
 		}
 
+		m_frameStats.beginPass(ccFrameStats::SCENE_3D_PASS);
 		draw3D(CONTEXT, renderingParams);
+		m_frameStats.endPass();
+
+		if (m_showDebugTraces && m_currentLODState.inProgress)
+		{
+			diagStrings << QString("LOD points: %1 submitted / %2 visible").arg(CONTEXT.lodSubmittedPointCount).arg(CONTEXT.lodVisiblePointCount);
+		}
 
 		if (m_stereoModeEnabled && m_stereoParams.isAnaglyph())
 		{
@@ -1882,12 +2088,18 @@ void ccGLWindow::fullRenderingPass(CC_DRAW_CONTEXT& CONTEXT, RenderingParams& re
 		//draw black background
 		{
 			int heigth = (diagStrings.size() + 1) * 10;
+			int width = 200;
+			QFontMetrics fm(m_font);
+			for (const QString& str : diagStrings)
+			{
+				width = std::max(width, fm.width(str) + 20);
+			}
 			glColor3ubv_safe<ccQOpenGLFunctions>(glFunc, ccColor::black.rgba);
 			glFunc->glBegin(GL_QUADS);
 			glFunc->glVertex2i(x, m_glViewport.height() - y);
 			glFunc->glVertex2i(x, m_glViewport.height() - (y + heigth));
-			glFunc->glVertex2i(x + 200, m_glViewport.height() - (y + heigth));
-			glFunc->glVertex2i(x + 200, m_glViewport.height() - y);
+			glFunc->glVertex2i(x + width, m_glViewport.height() - (y + heigth));
+			glFunc->glVertex2i(x + width, m_glViewport.height() - y);
 			glFunc->glEnd();
 		}
 
@@ -1942,7 +2154,9 @@ void ccGLWindow::fullRenderingPass(CC_DRAW_CONTEXT& CONTEXT, RenderingParams& re
 					parameters.zoom = m_viewportParams.perspectiveView ? computePerspectiveZoom() : m_viewportParams.zoom; //TODO: doesn't work well with EDL in perspective mode!
 				}
 				//apply shader
+				m_frameStats.beginPass(ccFrameStats::GL_FILTER_PASS);
 				m_activeGLFilter->shade(depthTex, colorTex, parameters);
+				m_frameStats.endPass();
 				logGLError("ccGLWindow::paintGL/glFilter shade");
 				bindFBO(0); //in case the active filter has used a FBOs!
 
@@ -2046,7 +2260,9 @@ void ccGLWindow::fullRenderingPass(CC_DRAW_CONTEXT& CONTEXT, RenderingParams& re
 	/******************/
 	if (renderingParams.drawForeground && !oculusMode)
 	{
+		m_frameStats.beginPass(ccFrameStats::FOREGROUND_PASS);
 		drawForeground(CONTEXT, renderingParams);
+		m_frameStats.endPass();
 	}
 
 	glFunc->glFlush();
@@ -2096,6 +2312,12 @@ void ccGLWindow::draw3D(CC_DRAW_CONTEXT& CONTEXT, RenderingParams& renderingPara
 		CONTEXT.colorRampShader = m_colorRampShader;
 	}
 
+	//normals are decoded by the GPU (unless another shader is already active)
+	if (m_normalDecodeShader && !m_activeShader)
+	{
+		CONTEXT.normalDecodeShader = m_normalDecodeShader;
+	}
+
 	//custom rendering shader (OpenGL 3.3+)
 	{
 		//FIXME: work in progress
@@ -2287,6 +2509,7 @@ void ccGLWindow::draw3D(CC_DRAW_CONTEXT& CONTEXT, RenderingParams& renderingPara
 
 	//reset context
 	CONTEXT.colorRampShader = 0;
+	CONTEXT.normalDecodeShader = 0;
 	CONTEXT.customRenderingShader = 0;
 
 	//we disable shader (if any)
@@ -4598,9 +4821,8 @@ void ccGLWindow::startCPUBasedPointPicking(const PickingParameters& params)
 	double nearestElementSquareDist = -1.0;
 	CCVector3 nearestPoint(0, 0, 0);
 
-	static ccGui::ParamStruct::ComputeOctreeForPicking autoComputeOctreeThisSession = ccGui::ParamStruct::ASK_USER;
-	bool autoComputeOctree = false;
-	bool firstCloudWithoutOctree = true;
+	//octree computation behavior (for picking)
+	ccGui::ParamStruct::ComputeOctreeForPicking octreeBehavior = getDisplayParameters().autoComputeOctree;
 
 	ccGLCameraParameters camera;
 	getGLCameraParameters(camera);
@@ -4631,69 +4853,23 @@ void ccGLWindow::startCPUBasedPointPicking(const PickingParameters& params)
 				{
 					ccGenericPointCloud* cloud = static_cast<ccGenericPointCloud*>(ent);
 
-					if (firstCloudWithoutOctree && !cloud->getOctree())
+					bool autoComputeOctree = false;
+					if (!cloud->getPickingOctree())
 					{
-						//can we compute an octree for picking?
-						ccGui::ParamStruct::ComputeOctreeForPicking behavior = getDisplayParameters().autoComputeOctree;
-						if (behavior == ccGui::ParamStruct::ASK_USER)
-						{
-							//we use the persistent parameter for this session
-							behavior = autoComputeOctreeThisSession;
-						}
-
-						switch (behavior)
+						switch (octreeBehavior)
 						{
 						case ccGui::ParamStruct::ALWAYS:
 							autoComputeOctree = true;
 							break;
 
-						case ccGui::ParamStruct::ASK_USER:
-						{
-							QMessageBox question(QMessageBox::Question,
-								"Picking acceleration",
-								"Automatically compute octree(s) to accelerate the picking process?\n(this behavior can be changed later in the Display Settings)",
-								QMessageBox::NoButton,
-								asWidget());
-
-							QPushButton* yes = new QPushButton("Yes");
-							question.addButton(yes, QMessageBox::AcceptRole);
-							QPushButton* no = new QPushButton("No");
-							question.addButton(no, QMessageBox::RejectRole);
-							QPushButton* always = new QPushButton("Always");
-							question.addButton(always, QMessageBox::AcceptRole);
-							QPushButton* never = new QPushButton("Never");
-							question.addButton(never, QMessageBox::RejectRole);
-
-							question.exec();
-							QAbstractButton* clickedButton = question.clickedButton();
-							if (clickedButton == yes)
-							{
-								autoComputeOctree = true;
-								autoComputeOctreeThisSession = ccGui::ParamStruct::ALWAYS;
-							}
-							else if (clickedButton == no)
-							{
-								autoComputeOctree = false;
-								autoComputeOctreeThisSession = ccGui::ParamStruct::NEVER;
-							}
-							else if (clickedButton == always || clickedButton == never)
-							{
-								autoComputeOctree = (clickedButton == always);
-								//update the global application parameters
-								ccGui::ParamStruct params = ccGui::Parameters();
-								params.autoComputeOctree = autoComputeOctree ? ccGui::ParamStruct::ALWAYS : ccGui::ParamStruct::NEVER;
-								ccGui::Set(params);
-								params.toPersistentSettings();
-							}
-						}
-						break;
+						case ccGui::ParamStruct::IN_BACKGROUND:
+							//we'll use the brute force approach until the octree is ready
+							cloud->computePickingOctreeInBackground();
+							break;
 
 						case ccGui::ParamStruct::NEVER:
-							autoComputeOctree = false;
 							break;
 						}
-
-						firstCloudWithoutOctree = false;
 					}
 
 					int nearestPointIndex = -1;
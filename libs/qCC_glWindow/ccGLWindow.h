@@ -25,6 +25,7 @@
 
 //qCC
 #include "ccGuiParameters.h"
+#include "ccFrameStats.h"
 
 //Qt
 #include <QElapsedTimer>
@@ -47,11 +48,13 @@ class ccHObject;
 class ccBBox;
 class ccShader;
 class ccColorRampShader;
+class ccNormalDecodeShader;
 class ccGlFilter;
 class ccFrameBufferObject;
 class ccInteractor;
 class ccPolyline;
 struct HotZone;
+class QOffscreenSurface;
 
 #ifdef CC_GL_WINDOW_USE_QWINDOW
 class QOpenGLPaintDevice;
@@ -172,6 +175,22 @@ public:
 	//! Returns current 'scene graph' root
 	ccHObject* getSceneDB();
 
+	//! Returns whether the OpenGL context has been initialized
+	inline bool isInitialized() const { return m_initialized; }
+
+	//! Initializes the 3D view for offscreen rendering
+	/** The OpenGL context is bound to a QOffscreenSurface (a pbuffer, or a
+		surfaceless EGL context with Mesa) and not to the view itself, which
+		must never be shown. Images are then rendered with renderToImage.
+		\param width viewport width (in pixels)
+		\param height viewport height (in pixels)
+		\return success
+	**/
+	bool initializeOffscreen(int width, int height);
+
+	//! Returns whether the view renders offscreen
+	inline bool isOffscreen() const { return m_offscreenSurface != 0; }
+
 	//replacement for the missing methods of QGLWidget
 	// 滻QGLWidgetȱʧķ
 	void renderText(int x, int y, const QString & str, const QFont & font = QFont());
@@ -601,6 +620,25 @@ public: //debug traces on screen
 	//! Toggles debug info on screen
 	inline void toggleDebugTrace() { m_showDebugTraces = !m_showDebugTraces; }
 
+public: //rendering statistics
+
+	//! Enables the collection of rendering statistics (displayed on screen)
+	/** CPU and GPU times of each rendering pass, number of entities drawn,
+		number of points sent to the GPU, etc. (see ccFrameStats).
+	**/
+	void enableFrameStats(bool state);
+
+	//! Returns whether rendering statistics are collected
+	inline bool frameStatsEnabled() const { return m_frameStatsEnabled; }
+
+	//! Returns the rendering statistics of the last frames
+	inline const ccFrameStats& frameStats() const { return m_frameStats; }
+
+	//! Saves the rendering statistics of the last frames as a trace file
+	/** See ccFrameStats::saveTrace.
+	**/
+	bool saveFrameStats(const QString& filename) const;
+
 public: //stereo mode
 
 	//! Seterovision parameters
@@ -816,6 +854,11 @@ protected: //rendering
 #ifdef CC_GL_WINDOW_USE_QWINDOW
 	//! Returns the context (if any)
 	inline QOpenGLContext* context() const { return m_context; }
+#else
+	//! Returns the context (if any)
+	/** Hides QOpenGLWidget::context so as to return the offscreen context in offscreen mode.
+	**/
+	inline QOpenGLContext* context() const { return m_offscreenContext ? m_offscreenContext : ccGLWindowParent::context(); }
 #endif
 
 	//reimplemented from QOpenGLWidget
@@ -1149,8 +1192,16 @@ protected: //members
 	//! Associated widget (we use the WidgetContainer mechanism)
 	QWidget* m_parentWidget;
 
+#else
+
+	//! Offscreen OpenGL context (offscreen mode only)
+	QOpenGLContext* m_offscreenContext;
+
 #endif
 
+	//! Offscreen surface (offscreen mode only)
+	QOffscreenSurface* m_offscreenSurface;
+
 	//! Unique ID
 	int m_uniqueID;
 
@@ -1320,6 +1371,8 @@ protected: //members
 
 	// Color ramp shader
 	ccColorRampShader* m_colorRampShader;
+	// Normal decoding shader
+	ccNormalDecodeShader* m_normalDecodeShader;
 	// Custom rendering shader (OpenGL 3.3+)
 	ccShader* m_customRenderingShader;
 
@@ -1421,6 +1474,11 @@ protected: //members
 	//! Debug traces visibility
 	bool m_showDebugTraces;
 
+	//! Whether rendering statistics are collected
+	bool m_frameStatsEnabled;
+	//! Rendering statistics
+	ccFrameStats m_frameStats;
+
 	//! Picking radius (pixels)
 	int m_pickRadius;
 
@@ -84,6 +84,7 @@ void ccGui::ParamStruct::reset()
 	minLoDMeshSize				= 2500000;
 	decimateCloudOnMove			= true;
 	minLoDCloudSize				= 10000000;
+	saveLODWithClouds			= false; //it doubles the size of the BIN files
 	useVBOs						= true;
 	displayCross				= true;
 
@@ -107,7 +108,7 @@ void ccGui::ParamStruct::reset()
 
 	zoomSpeed					= 1.0;
 
-	autoComputeOctree			= ASK_USER;
+	autoComputeOctree			= IN_BACKGROUND;
 }
 
 static int c_fColorArraySize  = sizeof(float) * 4;
@@ -137,6 +138,7 @@ void ccGui::ParamStruct::fromPersistentSettings()
 	minLoDMeshSize				=                                      settings.value("minLoDMeshSize",       2500000 ).toUInt();
 	decimateCloudOnMove			=                                      settings.value("cloudDecimation",         true ).toBool();
 	minLoDCloudSize				=                                      settings.value("minLoDCloudSize",     10000000 ).toUInt();
+	saveLODWithClouds			=                                      settings.value("saveLODWithClouds",       false).toBool();
 	useVBOs						=                                      settings.value("useVBOs",                 true ).toBool();
 	displayCross				=                                      settings.value("crossDisplayed",          true ).toBool();
 	labelMarkerSize				= static_cast<unsigned>(std::max(0,    settings.value("labelMarkerSize",         5    ).toInt()));
@@ -149,7 +151,7 @@ void ccGui::ParamStruct::fromPersistentSettings()
 	displayedNumPrecision		= static_cast<unsigned>(std::max(0,    settings.value("displayedNumPrecision",    6   ).toInt()));
 	labelOpacity				= static_cast<unsigned>(std::max(0,    settings.value("labelOpacity",             75  ).toInt()));
 	zoomSpeed					=                                      settings.value("zoomSpeed",                1.0 ).toDouble();
-	autoComputeOctree			= static_cast<ComputeOctreeForPicking>(settings.value("autoComputeOctree",   ASK_USER ).toInt());
+	autoComputeOctree			= static_cast<ComputeOctreeForPicking>(settings.value("autoComputeOctree",   IN_BACKGROUND).toInt());
 
 	settings.endGroup();
 }
@@ -177,6 +179,7 @@ void ccGui::ParamStruct::toPersistentSettings() const
 	settings.setValue("minLoDMeshSize",	          minLoDMeshSize);
 	settings.setValue("cloudDecimation",          decimateCloudOnMove);
 	settings.setValue("minLoDCloudSize",	      minLoDCloudSize);
+	settings.setValue("saveLODWithClouds",        saveLODWithClouds);
 	settings.setValue("useVBOs",                  useVBOs);
 	settings.setValue("crossDisplayed",           displayCross);
 	settings.setValue("labelMarkerSize",          labelMarkerSize);
@@ -87,6 +87,9 @@ public:
 		//! Min cloud size for decimation
 		//  ڳȡС
 		unsigned minLoDCloudSize;
+
+		//! Whether the decimation (LoD) structure of the clouds is saved in BIN files
+		bool saveLODWithClouds;
 		//! Display cross in the middle of the screen
 		bool displayCross;
 
@@ -119,7 +122,11 @@ public:
 
 		//! Octree computation (for picking) behaviors
 		//  ˲㣨ѡΪ
-		enum ComputeOctreeForPicking { ALWAYS = 0, ASK_USER = 1, NEVER = 2 };
+		/** ALWAYS: computed (synchronously) the first time a cloud is picked
+			IN_BACKGROUND: computed in background (when a cloud is loaded or picked) - meanwhile the picking is done the brute force way
+			NEVER: always use the brute force approach
+		**/
+		enum ComputeOctreeForPicking { ALWAYS = 0, IN_BACKGROUND = 1, NEVER = 2 };
 
 		//! Octree computation (for picking) behavior
 		ComputeOctreeForPicking autoComputeOctree;
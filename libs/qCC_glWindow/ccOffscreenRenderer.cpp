@@ -0,0 +1,166 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#include "ccOffscreenRenderer.h"
+
+//Local
+#include "ccGLWindow.h"
+
+//qCC_db
+#include <ccHObject.h>
+
+//Qt
+#include <QSurfaceFormat>
+
+//System
+#include <assert.h>
+
+ccOffscreenRenderer::ccOffscreenRenderer()
+	: m_window(0)
+	, m_perspective(false)
+	, m_fov_deg(30.0f)
+{
+}
+
+ccOffscreenRenderer::~ccOffscreenRenderer()
+{
+	release();
+}
+
+void ccOffscreenRenderer::release()
+{
+	removeEntities();
+
+	if (m_window)
+	{
+		delete m_window;
+		m_window = 0;
+	}
+}
+
+bool ccOffscreenRenderer::init(int width, int height, QString& error)
+{
+	release();
+
+	if (width <= 0 || height <= 0)
+	{
+		error = QString("Invalid image size (%1 x %2)").arg(width).arg(height);
+		return false;
+	}
+
+	//single buffered: there's no window to swap with
+	QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+	format.setSwapBehavior(QSurfaceFormat::SingleBuffer);
+	format.setStereo(false);
+
+	m_window = new ccGLWindow(&format, 0, true);
+	if (!m_window->initializeOffscreen(width, height))
+	{
+		error = "Failed to initialize the offscreen OpenGL context (see console)";
+		release();
+		return false;
+	}
+
+	//no interaction, no overlay
+	m_window->setLODEnabled(false);
+	m_window->setSunLight(true);
+	m_window->setPerspectiveState(false, true);
+
+	return true;
+}
+
+void ccOffscreenRenderer::addEntity(ccHObject* entity)
+{
+	if (!m_window || !entity)
+	{
+		assert(false);
+		return;
+	}
+
+	try
+	{
+		m_entities.push_back(entity);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return;
+	}
+
+	//the entity keeps its own parent (no dependency)
+	m_window->addToOwnDB(entity, true);
+	entity->setDisplay_recursive(m_window);
+}
+
+void ccOffscreenRenderer::removeEntities()
+{
+	for (ccHObject* entity : m_entities)
+	{
+		if (m_window)
+		{
+			m_window->removeFromOwnDB(entity);
+		}
+		entity->setDisplay_recursive(0);
+	}
+	m_entities.clear();
+}
+
+void ccOffscreenRenderer::setPerspective(bool state, float fov_deg/*=30.0f*/)
+{
+	m_perspective = state;
+	m_fov_deg = fov_deg;
+}
+
+void ccOffscreenRenderer::setPointSize(float size)
+{
+	if (m_window)
+	{
+		m_window->setPointSize(size);
+	}
+}
+
+QImage ccOffscreenRenderer::render(const View& view, float zoomFactor/*=1.0f*/)
+{
+	if (!m_window)
+	{
+		assert(false);
+		return QImage();
+	}
+
+	if (view.customCamera)
+	{
+		//viewer-based perspective
+		m_window->setPerspectiveState(true, false);
+		m_window->setFov(m_fov_deg);
+		m_window->setCameraPos(view.cameraCenter);
+		m_window->setPivotPoint(view.target, false, false);
+		m_window->setCustomView(view.target - view.cameraCenter, view.up, false);
+	}
+	else
+	{
+		//object-centered view
+		m_window->setPerspectiveState(m_perspective, true);
+		if (m_perspective)
+		{
+			m_window->setFov(m_fov_deg);
+		}
+		m_window->setView(view.orientation, false);
+		m_window->zoomGlobal();
+	}
+
+	return m_window->renderToImage(zoomFactor, false, false, true);
+}
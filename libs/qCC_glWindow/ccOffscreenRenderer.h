@@ -0,0 +1,130 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_OFFSCREEN_RENDERER_HEADER
+#define CC_OFFSCREEN_RENDERER_HEADER
+
+//Local
+#include "ccGLUtils.h"
+
+//CCLib
+#include <CCGeom.h>
+
+//Qt
+#include <QImage>
+#include <QString>
+
+//System
+#include <vector>
+
+class ccGLWindow;
+class ccHObject;
+
+//! Renders entities in images without displaying anything on screen
+/** The rendering is done by a 3D view that is never shown: its OpenGL
+	context is bound to a QOffscreenSurface and the images are rendered in
+	FBOs. With an EGL based Qt platform plugin (e.g. 'eglfs' or 'minimalegl'
+	with Mesa's surfaceless EGL platform and llvmpipe) it can be used on a
+	machine without any display or X server.
+
+	Several views can be rendered in a row: the entities are only uploaded
+	once to the GPU (VBOs, textures, etc.) as the same OpenGL context is used.
+**/
+class ccOffscreenRenderer
+{
+public:
+
+	//! View parameters
+	struct View
+	{
+		//! Default constructor (standard isometric view)
+		View()
+			: orientation(CC_ISO_VIEW_1)
+			, customCamera(false)
+			, cameraCenter(0, 0, 0)
+			, target(0, 0, 0)
+			, up(0, 0, 1)
+		{}
+
+		//! View name (for output)
+		QString name;
+		//! Standard orientation (if no custom camera is defined)
+		/** The view is zoomed on the entities.
+		**/
+		CC_VIEW_ORIENTATION orientation;
+		//! Whether a custom camera is used (perspective mode only)
+		bool customCamera;
+		//! Custom camera center
+		CCVector3d cameraCenter;
+		//! Custom camera target
+		CCVector3d target;
+		//! Custom camera 'up' direction
+		CCVector3d up;
+	};
+
+	//! Default constructor
+	ccOffscreenRenderer();
+
+	//! Destructor
+	virtual ~ccOffscreenRenderer();
+
+	//! Initializes the renderer (creates the offscreen 3D view and its OpenGL context)
+	/** \param width image width (in pixels)
+		\param height image height (in pixels)
+		\param error error message (if any)
+		\return success
+	**/
+	bool init(int width, int height, QString& error);
+
+	//! Returns whether the renderer is initialized or not
+	bool isValid() const { return m_window != 0; }
+
+	//! Adds an entity to render (the renderer doesn't take its ownership)
+	void addEntity(ccHObject* entity);
+
+	//! Removes all the entities
+	void removeEntities();
+
+	//! Sets the perspective mode
+	void setPerspective(bool state, float fov_deg = 30.0f);
+
+	//! Sets the default point size
+	void setPointSize(float size);
+
+	//! Renders a view
+	/** \param view view parameters
+		\param zoomFactor super-resolution factor (the output image will be zoomFactor times bigger)
+		\return the rendered image (null if an error occurred)
+	**/
+	QImage render(const View& view, float zoomFactor = 1.0f);
+
+protected:
+
+	//! Releases the offscreen 3D view
+	void release();
+
+	//! Offscreen 3D view
+	ccGLWindow* m_window;
+	//! Entities to render
+	std::vector<ccHObject*> m_entities;
+	//! Perspective mode
+	bool m_perspective;
+	//! Perspective F.O.V. (in degrees)
+	float m_fov_deg;
+};
+
+#endif //CC_OFFSCREEN_RENDERER_HEADER
@@ -17,6 +17,9 @@
 
 #include "AsciiFilter.h"
 
+//Local
+#include "ccPointStream.h"
+
 //Qt
 #include <QFile>
 #include <QFileInfo>
@@ -83,6 +86,151 @@ bool AsciiFilter::canSave(CC_CLASS_ENUM type, bool& multiple, bool& exclusive) c
 	return false;
 }
 
+//! ASCII output format (as set in the save dialog)
+struct AsciiOutputFormat
+{
+	int coordPrecision;
+	int sfPrecision;
+	int nPrecision;
+	bool saveColumnsHeader;
+	bool savePointCountHeader;
+	bool swapColorAndSFs;
+	bool saveFloatColors;
+	QChar separator;
+
+	explicit AsciiOutputFormat(const AsciiSaveDlg* saveDialog)
+		: coordPrecision(saveDialog->coordsPrecision())
+		, sfPrecision(saveDialog->sfPrecision())
+		, nPrecision(2+sizeof(PointCoordinateType))
+		, saveColumnsHeader(saveDialog->saveColumnsNamesHeader())
+		, savePointCountHeader(saveDialog->savePointCountHeader())
+		, swapColorAndSFs(saveDialog->swapColorAndSF())
+		, saveFloatColors(saveDialog->saveFloatColors())
+		, separator(saveDialog->getSeparator())
+	{}
+
+	//! Returns the columns names header
+	QString header(bool writeColors, const std::vector<ccScalarField*>& scalarFields, bool writeNorms) const
+	{
+		QString header("//");
+		header.append(AsciiHeaderColumns::X());
+		header.append(separator);
+		header.append(AsciiHeaderColumns::Y());
+		header.append(separator);
+		header.append(AsciiHeaderColumns::Z());
+
+		if (writeColors && !swapColorAndSFs)
+		{
+			header.append(separator);
+			header.append(saveFloatColors ? AsciiHeaderColumns::Rf() : AsciiHeaderColumns::R());
+			header.append(separator);
+			header.append(saveFloatColors ? AsciiHeaderColumns::Gf() : AsciiHeaderColumns::G());
+			header.append(separator);
+			header.append(saveFloatColors ? AsciiHeaderColumns::Bf() : AsciiHeaderColumns::B());
+		}
+
+		//add each associated SF name
+		for (std::vector<ccScalarField*>::const_iterator it = scalarFields.begin(); it != scalarFields.end(); ++it)
+		{
+			QString sfName((*it)->getName());
+			sfName.replace(separator,'_');
+			header.append(separator);
+			header.append(sfName);
+		}
+
+		if (writeColors && swapColorAndSFs)
+		{
+			header.append(separator);
+			header.append(saveFloatColors ? AsciiHeaderColumns::Rf() : AsciiHeaderColumns::R());
+			header.append(separator);
+			header.append(saveFloatColors ? AsciiHeaderColumns::Gf() : AsciiHeaderColumns::G());
+			header.append(separator);
+			header.append(saveFloatColors ? AsciiHeaderColumns::Bf() : AsciiHeaderColumns::B());
+		}
+
+		if (writeNorms)
+		{
+			header.append(separator);
+			header.append(AsciiHeaderColumns::Nx());
+			header.append(separator);
+			header.append(AsciiHeaderColumns::Ny());
+			header.append(separator);
+			header.append(AsciiHeaderColumns::Nz());
+		}
+
+		return header;
+	}
+
+	//! Returns the line corresponding to a given point
+	QString line(const ccGenericPointCloud* cloud, unsigned i, bool writeColors, const std::vector<ccScalarField*>& scalarFields, bool writeNorms) const
+	{
+		QString line;
+
+		//write current point coordinates
+		CCVector3 P;
+		cloud->getPoint(i, P);
+		CCVector3d Pglobal = cloud->toGlobal3d<PointCoordinateType>(P);
+		line.append(QString::number(Pglobal.x,'f',coordPrecision));
+		line.append(separator);
+		line.append(QString::number(Pglobal.y,'f',coordPrecision));
+		line.append(separator);
+		line.append(QString::number(Pglobal.z,'f',coordPrecision));
+
+		QString colorLine;
+		if (writeColors)
+		{
+			//add rgb color
+			const ColorCompType* col = cloud->getPointColor(i);
+			if (saveFloatColors)
+			{
+				colorLine.append(separator);
+				colorLine.append(QString::number(static_cast<double>(col[0])/ccColor::MAX));
+				colorLine.append(separator);
+				colorLine.append(QString::number(static_cast<double>(col[1])/ccColor::MAX));
+				colorLine.append(separator);
+				colorLine.append(QString::number(static_cast<double>(col[2])/ccColor::MAX));
+			}
+			else
+			{
+				colorLine.append(separator);
+				colorLine.append(QString::number(col[0]));
+				colorLine.append(separator);
+				colorLine.append(QString::number(col[1]));
+				colorLine.append(separator);
+				colorLine.append(QString::number(col[2]));
+			}
+
+			if (!swapColorAndSFs)
+				line.append(colorLine);
+		}
+
+		//add each associated SF values
+		for (std::vector<ccScalarField*>::const_iterator it = scalarFields.begin(); it != scalarFields.end(); ++it)
+		{
+			line.append(separator);
+			double sfVal = (*it)->getGlobalShift() + (*it)->getValue(i);
+			line.append(QString::number(sfVal,'f',sfPrecision));
+		}
+
+		if (writeColors && swapColorAndSFs)
+			line.append(colorLine);
+
+		if (writeNorms)
+		{
+			//add normal vector
+			const CCVector3& N = cloud->getPointNormal(i);
+			line.append(separator);
+			line.append(QString::number(N.x,'f',nPrecision));
+			line.append(separator);
+			line.append(QString::number(N.y,'f',nPrecision));
+			line.append(separator);
+			line.append(QString::number(N.z,'f',nPrecision));
+		}
+
+		return line;
+	}
+};
+
 CC_FILE_ERROR AsciiFilter::saveToFile(ccHObject* entity, QString filename, SaveParameters& parameters)
 {
 	assert(entity && !filename.isEmpty());
@@ -186,7 +334,6 @@ CC_FILE_ERROR AsciiFilter::saveToFile(ccHObject* entity, QString filename, SaveP
 		for (unsigned i=0; i<ccCloud->getNumberOfScalarFields(); ++i)
 			theScalarFields.push_back(static_cast<ccScalarField*>(ccCloud->getScalarField(i)));
 	}
-	bool writeSF = (theScalarFields.size() != 0);
 
 	//progress dialog
 	ccProgressDialog pdlg(true, parameters.parentWidget);
@@ -198,73 +345,14 @@ CC_FILE_ERROR AsciiFilter::saveToFile(ccHObject* entity, QString filename, SaveP
 		pdlg.start();
 	}
 
-	//output precision
-	const int s_coordPrecision = saveDialog->coordsPrecision();
-	const int s_sfPrecision = saveDialog->sfPrecision(); 
-	const int s_nPrecision = 2+sizeof(PointCoordinateType);
-
-	//other parameters
-	bool saveColumnsHeader = saveDialog->saveColumnsNamesHeader();
-	bool savePointCountHeader = saveDialog->savePointCountHeader();
-	bool swapColorAndSFs = saveDialog->swapColorAndSF();
-	QChar separator(saveDialog->getSeparator());
-	bool saveFloatColors = saveDialog->saveFloatColors();
+	AsciiOutputFormat format(saveDialog);
 
-	if (saveColumnsHeader)
+	if (format.saveColumnsHeader)
 	{
-		QString header("//");
-		header.append(AsciiHeaderColumns::X());
-		header.append(separator);
-		header.append(AsciiHeaderColumns::Y());
-		header.append(separator);
-		header.append(AsciiHeaderColumns::Z());
-
-		if (writeColors && !swapColorAndSFs)
-		{
-			header.append(separator);
-			header.append(saveFloatColors ? AsciiHeaderColumns::Rf() : AsciiHeaderColumns::R());
-			header.append(separator);
-			header.append(saveFloatColors ? AsciiHeaderColumns::Gf() : AsciiHeaderColumns::G());
-			header.append(separator);
-			header.append(saveFloatColors ? AsciiHeaderColumns::Bf() : AsciiHeaderColumns::B());
-		}
-
-		if (writeSF)
-		{
-			//add each associated SF name
-			for (std::vector<ccScalarField*>::const_iterator it = theScalarFields.begin(); it != theScalarFields.end(); ++it)
-			{
-				QString sfName((*it)->getName());
-				sfName.replace(separator,'_');
-				header.append(separator);
-				header.append(sfName);
-			}
-		}
-
-		if (writeColors && swapColorAndSFs)
-		{
-			header.append(separator);
-			header.append(saveFloatColors ? AsciiHeaderColumns::Rf() : AsciiHeaderColumns::R());
-			header.append(separator);
-			header.append(saveFloatColors ? AsciiHeaderColumns::Gf() : AsciiHeaderColumns::G());
-			header.append(separator);
-			header.append(saveFloatColors ? AsciiHeaderColumns::Bf() : AsciiHeaderColumns::B());
-		}
-
-		if (writeNorms)
-		{
-			header.append(separator);
-			header.append(AsciiHeaderColumns::Nx());
-			header.append(separator);
-			header.append(AsciiHeaderColumns::Ny());
-			header.append(separator);
-			header.append(AsciiHeaderColumns::Nz());
-		}
-		
-		stream << header << "\n";
+		stream << format.header(writeColors, theScalarFields, writeNorms) << "\n";
 	}
 
-	if (savePointCountHeader)
+	if (format.savePointCountHeader)
 	{
 		stream << QString::number(numberOfPoints) << "\n";
 	}
@@ -272,73 +360,7 @@ CC_FILE_ERROR AsciiFilter::saveToFile(ccHObject* entity, QString filename, SaveP
 	CC_FILE_ERROR result = CC_FERR_NO_ERROR;
 	for (unsigned i=0; i<numberOfPoints; ++i)
 	{
-		//line for the current point
-		QString line;
-
-		//write current point coordinates
-		const CCVector3* P = cloud->getPoint(i);
-		CCVector3d Pglobal = cloud->toGlobal3d<PointCoordinateType>(*P);
-		line.append(QString::number(Pglobal.x,'f',s_coordPrecision));
-		line.append(separator);
-		line.append(QString::number(Pglobal.y,'f',s_coordPrecision));
-		line.append(separator);
-		line.append(QString::number(Pglobal.z,'f',s_coordPrecision));
-
-		QString colorLine;
-		if (writeColors)
-		{
-			//add rgb color
-			const ColorCompType* col = cloud->getPointColor(i);
-			if (saveFloatColors)
-			{
-				colorLine.append(separator);
-				colorLine.append(QString::number(static_cast<double>(col[0])/ccColor::MAX));
-				colorLine.append(separator);
-				colorLine.append(QString::number(static_cast<double>(col[1])/ccColor::MAX));
-				colorLine.append(separator);
-				colorLine.append(QString::number(static_cast<double>(col[2])/ccColor::MAX));
-			}
-			else
-			{
-				colorLine.append(separator);
-				colorLine.append(QString::number(col[0]));
-				colorLine.append(separator);
-				colorLine.append(QString::number(col[1]));
-				colorLine.append(separator);
-				colorLine.append(QString::number(col[2]));
-			}
-
-			if (!swapColorAndSFs)
-				line.append(colorLine);
-		}
-
-		if (writeSF)
-		{
-			//add each associated SF values
-			for (std::vector<ccScalarField*>::const_iterator it = theScalarFields.begin(); it != theScalarFields.end(); ++it)
-			{
-				line.append(separator);
-				double sfVal = (*it)->getGlobalShift() + (*it)->getValue(i);
-				line.append(QString::number(sfVal,'f',s_sfPrecision));
-			}
-		}
-
-		if (writeColors && swapColorAndSFs)
-			line.append(colorLine);
-
-		if (writeNorms)
-		{
-			//add normal vector
-			const CCVector3& N = cloud->getPointNormal(i);
-			line.append(separator);
-			line.append(QString::number(N.x,'f',s_nPrecision));
-			line.append(separator);
-			line.append(QString::number(N.y,'f',s_nPrecision));
-			line.append(separator);
-			line.append(QString::number(N.z,'f',s_nPrecision));
-		}
-
-		stream << line << "\n";
+		stream << format.line(cloud, i, writeColors, theScalarFields, writeNorms) << "\n";
 
 		if (parameters.parentWidget && !nprogress.oneStep())
 		{
@@ -350,20 +372,8 @@ CC_FILE_ERROR AsciiFilter::saveToFile(ccHObject* entity, QString filename, SaveP
 	return result;
 }
 
-CC_FILE_ERROR AsciiFilter::loadFile(QString filename,
-									ccHObject& container,
-									LoadParameters& parameters)
+CC_FILE_ERROR AsciiFilter::InitOpenDialog(const QString& filename, LoadParameters& parameters)
 {
-	//we get the size of the file to open
-	QFile file(filename);
-	if (!file.exists())
-		return CC_FERR_READING;
-
-	qint64 fileSize = file.size();
-	if (fileSize == 0)
-		return CC_FERR_NO_LOAD;
-
-	//column attribution dialog
 	//DGM: we ask for the semi-persistent dialog as it may have
 	//been already initialized (by the command-line for instance)
 	AsciiOpenDlg* openDialog = GetOpenDialog(parameters.parentWidget);
@@ -397,6 +407,29 @@ CC_FILE_ERROR AsciiFilter::loadFile(QString filename,
 		}
 	}
 
+	return CC_FERR_NO_ERROR;
+}
+
+CC_FILE_ERROR AsciiFilter::loadFile(QString filename,
+									ccHObject& container,
+									LoadParameters& parameters)
+{
+	//we get the size of the file to open
+	QFile file(filename);
+	if (!file.exists())
+		return CC_FERR_READING;
+
+	qint64 fileSize = file.size();
+	if (fileSize == 0)
+		return CC_FERR_NO_LOAD;
+
+	//column attribution dialog
+	CC_FILE_ERROR dlgResult = InitOpenDialog(filename, parameters);
+	if (dlgResult != CC_FERR_NO_ERROR)
+		return dlgResult;
+	AsciiOpenDlg* openDialog = GetOpenDialog();
+	assert(openDialog);
+
 	//we compute the approximate line number
 	double averageLineSize = openDialog->getAverageLineSize();
 	unsigned approximateNumberOfLines = static_cast<unsigned>(ceil(static_cast<double>(fileSize)/averageLineSize));
@@ -670,6 +703,81 @@ cloudAttributesDescriptor prepareCloud(	const AsciiOpenDlg::Sequence &openSequen
 	return cloudDesc;
 }
 
+//! Reads the attributes of the last added point (normal, color, scalars) from the parts of its line
+static void ReadPointAttributes(cloudAttributesDescriptor& cloudDesc, const QStringList& parts, unsigned pointIndex)
+{
+	ScalarType D = 0;
+	CCVector3 N(0,0,0);
+	ccColor::Rgb col;
+
+	//Normal vector
+	if (cloudDesc.hasNorms)
+	{
+		if (cloudDesc.xNormIndex >= 0)
+			N.x = static_cast<PointCoordinateType>(parts[cloudDesc.xNormIndex].toDouble());
+		if (cloudDesc.yNormIndex >= 0)
+			N.y = static_cast<PointCoordinateType>(parts[cloudDesc.yNormIndex].toDouble());
+		if (cloudDesc.zNormIndex >= 0)
+			N.z = static_cast<PointCoordinateType>(parts[cloudDesc.zNormIndex].toDouble());
+		cloudDesc.cloud->addNorm(N);
+	}
+
+	//Colors
+	if (cloudDesc.hasRGBColors)
+	{
+		if (cloudDesc.iRgbaIndex >= 0)
+		{
+			const uint32_t rgb = parts[cloudDesc.iRgbaIndex].toInt();
+			col.r = ((rgb >> 16) & 0x0000ff);
+			col.g = ((rgb >> 8 ) & 0x0000ff);
+			col.b = ((rgb      ) & 0x0000ff);
+
+		}
+		else if (cloudDesc.fRgbaIndex >= 0)
+		{
+			const float rgbf = parts[cloudDesc.fRgbaIndex].toFloat();
+			const uint32_t rgb = (uint32_t)(*((uint32_t*)&rgbf));
+			col.r = ((rgb >> 16) & 0x0000ff);
+			col.g = ((rgb >> 8 ) & 0x0000ff);
+			col.b = ((rgb      ) & 0x0000ff);
+		}
+		else
+		{
+			if (cloudDesc.redIndex >= 0)
+			{
+				float multiplier = cloudDesc.hasFloatRGBColors[0] ? static_cast<float>(ccColor::MAX) : 1.0f;
+				col.r = static_cast<ColorCompType>(parts[cloudDesc.redIndex].toFloat() * multiplier);
+			}
+			if (cloudDesc.greenIndex >= 0)
+			{
+				float multiplier = cloudDesc.hasFloatRGBColors[1] ? static_cast<float>(ccColor::MAX) : 1.0f;
+				col.g = static_cast<ColorCompType>(parts[cloudDesc.greenIndex].toFloat() * multiplier);
+			}
+			if (cloudDesc.blueIndex >= 0)
+			{
+				float multiplier = cloudDesc.hasFloatRGBColors[2] ? static_cast<float>(ccColor::MAX) : 1.0f;
+				col.b = static_cast<ColorCompType>(parts[cloudDesc.blueIndex].toFloat() * multiplier);
+			}
+		}
+		cloudDesc.cloud->addRGBColor(col.rgb);
+	}
+	else if (cloudDesc.greyIndex >= 0)
+	{
+		col.r = col.r = col.b = static_cast<ColorCompType>(parts[cloudDesc.greyIndex].toInt());
+		cloudDesc.cloud->addRGBColor(col.rgb);
+	}
+
+	//Scalar distance
+	if (!cloudDesc.scalarIndexes.empty())
+	{
+		for (size_t j=0; j<cloudDesc.scalarIndexes.size(); ++j)
+		{
+			D = static_cast<ScalarType>( parts[cloudDesc.scalarIndexes[j]].toDouble() );
+			cloudDesc.scalarFields[j]->setValue(pointIndex,D);
+		}
+	}
+}
+
 CC_FILE_ERROR AsciiFilter::loadCloudFromFormatedAsciiFile(	const QString& filename,
 															ccHObject& container,
 															const AsciiOpenDlg::Sequence& openSequence,
@@ -722,11 +830,8 @@ CC_FILE_ERROR AsciiFilter::loadCloudFromFormatedAsciiFile(	const QString& filena
 	}
 
 	//buffers
-	ScalarType D = 0;
 	CCVector3d P(0,0,0);
 	CCVector3d Pshift(0,0,0);
-	CCVector3 N(0,0,0);
-	ccColor::Rgb col;
 
 	//other useful variables
 	unsigned linesRead = 0;
@@ -854,72 +959,8 @@ CC_FILE_ERROR AsciiFilter::loadCloudFromFormatedAsciiFile(	const QString& filena
 			//add point
 			cloudDesc.cloud->addPoint(CCVector3::fromArray((P+Pshift).u));
 
-			//Normal vector
-			if (cloudDesc.hasNorms)
-			{
-				if (cloudDesc.xNormIndex >= 0)
-					N.x = static_cast<PointCoordinateType>(parts[cloudDesc.xNormIndex].toDouble());
-				if (cloudDesc.yNormIndex >= 0)
-					N.y = static_cast<PointCoordinateType>(parts[cloudDesc.yNormIndex].toDouble());
-				if (cloudDesc.zNormIndex >= 0)
-					N.z = static_cast<PointCoordinateType>(parts[cloudDesc.zNormIndex].toDouble());
-				cloudDesc.cloud->addNorm(N);
-			}
-
-			//Colors
-			if (cloudDesc.hasRGBColors)
-			{
-				if (cloudDesc.iRgbaIndex >= 0)
-				{
-					const uint32_t rgb = parts[cloudDesc.iRgbaIndex].toInt();
-					col.r = ((rgb >> 16) & 0x0000ff);
-					col.g = ((rgb >> 8 ) & 0x0000ff);
-					col.b = ((rgb      ) & 0x0000ff);
-
-				}
-				else if (cloudDesc.fRgbaIndex >= 0)
-				{
-					const float rgbf = parts[cloudDesc.fRgbaIndex].toFloat();
-					const uint32_t rgb = (uint32_t)(*((uint32_t*)&rgbf));
-					col.r = ((rgb >> 16) & 0x0000ff);
-					col.g = ((rgb >> 8 ) & 0x0000ff);
-					col.b = ((rgb      ) & 0x0000ff);
-				}
-				else
-				{
-					if (cloudDesc.redIndex >= 0)
-					{
-						float multiplier = cloudDesc.hasFloatRGBColors[0] ? static_cast<float>(ccColor::MAX) : 1.0f;
-						col.r = static_cast<ColorCompType>(parts[cloudDesc.redIndex].toFloat() * multiplier);
-					}
-					if (cloudDesc.greenIndex >= 0)
-					{
-						float multiplier = cloudDesc.hasFloatRGBColors[1] ? static_cast<float>(ccColor::MAX) : 1.0f;
-						col.g = static_cast<ColorCompType>(parts[cloudDesc.greenIndex].toFloat() * multiplier);
-					}
-					if (cloudDesc.blueIndex >= 0)
-					{
-						float multiplier = cloudDesc.hasFloatRGBColors[2] ? static_cast<float>(ccColor::MAX) : 1.0f;
-						col.b = static_cast<ColorCompType>(parts[cloudDesc.blueIndex].toFloat() * multiplier);
-					}
-				}
-				cloudDesc.cloud->addRGBColor(col.rgb);
-			}
-			else if (cloudDesc.greyIndex >= 0)
-			{
-				col.r = col.r = col.b = static_cast<ColorCompType>(parts[cloudDesc.greyIndex].toInt());
-				cloudDesc.cloud->addRGBColor(col.rgb);
-			}
-
-			//Scalar distance
-			if (!cloudDesc.scalarIndexes.empty())
-			{
-				for (size_t j=0; j<cloudDesc.scalarIndexes.size(); ++j)
-				{
-					D = static_cast<ScalarType>( parts[cloudDesc.scalarIndexes[j]].toDouble() );
-					cloudDesc.scalarFields[j]->setValue(pointsRead-cloudChunkPos,D);
-				}
-			}
+			//other attributes
+			ReadPointAttributes(cloudDesc, parts, pointsRead - cloudChunkPos);
 
 			++pointsRead;
 		}
@@ -963,3 +1004,279 @@ CC_FILE_ERROR AsciiFilter::loadCloudFromFormatedAsciiFile(	const QString& filena
 
 	return result;
 }
+
+//! ASCII point stream reader
+class AsciiStreamReader : public ccPointStreamReader
+{
+public:
+
+	AsciiStreamReader(	const QString& filename,
+						const AsciiOpenDlg::Sequence& openSequence,
+						char separator,
+						unsigned skipLines,
+						const FileIOFilter::LoadParameters& parameters)
+		: ccPointStreamReader(parameters)
+		, m_filename(filename)
+		, m_openSequence(openSequence)
+		, m_separator(separator)
+		, m_skipLines(skipLines)
+	{}
+
+	virtual CC_FILE_ERROR read(unsigned blockSize, BlockHandler handler) override
+	{
+		QFile file(m_filename);
+		if (!file.open(QFile::ReadOnly))
+			return CC_FERR_READING;
+		QTextStream stream(&file);
+
+		//we skip lines as defined on input
+		for (unsigned i = 0; i < m_skipLines; ++i)
+		{
+			stream.readLine();
+		}
+
+		//the last column used by the sequence
+		int maxPartIndex = -1;
+		for (size_t i = 0; i < m_openSequence.size(); ++i)
+		{
+			if (m_openSequence[i].type != ASCII_OPEN_DLG_None)
+				maxPartIndex = static_cast<int>(i);
+		}
+
+		CCVector3d P(0, 0, 0);
+		CCVector3d Pshift(0, 0, 0);
+		qint64 pointsRead = 0;
+		qint64 linesRead = m_skipLines;
+		cloudAttributesDescriptor cloudDesc;
+
+		QString currentLine = stream.readLine();
+		while (!currentLine.isNull())
+		{
+			++linesRead;
+
+			//comment or empty line
+			if (currentLine.isEmpty() || currentLine.startsWith("//"))
+			{
+				currentLine = stream.readLine();
+				continue;
+			}
+
+			QStringList parts = currentLine.split(m_separator, QString::SkipEmptyParts);
+			if (parts.size() > maxPartIndex)
+			{
+				//new block
+				if (!cloudDesc.cloud)
+				{
+					int dummyMaxIndex = -1;
+					cloudDesc = prepareCloud(m_openSequence, blockSize, dummyMaxIndex, m_separator);
+					if (!cloudDesc.cloud)
+						return CC_FERR_NOT_ENOUGH_MEMORY;
+					cloudDesc.cloud->setGlobalShift(Pshift);
+				}
+
+				//(X,Y,Z)
+				if (cloudDesc.xCoordIndex >= 0)
+					P.x = parts[cloudDesc.xCoordIndex].toDouble();
+				if (cloudDesc.yCoordIndex >= 0)
+					P.y = parts[cloudDesc.yCoordIndex].toDouble();
+				if (cloudDesc.zCoordIndex >= 0)
+					P.z = parts[cloudDesc.zCoordIndex].toDouble();
+
+				//first point: check for 'big' coordinates
+				if (pointsRead == 0)
+				{
+					if (FileIOFilter::HandleGlobalShift(P, Pshift, m_loadParameters))
+					{
+						cloudDesc.cloud->setGlobalShift(Pshift);
+						ccLog::Warning("[ASCIIFilter] Cloud has been recentered! Translation: (%.2f ; %.2f ; %.2f)", Pshift.x, Pshift.y, Pshift.z);
+					}
+				}
+
+				cloudDesc.cloud->addPoint(CCVector3::fromArray((P + Pshift).u));
+				ReadPointAttributes(cloudDesc, parts, cloudDesc.cloud->size() - 1);
+				++pointsRead;
+
+				//block is full
+				if (cloudDesc.cloud->size() == blockSize)
+				{
+					if (!handler(ReleaseBlock(cloudDesc)))
+						return CC_FERR_CANCELED_BY_USER;
+				}
+			}
+			else
+			{
+				ccLog::Warning("[AsciiFilter::Load] Line %lli is corrupted (found %i part(s) on %i expected)!", linesRead, parts.size(), maxPartIndex + 1);
+			}
+
+			currentLine = stream.readLine();
+		}
+
+		//last block
+		if (cloudDesc.cloud)
+		{
+			if (!handler(ReleaseBlock(cloudDesc)))
+				return CC_FERR_CANCELED_BY_USER;
+		}
+
+		return CC_FERR_NO_ERROR;
+	}
+
+protected:
+
+	//! Finalizes the current block and releases it
+	static ccPointCloud* ReleaseBlock(cloudAttributesDescriptor& cloudDesc)
+	{
+		ccPointCloud* block = cloudDesc.cloud;
+		//scalar fields are filled with 'setValue': we must update their size
+		block->resize(block->size());
+		cloudDesc.reset();
+		return block;
+	}
+
+	QString m_filename;
+	AsciiOpenDlg::Sequence m_openSequence;
+	char m_separator;
+	unsigned m_skipLines;
+};
+
+//! ASCII point stream writer
+class AsciiStreamWriter : public ccPointStreamWriter
+{
+public:
+
+	explicit AsciiStreamWriter(const AsciiOutputFormat& format)
+		: m_format(format)
+		, m_layoutDefined(false)
+		, m_writeColors(false)
+		, m_writeNorms(false)
+		, m_sfCount(0)
+	{}
+
+	bool open(const QString& filename)
+	{
+		m_file.setFileName(filename);
+		if (!m_file.open(QFile::WriteOnly | QFile::Truncate))
+			return false;
+		m_stream.setDevice(&m_file);
+
+		if (m_format.savePointCountHeader)
+		{
+			//we can't know the number of points in advance
+			ccLog::Warning("[ASCII] The points count header is not supported in streaming mode (ignored)");
+		}
+
+		return true;
+	}
+
+	virtual CC_FILE_ERROR write(const ccPointCloud* block) override
+	{
+		unsigned count = block->size();
+		if (count == 0)
+			return CC_FERR_NO_ERROR;
+
+		//the first (non empty) block defines the output layout
+		if (!m_layoutDefined)
+		{
+			m_writeColors = block->hasColors();
+			m_writeNorms = block->hasNormals();
+			m_sfCount = block->getNumberOfScalarFields();
+			m_layoutDefined = true;
+
+			if (m_format.saveColumnsHeader)
+			{
+				m_stream << m_format.header(m_writeColors, scalarFields(block), m_writeNorms) << "\n";
+			}
+		}
+		else if (	(m_writeColors && !block->hasColors())
+				||	(m_writeNorms && !block->hasNormals())
+				||	block->getNumberOfScalarFields() < m_sfCount)
+		{
+			//all the blocks should have the same layout
+			return CC_FERR_BAD_ENTITY_TYPE;
+		}
+
+		std::vector<ccScalarField*> theScalarFields = scalarFields(block);
+		for (unsigned i = 0; i < count; ++i)
+		{
+			m_stream << m_format.line(block, i, m_writeColors, theScalarFields, m_writeNorms) << "\n";
+		}
+
+		return (m_stream.status() == QTextStream::Ok ? CC_FERR_NO_ERROR : CC_FERR_WRITING);
+	}
+
+	virtual CC_FILE_ERROR finish() override
+	{
+		m_stream.flush();
+		bool ok = (m_stream.status() == QTextStream::Ok);
+		m_file.close();
+		return (ok ? CC_FERR_NO_ERROR : CC_FERR_WRITING);
+	}
+
+protected:
+
+	//! Returns the scalar fields of a block (as defined by the output layout)
+	std::vector<ccScalarField*> scalarFields(const ccPointCloud* block) const
+	{
+		std::vector<ccScalarField*> theScalarFields;
+		for (unsigned i = 0; i < m_sfCount; ++i)
+			theScalarFields.push_back(static_cast<ccScalarField*>(block->getScalarField(static_cast<int>(i))));
+		return theScalarFields;
+	}
+
+	AsciiOutputFormat m_format;
+	QFile m_file;
+	QTextStream m_stream;
+	bool m_layoutDefined;
+	bool m_writeColors;
+	bool m_writeNorms;
+	unsigned m_sfCount;
+};
+
+ccPointStreamReader* AsciiFilter::openStreamReader(const QString& filename, LoadParameters& parameters, CC_FILE_ERROR& result)
+{
+	QFile file(filename);
+	if (!file.exists())
+	{
+		result = CC_FERR_READING;
+		return 0;
+	}
+	if (file.size() == 0)
+	{
+		result = CC_FERR_NO_LOAD;
+		return 0;
+	}
+
+	//column attribution dialog
+	result = InitOpenDialog(filename, parameters);
+	if (result != CC_FERR_NO_ERROR)
+		return 0;
+	AsciiOpenDlg* openDialog = GetOpenDialog();
+	assert(openDialog);
+
+	AsciiStreamReader* reader = new AsciiStreamReader(	filename,
+														openDialog->getOpenSequence(),
+														static_cast<char>(openDialog->getSeparator()),
+														openDialog->getSkippedLinesCount(),
+														parameters);
+
+	s_openDialog.release(); //release the 'source' dialog (so as to be sure to reset it next time)
+
+	return reader;
+}
+
+ccPointStreamWriter* AsciiFilter::openStreamWriter(const QString& filename, CC_FILE_ERROR& result)
+{
+	AsciiSaveDlg* saveDialog = GetSaveDialog();
+	assert(saveDialog);
+
+	AsciiStreamWriter* writer = new AsciiStreamWriter(AsciiOutputFormat(saveDialog));
+	if (!writer->open(filename))
+	{
+		delete writer;
+		result = CC_FERR_WRITING;
+		return 0;
+	}
+
+	result = CC_FERR_NO_ERROR;
+	return writer;
+}
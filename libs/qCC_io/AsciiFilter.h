@@ -56,6 +56,8 @@ public:
 	virtual QString getDefaultExtension() const override { return GetDefaultExtension(); }
 	virtual bool canLoadExtension(QString upperCaseExt) const override;
 	virtual bool canSave(CC_CLASS_ENUM type, bool& multiple, bool& exclusive) const override;
+	virtual ccPointStreamReader* openStreamReader(const QString& filename, LoadParameters& parameters, CC_FILE_ERROR& result) override;
+	virtual ccPointStreamWriter* openStreamWriter(const QString& filename, CC_FILE_ERROR& result) override;
 
 	//! Loads an ASCII file with a predefined format
 	CC_FILE_ERROR loadCloudFromFormatedAsciiFile(	const QString& filename,
@@ -78,6 +80,12 @@ protected:
 	//! Internal use only
 	CC_FILE_ERROR saveFile(ccHObject* entity, FILE *theFile);
 
+	//! Initializes the (semi-persistent) open dialog for a given file
+	/** The dialog is only displayed if the columns can't be guessed automatically
+		(or if the loading parameters require it).
+	**/
+	static CC_FILE_ERROR InitOpenDialog(const QString& filename, LoadParameters& parameters);
+
 	//! Associated (export) dialog
 	static AutoDeletePtr<AsciiSaveDlg> s_saveDialog;
 	//! Associated (import) dialog
@@ -32,6 +32,7 @@
 #include "LASFilter.h"
 #include "E57Filter.h"
 #include "PTXFilter.h"
+#include "OocFilter.h"
 //MESHES
 #include "ObjFilter.h"
 #include "PlyFilter.h"
@@ -52,7 +53,14 @@
 #include "HeightProfileFilter.h"
 
 //Qt
+#include <QCoreApplication>
 #include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QScopedPointer>
+#include <QSemaphore>
+#include <QThread>
+#include <QTimer>
 
 #ifdef USE_VLD
 //VLD
@@ -82,6 +90,7 @@ void FileIOFilter::InitInternalFilters()
 	Register(Shared(new E57Filter()));
 #endif
 	Register(Shared(new PTXFilter()));
+	Register(Shared(new OocFilter()));
 	Register(Shared(new PlyFilter()));
 	Register(Shared(new ObjFilter()));
 	Register(Shared(new VTKFilter()));
@@ -452,27 +461,82 @@ bool FileIOFilter::CheckForSpecialChars(QString filename)
 	return (filename.normalized(QString::NormalizationForm_D) != filename);
 }
 
+//! Mutex shared by all the files loaded in background threads
+/** The (optional) global shift information of the loading parameters is typically
+	shared by several files (it must be read and updated atomically), and only one
+	'global shift' dialog should be displayed at a time.
+**/
+static QMutex s_backgroundGlobalShiftMutex;
+
+//! Mutex protecting the (shared) global shift information of the loading parameters
+/** Locked by all the threads (including the main one), but never while a dialog is displayed.
+**/
+static QMutex s_globalShiftParametersMutex;
+
+bool FileIOFilter::IsGlobalShiftEnabled(const LoadParameters& loadParameters)
+{
+	QMutexLocker locker(&s_globalShiftParametersMutex);
+	return (loadParameters.coordinatesShiftEnabled && *loadParameters.coordinatesShiftEnabled);
+}
+
 bool FileIOFilter::HandleGlobalShift(const CCVector3d& P, CCVector3d& Pshift, LoadParameters& loadParameters, bool useInputCoordinatesShiftIfPossible/*=false*/)
 {
-	bool shiftAlreadyEnabled = (loadParameters.coordinatesShiftEnabled && *loadParameters.coordinatesShiftEnabled && loadParameters.coordinatesShift);
-	if (shiftAlreadyEnabled)
+	//files loaded in background threads are serialized
+	//(the main thread can't wait for them, as they may wait for it to display the dialog)
+	QCoreApplication* app = QCoreApplication::instance();
+	bool backgroundThread = (app && QThread::currentThread() != app->thread());
+	QScopedPointer<QMutexLocker> locker(backgroundThread ? new QMutexLocker(&s_backgroundGlobalShiftMutex) : 0);
+
+	bool shiftAlreadyEnabled = false;
 	{
-		Pshift = *loadParameters.coordinatesShift;
+		QMutexLocker parametersLocker(&s_globalShiftParametersMutex);
+		shiftAlreadyEnabled = (loadParameters.coordinatesShiftEnabled && *loadParameters.coordinatesShiftEnabled && loadParameters.coordinatesShift);
+		if (shiftAlreadyEnabled)
+		{
+			Pshift = *loadParameters.coordinatesShift;
+		}
 	}
 	
 	bool applyAll = false;
-	if (	sizeof(PointCoordinateType) < 8
-		&&	ccGlobalShiftManager::Handle(	P,
-											0,
-											loadParameters.shiftHandlingMode,
-											shiftAlreadyEnabled || useInputCoordinatesShiftIfPossible,
-											Pshift,
-											0,
-											&applyAll) )
+	bool shiftEnabled = false;
+	if (sizeof(PointCoordinateType) < 8)
+	{
+		auto handle = [&]()
+		{
+			shiftEnabled = ccGlobalShiftManager::Handle(	P,
+															0,
+															loadParameters.shiftHandlingMode,
+															shiftAlreadyEnabled || useInputCoordinatesShiftIfPossible,
+															Pshift,
+															0,
+															&applyAll);
+		};
+
+		if (	backgroundThread
+			&&	(	loadParameters.shiftHandlingMode == ccGlobalShiftManager::DIALOG_IF_NECESSARY
+				||	loadParameters.shiftHandlingMode == ccGlobalShiftManager::ALWAYS_DISPLAY_DIALOG) )
+		{
+			//the dialog (if any) must be displayed by the main thread
+			QSemaphore done;
+			QTimer::singleShot(0, app, [&]()
+			{
+				handle();
+				done.release();
+			});
+			done.acquire();
+		}
+		else
+		{
+			handle();
+		}
+	}
+
+	if (shiftEnabled)
 	{
 		//we save coordinates shift information
 		if (applyAll && loadParameters.coordinatesShiftEnabled && loadParameters.coordinatesShift)
 		{
+			QMutexLocker parametersLocker(&s_globalShiftParametersMutex);
 			*loadParameters.coordinatesShiftEnabled = true;
 			*loadParameters.coordinatesShift = Pshift;
 		}
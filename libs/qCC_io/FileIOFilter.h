@@ -26,6 +26,8 @@
 #include "ccGlobalShiftManager.h"
 
 class QWidget;
+class ccPointStreamReader;
+class ccPointStreamWriter;
 
 //! Typical I/O filter errors
 enum CC_FILE_ERROR {
@@ -117,6 +119,12 @@ public: //public interface (to be reimplemented by each I/O filter)
 		return false;
 	}
 
+	//! Returns whether this I/O filter can import files in a background thread
+	/** I.e. concurrently with other files, and without any dialog or progress
+		dialog as long as LoadParameters::parentWidget is not set.
+	**/
+	virtual bool backgroundImportSupported() const { return false; }
+
 	//! Loads one or more entities from a file
 	/** This method must be implemented by children classes.
 	  * 뱻ִ
@@ -181,6 +189,35 @@ public: //public interface (to be reimplemented by each I/O filter)
 	**/
 	virtual bool canSave(CC_CLASS_ENUM type, bool& multiple, bool& exclusive) const = 0;
 
+public: //out-of-core (streaming) interface
+
+	//! Opens a point cloud file for sequential reading (block by block)
+	/** Only for filters that can read a cloud without loading it entirely in memory.
+		\param filename file to read
+		\param parameters generic loading parameters (for the global shift)
+		\param result error (if any)
+		\return reader (or 0 if streaming is not supported by this filter) - to be deleted by the caller
+	**/
+	virtual ccPointStreamReader* openStreamReader(	const QString& filename,
+													LoadParameters& parameters,
+													CC_FILE_ERROR& result)
+	{
+		result = CC_FERR_NOT_IMPLEMENTED;
+		return 0;
+	}
+
+	//! Creates a point cloud file for sequential writing (block by block)
+	/** \param filename file to create
+		\param result error (if any)
+		\return writer (or 0 if streaming is not supported by this filter) - to be deleted by the caller
+	**/
+	virtual ccPointStreamWriter* openStreamWriter(	const QString& filename,
+													CC_FILE_ERROR& result)
+	{
+		result = CC_FERR_NOT_IMPLEMENTED;
+		return 0;
+	}
+
 public: //static methods
 
 	//! Loads one or more entities from a file with a known filter
@@ -246,6 +283,11 @@ public: //static methods
 		LoadParameters& loadParameters,
 		bool useInputCoordinatesShiftIfPossible = false);
 
+	//! Returns whether the (shared) global shift of the loading parameters is already enabled
+	/** Thread-safe (see HandleGlobalShift).
+	**/
+	QCC_IO_LIB_API static bool IsGlobalShiftEnabled(const LoadParameters& loadParameters);
+
 	//! Displays (to console) the message corresponding to a given error code
 	/** \param err error code
 		\param action "saving", "reading", etc.
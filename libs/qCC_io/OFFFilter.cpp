@@ -28,6 +28,9 @@
 #include <QMessageBox>
 #include <QPushButton>
 
+//local
+#include "ccMappedTextFile.h"
+
 //qCC_db
 #include <ccLog.h>
 #include <ccMesh.h>
@@ -37,6 +40,7 @@
 
 //System
 #include <string.h>
+#include <algorithm>
 
 bool OFFFilter::canLoadExtension(QString upperCaseExt) const
 {
@@ -118,181 +122,294 @@ CC_FILE_ERROR OFFFilter::saveToFile(ccHObject* entity, QString filename, SavePar
 }
 
 
-static QString GetNextLine(QTextStream& stream)
+//! Returns whether a line (from p) is a data line (i.e. neither empty nor a comment)
+static inline bool IsDataLine(const char* p, const char* end)
+{
+	p = ccMappedTextFile::SkipBlanks(p, end);
+	return p != end && *p != '\n' && *p != '#';
+}
+
+//! Returns the beginning of the next data line (or 'end')
+static const char* GetNextDataLine(const char* p, const char* end)
+{
+	while (p != end && !IsDataLine(p, end))
+		p = ccMappedTextFile::NextLine(p, end);
+	return p;
+}
+
+//! Chunk of an OFF file (parsed in parallel)
+struct OFFChunk
+{
+	ccMappedTextFile::Chunk range;
+	//! index of the first data line of the chunk
+	unsigned firstLine;
+	//! number of data lines in the chunk
+	unsigned lineCount;
+	//! index of the first triangle of the chunk
+	unsigned firstTriangle;
+	//! number of triangles in the chunk
+	unsigned triCount;
+	//! whether some polygons were ignored (> 4 vertices)
+	bool ignoredPolygons;
+	//! whether the chunk is malformed
+	bool error;
+
+	//shared parameters
+	unsigned vertCount;
+	unsigned facetCount;
+	CCVector3d Pshift;
+	ccPointCloud* vertices;
+	ccMesh* mesh;
+};
+
+//! Pass 1: counts the data lines of a chunk
+static void CountOFFLines(OFFChunk& chunk)
 {
-	QString currentLine;
-	//skip comments
-	do
+	chunk.lineCount = 0;
+	for (const char* p = chunk.range.begin; p != chunk.range.end; p = ccMappedTextFile::NextLine(p, chunk.range.end))
 	{
-		currentLine = stream.readLine();
-		//end of file?
-		if (currentLine.isNull())
-			return QString();
+		if (IsDataLine(p, chunk.range.end))
+			++chunk.lineCount;
 	}
-	while (currentLine.startsWith("#") || currentLine.isEmpty());
+}
+
+//! Decodes the vertex indexes of a polygon (returns the number of vertices or 0 if the polygon is malformed)
+static unsigned ReadOFFPolygon(const char* p, const char* end, unsigned indexes[4])
+{
+	unsigned polyVertCount = 0;
+	if (!ccMappedTextFile::ParseUInt(p, end, polyVertCount) || !ccMappedTextFile::IsTokenEnd(p, end) || polyVertCount < 3)
+		return 0;
 
-	return currentLine;
+	unsigned count = std::min(polyVertCount, 4u);
+	for (unsigned j = 0; j < count; ++j)
+	{
+		if (!ccMappedTextFile::ParseUInt(p, end, indexes[j]) || !ccMappedTextFile::IsTokenEnd(p, end))
+			return 0;
+	}
+
+	return polyVertCount;
+}
+
+//! Pass 2: reads the vertices and counts the triangles of a chunk
+static void ReadOFFVertices(OFFChunk& chunk)
+{
+	chunk.triCount = 0;
+	chunk.ignoredPolygons = false;
+	chunk.error = false;
+
+	const char* end = chunk.range.end;
+	unsigned lineIndex = chunk.firstLine;
+	for (const char* p = chunk.range.begin; p != end && lineIndex < chunk.vertCount + chunk.facetCount; p = ccMappedTextFile::NextLine(p, end))
+	{
+		if (!IsDataLine(p, end))
+			continue;
+
+		if (lineIndex < chunk.vertCount)
+		{
+			CCVector3d Pd;
+			const char* c = p;
+			if (	!ccMappedTextFile::ParseDouble(c, end, Pd.x)
+				||	!ccMappedTextFile::ParseDouble(c, end, Pd.y)
+				||	!ccMappedTextFile::ParseDouble(c, end, Pd.z) )
+			{
+				chunk.error = true;
+				return;
+			}
+			*const_cast<CCVector3*>(chunk.vertices->getPointPersistentPtr(lineIndex)) = CCVector3::fromArray((Pd + chunk.Pshift).u);
+		}
+		else
+		{
+			unsigned indexes[4];
+			unsigned polyVertCount = ReadOFFPolygon(p, end, indexes);
+			if (polyVertCount == 0)
+			{
+				chunk.error = true;
+				return;
+			}
+			if (polyVertCount <= 4)
+				chunk.triCount += polyVertCount - 2;
+			else
+				chunk.ignoredPolygons = true;
+		}
+
+		++lineIndex;
+	}
+}
+
+//! Pass 3: reads the triangles of a chunk
+static void ReadOFFTriangles(OFFChunk& chunk)
+{
+	if (chunk.triCount == 0)
+		return;
+
+	const char* end = chunk.range.end;
+	unsigned lineIndex = chunk.firstLine;
+	unsigned triIndex = chunk.firstTriangle;
+	for (const char* p = chunk.range.begin; p != end && lineIndex < chunk.vertCount + chunk.facetCount; p = ccMappedTextFile::NextLine(p, end))
+	{
+		if (!IsDataLine(p, end))
+			continue;
+
+		if (lineIndex >= chunk.vertCount)
+		{
+			unsigned indexes[4];
+			unsigned polyVertCount = ReadOFFPolygon(p, end, indexes);
+			//triangle or quad only
+			if (polyVertCount == 3 || polyVertCount == 4)
+			{
+				CCLib::VerticesIndexes* tsi = chunk.mesh->getTriangleVertIndexes(triIndex++);
+				tsi->i1 = indexes[0];
+				tsi->i2 = indexes[1];
+				tsi->i3 = indexes[2];
+				if (polyVertCount == 4)
+				{
+					tsi = chunk.mesh->getTriangleVertIndexes(triIndex++);
+					tsi->i1 = indexes[0];
+					tsi->i2 = indexes[2];
+					tsi->i3 = indexes[3];
+				}
+			}
+		}
+
+		++lineIndex;
+	}
 }
 
 CC_FILE_ERROR OFFFilter::loadFile(QString filename, ccHObject& container, LoadParameters& parameters)
 {
-	//try to open file
-	QFile fp(filename);
-	if (!fp.open(QIODevice::ReadOnly | QIODevice::Text))
+	//try to open (map) the file
+	ccMappedTextFile file;
+	if (!file.open(filename))
 		return CC_FERR_READING;
 
-	QTextStream stream(&fp);
+	const char* begin = file.begin();
+	const char* end = file.end();
 
-	QString currentLine = stream.readLine();
-	if (!currentLine.toUpper().startsWith("OFF"))
+	if (!ccMappedTextFile::StartsWith(begin, end, "OFF"))
 		return CC_FERR_MALFORMED_FILE;
 
 	//check if the number of vertices/faces/etc. are on the first line (yes it happens :( )
-	QStringList tokens = currentLine.split(QRegExp("\\s+"),QString::SkipEmptyParts);
-	if (tokens.size() == 4)
-	{
-		tokens.removeAt(0);
-	}
-	else
+	const char* countsLine = ccMappedTextFile::TokenEnd(begin, end);
+	if (ccMappedTextFile::IsLineEnd(countsLine, end))
 	{
-		currentLine = GetNextLine(stream);
+		countsLine = GetNextDataLine(ccMappedTextFile::NextLine(begin, end), end);
 
 		//end of file already?!
-		if (currentLine.isNull())
+		if (countsLine == end)
 			return CC_FERR_MALFORMED_FILE;
+	}
 
-		//read the number of vertices/faces
-		tokens = currentLine.split(QRegExp("\\s+"),QString::SkipEmptyParts);
-		if (tokens.size() < 2/*3*/) //should be 3 but we only use the 2 firsts...
+	//read the number of vertices/faces (there should be 3 numbers but we only use the 2 firsts...)
+	unsigned vertCount = 0;
+	unsigned triCount = 0;
+	{
+		const char* p = countsLine;
+		if (	!ccMappedTextFile::ParseUInt(p, end, vertCount) || !ccMappedTextFile::IsTokenEnd(p, end)
+			||	!ccMappedTextFile::ParseUInt(p, end, triCount) || !ccMappedTextFile::IsTokenEnd(p, end) )
+		{
 			return CC_FERR_MALFORMED_FILE;
+		}
 	}
 
-	bool ok = false;
-	unsigned vertCount = tokens[0].toUInt(&ok);
-	if (!ok)
-		return CC_FERR_MALFORMED_FILE;
-	unsigned triCount = tokens[1].toUInt(&ok);
-	if (!ok)
-		return CC_FERR_MALFORMED_FILE;
+	//split the remaining data in chunks (of whole lines)
+	const char* dataBegin = ccMappedTextFile::NextLine(countsLine, end);
+	std::vector<ccMappedTextFile::Chunk> ranges = ccMappedTextFile::Split(dataBegin, end);
+	std::vector<OFFChunk> chunks;
+	try
+	{
+		chunks.resize(ranges.size());
+	}
+	catch (const std::bad_alloc&)
+	{
+		return CC_FERR_NOT_ENOUGH_MEMORY;
+	}
+
+	//pass 1: count the data lines of each chunk
+	for (size_t i = 0; i < chunks.size(); ++i)
+	{
+		chunks[i].range = ranges[i];
+	}
+	ccMappedTextFile::ProcessInParallel(chunks, CountOFFLines);
+	{
+		unsigned lineCount = 0;
+		for (size_t i = 0; i < chunks.size(); ++i)
+		{
+			chunks[i].firstLine = lineCount;
+			lineCount += chunks[i].lineCount;
+		}
+		if (lineCount < vertCount + triCount)
+			return CC_FERR_MALFORMED_FILE;
+	}
 
 	//create cloud and reserve some memory
 	ccPointCloud* vertices = new ccPointCloud("vertices");
-	if (!vertices->reserve(vertCount))
+	if (!vertices->resize(vertCount))
 	{
 		delete vertices;
 		return CC_FERR_NOT_ENOUGH_MEMORY;
 	}
 
-	//read vertices
+	//first point: check for 'big' coordinates
+	CCVector3d Pshift(0,0,0);
+	if (vertCount != 0)
 	{
-		CCVector3d Pshift(0,0,0);
-		for (unsigned i=0; i<vertCount; ++i)
+		const char* p = GetNextDataLine(dataBegin, end);
+		CCVector3d Pd;
+		if (	!ccMappedTextFile::ParseDouble(p, end, Pd.x)
+			||	!ccMappedTextFile::ParseDouble(p, end, Pd.y)
+			||	!ccMappedTextFile::ParseDouble(p, end, Pd.z) )
 		{
-			currentLine = GetNextLine(stream);
-			tokens = currentLine.split(QRegExp("\\s+"),QString::SkipEmptyParts);
-			if (tokens.size() < 3)
-			{
-				delete vertices;
-				return CC_FERR_MALFORMED_FILE;
-			}
-
-			//read vertex
-			CCVector3d Pd(0,0,0);
-			{
-				bool vertexIsOk = false;
-				Pd.x = tokens[0].toDouble(&vertexIsOk);
-				if (vertexIsOk)
-				{
-					Pd.y = tokens[1].toDouble(&vertexIsOk);
-					if (vertexIsOk)
-						Pd.z = tokens[2].toDouble(&vertexIsOk);
-				}
-				if (!vertexIsOk)
-				{
-					delete vertices;
-					return CC_FERR_MALFORMED_FILE;
-				}
-			}
-
-			//first point: check for 'big' coordinates
-			if (i == 0)
-			{
-				if (HandleGlobalShift(Pd,Pshift,parameters))
-				{
-					vertices->setGlobalShift(Pshift);
-					ccLog::Warning("[OFF] Cloud has been recentered! Translation: (%.2f ; %.2f ; %.2f)",Pshift.x,Pshift.y,Pshift.z);
-				}
-			}
+			delete vertices;
+			return CC_FERR_MALFORMED_FILE;
+		}
 
-			CCVector3 P = CCVector3::fromArray((Pd + Pshift).u);
-			vertices->addPoint(P);
+		if (HandleGlobalShift(Pd,Pshift,parameters))
+		{
+			vertices->setGlobalShift(Pshift);
+			ccLog::Warning("[OFF] Cloud has been recentered! Translation: (%.2f ; %.2f ; %.2f)",Pshift.x,Pshift.y,Pshift.z);
 		}
 	}
 
 	ccMesh* mesh = new ccMesh(vertices);
 	mesh->addChild(vertices);
-	if (!mesh->reserve(triCount))
+
+	//pass 2: read the vertices and count the triangles
+	for (size_t i = 0; i < chunks.size(); ++i)
 	{
-		delete mesh;
-		return CC_FERR_NOT_ENOUGH_MEMORY;
+		OFFChunk& chunk = chunks[i];
+		chunk.vertCount = vertCount;
+		chunk.facetCount = triCount;
+		chunk.Pshift = Pshift;
+		chunk.vertices = vertices;
+		chunk.mesh = mesh;
 	}
+	ccMappedTextFile::ProcessInParallel(chunks, ReadOFFVertices);
 
 	//load triangles
 	{
 		bool ignoredPolygons = false;
-		for (unsigned i=0; i<triCount; ++i)
+		unsigned meshTriCount = 0;
+		for (size_t i = 0; i < chunks.size(); ++i)
 		{
-			currentLine = GetNextLine(stream);
-			tokens = currentLine.split(QRegExp("\\s+"),QString::SkipEmptyParts);
-			if (tokens.size() < 3)
+			if (chunks[i].error)
 			{
 				delete mesh;
 				return CC_FERR_MALFORMED_FILE;
 			}
+			chunks[i].firstTriangle = meshTriCount;
+			meshTriCount += chunks[i].triCount;
+			ignoredPolygons |= chunks[i].ignoredPolygons;
+		}
 
-			unsigned polyVertCount = tokens[0].toUInt(&ok);
-			if (!ok || static_cast<int>(polyVertCount) >= tokens.size())
-			{
-				delete mesh;
-				return CC_FERR_MALFORMED_FILE;
-			}
-			if (polyVertCount == 3 || polyVertCount == 4)
-			{
-				//decode indexes
-				unsigned indexes[4];
-				for (unsigned j=0; j<polyVertCount; ++j)
-				{
-					indexes[j] = tokens[j+1].toUInt(&ok);
-					if (!ok)
-					{
-						delete mesh;
-						return CC_FERR_MALFORMED_FILE;
-					}
-				}
-
-				//reserve memory if necessary
-				unsigned polyTriCount = polyVertCount-2;
-				if (mesh->size() + polyTriCount > mesh->capacity())
-				{
-					if (!mesh->reserve(mesh->size() + polyTriCount + 256)) //use some margin to avoid too many allocations
-					{
-						delete mesh;
-						return CC_FERR_NOT_ENOUGH_MEMORY;
-					}
-				}
-
-				//triangle or quad only
-				mesh->addTriangle(indexes[0],indexes[1],indexes[2]);
-				if (polyVertCount == 4)
-					mesh->addTriangle(indexes[0],indexes[2],indexes[3]);
-
-			}
-			else
-			{
-				ignoredPolygons = true;
-			}
+		if (!mesh->resize(meshTriCount))
+		{
+			delete mesh;
+			return CC_FERR_NOT_ENOUGH_MEMORY;
 		}
 
+		//pass 3: read the triangles
+		ccMappedTextFile::ProcessInParallel(chunks, ReadOFFTriangles);
+
 		if (ignoredPolygons)
 		{
 			ccLog::Warning("[OFF] Some polygons with an unhandled size (i.e. > 4) were ignored!");
@@ -22,9 +22,14 @@
 #include <QFileInfo>
 #include <QStringList>
 #include <QString>
+#include <QByteArray>
 #include <QFile>
+#include <QScopedPointer>
 #include <QTextStream>
 
+//local
+#include "ccMappedTextFile.h"
+
 //qCC_db
 #include <ccLog.h>
 #include <ccMesh.h>
@@ -38,6 +43,7 @@
 
 //System
 #include <string.h>
+#include <algorithm>
 
 bool ObjFilter::canLoadExtension(QString upperCaseExt) const
 {
@@ -398,15 +404,227 @@ struct facetElement
 	}
 };
 
+//! OBJ 'element' lines (parsed in parallel)
+enum OBJ_LINE_TYPE { OBJ_OTHER_LINE = 0, OBJ_VERTEX_LINE = 1, OBJ_TEX_COORD_LINE = 2, OBJ_NORMAL_LINE = 3, OBJ_FACE_LINE = 4 };
+
+//! Returns the type of a line (p should point on the first token)
+static inline OBJ_LINE_TYPE GetObjLineType(const char* p, const char* end)
+{
+	if (p == end)
+		return OBJ_OTHER_LINE;
+	if (*p == 'v')
+	{
+		if (ccMappedTextFile::IsTokenEnd(p + 1, end))
+			return OBJ_VERTEX_LINE;
+		if (p + 1 != end && ccMappedTextFile::IsTokenEnd(p + 2, end))
+		{
+			if (p[1] == 't')
+				return OBJ_TEX_COORD_LINE;
+			if (p[1] == 'n')
+				return OBJ_NORMAL_LINE;
+		}
+	}
+	else if (*p == 'f')
+	{
+		return OBJ_FACE_LINE;
+	}
+	return OBJ_OTHER_LINE;
+}
+
+//! Returns the number of elements of a line (i.e. the number of tokens after the first one)
+static inline unsigned CountObjElements(const char* p, const char* lineEnd)
+{
+	unsigned count = 0;
+	p = ccMappedTextFile::SkipBlanks(ccMappedTextFile::TokenEnd(p, lineEnd), lineEnd);
+	while (p != lineEnd)
+	{
+		++count;
+		p = ccMappedTextFile::SkipBlanks(ccMappedTextFile::TokenEnd(p, lineEnd), lineEnd);
+	}
+	return count;
+}
+
+//! Chunk of an OBJ file
+struct OBJChunk
+{
+	ccMappedTextFile::Chunk range;
+	//! number of vertices in the chunk
+	unsigned vCount;
+	//! number of texture coordinates in the chunk
+	unsigned vtCount;
+	//! number of normals in the chunk
+	unsigned vnCount;
+	//! number of triangles in the chunk (after tesselation)
+	unsigned triCount;
+	//! index of the first vertex of the chunk
+	unsigned firstV;
+	//! index of the first texture coordinates of the chunk
+	unsigned firstVT;
+	//! index of the first normal of the chunk
+	unsigned firstVN;
+	//! whether the chunk has invalid (non unit) normals
+	bool invalidNormals;
+	//! whether the chunk is malformed
+	bool error;
+
+	//shared parameters
+	CCVector3d Pshift;
+	ccPointCloud* vertices;
+	TextureCoordsContainer* texCoords;
+	NormsIndexesTableType* normals;
+};
+
+//! Pass 1: counts the elements of a chunk
+static void CountObjChunkElements(OBJChunk& chunk)
+{
+	chunk.vCount = chunk.vtCount = chunk.vnCount = chunk.triCount = 0;
+
+	const char* end = chunk.range.end;
+	for (const char* p = chunk.range.begin; p != end; p = ccMappedTextFile::NextLine(p, end))
+	{
+		p = ccMappedTextFile::SkipBlanks(p, end);
+		switch (GetObjLineType(p, end))
+		{
+		case OBJ_VERTEX_LINE:
+			++chunk.vCount;
+			break;
+		case OBJ_TEX_COORD_LINE:
+			++chunk.vtCount;
+			break;
+		case OBJ_NORMAL_LINE:
+			++chunk.vnCount;
+			break;
+		case OBJ_FACE_LINE:
+		{
+			unsigned polyVertCount = CountObjElements(p, ccMappedTextFile::LineEnd(p, end));
+			if (polyVertCount >= 3)
+				chunk.triCount += polyVertCount - 2;
+		}
+		break;
+		default:
+			break;
+		}
+	}
+}
+
+//! Pass 2: reads the vertices, texture coordinates and normals of a chunk
+static void ReadObjElements(OBJChunk& chunk)
+{
+	chunk.invalidNormals = false;
+	chunk.error = false;
+
+	unsigned vIndex = chunk.firstV;
+	unsigned vtIndex = chunk.firstVT;
+	unsigned vnIndex = chunk.firstVN;
+
+	const char* end = chunk.range.end;
+	for (const char* p = chunk.range.begin; p != end; p = ccMappedTextFile::NextLine(p, end))
+	{
+		p = ccMappedTextFile::SkipBlanks(p, end);
+		OBJ_LINE_TYPE type = GetObjLineType(p, end);
+		if (type == OBJ_OTHER_LINE || type == OBJ_FACE_LINE)
+			continue;
+
+		const char* c = ccMappedTextFile::TokenEnd(p, end);
+		switch (type)
+		{
+		case OBJ_VERTEX_LINE:
+		{
+			CCVector3d Pd;
+			if (	!ccMappedTextFile::ParseDouble(c, end, Pd.x)
+				||	!ccMappedTextFile::ParseDouble(c, end, Pd.y)
+				||	!ccMappedTextFile::ParseDouble(c, end, Pd.z) )
+			{
+				chunk.error = true;
+				return;
+			}
+			//shifted point
+			*const_cast<CCVector3*>(chunk.vertices->getPointPersistentPtr(vIndex++)) = CCVector3::fromArray((Pd + chunk.Pshift).u);
+		}
+		break;
+
+		case OBJ_TEX_COORD_LINE:
+		{
+			double T[2] = { 0, 0 };
+			if (!ccMappedTextFile::ParseDouble(c, end, T[0]))
+			{
+				chunk.error = true;
+				return;
+			}
+			//OBJ specification allows for only one value!!!
+			if (!ccMappedTextFile::IsLineEnd(c, end))
+				ccMappedTextFile::ParseDouble(c, end, T[1]);
+
+			float Tf[2] = { static_cast<float>(T[0]), static_cast<float>(T[1]) };
+			chunk.texCoords->setValue(vtIndex++, Tf);
+		}
+		break;
+
+		case OBJ_NORMAL_LINE:
+		{
+			CCVector3d Nd;
+			if (	!ccMappedTextFile::ParseDouble(c, end, Nd.x)
+				||	!ccMappedTextFile::ParseDouble(c, end, Nd.y)
+				||	!ccMappedTextFile::ParseDouble(c, end, Nd.z) )
+			{
+				chunk.error = true;
+				return;
+			}
+			CCVector3 N = CCVector3::fromArray(Nd.u);
+			if (fabs(N.norm2() - 1.0) > 0.005)
+			{
+				chunk.invalidNormals = true;
+				N.normalize();
+			}
+			//we don't know yet if it's per-vertex or per-triangle normal...
+			chunk.normals->setValue(vnIndex++, ccNormalVectors::GetNormIndex(N.u));
+		}
+		break;
+
+		default:
+			assert(false);
+			break;
+		}
+	}
+}
+
+//! Reads an OBJ face/polyline vertex ('v', 'v/vt', 'v//vn' or 'v/vt/vn')
+/** \return false if the vertex index is missing
+**/
+static bool ReadObjFacetElement(const char* p, const char* tokenEnd, facetElement& fe)
+{
+	if (p == tokenEnd || *p == '/')
+		return false;
+
+	//DGM: invalid values are replaced by 0 (and will be detected later)
+	if (!ccMappedTextFile::ParseInt(p, tokenEnd, fe.vIndex))
+		return true;
+	if (p != tokenEnd && *p == '/')
+	{
+		++p;
+		if (p != tokenEnd && *p != '/')
+			ccMappedTextFile::ParseInt(p, tokenEnd, fe.tcIndex);
+		if (p != tokenEnd && *p == '/')
+		{
+			++p;
+			if (p != tokenEnd)
+				ccMappedTextFile::ParseInt(p, tokenEnd, fe.nIndex);
+		}
+	}
+
+	return true;
+}
+
 CC_FILE_ERROR ObjFilter::loadFile(QString filename, ccHObject& container, LoadParameters& parameters)
 {
 	ccLog::Print(QString("[OBJ] ") + filename);
 
-	//open file
-	QFile file(filename);
-	if (!file.open(QFile::ReadOnly))
+	//open (map) file
+	ccMappedTextFile file;
+	if (!file.open(filename))
 		return CC_FERR_READING;
-	QTextStream stream(&file);
+	const char* begin = file.begin();
+	const char* end = file.end();
 
 	//current vertex shift
 	CCVector3d Pshift(0,0,0);
@@ -423,12 +641,6 @@ CC_FILE_ERROR ObjFilter::loadFile(QString filename, ccHObject& container, LoadPa
 	//base mesh
 	ccMesh* baseMesh = new ccMesh(vertices);
 	baseMesh->setName(QFileInfo(filename).baseName());
-	//we need some space already reserved!
-	if (!baseMesh->reserve(128))
-	{
-		ccLog::Error("Not engouh memory!");
-		return CC_FERR_NOT_ENOUGH_MEMORY;
-	}
 
 	//groups (starting index + name)
 	std::vector<std::pair<unsigned,QString> > groups;
@@ -453,12 +665,15 @@ CC_FILE_ERROR ObjFilter::loadFile(QString filename, ccHObject& container, LoadPa
 	int maxTriNormIndex = -1;
 
 	//progress dialog
-	ccProgressDialog pDlg(true, parameters.parentWidget);
-	pDlg.setMethodTitle(QObject::tr("OBJ file"));
-	pDlg.setInfo(QObject::tr("Loading in progress..."));
-	pDlg.setRange(0, static_cast<int>(file.size()));
-	pDlg.show();
-	QApplication::processEvents();
+	QScopedPointer<ccProgressDialog> pDlg(parameters.parentWidget ? new ccProgressDialog(true, parameters.parentWidget) : 0);
+	if (parameters.parentWidget)
+	{
+		pDlg->setMethodTitle(QObject::tr("OBJ file"));
+		pDlg->setInfo(QObject::tr("Loading in progress..."));
+		pDlg->setRange(0, static_cast<int>(file.size() >> 10));
+		pDlg->show();
+		QApplication::processEvents();
+	}
 
 	//common warnings that can appear multiple time (we avoid to send too many messages to the console!)
 	enum OBJ_WARNINGS {	INVALID_NORMALS		= 0,
@@ -466,164 +681,189 @@ CC_FILE_ERROR ObjFilter::loadFile(QString filename, ccHObject& container, LoadPa
 						NOT_ENOUGH_MEMORY	= 2,
 						INVALID_LINE		= 3,
 						CANCELLED_BY_USER	= 4,
+						INVALID_VALUE		= 5,
 	};
-	bool objWarnings[5] = { false, false, false, false, false };
+	bool objWarnings[6] = { false, false, false, false, false, false };
 	bool error = false;
+	unsigned skippedFaces = 0;
 
 	try
 	{
-		unsigned lineCount = 0;
-		unsigned polyCount = 0;
-		QString currentLine = stream.readLine();
-		while (!currentLine.isNull())
+		//the vertices, texture coordinates and normals are read in parallel (count, then fill)
+		std::vector<ccMappedTextFile::Chunk> ranges = ccMappedTextFile::Split(begin, end);
+		std::vector<OBJChunk> chunks(ranges.size());
+		for (size_t i = 0; i < chunks.size(); ++i)
 		{
-			if ((++lineCount % 2048) == 0)
-			{
-				if (pDlg.wasCanceled())
-				{
-					error = true;
-					objWarnings[CANCELLED_BY_USER] = true;
-					break;
-				}
-				pDlg.setValue(static_cast<int>(file.pos()));
-				QApplication::processEvents();
-			}
+			chunks[i].range = ranges[i];
+		}
 
-			QStringList tokens = QString(currentLine).split(QRegExp("\\s+"),QString::SkipEmptyParts);
+		//pass 1: count the elements
+		if (!ccMappedTextFile::ProcessInParallel(chunks, CountObjChunkElements, pDlg.data()))
+		{
+			error = true;
+			objWarnings[CANCELLED_BY_USER] = true;
+		}
 
-			//skip comments & empty lines
-			if (tokens.empty() || tokens.front().startsWith('/', Qt::CaseInsensitive) || tokens.front().startsWith('#', Qt::CaseInsensitive))
+		unsigned vCount = 0, vtCount = 0, vnCount = 0, triCount = 0;
+		for (size_t i = 0; i < chunks.size(); ++i)
+		{
+			OBJChunk& chunk = chunks[i];
+			chunk.firstV = vCount;
+			chunk.firstVT = vtCount;
+			chunk.firstVN = vnCount;
+			vCount += chunk.vCount;
+			vtCount += chunk.vtCount;
+			vnCount += chunk.vnCount;
+			triCount += chunk.triCount;
+		}
+
+		//reserve memory
+		if (!error)
+		{
+			//we need some space already reserved!
+			if (!vertices->resize(vCount) || !baseMesh->reserve(std::max(triCount, 128u)))
 			{
-				currentLine = stream.readLine();
-				continue;
+				objWarnings[NOT_ENOUGH_MEMORY] = true;
+				error = true;
 			}
-
-			/*** new vertex ***/
-			if (tokens.front() == "v")
+			else if (vtCount != 0)
 			{
-				//reserve more memory if necessary
-				if (vertices->size() == vertices->capacity())
+				texCoords = new TextureCoordsContainer();
+				texCoords->link();
+				if (!texCoords->resize(vtCount))
 				{
-					if (!vertices->reserve(vertices->capacity() + MAX_NUMBER_OF_ELEMENTS_PER_CHUNK))
-					{
-						objWarnings[NOT_ENOUGH_MEMORY] = true;
-						error = true;
-						break;
-					}
+					objWarnings[NOT_ENOUGH_MEMORY] = true;
+					error = true;
 				}
-
-				//malformed line?
-				if (tokens.size() < 4)
+			}
+			if (!error && vnCount != 0)
+			{
+				normals = new NormsIndexesTableType;
+				normals->link();
+				if (!normals->resize(vnCount))
 				{
-					objWarnings[INVALID_LINE] = true;
+					objWarnings[NOT_ENOUGH_MEMORY] = true;
 					error = true;
-					break;
 				}
+			}
+		}
 
-				CCVector3d Pd( tokens[1].toDouble(), tokens[2].toDouble(), tokens[3].toDouble() );
+		//first point: check for 'big' coordinates
+		if (!error && vCount != 0)
+		{
+			const char* p = begin;
+			while (GetObjLineType(ccMappedTextFile::SkipBlanks(p, end), end) != OBJ_VERTEX_LINE)
+			{
+				p = ccMappedTextFile::NextLine(p, end);
+			}
+			p = ccMappedTextFile::TokenEnd(ccMappedTextFile::SkipBlanks(p, end), end);
 
-				//first point: check for 'big' coordinates
-				if (pointsRead == 0)
-				{
-					if (HandleGlobalShift(Pd, Pshift, parameters))
-					{
-						vertices->setGlobalShift(Pshift);
-						ccLog::Warning("[OBJ] Cloud has been recentered! Translation: (%.2f ; %.2f ; %.2f)", Pshift.x, Pshift.y, Pshift.z);
-					}
-				}
+			CCVector3d Pd;
+			if (	ccMappedTextFile::ParseDouble(p, end, Pd.x)
+				&&	ccMappedTextFile::ParseDouble(p, end, Pd.y)
+				&&	ccMappedTextFile::ParseDouble(p, end, Pd.z)
+				&&	HandleGlobalShift(Pd, Pshift, parameters) )
+			{
+				vertices->setGlobalShift(Pshift);
+				ccLog::Warning("[OBJ] Cloud has been recentered! Translation: (%.2f ; %.2f ; %.2f)", Pshift.x, Pshift.y, Pshift.z);
+			}
+		}
 
-				//shifted point
-				CCVector3 P = CCVector3::fromArray((Pd + Pshift).u);
-				vertices->addPoint(P);
-				++pointsRead;
+		//pass 2: read the elements
+		if (!error)
+		{
+			for (size_t i = 0; i < chunks.size(); ++i)
+			{
+				OBJChunk& chunk = chunks[i];
+				chunk.Pshift = Pshift;
+				chunk.vertices = vertices;
+				chunk.texCoords = texCoords;
+				chunk.normals = normals;
 			}
-			/*** new vertex texture coordinates ***/
-			else if (tokens.front() == "vt")
+			if (!ccMappedTextFile::ProcessInParallel(chunks, ReadObjElements, pDlg.data()))
 			{
-				//create and reserve memory for tex. coords container if necessary
-				if (!texCoords)
-				{
-					texCoords = new TextureCoordsContainer();
-					texCoords->link();
-				}
-				if (texCoords->currentSize() == texCoords->capacity())
+				error = true;
+				objWarnings[CANCELLED_BY_USER] = true;
+			}
+			else
+			{
+				for (size_t i = 0; i < chunks.size(); ++i)
 				{
-					if (!texCoords->reserve(texCoords->capacity() + MAX_NUMBER_OF_ELEMENTS_PER_CHUNK))
+					if (chunks[i].error)
 					{
-						objWarnings[NOT_ENOUGH_MEMORY] = true;
+						//a missing or malformed coordinate can't be replaced silently
+						objWarnings[INVALID_VALUE] = true;
 						error = true;
-						break;
+					}
+					if (chunks[i].invalidNormals)
+					{
+						objWarnings[INVALID_NORMALS] = true;
 					}
 				}
+			}
+		}
 
-				//malformed line?
-				if (tokens.size() < 2)
+		//pass 3: the other elements (faces, groups, materials, etc.) are processed sequentially
+		//(as they depend on the previous lines)
+		unsigned lineCount = 0;
+		unsigned polyCount = 0;
+		std::vector<facetElement> currentFace;
+		for (const char* lineStart = begin; !error && lineStart != end; lineStart = ccMappedTextFile::NextLine(lineStart, end))
+		{
+			if (pDlg && (++lineCount % 2048) == 0)
+			{
+				if (pDlg->wasCanceled())
 				{
-					objWarnings[INVALID_LINE] = true;
 					error = true;
+					objWarnings[CANCELLED_BY_USER] = true;
 					break;
 				}
+				pDlg->setValue(static_cast<int>((lineStart - begin) >> 10));
+				QApplication::processEvents();
+			}
 
-				float T[2] = { T[0] = tokens[1].toFloat(), 0 };
+			const char* lineEnd = ccMappedTextFile::LineEnd(lineStart, end);
+			const char* p = ccMappedTextFile::SkipBlanks(lineStart, lineEnd);
 
-				if (tokens.size() > 2) //OBJ specification allows for only one value!!!
-				{
-					T[1] = tokens[2].toFloat();
-				}
+			//skip comments & empty lines
+			if (p == lineEnd || *p == '/' || *p == '#')
+			{
+				continue;
+			}
+
+			//first token
+			const char* firstTokenEnd = ccMappedTextFile::TokenEnd(p, lineEnd);
+			QByteArray firstToken = QByteArray::fromRawData(p, static_cast<int>(firstTokenEnd - p));
+			//the remaining part of the line
+			const char* rest = ccMappedTextFile::SkipBlanks(firstTokenEnd, lineEnd);
 
-				texCoords->addElement(T);
+			/*** new vertex ***/
+			if (firstToken == "v")
+			{
+				//already read
+				++pointsRead;
+			}
+			/*** new vertex texture coordinates ***/
+			else if (firstToken == "vt")
+			{
+				//already read
 				++texCoordsRead;
 			}
 			/*** new vertex normal ***/
-			else if (tokens.front() == "vn") //--> in fact it can also be a facet normal!!!
+			else if (firstToken == "vn") //--> in fact it can also be a facet normal!!!
 			{
-				//create and reserve memory for normals container if necessary
-				if (!normals)
-				{
-					normals = new NormsIndexesTableType;
-					normals->link();
-				}
-				if (normals->currentSize() == normals->capacity())
-				{
-					if (!normals->reserve(normals->capacity() + MAX_NUMBER_OF_ELEMENTS_PER_CHUNK))
-					{
-						objWarnings[NOT_ENOUGH_MEMORY] = true;
-						error = true;
-						break;
-					}
-				}
-
-				//malformed line?
-				if (tokens.size() < 4)
-				{
-					objWarnings[INVALID_LINE] = true;
-					error = true;
-					break;
-				}
-
-				CCVector3 N(static_cast<PointCoordinateType>(tokens[1].toDouble()),
-							static_cast<PointCoordinateType>(tokens[2].toDouble()),
-							static_cast<PointCoordinateType>(tokens[3].toDouble()));
-
-				if (fabs(N.norm2() - 1.0) > 0.005)
-				{
-					objWarnings[INVALID_NORMALS] = true;
-					N.normalize();
-				}
-				CompressedNormType nIndex = ccNormalVectors::GetNormIndex(N.u);
-
-				normals->addElement(nIndex); //we don't know yet if it's per-vertex or per-triangle normal...
+				//already read
 				++normsRead;
 			}
 			/*** new group ***/
-			else if (tokens.front() == "g" || tokens.front() == "o")
+			else if (firstToken == "g" || firstToken == "o")
 			{
 				//update new group index
 				facesRead = 0;
 				//get the group name
-				QString groupName = (tokens.size() > 1 && !tokens[1].isEmpty() ? tokens[1] : "default");
-				for (int i = 2; i < tokens.size(); ++i) //multiple parts?
-					groupName.append(QString(" ") + tokens[i]);
+				QString groupName = QString::fromLocal8Bit(rest, static_cast<int>(lineEnd - rest)).simplified();
+				if (groupName.isEmpty())
+					groupName = "default";
 				//push previous group descriptor (if none was pushed)
 				if (groups.empty() && totalFacesRead > 0)
 					groups.push_back(std::pair<unsigned, QString>(0, "default"));
@@ -635,54 +875,35 @@ CC_FILE_ERROR ObjFilter::loadFile(QString filename, ccHObject& container, LoadPa
 				polyCount = 0; //restart polyline count at 0!
 			}
 			/*** new face ***/
-			else if (tokens.front().startsWith('f'))
+			else if (firstToken.startsWith('f'))
 			{
-				//malformed line?
-				if (tokens.size() < 4)
-				{
-					objWarnings[INVALID_LINE] = true;
-					currentLine = stream.readLine();
-					continue;
-					//error = true;
-					//break;
-				}
-
 				//read the face elements (singleton, pair or triplet)
-				std::vector<facetElement> currentFace;
+				currentFace.clear();
+				for (const char* c = rest; c != lineEnd; c = ccMappedTextFile::SkipBlanks(c, lineEnd))
 				{
-					for (int i = 1; i < tokens.size(); ++i)
-					{
-						QStringList vertexTokens = tokens[i].split('/');
-						if (vertexTokens.size() == 0 || vertexTokens[0].isEmpty())
-						{
-							objWarnings[INVALID_LINE] = true;
-							error = true;
-							break;
-						}
-						else
-						{
-							//new vertex
-							facetElement fe; //(0,0,0) by default
-
-							fe.vIndex = vertexTokens[0].toInt();
-							if (vertexTokens.size() > 1 && !vertexTokens[1].isEmpty())
-								fe.tcIndex = vertexTokens[1].toInt();
-							if (vertexTokens.size() > 2 && !vertexTokens[2].isEmpty())
-								fe.nIndex = vertexTokens[2].toInt();
+					const char* tokenEnd = ccMappedTextFile::TokenEnd(c, lineEnd);
 
-							currentFace.push_back(fe);
-						}
+					//new vertex
+					facetElement fe; //(0,0,0) by default
+					if (!ReadObjFacetElement(c, tokenEnd, fe))
+					{
+						objWarnings[INVALID_LINE] = true;
+						error = true;
+						break;
 					}
+					currentFace.push_back(fe);
+
+					c = tokenEnd;
 				}
 
 				if (error)
 					break;
 
+				//degenerate polygon? (it is ignored, as it was by the former loader)
 				if (currentFace.size() < 3)
 				{
-					ccLog::Warning("[OBJ] Malformed file: polygon on line %1 has less than 3 vertices!",lineCount);
-					error = true;
-					break;
+					++skippedFaces;
+					continue;
 				}
 
 				//first vertex
@@ -792,7 +1013,7 @@ CC_FILE_ERROR ObjFilter::loadFile(QString filename, ccHObject& container, LoadPa
 				std::vector<facetElement>::const_iterator C = B + 1;
 				for (; C != currentFace.end(); ++B, ++C)
 				{
-					//need more space?
+					//need more space? (shouldn't happen as the triangles have been counted already)
 					if (baseMesh->size() == baseMesh->capacity())
 					{
 						if (!baseMesh->reserve(baseMesh->size()+128))
@@ -819,50 +1040,51 @@ CC_FILE_ERROR ObjFilter::loadFile(QString filename, ccHObject& container, LoadPa
 				}
 			}
 			/*** polyline ***/
-			else if (tokens.front().startsWith('l'))
+			else if (firstToken.startsWith('l'))
 			{
 				//malformed line?
-				if (tokens.size() < 3)
+				unsigned polyVertCount = CountObjElements(p, lineEnd);
+				if (polyVertCount < 2)
 				{
 					objWarnings[INVALID_LINE] = true;
-					currentLine = stream.readLine();
 					continue;
 				}
 
 				//read the face elements (singleton, pair or triplet)
 				ccPolyline* polyline = new ccPolyline(vertices);
-				if (!polyline->reserve(static_cast<unsigned>(tokens.size() - 1)))
+				if (!polyline->reserve(polyVertCount))
 				{
 					//not enough memory
 					objWarnings[NOT_ENOUGH_MEMORY] = true;
 					delete polyline;
 					polyline = 0;
-					currentLine = stream.readLine();
 					continue;
 				}
 
-				for (int i = 1; i < tokens.size(); ++i)
+				for (const char* c = rest; c != lineEnd; c = ccMappedTextFile::SkipBlanks(c, lineEnd))
 				{
+					const char* tokenEnd = ccMappedTextFile::TokenEnd(c, lineEnd);
+
 					//get next polyline's vertex index
-					QStringList vertexTokens = tokens[i].split('/');
-					if (vertexTokens.size() == 0 || vertexTokens[0].isEmpty())
+					facetElement fe;
+					if (!ReadObjFacetElement(c, tokenEnd, fe))
 					{
 						objWarnings[INVALID_LINE] = true;
 						error = true;
 						break;
 					}
-					else
-					{
-						int index = vertexTokens[0].toInt(); //we ignore normal index (if any!)
-						if (!UpdatePointIndex(index, pointsRead))
-						{
-							objWarnings[INVALID_INDEX] = true;
-							error = true;
-							break;
-						}
 
-						polyline->addPointIndex(index);
+					int index = fe.vIndex; //we ignore normal index (if any!)
+					if (!UpdatePointIndex(index, pointsRead))
+					{
+						objWarnings[INVALID_INDEX] = true;
+						error = true;
+						break;
 					}
+
+					polyline->addPointIndex(index);
+
+					c = tokenEnd;
 				}
 
 				if (error)
@@ -879,31 +1101,30 @@ CC_FILE_ERROR ObjFilter::loadFile(QString filename, ccHObject& container, LoadPa
 
 			}
 			/*** material ***/
-			else if (tokens.front() == "usemtl") //see 'MTL file' below
+			else if (firstToken == "usemtl") //see 'MTL file' below
 			{
 				if (materials) //otherwise we have failed to load MTL file!!!
 				{
-					QString mtlName = currentLine.mid(7).trimmed();
-					//DGM: in case there's space characters in the material name, we must read it again from the original line buffer
-					//QString mtlName = (tokens.size() > 1 && !tokens[1].isEmpty() ? tokens[1] : "");
+					//DGM: in case there's space characters in the material name, we must read the whole end of line
+					QString mtlName = QString::fromLocal8Bit(rest, static_cast<int>(lineEnd - rest)).trimmed();
 					currentMaterial = (!mtlName.isEmpty() ? materials->findMaterialByName(mtlName) : -1);
 					currentMaterialDefined = true;
 				}
 			}
 			/*** material file (MTL) ***/
-			else if (tokens.front() == "mtllib")
+			else if (firstToken == "mtllib")
 			{
+				//DGM: in case there's space characters in the filename, we must read the whole end of line
+				QString mtlFilename = QString::fromLocal8Bit(rest, static_cast<int>(lineEnd - rest)).trimmed();
+
 				//malformed line?
-				if (tokens.size() < 2 || tokens[1].isEmpty())
+				if (mtlFilename.isEmpty())
 				{
 					objWarnings[INVALID_LINE] = true;
 				}
 				else
 				{
 					//we build the whole MTL filename + path
-					//DGM: in case there's space characters in the filename, we must read it again from the original line buffer
-					//QString mtlFilename = tokens[1];
-					QString mtlFilename = currentLine.mid(7).trimmed();
 					ccLog::Print(QString("[OBJ] Material file: ") + mtlFilename);
 					QString mtlPath = QFileInfo(filename).canonicalPath();
 					//we try to load it
@@ -940,15 +1161,10 @@ CC_FILE_ERROR ObjFilter::loadFile(QString filename, ccHObject& container, LoadPa
 				}
 			}
 			///*** shading group ***/
-			//else if (tokens.front() == "s")
+			//else if (firstToken == "s")
 			//{
 			//	//ignored!
 			//}
-
-			if (error)
-				break;
-
-			currentLine = stream.readLine();
 		}
 	}
 	catch (const std::bad_alloc&)
@@ -958,7 +1174,6 @@ CC_FILE_ERROR ObjFilter::loadFile(QString filename, ccHObject& container, LoadPa
 		error = true;
 	}
 
-	file.close();
 
 	//1st check
 	if (!error && pointsRead == 0)
@@ -1159,7 +1374,10 @@ CC_FILE_ERROR ObjFilter::loadFile(QString filename, ccHObject& container, LoadPa
 		materials = 0;
 	}
 
-	pDlg.close();
+	if (pDlg)
+	{
+		pDlg->close();
+	}
 
 	//potential warnings
 	if (objWarnings[INVALID_NORMALS])
@@ -1170,6 +1388,10 @@ CC_FILE_ERROR ObjFilter::loadFile(QString filename, ccHObject& container, LoadPa
 		ccLog::Warning("[OBJ] Not enough memory!");
 	if (objWarnings[INVALID_LINE])
 		ccLog::Warning("[OBJ] File is malformed! Missing data.");
+	if (objWarnings[INVALID_VALUE])
+		ccLog::Warning("[OBJ] File is malformed! Invalid or missing vertex, normal or texture coordinate value.");
+	if (skippedFaces != 0)
+		ccLog::Warning(QString("[OBJ] %1 polygon(s) with less than 3 vertices were ignored").arg(skippedFaces));
 
 	if (error)
 	{
@@ -0,0 +1,656 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#include "OocFilter.h"
+
+//local
+#include "ccPointStream.h"
+
+//qCC_db
+#include <ccLog.h>
+#include <ccOutOfCoreCloud.h>
+#include <ccPointCloud.h>
+
+//Qt
+#include <QFile>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QTemporaryDir>
+
+//System
+#include <assert.h>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <vector>
+
+typedef ccOutOfCoreCloud::FilePoint FilePoint;
+
+//! Max number of points sorted in memory at once (i.e. per run - 8M points = 192 Mb)
+static const size_t s_runSize = (1 << 23);
+//! Max number of runs merged at once
+static const size_t s_mergeFanIn = 32;
+//! Number of records read or written at once (per file)
+static const size_t s_ioBufferSize = (1 << 16);
+//! Deepest level of the hierarchy (its nodes take all the remaining points)
+static const unsigned s_maxLevel = 15;
+//! Number of (sub-)levels of the grid used to select the points of a node (i.e. 64^3 cells)
+static const unsigned s_gridLevels = 6;
+
+static_assert(s_maxLevel + s_gridLevels <= ccOutOfCoreCloud::MAX_CODE_LEVEL, "Not enough bits in the cell codes");
+
+//! Point with its (Morton) cell code at the deepest level
+struct SortRecord
+{
+	quint64 code;
+	FilePoint point;
+};
+
+//! Spreads the 21 lowest bits of a value (2 zero bits between each bit)
+static inline quint64 SplitBy3(quint32 a)
+{
+	quint64 x = a & 0x1fffff;
+	x = (x | x << 32) & 0x1f00000000ffff;
+	x = (x | x << 16) & 0x1f0000ff0000ff;
+	x = (x | x << 8) & 0x100f00f00f00f00f;
+	x = (x | x << 4) & 0x10c30c30c30c30c3;
+	x = (x | x << 2) & 0x1249249249249249;
+	return x;
+}
+
+//! Buffered reader of a (temporary) file of records
+template <typename T> class RecordReader
+{
+public:
+
+	RecordReader() : m_pos(0) {}
+
+	bool open(const QString& filename)
+	{
+		m_file.setFileName(filename);
+		return m_file.open(QFile::ReadOnly);
+	}
+
+	//! Returns the next record (or 0 at the end of the file)
+	/** The record remains valid until the next call.
+	**/
+	const T* next()
+	{
+		if (m_pos == m_buffer.size())
+		{
+			m_buffer.resize(s_ioBufferSize);
+			qint64 byteCount = m_file.read(reinterpret_cast<char*>(m_buffer.data()), static_cast<qint64>(s_ioBufferSize * sizeof(T)));
+			m_buffer.resize(byteCount > 0 ? static_cast<size_t>(byteCount) / sizeof(T) : 0);
+			m_pos = 0;
+			if (m_buffer.empty())
+			{
+				return 0;
+			}
+		}
+		return &m_buffer[m_pos++];
+	}
+
+	bool failed() const { return m_file.error() != QFile::NoError; }
+
+protected:
+
+	QFile m_file;
+	std::vector<T> m_buffer;
+	size_t m_pos;
+};
+
+//! Buffered writer of a (temporary) file of records
+template <typename T> class RecordWriter
+{
+public:
+
+	bool open(const QString& filename)
+	{
+		m_file.setFileName(filename);
+		if (!m_file.open(QFile::WriteOnly | QFile::Truncate))
+			return false;
+		m_buffer.reserve(s_ioBufferSize);
+		return true;
+	}
+
+	bool write(const T& record)
+	{
+		m_buffer.push_back(record);
+		return (m_buffer.size() < s_ioBufferSize || flush());
+	}
+
+	bool close()
+	{
+		bool ok = flush();
+		m_file.close();
+		return ok;
+	}
+
+protected:
+
+	bool flush()
+	{
+		if (m_buffer.empty())
+			return true;
+		qint64 byteCount = static_cast<qint64>(m_buffer.size() * sizeof(T));
+		bool ok = (m_file.write(reinterpret_cast<const char*>(m_buffer.data()), byteCount) == byteCount);
+		m_buffer.clear();
+		return ok;
+	}
+
+	QFile m_file;
+	std::vector<T> m_buffer;
+};
+
+//! Out-of-core cloud stream writer
+/** The points are first written 'as is' in a temporary file. Once all the blocks
+	have been received, they are sorted by cell code (external merge sort) and
+	distributed in the nodes of the hierarchy during a single pass on the sorted
+	points: each node takes the first point falling in each cell of its grid,
+	the remaining points go to its children (Potree-like 'additive' LOD).
+**/
+class OocStreamWriter : public ccPointStreamWriter
+{
+public:
+
+	OocStreamWriter()
+		: m_layoutDefined(false)
+		, m_runIndex(0)
+		, m_depth(0)
+	{}
+
+	bool open(const QString& filename)
+	{
+		m_outFile.setFileName(filename);
+		if (!m_outFile.open(QFile::WriteOnly | QFile::Truncate))
+			return false;
+
+		//the temporary files are created next to the output file (the system temporary folder may be too small)
+		m_tempDir.reset(new QTemporaryDir(QFileInfo(filename).absolutePath() + "/ooc_XXXXXX"));
+		if (!m_tempDir->isValid())
+			return false;
+
+		return m_rawPoints.open(m_tempDir->path() + "/points.raw");
+	}
+
+	virtual CC_FILE_ERROR write(const ccPointCloud* block) override
+	{
+		unsigned count = block->size();
+		if (count == 0)
+			return CC_FERR_NO_ERROR;
+
+		//the first (non empty) block defines the output layout
+		if (!m_layoutDefined)
+		{
+			if (block->hasColors())
+			{
+				m_header.flags |= ccOutOfCoreCloud::HAS_COLORS;
+			}
+			m_header.globalShift = block->getGlobalShift();
+			m_header.globalScale = block->getGlobalScale();
+			m_header.bbMin = m_header.bbMax = CCVector3d::fromArray(block->getPoint(0)->u);
+			m_layoutDefined = true;
+
+			if (block->hasNormals() || block->hasScalarFields())
+			{
+				ccLog::Warning("[OOC] Only the coordinates and the colors of the points are stored");
+			}
+		}
+
+		//all the points are expressed in the coordinate system of the first block
+		const CCVector3d& shift = block->getGlobalShift();
+		bool sameShift = (		shift.x == m_header.globalShift.x
+							&&	shift.y == m_header.globalShift.y
+							&&	shift.z == m_header.globalShift.z
+							&&	block->getGlobalScale() == m_header.globalScale);
+
+		bool writeColors = (m_header.flags & ccOutOfCoreCloud::HAS_COLORS) && block->hasColors();
+
+		for (unsigned i = 0; i < count; ++i)
+		{
+			const CCVector3* P = block->getPoint(i);
+			CCVector3d Plocal = CCVector3d::fromArray(P->u);
+			if (!sameShift)
+			{
+				Plocal = (block->toGlobal3d<PointCoordinateType>(*P) + m_header.globalShift) * m_header.globalScale;
+			}
+
+			FilePoint point;
+			point.x = static_cast<float>(Plocal.x);
+			point.y = static_cast<float>(Plocal.y);
+			point.z = static_cast<float>(Plocal.z);
+			if (writeColors)
+			{
+				const ColorCompType* col = block->getPointColor(i);
+				point.rgba[0] = col[0];
+				point.rgba[1] = col[1];
+				point.rgba[2] = col[2];
+			}
+			else
+			{
+				point.rgba[0] = point.rgba[1] = point.rgba[2] = 255;
+			}
+			point.rgba[3] = 255;
+
+			//bounding-box (of the stored - float - coordinates)
+			m_header.bbMin.x = std::min<double>(m_header.bbMin.x, point.x);
+			m_header.bbMin.y = std::min<double>(m_header.bbMin.y, point.y);
+			m_header.bbMin.z = std::min<double>(m_header.bbMin.z, point.z);
+			m_header.bbMax.x = std::max<double>(m_header.bbMax.x, point.x);
+			m_header.bbMax.y = std::max<double>(m_header.bbMax.y, point.y);
+			m_header.bbMax.z = std::max<double>(m_header.bbMax.z, point.z);
+
+			if (!m_rawPoints.write(point))
+			{
+				return CC_FERR_WRITING;
+			}
+		}
+
+		m_header.pointCount += count;
+
+		return CC_FERR_NO_ERROR;
+	}
+
+	virtual CC_FILE_ERROR finish() override
+	{
+		if (!m_rawPoints.close())
+			return CC_FERR_WRITING;
+
+		if (m_header.pointCount == 0)
+			return CC_FERR_NO_SAVE;
+
+		//root cell
+		CCVector3d diag = m_header.bbMax - m_header.bbMin;
+		double maxDim = std::max(diag.x, std::max(diag.y, diag.z));
+		m_header.cubeOrigin = m_header.bbMin;
+		m_header.cubeSize = (maxDim > 0 ? maxDim : 1.0);
+		m_header.maxLevel = s_maxLevel;
+		m_header.gridResolution = (1 << s_gridLevels);
+
+		try
+		{
+			//sorted runs
+			ccLog::Print(QString("[OOC] Sorting %1 points").arg(m_header.pointCount));
+			std::vector<QString> runs;
+			CC_FILE_ERROR error = createSortedRuns(runs);
+			if (error != CC_FERR_NO_ERROR)
+				return error;
+
+			//merge the runs until they can be merged at once
+			while (runs.size() > s_mergeFanIn)
+			{
+				ccLog::Print(QString("[OOC] Merging %1 sorted runs").arg(runs.size()));
+				std::vector<QString> mergedRuns;
+				for (size_t i = 0; i < runs.size(); i += s_mergeFanIn)
+				{
+					std::vector<QString> group(runs.begin() + i, runs.begin() + std::min(runs.size(), i + s_mergeFanIn));
+					QString mergedRun = nextRunFilename();
+					RecordWriter<SortRecord> writer;
+					if (	!writer.open(mergedRun)
+						||	!mergeRuns(group, [&](const SortRecord& record) { return writer.write(record); })
+						||	!writer.close())
+					{
+						return CC_FERR_WRITING;
+					}
+					for (const QString& run : group)
+					{
+						QFile::remove(run);
+					}
+					mergedRuns.push_back(mergedRun);
+				}
+				runs.swap(mergedRuns);
+			}
+
+			//the hierarchy is built during the last merge
+			ccLog::Print("[OOC] Building the hierarchy");
+			if (!m_header.toFile(m_outFile))
+				return CC_FERR_WRITING;
+
+			m_stack.resize(s_maxLevel + 1);
+			m_grids.resize(s_maxLevel);
+			for (std::vector<quint64>& grid : m_grids)
+			{
+				grid.resize((static_cast<size_t>(1) << (3 * s_gridLevels)) / 64);
+			}
+
+			if (!mergeRuns(runs, [&](const SortRecord& record) { return addToHierarchy(record); }))
+				return CC_FERR_WRITING;
+			while (m_depth != 0)
+			{
+				if (!closeNode())
+					return CC_FERR_WRITING;
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			return CC_FERR_NOT_ENOUGH_MEMORY;
+		}
+
+		//node table
+		m_header.nodeCount = static_cast<quint32>(m_nodes.size());
+		m_header.hierarchyOffset = static_cast<quint64>(m_outFile.pos());
+		for (const ccOutOfCoreCloud::FileNode& node : m_nodes)
+		{
+			if (!node.toFile(m_outFile))
+				return CC_FERR_WRITING;
+		}
+
+		//update the header
+		if (!m_outFile.seek(0) || !m_header.toFile(m_outFile))
+			return CC_FERR_WRITING;
+		m_outFile.close();
+
+		ccLog::Print(QString("[OOC] %1 points stored in %2 nodes").arg(m_header.pointCount).arg(m_header.nodeCount));
+
+		return CC_FERR_NO_ERROR;
+	}
+
+protected:
+
+	//! Returns the name of a new temporary run file
+	QString nextRunFilename()
+	{
+		return m_tempDir->path() + QString("/run_%1.tmp").arg(m_runIndex++);
+	}
+
+	//! Computes the code of a point (at the deepest level)
+	quint64 cellCode(const FilePoint& P) const
+	{
+		static const double maxCellIndex = static_cast<double>((1 << ccOutOfCoreCloud::MAX_CODE_LEVEL) - 1);
+		const double scale = (1 << ccOutOfCoreCloud::MAX_CODE_LEVEL) / m_header.cubeSize;
+
+		quint32 cellPos[3];
+		const float* u = &P.x;
+		for (unsigned d = 0; d < 3; ++d)
+		{
+			double pos = (u[d] - m_header.cubeOrigin.u[d]) * scale;
+			cellPos[d] = static_cast<quint32>(std::max(0.0, std::min(pos, maxCellIndex)));
+		}
+
+		return SplitBy3(cellPos[0]) | (SplitBy3(cellPos[1]) << 1) | (SplitBy3(cellPos[2]) << 2);
+	}
+
+	//! Sorts the points by blocks (runs)
+	CC_FILE_ERROR createSortedRuns(std::vector<QString>& runs)
+	{
+		QString rawFilename = m_tempDir->path() + "/points.raw";
+		RecordReader<FilePoint> reader;
+		if (!reader.open(rawFilename))
+			return CC_FERR_READING;
+
+		std::vector<SortRecord> run;
+		run.reserve(static_cast<size_t>(std::min<quint64>(s_runSize, m_header.pointCount)));
+
+		while (true)
+		{
+			const FilePoint* P = reader.next();
+			if (P)
+			{
+				SortRecord record;
+				record.code = cellCode(*P);
+				record.point = *P;
+				run.push_back(record);
+			}
+
+			if (run.size() == s_runSize || (!P && !run.empty()))
+			{
+				std::sort(run.begin(), run.end(), [](const SortRecord& a, const SortRecord& b) { return a.code < b.code; });
+
+				QString runFilename = nextRunFilename();
+				RecordWriter<SortRecord> writer;
+				if (!writer.open(runFilename))
+					return CC_FERR_WRITING;
+				for (const SortRecord& record : run)
+				{
+					if (!writer.write(record))
+						return CC_FERR_WRITING;
+				}
+				if (!writer.close())
+					return CC_FERR_WRITING;
+
+				runs.push_back(runFilename);
+				run.clear();
+			}
+
+			if (!P)
+				break;
+		}
+
+		if (reader.failed())
+			return CC_FERR_READING;
+
+		//we don't need the raw points anymore
+		QFile::remove(rawFilename);
+
+		return CC_FERR_NO_ERROR;
+	}
+
+	//! Merges sorted runs
+	bool mergeRuns(const std::vector<QString>& runs, std::function<bool(const SortRecord&)> output)
+	{
+		std::vector< QSharedPointer< RecordReader<SortRecord> > > readers;
+		std::vector<const SortRecord*> heads;
+
+		//min-heap of the current record of each run
+		typedef std::pair<quint64, size_t> HeapItem;
+		std::priority_queue< HeapItem, std::vector<HeapItem>, std::greater<HeapItem> > heap;
+
+		for (const QString& run : runs)
+		{
+			QSharedPointer< RecordReader<SortRecord> > reader(new RecordReader<SortRecord>);
+			if (!reader->open(run))
+				return false;
+
+			const SortRecord* head = reader->next();
+			if (head)
+			{
+				heap.push(HeapItem(head->code, readers.size()));
+			}
+			readers.push_back(reader);
+			heads.push_back(head);
+		}
+
+		while (!heap.empty())
+		{
+			size_t runIndex = heap.top().second;
+			heap.pop();
+
+			if (!output(*heads[runIndex]))
+				return false;
+
+			heads[runIndex] = readers[runIndex]->next();
+			if (heads[runIndex])
+			{
+				heap.push(HeapItem(heads[runIndex]->code, runIndex));
+			}
+		}
+
+		for (const QSharedPointer< RecordReader<SortRecord> >& reader : readers)
+		{
+			if (reader->failed())
+				return false;
+		}
+
+		return true;
+	}
+
+	//! Adds a point to the hierarchy (points must be sorted by code)
+	bool addToHierarchy(const SortRecord& record)
+	{
+		//the nodes that don't contain the point are complete
+		unsigned depth = 0;
+		while (depth < m_depth && m_stack[depth].code == (record.code >> (3 * (ccOutOfCoreCloud::MAX_CODE_LEVEL - depth))))
+		{
+			++depth;
+		}
+		while (m_depth > depth)
+		{
+			if (!closeNode())
+				return false;
+		}
+
+		//the point goes to the first node with a free cell
+		for (unsigned level = 0; ; ++level)
+		{
+			if (level == m_depth)
+			{
+				openNode(record.code >> (3 * (ccOutOfCoreCloud::MAX_CODE_LEVEL - level)));
+			}
+
+			ActiveNode& node = m_stack[level];
+			if (level == s_maxLevel)
+			{
+				node.points.push_back(record.point);
+				break;
+			}
+
+			quint64 cellIndex = (record.code >> (3 * (ccOutOfCoreCloud::MAX_CODE_LEVEL - level - s_gridLevels))) & ((1 << (3 * s_gridLevels)) - 1);
+			quint64& word = m_grids[level][cellIndex >> 6];
+			quint64 bit = (static_cast<quint64>(1) << (cellIndex & 63));
+			if ((word & bit) == 0)
+			{
+				word |= bit;
+				node.points.push_back(record.point);
+				break;
+			}
+		}
+
+		return true;
+	}
+
+	//! Opens a new node (at the next level)
+	void openNode(quint64 code)
+	{
+		unsigned level = m_depth;
+		assert(level <= s_maxLevel);
+
+		ActiveNode& node = m_stack[level];
+		node.code = code;
+		node.points.clear();
+		std::fill(node.children, node.children + 8, -1);
+		if (level < s_maxLevel)
+		{
+			std::fill(m_grids[level].begin(), m_grids[level].end(), 0);
+		}
+
+		++m_depth;
+	}
+
+	//! Writes the deepest opened node
+	bool closeNode()
+	{
+		assert(m_depth != 0);
+		unsigned level = m_depth - 1;
+		ActiveNode& node = m_stack[level];
+
+		ccOutOfCoreCloud::FileNode desc;
+		desc.dataOffset = static_cast<quint64>(m_outFile.pos());
+		desc.code = node.code;
+		desc.pointCount = static_cast<quint32>(node.points.size());
+		desc.level = static_cast<quint8>(level);
+		std::copy(node.children, node.children + 8, desc.children);
+
+		qint64 byteCount = static_cast<qint64>(node.points.size() * sizeof(FilePoint));
+		if (m_outFile.write(reinterpret_cast<const char*>(node.points.data()), byteCount) != byteCount)
+			return false;
+
+		qint32 nodeIndex = static_cast<qint32>(m_nodes.size());
+		m_nodes.push_back(desc);
+
+		--m_depth;
+		if (m_depth != 0)
+		{
+			m_stack[m_depth - 1].children[node.code & 7] = nodeIndex;
+		}
+
+		return true;
+	}
+
+	//! Node being filled
+	struct ActiveNode
+	{
+		quint64 code;
+		std::vector<FilePoint> points;
+		qint32 children[8];
+	};
+
+	//! Output file
+	QFile m_outFile;
+	//! Output header
+	ccOutOfCoreCloud::Header m_header;
+	//! Whether the layout has been defined (by the first non empty block)
+	bool m_layoutDefined;
+
+	//! Temporary directory
+	QScopedPointer<QTemporaryDir> m_tempDir;
+	//! Raw (unsorted) points
+	RecordWriter<FilePoint> m_rawPoints;
+	//! Index of the next run file
+	unsigned m_runIndex;
+
+	//! Nodes being filled (one per level, from the root)
+	std::vector<ActiveNode> m_stack;
+	//! Number of nodes being filled
+	unsigned m_depth;
+	//! Occupancy grids of the nodes being filled
+	std::vector< std::vector<quint64> > m_grids;
+	//! Written nodes
+	std::vector<ccOutOfCoreCloud::FileNode> m_nodes;
+};
+
+bool OocFilter::canLoadExtension(QString upperCaseExt) const
+{
+	return (upperCaseExt == "OOC");
+}
+
+bool OocFilter::canSave(CC_CLASS_ENUM type, bool& multiple, bool& exclusive) const
+{
+	//out-of-core files can only be created by streaming (see openStreamWriter)
+	return false;
+}
+
+CC_FILE_ERROR OocFilter::loadFile(QString filename, ccHObject& container, LoadParameters& parameters)
+{
+	if (!QFile::exists(filename))
+		return CC_FERR_READING;
+
+	ccOutOfCoreCloud* cloud = new ccOutOfCoreCloud(QFileInfo(filename).baseName());
+	if (!cloud->open(filename))
+	{
+		delete cloud;
+		return CC_FERR_MALFORMED_FILE;
+	}
+
+	container.addChild(cloud);
+
+	return CC_FERR_NO_ERROR;
+}
+
+ccPointStreamWriter* OocFilter::openStreamWriter(const QString& filename, CC_FILE_ERROR& result)
+{
+	OocStreamWriter* writer = new OocStreamWriter();
+	if (!writer->open(filename))
+	{
+		delete writer;
+		result = CC_FERR_WRITING;
+		return 0;
+	}
+
+	result = CC_FERR_NO_ERROR;
+	return writer;
+}
@@ -0,0 +1,48 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_OOC_FILTER_HEADER
+#define CC_OOC_FILTER_HEADER
+
+#include "FileIOFilter.h"
+
+//! Out-of-core (hierarchical) point cloud I/O filter
+/** Such files can only be created by streaming another file (e.g. with
+	the -STREAM command line option): the points are sorted on disk (so
+	that the input cloud doesn't have to fit in memory) and distributed in
+	the nodes of an octree. See ccOutOfCoreCloud.
+**/
+class QCC_IO_LIB_API OocFilter : public FileIOFilter
+{
+public:
+
+	//static accessors
+	static inline QString GetFileFilter() { return "Out-of-core cloud (*.ooc)"; }
+	static inline QString GetDefaultExtension() { return QString("ooc"); }
+
+	//inherited from FileIOFilter
+	virtual bool importSupported() const override { return true; }
+	virtual bool backgroundImportSupported() const override { return true; }
+	virtual CC_FILE_ERROR loadFile(QString filename, ccHObject& container, LoadParameters& parameters) override;
+	virtual QStringList getFileFilters(bool onImport) const override { return QStringList(GetFileFilter()); }
+	virtual QString getDefaultExtension() const override { return GetDefaultExtension(); }
+	virtual bool canLoadExtension(QString upperCaseExt) const override;
+	virtual bool canSave(CC_CLASS_ENUM type, bool& multiple, bool& exclusive) const override;
+	virtual ccPointStreamWriter* openStreamWriter(const QString& filename, CC_FILE_ERROR& result) override;
+};
+
+#endif //CC_OOC_FILTER_HEADER
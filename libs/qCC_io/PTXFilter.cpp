@@ -17,6 +17,9 @@
 
 #include "PTXFilter.h"
 
+//local
+#include "ccMappedTextFile.h"
+
 //qCC_db
 #include <ccLog.h>
 #include <ccPointCloud.h>
@@ -28,12 +31,14 @@
 
 //Qt
 #include <QFile>
+#include <QScopedPointer>
 #include <QTextStream>
 #include <QMessageBox>
 
 //System
 #include <assert.h>
 #include <string.h>
+#include <algorithm>
 
 const char CC_PTX_INTENSITY_FIELD_NAME[] = "Intensity";
 
@@ -88,18 +93,128 @@ void CleanMatrix(ccGLMatrixd& mat)
 	}
 }
 
+//! Reads a line made of 'count' numbers
+static bool ReadPTXValues(const char*& p, const char* end, double* values, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		if (!ccMappedTextFile::ParseDouble(p, end, values[i]))
+			return false;
+	}
+	if (!ccMappedTextFile::IsLineEnd(p, end))
+		return false;
+
+	p = ccMappedTextFile::NextLine(p, end);
+	return true;
+}
+
+//! Minimum number of grid cells per chunk
+static const size_t PTX_MIN_CELLS_PER_CHUNK = 4096;
+
+//! Chunk of a PTX scan grid (parsed in parallel)
+struct PTXChunk
+{
+	ccMappedTextFile::Chunk range;
+	//! index of the first cell of the chunk
+	size_t firstCell;
+	//! number of cells (lines) in the chunk
+	size_t cellCount;
+	//! whether the chunk has been processed
+	bool processed;
+	//! whether the chunk is malformed
+	bool error;
+
+	//shared parameters
+	bool hasColors;
+	CCVector3d Pshift;
+	ccPointCloud* cloud;
+	ccScalarField* intensitySF;
+	ccPointCloud::Grid* gridColors;
+	std::vector<unsigned char>* validCells;
+};
+
+//! Reads the cells of a chunk (valid points are stored at the cell position)
+static void ReadPTXCells(PTXChunk& chunk)
+{
+	chunk.error = false;
+
+	ColorsTableType* colors = chunk.hasColors ? chunk.cloud->rgbColors() : 0;
+
+	const char* end = chunk.range.end;
+	const char* p = chunk.range.begin;
+	for (size_t k = 0; k < chunk.cellCount; ++k)
+	{
+		size_t gridIndex = chunk.firstCell + k;
+
+		double values[4];
+		for (int v = 0; v < 4; ++v)
+		{
+			if (!ccMappedTextFile::ParseDouble(p, end, values[v]))
+			{
+				chunk.error = true;
+				return;
+			}
+		}
+
+		ccColor::Rgb color;
+		if (chunk.hasColors)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				unsigned temp = 0;
+				if (!ccMappedTextFile::ParseUInt(p, end, temp) || !ccMappedTextFile::IsTokenEnd(p, end) || temp > 255)
+				{
+					chunk.error = true;
+					return;
+				}
+				color.rgb[c] = static_cast<unsigned char>(temp);
+			}
+		}
+
+		if (!ccMappedTextFile::IsLineEnd(p, end))
+		{
+			chunk.error = true;
+			return;
+		}
+		p = ccMappedTextFile::NextLine(p, end);
+
+		//we skip "empty" cells
+		bool pointIsValid = (CCVector3d::fromArray(values).norm2() != 0);
+		if (pointIsValid)
+		{
+			unsigned pointIndex = static_cast<unsigned>(gridIndex);
+			*const_cast<CCVector3*>(chunk.cloud->getPointPersistentPtr(pointIndex)) = CCVector3(	static_cast<PointCoordinateType>(values[0] + chunk.Pshift.x),
+																									static_cast<PointCoordinateType>(values[1] + chunk.Pshift.y),
+																									static_cast<PointCoordinateType>(values[2] + chunk.Pshift.z));
+			if (chunk.intensitySF)
+				chunk.intensitySF->setValue(pointIndex, static_cast<ScalarType>(values[3]));
+			if (colors)
+				colors->setValue(pointIndex, color.rgb);
+			(*chunk.validCells)[gridIndex] = 1;
+		}
+
+		//we also load the colors into the grid (as invalid/missing points can have colors!)
+		if (chunk.gridColors)
+		{
+			chunk.gridColors->colors[gridIndex] = color;
+		}
+	}
+
+	chunk.processed = true;
+}
+
 CC_FILE_ERROR PTXFilter::loadFile(	QString filename,
 									ccHObject& container,
 									LoadParameters& parameters)
 {
-	//open ASCII file for reading
-	QFile file(filename);
-	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	//map the ASCII file in memory
+	ccMappedTextFile file;
+	if (!file.open(filename))
 	{
 		return CC_FERR_READING;
 	}
-
-	QTextStream inFile(&file);
+	const char* p = file.begin();
+	const char* end = file.end();
 
 	CCVector3d PshiftTrans(0,0,0);
 	CCVector3d PshiftCloud(0,0,0);
@@ -109,18 +224,18 @@ CC_FILE_ERROR PTXFilter::loadFile(	QString filename,
 	ScalarType maxIntensity = 0;
 
 	//progress dialog
-	ccProgressDialog pdlg(true, parameters.parentWidget);
+	QScopedPointer<ccProgressDialog> pdlg(parameters.parentWidget ? new ccProgressDialog(true, parameters.parentWidget) : 0);
 	if (parameters.parentWidget)
 	{
-		pdlg.setMethodTitle(QObject::tr("Loading PTX file"));
-		pdlg.setAutoClose(false);
+		pdlg->setMethodTitle(QObject::tr("Loading PTX file"));
+		pdlg->setAutoClose(false);
 	}
 
 	//progress dialog (for normals computation)
-	ccProgressDialog normalsProgressDlg(true, parameters.parentWidget);
+	QScopedPointer<ccProgressDialog> normalsProgressDlg(parameters.parentWidget ? new ccProgressDialog(true, parameters.parentWidget) : 0);
 	if (parameters.parentWidget)
 	{
-		normalsProgressDlg.setAutoClose(false);
+		normalsProgressDlg->setAutoClose(false);
 	}
 
 	for (unsigned cloudIndex = 0; result == CC_FERR_NO_ERROR || result == CC_FERR_NO_LOAD; cloudIndex++)
@@ -130,29 +245,29 @@ CC_FILE_ERROR PTXFilter::loadFile(	QString filename,
 
 		//read header
 		{
-			QString line = inFile.readLine();
-			if (line.isNull() && container.getChildrenNumber() != 0) //end of file?
+			//end of file?
+			const char* next = p;
+			while (next != end && ccMappedTextFile::IsLineEnd(next, end))
+				next = ccMappedTextFile::NextLine(next, end);
+			if (next == end && container.getChildrenNumber() != 0)
 				break;
 
 			//read the width (number of columns) and the height (number of rows) on the two first lines
 			//(DGM: we transpose the matrix right away)
-			bool ok;
-			height = line.toUInt(&ok);
-			if (!ok)
+			if (!ccMappedTextFile::ParseUInt(p, end, height) || !ccMappedTextFile::IsLineEnd(p, end))
 				return CC_FERR_MALFORMED_FILE;
-			line = inFile.readLine();
-			width = line.toUInt(&ok);
-			if (!ok)
+			p = ccMappedTextFile::NextLine(p, end);
+			if (!ccMappedTextFile::ParseUInt(p, end, width) || !ccMappedTextFile::IsLineEnd(p, end))
 				return CC_FERR_MALFORMED_FILE;
+			p = ccMappedTextFile::NextLine(p, end);
 
 			ccLog::Print(QString("[PTX] Scan #%1 - grid size: %2 x %3").arg(cloudIndex+1).arg(height).arg(width));
 
 			//read sensor transformation matrix
 			for (int i=0; i<4; ++i)
 			{
-				line = inFile.readLine();
-				QStringList tokens = line.split(" ",QString::SkipEmptyParts);
-				if (tokens.size() != 3)
+				double values[3];
+				if (!ReadPTXValues(p, end, values, 3))
 					return CC_FERR_MALFORMED_FILE;
 
 				double* colDest = 0;
@@ -170,9 +285,7 @@ CC_FILE_ERROR PTXFilter::loadFile(	QString filename,
 				for (int j=0; j<3; ++j)
 				{
 					assert(colDest);
-					colDest[j] = tokens[j].toDouble(&ok);
-					if (!ok)
-						return CC_FERR_MALFORMED_FILE;
+					colDest[j] = values[j];
 				}
 			}
 			//make the transform a little bit cleaner (necessary as it's read from ASCII!)
@@ -181,18 +294,8 @@ CC_FILE_ERROR PTXFilter::loadFile(	QString filename,
 			//read cloud transformation matrix
 			for (int i=0; i<4; ++i)
 			{
-				line = inFile.readLine();
-				QStringList tokens = line.split(" ",QString::SkipEmptyParts);
-				if (tokens.size() != 4)
+				if (!ReadPTXValues(p, end, cloudTransD.getColumn(i), 4))
 					return CC_FERR_MALFORMED_FILE;
-
-				double* col = cloudTransD.getColumn(i);
-				for (int j=0; j<4; ++j)
-				{
-					col[j] = tokens[j].toDouble(&ok);
-					if (!ok)
-						return CC_FERR_MALFORMED_FILE;
-				}
 			}
 			//make the transform a little bit cleaner (necessary as it's read from ASCII!)
 			CleanMatrix(cloudTransD);
@@ -225,8 +328,44 @@ CC_FILE_ERROR PTXFilter::loadFile(	QString filename,
 			cloud->setName(QString("unnamed - Cloud %1").arg(container.getChildrenNumber()+1));
 		}
 
+		//split the grid lines in chunks (one line per cell)
 		unsigned gridSize = width * height;
-		if (!cloud->reserve(gridSize))
+		std::vector<PTXChunk> chunks;
+		{
+			size_t cellsPerChunk = std::max(PTX_MIN_CELLS_PER_CHUNK, static_cast<size_t>(gridSize) / (static_cast<size_t>(std::max(1, QThread::idealThreadCount())) * 8));
+			PTXChunk chunk;
+			chunk.firstCell = 0;
+			chunk.cellCount = 0;
+			chunk.processed = false;
+			chunk.error = false;
+			chunk.range.begin = p;
+			for (size_t gridIndex = 0; gridIndex < gridSize; ++gridIndex)
+			{
+				if (p == end)
+				{
+					//the file is truncated (the error will be detected when parsing the chunk)
+					break;
+				}
+				p = ccMappedTextFile::NextLine(p, end);
+				if (++chunk.cellCount == cellsPerChunk)
+				{
+					chunk.range.end = p;
+					chunks.push_back(chunk);
+					chunk.firstCell += chunk.cellCount;
+					chunk.cellCount = 0;
+					chunk.range.begin = p;
+				}
+			}
+			chunk.range.end = p;
+			if (chunk.firstCell < gridSize)
+			{
+				//the last chunk contains all the remaining cells
+				chunk.cellCount = gridSize - chunk.firstCell;
+				chunks.push_back(chunk);
+			}
+		}
+
+		if (!cloud->resize(gridSize))
 		{
 			result = CC_FERR_NOT_ENOUGH_MEMORY;
 			delete cloud;
@@ -239,7 +378,7 @@ CC_FILE_ERROR PTXFilter::loadFile(	QString filename,
 
 		//intensities
 		ccScalarField* intensitySF = new ccScalarField(CC_PTX_INTENSITY_FIELD_NAME);
-		if (!intensitySF->reserve(static_cast<unsigned>(gridSize)))
+		if (!intensitySF->resize(static_cast<unsigned>(gridSize)))
 		{
 			ccLog::Warning("[PTX] Not enough memory to load intensities!");
 			intensitySF->release();
@@ -261,153 +400,153 @@ CC_FILE_ERROR PTXFilter::loadFile(	QString filename,
 			hasIndexGrid = false;
 		}
 
+		//valid cells
+		std::vector<unsigned char> validCells;
+		try
+		{
+			validCells.resize(gridSize, 0);
+		}
+		catch (const std::bad_alloc&)
+		{
+			result = CC_FERR_NOT_ENOUGH_MEMORY;
+			if (intensitySF)
+				intensitySF->release();
+			delete cloud;
+			cloud = 0;
+			break;
+		}
+
 		//read points
 		{
-			CCLib::NormalizedProgress nprogress(&pdlg, gridSize);
 			if (parameters.parentWidget)
 			{
-				pdlg.setInfo(qPrintable(QString("Number of cells: %1").arg(gridSize)));
-				pdlg.start();
+				pdlg->setInfo(qPrintable(QString("Number of cells: %1").arg(gridSize)));
+				pdlg->setRange(0, 0);
+				pdlg->start();
 			}
 
-			bool firstPoint = true;
+			//the number of tokens of the first line tells us whether there are colors or not
 			bool hasColors = false;
 			bool loadColors = false;
 			bool loadGridColors = false;
-			size_t gridIndex = 0;
-
-			for (unsigned j=0; j<height; ++j)
+			if (!chunks.empty())
+			{
+				const char* c = chunks.front().range.begin;
+				int tokenCount = 0;
+				for (c = ccMappedTextFile::SkipBlanks(c, end); !ccMappedTextFile::IsLineEnd(c, end); c = ccMappedTextFile::SkipBlanks(ccMappedTextFile::TokenEnd(c, end), end))
+					++tokenCount;
+				hasColors = (tokenCount == 7);
+			}
+			if (hasColors)
 			{
-				for (unsigned i=0; i<width; ++i, ++gridIndex)
+				loadColors = cloud->resizeTheRGBTable();
+				if (!loadColors)
 				{
-					QString line = inFile.readLine();
-					QStringList tokens = line.split(" ",QString::SkipEmptyParts);
-
-					if (firstPoint)
-					{
-						hasColors = (tokens.size() == 7);
-						if (hasColors)
-						{
-							loadColors = cloud->reserveTheRGBTable();
-							if (!loadColors)
-							{
-								ccLog::Warning("[PTX] Not enough memory to load RGB colors!");
-							}
-							else if (hasIndexGrid)
-							{
-								//we also load the colors into the grid (as invalid/missing points can have colors!)
-								try
-								{
-									grid->colors.resize(gridSize, ccColor::Rgb(0, 0, 0));
-									loadGridColors = true;
-								}
-								catch (const std::bad_alloc&)
-								{
-									ccLog::Warning("[PTX] Not enough memory to load the grid colors");
-								}
-							}
-						}
-					}
-					if ((hasColors && tokens.size() != 7) || (!hasColors && tokens.size() != 4))
+					ccLog::Warning("[PTX] Not enough memory to load RGB colors!");
+				}
+				else if (hasIndexGrid)
+				{
+					//we also load the colors into the grid (as invalid/missing points can have colors!)
+					try
 					{
-						result = CC_FERR_MALFORMED_FILE;
-						//early stop
-						j = height;
-						break;
+						grid->colors.resize(gridSize, ccColor::Rgb(0, 0, 0));
+						loadGridColors = true;
 					}
-
-					double values[4];
-					for (int v=0; v<4; ++v)
+					catch (const std::bad_alloc&)
 					{
-						bool ok;
-						values[v] = tokens[v].toDouble(&ok);
-						if (!ok)
-						{
-							result = CC_FERR_MALFORMED_FILE;
-							//early stop
-							j = height;
-							break;
-						}
+						ccLog::Warning("[PTX] Not enough memory to load the grid colors");
 					}
+				}
+			}
 
-					//we skip "empty" cells
-					bool pointIsValid = (CCVector3d::fromArray(values).norm2() != 0);
-					if (pointIsValid)
+			//first (valid) point: check for 'big' coordinates
+			if (cloudIndex == 0 && !cloud->isShifted()) //in case the trans. matrix was ok!
+			{
+				for (size_t i = 0; i < chunks.size(); ++i)
+				{
+					bool found = false;
+					const char* c = chunks[i].range.begin;
+					for (size_t k = 0; k < chunks[i].cellCount && c != end; ++k, c = ccMappedTextFile::NextLine(c, end))
 					{
-						const double* Pd = values;
-						//first point: check for 'big' coordinates
-						if (firstPoint)
+						CCVector3d P;
+						const char* v = c;
+						if (	ccMappedTextFile::ParseDouble(v, end, P.x)
+							&&	ccMappedTextFile::ParseDouble(v, end, P.y)
+							&&	ccMappedTextFile::ParseDouble(v, end, P.z)
+							&&	P.norm2() != 0 )
 						{
-							if (cloudIndex == 0 && !cloud->isShifted()) //in case the trans. matrix was ok!
+							if (HandleGlobalShift(P,PshiftCloud,parameters))
 							{
-								CCVector3d P(Pd);
-								if (HandleGlobalShift(P,PshiftCloud,parameters))
-								{
-									cloud->setGlobalShift(PshiftCloud);
-									ccLog::Warning("[PTXFilter::loadFile] Cloud has been recentered! Translation: (%.2f ; %.2f ; %.2f)",PshiftCloud.x,PshiftCloud.y,PshiftCloud.z);
-								}
+								cloud->setGlobalShift(PshiftCloud);
+								ccLog::Warning("[PTXFilter::loadFile] Cloud has been recentered! Translation: (%.2f ; %.2f ; %.2f)",PshiftCloud.x,PshiftCloud.y,PshiftCloud.z);
 							}
-							firstPoint = false;
+							found = true;
+							break;
 						}
+					}
+					if (found)
+						break;
+				}
+			}
 
-						//update index grid
-						if (hasIndexGrid)
-						{
-							grid->indexes[gridIndex] = static_cast<int>(cloud->size()); // = index (default value = -1, means no point)
-						}
+			for (size_t i = 0; i < chunks.size(); ++i)
+			{
+				PTXChunk& chunk = chunks[i];
+				chunk.hasColors = hasColors;
+				chunk.Pshift = PshiftCloud;
+				chunk.cloud = cloud;
+				chunk.intensitySF = intensitySF;
+				chunk.gridColors = loadGridColors ? grid.data() : 0;
+				chunk.validCells = &validCells;
+			}
+			if (!ccMappedTextFile::ProcessInParallel(chunks, ReadPTXCells, pdlg.data()))
+			{
+				result = CC_FERR_CANCELED_BY_USER;
+			}
 
-						//add point
-						cloud->addPoint(CCVector3(	static_cast<PointCoordinateType>(Pd[0] + PshiftCloud.x),
-													static_cast<PointCoordinateType>(Pd[1] + PshiftCloud.y),
-													static_cast<PointCoordinateType>(Pd[2] + PshiftCloud.z)) );
+			//now we can remove the invalid cells (in the same order)
+			ColorsTableType* colors = loadColors ? cloud->rgbColors() : 0;
+			unsigned pointCount = 0;
+			for (size_t i = 0; i < chunks.size(); ++i)
+			{
+				const PTXChunk& chunk = chunks[i];
+				if (!chunk.processed)
+				{
+					//early stop
+					if (chunk.error)
+						result = CC_FERR_MALFORMED_FILE;
+					break;
+				}
 
-						//add intensity
-						if (intensitySF)
-						{
-							intensitySF->addElement(static_cast<ScalarType>(values[3]));
-						}
-					}
+				for (size_t gridIndex = chunk.firstCell; gridIndex < chunk.firstCell + chunk.cellCount; ++gridIndex)
+				{
+					if (!validCells[gridIndex])
+						continue;
 
-					//color
-					if (loadColors && (pointIsValid || loadGridColors))
+					unsigned cellIndex = static_cast<unsigned>(gridIndex);
+					if (pointCount != cellIndex)
 					{
-						ccColor::Rgb color;
-						for (int c=0; c<3; ++c)
-						{
-							bool ok;
-							unsigned temp = tokens[4+c].toUInt(&ok);
-							ok &= (temp <= 255);
-							if (ok)
-							{
-								color.rgb[c] = static_cast<unsigned char>(temp);
-							}
-							else
-							{
-								result = CC_FERR_MALFORMED_FILE;
-								//early stop
-								j = height;
-								break;
-							}
-						}
-
-						if (pointIsValid)
-						{
-							cloud->addRGBColor(color.rgb);
-						}
-						if (loadGridColors)
-						{
-							assert(!grid->colors.empty());
-							grid->colors[gridIndex] = color;
-						}
+						*const_cast<CCVector3*>(cloud->getPointPersistentPtr(pointCount)) = *cloud->getPointPersistentPtr(cellIndex);
+						if (intensitySF)
+							intensitySF->setValue(pointCount, intensitySF->getValue(cellIndex));
+						if (colors)
+							colors->setValue(pointCount, colors->getValue(cellIndex));
 					}
 
-					if (parameters.parentWidget && !nprogress.oneStep())
+					//update index grid
+					if (hasIndexGrid)
 					{
-						result = CC_FERR_CANCELED_BY_USER;
-						break;
+						grid->indexes[gridIndex] = static_cast<int>(pointCount); // = index (default value = -1, means no point)
 					}
+					++pointCount;
 				}
 			}
+
+			cloud->resize(pointCount);
+			if (intensitySF)
+			{
+				intensitySF->resize(pointCount);
+			}
 		}
 
 		//is there at least one valid point in this grid?
@@ -482,7 +621,7 @@ CC_FILE_ERROR PTXFilter::loadFile(	QString filename,
 				//by default we don't compute normals without asking the user
 				if (parameters.autoComputeNormals)
 				{
-					cloud->computeNormalsWithGrids(LS, 2, true, parameters.parentWidget ? &normalsProgressDlg : 0);
+					cloud->computeNormalsWithGrids(LS, 2, true, normalsProgressDlg.data());
 				}
 			}
 
@@ -32,6 +32,7 @@ public:
 
 	//inherited from FileIOFilter
 	virtual bool importSupported() const override { return true; }
+	virtual bool backgroundImportSupported() const override { return true; }
 	virtual CC_FILE_ERROR loadFile(QString filename, ccHObject& container, LoadParameters& parameters) override;
 	virtual QStringList getFileFilters(bool onImport) const override { return QStringList(GetFileFilter()); }
 	virtual QString getDefaultExtension() const override { return GetDefaultExtension(); }
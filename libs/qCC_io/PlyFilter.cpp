@@ -19,12 +19,16 @@
 
 //Local
 #include "PlyOpenDlg.h"
+#include "ccPointStream.h"
 
 //Qt
 #include <QImage>
+#include <QFile>
 #include <QFileInfo>
 #include <QMessageBox>
 #include <QPushButton>
+#include <QtConcurrentMap>
+#include <QtEndian>
 
 //qCC_db
 #include <ccLog.h>
@@ -32,12 +36,15 @@
 #include <ccPointCloud.h>
 #include <ccMaterial.h>
 #include <ccMaterialSet.h>
+#include <ccNormalVectors.h>
 #include <ccProgressDialog.h>
 #include <ccScalarField.h>
 
 //System
 #include <string.h>
 #include <assert.h>
+#include <algorithm>
+#include <limits>
 #if defined(CC_WINDOWS)
 #include <windows.h>
 #else
@@ -733,6 +740,535 @@ static int texIndexes_cb(p_ply_argument argument)
 	return 1;
 }
 
+/*****************************/
+/***  Binary fast path     ***/
+/*****************************/
+
+//! Size (in bytes) of each scalar PLY type (same order as e_ply_type)
+static const size_t s_plyTypeSizes[PLY_LIST] = { 1, 1, 2, 2, 4, 4, 4, 8, 1, 1, 2, 2, 4, 4, 4, 8 };
+
+//! Number of records decoded by a single task of the binary fast path
+static const unsigned PLY_BINARY_BLOCK_SIZE = 65536;
+
+//! Reads a single value from a binary PLY record
+static inline double ReadPlyBinaryValue(const uchar* ptr, e_ply_type type, bool bigEndian)
+{
+	switch (type)
+	{
+	case PLY_INT8:
+	case PLY_CHAR:
+		return static_cast<double>(static_cast<qint8>(*ptr));
+	case PLY_UINT8:
+	case PLY_UCHAR:
+		return static_cast<double>(*ptr);
+	case PLY_INT16:
+	case PLY_SHORT:
+		return static_cast<double>(static_cast<qint16>(bigEndian ? qFromBigEndian<quint16>(ptr) : qFromLittleEndian<quint16>(ptr)));
+	case PLY_UINT16:
+	case PLY_USHORT:
+		return static_cast<double>(bigEndian ? qFromBigEndian<quint16>(ptr) : qFromLittleEndian<quint16>(ptr));
+	case PLY_INT32:
+	case PLY_INT:
+		return static_cast<double>(static_cast<qint32>(bigEndian ? qFromBigEndian<quint32>(ptr) : qFromLittleEndian<quint32>(ptr)));
+	case PLY_UIN32:
+	case PLY_UINT:
+		return static_cast<double>(bigEndian ? qFromBigEndian<quint32>(ptr) : qFromLittleEndian<quint32>(ptr));
+	case PLY_FLOAT32:
+	case PLY_FLOAT:
+	{
+		quint32 bits = (bigEndian ? qFromBigEndian<quint32>(ptr) : qFromLittleEndian<quint32>(ptr));
+		float val;
+		memcpy(&val, &bits, sizeof(float));
+		return static_cast<double>(val);
+	}
+	case PLY_FLOAT64:
+	case PLY_DOUBLE:
+	{
+		quint64 bits = (bigEndian ? qFromBigEndian<quint64>(ptr) : qFromLittleEndian<quint64>(ptr));
+		double val;
+		memcpy(&val, &bits, sizeof(double));
+		return val;
+	}
+	default:
+		assert(false);
+		break;
+	}
+
+	return 0.0;
+}
+
+//! Converts a PLY color component to a ColorCompType (same rules as 'rgb_cb')
+static inline ColorCompType ToPlyColorComp(double val, e_ply_type type)
+{
+	switch (type)
+	{
+	case PLY_FLOAT:
+	case PLY_DOUBLE:
+	case PLY_FLOAT32:
+	case PLY_FLOAT64:
+		return static_cast<ColorCompType>(std::min(std::max(0.0, val), 1.0) * ccColor::MAX);
+	default:
+		return static_cast<ColorCompType>(val);
+	}
+}
+
+//! Location of a scalar property inside a fixed-size binary record
+struct PlyBinaryField
+{
+	PlyBinaryField() : offset(0), type(PLY_FLOAT32), valid(false) {}
+
+	size_t offset;
+	e_ply_type type;
+	bool valid;
+};
+
+//! Layout of a PLY element in a binary file
+struct PlyBinaryElement
+{
+	PlyBinaryElement() : dataOffset(0), recordSize(0), fixedSize(false), located(false) {}
+
+	//! Offset of the first record (relatively to the end of the header)
+	size_t dataOffset;
+	//! Record size (only valid if fixedSize is true)
+	size_t recordSize;
+	//! Whether all the element records have the same size
+	bool fixedSize;
+	//! Whether the data offset is known (i.e. all the previous elements have a fixed size)
+	bool located;
+};
+
+//! Shared (read-only) context of the binary fast path
+struct PlyBinaryContext
+{
+	PlyBinaryContext()
+		: bigEndian(false)
+		, vertexData(0)
+		, vertexStride(0)
+		, cloud(0)
+		, Pshift(0, 0, 0)
+		, hasNormals(false)
+		, hasColors(false)
+		, faceData(0)
+		, faceStride(0)
+		, mesh(0)
+	{}
+
+	bool bigEndian;
+
+	const uchar* vertexData;
+	size_t vertexStride;
+	ccPointCloud* cloud;
+	CCVector3d Pshift;
+	PlyBinaryField coords[3];
+	PlyBinaryField normals[3];
+	PlyBinaryField colors[3];
+	PlyBinaryField intensity;
+	bool hasNormals;
+	bool hasColors;
+	std::vector<PlyBinaryField> sfFields;
+	std::vector<CCLib::ScalarField*> sfs;
+
+	const uchar* faceData;
+	size_t faceStride;
+	PlyBinaryField faceLength;
+	PlyBinaryField faceIndexes;
+	ccMesh* mesh;
+};
+
+//! Range of records processed by a single task of the binary fast path
+struct PlyBinaryBlock
+{
+	const PlyBinaryContext* context;
+	unsigned first;
+	unsigned count;
+	//! Set to false if the block content is irregular
+	bool valid;
+};
+
+static void DecodePlyVertexBlock(PlyBinaryBlock& block)
+{
+	const PlyBinaryContext& c = *block.context;
+	const uchar* record = c.vertexData + c.vertexStride * block.first;
+
+	for (unsigned i = block.first; i < block.first + block.count; ++i, record += c.vertexStride)
+	{
+		CCVector3d P(0, 0, 0);
+		for (unsigned char d = 0; d < 3; ++d)
+		{
+			if (c.coords[d].valid)
+			{
+				double val = ReadPlyBinaryValue(record + c.coords[d].offset, c.coords[d].type, c.bigEndian);
+				//NaN values are replaced by 0 (see 'vertex_cb')
+				P.u[d] = (val == val ? val : 0.0);
+			}
+		}
+		*const_cast<CCVector3*>(c.cloud->getPointPersistentPtr(i)) = CCVector3::fromArray((P + c.Pshift).u);
+
+		if (c.hasNormals)
+		{
+			CCVector3 N(0, 0, 0);
+			for (unsigned char d = 0; d < 3; ++d)
+			{
+				if (c.normals[d].valid)
+					N.u[d] = static_cast<PointCoordinateType>(ReadPlyBinaryValue(record + c.normals[d].offset, c.normals[d].type, c.bigEndian));
+			}
+			c.cloud->normals()->setValue(i, ccNormalVectors::GetNormIndex(N.u));
+		}
+
+		if (c.hasColors)
+		{
+			ColorCompType col[3] = { 0, 0, 0 };
+			if (c.intensity.valid)
+			{
+				col[0] = col[1] = col[2] = ToPlyColorComp(ReadPlyBinaryValue(record + c.intensity.offset, c.intensity.type, c.bigEndian), c.intensity.type);
+			}
+			else
+			{
+				for (unsigned char d = 0; d < 3; ++d)
+				{
+					if (c.colors[d].valid)
+						col[d] = ToPlyColorComp(ReadPlyBinaryValue(record + c.colors[d].offset, c.colors[d].type, c.bigEndian), c.colors[d].type);
+				}
+			}
+			c.cloud->rgbColors()->setValue(i, col);
+		}
+
+		for (size_t j = 0; j < c.sfs.size(); ++j)
+		{
+			const PlyBinaryField& f = c.sfFields[j];
+			c.sfs[j]->setValue(i, static_cast<ScalarType>(ReadPlyBinaryValue(record + f.offset, f.type, c.bigEndian)));
+		}
+	}
+}
+
+static void CheckPlyFaceBlock(PlyBinaryBlock& block)
+{
+	const PlyBinaryContext& c = *block.context;
+	const uchar* record = c.faceData + c.faceStride * block.first;
+
+	for (unsigned i = 0; i < block.count; ++i, record += c.faceStride)
+	{
+		if (ReadPlyBinaryValue(record + c.faceLength.offset, c.faceLength.type, c.bigEndian) != 3.0)
+		{
+			block.valid = false;
+			return;
+		}
+	}
+}
+
+static void DecodePlyFaceBlock(PlyBinaryBlock& block)
+{
+	const PlyBinaryContext& c = *block.context;
+	const uchar* record = c.faceData + c.faceStride * block.first;
+	const size_t valueSize = s_plyTypeSizes[c.faceIndexes.type];
+
+	for (unsigned i = block.first; i < block.first + block.count; ++i, record += c.faceStride)
+	{
+		const uchar* indexes = record + c.faceIndexes.offset;
+		CCLib::VerticesIndexes* tri = c.mesh->getTriangleVertIndexes(i);
+		tri->i1 = static_cast<unsigned>(ReadPlyBinaryValue(indexes, c.faceIndexes.type, c.bigEndian));
+		tri->i2 = static_cast<unsigned>(ReadPlyBinaryValue(indexes + valueSize, c.faceIndexes.type, c.bigEndian));
+		tri->i3 = static_cast<unsigned>(ReadPlyBinaryValue(indexes + 2 * valueSize, c.faceIndexes.type, c.bigEndian));
+	}
+}
+
+//! Processes 'count' records in parallel (by blocks)
+/** \return false if at least one block was flagged as invalid
+**/
+static bool ProcessPlyBinaryBlocks(const PlyBinaryContext& context, unsigned count, void (*func)(PlyBinaryBlock&))
+{
+	std::vector<PlyBinaryBlock> blocks;
+	try
+	{
+		blocks.reserve((count + PLY_BINARY_BLOCK_SIZE - 1) / PLY_BINARY_BLOCK_SIZE);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	for (unsigned first = 0; first < count; first += PLY_BINARY_BLOCK_SIZE)
+	{
+		PlyBinaryBlock block;
+		block.context = &context;
+		block.first = first;
+		block.count = std::min(PLY_BINARY_BLOCK_SIZE, count - first);
+		block.valid = true;
+		blocks.push_back(block);
+	}
+
+	QtConcurrent::blockingMap(blocks, func);
+
+	for (size_t i = 0; i < blocks.size(); ++i)
+		if (!blocks[i].valid)
+			return false;
+
+	return true;
+}
+
+//! Looks for the element (and the position in its records) of a given property
+static bool FindPlyBinaryField(const std::vector<plyElement>& fileElements, p_ply_property prop, size_t& elementIndex, PlyBinaryField& field)
+{
+	for (size_t i = 0; i < fileElements.size(); ++i)
+	{
+		size_t offset = 0;
+		const std::vector<plyProperty>& properties = fileElements[i].properties;
+		for (size_t j = 0; j < properties.size(); ++j)
+		{
+			const plyProperty& pp = properties[j];
+			if (pp.prop == prop)
+			{
+				elementIndex = i;
+				field.offset = offset;
+				field.type = (pp.type == PLY_LIST ? pp.length_type : pp.type);
+				field.valid = true;
+				return true;
+			}
+			if (pp.type == PLY_LIST)
+			{
+				//the offset of the next properties is not constant
+				break;
+			}
+			offset += s_plyTypeSizes[pp.type];
+		}
+	}
+
+	return false;
+}
+
+//! Loads the vertices (and faces) of a binary PLY file without rply
+/** Only works if the vertex element and all the elements before it have
+	fixed-size records. Faces are only decoded if they are all triangles
+	and if the face element has no other list property.
+	This method doesn't rely on any static variable (contrarily to the
+	rply callbacks) and can therefore be called concurrently.
+	\return false if the file doesn't meet the requirements (rply should be used instead)
+**/
+static bool LoadBinaryPlyFastPath(	const QString& filename,
+									e_ply_storage_mode storageMode,
+									const std::vector<plyElement>& fileElements,
+									const plyProperty* const stdProps[10],
+									const std::vector<const plyProperty*>& sfProps,
+									const std::vector<CCLib::ScalarField*>& sfs,
+									const plyProperty* faceProp,
+									unsigned numberOfPoints,
+									ccPointCloud* cloud,
+									ccMesh* mesh,
+									FileIOFilter::LoadParameters& parameters)
+{
+	if (storageMode != PLY_BIG_ENDIAN && storageMode != PLY_LITTLE_ENDIAN)
+		return false;
+	assert(cloud && sfProps.size() == sfs.size());
+
+	//records layout
+	std::vector<PlyBinaryElement> layouts(fileElements.size());
+	{
+		size_t offset = 0;
+		bool located = true;
+		for (size_t i = 0; i < fileElements.size(); ++i)
+		{
+			PlyBinaryElement& layout = layouts[i];
+			layout.located = located;
+			layout.dataOffset = offset;
+			layout.fixedSize = true;
+
+			const std::vector<plyProperty>& properties = fileElements[i].properties;
+			for (size_t j = 0; j < properties.size(); ++j)
+			{
+				if (properties[j].type == PLY_LIST)
+				{
+					layout.fixedSize = false;
+					break;
+				}
+				layout.recordSize += s_plyTypeSizes[properties[j].type];
+			}
+
+			//we can't locate the next elements if the records don't have a fixed size
+			if (layout.fixedSize)
+				offset += layout.recordSize * static_cast<size_t>(fileElements[i].elementInstances);
+			else
+				located = false;
+		}
+	}
+
+	PlyBinaryContext context;
+	context.bigEndian = (storageMode == PLY_BIG_ENDIAN);
+	context.cloud = cloud;
+
+	//all the point properties must belong to the same (located) element
+	size_t vertexElementIndex = fileElements.size();
+	{
+		PlyBinaryField* targets[10] = {	&context.coords[0], &context.coords[1], &context.coords[2],
+										&context.normals[0], &context.normals[1], &context.normals[2],
+										&context.colors[0], &context.colors[1], &context.colors[2],
+										&context.intensity };
+
+		std::vector<const plyProperty*> properties(stdProps, stdProps + 10);
+		properties.insert(properties.end(), sfProps.begin(), sfProps.end());
+		context.sfFields.resize(sfProps.size());
+
+		for (size_t i = 0; i < properties.size(); ++i)
+		{
+			if (!properties[i])
+				continue;
+
+			size_t elementIndex = 0;
+			PlyBinaryField& field = (i < 10 ? *targets[i] : context.sfFields[i - 10]);
+			if (!FindPlyBinaryField(fileElements, properties[i]->prop, elementIndex, field))
+				return false;
+			if (vertexElementIndex == fileElements.size())
+				vertexElementIndex = elementIndex;
+			else if (vertexElementIndex != elementIndex)
+				return false;
+		}
+	}
+	if (	vertexElementIndex == fileElements.size()
+		||	!layouts[vertexElementIndex].located
+		||	!layouts[vertexElementIndex].fixedSize
+		||	fileElements[vertexElementIndex].elementInstances != static_cast<long>(numberOfPoints))
+	{
+		return false;
+	}
+
+	context.hasNormals = (context.normals[0].valid || context.normals[1].valid || context.normals[2].valid);
+	context.hasColors = (context.colors[0].valid || context.colors[1].valid || context.colors[2].valid);
+	//intensity is only loaded if there's no RGB color (see the standard path)
+	if (context.hasColors)
+		context.intensity.valid = false;
+	else
+		context.hasColors = context.intensity.valid;
+	if (context.hasNormals && !cloud->hasNormals())
+		return false;
+	if (context.hasColors && !cloud->hasColors())
+		return false;
+
+	//face element
+	size_t faceElementIndex = fileElements.size();
+	if (mesh && faceProp)
+	{
+		if (!FindPlyBinaryField(fileElements, faceProp->prop, faceElementIndex, context.faceLength))
+			return false;
+		if (!layouts[faceElementIndex].located)
+			return false;
+
+		//the vertex indexes must be the only 'list' property of the face element
+		const std::vector<plyProperty>& properties = fileElements[faceElementIndex].properties;
+		size_t recordSize = 0;
+		for (size_t j = 0; j < properties.size(); ++j)
+		{
+			const plyProperty& pp = properties[j];
+			if (pp.type == PLY_LIST)
+			{
+				if (pp.prop != faceProp->prop || pp.value_type >= PLY_LIST || pp.length_type >= PLY_LIST)
+					return false;
+				recordSize += s_plyTypeSizes[pp.length_type] + 3 * s_plyTypeSizes[pp.value_type];
+				context.faceIndexes.type = pp.value_type;
+			}
+			else
+			{
+				recordSize += s_plyTypeSizes[pp.type];
+			}
+		}
+		context.faceIndexes.offset = context.faceLength.offset + s_plyTypeSizes[context.faceLength.type];
+		context.faceIndexes.valid = true;
+		//(assuming the list size is always 3)
+		context.faceStride = recordSize;
+	}
+
+	QFile file(filename);
+	if (!file.open(QFile::ReadOnly))
+		return false;
+	const qint64 fileSize = file.size();
+	uchar* fileData = file.map(0, fileSize);
+	if (!fileData)
+	{
+		//can't map the file (32 bits OS?)
+		return false;
+	}
+
+	//look for the end of the header
+	size_t headerSize = 0;
+	{
+		static const char endHeader[] = "end_header";
+		QByteArray buffer = QByteArray::fromRawData(reinterpret_cast<const char*>(fileData), static_cast<int>(std::min<qint64>(fileSize, std::numeric_limits<int>::max())));
+		int pos = buffer.indexOf(endHeader);
+		if (pos < 0)
+		{
+			file.unmap(fileData);
+			return false;
+		}
+		headerSize = static_cast<size_t>(pos) + strlen(endHeader);
+		if (headerSize < static_cast<size_t>(fileSize) && fileData[headerSize] == '\r')
+			++headerSize;
+		if (headerSize < static_cast<size_t>(fileSize) && fileData[headerSize] == '\n')
+			++headerSize;
+	}
+
+	//check that the vertex (and face) records fit in the file
+	const PlyBinaryElement& vertexLayout = layouts[vertexElementIndex];
+	context.vertexData = fileData + headerSize + vertexLayout.dataOffset;
+	context.vertexStride = vertexLayout.recordSize;
+	if (headerSize + vertexLayout.dataOffset + vertexLayout.recordSize * static_cast<size_t>(numberOfPoints) > static_cast<size_t>(fileSize))
+	{
+		file.unmap(fileData);
+		return false;
+	}
+
+	unsigned numberOfFacets = 0;
+	if (faceElementIndex != fileElements.size())
+	{
+		numberOfFacets = static_cast<unsigned>(fileElements[faceElementIndex].elementInstances);
+		size_t faceOffset = headerSize + layouts[faceElementIndex].dataOffset;
+		if (faceOffset + context.faceStride * static_cast<size_t>(numberOfFacets) > static_cast<size_t>(fileSize))
+		{
+			file.unmap(fileData);
+			return false;
+		}
+		context.faceData = fileData + faceOffset;
+		context.mesh = mesh;
+
+		//all faces must be triangles
+		if (!ProcessPlyBinaryBlocks(context, numberOfFacets, CheckPlyFaceBlock))
+		{
+			file.unmap(fileData);
+			return false;
+		}
+	}
+
+	//from now on, we can't go back anymore
+	if (!cloud->resize(numberOfPoints) || (context.mesh && !context.mesh->resize(numberOfFacets)))
+	{
+		file.unmap(fileData);
+		return false;
+	}
+
+	//first point: check for 'big' coordinates
+	{
+		CCVector3d P(0, 0, 0);
+		for (unsigned char d = 0; d < 3; ++d)
+		{
+			if (context.coords[d].valid)
+			{
+				double val = ReadPlyBinaryValue(context.vertexData + context.coords[d].offset, context.coords[d].type, context.bigEndian);
+				P.u[d] = (val == val ? val : 0.0);
+			}
+		}
+		if (FileIOFilter::HandleGlobalShift(P, context.Pshift, parameters))
+		{
+			cloud->setGlobalShift(context.Pshift);
+			ccLog::Warning("[PLYFilter::loadFile] Cloud (vertices) has been recentered! Translation: (%.2f ; %.2f ; %.2f)", context.Pshift.x, context.Pshift.y, context.Pshift.z);
+		}
+	}
+
+	ProcessPlyBinaryBlocks(context, numberOfPoints, DecodePlyVertexBlock);
+	if (context.mesh)
+		ProcessPlyBinaryBlocks(context, numberOfFacets, DecodePlyFaceBlock);
+
+	file.unmap(fileData);
+
+	return true;
+}
+
 
 CC_FILE_ERROR PlyFilter::loadFile(QString filename, ccHObject& container, LoadParameters& parameters)
 {
@@ -829,6 +1365,8 @@ CC_FILE_ERROR PlyFilter::loadFile(QString filename, QString inputTextureFilename
 	std::vector<plyProperty> listProperties;
 	//Mesh-based single-element properties (texture index, etc.)
 	std::vector<plyProperty> singleProperties;
+	//All elements (in the file order)
+	std::vector<plyElement> fileElements;
 
 	try
 	{
@@ -904,6 +1442,8 @@ CC_FILE_ERROR PlyFilter::loadFile(QString filename, QString inputTextureFilename
 				}
 				pointElements.push_back(lastElement);
 			}
+
+			fileElements.push_back(lastElement);
 		}
 	}
 	catch (const std::bad_alloc&)
@@ -1407,6 +1947,8 @@ CC_FILE_ERROR PlyFilter::loadFile(QString filename, QString inputTextureFilename
 	}
 
 	/* SCALAR FIELDS (SF) */
+	std::vector<const plyProperty*> sfProps;
+	std::vector<CCLib::ScalarField*> sfs;
 	{
 		for (size_t i=0; i<sfPropIndexes.size(); ++i)
 		{
@@ -1439,6 +1981,8 @@ CC_FILE_ERROR PlyFilter::loadFile(QString filename, QString inputTextureFilename
 					if (sf->resize(numberOfScalars))
 					{
 						ply_set_read_cb(ply, pointElements[pp.elemIndex].elementName, pp.propName, scalar_cb, sf, 1);
+						sfProps.push_back(&pp);
+						sfs.push_back(sf);
 					}
 					else
 					{
@@ -1543,15 +2087,62 @@ CC_FILE_ERROR PlyFilter::loadFile(QString filename, QString inputTextureFilename
 		QApplication::processEvents();
 	}
 
-	//let 'Rply' do the job;)
+	//binary files with fixed-size vertex records can be decoded directly
+	bool fastPathUsed = false;
+	unsigned triCount = 0;
+	if (!texCoords && !texIndexes)
+	{
+		const plyProperty* stdProps[nStdProp];
+		for (unsigned i = 0; i < nStdProp; ++i)
+			stdProps[i] = (stdPropIndexes[i] > 0 ? &stdProperties[stdPropIndexes[i] - 1] : 0);
+		const plyProperty* faceProp = (mesh ? &listProperties[facesIndex - 1] : 0);
+
+		try
+		{
+			fastPathUsed = LoadBinaryPlyFastPath(filename, storage_mode, fileElements, stdProps, sfProps, sfs, faceProp, numberOfPoints, cloud, mesh, parameters);
+		}
+		catch (const std::bad_alloc&)
+		{
+			fastPathUsed = false;
+		}
+
+		if (fastPathUsed)
+		{
+			triCount = (mesh ? mesh->size() : 0);
+			ccLog::PrintDebug("[PLY] Binary file decoded without rply");
+		}
+		else if (cloud->size() != 0)
+		{
+			//the fast path failed after having started to fill the cloud
+			if (mesh)
+				delete mesh;
+			delete cloud;
+			ply_close(ply);
+			delete pDlg;
+			return CC_FERR_NOT_ENOUGH_MEMORY;
+		}
+	}
+
+	//otherwise let 'Rply' do the job;)
 	int success = 0;
-	try
+	if (fastPathUsed)
 	{
-		success = ply_read(ply);
+		success = 1;
 	}
-	catch(...)
+	else
 	{
-		success = -1;
+		try
+		{
+			success = ply_read(ply);
+		}
+		catch(...)
+		{
+			success = -1;
+		}
+
+		triCount = s_triCount;
+		//we save parameters
+		parameters = s_loadParameters;
 	}
 
 	ply_close(ply);
@@ -1619,9 +2210,6 @@ CC_FILE_ERROR PlyFilter::loadFile(QString filename, QString inputTextureFilename
 		}
 	}
 
-	//we save parameters
-	parameters = s_loadParameters;
-
 	//we update the scalar field(s)
 	{
 		for (unsigned i=0; i<cloud->getNumberOfScalarFields(); ++i)
@@ -1639,17 +2227,17 @@ CC_FILE_ERROR PlyFilter::loadFile(QString filename, QString inputTextureFilename
 
 	if (mesh)
 	{
-		assert(s_triCount > 0);
+		assert(triCount > 0);
 		//check number of loaded facets against 'theoretical' number
-		if (s_triCount < numberOfFacets)
+		if (triCount < numberOfFacets)
 		{
-			mesh->resize(s_triCount);
+			mesh->resize(triCount);
 			ccLog::Warning("[PLY] Some facets couldn't be loaded!");
 		}
 
 		//check that vertex indices start at 0
 		unsigned minVertIndex = numberOfPoints, maxVertIndex = 0;
-		for (unsigned i = 0; i < s_triCount; ++i)
+		for (unsigned i = 0; i < triCount; ++i)
 		{
 			const CCLib::VerticesIndexes* tri = mesh->getTriangleVertIndexes(i);
 			if (tri->i1 < minVertIndex)
@@ -1671,7 +2259,7 @@ CC_FILE_ERROR PlyFilter::loadFile(QString filename, QString inputTextureFilename
 			if (maxVertIndex == numberOfPoints && minVertIndex > 0)
 			{
 				ccLog::Warning("[PLY] Vertex indexes seem to be shifted (+1)! We will try to 'unshift' indices (otherwise file is corrupted...)");
-				for (unsigned i=0;i<s_triCount;++i)
+				for (unsigned i=0;i<triCount;++i)
 				{
 					CCLib::VerticesIndexes* tri = mesh->getTriangleVertIndexes(i);
 					--tri->i1;
@@ -1815,3 +2403,588 @@ CC_FILE_ERROR PlyFilter::loadFile(QString filename, QString inputTextureFilename
 
 	return CC_FERR_NO_ERROR;
 }
+
+//! Role of a 'vertex' property for the PLY stream reader
+enum PlyStreamPropertyRole { PLY_STREAM_IGNORED, PLY_STREAM_COORD, PLY_STREAM_NORMAL, PLY_STREAM_COLOR, PLY_STREAM_SCALAR };
+
+//! PLY point stream reader
+/** Only the 'vertex' element is read (faces are skipped).
+**/
+class PlyStreamReader : public ccPointStreamReader
+{
+public:
+
+	PlyStreamReader(const QString& filename, const FileIOFilter::LoadParameters& parameters)
+		: ccPointStreamReader(parameters)
+		, m_filename(filename)
+		, m_ply(0)
+		, m_pointCount(0)
+		, m_lastPropIndex(-1)
+		, m_hasNormals(false)
+		, m_hasColors(false)
+		, m_blockSize(0)
+		, m_block(0)
+		, m_pointsRead(0)
+		, m_Pshift(0, 0, 0)
+		, m_result(CC_FERR_NO_ERROR)
+	{}
+
+	virtual ~PlyStreamReader()
+	{
+		if (m_ply)
+			ply_close(m_ply);
+		delete m_block;
+	}
+
+	//! Opens the file and reads its header
+	CC_FILE_ERROR open()
+	{
+		m_ply = ply_open(qPrintable(m_filename), NULL, 0, NULL);
+		if (!m_ply)
+			return CC_FERR_READING;
+		if (!ply_read_header(m_ply))
+			return CC_FERR_WRONG_FILE_TYPE;
+
+		//look for the 'vertex' element
+		p_ply_element element = 0;
+		while ((element = ply_get_next_element(m_ply, element)))
+		{
+			const char* elementName = 0;
+			long instances = 0;
+			ply_get_element_info(element, &elementName, &instances);
+			if (!elementName || QString(elementName).toLower() != "vertex")
+				continue;
+
+			m_pointCount = instances;
+
+			p_ply_property property = 0;
+			while ((property = ply_get_next_property(element, property)))
+			{
+				PropertyDesc desc;
+				e_ply_type type, lengthType, valueType;
+				ply_get_property_info(property, &desc.name, &type, &lengthType, &valueType);
+				QString name = QString(desc.name).toLower();
+				desc.isFloat = (type == PLY_FLOAT || type == PLY_DOUBLE || type == PLY_FLOAT32 || type == PLY_FLOAT64);
+
+				if (type == PLY_LIST)
+				{
+					desc.role = PLY_STREAM_IGNORED;
+				}
+				else if (name == "x" || name == "y" || name == "z")
+				{
+					desc.role = PLY_STREAM_COORD;
+					desc.dim = name[0].toLatin1() - 'x';
+				}
+				else if (name == "nx" || name == "ny" || name == "nz")
+				{
+					desc.role = PLY_STREAM_NORMAL;
+					desc.dim = name[1].toLatin1() - 'x';
+					m_hasNormals = true;
+				}
+				else if (name == "red" || name == "diffuse_red" || name == "r")
+				{
+					desc.role = PLY_STREAM_COLOR;
+					desc.dim = 0;
+					m_hasColors = true;
+				}
+				else if (name == "green" || name == "diffuse_green" || name == "g")
+				{
+					desc.role = PLY_STREAM_COLOR;
+					desc.dim = 1;
+					m_hasColors = true;
+				}
+				else if (name == "blue" || name == "diffuse_blue" || name == "b")
+				{
+					desc.role = PLY_STREAM_COLOR;
+					desc.dim = 2;
+					m_hasColors = true;
+				}
+				else if (name == "alpha" || name == "diffuse_alpha" || name == "a")
+				{
+					desc.role = PLY_STREAM_IGNORED;
+				}
+				else
+				{
+					desc.role = PLY_STREAM_SCALAR;
+					QString sfName(desc.name);
+					if (sfName.startsWith("scalar_") && sfName.length() > 7)
+					{
+						//remove the 'scalar_' prefix added when saving SF with CC!
+						sfName = sfName.mid(7).replace('_', ' ');
+					}
+					desc.dim = static_cast<int>(m_sfNames.size());
+					m_sfNames.push_back(sfName);
+				}
+
+				if (desc.role != PLY_STREAM_IGNORED)
+				{
+					m_lastPropIndex = static_cast<int>(m_properties.size());
+				}
+				m_properties.push_back(desc);
+			}
+			break;
+		}
+
+		int coordCount = 0;
+		for (const PropertyDesc& desc : m_properties)
+			if (desc.role == PLY_STREAM_COORD)
+				++coordCount;
+		if (coordCount == 0 || m_pointCount <= 0)
+			return CC_FERR_NO_LOAD;
+
+		m_values.resize(m_properties.size(), 0.0);
+		return CC_FERR_NO_ERROR;
+	}
+
+	virtual qint64 pointCount() const override { return m_pointCount; }
+
+	virtual CC_FILE_ERROR read(unsigned blockSize, BlockHandler handler) override
+	{
+		if (!m_ply || m_lastPropIndex < 0)
+			return CC_FERR_BAD_ARGUMENT;
+
+		m_blockSize = blockSize;
+		m_handler = handler;
+		m_result = CC_FERR_NO_ERROR;
+
+		for (size_t i = 0; i < m_properties.size(); ++i)
+		{
+			if (m_properties[i].role != PLY_STREAM_IGNORED)
+				ply_set_read_cb(m_ply, "vertex", m_properties[i].name, VertexCallback, this, static_cast<long>(i));
+		}
+
+		int success = ply_read(m_ply);
+		if (m_result != CC_FERR_NO_ERROR)
+			return m_result;
+
+		//last block
+		if (m_block)
+		{
+			ccPointCloud* block = m_block;
+			m_block = 0;
+			if (!m_handler(block))
+				return CC_FERR_CANCELED_BY_USER;
+		}
+
+		if (success <= 0 && m_pointsRead < m_pointCount)
+		{
+			//the file is truncated (or corrupted)
+			return CC_FERR_READING;
+		}
+
+		return CC_FERR_NO_ERROR;
+	}
+
+protected:
+
+	//! 'vertex' property description
+	struct PropertyDesc
+	{
+		const char* name;
+		PlyStreamPropertyRole role;
+		int dim;
+		bool isFloat;
+
+		PropertyDesc() : name(0), role(PLY_STREAM_IGNORED), dim(0), isFloat(false) {}
+	};
+
+	//! rply callback
+	static int VertexCallback(p_ply_argument argument)
+	{
+		void* reader = 0;
+		long index = 0;
+		ply_get_argument_user_data(argument, &reader, &index);
+		return static_cast<PlyStreamReader*>(reader)->setValue(static_cast<int>(index), ply_get_argument_value(argument)) ? 1 : 0;
+	}
+
+	//! Stores a property value (and adds the current point once all its properties have been read)
+	bool setValue(int propIndex, double value)
+	{
+		m_values[propIndex] = value;
+		return (propIndex == m_lastPropIndex ? addPoint() : true);
+	}
+
+	//! Creates a new block
+	ccPointCloud* createBlock()
+	{
+		ccPointCloud* block = new ccPointCloud("unnamed - Cloud");
+		if (	!block->reserveThePointsTable(m_blockSize)
+			||	(m_hasColors && !block->reserveTheRGBTable())
+			||	(m_hasNormals && !block->reserveTheNormsTable()) )
+		{
+			delete block;
+			return 0;
+		}
+
+		for (const QString& sfName : m_sfNames)
+		{
+			ccScalarField* sf = new ccScalarField(qPrintable(sfName));
+			sf->link();
+			int sfIdx = block->addScalarField(sf);
+			sf->release();
+			if (sfIdx < 0 || !sf->reserve(m_blockSize))
+			{
+				delete block;
+				return 0;
+			}
+		}
+
+		block->setGlobalShift(m_Pshift);
+		return block;
+	}
+
+	//! Adds the current point to the current block
+	bool addPoint()
+	{
+		if (!m_block)
+		{
+			m_block = createBlock();
+			if (!m_block)
+			{
+				m_result = CC_FERR_NOT_ENOUGH_MEMORY;
+				return false;
+			}
+		}
+
+		CCVector3d P(0, 0, 0);
+		CCVector3 N(0, 0, 0);
+		ColorCompType rgb[3] = { 0, 0, 0 };
+		for (size_t i = 0; i < m_properties.size(); ++i)
+		{
+			const PropertyDesc& desc = m_properties[i];
+			double value = m_values[i];
+			switch (desc.role)
+			{
+			case PLY_STREAM_COORD:
+				P.u[desc.dim] = (value == value ? value : 0); //NaN values are replaced by 0
+				break;
+			case PLY_STREAM_NORMAL:
+				N.u[desc.dim] = static_cast<PointCoordinateType>(value);
+				break;
+			case PLY_STREAM_COLOR:
+				if (desc.isFloat)
+					value *= ccColor::MAX;
+				rgb[desc.dim] = static_cast<ColorCompType>(std::min(std::max(0.0, value), static_cast<double>(ccColor::MAX)));
+				break;
+			case PLY_STREAM_SCALAR:
+				m_block->getScalarField(desc.dim)->addElement(static_cast<ScalarType>(value));
+				break;
+			default:
+				break;
+			}
+		}
+
+		//first point: check for 'big' coordinates
+		if (m_pointsRead == 0)
+		{
+			if (FileIOFilter::HandleGlobalShift(P, m_Pshift, m_loadParameters))
+			{
+				m_block->setGlobalShift(m_Pshift);
+				ccLog::Warning("[PLYFilter] Cloud (vertices) has been recentered! Translation: (%.2f ; %.2f ; %.2f)", m_Pshift.x, m_Pshift.y, m_Pshift.z);
+			}
+		}
+
+		m_block->addPoint(CCVector3::fromArray((P + m_Pshift).u));
+		if (m_hasNormals)
+			m_block->addNorm(N);
+		if (m_hasColors)
+			m_block->addRGBColor(rgb);
+		++m_pointsRead;
+
+		//block is full
+		if (m_block->size() == m_blockSize)
+		{
+			ccPointCloud* block = m_block;
+			m_block = 0;
+			if (!m_handler(block))
+			{
+				m_result = CC_FERR_CANCELED_BY_USER;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	QString m_filename;
+	p_ply m_ply;
+	qint64 m_pointCount;
+	std::vector<PropertyDesc> m_properties;
+	std::vector<QString> m_sfNames;
+	std::vector<double> m_values;
+	int m_lastPropIndex;
+	bool m_hasNormals;
+	bool m_hasColors;
+
+	unsigned m_blockSize;
+	BlockHandler m_handler;
+	ccPointCloud* m_block;
+	qint64 m_pointsRead;
+	CCVector3d m_Pshift;
+	CC_FILE_ERROR m_result;
+};
+
+//! Width of the (space padded) 'vertex' element count in the PLY header written by PlyStreamWriter
+static const int PLY_STREAM_COUNT_WIDTH = 20;
+
+//! PLY point stream writer
+/** The vertex count is unknown when the header is written: it is patched afterwards.
+**/
+class PlyStreamWriter : public ccPointStreamWriter
+{
+public:
+
+	explicit PlyStreamWriter(e_ply_storage_mode storageType)
+		: m_storageType(storageType)
+		, m_countPos(-1)
+		, m_pointCount(0)
+		, m_coordType(PLY_FLOAT)
+		, m_writeColors(false)
+		, m_writeNorms(false)
+		, m_sfCount(0)
+	{
+		if (m_storageType == PLY_DEFAULT)
+		{
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+			m_storageType = PLY_BIG_ENDIAN;
+#else
+			m_storageType = PLY_LITTLE_ENDIAN;
+#endif
+		}
+	}
+
+	bool open(const QString& filename)
+	{
+		m_file.setFileName(filename);
+		return m_file.open(QFile::WriteOnly | QFile::Truncate);
+	}
+
+	virtual CC_FILE_ERROR write(const ccPointCloud* block) override
+	{
+		unsigned count = block->size();
+		if (count == 0)
+			return CC_FERR_NO_ERROR;
+
+		//the first (non empty) block defines the output layout
+		if (m_countPos < 0)
+		{
+			m_coordType = block->isShifted() || sizeof(PointCoordinateType) > 4 ? PLY_DOUBLE : PLY_FLOAT; //we use double coordinates for shifted vertices (i.e. >1e6)
+			m_writeColors = block->hasColors();
+			m_writeNorms = block->hasNormals();
+			m_sfCount = block->getNumberOfScalarFields();
+			if (!writeHeader(block))
+				return CC_FERR_WRITING;
+		}
+		else if (	(m_writeColors && !block->hasColors())
+				||	(m_writeNorms && !block->hasNormals())
+				||	block->getNumberOfScalarFields() < m_sfCount)
+		{
+			//all the blocks should have the same layout
+			return CC_FERR_BAD_ENTITY_TYPE;
+		}
+
+		QByteArray buffer;
+		for (unsigned i = 0; i < count; ++i)
+		{
+			CCVector3 P;
+			block->getPoint(i, P);
+			CCVector3d Pglobal = block->toGlobal3d<PointCoordinateType>(P);
+			for (unsigned d = 0; d < 3; ++d)
+			{
+				if (m_coordType == PLY_DOUBLE)
+					append(buffer, Pglobal.u[d]);
+				else
+					append(buffer, static_cast<float>(Pglobal.u[d]));
+			}
+
+			if (m_writeColors)
+			{
+				const ColorCompType* col = block->getPointColor(i);
+				append(buffer, col[0]);
+				append(buffer, col[1]);
+				append(buffer, col[2]);
+			}
+
+			if (m_writeNorms)
+			{
+				const CCVector3& N = block->getPointNormal(i);
+				append(buffer, static_cast<float>(N.x));
+				append(buffer, static_cast<float>(N.y));
+				append(buffer, static_cast<float>(N.z));
+			}
+
+			for (unsigned k = 0; k < m_sfCount; ++k)
+			{
+				const CCLib::ScalarField* sf = block->getScalarField(static_cast<int>(k));
+				append(buffer, static_cast<float>(static_cast<const ccScalarField*>(sf)->getGlobalShift() + sf->getValue(i)));
+			}
+
+			if (m_storageType == PLY_ASCII)
+			{
+				//replace the last separator by an end of line
+				buffer[buffer.size() - 1] = '\n';
+			}
+		}
+
+		if (m_file.write(buffer) != buffer.size())
+			return CC_FERR_WRITING;
+
+		m_pointCount += count;
+		return CC_FERR_NO_ERROR;
+	}
+
+	virtual CC_FILE_ERROR finish() override
+	{
+		//empty file
+		if (m_countPos < 0 && !writeHeader(0))
+			return CC_FERR_WRITING;
+
+		//we can now write the actual number of points
+		QByteArray countStr = QByteArray::number(m_pointCount).leftJustified(PLY_STREAM_COUNT_WIDTH, ' ');
+		if (	countStr.size() != PLY_STREAM_COUNT_WIDTH
+			||	!m_file.seek(m_countPos)
+			||	m_file.write(countStr) != countStr.size())
+		{
+			return CC_FERR_WRITING;
+		}
+
+		m_file.close();
+		return CC_FERR_NO_ERROR;
+	}
+
+protected:
+
+	//! Writes the header (the vertex count is left blank)
+	bool writeHeader(const ccPointCloud* block)
+	{
+		static const char* formatNames[] = { "binary_big_endian", "binary_little_endian", "ascii" };
+
+		QByteArray header;
+		header.append("ply\n");
+		header.append(QString("format %1 1.0\n").arg(formatNames[m_storageType]).toLatin1());
+		header.append("comment Author: CloudCompare (TELECOM PARISTECH/EDF R&D)\n");
+		header.append("obj_info Generated by CloudCompare!\n");
+		header.append("element vertex ");
+		qint64 countPos = m_file.pos() + header.size();
+		header.append(QByteArray(PLY_STREAM_COUNT_WIDTH, ' '));
+		header.append("\n");
+
+		const char* coordTypeName = (m_coordType == PLY_DOUBLE ? "double" : "float");
+		header.append(QString("property %1 x\nproperty %1 y\nproperty %1 z\n").arg(coordTypeName).toLatin1());
+		if (m_writeColors)
+		{
+			header.append("property uchar red\nproperty uchar green\nproperty uchar blue\n");
+		}
+		if (m_writeNorms)
+		{
+			header.append("property float nx\nproperty float ny\nproperty float nz\n");
+		}
+		unsigned unnamedSF = 0;
+		for (unsigned k = 0; k < m_sfCount; ++k)
+		{
+			const char* sfName = block->getScalarFieldName(static_cast<int>(k));
+			QString propName;
+			if (!sfName)
+			{
+				if (unnamedSF++ == 0)
+					propName = "scalar";
+				else
+					propName = QString("scalar_%1").arg(unnamedSF);
+			}
+			else
+			{
+				propName = QString("scalar_%1").arg(sfName);
+				propName.replace(' ','_');
+			}
+			header.append(QString("property float %1\n").arg(propName).toLatin1());
+		}
+		header.append("end_header\n");
+
+		if (m_file.write(header) != header.size())
+			return false;
+
+		m_countPos = countPos;
+		return true;
+	}
+
+	//! Appends a value to the output buffer (with the right format)
+	template <typename T> void append(QByteArray& buffer, T value)
+	{
+		if (m_storageType == PLY_ASCII)
+		{
+			buffer.append(QByteArray::number(static_cast<double>(value), 'g', sizeof(T) > 4 ? 17 : 9));
+			buffer.append(' ');
+		}
+		else
+		{
+			bool bigEndian = (m_storageType == PLY_BIG_ENDIAN);
+			uchar bytes[8];
+			switch (sizeof(T))
+			{
+			case 1:
+				memcpy(bytes, &value, 1);
+				break;
+			case 4:
+			{
+				quint32 bits;
+				memcpy(&bits, &value, 4);
+				if (bigEndian)
+					qToBigEndian<quint32>(bits, bytes);
+				else
+					qToLittleEndian<quint32>(bits, bytes);
+			}
+			break;
+			case 8:
+			{
+				quint64 bits;
+				memcpy(&bits, &value, 8);
+				if (bigEndian)
+					qToBigEndian<quint64>(bits, bytes);
+				else
+					qToLittleEndian<quint64>(bits, bytes);
+			}
+			break;
+			default:
+				assert(false);
+				return;
+			}
+			buffer.append(reinterpret_cast<const char*>(bytes), static_cast<int>(sizeof(T)));
+		}
+	}
+
+	QFile m_file;
+	e_ply_storage_mode m_storageType;
+	qint64 m_countPos;
+	qint64 m_pointCount;
+	e_ply_type m_coordType;
+	bool m_writeColors;
+	bool m_writeNorms;
+	unsigned m_sfCount;
+};
+
+ccPointStreamReader* PlyFilter::openStreamReader(const QString& filename, LoadParameters& parameters, CC_FILE_ERROR& result)
+{
+	PlyStreamReader* reader = new PlyStreamReader(filename, parameters);
+	result = reader->open();
+	if (result != CC_FERR_NO_ERROR)
+	{
+		delete reader;
+		return 0;
+	}
+
+	return reader;
+}
+
+ccPointStreamWriter* PlyFilter::openStreamWriter(const QString& filename, CC_FILE_ERROR& result)
+{
+	PlyStreamWriter* writer = new PlyStreamWriter(s_defaultOutputFormat);
+	if (!writer->open(filename))
+	{
+		delete writer;
+		result = CC_FERR_WRITING;
+		return 0;
+	}
+
+	result = CC_FERR_NO_ERROR;
+	return writer;
+}
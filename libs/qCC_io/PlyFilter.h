@@ -75,6 +75,8 @@ public:
 	virtual QString getDefaultExtension() const override { return GetDefaultExtension(); }
 	virtual bool canLoadExtension(QString upperCaseExt) const override;
 	virtual bool canSave(CC_CLASS_ENUM type, bool& multiple, bool& exclusive) const override;
+	virtual ccPointStreamReader* openStreamReader(const QString& filename, LoadParameters& parameters, CC_FILE_ERROR& result) override;
+	virtual ccPointStreamWriter* openStreamWriter(const QString& filename, CC_FILE_ERROR& result) override;
 
 	//! Custom loading method
 	CC_FILE_ERROR loadFile(QString filename, QString textureFilename, ccHObject& container, LoadParameters& parameters);
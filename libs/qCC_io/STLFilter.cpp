@@ -26,6 +26,12 @@
 #include <QString>
 #include <QMessageBox>
 #include <QPushButton>
+#include <QByteArray>
+#include <QScopedPointer>
+#include <QtConcurrentMap>
+
+//local
+#include "ccMappedTextFile.h"
 
 //qCC_db
 #include <ccLog.h>
@@ -33,10 +39,11 @@
 #include <ccPointCloud.h>
 #include <ccProgressDialog.h>
 #include <ccNormalVectors.h>
-#include <ccOctree.h>
 
 //System
 #include <string.h>
+#include <algorithm>
+#include <limits>
 
 bool STLFilter::canLoadExtension(QString upperCaseExt) const
 {
@@ -249,79 +256,467 @@ CC_FILE_ERROR STLFilter::saveToASCIIFile(ccGenericMesh* mesh, FILE *theFile, QWi
 	return CC_FERR_NO_ERROR;
 }
 
-const PointCoordinateType c_defaultSearchRadius = static_cast<PointCoordinateType>(sqrt(ZERO_TOLERANCE));
-static bool TagDuplicatedVertices(const CCLib::DgmOctree::octreeCell& cell,
-	void** additionalParameters,
-	CCLib::NormalizedProgress* nProgress/*=0*/)
+//! Default welding step (vertices falling in the same cell of this size are merged)
+/** Same order of magnitude as the search radius of the former octree-based approach.
+	Use 0 for an exact (bitwise) welding.
+**/
+static const PointCoordinateType c_defaultWeldingStep = static_cast<PointCoordinateType>(sqrt(ZERO_TOLERANCE));
+
+//! Number of facets processed at once
+static const unsigned STL_BLOCK_SIZE = 65536;
+//! Number of shards of the welding hash map (power of 2)
+static const unsigned STL_WELDER_SHARD_COUNT = 16;
+//! Number of vertices processed by each thread when computing their shard
+static const unsigned STL_WELDER_RANGE_SIZE = 16384;
+//! Empty entry flag (welding hash map)
+static const unsigned STL_WELDER_EMPTY_ENTRY = static_cast<unsigned>(-1);
+//! Flag of the entries pointing to a vertex of the current block (welding hash map)
+static const unsigned STL_WELDER_BLOCK_FLAG = (1u << 31);
+
+//! Hash-based vertex welder
+/** STL files store 3 (unshared) vertices per facet. Instead of building an octree
+	on all of them, vertices are merged on the fly with a hash map on their (quantized)
+	coordinates. The map is split in several shards that are filled in parallel. The
+	indexes are given in the order of first appearance (i.e. the result is deterministic).
+	The map only stores the index of each welded vertex: the keys are computed again
+	from the vertices coordinates (stored by the caller) when needed.
+	Warning: two vertices are merged if they fall in the same cell of the welding grid.
+	Close vertices on both sides of a cell boundary are not merged.
+**/
+class STLVertexWelder
 {
-	GenericChunkedArray<1, int>* equivalentIndexes = static_cast<GenericChunkedArray<1, int>*>(additionalParameters[0]);
+public:
+
+	//! Default constructor
+	/** \param step welding step (0 = exact welding)
+		\param vertices welded vertices (see weld)
+		\param rootIndexes index of each welded vertex in 'vertices' (optional: identity by default)
+	**/
+	STLVertexWelder(PointCoordinateType step, const ccPointCloud* vertices, const std::vector<unsigned>* rootIndexes = 0)
+		: m_step(step)
+		, m_vertexCount(0)
+		, m_vertices(vertices)
+		, m_rootIndexes(rootIndexes)
+		, m_points(0)
+	{
+		for (unsigned i = 0; i < STL_WELDER_SHARD_COUNT; ++i)
+		{
+			m_shards[i].welder = this;
+			m_shards[i].index = i;
+			m_shards[i].count = 0;
+		}
+	}
+
+	//! Returns the current number of (welded) vertices
+	inline unsigned vertexCount() const { return m_vertexCount; }
+
+	//! Welds a block of vertices
+	/** The new vertices must be stored by the caller (see the constructor) before the next call.
+		\param points input vertices
+		\param count number of input vertices
+		\param indexes output (welded) index of each input vertex
+		\param newVertices output position (in the input block) of the vertices that are new
+		\return success
+	**/
+	bool weld(const CCVector3* points, unsigned count, std::vector<unsigned>& indexes, std::vector<unsigned>& newVertices)
+	{
+		if (count >= STL_WELDER_BLOCK_FLAG || m_vertexCount >= STL_WELDER_BLOCK_FLAG - count)
+		{
+			//too many vertices
+			return false;
+		}
 
-	//we look for points very near to the others (only if not yet tagged!)
+		try
+		{
+			indexes.resize(count);
+			m_shardOf.resize(count);
+			m_refs.resize(count);
+			newVertices.clear();
+		}
+		catch (const std::bad_alloc&)
+		{
+			return false;
+		}
+		m_points = points;
 
-	//structure for nearest neighbors search
-	CCLib::DgmOctree::NearestNeighboursSphericalSearchStruct nNSS;
-	nNSS.level = cell.level;
-	nNSS.prepare(c_defaultSearchRadius, cell.parentOctree->getCellSize(nNSS.level));
-	cell.parentOctree->getCellPos(cell.truncatedCode, cell.level, nNSS.cellPos, true);
-	cell.parentOctree->computeCellCenter(nNSS.cellPos, cell.level, nNSS.cellCenter);
-	//*/
+		//compute the shard of each vertex (in parallel)
+		{
+			std::vector<Range> ranges;
+			for (unsigned first = 0; first < count; first += STL_WELDER_RANGE_SIZE)
+			{
+				Range r;
+				r.welder = this;
+				r.first = first;
+				r.count = std::min(STL_WELDER_RANGE_SIZE, count - first);
+				ranges.push_back(r);
+			}
+			QtConcurrent::blockingMap(ranges, ComputeShards);
+		}
 
-	unsigned n = cell.points->size(); //number of points in the current cell
+		//look for the vertices in each shard (in parallel)
+		{
+			std::vector<Shard*> shards;
+			for (unsigned i = 0; i < STL_WELDER_SHARD_COUNT; ++i)
+			{
+				m_shards[i].blockSize = count;
+				m_shards[i].error = false;
+				m_shards[i].newEntries.clear();
+				shards.push_back(m_shards + i);
+			}
+			QtConcurrent::blockingMap(shards, FillShard);
+			for (unsigned i = 0; i < STL_WELDER_SHARD_COUNT; ++i)
+			{
+				if (m_shards[i].error)
+					return false;
+			}
+		}
 
-	//we already know some of the neighbours: the points in the current cell!
-	try
+		//eventually we assign the new indexes (in order)
+		try
+		{
+			for (unsigned i = 0; i < count; ++i)
+			{
+				unsigned ref = m_refs[i];
+				if (ref == (i | STL_WELDER_BLOCK_FLAG))
+				{
+					//new vertex
+					indexes[i] = m_vertexCount++;
+					newVertices.push_back(i);
+				}
+				else if (ref & STL_WELDER_BLOCK_FLAG)
+				{
+					//first seen earlier in the same block
+					indexes[i] = indexes[ref & ~STL_WELDER_BLOCK_FLAG];
+				}
+				else
+				{
+					indexes[i] = ref;
+				}
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			return false;
+		}
+
+		//the new entries now point to the welded vertices
+		for (unsigned i = 0; i < STL_WELDER_SHARD_COUNT; ++i)
+		{
+			Shard& shard = m_shards[i];
+			for (size_t k = 0; k < shard.newEntries.size(); ++k)
+			{
+				unsigned& e = shard.table[shard.newEntries[k]];
+				e = indexes[e & ~STL_WELDER_BLOCK_FLAG];
+			}
+		}
+
+		m_points = 0;
+		return true;
+	}
+
+protected:
+
+	//! Hash map shard
+	struct Shard
+	{
+		STLVertexWelder* welder;
+		unsigned index;
+		//! number of vertices in the shard
+		size_t count;
+		//! open addressing table (index of the welded vertices)
+		std::vector<unsigned> table;
+		//! position of the entries created for the current block
+		std::vector<size_t> newEntries;
+		//! size of the current block
+		unsigned blockSize;
+		//! error flag
+		bool error;
+	};
+
+	//! Range of vertices
+	struct Range
+	{
+		STLVertexWelder* welder;
+		unsigned first;
+		unsigned count;
+	};
+
+	//! Computes the key of a vertex
+	inline void computeKey(const CCVector3& P, qint64 key[3]) const
 	{
-		nNSS.pointsInNeighbourhood.resize(n);
+		for (unsigned d = 0; d < 3; ++d)
+		{
+			if (m_step > 0)
+			{
+				double q = floor(static_cast<double>(P.u[d]) / m_step);
+				q = std::max(std::min(q, 9.0e18), -9.0e18);
+				key[d] = static_cast<qint64>(q);
+			}
+			else
+			{
+				//exact welding: we simply use the float bits (-0 and +0 should be the same)
+				float f = static_cast<float>(P.u[d]);
+				if (f == 0)
+					f = 0;
+				qint32 bits;
+				memcpy(&bits, &f, sizeof(float));
+				key[d] = bits;
+			}
+		}
 	}
-	catch (.../*const std::bad_alloc&*/) //out of memory
+
+	//! Returns the vertex pointed by a hash map entry
+	inline const CCVector3* entryVertex(unsigned e) const
 	{
-		return false;
+		if (e & STL_WELDER_BLOCK_FLAG)
+			return m_points + (e & ~STL_WELDER_BLOCK_FLAG);
+		return m_vertices->getPoint(m_rootIndexes ? (*m_rootIndexes)[e] : e);
+	}
+
+	//! Hashes a key
+	static inline quint64 Hash(const qint64 key[3])
+	{
+		quint64 h = static_cast<quint64>(key[0]) * 0x9E3779B97F4A7C15ULL;
+		h ^= static_cast<quint64>(key[1]) * 0xC2B2AE3D27D4EB4FULL;
+		h ^= static_cast<quint64>(key[2]) * 0x165667B19E3779F9ULL;
+		h ^= (h >> 29);
+		h *= 0xBF58476D1CE4E5B9ULL;
+		h ^= (h >> 32);
+		return h;
 	}
 
-	//init structure with cell points
+	//! Computes the shard of a range of vertices
+	static void ComputeShards(Range& range)
 	{
-		CCLib::DgmOctree::NeighboursSet::iterator it = nNSS.pointsInNeighbourhood.begin();
-		for (unsigned i = 0; i < n; ++i, ++it)
+		STLVertexWelder* welder = range.welder;
+		for (unsigned i = range.first; i < range.first + range.count; ++i)
 		{
-			it->point = cell.points->getPointPersistentPtr(i);
-			it->pointIndex = cell.points->getPointGlobalIndex(i);
+			qint64 key[3];
+			welder->computeKey(welder->m_points[i], key);
+			welder->m_shardOf[i] = static_cast<unsigned char>(Hash(key) >> 60); //4 bits = 16 shards
 		}
-		nNSS.alreadyVisitedNeighbourhoodSize = 1;
 	}
 
-	//for each point in the cell
-	for (unsigned i = 0; i < n; ++i)
+	//! Resizes the table of a shard (and re-inserts the existing entries)
+	/** Must be called between two blocks (all the entries then point to welded vertices).
+	**/
+	static bool Rehash(Shard& shard, size_t newSize)
 	{
-		int thisIndex = static_cast<int>(cell.points->getPointGlobalIndex(i));
-		if (equivalentIndexes->getValue(thisIndex) < 0) //has no equivalent yet 
+		std::vector<unsigned> newTable;
+		try
+		{
+			newTable.resize(newSize, STL_WELDER_EMPTY_ENTRY);
+		}
+		catch (const std::bad_alloc&)
+		{
+			return false;
+		}
+
+		size_t mask = newSize - 1;
+		for (size_t i = 0; i < shard.table.size(); ++i)
 		{
-			cell.points->getPoint(i, nNSS.queryPoint);
+			unsigned e = shard.table[i];
+			if (e == STL_WELDER_EMPTY_ENTRY)
+				continue;
+			qint64 key[3];
+			shard.welder->computeKey(*shard.welder->entryVertex(e), key);
+			size_t pos = static_cast<size_t>(Hash(key)) & mask;
+			while (newTable[pos] != STL_WELDER_EMPTY_ENTRY)
+				pos = (pos + 1) & mask;
+			newTable[pos] = e;
+		}
 
-			//look for neighbors in a (very small) sphere
-			//warning: there may be more points at the end of nNSS.pointsInNeighbourhood than the actual nearest neighbors (k)!
-			unsigned k = cell.parentOctree->findNeighborsInASphereStartingFromCell(nNSS, c_defaultSearchRadius, false);
+		shard.table.swap(newTable);
+		return true;
+	}
 
-			//if there are some very close points
-			if (k > 1)
+	//! Looks for (or inserts) the vertices of a shard
+	static void FillShard(Shard* shard)
+	{
+		STLVertexWelder* welder = shard->welder;
+
+		//we keep the load factor below 1/2 (the table must not be resized while the block is processed)
+		size_t blockCount = 0;
+		for (unsigned i = 0; i < shard->blockSize; ++i)
+		{
+			if (welder->m_shardOf[i] == shard->index)
+				++blockCount;
+		}
+		if ((shard->count + blockCount) * 2 > shard->table.size())
+		{
+			size_t newSize = std::max<size_t>(1024, shard->table.size());
+			while ((shard->count + blockCount) * 2 > newSize)
+				newSize *= 2;
+			if (!Rehash(*shard, newSize))
 			{
-				for (unsigned j = 0; j < k; ++j)
+				shard->error = true;
+				return;
+			}
+		}
+
+		size_t mask = shard->table.size() - 1;
+		for (unsigned i = 0; i < shard->blockSize; ++i)
+		{
+			if (welder->m_shardOf[i] != shard->index)
+				continue;
+
+			qint64 key[3];
+			welder->computeKey(welder->m_points[i], key);
+
+			size_t pos = static_cast<size_t>(Hash(key)) & mask;
+			while (true)
+			{
+				unsigned& e = shard->table[pos];
+				if (e == STL_WELDER_EMPTY_ENTRY)
+				{
+					//new vertex
+					try
+					{
+						shard->newEntries.push_back(pos);
+					}
+					catch (const std::bad_alloc&)
+					{
+						shard->error = true;
+						return;
+					}
+					e = (i | STL_WELDER_BLOCK_FLAG);
+					++shard->count;
+					welder->m_refs[i] = e;
+					break;
+				}
+
+				qint64 otherKey[3];
+				welder->computeKey(*welder->entryVertex(e), otherKey);
+				if (otherKey[0] == key[0] && otherKey[1] == key[1] && otherKey[2] == key[2])
 				{
-					//all the other points are equivalent to the query point
-					const unsigned& otherIndex = nNSS.pointsInNeighbourhood[j].pointIndex;
-					if (static_cast<int>(otherIndex) != thisIndex)
-						equivalentIndexes->setValue(otherIndex, thisIndex);
+					//existing vertex
+					welder->m_refs[i] = e;
+					break;
 				}
+				pos = (pos + 1) & mask;
 			}
-
-			//and the query point is always root
-			equivalentIndexes->setValue(thisIndex, thisIndex);
 		}
+	}
+
+	//! Welding step
+	PointCoordinateType m_step;
+	//! Number of (welded) vertices
+	unsigned m_vertexCount;
+	//! Welded vertices
+	const ccPointCloud* m_vertices;
+	//! Index of each welded vertex in m_vertices (optional)
+	const std::vector<unsigned>* m_rootIndexes;
+	//! Shards
+	Shard m_shards[STL_WELDER_SHARD_COUNT];
+
+	//! Current block of vertices
+	const CCVector3* m_points;
+	//! Shard of each vertex of the current block
+	std::vector<unsigned char> m_shardOf;
+	//! Hash map entry found (or created) for each vertex of the current block
+	std::vector<unsigned> m_refs;
+};
+
+//! Welds the (unshared) vertices of a mesh in place
+/** Triangles that collapse after welding are removed.
+**/
+static bool WeldVertices(ccMesh* mesh, ccPointCloud* vertices, ccProgressDialog* pDlg)
+{
+	unsigned vertCount = vertices->size();
+	unsigned faceCount = mesh->size();
+
+	//the points are processed chunk by chunk (so that they are stored contiguously)
+	static const unsigned WELD_BLOCK_SIZE = MAX_NUMBER_OF_ELEMENTS_PER_CHUNK;
+
+	CCLib::NormalizedProgress nProgress(pDlg, (vertCount + WELD_BLOCK_SIZE - 1) / WELD_BLOCK_SIZE);
+	if (pDlg)
+	{
+		pDlg->setMethodTitle(QObject::tr("STL file"));
+		pDlg->setInfo(QObject::tr("Welding vertices"));
+		pDlg->start();
+		QApplication::processEvents();
+	}
+
+	//new index of each (original) vertex
+	std::vector<unsigned> newIndexes;
+	//original index of each welded vertex
+	std::vector<unsigned> rootIndexes;
+	std::vector<unsigned> indexes, newVertices;
+	try
+	{
+		newIndexes.resize(vertCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	STLVertexWelder welder(c_defaultWeldingStep, vertices, &rootIndexes);
+	for (unsigned first = 0; first < vertCount; first += WELD_BLOCK_SIZE)
+	{
+		unsigned count = std::min(WELD_BLOCK_SIZE, vertCount - first);
 
-		if (nProgress && !nProgress->oneStep())
+		if (!welder.weld(vertices->getPointPersistentPtr(first), count, indexes, newVertices))
+			return false;
+
+		try
+		{
+			for (size_t k = 0; k < newVertices.size(); ++k)
+				rootIndexes.push_back(first + newVertices[k]);
+		}
+		catch (const std::bad_alloc&)
 		{
 			return false;
 		}
+		for (unsigned i = 0; i < count; ++i)
+			newIndexes[first + i] = indexes[i];
+
+		if (pDlg && !nProgress.oneStep())
+			return false;
+	}
+
+	//very small triangles (or flat ones) may be implicitly removed by vertex fusion!
+	unsigned newFaceCount = 0;
+	for (unsigned i = 0; i < faceCount; ++i)
+	{
+		const CCLib::VerticesIndexes* tri = mesh->getTriangleVertIndexes(i);
+		unsigned i1 = newIndexes[tri->i1];
+		unsigned i2 = newIndexes[tri->i2];
+		unsigned i3 = newIndexes[tri->i3];
+		if (i1 != i2 && i1 != i3 && i2 != i3)
+			++newFaceCount;
+	}
+	if (newFaceCount == 0)
+	{
+		ccLog::Warning("[STL] After vertex fusion, all triangles would collapse! We'll keep the non-fused version...");
+		return false;
+	}
+
+	//copy root points (in place, as rootIndexes[k] >= k)
+	for (size_t k = 0; k < rootIndexes.size(); ++k)
+	{
+		if (rootIndexes[k] != k)
+			*const_cast<CCVector3*>(vertices->getPointPersistentPtr(static_cast<unsigned>(k))) = *vertices->getPoint(rootIndexes[k]);
+	}
+	vertices->resize(welder.vertexCount());
+
+	//update face indexes
+	newFaceCount = 0;
+	for (unsigned i = 0; i < faceCount; ++i)
+	{
+		CCLib::VerticesIndexes* tri = mesh->getTriangleVertIndexes(i);
+		tri->i1 = newIndexes[tri->i1];
+		tri->i2 = newIndexes[tri->i2];
+		tri->i3 = newIndexes[tri->i3];
+
+		if (tri->i1 != tri->i2 && tri->i1 != tri->i3 && tri->i2 != tri->i3)
+		{
+			if (newFaceCount != i)
+				mesh->swapTriangles(i, newFaceCount);
+			++newFaceCount;
+		}
 	}
+	mesh->resize(newFaceCount);
 
 	return true;
 }
@@ -407,127 +802,6 @@ CC_FILE_ERROR STLFilter::loadFile(QString filename, ccHObject& container, LoadPa
 			normals->shrinkToFit();
 	}
 
-	//remove duplicated vertices
-	//if (false)
-	{
-		GenericChunkedArray<1, int>* equivalentIndexes = new GenericChunkedArray < 1, int > ;
-		const int razValue = -1;
-		if (equivalentIndexes && equivalentIndexes->resize(vertCount, true, razValue))
-		{
-			ccProgressDialog pDlg(true, parameters.parentWidget);
-			ccOctree::Shared octree = ccOctree::Shared(new ccOctree(vertices));
-			if (!octree->build(parameters.parentWidget ? &pDlg : 0))
-			{
-				octree.clear();
-			}
-			if (octree)
-			{
-				void* additionalParameters[] = { static_cast<void*>(equivalentIndexes) };
-				unsigned result = octree->executeFunctionForAllCellsAtLevel(10,
-					TagDuplicatedVertices,
-					additionalParameters,
-					false,
-					parameters.parentWidget ? &pDlg : 0,
-					"Tag duplicated vertices");
-
-				octree.clear();
-
-				if (result != 0)
-				{
-					unsigned remainingCount = 0;
-					for (unsigned i = 0; i < vertCount; ++i)
-					{
-						int eqIndex = equivalentIndexes->getValue(i);
-						assert(eqIndex >= 0);
-						if (eqIndex == static_cast<int>(i)) //root point
-						{
-							int newIndex = static_cast<int>(vertCount + remainingCount); //We replace the root index by its 'new' index (+ vertCount, to differentiate it later)
-							equivalentIndexes->setValue(i, newIndex);
-							++remainingCount;
-						}
-					}
-
-					ccPointCloud* newVertices = new ccPointCloud("vertices");
-					if (newVertices->reserve(remainingCount))
-					{
-						//copy root points in a new cloud
-						{
-							for (unsigned i = 0; i < vertCount; ++i)
-							{
-								int eqIndex = equivalentIndexes->getValue(i);
-								if (eqIndex >= static_cast<int>(vertCount)) //root point
-									newVertices->addPoint(*vertices->getPoint(i));
-								else
-									equivalentIndexes->setValue(i, equivalentIndexes->getValue(eqIndex)); //and update the other indexes
-							}
-						}
-
-						//update face indexes
-						{
-							unsigned newFaceCount = 0;
-							for (unsigned i = 0; i < faceCount; ++i)
-							{
-								CCLib::VerticesIndexes* tri = mesh->getTriangleVertIndexes(i);
-								tri->i1 = static_cast<unsigned>(equivalentIndexes->getValue(tri->i1)) - vertCount;
-								tri->i2 = static_cast<unsigned>(equivalentIndexes->getValue(tri->i2)) - vertCount;
-								tri->i3 = static_cast<unsigned>(equivalentIndexes->getValue(tri->i3)) - vertCount;
-
-								//very small triangles (or flat ones) may be implicitly removed by vertex fusion!
-								if (tri->i1 != tri->i2 && tri->i1 != tri->i3 && tri->i2 != tri->i3)
-								{
-									if (newFaceCount != i)
-										mesh->swapTriangles(i, newFaceCount);
-									++newFaceCount;
-								}
-							}
-
-							if (newFaceCount == 0)
-							{
-								ccLog::Warning("[STL] After vertex fusion, all triangles would collapse! We'll keep the non-fused version...");
-								delete newVertices;
-								newVertices = 0;
-							}
-							else
-							{
-								mesh->resize(newFaceCount);
-							}
-						}
-
-						if (newVertices)
-						{
-							mesh->setAssociatedCloud(newVertices);
-							delete vertices;
-							vertices = newVertices;
-							vertCount = vertices->size();
-							ccLog::Print("[STL] Remaining vertices after auto-removal of duplicate ones: %i", vertCount);
-							ccLog::Print("[STL] Remaining faces after auto-removal of duplicate ones: %i", mesh->size());
-						}
-					}
-					else
-					{
-						ccLog::Warning("[STL] Not enough memory: couldn't removed duplicated vertices!");
-					}
-				}
-				else
-				{
-					ccLog::Warning("[STL] Duplicated vertices removal algorithm failed?!");
-				}
-			}
-			else
-			{
-				ccLog::Warning("[STL] Not enough memory: couldn't removed duplicated vertices!");
-			}
-		}
-		else
-		{
-			ccLog::Warning("[STL] Not enough memory: couldn't removed duplicated vertices!");
-		}
-
-		if (equivalentIndexes)
-			equivalentIndexes->release();
-		equivalentIndexes = 0;
-	}
-
 	NormsIndexesTableType* normals = mesh->getTriNormsTable();
 	if (normals)
 	{
@@ -554,311 +828,345 @@ CC_FILE_ERROR STLFilter::loadFile(QString filename, ccHObject& container, LoadPa
 	return CC_FERR_NO_ERROR;
 }
 
-CC_FILE_ERROR STLFilter::loadASCIIFile(QFile& fp,
-	ccMesh* mesh,
-	ccPointCloud* vertices,
-	LoadParameters& parameters)
+//! Returns the beginning of the next non-empty line (or 'end')
+static const char* GetNextSTLLine(const char* p, const char* end)
 {
-	assert(fp.isOpen() && mesh && vertices);
+	while (p != end && ccMappedTextFile::IsLineEnd(p, end))
+		p = ccMappedTextFile::NextLine(p, end);
+	return ccMappedTextFile::SkipBlanks(p, end);
+}
 
-	//text stream
-	QTextStream stream(&fp);
+//! Chunk of an ASCII STL file (parsed in parallel)
+/** Chunks always start with a 'facet' line.
+**/
+struct STLChunk
+{
+	ccMappedTextFile::Chunk range;
+	//! index of the first facet of the chunk
+	unsigned firstFacet;
+	//! number of facets in the chunk
+	unsigned facetCount;
+	//! whether the 'endsolid' keyword was met in this chunk
+	bool endReached;
+	//! whether some normals couldn't be read
+	bool normalWarning;
+	//! error position (if any)
+	const char* errorPos;
+	//! error message (if any)
+	const char* errorMsg;
+
+	//shared parameters
+	CCVector3d Pshift;
+	ccPointCloud* vertices;
+	ccMesh* mesh;
+	NormsIndexesTableType* normals;
+};
+
+//! Pass 1: counts the facets of a chunk
+static void CountSTLFacets(STLChunk& chunk)
+{
+	chunk.facetCount = 0;
+	chunk.endReached = false;
 
-	//1st line: 'solid name'
-	QString name("mesh");
+	const char* end = chunk.range.end;
+	for (const char* p = chunk.range.begin; p != end; p = ccMappedTextFile::NextLine(p, end))
 	{
-		QString currentLine = stream.readLine();
-		if (currentLine.isEmpty() || fp.error() != QFile::NoError)
+		p = ccMappedTextFile::SkipBlanks(p, end);
+		if (ccMappedTextFile::TokenIs(p, end, "facet"))
 		{
-			return CC_FERR_READING;
-		}
-		QStringList tokens = currentLine.split(QRegExp("\\s+"), QString::SkipEmptyParts);
-		if (tokens.empty() || tokens[0].toUpper() != "SOLID")
-		{
-			ccLog::Warning("[STL] File should begin by 'solid [name]'!");
-			return CC_FERR_MALFORMED_FILE;
+			++chunk.facetCount;
 		}
-		//Extract name
-		if (tokens.size() > 1)
+		else if (ccMappedTextFile::TokenIs(p, end, "endsolid"))
 		{
-			tokens.removeAt(0);
-			name = tokens.join(" ");
+			chunk.endReached = true;
+			chunk.range.end = p;
+			break;
 		}
 	}
-	mesh->setName(name);
-
-	//progress dialog
-	ccProgressDialog pDlg(true, parameters.parentWidget);
-	if (parameters.parentWidget)
-	{
-		pDlg.setMethodTitle(QObject::tr("(ASCII) STL file"));
-		pDlg.setInfo(QObject::tr("Loading in progress..."));
-		pDlg.setRange(0, 0);
-		pDlg.start();
-		QApplication::processEvents();
-	}
-
-	//current vertex shift
-	CCVector3d Pshift(0, 0, 0);
-
-	unsigned pointCount = 0;
-	unsigned faceCount = 0;
-	bool normalWarningAlreadyDisplayed = false;
-	NormsIndexesTableType* normals = mesh->getTriNormsTable();
+}
 
-	CC_FILE_ERROR result = CC_FERR_NO_ERROR;
+//! Pass 2: reads the facets of a chunk
+static void ReadSTLFacets(STLChunk& chunk)
+{
+	chunk.normalWarning = false;
+	chunk.errorPos = 0;
+	chunk.errorMsg = 0;
 
-	unsigned lineCount = 1;
-	while (true)
+	const char* end = chunk.range.end;
+	const char* p = chunk.range.begin;
+	for (unsigned f = 0; f < chunk.facetCount; ++f)
 	{
-		CCVector3 N;
-		bool normalIsOk = false;
+		unsigned facetIndex = chunk.firstFacet + f;
 
-		//1st line of a 'facet': "facet normal ni nj nk" / or 'endsolid' (i.e. end of file)
+		//1st line of a 'facet': "facet normal ni nj nk"
+		p = GetNextSTLLine(p, end);
+		if (!ccMappedTextFile::TokenIs(p, end, "facet"))
 		{
-			QString currentLine = stream.readLine();
-			if (currentLine.isEmpty())
-			{
-				break;
-			}
-			else if (fp.error() != QFile::NoError)
-			{
-				result = CC_FERR_READING;
-				break;
-			}
-			++lineCount;
-
-			QStringList tokens = currentLine.split(QRegExp("\\s+"), QString::SkipEmptyParts);
-			if (tokens.empty() || tokens[0].toUpper() != "FACET")
+			chunk.errorPos = p;
+			chunk.errorMsg = "line should start by 'facet'";
+			return;
+		}
+		{
+			const char* c = ccMappedTextFile::SkipBlanks(ccMappedTextFile::TokenEnd(p, end), end);
+			if (!ccMappedTextFile::IsLineEnd(c, end))
 			{
-				if (tokens[0].toUpper() != "ENDSOLID")
+				bool normalIsOk = false;
+				CCVector3d N;
+				if (ccMappedTextFile::TokenIs(c, end, "normal"))
 				{
-					ccLog::Warning("[STL] Error on line #%i: line should start by 'facet'!", lineCount);
-					return CC_FERR_MALFORMED_FILE;
+					c = ccMappedTextFile::TokenEnd(c, end);
+					normalIsOk =	ccMappedTextFile::ParseDouble(c, end, N.x)
+								&&	ccMappedTextFile::ParseDouble(c, end, N.y)
+								&&	ccMappedTextFile::ParseDouble(c, end, N.z);
 				}
-				break;
-			}
 
-			if (normals && tokens.size() >= 5)
-			{
-				//let's try to read normal
-				if (tokens[1].toUpper() == "NORMAL")
+				if (normalIsOk)
 				{
-					N.x = static_cast<PointCoordinateType>(tokens[2].toDouble(&normalIsOk));
-					if (normalIsOk)
+					if (chunk.normals)
 					{
-						N.y = static_cast<PointCoordinateType>(tokens[3].toDouble(&normalIsOk));
-						if (normalIsOk)
-						{
-							N.z = static_cast<PointCoordinateType>(tokens[4].toDouble(&normalIsOk));
-						}
-					}
-					if (!normalIsOk && !normalWarningAlreadyDisplayed)
-					{
-						ccLog::Warning("[STL] Error on line #%i: failed to read 'normal' values!", lineCount);
-						normalWarningAlreadyDisplayed = true;
+						CCVector3 Nf = CCVector3::fromArray(N.u);
+						chunk.normals->setValue(facetIndex, ccNormalVectors::GetNormIndex(Nf.u));
+						int index = static_cast<int>(facetIndex);
+						chunk.mesh->setTriangleNormalIndexes(facetIndex, index, index, index);
 					}
 				}
-				else if (!normalWarningAlreadyDisplayed)
+				else
 				{
-					ccLog::Warning("[STL] Error on line #%i: expecting 'normal' after 'facet'!", lineCount);
-					normalWarningAlreadyDisplayed = true;
+					chunk.normalWarning = true;
 				}
 			}
-			else if (tokens.size() > 1 && !normalWarningAlreadyDisplayed)
-			{
-				ccLog::Warning("[STL] Error on line #%i: incomplete 'normal' description!", lineCount);
-				normalWarningAlreadyDisplayed = true;
-			}
 		}
+		p = ccMappedTextFile::NextLine(p, end);
 
 		//2nd line: 'outer loop'
+		p = GetNextSTLLine(p, end);
+		if (!ccMappedTextFile::StartsWith(p, end, "outer loop"))
 		{
-			QString currentLine = stream.readLine();
-			if (currentLine.isEmpty()
-				|| fp.error() != QFile::NoError
-				|| !QString(currentLine).trimmed().toUpper().startsWith("OUTER LOOP"))
-			{
-				ccLog::Warning("[STL] Error: expecting 'outer loop' on line #%i", lineCount + 1);
-				result = CC_FERR_READING;
-				break;
-			}
-			++lineCount;
+			chunk.errorPos = p;
+			chunk.errorMsg = "expecting 'outer loop'";
+			return;
 		}
+		p = ccMappedTextFile::NextLine(p, end);
 
 		//3rd to 5th lines: 'vertex vix viy viz'
-		unsigned vertIndexes[3];
-		//unsigned pointCountBefore = pointCount;
 		for (unsigned i = 0; i < 3; ++i)
 		{
-			QString currentLine = stream.readLine();
-			if (currentLine.isEmpty()
-				|| fp.error() != QFile::NoError
-				|| !QString(currentLine).trimmed().toUpper().startsWith("VERTEX"))
-			{
-				ccLog::Warning("[STL] Error: expecting a line starting by 'vertex' on line #%i", lineCount + 1);
-				result = CC_FERR_MALFORMED_FILE;
-				break;
-			}
-			++lineCount;
-
-			QStringList tokens = QString(currentLine).split(QRegExp("\\s+"), QString::SkipEmptyParts);
-			if (tokens.size() < 4)
+			p = GetNextSTLLine(p, end);
+			if (!ccMappedTextFile::TokenIs(p, end, "vertex"))
 			{
-				ccLog::Warning("[STL] Error on line #%i: incomplete 'vertex' description!", lineCount);
-				result = CC_FERR_MALFORMED_FILE;
-				break;
-			}
-
-			//read vertex
-			CCVector3d Pd(0, 0, 0);
-			{
-				bool vertexIsOk = false;
-				Pd.x = tokens[1].toDouble(&vertexIsOk);
-				if (vertexIsOk)
-				{
-					Pd.y = tokens[2].toDouble(&vertexIsOk);
-					if (vertexIsOk)
-						Pd.z = tokens[3].toDouble(&vertexIsOk);
-				}
-				if (!vertexIsOk)
-				{
-					ccLog::Warning("[STL] Error on line #%i: failed to read 'vertex' coordinates!", lineCount);
-					result = CC_FERR_MALFORMED_FILE;
-					break;
-				}
+				chunk.errorPos = p;
+				chunk.errorMsg = "expecting a line starting by 'vertex'";
+				return;
 			}
 
-			//first point: check for 'big' coordinates
-			if (pointCount == 0)
+			CCVector3d Pd;
+			const char* c = ccMappedTextFile::TokenEnd(p, end);
+			if (	!ccMappedTextFile::ParseDouble(c, end, Pd.x)
+				||	!ccMappedTextFile::ParseDouble(c, end, Pd.y)
+				||	!ccMappedTextFile::ParseDouble(c, end, Pd.z) )
 			{
-				if (HandleGlobalShift(Pd, Pshift, parameters))
-				{
-					vertices->setGlobalShift(Pshift);
-					ccLog::Warning("[STLFilter::loadFile] Cloud has been recentered! Translation: (%.2f ; %.2f ; %.2f)", Pshift.x, Pshift.y, Pshift.z);
-				}
+				chunk.errorPos = p;
+				chunk.errorMsg = "failed to read 'vertex' coordinates";
+				return;
 			}
 
-			CCVector3 P = CCVector3::fromArray((Pd + Pshift).u);
+			*const_cast<CCVector3*>(chunk.vertices->getPointPersistentPtr(3 * facetIndex + i)) = CCVector3::fromArray((Pd + chunk.Pshift).u);
+			p = ccMappedTextFile::NextLine(p, end);
+		}
 
-			//look for existing vertices at the same place! (STL format is so dumb...)
-			{
-				//int equivalentIndex = -1;
-				//if (pointCount>2)
-				//{
-				//	//brute force!
-				//	for (int j=(int)pointCountBefore-1; j>=0; j--)
-				//	{
-				//		const CCVector3* Pj = vertices->getPoint(j);
-				//		if (Pj->x == P.x &&
-				//			Pj->y == P.y &&
-				//			Pj->z == P.z)
-				//		{
-				//			equivalentIndex = j;
-				//			break;
-				//		}
-				//	}
-				//}
-
-				////new point ?
-				//if (equivalentIndex < 0)
-				{
-					//cloud is already full?
-					if (vertices->capacity() == pointCount && !vertices->reserve(pointCount + 1000))
-						return CC_FERR_NOT_ENOUGH_MEMORY;
+		CCLib::VerticesIndexes* tsi = chunk.mesh->getTriangleVertIndexes(facetIndex);
+		tsi->i1 = 3 * facetIndex;
+		tsi->i2 = 3 * facetIndex + 1;
+		tsi->i3 = 3 * facetIndex + 2;
 
-					//insert new point
-					vertIndexes[i] = pointCount++;
-					vertices->addPoint(P);
-				}
-				//else
-				//{
-				//	vertIndexes[i] = (unsigned)equivalentIndex;
-				//}
-			}
+		//6th line: 'endloop'
+		p = GetNextSTLLine(p, end);
+		if (!ccMappedTextFile::TokenIs(p, end, "endloop"))
+		{
+			chunk.errorPos = p;
+			chunk.errorMsg = "expecting 'endloop'";
+			return;
 		}
+		p = ccMappedTextFile::NextLine(p, end);
 
-		//we have successfully read the 3 vertices
-		//let's add a new triangle
+		//7th and last line: 'endfacet'
+		p = GetNextSTLLine(p, end);
+		if (!ccMappedTextFile::TokenIs(p, end, "endfacet"))
 		{
-			//mesh is full?
-			if (mesh->capacity() == faceCount)
-			{
-				if (!mesh->reserve(faceCount + 1000))
-				{
-					result = CC_FERR_NOT_ENOUGH_MEMORY;
-					break;
-				}
+			chunk.errorPos = p;
+			chunk.errorMsg = "expecting 'endfacet'";
+			return;
+		}
+		p = ccMappedTextFile::NextLine(p, end);
+	}
+}
 
-				if (normals)
-				{
-					bool success = normals->reserve(mesh->capacity());
-					if (success && faceCount == 0) //specific case: allocate per triangle normal indexes the first time!
-						success = mesh->reservePerTriangleNormalIndexes();
+CC_FILE_ERROR STLFilter::loadASCIIFile(QFile& fp,
+	ccMesh* mesh,
+	ccPointCloud* vertices,
+	LoadParameters& parameters)
+{
+	assert(fp.isOpen() && mesh && vertices);
 
-					if (!success)
-					{
-						ccLog::Warning("[STL] Not enough memory: can't store normals!");
-						mesh->removePerTriangleNormalIndexes();
-						mesh->setTriNormsTable(0);
-						normals = 0;
-					}
-				}
-			}
+	//we map the file in memory (instead of reading it line by line)
+	ccMappedTextFile file;
+	if (!file.open(fp.fileName()))
+	{
+		return CC_FERR_READING;
+	}
+	const char* begin = file.begin();
+	const char* end = file.end();
 
-			mesh->addTriangle(vertIndexes[0], vertIndexes[1], vertIndexes[2]);
-			++faceCount;
+	//1st line: 'solid name'
+	QString name("mesh");
+	{
+		const char* p = ccMappedTextFile::SkipBlanks(begin, end);
+		if (!ccMappedTextFile::TokenIs(p, end, "solid"))
+		{
+			ccLog::Warning("[STL] File should begin by 'solid [name]'!");
+			return CC_FERR_MALFORMED_FILE;
 		}
-
-		//and a new normal?
-		if (normals)
+		//Extract name
+		p = ccMappedTextFile::TokenEnd(p, end);
+		QString solidName = QString::fromLocal8Bit(p, static_cast<int>(ccMappedTextFile::LineEnd(p, end) - p)).simplified();
+		if (!solidName.isEmpty())
 		{
-			int index = -1;
-			if (normalIsOk)
-			{
-				//compress normal
-				index = static_cast<int>(normals->currentSize());
-				CompressedNormType nIndex = ccNormalVectors::GetNormIndex(N.u);
-				normals->addElement(nIndex);
-			}
-			mesh->addTriangleNormalIndexes(index, index, index);
+			name = solidName;
 		}
+	}
+	mesh->setName(name);
 
-		//6th line: 'endloop'
+	//progress dialog
+	QScopedPointer<ccProgressDialog> pDlg(parameters.parentWidget ? new ccProgressDialog(true, parameters.parentWidget) : 0);
+	if (parameters.parentWidget)
+	{
+		pDlg->setMethodTitle(QObject::tr("(ASCII) STL file"));
+		pDlg->setInfo(QObject::tr("Loading in progress..."));
+		pDlg->setRange(0, 0);
+		pDlg->start();
+		QApplication::processEvents();
+	}
+
+	//split the facets in chunks
+	const char* dataBegin = GetNextSTLLine(ccMappedTextFile::NextLine(begin, end), end);
+	std::vector<ccMappedTextFile::Chunk> ranges = ccMappedTextFile::Split(dataBegin, end, "facet");
+	std::vector<STLChunk> chunks;
+	try
+	{
+		chunks.resize(ranges.size());
+	}
+	catch (const std::bad_alloc&)
+	{
+		return CC_FERR_NOT_ENOUGH_MEMORY;
+	}
+	for (size_t i = 0; i < chunks.size(); ++i)
+	{
+		chunks[i].range = ranges[i];
+	}
+
+	//pass 1: count the facets
+	if (!ccMappedTextFile::ProcessInParallel(chunks, CountSTLFacets, pDlg.data()))
+	{
+		return CC_FERR_CANCELED_BY_USER;
+	}
+	unsigned faceCount = 0;
+	{
+		for (size_t i = 0; i < chunks.size(); ++i)
 		{
-			QString currentLine = stream.readLine();
-			if (currentLine.isEmpty()
-				|| fp.error() != QFile::NoError
-				|| !QString(currentLine).trimmed().toUpper().startsWith("ENDLOOP"))
+			chunks[i].firstFacet = faceCount;
+			faceCount += chunks[i].facetCount;
+			if (chunks[i].endReached)
 			{
-				ccLog::Warning("[STL] Error: expecting 'endnloop' on line #%i", lineCount + 1);
-				result = CC_FERR_MALFORMED_FILE;
+				//ignore everything after 'endsolid'
+				chunks.resize(i + 1);
 				break;
 			}
-			++lineCount;
 		}
+	}
 
-		//7th and last line: 'endfacet'
+	if (faceCount == 0)
+	{
+		//empty solid
+		return CC_FERR_NO_ERROR;
+	}
+
+	//first point: check for 'big' coordinates
+	CCVector3d Pshift(0, 0, 0);
+	{
+		const char* p = dataBegin;
+		while (p != end && !ccMappedTextFile::TokenIs(ccMappedTextFile::SkipBlanks(p, end), end, "vertex"))
 		{
-			QString currentLine = stream.readLine();
-			if (currentLine.isEmpty()
-				|| fp.error() != QFile::NoError
-				|| !QString(currentLine).trimmed().toUpper().startsWith("ENDFACET"))
+			p = ccMappedTextFile::NextLine(p, end);
+		}
+		CCVector3d Pd;
+		const char* c = ccMappedTextFile::TokenEnd(ccMappedTextFile::SkipBlanks(p, end), end);
+		if (	ccMappedTextFile::ParseDouble(c, end, Pd.x)
+			&&	ccMappedTextFile::ParseDouble(c, end, Pd.y)
+			&&	ccMappedTextFile::ParseDouble(c, end, Pd.z) )
+		{
+			if (HandleGlobalShift(Pd, Pshift, parameters))
 			{
-				ccLog::Warning("[STL] Error: expecting 'endfacet' on line #%i", lineCount + 1);
-				result = CC_FERR_MALFORMED_FILE;
-				break;
+				vertices->setGlobalShift(Pshift);
+				ccLog::Warning("[STLFilter::loadFile] Cloud has been recentered! Translation: (%.2f ; %.2f ; %.2f)", Pshift.x, Pshift.y, Pshift.z);
 			}
-			++lineCount;
 		}
+	}
 
-		//progress
-		if (parameters.parentWidget && (faceCount % 1024) == 0)
+	//reserve memory (3 vertices per facet)
+	if (	faceCount > std::numeric_limits<unsigned>::max() / 3
+		||	!vertices->resize(3 * faceCount)
+		||	!mesh->reserve(faceCount))
+	{
+		return CC_FERR_NOT_ENOUGH_MEMORY;
+	}
+	NormsIndexesTableType* normals = mesh->getTriNormsTable();
+	if (normals)
+	{
+		//one normal per facet (only valid normals are referenced by the triangles)
+		if (!normals->resize(faceCount, true, 0) || !mesh->reservePerTriangleNormalIndexes())
 		{
-			if (pDlg.wasCanceled())
-				break;
-			pDlg.setValue(static_cast<int>(faceCount >> 10));
+			ccLog::Warning("[STL] Not enough memory: can't store normals!");
+			mesh->removePerTriangleNormalIndexes();
+			mesh->setTriNormsTable(0);
+			normals = 0;
+		}
+	}
+	if (!mesh->resize(faceCount))
+	{
+		return CC_FERR_NOT_ENOUGH_MEMORY;
+	}
+
+	//pass 2: read the facets
+	for (size_t i = 0; i < chunks.size(); ++i)
+	{
+		STLChunk& chunk = chunks[i];
+		chunk.Pshift = Pshift;
+		chunk.vertices = vertices;
+		chunk.mesh = mesh;
+		chunk.normals = normals;
+	}
+	if (!ccMappedTextFile::ProcessInParallel(chunks, ReadSTLFacets, pDlg.data()))
+	{
+		return CC_FERR_CANCELED_BY_USER;
+	}
+
+	if (parameters.parentWidget)
+	{
+		pDlg->close();
+	}
+
+	bool normalWarningAlreadyDisplayed = false;
+	for (size_t i = 0; i < chunks.size(); ++i)
+	{
+		const STLChunk& chunk = chunks[i];
+		if (chunk.errorPos)
+		{
+			//we only compute the line number in case of error
+			int lineNumber = 1 + static_cast<int>(std::count(begin, chunk.errorPos, '\n'));
+			ccLog::Warning("[STL] Error on line #%i: %s!", lineNumber, chunk.errorMsg);
+			return CC_FERR_MALFORMED_FILE;
 		}
+		normalWarningAlreadyDisplayed |= chunk.normalWarning;
 	}
 
 	if (normalWarningAlreadyDisplayed)
@@ -866,12 +1174,73 @@ CC_FILE_ERROR STLFilter::loadASCIIFile(QFile& fp,
 		ccLog::Warning("[STL] Failed to read some 'normal' values!");
 	}
 
+	//remove duplicated vertices (STL format is so dumb...)
+	if (WeldVertices(mesh, vertices, pDlg.data()))
+	{
+		ccLog::Print("[STL] Remaining vertices after auto-removal of duplicate ones: %i", vertices->size());
+		ccLog::Print("[STL] Remaining faces after auto-removal of duplicate ones: %i", mesh->size());
+	}
+	else
+	{
+		ccLog::Warning("[STL] Duplicated vertices couldn't be removed!");
+	}
+
 	if (parameters.parentWidget)
 	{
-		pDlg.close();
+		pDlg->close();
 	}
 
-	return result;
+	return CC_FERR_NO_ERROR;
+}
+
+//! Size of a binary STL facet record (in bytes)
+static const unsigned STL_BINARY_FACET_SIZE = 50;
+
+//! Block of binary STL facets (decoded in parallel)
+struct STLBinaryBlock
+{
+	//! facet records
+	const char* data;
+	//! number of facets
+	unsigned count;
+	//! output vertices (3 per facet)
+	CCVector3* points;
+	//! output (compressed) normals (one per facet, optional)
+	CompressedNormType* normals;
+	//! global shift
+	CCVector3d Pshift;
+};
+
+//! Decodes a block of binary STL facets
+static void DecodeSTLBinaryBlock(STLBinaryBlock& block)
+{
+	assert(sizeof(float) == 4);
+	for (unsigned f = 0; f < block.count; ++f)
+	{
+		const char* record = block.data + static_cast<size_t>(f) * STL_BINARY_FACET_SIZE;
+
+		//REAL32[3] Normal vector
+		if (block.normals)
+		{
+			float Nf[3];
+			memcpy(Nf, record, 12);
+			CCVector3 N(static_cast<PointCoordinateType>(Nf[0]),
+						static_cast<PointCoordinateType>(Nf[1]),
+						static_cast<PointCoordinateType>(Nf[2]));
+			block.normals[f] = ccNormalVectors::GetNormIndex(N.u);
+		}
+
+		//REAL32[3] Vertex 1,2 & 3
+		for (unsigned i = 0; i < 3; ++i)
+		{
+			float Pf[3];
+			memcpy(Pf, record + 12 * (i + 1), 12);
+			CCVector3d Pd(Pf[0], Pf[1], Pf[2]);
+			block.points[3 * f + i] = CCVector3::fromArray((Pd + block.Pshift).u);
+		}
+
+		//UINT16 Attribute byte count (not used)
+	}
 }
 
 CC_FILE_ERROR STLFilter::loadBinaryFile(QFile& fp,
@@ -881,7 +1250,6 @@ CC_FILE_ERROR STLFilter::loadBinaryFile(QFile& fp,
 {
 	assert(fp.isOpen() && mesh && vertices);
 
-	unsigned pointCount = 0;
 	unsigned faceCount = 0;
 
 	//UINT8[80] Header (we skip it)
@@ -904,44 +1272,74 @@ CC_FILE_ERROR STLFilter::loadBinaryFile(QFile& fp,
 		ccLog::Warning("[STL] Not enough memory: can't store normals!");
 		mesh->removePerTriangleNormalIndexes();
 		mesh->setTriNormsTable(0);
+		normals = 0;
 	}
 
+	//the vertices are welded on the fly: for a closed mesh there's roughly one vertex for two facets
+	if (!vertices->reserve(std::min(faceCount, faceCount / 2 + 3 * STL_BLOCK_SIZE)))
+		return CC_FERR_NOT_ENOUGH_MEMORY;
+
 	//progress dialog
-	ccProgressDialog pDlg(true, parameters.parentWidget);
-	CCLib::NormalizedProgress nProgress(&pDlg, faceCount);
+	QScopedPointer<ccProgressDialog> pDlg(parameters.parentWidget ? new ccProgressDialog(true, parameters.parentWidget) : 0);
+	CCLib::NormalizedProgress nProgress(pDlg.data(), (faceCount + STL_BLOCK_SIZE - 1) / STL_BLOCK_SIZE);
 	if (parameters.parentWidget)
 	{
-		pDlg.setMethodTitle(QObject::tr("Loading binary STL file"));
-		pDlg.setInfo(QObject::tr("Loading %1 faces").arg(faceCount));
-		pDlg.start();
+		pDlg->setMethodTitle(QObject::tr("Loading binary STL file"));
+		pDlg->setInfo(QObject::tr("Loading %1 faces").arg(faceCount));
+		pDlg->start();
 		QApplication::processEvents();
 	}
 
 	//current vertex shift
 	CCVector3d Pshift(0, 0, 0);
 
-	for (unsigned f = 0; f < faceCount; ++f)
+	//buffers (one block of facets at a time)
+	QByteArray buffer;
+	std::vector<CCVector3> points;
+	std::vector<CompressedNormType> facetNormals;
+	std::vector<unsigned> indexes, newVertices;
+	try
 	{
-		//REAL32[3] Normal vector
-		assert(sizeof(float) == 4);
-		CCVector3 N;
-		if (fp.read((char*)N.u, 12) < 12)
-			return CC_FERR_READING;
+		unsigned blockSize = std::min(faceCount, STL_BLOCK_SIZE);
+		buffer.resize(static_cast<int>(blockSize * STL_BINARY_FACET_SIZE));
+		points.resize(3 * blockSize);
+		if (normals)
+			facetNormals.resize(blockSize);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return CC_FERR_NOT_ENOUGH_MEMORY;
+	}
 
-		//3 vertices
-		unsigned vertIndexes[3];
-		//		unsigned pointCountBefore=pointCount;
-		for (unsigned i = 0; i < 3; ++i)
+	//if all the triangles collapse after vertex fusion, we load the non-fused version
+	bool weldVertices = true;
+	CC_FILE_ERROR result = CC_FERR_NO_ERROR;
+	while (true)
+	{
+		STLVertexWelder welder(c_defaultWeldingStep, vertices);
+		unsigned degeneratedCount = 0;
+		unsigned processedFacetCount = 0;
+
+		for (unsigned firstFacet = 0; firstFacet < faceCount; firstFacet += STL_BLOCK_SIZE)
 		{
-			//REAL32[3] Vertex 1,2 & 3
-			float Pf[3];
-			if (fp.read((char*)Pf, 12) < 0)
-				return CC_FERR_READING;
+			unsigned blockCount = std::min(STL_BLOCK_SIZE, faceCount - firstFacet);
 
-			//first point: check for 'big' coordinates
-			CCVector3d Pd(Pf[0], Pf[1], Pf[2]);
-			if (pointCount == 0)
+			//read the block
+			qint64 readBytes = fp.read(buffer.data(), static_cast<qint64>(blockCount) * STL_BINARY_FACET_SIZE);
+			if (readBytes < static_cast<qint64>(blockCount) * STL_BINARY_FACET_SIZE)
+			{
+				//truncated file: the complete facets of this block are still processed,
+				//but the error is returned (and the caller discards the mesh)
+				result = CC_FERR_READING;
+				blockCount = (readBytes > 0 ? static_cast<unsigned>(readBytes / STL_BINARY_FACET_SIZE) : 0);
+			}
+
+			//first point: check for 'big' coordinates (only once)
+			if (firstFacet == 0 && blockCount != 0 && weldVertices)
 			{
+				float Pf[3];
+				memcpy(Pf, buffer.constData() + 12, 12);
+				CCVector3d Pd(Pf[0], Pf[1], Pf[2]);
 				if (HandleGlobalShift(Pd, Pshift, parameters))
 				{
 					vertices->setGlobalShift(Pshift);
@@ -949,80 +1347,122 @@ CC_FILE_ERROR STLFilter::loadBinaryFile(QFile& fp,
 				}
 			}
 
-			CCVector3 P = CCVector3::fromArray((Pd + Pshift).u);
+			//decode the facets (in parallel)
+			{
+				static const unsigned SUB_BLOCK_SIZE = 4096;
+				std::vector<STLBinaryBlock> subBlocks;
+				for (unsigned f = 0; f < blockCount; f += SUB_BLOCK_SIZE)
+				{
+					STLBinaryBlock subBlock;
+					subBlock.data = buffer.constData() + static_cast<size_t>(f) * STL_BINARY_FACET_SIZE;
+					subBlock.count = std::min(SUB_BLOCK_SIZE, blockCount - f);
+					subBlock.points = &points[3 * f];
+					subBlock.normals = normals ? &facetNormals[f] : 0;
+					subBlock.Pshift = Pshift;
+					subBlocks.push_back(subBlock);
+				}
+				QtConcurrent::blockingMap(subBlocks, DecodeSTLBinaryBlock);
+			}
 
-			//look for existing vertices at the same place! (STL format is so dumb...)
+			if (weldVertices)
+			{
+				//look for existing vertices at the same place! (STL format is so dumb...)
+				if (blockCount != 0 && !welder.weld(&points[0], 3 * blockCount, indexes, newVertices))
+				{
+					return CC_FERR_NOT_ENOUGH_MEMORY;
+				}
+			}
+			else
 			{
-				//int equivalentIndex = -1;
-				//if (pointCount>2)
-				//{
-				//	//brute force!
-				//	for (int j=static_cast<int>(pointCountBefore)-1; j>=0; j--)
-				//	{
-				//		const CCVector3* Pj = vertices->getPoint(j);
-				//		if (Pj->x == P.x &&
-				//			Pj->y == P.y &&
-				//			Pj->z == P.z)
-				//		{
-				//			equivalentIndex = j;
-				//			break;
-				//		}
-				//	}
-				//}
-
-				////new point ?
-				//if (equivalentIndex < 0)
+				//all the vertices are new
+				try
+				{
+					indexes.resize(3 * blockCount);
+					newVertices.resize(3 * blockCount);
+				}
+				catch (const std::bad_alloc&)
+				{
+					return CC_FERR_NOT_ENOUGH_MEMORY;
+				}
+				for (unsigned i = 0; i < 3 * blockCount; ++i)
 				{
-					//cloud is already full?
-					if (vertices->capacity() == pointCount && !vertices->reserve(pointCount + 1000))
-						return CC_FERR_NOT_ENOUGH_MEMORY;
+					indexes[i] = vertices->size() + i;
+					newVertices[i] = i;
+				}
+			}
 
-					//insert new point
-					vertIndexes[i] = pointCount++;
-					vertices->addPoint(P);
+			//add the new vertices
+			if (vertices->size() + newVertices.size() > vertices->capacity())
+			{
+				unsigned newCapacity = std::max(vertices->size() + static_cast<unsigned>(newVertices.size()), vertices->capacity() + vertices->capacity() / 2);
+				if (!vertices->reserve(newCapacity))
+					return CC_FERR_NOT_ENOUGH_MEMORY;
+			}
+			for (size_t k = 0; k < newVertices.size(); ++k)
+			{
+				vertices->addPoint(points[newVertices[k]]);
+			}
+
+			//add the triangles
+			for (unsigned f = 0; f < blockCount; ++f)
+			{
+				unsigned i1 = indexes[3 * f];
+				unsigned i2 = indexes[3 * f + 1];
+				unsigned i3 = indexes[3 * f + 2];
+
+				//very small triangles (or flat ones) may be implicitly removed by vertex fusion!
+				if (i1 == i2 || i1 == i3 || i2 == i3)
+				{
+					++degeneratedCount;
+					continue;
+				}
+
+				mesh->addTriangle(i1, i2, i3);
+
+				//and a new normal?
+				if (normals)
+				{
+					int index = static_cast<int>(normals->currentSize());
+					normals->addElement(facetNormals[f]);
+					mesh->addTriangleNormalIndexes(index, index, index);
 				}
-				//else
-				//{
-				//	vertIndexes[i] = static_cast<unsigned>(equivalentIndex);
-				//}
 			}
-		}
+			processedFacetCount += blockCount;
 
-		//UINT16 Attribute byte count (not used)
-		{
-			char a[2];
-			if (fp.read(a, 2) < 0)
-				return CC_FERR_READING;
+			//progress
+			if (result != CC_FERR_NO_ERROR || (parameters.parentWidget && !nProgress.oneStep()))
+			{
+				break;
+			}
 		}
 
-		//we have successfully read the 3 vertices
-		//let's add a new triangle
+		if (weldVertices && result == CC_FERR_NO_ERROR && faceCount != 0 && processedFacetCount == faceCount && mesh->size() == 0)
 		{
-			mesh->addTriangle(vertIndexes[0], vertIndexes[1], vertIndexes[2]);
-		}
+			ccLog::Warning("[STL] After vertex fusion, all triangles would collapse! We'll keep the non-fused version...");
 
-		//and a new normal?
-		if (normals)
-		{
-			//compress normal
-			int index = static_cast<int>(normals->currentSize());
-			CompressedNormType nIndex = ccNormalVectors::GetNormIndex(N.u);
-			normals->addElement(nIndex);
-			mesh->addTriangleNormalIndexes(index, index, index);
+			//we read the facets again
+			weldVertices = false;
+			vertices->resize(0);
+			if (!fp.seek(84))
+			{
+				result = CC_FERR_READING;
+				break;
+			}
+			nProgress.reset();
+			continue;
 		}
 
-		//progress
-		if (parameters.parentWidget && !nProgress.oneStep())
+		if (degeneratedCount != 0)
 		{
-			break;
+			ccLog::Print("[STL] %u degenerated face(s) removed after auto-removal of duplicate vertices", degeneratedCount);
 		}
+		break;
 	}
 
 	if (parameters.parentWidget)
 	{
-		pDlg.stop();
+		pDlg->stop();
 	}
 
-	return CC_FERR_NO_ERROR;
+	return result;
 }
-
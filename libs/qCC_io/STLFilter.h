@@ -37,6 +37,7 @@ public:
 
 	//inherited from FileIOFilter
 	virtual bool importSupported() const override { return true; }
+	virtual bool backgroundImportSupported() const override { return true; }
 	virtual bool exportSupported() const override { return true; }
 	virtual CC_FILE_ERROR loadFile(QString filename, ccHObject& container, LoadParameters& parameters) override;
 	virtual CC_FILE_ERROR saveToFile(ccHObject* entity, QString filename, SaveParameters& parameters) override;
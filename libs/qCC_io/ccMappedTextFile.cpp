@@ -0,0 +1,313 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "ccMappedTextFile.h"
+
+//Qt
+#include <QByteArray>
+
+//System
+#include <ctype.h>
+#include <algorithm>
+#include <limits>
+
+//! Minimum size of a chunk (in bytes)
+static const size_t MIN_CHUNK_SIZE = (1 << 20);
+
+//! Maximum number of significant digits handled by the fast double parser
+static const int MAX_FAST_DIGITS = 19;
+
+//! Exact powers of 10 (as doubles)
+static const double s_pow10[] = {	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+									1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+									1e21, 1e22 };
+
+ccMappedTextFile::ccMappedTextFile()
+	: m_data(0)
+	, m_size(0)
+{
+}
+
+ccMappedTextFile::~ccMappedTextFile()
+{
+	close();
+}
+
+bool ccMappedTextFile::open(const QString& filename)
+{
+	close();
+
+	m_file.setFileName(filename);
+	if (!m_file.open(QFile::ReadOnly))
+		return false;
+
+	m_size = static_cast<size_t>(m_file.size());
+	if (m_size == 0)
+	{
+		//nothing to map
+		return true;
+	}
+
+	m_data = m_file.map(0, m_file.size());
+	if (!m_data)
+	{
+		//not enough address space?
+		m_file.close();
+		m_size = 0;
+		return false;
+	}
+
+	return true;
+}
+
+void ccMappedTextFile::close()
+{
+	if (m_data)
+	{
+		m_file.unmap(m_data);
+		m_data = 0;
+	}
+	m_size = 0;
+	if (m_file.isOpen())
+		m_file.close();
+}
+
+bool ccMappedTextFile::StartsWith(const char* p, const char* end, const char* keyword)
+{
+	for (; *keyword; ++keyword, ++p)
+	{
+		if (p == end || toupper(static_cast<unsigned char>(*p)) != toupper(static_cast<unsigned char>(*keyword)))
+			return false;
+	}
+	return true;
+}
+
+std::vector<ccMappedTextFile::Chunk> ccMappedTextFile::Split(const char* begin, const char* end, const char* recordKeyword/*=0*/, size_t targetChunkSize/*=0*/)
+{
+	std::vector<Chunk> chunks;
+	if (begin >= end)
+		return chunks;
+
+	const size_t rangeSize = static_cast<size_t>(end - begin);
+	if (targetChunkSize == 0)
+	{
+		//several chunks per thread (for a better load balancing)
+		size_t chunkCount = static_cast<size_t>(std::max(1, QThread::idealThreadCount())) * 8;
+		targetChunkSize = std::max(MIN_CHUNK_SIZE, rangeSize / chunkCount);
+	}
+
+	const char* chunkStart = begin;
+	while (chunkStart != end)
+	{
+		const char* chunkEnd = end;
+		if (static_cast<size_t>(end - chunkStart) > targetChunkSize)
+		{
+			//move to the beginning of the next line
+			chunkEnd = NextLine(chunkStart + targetChunkSize, end);
+
+			//and to the next record if necessary
+			if (recordKeyword)
+			{
+				while (chunkEnd != end && !StartsWith(SkipBlanks(chunkEnd, end), end, recordKeyword))
+				{
+					chunkEnd = NextLine(chunkEnd, end);
+				}
+			}
+		}
+
+		Chunk chunk;
+		chunk.begin = chunkStart;
+		chunk.end = chunkEnd;
+		chunks.push_back(chunk);
+
+		chunkStart = chunkEnd;
+	}
+
+	return chunks;
+}
+
+bool ccMappedTextFile::ParseDouble(const char*& p, const char* end, double& val)
+{
+	const char* start = SkipBlanks(p, end);
+	const char* c = start;
+	if (c == end)
+		return false;
+
+	bool negative = false;
+	if (*c == '-' || *c == '+')
+	{
+		negative = (*c == '-');
+		++c;
+	}
+
+	//mantissa
+	quint64 mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool hasDigits = false;
+	for (; c != end && *c >= '0' && *c <= '9'; ++c)
+	{
+		hasDigits = true;
+		if (digits < MAX_FAST_DIGITS)
+		{
+			if (mantissa != 0 || *c != '0')
+			{
+				mantissa = mantissa * 10 + static_cast<quint64>(*c - '0');
+				++digits;
+			}
+		}
+		else
+		{
+			//we can't store this digit anymore
+			++exponent;
+			++digits;
+		}
+	}
+	if (c != end && *c == '.')
+	{
+		++c;
+		for (; c != end && *c >= '0' && *c <= '9'; ++c)
+		{
+			hasDigits = true;
+			if (digits < MAX_FAST_DIGITS)
+			{
+				if (mantissa != 0 || *c != '0')
+				{
+					mantissa = mantissa * 10 + static_cast<quint64>(*c - '0');
+					++digits;
+				}
+				--exponent;
+			}
+			else
+			{
+				++digits;
+			}
+		}
+	}
+
+	bool fastPath = hasDigits && digits <= MAX_FAST_DIGITS;
+
+	//exponent
+	if (hasDigits && c != end && (*c == 'e' || *c == 'E'))
+	{
+		const char* e = c + 1;
+		bool negativeExp = false;
+		if (e != end && (*e == '-' || *e == '+'))
+		{
+			negativeExp = (*e == '-');
+			++e;
+		}
+		if (e == end || *e < '0' || *e > '9')
+		{
+			//malformed exponent
+			return false;
+		}
+		int expValue = 0;
+		for (; e != end && *e >= '0' && *e <= '9'; ++e)
+		{
+			if (expValue < 100000)
+				expValue = expValue * 10 + (*e - '0');
+		}
+		exponent += (negativeExp ? -expValue : expValue);
+		c = e;
+	}
+
+	if (fastPath && IsTokenEnd(c, end))
+	{
+		//exact conversion when both the mantissa and the power of 10 are exactly representable as doubles
+		if (mantissa < (static_cast<quint64>(1) << 53) && exponent >= -22 && exponent <= 22)
+		{
+			double d = static_cast<double>(mantissa);
+			d = (exponent < 0 ? d / s_pow10[-exponent] : d * s_pow10[exponent]);
+			val = (negative ? -d : d);
+			p = c;
+			return true;
+		}
+		else if (mantissa == 0)
+		{
+			val = (negative ? -0.0 : 0.0);
+			p = c;
+			return true;
+		}
+	}
+
+	//slow path (special values, many digits, large exponents, etc.)
+	const char* tokenEnd = TokenEnd(start, end);
+	if (tokenEnd == start)
+		return false;
+	bool ok = false;
+	double d = QByteArray::fromRawData(start, static_cast<int>(tokenEnd - start)).toDouble(&ok);
+	if (!ok)
+		return false;
+	val = d;
+	p = tokenEnd;
+	return true;
+}
+
+bool ccMappedTextFile::ParseInt(const char*& p, const char* end, int& val)
+{
+	const char* c = SkipBlanks(p, end);
+	if (c == end)
+		return false;
+
+	bool negative = false;
+	if (*c == '-' || *c == '+')
+	{
+		negative = (*c == '-');
+		++c;
+	}
+
+	if (c == end || *c < '0' || *c > '9')
+		return false;
+
+	qint64 value = 0;
+	for (; c != end && *c >= '0' && *c <= '9'; ++c)
+	{
+		value = value * 10 + (*c - '0');
+		if (value > static_cast<qint64>(1) << 31)
+			return false; //overflow
+	}
+	if (negative)
+		value = -value;
+	if (value > std::numeric_limits<int>::max() || value < std::numeric_limits<int>::min())
+		return false;
+
+	val = static_cast<int>(value);
+	p = c;
+	return true;
+}
+
+bool ccMappedTextFile::ParseUInt(const char*& p, const char* end, unsigned& val)
+{
+	const char* c = SkipBlanks(p, end);
+	if (c != end && *c == '+')
+		++c;
+	if (c == end || *c < '0' || *c > '9')
+		return false;
+
+	quint64 value = 0;
+	for (; c != end && *c >= '0' && *c <= '9'; ++c)
+	{
+		value = value * 10 + static_cast<quint64>(*c - '0');
+		if (value > std::numeric_limits<unsigned>::max())
+			return false; //overflow
+	}
+
+	val = static_cast<unsigned>(value);
+	p = c;
+	return true;
+}
@@ -0,0 +1,216 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_MAPPED_TEXT_FILE_HEADER
+#define CC_MAPPED_TEXT_FILE_HEADER
+
+//local
+#include "qCC_io.h"
+
+//qCC_db
+#include <ccProgressDialog.h>
+
+//Qt
+#include <QEventLoop>
+#include <QFile>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QThread>
+#include <QTimer>
+#include <QtConcurrentMap>
+
+//System
+#include <string.h>
+#include <vector>
+
+//! Memory-mapped text file with fast (byte-level) tokenizing and number parsing
+/** Meant to replace QTextStream::readLine + QString::split in the ASCII loaders.
+	The file content can be split in chunks made of whole lines so that each
+	chunk can be parsed independently (typically in two passes: count, then fill).
+**/
+class QCC_IO_LIB_API ccMappedTextFile
+{
+public:
+
+	//! Default constructor
+	ccMappedTextFile();
+
+	//! Destructor (unmaps the file)
+	~ccMappedTextFile();
+
+	//! Maps a file in memory
+	bool open(const QString& filename);
+
+	//! Unmaps the file
+	void close();
+
+	//! Returns whether the file is mapped
+	inline bool isOpen() const { return m_data != 0 || (m_size == 0 && m_file.isOpen()); }
+
+	//! Returns the beginning of the file content
+	inline const char* begin() const { return reinterpret_cast<const char*>(m_data); }
+	//! Returns the end of the file content
+	inline const char* end() const { return reinterpret_cast<const char*>(m_data) + m_size; }
+	//! Returns the file size (in bytes)
+	inline size_t size() const { return m_size; }
+
+	//! Range of whole lines
+	struct Chunk
+	{
+		const char* begin;
+		const char* end;
+	};
+
+	//! Splits a text range in chunks made of whole lines
+	/** \param begin range start (should be the beginning of a line)
+		\param end range end
+		\param recordKeyword optional keyword that all chunks (but the first) must start with (case insensitive, leading blanks are ignored)
+		\param targetChunkSize target size of each chunk (0 = automatic)
+		\return chunks (in the same order as in the file)
+	**/
+	static std::vector<Chunk> Split(const char* begin, const char* end, const char* recordKeyword = 0, size_t targetChunkSize = 0);
+
+	//! Processes all the input elements in parallel
+	/** If a progress dialog is provided, an event loop keeps the GUI responsive
+		while the workers run: the progress is updated and the cancel button is
+		checked periodically. Otherwise the calling thread simply waits.
+		\return false if the process was canceled by the user
+	**/
+	template <class T> static bool ProcessInParallel(std::vector<T>& elements, void (*func)(T&), ccProgressDialog* pDlg = 0)
+	{
+		if (elements.empty())
+			return true;
+
+		QFuture<void> future = QtConcurrent::map(elements, func);
+		if (!pDlg)
+		{
+			future.waitForFinished();
+			return true;
+		}
+
+		bool canceled = false;
+		QEventLoop loop;
+		QFutureWatcher<void> watcher;
+		QObject::connect(&watcher, &QFutureWatcher<void>::finished, &loop, &QEventLoop::quit);
+		QTimer timer;
+		QObject::connect(&timer, &QTimer::timeout, [&]()
+		{
+			if (!canceled && pDlg->wasCanceled())
+			{
+				future.cancel();
+				canceled = true;
+			}
+			else if (future.progressMaximum() > 0)
+			{
+				pDlg->update(100.0f * future.progressValue() / future.progressMaximum());
+			}
+		});
+		watcher.setFuture(future);
+		if (!future.isFinished())
+		{
+			timer.start(100);
+			loop.exec();
+			timer.stop();
+		}
+
+		//the running tasks must be over (even if the process was canceled)
+		future.waitForFinished();
+
+		return !canceled;
+	}
+
+	/*** Tokenizing ***/
+
+	//! Returns whether a character is a blank character (end of line excluded)
+	static inline bool IsBlank(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v'; }
+
+	//! Skips blank characters (end of line excluded)
+	static inline const char* SkipBlanks(const char* p, const char* end)
+	{
+		while (p != end && IsBlank(*p))
+			++p;
+		return p;
+	}
+
+	//! Returns the end of the current line (i.e. the position of the next '\n' or 'end')
+	static inline const char* LineEnd(const char* p, const char* end)
+	{
+		const void* eol = memchr(p, '\n', end - p);
+		return eol ? static_cast<const char*>(eol) : end;
+	}
+
+	//! Returns the beginning of the next line
+	static inline const char* NextLine(const char* p, const char* end)
+	{
+		p = LineEnd(p, end);
+		return p != end ? p + 1 : end;
+	}
+
+	//! Returns the end of the current token (i.e. the next blank or end of line)
+	static inline const char* TokenEnd(const char* p, const char* end)
+	{
+		while (p != end && *p != '\n' && !IsBlank(*p))
+			++p;
+		return p;
+	}
+
+	//! Returns whether the current position is the end of a token
+	static inline bool IsTokenEnd(const char* p, const char* end) { return p == end || *p == '\n' || IsBlank(*p); }
+
+	//! Returns whether the current line (from p) is empty or only contains blank characters
+	static inline bool IsLineEnd(const char* p, const char* end) { p = SkipBlanks(p, end); return p == end || *p == '\n'; }
+
+	//! Returns whether the text at the current position starts by a given keyword (case insensitive)
+	static bool StartsWith(const char* p, const char* end, const char* keyword);
+
+	//! Returns whether the current token (from p) is exactly a given keyword (case insensitive)
+	static inline bool TokenIs(const char* p, const char* end, const char* keyword)
+	{
+		return StartsWith(p, end, keyword) && IsTokenEnd(p + strlen(keyword), end);
+	}
+
+	/*** Number parsing ***/
+
+	//! Parses a (double) number
+	/** Leading blanks are skipped. The number must be followed by a blank, an end of line or the end of the range.
+		\param p current position (updated on success)
+		\param end end of the range
+		\param val output value
+		\return success
+	**/
+	static bool ParseDouble(const char*& p, const char* end, double& val);
+
+	//! Parses a signed integer
+	/** Leading blanks are skipped. Contrarily to ParseDouble, parsing stops at the first non-digit character
+		(so that 'v/vt/vn' tokens can be read for instance).
+	**/
+	static bool ParseInt(const char*& p, const char* end, int& val);
+
+	//! Parses an unsigned integer (see ParseInt)
+	static bool ParseUInt(const char*& p, const char* end, unsigned& val);
+
+protected:
+
+	//! File
+	QFile m_file;
+	//! Mapped data
+	uchar* m_data;
+	//! Mapped size
+	size_t m_size;
+};
+
+#endif //CC_MAPPED_TEXT_FILE_HEADER
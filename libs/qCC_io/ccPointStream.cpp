@@ -0,0 +1,244 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "ccPointStream.h"
+
+//qCC_db
+#include <ccPointCloud.h>
+
+//Qt
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+
+//System
+#include <assert.h>
+#include <algorithm>
+#include <deque>
+
+//! Bounded FIFO of point blocks shared by two pipeline stages
+class ccPointBlockQueue
+{
+public:
+
+	explicit ccPointBlockQueue(unsigned capacity)
+		: m_capacity(std::max(1u, capacity))
+		, m_closed(false)
+		, m_aborted(false)
+	{}
+
+	~ccPointBlockQueue()
+	{
+		while (!m_blocks.empty())
+		{
+			delete m_blocks.front();
+			m_blocks.pop_front();
+		}
+	}
+
+	//! Pushes a block (waits while the queue is full)
+	/** \return false if the queue has been aborted (the block is not stored in this case)
+	**/
+	bool push(ccPointCloud* block)
+	{
+		QMutexLocker locker(&m_mutex);
+		while (!m_aborted && m_blocks.size() >= m_capacity)
+		{
+			m_notFull.wait(&m_mutex);
+		}
+		if (m_aborted)
+			return false;
+
+		m_blocks.push_back(block);
+		m_notEmpty.wakeOne();
+		return true;
+	}
+
+	//! Pops a block (waits while the queue is empty)
+	/** \return the next block or 0 if the queue is closed and empty (or has been aborted)
+	**/
+	ccPointCloud* pop()
+	{
+		QMutexLocker locker(&m_mutex);
+		while (!m_aborted && !m_closed && m_blocks.empty())
+		{
+			m_notEmpty.wait(&m_mutex);
+		}
+		if (m_aborted || m_blocks.empty())
+			return 0;
+
+		ccPointCloud* block = m_blocks.front();
+		m_blocks.pop_front();
+		m_notFull.wakeOne();
+		return block;
+	}
+
+	//! Signals that no more block will be pushed
+	void close()
+	{
+		QMutexLocker locker(&m_mutex);
+		m_closed = true;
+		m_notEmpty.wakeAll();
+	}
+
+	//! Stops both sides of the queue
+	void abort()
+	{
+		QMutexLocker locker(&m_mutex);
+		m_aborted = true;
+		m_notEmpty.wakeAll();
+		m_notFull.wakeAll();
+	}
+
+protected:
+
+	size_t m_capacity;
+	bool m_closed;
+	bool m_aborted;
+	std::deque<ccPointCloud*> m_blocks;
+	QMutex m_mutex;
+	QWaitCondition m_notEmpty;
+	QWaitCondition m_notFull;
+};
+
+//! Thread running a single function
+/** Dedicated threads are used (instead of the global thread pool) as the
+	stages wait for each other: they must all be running at the same time.
+**/
+class ccPointStreamThread : public QThread
+{
+public:
+
+	explicit ccPointStreamThread(std::function<void()> func)
+		: m_func(func)
+	{}
+
+protected:
+
+	virtual void run() override { m_func(); }
+
+	std::function<void()> m_func;
+};
+
+ccPointStreamPipeline::ccPointStreamPipeline(unsigned blockSize/*=1000000*/, unsigned queueSize/*=2*/)
+	: m_blockSize(std::max(1u, blockSize))
+	, m_queueSize(std::max(1u, queueSize))
+	, m_pointsRead(0)
+	, m_pointsWritten(0)
+{
+}
+
+CC_FILE_ERROR ccPointStreamPipeline::run(ccPointStreamReader* reader, ccPointStreamWriter* writer, Process process)
+{
+	if (!reader || !writer)
+	{
+		assert(false);
+		return CC_FERR_BAD_ARGUMENT;
+	}
+
+	m_pointsRead = 0;
+	m_pointsWritten = 0;
+
+	ccPointBlockQueue readQueue(m_queueSize);
+	ccPointBlockQueue writeQueue(m_queueSize);
+
+	//reading stage
+	CC_FILE_ERROR readResult = CC_FERR_NO_ERROR;
+	ccPointStreamThread readerThread([&]()
+	{
+		readResult = reader->read(m_blockSize, [&](ccPointCloud* block) -> bool
+		{
+			m_pointsRead += block->size();
+			if (!readQueue.push(block))
+			{
+				delete block;
+				return false;
+			}
+			return true;
+		});
+
+		readQueue.close();
+	});
+
+	//writing stage
+	CC_FILE_ERROR writeResult = CC_FERR_NO_ERROR;
+	ccPointStreamThread writerThread([&]()
+	{
+		while (ccPointCloud* block = writeQueue.pop())
+		{
+			writeResult = writer->write(block);
+			if (writeResult == CC_FERR_NO_ERROR)
+			{
+				m_pointsWritten += block->size();
+			}
+			delete block;
+
+			if (writeResult != CC_FERR_NO_ERROR)
+			{
+				//stop all the stages
+				writeQueue.abort();
+				readQueue.abort();
+				break;
+			}
+		}
+	});
+
+	readerThread.start();
+	writerThread.start();
+
+	//processing stage (current thread)
+	bool canceled = false;
+	while (ccPointCloud* block = readQueue.pop())
+	{
+		if (process && !process(block))
+		{
+			delete block;
+			canceled = true;
+			break;
+		}
+
+		if (!writeQueue.push(block))
+		{
+			//the writer has failed
+			delete block;
+			break;
+		}
+	}
+
+	if (canceled)
+	{
+		readQueue.abort();
+		writeQueue.abort();
+	}
+	else
+	{
+		writeQueue.close();
+	}
+
+	readerThread.wait();
+	writerThread.wait();
+
+	if (writeResult != CC_FERR_NO_ERROR)
+		return writeResult;
+	if (canceled)
+		return CC_FERR_CANCELED_BY_USER;
+	if (readResult != CC_FERR_NO_ERROR)
+		return readResult;
+
+	return writer->finish();
+}
@@ -0,0 +1,143 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_POINT_STREAM_HEADER
+#define CC_POINT_STREAM_HEADER
+
+//local
+#include "FileIOFilter.h"
+
+//System
+#include <functional>
+
+class ccPointCloud;
+
+//! Sequential (block by block) point cloud reader
+/** Used to process files that don't fit in memory. Each block is a standalone
+	point cloud (with the same global shift, colors, normals and scalar fields
+	as the other blocks of the same file).
+	See FileIOFilter::openStreamReader.
+**/
+class ccPointStreamReader
+{
+public:
+
+	//! Default constructor
+	/** \param parameters loading parameters (for the global shift)
+	**/
+	explicit ccPointStreamReader(const FileIOFilter::LoadParameters& parameters)
+		: m_loadParameters(parameters)
+	{
+		//reading happens on a worker thread: no dialog can be displayed
+		if (	m_loadParameters.shiftHandlingMode == ccGlobalShiftManager::DIALOG_IF_NECESSARY
+			||	m_loadParameters.shiftHandlingMode == ccGlobalShiftManager::ALWAYS_DISPLAY_DIALOG)
+		{
+			m_loadParameters.shiftHandlingMode = ccGlobalShiftManager::NO_DIALOG_AUTO_SHIFT;
+		}
+		m_loadParameters.alwaysDisplayLoadDialog = false;
+		m_loadParameters.parentWidget = 0;
+	}
+
+	//! Destructor
+	virtual ~ccPointStreamReader() {}
+
+	//! Block handler
+	/** Takes the ownership of the block.
+		\return false to stop reading
+	**/
+	typedef std::function<bool(ccPointCloud*)> BlockHandler;
+
+	//! Returns the total number of points in the file (or 0 if unknown)
+	virtual qint64 pointCount() const { return 0; }
+
+	//! Reads the whole file, block by block
+	/** \param blockSize max number of points per block
+		\param handler called each time a block is ready
+		\return error (CC_FERR_CANCELED_BY_USER if the handler stopped the process)
+	**/
+	virtual CC_FILE_ERROR read(unsigned blockSize, BlockHandler handler) = 0;
+
+protected:
+
+	//! Loading parameters
+	FileIOFilter::LoadParameters m_loadParameters;
+};
+
+//! Sequential (block by block) point cloud writer
+/** The layout of the output file (colors, normals, scalar fields) is
+	defined by the first non empty block. See FileIOFilter::openStreamWriter.
+**/
+class ccPointStreamWriter
+{
+public:
+
+	//! Destructor
+	virtual ~ccPointStreamWriter() {}
+
+	//! Writes a block of points (in global coordinates)
+	virtual CC_FILE_ERROR write(const ccPointCloud* block) = 0;
+
+	//! Finalizes the file (once all blocks have been written)
+	virtual CC_FILE_ERROR finish() = 0;
+};
+
+//! Out-of-core 'read -> process -> write' pipeline
+/** The reader and the writer run on their own threads. Blocks are passed
+	between the stages through bounded queues, so that the amount of memory
+	used doesn't depend on the size of the file.
+**/
+class QCC_IO_LIB_API ccPointStreamPipeline
+{
+public:
+
+	//! Block process (called on the caller thread)
+	/** The block can be replaced by another one (in which case the process
+		is responsible for deleting the original block).
+		\return false to stop the pipeline
+	**/
+	typedef std::function<bool(ccPointCloud*& block)> Process;
+
+	//! Default constructor
+	/** \param blockSize max number of points per block
+		\param queueSize max number of blocks waiting between two stages
+	**/
+	ccPointStreamPipeline(unsigned blockSize = 1000000, unsigned queueSize = 2);
+
+	//! Runs the pipeline
+	/** The writer is finalized if (and only if) the whole process succeeds.
+		\return error
+	**/
+	CC_FILE_ERROR run(ccPointStreamReader* reader, ccPointStreamWriter* writer, Process process);
+
+	//! Returns the number of points read during the last run
+	qint64 pointsRead() const { return m_pointsRead; }
+	//! Returns the number of points written during the last run
+	qint64 pointsWritten() const { return m_pointsWritten; }
+
+protected:
+
+	//! Max number of points per block
+	unsigned m_blockSize;
+	//! Max number of blocks waiting between two stages
+	unsigned m_queueSize;
+	//! Number of points read
+	qint64 m_pointsRead;
+	//! Number of points written
+	qint64 m_pointsWritten;
+};
+
+#endif //CC_POINT_STREAM_HEADER
@@ -877,7 +877,7 @@ CC_FILE_ERROR LASFWFFilter::loadFile(QString filename, ccHObject& container, Loa
 				ccGlobalShiftManager::Mode csModeBackup = parameters.shiftHandlingMode;
 				bool useLasShift = false;
 				//set the LAS shift as default shift (if none was provided)
-				if (lasShift.norm2() != 0 && (!parameters.coordinatesShiftEnabled || !*parameters.coordinatesShiftEnabled))
+				if (lasShift.norm2() != 0 && !IsGlobalShiftEnabled(parameters))
 				{
 					useLasShift = true;
 					Pshift = lasShift;
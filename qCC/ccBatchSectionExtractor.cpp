@@ -0,0 +1,802 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#include "ccBatchSectionExtractor.h"
+
+//qCC_db
+#include <ccGenericPointCloud.h>
+#include <ccPointCloud.h>
+#include <ccPolyline.h>
+
+//Qt
+#include <QThread>
+
+//system
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+
+//! Max number of cells of a cloud index
+static const double MAX_GRID_CELL_COUNT = static_cast<double>(1 << 24);
+
+//! Returns the number of cells of a grid
+static double GridCellCount(double dx, double dy, double step)
+{
+	return (floor(dx / step) + 1) * (floor(dy / step) + 1);
+}
+
+//! Returns the (clamped) cell coordinate of a value
+static inline unsigned CellCoord(double value, double origin, double step, unsigned count)
+{
+	double c = floor((value - origin) / step);
+	if (c < 0)
+		return 0;
+	if (c >= count)
+		return count - 1;
+	return static_cast<unsigned>(c);
+}
+
+//! Returns the range of cells overlapping an interval
+/** \return false if the interval is outside the grid
+**/
+static bool CellRange(double minValue, double maxValue, double origin, double step, unsigned count, unsigned& c0, unsigned& c1)
+{
+	double f0 = floor((minValue - origin) / step);
+	double f1 = floor((maxValue - origin) / step);
+	if (f1 < 0 || f0 >= count)
+		return false;
+
+	c0 = (f0 < 0 ? 0 : static_cast<unsigned>(f0));
+	c1 = (f1 >= count ? count - 1 : static_cast<unsigned>(f1));
+	return true;
+}
+
+ccBatchSectionExtractor::ccBatchSectionExtractor(unsigned char vertDim/*=2*/)
+	: m_vertDim(vertDim > 2 ? 2 : vertDim)
+{
+	m_xDim = (m_vertDim < 2 ? m_vertDim + 1 : 0);
+	m_yDim = (m_xDim < 2 ? m_xDim + 1 : 0);
+}
+
+void ccBatchSectionExtractor::ReleaseSections(std::vector<Section>& sections)
+{
+	for (Section& section : sections)
+	{
+		if (section.cloud)
+		{
+			delete section.cloud;
+			section.cloud = 0;
+		}
+		for (ccPolyline* contour : section.contours)
+		{
+			delete contour;
+		}
+		section.contours.clear();
+	}
+	sections.clear();
+}
+
+bool ccBatchSectionExtractor::setClouds(const std::vector<ccGenericPointCloud*>& clouds,
+										double cellSize,
+										CCLib::GenericProgressCallback* progressCb/*=0*/)
+{
+	m_grids.clear();
+
+	if (cellSize <= 0)
+	{
+		assert(false);
+		return false;
+	}
+
+	CCLib::NormalizedProgress nProgress(progressCb, static_cast<unsigned>(clouds.size()));
+
+	try
+	{
+		m_grids.resize(clouds.size());
+
+		for (size_t c = 0; c < clouds.size(); ++c)
+		{
+			CloudGrid& grid = m_grids[c];
+			grid.cloud = clouds[c];
+			if (!grid.cloud)
+			{
+				assert(false);
+				continue;
+			}
+
+			unsigned pointCount = grid.cloud->size();
+			if (pointCount == 0)
+			{
+				//nothing to index
+				continue;
+			}
+
+			ccBBox box = grid.cloud->getOwnBB();
+			grid.minCorner = CCVector2(box.minCorner().u[m_xDim], box.minCorner().u[m_yDim]);
+			double dx = static_cast<double>(box.maxCorner().u[m_xDim]) - grid.minCorner.x;
+			double dy = static_cast<double>(box.maxCorner().u[m_yDim]) - grid.minCorner.y;
+
+			//we don't want (much) more cells than points
+			double maxCellCount = std::max(1.0, std::min(static_cast<double>(pointCount), MAX_GRID_CELL_COUNT));
+			double step = std::max(cellSize, sqrt(dx * dy / maxCellCount));
+			while (GridCellCount(dx, dy, step) > maxCellCount)
+			{
+				step *= 1.5;
+			}
+
+			grid.cellSize = static_cast<PointCoordinateType>(step);
+			grid.width = static_cast<unsigned>(floor(dx / step)) + 1;
+			grid.height = static_cast<unsigned>(floor(dy / step)) + 1;
+			size_t cellCount = static_cast<size_t>(grid.width) * grid.height;
+
+			//compute the cell index of each point
+			std::vector<unsigned> pointCells(pointCount);
+#if defined(_OPENMP)
+			#pragma omp parallel for
+#endif
+			for (int i = 0; i < static_cast<int>(pointCount); ++i)
+			{
+				const CCVector3* P = grid.cloud->getPoint(static_cast<unsigned>(i));
+				unsigned cx = CellCoord(P->u[m_xDim], grid.minCorner.x, step, grid.width);
+				unsigned cy = CellCoord(P->u[m_yDim], grid.minCorner.y, step, grid.height);
+				pointCells[i] = cx + cy * grid.width;
+			}
+
+			//counting sort (the points remain in ascending order inside each cell)
+			grid.cellStart.assign(cellCount + 1, 0);
+			grid.pointIndexes.resize(pointCount);
+			for (unsigned i = 0; i < pointCount; ++i)
+			{
+				++grid.cellStart[pointCells[i] + 1];
+			}
+			for (size_t k = 0; k < cellCount; ++k)
+			{
+				grid.cellStart[k + 1] += grid.cellStart[k];
+			}
+			for (unsigned i = 0; i < pointCount; ++i)
+			{
+				grid.pointIndexes[grid.cellStart[pointCells[i]]++] = i;
+			}
+			//each 'cellStart' value now points to the start of the next cell
+			for (size_t k = cellCount; k > 0; --k)
+			{
+				grid.cellStart[k] = grid.cellStart[k - 1];
+			}
+			grid.cellStart[0] = 0;
+
+			if (progressCb && !nProgress.oneStep())
+			{
+				//process cancelled by the user
+				m_grids.clear();
+				return false;
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		m_grids.clear();
+		return false;
+	}
+
+	return true;
+}
+
+void ccBatchSectionExtractor::getSegments(const ccPolyline* poly, bool countDegenerateLength, std::vector<Segment>& segments) const
+{
+	segments.clear();
+
+	unsigned polyVertCount = poly->size();
+	if (polyVertCount < 2)
+	{
+		return;
+	}
+	unsigned polyMaxCount = poly->isClosed() ? polyVertCount : polyVertCount - 1;
+	segments.reserve(polyMaxCount);
+
+	PointCoordinateType curvPos = 0;
+	for (unsigned j = 0; j < polyMaxCount; ++j)
+	{
+		//current polyline segment
+		CCVector3 A, B;
+		poly->getPoint(j, A);
+		poly->getPoint((j + 1) % polyVertCount, B);
+
+		Segment s;
+		s.A = CCVector2(A.u[m_xDim], A.u[m_yDim]);
+		s.B = CCVector2(B.u[m_xDim], B.u[m_yDim]);
+		s.u = s.B - s.A;
+		s.d = s.u.norm();
+		if (s.d < ZERO_TOLERANCE)
+		{
+			//degenerate segment (in 2D)
+			if (countDegenerateLength)
+				curvPos += (B - A).norm();
+			continue;
+		}
+		s.u /= s.d;
+		s.curvPos = curvPos;
+		segments.push_back(s);
+
+		//update curvilinear pos
+		curvPos += (B - A).norm();
+	}
+}
+
+void ccBatchSectionExtractor::queryStrip(	const CloudGrid& grid,
+											const Segment& seg,
+											double halfThickness,
+											bool roundedEnds,
+											std::vector<Hit>& hits) const
+{
+	hits.clear();
+
+	if (!grid.cloud || grid.cellStart.empty())
+	{
+		return;
+	}
+
+	const double maxSquareDist = halfThickness * halfThickness;
+	const CCVector2 n(-seg.u.y, seg.u.x);
+	const PointCoordinateType t = static_cast<PointCoordinateType>(halfThickness);
+	const PointCoordinateType endMargin = roundedEnds ? t : 0;
+
+	//bounding-box of the strip (with a small margin for robustness)
+	unsigned i0 = 0, i1 = 0, j0 = 0, j1 = 0;
+	{
+		CCVector2 start = seg.A - seg.u * endMargin;
+		CCVector2 end = seg.B + seg.u * endMargin;
+		PointCoordinateType sx = std::abs(n.x * t) + grid.cellSize / 4;
+		PointCoordinateType sy = std::abs(n.y * t) + grid.cellSize / 4;
+		if (	!CellRange(std::min(start.x, end.x) - sx, std::max(start.x, end.x) + sx, grid.minCorner.x, grid.cellSize, grid.width, i0, i1)
+			||	!CellRange(std::min(start.y, end.y) - sy, std::max(start.y, end.y) + sy, grid.minCorner.y, grid.cellSize, grid.height, j0, j1))
+		{
+			//the strip doesn't intersect the cloud
+			return;
+		}
+	}
+
+	//slightly bigger than half the cell diagonal
+	const PointCoordinateType cellRadius = grid.cellSize * static_cast<PointCoordinateType>(0.75);
+
+	for (unsigned j = j0; j <= j1; ++j)
+	{
+		for (unsigned i = i0; i <= i1; ++i)
+		{
+			size_t cellIndex = static_cast<size_t>(j) * grid.width + i;
+			unsigned first = grid.cellStart[cellIndex];
+			unsigned last = grid.cellStart[cellIndex + 1];
+			if (first == last)
+				continue;
+
+			//skip the cells that are too far from the segment
+			CCVector2 C(grid.minCorner.x + (i + static_cast<PointCoordinateType>(0.5)) * grid.cellSize,
+						grid.minCorner.y + (j + static_cast<PointCoordinateType>(0.5)) * grid.cellSize);
+			CCVector2 AC = C - seg.A;
+			PointCoordinateType along = seg.u.dot(AC);
+			if (along < -endMargin - cellRadius || along > seg.d + endMargin + cellRadius)
+				continue;
+			if (std::abs(n.dot(AC)) > t + cellRadius)
+				continue;
+
+			for (unsigned k = first; k < last; ++k)
+			{
+				unsigned pointIndex = grid.pointIndexes[k];
+				const CCVector3* P = grid.cloud->getPoint(pointIndex);
+				CCVector2 P2D(P->u[m_xDim], P->u[m_yDim]);
+				CCVector2 AP2D = P2D - seg.A;
+
+				//longitudinal 'distance'
+				PointCoordinateType dotprod = seg.u.dot(AP2D);
+
+				if (roundedEnds)
+				{
+					PointCoordinateType squareDist = 0;
+					if (dotprod < 0)
+					{
+						//dist to nearest vertex
+						squareDist = AP2D.norm2();
+					}
+					else if (dotprod > seg.d)
+					{
+						//dist to nearest vertex
+						squareDist = (P2D - seg.B).norm2();
+					}
+					else
+					{
+						//orthogonal distance
+						squareDist = (AP2D - seg.u * dotprod).norm2();
+					}
+
+					if (squareDist <= maxSquareDist)
+					{
+						hits.push_back(Hit(pointIndex, squareDist));
+					}
+				}
+				else
+				{
+					if (dotprod < 0 || dotprod > seg.d)
+						continue;
+
+					//orthogonal distance
+					PointCoordinateType h = (AP2D - seg.u * dotprod).norm2();
+					if (h <= maxSquareDist)
+					{
+						hits.push_back(Hit(pointIndex, dotprod));
+					}
+				}
+			}
+		}
+	}
+
+	//restore the original order of the points
+	std::sort(hits.begin(), hits.end());
+}
+
+bool ccBatchSectionExtractor::buildSection(	const std::vector<Segment>& segments,
+											const std::vector<Hit>* hits,
+											const Parameters& params,
+											Section& section) const
+{
+	const size_t segCount = segments.size();
+	const size_t cloudCount = m_grids.size();
+
+	//count the extracted points
+	std::vector<unsigned> cloudPointCounts(cloudCount, 0);
+	section.pointCount = 0;
+	for (size_t c = 0; c < cloudCount; ++c)
+	{
+		for (size_t j = 0; j < segCount; ++j)
+		{
+			cloudPointCounts[c] += static_cast<unsigned>(hits[c * segCount + j].size());
+		}
+		section.pointCount += cloudPointCounts[c];
+	}
+
+	if (section.pointCount == 0)
+	{
+		//nothing to do
+		return true;
+	}
+
+	//extract the section as a cloud
+	if (params.extractClouds)
+	{
+		for (size_t c = 0; c < cloudCount; ++c)
+		{
+			if (cloudPointCounts[c] == 0)
+				continue;
+
+			ccGenericPointCloud* cloud = m_grids[c].cloud;
+			CCLib::ReferenceCloud refCloud(cloud);
+			if (!refCloud.reserve(cloudPointCounts[c]))
+			{
+				//not enough memory
+				return false;
+			}
+			for (size_t j = 0; j < segCount; ++j)
+			{
+				for (const Hit& hit : hits[c * segCount + j])
+				{
+					refCloud.addPointIndex(hit.index);
+				}
+			}
+
+			//if the cloud is a ccPointCloud, we can keep a lot more information
+			//when extracting the section cloud
+			ccPointCloud* pc = dynamic_cast<ccPointCloud*>(cloud);
+			ccPointCloud* part = pc ? pc->partialClone(&refCloud) : ccPointCloud::From(&refCloud, cloud);
+			if (!part)
+			{
+				//not enough memory
+				return false;
+			}
+
+			if (!section.cloud)
+			{
+				//we simply use this 'part' cloud as the section cloud
+				section.cloud = part;
+			}
+			else
+			{
+				//fuse it with the global cloud
+				unsigned cloudSizeBefore = section.cloud->size();
+				unsigned partSize = part->size();
+				section.cloud->append(part, cloudSizeBefore, true);
+				delete part;
+				part = 0;
+
+				//check that it actually worked!
+				if (section.cloud->size() != cloudSizeBefore + partSize)
+				{
+					//not enough memory
+					return false;
+				}
+			}
+		}
+	}
+
+	//extract the section as a contour
+	if (params.extractContours && section.pointCount > 1)
+	{
+		ccPointCloud originalSectionCloud("section.orig");
+		ccPointCloud unrolledSectionCloud("section.unroll");
+		if (	!originalSectionCloud.reserve(section.pointCount)
+			||	!unrolledSectionCloud.reserve(section.pointCount))
+		{
+			//not enough memory
+			return false;
+		}
+
+		//assign them the default (first!) global shift & scale info
+		originalSectionCloud.setGlobalScale(m_grids.front().cloud->getGlobalScale());
+		originalSectionCloud.setGlobalShift(m_grids.front().cloud->getGlobalShift());
+
+		for (size_t c = 0; c < cloudCount; ++c)
+		{
+			ccGenericPointCloud* cloud = m_grids[c].cloud;
+			for (size_t j = 0; j < segCount; ++j)
+			{
+				const Segment& seg = segments[j];
+				for (const Hit& hit : hits[c * segCount + j])
+				{
+					const CCVector3* P = cloud->getPoint(hit.index);
+					PointCoordinateType dotprod = hit.value;
+
+					//we project the 'real' 3D point in the section plane
+					CCVector3 Pproj3D;
+					{
+						Pproj3D.u[m_xDim]    = seg.A.x + seg.u.x * dotprod;
+						Pproj3D.u[m_yDim]    = seg.A.y + seg.u.y * dotprod;
+						Pproj3D.u[m_vertDim] = P->u[m_vertDim];
+					}
+					originalSectionCloud.addPoint(Pproj3D);
+					//the 'unrolled' points are 2D (X = curvilinear coordinate, Y = height, Z = 0)
+					unrolledSectionCloud.addPoint(CCVector3(seg.curvPos + dotprod, P->u[m_vertDim], 0));
+				}
+			}
+		}
+
+		CCVector3 N(0, 0, 1);
+		CCVector3 Y(0, 1, 0);
+
+		std::vector<unsigned> vertIndexes;
+		ccPolyline* contour = ccContourExtractor::ExtractFlatContour(	&unrolledSectionCloud,
+																		params.multiPass,
+																		params.maxEdgeLength,
+																		N.u,
+																		Y.u,
+																		params.contourType,
+																		&vertIndexes,
+																		params.visualDebugMode);
+		if (contour)
+		{
+			//update vertices (to replace 'unrolled' points by 'original' ones
+			CCLib::GenericIndexedCloud* vertices = contour->getAssociatedCloud();
+			if (vertIndexes.size() != static_cast<size_t>(vertices->size()))
+			{
+				//internal error (couldn't fetch original points indexes?!)
+				delete contour;
+				return false;
+			}
+			for (unsigned i = 0; i < vertices->size(); ++i)
+			{
+				assert(vertIndexes[i] < originalSectionCloud.size());
+				*const_cast<CCVector3*>(vertices->getPoint(i)) = *originalSectionCloud.getPoint(vertIndexes[i]);
+			}
+			ccPointCloud* verticesAsPC = dynamic_cast<ccPointCloud*>(vertices);
+			if (verticesAsPC)
+				verticesAsPC->refreshBB();
+
+			if (params.splitContours)
+			{
+				/*bool success = */contour->split(params.maxEdgeLength, section.contours);
+				delete contour;
+				contour = 0;
+			}
+			else
+			{
+				section.contours.push_back(contour);
+			}
+
+			for (ccPolyline* contourPart : section.contours)
+			{
+				contourPart->setGlobalScale(originalSectionCloud.getGlobalScale());
+				contourPart->setGlobalShift(originalSectionCloud.getGlobalShift());
+			}
+		}
+	}
+
+	return true;
+}
+
+bool ccBatchSectionExtractor::extractSections(	const std::vector<ccPolyline*>& polylines,
+												const Parameters& params,
+												std::vector<Section>& sections,
+												CCLib::GenericProgressCallback* progressCb/*=0*/) const
+{
+	sections.clear();
+
+	if (m_grids.empty() || params.thickness <= 0)
+	{
+		assert(false);
+		return false;
+	}
+
+	//we consider half of the total thickness as points can be on both sides!
+	const double halfThickness = params.thickness / 2;
+	const size_t cloudCount = m_grids.size();
+
+	CCLib::NormalizedProgress nProgress(progressCb, static_cast<unsigned>(polylines.size()));
+
+	bool error = false;
+	bool canceled = false;
+	try
+	{
+		sections.resize(polylines.size());
+
+		//prepare the 2D segments of each section
+		std::vector< std::vector<Segment> > polySegments(polylines.size());
+		for (size_t s = 0; s < polylines.size(); ++s)
+		{
+			if (polylines[s])
+			{
+				getSegments(polylines[s], false, polySegments[s]);
+			}
+		}
+
+		//process the sections by batches (so as to be able to cancel the process)
+		const size_t batchSize = static_cast<size_t>(std::max(1, QThread::idealThreadCount())) * 4;
+		for (size_t firstSection = 0; firstSection < polylines.size() && !error; firstSection += batchSize)
+		{
+			size_t lastSection = std::min(firstSection + batchSize, polylines.size());
+
+			//list the strip queries (for each section, cloud by cloud, then segment by segment)
+			std::vector<size_t> queryStart(lastSection - firstSection + 1, 0);
+			for (size_t s = firstSection; s < lastSection; ++s)
+			{
+				queryStart[s - firstSection + 1] = queryStart[s - firstSection] + cloudCount * polySegments[s].size();
+			}
+			std::vector<std::pair<size_t, size_t> > queries; //section + query index (inside the section)
+			queries.reserve(queryStart.back());
+			for (size_t s = firstSection; s < lastSection; ++s)
+			{
+				for (size_t q = 0; q < cloudCount * polySegments[s].size(); ++q)
+				{
+					queries.push_back(std::make_pair(s, q));
+				}
+			}
+
+			//query the strip of each segment (in parallel)
+			std::vector< std::vector<Hit> > hits(queries.size());
+			bool memoryError = false;
+#if defined(_OPENMP)
+			#pragma omp parallel for schedule(dynamic)
+#endif
+			for (int k = 0; k < static_cast<int>(queries.size()); ++k)
+			{
+				size_t s = queries[k].first;
+				size_t segCount = polySegments[s].size();
+				size_t c = queries[k].second / segCount;
+				size_t j = queries[k].second % segCount;
+				try
+				{
+					queryStrip(m_grids[c], polySegments[s][j], halfThickness, false, hits[k]);
+				}
+				catch (const std::bad_alloc&)
+				{
+					//exceptions can't cross the parallel region boundary
+					memoryError = true;
+				}
+			}
+
+			if (memoryError)
+			{
+				error = true;
+				break;
+			}
+
+			//generate the section clouds and contours (concurrently)
+			int currentBatchSize = static_cast<int>(lastSection - firstSection);
+			std::vector<int> success(currentBatchSize, 1);
+#if defined(_OPENMP)
+			#pragma omp parallel for schedule(dynamic) if(!params.visualDebugMode)
+#endif
+			for (int b = 0; b < currentBatchSize; ++b)
+			{
+				size_t s = firstSection + b;
+				if (polySegments[s].empty())
+					continue;
+
+				try
+				{
+					success[b] = buildSection(polySegments[s], &hits[queryStart[b]], params, sections[s]) ? 1 : 0;
+				}
+				catch (const std::bad_alloc&)
+				{
+					//exceptions can't cross the parallel region boundary
+					success[b] = 0;
+				}
+			}
+
+			for (int b = 0; b < currentBatchSize; ++b)
+			{
+				if (success[b] == 0)
+				{
+					error = true;
+				}
+			}
+
+			if (!error && progressCb && !nProgress.steps(static_cast<unsigned>(currentBatchSize)))
+			{
+				//process cancelled by the user: we keep the sections already extracted
+				sections.resize(lastSection);
+				canceled = true;
+				break;
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		error = true;
+	}
+
+	if (error)
+	{
+		ReleaseSections(sections);
+		return false;
+	}
+
+	return !canceled;
+}
+
+bool ccBatchSectionExtractor::unfold(	size_t cloudIndex,
+										const ccPolyline* poly,
+										double thickness,
+										CCLib::ReferenceCloud& unfoldedIndexes,
+										std::vector<CCVector3>& unfoldedPoints,
+										CCLib::GenericProgressCallback* progressCb/*=0*/) const
+{
+	unfoldedIndexes.clear(false);
+	unfoldedPoints.clear();
+
+	if (cloudIndex >= m_grids.size() || !m_grids[cloudIndex].cloud || !poly || thickness <= 0)
+	{
+		assert(false);
+		return false;
+	}
+
+	const CloudGrid& grid = m_grids[cloudIndex];
+	unsigned pointCount = grid.cloud->size();
+
+	try
+	{
+		std::vector<Segment> segments;
+		getSegments(poly, true, segments);
+
+		//closest segment of each point (if any)
+		std::vector<int> closestSegment(pointCount, -1);
+		std::vector<PointCoordinateType> minSquareDist(pointCount, 0);
+
+		CCLib::NormalizedProgress nProgress(progressCb, static_cast<unsigned>(segments.size()));
+
+		//process the segments by batches (so as to be able to cancel the process)
+		const int batchSize = std::max(1, QThread::idealThreadCount()) * 4;
+		const int segCount = static_cast<int>(segments.size());
+		std::vector< std::vector<Hit> > hits;
+		for (int firstSegment = 0; firstSegment < segCount; firstSegment += batchSize)
+		{
+			int lastSegment = std::min(firstSegment + batchSize, segCount);
+			hits.clear();
+			hits.resize(lastSegment - firstSegment);
+
+			bool memoryError = false;
+#if defined(_OPENMP)
+			#pragma omp parallel for schedule(dynamic)
+#endif
+			for (int j = firstSegment; j < lastSegment; ++j)
+			{
+				try
+				{
+					//we consider half of the total thickness as points can be on both sides!
+					queryStrip(grid, segments[j], thickness / 2, true, hits[j - firstSegment]);
+				}
+				catch (const std::bad_alloc&)
+				{
+					//exceptions can't cross the parallel region boundary
+					memoryError = true;
+				}
+			}
+
+			if (memoryError)
+			{
+				return false;
+			}
+
+			//keep the closest segment (the first one in case of equality)
+			for (int j = firstSegment; j < lastSegment; ++j)
+			{
+				for (const Hit& hit : hits[j - firstSegment])
+				{
+					if (closestSegment[hit.index] < 0 || hit.value < minSquareDist[hit.index])
+					{
+						closestSegment[hit.index] = j;
+						minSquareDist[hit.index] = hit.value;
+					}
+				}
+			}
+
+			if (progressCb && !nProgress.steps(static_cast<unsigned>(lastSegment - firstSegment)))
+			{
+				//process cancelled by the user
+				return false;
+			}
+		}
+		hits.clear();
+
+		unsigned unfoldedCount = static_cast<unsigned>(pointCount - std::count(closestSegment.begin(), closestSegment.end(), -1));
+		if (unfoldedCount == 0)
+		{
+			//nothing to do
+			return true;
+		}
+		if (!unfoldedIndexes.reserve(unfoldedCount))
+		{
+			//not enough memory
+			return false;
+		}
+		unfoldedPoints.resize(unfoldedCount);
+
+		for (unsigned i = 0; i < pointCount; ++i)
+		{
+			if (closestSegment[i] < 0)
+				continue;
+
+			const Segment& s = segments[closestSegment[i]];
+			const CCVector3* P = grid.cloud->getPoint(i);
+
+			//we use the curvilinear position of the point in the X dimension (and Y is 0)
+			CCVector3 Q;
+			{
+				CCVector2 P2D(P->u[m_xDim], P->u[m_yDim]);
+				CCVector2 AP2D = P2D - s.A;
+				PointCoordinateType dotprod = s.u.dot(AP2D);
+				PointCoordinateType d = (AP2D - s.u*dotprod).norm();
+
+				//compute the sign of 'minDist'
+				PointCoordinateType crossprod = AP2D.y * s.u.x - AP2D.x * s.u.y;
+
+				Q.u[m_xDim]    = s.curvPos + dotprod;
+				Q.u[m_yDim]    = crossprod < 0 ? -d : d; //signed orthogonal distance to the polyline
+				Q.u[m_vertDim] = P->u[m_vertDim];
+			}
+
+			unfoldedPoints[unfoldedIndexes.size()] = Q;
+			unfoldedIndexes.addPointIndex(i);
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		unfoldedIndexes.clear(false);
+		unfoldedPoints.clear();
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,255 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_BATCH_SECTION_EXTRACTOR_HEADER
+#define CC_BATCH_SECTION_EXTRACTOR_HEADER
+
+//Local
+#include "ccContourExtractor.h"
+
+//CCLib
+#include <GenericProgressCallback.h>
+#include <ReferenceCloud.h>
+
+//system
+#include <vector>
+
+class ccGenericPointCloud;
+class ccPointCloud;
+class ccPolyline;
+
+//! Extraction of the points along (many) section polylines
+/** A 2D grid index is built once for each cloud, in the plane orthogonal to
+	the vertical dimension. Each segment of each section then only visits the
+	cells overlapping its strip (i.e. the oriented box of the segment, enlarged
+	by half the section thickness on both sides). The segments are queried in
+	parallel, and the section clouds and contours are generated concurrently.
+	The extracted points come in the same order as with an exhaustive scan of
+	the clouds (cloud by cloud, then segment by segment, then point by point).
+**/
+class ccBatchSectionExtractor
+{
+public:
+
+	//! Extraction parameters
+	struct Parameters
+	{
+		//! Default constructor
+		Parameters()
+			: thickness(0)
+			, extractClouds(false)
+			, extractContours(true)
+			, contourType(ccContourExtractor::LOWER)
+			, maxEdgeLength(0)
+			, multiPass(false)
+			, splitContours(false)
+			, visualDebugMode(false)
+		{}
+
+		//! Section thickness (points can be on both sides of the polyline)
+		double thickness;
+		//! Whether to extract the section clouds
+		bool extractClouds;
+		//! Whether to extract the section contours
+		bool extractContours;
+		//! Contour type
+		ccContourExtractor::ContourType contourType;
+		//! Contour max edge length
+		PointCoordinateType maxEdgeLength;
+		//! Whether to use the multi-pass contour extraction
+		bool multiPass;
+		//! Whether to split the contours (see ccPolyline::split)
+		bool splitContours;
+		//! Visual debug mode (contours are then extracted sequentially)
+		bool visualDebugMode;
+	};
+
+	//! Extracted section
+	struct Section
+	{
+		//! Default constructor
+		Section()
+			: pointCount(0)
+			, cloud(0)
+		{}
+
+		//! Number of extracted points (all clouds)
+		unsigned pointCount;
+		//! Section cloud (if requested and if points were found)
+		ccPointCloud* cloud;
+		//! Section contour part(s) (if requested)
+		std::vector<ccPolyline*> contours;
+	};
+
+	//! Default constructor
+	/** \param vertDim vertical dimension (0 = X, 1 = Y, 2 = Z)
+	**/
+	explicit ccBatchSectionExtractor(unsigned char vertDim = 2);
+
+	//! Returns the vertical dimension
+	inline unsigned char getVertDimension() const { return m_vertDim; }
+
+	//! Builds the 2D index of the clouds
+	/** The actual cell size may be bigger than the requested one if the
+		grid would have too many cells.
+		\param clouds input clouds
+		\param cellSize requested cell size (typically the section thickness)
+		\param progressCb optional progress callback
+		\return success (false if there's not enough memory)
+	**/
+	bool setClouds(	const std::vector<ccGenericPointCloud*>& clouds,
+					double cellSize,
+					CCLib::GenericProgressCallback* progressCb = 0);
+
+	//! Extracts the points along each section polyline
+	/** Polylines with less than 2 vertices are ignored (i.e. an empty section is returned).
+		The output entities belong to the caller. If the process is cancelled,
+		the sections extracted so far are kept (and 'sections' is truncated
+		after the last one).
+		\param polylines section polylines
+		\param params extraction parameters
+		\param sections output sections (one per polyline)
+		\param progressCb optional progress callback
+		\return success (false if there's not enough memory, if an error occurred or if the process has been cancelled)
+	**/
+	bool extractSections(	const std::vector<ccPolyline*>& polylines,
+							const Parameters& params,
+							std::vector<Section>& sections,
+							CCLib::GenericProgressCallback* progressCb = 0) const;
+
+	//! Unfolds the points of a cloud along a polyline
+	/** Each point closer than half the thickness to the polyline is expressed
+		relatively to its closest segment: the curvilinear position along the
+		polyline (first horizontal dimension), the signed distance to the polyline
+		(second horizontal dimension) and the original height.
+		\param cloudIndex index of the cloud (see setClouds)
+		\param poly polyline
+		\param thickness total thickness
+		\param unfoldedIndexes indexes of the unfolded points (in ascending order)
+		\param unfoldedPoints unfolded points positions
+		\param progressCb optional progress callback
+		\return success (false if there's not enough memory or if the process has been cancelled)
+	**/
+	bool unfold(size_t cloudIndex,
+				const ccPolyline* poly,
+				double thickness,
+				CCLib::ReferenceCloud& unfoldedIndexes,
+				std::vector<CCVector3>& unfoldedPoints,
+				CCLib::GenericProgressCallback* progressCb = 0) const;
+
+	//! Releases the output entities of a set of sections
+	static void ReleaseSections(std::vector<Section>& sections);
+
+protected:
+
+	//! 2D grid index of a cloud
+	/** The point indexes are sorted by cell (CSR layout), and in ascending
+		order inside each cell.
+	**/
+	struct CloudGrid
+	{
+		CloudGrid()
+			: cloud(0)
+			, minCorner(0, 0)
+			, cellSize(0)
+			, width(0)
+			, height(0)
+		{}
+
+		ccGenericPointCloud* cloud;
+		CCVector2 minCorner;
+		PointCoordinateType cellSize;
+		unsigned width;
+		unsigned height;
+		//! Index of the first point of each cell (+ the total number of points)
+		std::vector<unsigned> cellStart;
+		//! Point indexes
+		std::vector<unsigned> pointIndexes;
+	};
+
+	//! Polyline segment (in 2D)
+	struct Segment
+	{
+		Segment()
+			: A(0, 0)
+			, B(0, 0)
+			, u(0, 0)
+			, d(0)
+			, curvPos(0)
+		{}
+
+		CCVector2 A, B, u;
+		PointCoordinateType d, curvPos;
+	};
+
+	//! Point found by a strip query
+	struct Hit
+	{
+		Hit(unsigned i = 0, PointCoordinateType v = 0) : index(i), value(v) {}
+
+		unsigned index;
+		PointCoordinateType value;
+
+		bool operator < (const Hit& other) const { return index < other.index; }
+	};
+
+	//! Finds the points inside the strip of a segment
+	/** \param grid cloud index
+		\param seg segment
+		\param halfThickness half the strip thickness
+		\param roundedEnds whether the strip is extended around the segment ends (capsule) or not
+		\param hits output points (sorted by index) with their longitudinal position along the segment
+			(or their squared distance to the segment if roundedEnds is true)
+	**/
+	void queryStrip(const CloudGrid& grid,
+					const Segment& seg,
+					double halfThickness,
+					bool roundedEnds,
+					std::vector<Hit>& hits) const;
+
+	//! Returns the 2D segments of a polyline
+	/** Degenerate segments (in 2D) are skipped.
+		\param poly polyline
+		\param countDegenerateLength whether the (3D) length of the degenerate segments counts in the curvilinear position
+		\param segments output segments
+	**/
+	void getSegments(const ccPolyline* poly, bool countDegenerateLength, std::vector<Segment>& segments) const;
+
+	//! Generates the cloud and/or the contour of a section
+	/** \param segments section segments
+		\param hits points found for each cloud and each segment (cloud by cloud, then segment by segment)
+		\param params extraction parameters
+		\param section output section
+		\return success
+	**/
+	bool buildSection(	const std::vector<Segment>& segments,
+						const std::vector<Hit>* hits,
+						const Parameters& params,
+						Section& section) const;
+
+	//! Vertical dimension
+	unsigned char m_vertDim;
+	//! First horizontal dimension
+	unsigned char m_xDim;
+	//! Second horizontal dimension
+	unsigned char m_yDim;
+
+	//! Clouds index
+	std::vector<CloudGrid> m_grids;
+};
+
+#endif //CC_BATCH_SECTION_EXTRACTOR_HEADER
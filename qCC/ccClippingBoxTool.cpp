@@ -509,6 +509,40 @@ static unsigned ComputeGridDimensions(	const ccBBox& localBox,
 	return cellCount;
 }
 
+//! Computes the bounding-box of a cloud in the local clipping box ref.
+static ccBBox ComputeLocalBox(ccGenericPointCloud* cloud, const ccGLMatrix& localTrans)
+{
+	ccBBox localBox;
+	int pointCount = static_cast<int>(cloud->size());
+
+#if defined(_OPENMP)
+	#pragma omp parallel
+#endif
+	{
+		ccBBox threadBox;
+
+#if defined(_OPENMP)
+		#pragma omp for nowait
+#endif
+		for (int i = 0; i < pointCount; ++i)
+		{
+			CCVector3 P = *cloud->getPoint(static_cast<unsigned>(i));
+			localTrans.apply(P);
+			threadBox.add(P);
+		}
+
+		//merge the per-thread boxes
+#if defined(_OPENMP)
+		#pragma omp critical
+#endif
+		{
+			localBox += threadBox;
+		}
+	}
+
+	return localBox;
+}
+
 bool ccClippingBoxTool::ExtractSlicesAndContours
 (
 	const std::vector<ccGenericPointCloud*>& clouds,
@@ -596,12 +630,7 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 				ccBBox localBox;
 				for (ccGenericPointCloud* cloud : clouds)
 				{
-					for (unsigned i = 0; i < cloud->size(); ++i)
-					{
-						CCVector3 P = *cloud->getPoint(i);
-						localTrans.apply(P);
-						localBox.add(P);
-					}
+					localBox += ComputeLocalBox(cloud, localTrans);
 				}
 
 				int indexMins[3], indexMaxs[3], gridDim[3];
@@ -622,7 +651,9 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 				unsigned subCloudsCount = 0;
 
 				//project points into grid
-				for (size_t ci = 0; ci != clouds.size(); ++ci)
+				std::vector<int> pointCells;
+				std::vector<unsigned> cellPopulations;
+				for (size_t ci = 0; ci != clouds.size() && !error; ++ci)
 				{
 					ccGenericPointCloud* cloud = clouds[ci];
 					unsigned pointCount = cloud->size();
@@ -636,9 +667,15 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 					QApplication::processEvents();
 
 					CCLib::NormalizedProgress nProgress(progressDialog, pointCount);
-					for (unsigned i = 0; i < pointCount; ++i)
+
+					//compute the cell index of each point (-1 if it falls in a gap)
+					pointCells.resize(pointCount);
+#if defined(_OPENMP)
+					#pragma omp parallel for
+#endif
+					for (int i = 0; i < static_cast<int>(pointCount); ++i)
 					{
-						CCVector3 P = *cloud->getPoint(i);
+						CCVector3 P = *cloud->getPoint(static_cast<unsigned>(i));
 						localTrans.apply(P);
 
 						//relative coordinates (between 0 and 1)
@@ -660,20 +697,51 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 							&&	(P.z - static_cast<PointCoordinateType>(zi))*cellSizePlusGap.z <= cellSize.z))
 						{
 							int cloudIndex = ((zi - indexMins[2]) * static_cast<int>(gridDim[1]) + (yi - indexMins[1])) * static_cast<int>(gridDim[0]) + (xi - indexMins[0]);
-							assert(cloudIndex >= 0 && static_cast<size_t>(cloudIndex)* clouds.size() + ci < refClouds.size());
+							assert(cloudIndex >= 0 && static_cast<unsigned>(cloudIndex) < cellCount);
+							pointCells[i] = cloudIndex;
+						}
+						else
+						{
+							pointCells[i] = -1;
+						}
+					}
 
-							CCLib::ReferenceCloud*& destCloud = refClouds[cloudIndex * clouds.size() + ci];
-							if (!destCloud)
-							{
-								destCloud = new CCLib::ReferenceCloud(cloud);
-								++subCloudsCount;
-							}
+					//count the points of each cell (so as to allocate the exact amount of memory)
+					cellPopulations.assign(cellCount, 0);
+					for (unsigned i = 0; i < pointCount; ++i)
+					{
+						if (pointCells[i] >= 0)
+						{
+							++cellPopulations[pointCells[i]];
+						}
+					}
 
-							if (!destCloud->addPointIndex(i))
+					for (unsigned c = 0; c < cellCount; ++c)
+					{
+						if (cellPopulations[c] == 0)
+						{
+							continue;
+						}
+
+						CCLib::ReferenceCloud*& destCloud = refClouds[c * clouds.size() + ci];
+						destCloud = new CCLib::ReferenceCloud(cloud);
+						++subCloudsCount;
+						if (!destCloud->reserve(cellPopulations[c]))
+						{
+							ccLog::Error("Not enough memory!");
+							error = true;
+							break;
+						}
+					}
+
+					//dispatch the points (in the same order as the input cloud)
+					if (!error)
+					{
+						for (unsigned i = 0; i < pointCount; ++i)
+						{
+							if (pointCells[i] >= 0)
 							{
-								ccLog::Error("Not enough memory!");
-								error = true;
-								break;
+								refClouds[pointCells[i] * clouds.size() + ci]->addPointIndex(i);
 							}
 						}
 					}
@@ -681,6 +749,9 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 					nProgress.oneStep();
 				} //project points into grid
 
+				pointCells.clear();
+				pointCells.shrink_to_fit();
+
 				if (progressDialog)
 				{
 					progressDialog->setWindowTitle(QObject::tr("Section extraction"));
@@ -911,52 +982,96 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 			assert(cloudSliceCount < outputSlices.size());
 
 			//process all the slices originating from point clouds
-			for (size_t i = 0; i < cloudSliceCount; ++i)
+			//(the contours are extracted concurrently, by batches, then collected in the slices order)
+			const int batchSize = (visualDebugMode ? 1 : 64);
+			std::vector< std::vector<ccPolyline*> > batchPolys;
+			std::vector<int> batchStatus; //1 = success, 0 = failure, -1 = not enough memory
+			for (size_t batchStart = 0; batchStart < cloudSliceCount && !error; batchStart += static_cast<size_t>(batchSize))
 			{
-				ccPointCloud* sliceCloud = ccHObjectCaster::ToPointCloud(outputSlices[i]);
-				assert(sliceCloud);
-
-				std::vector<ccPolyline*> polys;
-				if (ccContourExtractor::ExtractFlatContour(sliceCloud,
-					multiPass,
-					maxEdgeLength,
-					polys,
-					splitContours,
-					preferredOrientation,
-					visualDebugMode))
+				int currentBatchSize = static_cast<int>(std::min(cloudSliceCount - batchStart, static_cast<size_t>(batchSize)));
+				batchPolys.clear();
+				batchPolys.resize(currentBatchSize);
+				batchStatus.assign(currentBatchSize, 0);
+
+#if defined(_OPENMP)
+				#pragma omp parallel for schedule(dynamic) if(!visualDebugMode)
+#endif
+				for (int bi = 0; bi < currentBatchSize; ++bi)
 				{
-					if (!polys.empty())
+					ccPointCloud* sliceCloud = ccHObjectCaster::ToPointCloud(outputSlices[batchStart + bi]);
+					assert(sliceCloud);
+
+					try
+					{
+						batchStatus[bi] = ccContourExtractor::ExtractFlatContour(sliceCloud,
+							multiPass,
+							maxEdgeLength,
+							batchPolys[bi],
+							splitContours,
+							preferredOrientation,
+							visualDebugMode) ? 1 : 0;
+					}
+					catch (const std::bad_alloc&)
 					{
-						for (size_t p = 0; p < polys.size(); ++p)
+						//exceptions can't cross the parallel region boundary
+						batchStatus[bi] = -1;
+					}
+				}
+
+				for (int bi = 0; bi < currentBatchSize; ++bi)
+				{
+					ccPointCloud* sliceCloud = ccHObjectCaster::ToPointCloud(outputSlices[batchStart + bi]);
+					std::vector<ccPolyline*>& polys = batchPolys[bi];
+
+					if (error || batchStatus[bi] < 0)
+					{
+						if (!error)
+						{
+							ccLog::Error("Not enough memory!");
+							error = true;
+						}
+						for (ccPolyline* poly : polys)
+						{
+							delete poly;
+						}
+						continue;
+					}
+
+					if (batchStatus[bi] != 0)
+					{
+						if (!polys.empty())
 						{
-							ccPolyline* poly = polys[p];
-							poly->setColor(ccColor::green);
-							poly->showColors(true);
-							poly->setGlobalScale(sliceCloud->getGlobalScale());
-							poly->setGlobalShift(sliceCloud->getGlobalShift());
-							QString contourName = sliceCloud->getName();
-							contourName.replace("slice", "contour");
-							if (polys.size() > 1)
+							for (size_t p = 0; p < polys.size(); ++p)
 							{
-								contourName += QString(" (part %1)").arg(p + 1);
+								ccPolyline* poly = polys[p];
+								poly->setColor(ccColor::green);
+								poly->showColors(true);
+								poly->setGlobalScale(sliceCloud->getGlobalScale());
+								poly->setGlobalShift(sliceCloud->getGlobalShift());
+								QString contourName = sliceCloud->getName();
+								contourName.replace("slice", "contour");
+								if (polys.size() > 1)
+								{
+									contourName += QString(" (part %1)").arg(p + 1);
+								}
+								poly->setName(contourName);
+								outputContours.push_back(poly);
 							}
-							poly->setName(contourName);
-							outputContours.push_back(poly);
+						}
+						else
+						{
+							ccLog::Warning(QString("%1: points are too far from each other! Increase the max edge length").arg(sliceCloud->getName()));
+							warningsIssued = true;
 						}
 					}
 					else
 					{
-						ccLog::Warning(QString("%1: points are too far from each other! Increase the max edge length").arg(sliceCloud->getName()));
+						ccLog::Warning(QString("%1: contour extraction failed!").arg(sliceCloud->getName()));
 						warningsIssued = true;
 					}
 				}
-				else
-				{
-					ccLog::Warning(QString("%1: contour extraction failed!").arg(sliceCloud->getName()));
-					warningsIssued = true;
-				}
 
-				if (progressDialog && !visualDebugMode)
+				if (!error && progressDialog && !visualDebugMode)
 				{
 					if (progressDialog->wasCanceled())
 					{
@@ -965,7 +1080,8 @@ bool ccClippingBoxTool::ExtractSlicesAndContours
 						//early stop
 						break;
 					}
-					progressDialog->setValue(static_cast<int>(i));
+					progressDialog->setValue(static_cast<int>(batchStart) + currentBatchSize);
+					QApplication::processEvents();
 				}
 			}
 
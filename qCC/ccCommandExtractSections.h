@@ -0,0 +1,272 @@
+#ifndef COMMAND_EXTRACT_SECTIONS_HEADER
+#define COMMAND_EXTRACT_SECTIONS_HEADER
+
+#include "ccCommandLineInterface.h"
+
+//Local
+#include "ccBatchSectionExtractor.h"
+
+//qCC_db
+#include <ccPointCloud.h>
+#include <ccPolyline.h>
+#include <ccProgressDialog.h>
+
+//Qt
+#include <QScopedPointer>
+#include <QStringList>
+
+//sub-options
+static const char COMMAND_EXTRACT_SECTIONS_THICKNESS[]			= "THICKNESS";			//+ section thickness
+static const char COMMAND_EXTRACT_SECTIONS_VERT_DIR[]			= "VERT_DIR";			//+ vertical dimension (0 = X, 1 = Y, 2 = Z)
+static const char COMMAND_EXTRACT_SECTIONS_OUTPUT[]				= "OUTPUT";				//+ comma separated list of outputs (CLOUDS,CONTOURS)
+static const char COMMAND_EXTRACT_SECTIONS_CONTOUR_TYPE[]		= "CONTOUR_TYPE";		//+ LOWER/UPPER/FULL
+static const char COMMAND_EXTRACT_SECTIONS_MAX_EDGE_LENGTH[]	= "MAX_EDGE_LENGTH";	//+ contour max edge length
+static const char COMMAND_EXTRACT_SECTIONS_MULTI_PASS[]			= "MULTI_PASS";			//multi-pass contour extraction
+static const char COMMAND_EXTRACT_SECTIONS_SPLIT[]				= "SPLIT";				//split the contours
+
+//! Extracts the loaded clouds along the polylines of a file ('-EXTRACT_SECTIONS {polylines file} -THICKNESS {value} [options]')
+/** Command line counterpart of the 'Extract points' action of the section extraction tool
+	(see ccBatchSectionExtractor). All the loaded clouds are considered together. The section
+	clouds are saved with the current cloud output format, and the contours of all the sections
+	are saved in a single file with the current mesh output format (BIN by default).
+**/
+struct CommandExtractSections : public ccCommandLineInterface::Command
+{
+	CommandExtractSections() : ccCommandLineInterface::Command("Extract sections", COMMAND_EXTRACT_SECTIONS) {}
+
+	//! Reads a number
+	static bool ReadNumber(ccCommandLineInterface& cmd, const char* keyword, const QString& what, double& value)
+	{
+		if (cmd.arguments().empty())
+			return cmd.error(QString("Missing parameter: %1 after \"-%2\"").arg(what, keyword));
+
+		bool ok = false;
+		QString valueStr = cmd.arguments().takeFirst();
+		value = valueStr.toDouble(&ok);
+		if (!ok)
+			return cmd.error(QString("Invalid parameter: %1 after \"-%2\" (got '%3')").arg(what, keyword, valueStr));
+
+		return true;
+	}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		cmd.print("[EXTRACT SECTIONS]");
+
+		if (cmd.arguments().empty())
+			return cmd.error(QString("Missing parameter: polylines file after \"-%1\"").arg(COMMAND_EXTRACT_SECTIONS));
+		QString polylinesFilename = cmd.arguments().takeFirst();
+
+		ccBatchSectionExtractor::Parameters params;
+		unsigned char vertDim = 2;
+
+		//optional parameters
+		while (!cmd.arguments().empty())
+		{
+			QString argument = cmd.arguments().front();
+			if (ccCommandLineInterface::IsCommand(argument, COMMAND_EXTRACT_SECTIONS_THICKNESS))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (!ReadNumber(cmd, COMMAND_EXTRACT_SECTIONS_THICKNESS, "section thickness", params.thickness))
+					return false;
+				if (params.thickness <= 0)
+					return cmd.error(QString("Invalid section thickness after \"-%1\"").arg(COMMAND_EXTRACT_SECTIONS_THICKNESS));
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_EXTRACT_SECTIONS_VERT_DIR))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				double dim = 2;
+				if (!ReadNumber(cmd, COMMAND_EXTRACT_SECTIONS_VERT_DIR, "vertical dimension", dim))
+					return false;
+				if (dim != 0 && dim != 1 && dim != 2)
+					return cmd.error(QString("Invalid vertical dimension after \"-%1\" (0, 1 or 2 expected)").arg(COMMAND_EXTRACT_SECTIONS_VERT_DIR));
+				vertDim = static_cast<unsigned char>(dim);
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_EXTRACT_SECTIONS_OUTPUT))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (cmd.arguments().empty())
+					return cmd.error(QString("Missing parameter: list of outputs after \"-%1\"").arg(COMMAND_EXTRACT_SECTIONS_OUTPUT));
+
+				params.extractClouds = params.extractContours = false;
+				QStringList outputs = cmd.arguments().takeFirst().toUpper().split(',', QString::SkipEmptyParts);
+				for (const QString& output : outputs)
+				{
+					if (output == "CLOUDS")
+						params.extractClouds = true;
+					else if (output == "CONTOURS")
+						params.extractContours = true;
+					else
+						return cmd.error(QString("Invalid output after \"-%1\" (got '%2')").arg(COMMAND_EXTRACT_SECTIONS_OUTPUT, output));
+				}
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_EXTRACT_SECTIONS_CONTOUR_TYPE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (cmd.arguments().empty())
+					return cmd.error(QString("Missing parameter: contour type after \"-%1\"").arg(COMMAND_EXTRACT_SECTIONS_CONTOUR_TYPE));
+
+				QString name = cmd.arguments().takeFirst().toUpper();
+				if (name == "LOWER")
+					params.contourType = ccContourExtractor::LOWER;
+				else if (name == "UPPER")
+					params.contourType = ccContourExtractor::UPPER;
+				else if (name == "FULL")
+					params.contourType = ccContourExtractor::FULL;
+				else
+					return cmd.error(QString("Invalid contour type after \"-%1\" (got '%2')").arg(COMMAND_EXTRACT_SECTIONS_CONTOUR_TYPE, name));
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_EXTRACT_SECTIONS_MAX_EDGE_LENGTH))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				double maxEdgeLength = 0;
+				if (!ReadNumber(cmd, COMMAND_EXTRACT_SECTIONS_MAX_EDGE_LENGTH, "max edge length", maxEdgeLength))
+					return false;
+				if (maxEdgeLength < 0)
+					return cmd.error(QString("Invalid max edge length after \"-%1\"").arg(COMMAND_EXTRACT_SECTIONS_MAX_EDGE_LENGTH));
+				params.maxEdgeLength = static_cast<PointCoordinateType>(maxEdgeLength);
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_EXTRACT_SECTIONS_MULTI_PASS))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				params.multiPass = true;
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_EXTRACT_SECTIONS_SPLIT))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				params.splitContours = true;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		if (params.thickness <= 0)
+			return cmd.error(QString("Missing parameter: section thickness (\"-%1 {value}\")").arg(COMMAND_EXTRACT_SECTIONS_THICKNESS));
+		if (!params.extractClouds && !params.extractContours)
+			return cmd.error(QString("No output selected after \"-%1\"").arg(COMMAND_EXTRACT_SECTIONS_OUTPUT));
+
+		if (cmd.clouds().empty())
+			return cmd.error(QString("No point cloud loaded (be sure to open at least one file with \"-%1 [filename]\" before \"-%2\")").arg(COMMAND_OPEN, COMMAND_EXTRACT_SECTIONS));
+
+		//load the polylines (with the same loading parameters as the clouds, so that they get the same global shift)
+		CC_FILE_ERROR result = CC_FERR_NO_ERROR;
+		QScopedPointer<ccHObject> polylinesContainer(FileIOFilter::LoadFromFile(polylinesFilename, cmd.fileLoadingParams(), result));
+		if (!polylinesContainer)
+			return cmd.error(QString("Failed to load the polylines file '%1'").arg(polylinesFilename));
+
+		std::vector<ccPolyline*> polylines;
+		{
+			ccHObject::Container polylineEntities;
+			polylinesContainer->filterChildren(polylineEntities, true, CC_TYPES::POLY_LINE);
+			for (ccHObject* entity : polylineEntities)
+			{
+				ccPolyline* poly = static_cast<ccPolyline*>(entity);
+				if (poly->size() > 1)
+					polylines.push_back(poly);
+			}
+		}
+		if (polylines.empty())
+			return cmd.error(QString("No (valid) polyline in file '%1'").arg(polylinesFilename));
+
+		cmd.print(QString("%1 section(s) loaded").arg(polylines.size()));
+
+		std::vector<ccGenericPointCloud*> clouds;
+		for (CLCloudDesc& desc : cmd.clouds())
+		{
+			clouds.push_back(desc.pc);
+		}
+
+		QScopedPointer<ccProgressDialog> progressDialog(0);
+		if (!cmd.silentMode())
+		{
+			progressDialog.reset(new ccProgressDialog(true, cmd.widgetParent()));
+			progressDialog->setAutoClose(false);
+		}
+
+		//the clouds are indexed once, then all the sections are extracted at once
+		ccBatchSectionExtractor extractor(vertDim);
+		std::vector<ccBatchSectionExtractor::Section> sections;
+		if (	!extractor.setClouds(clouds, params.thickness, progressDialog.data())
+			||	!extractor.extractSections(polylines, params, sections, progressDialog.data()))
+		{
+			//the sections extracted before a cancellation are kept by the extractor
+			ccBatchSectionExtractor::ReleaseSections(sections);
+			return cmd.error("Failed to extract the sections (not enough memory?)");
+		}
+
+		//save the outputs (next to the first cloud)
+		const CLCloudDesc& firstDesc = cmd.clouds().front();
+		ccHObject contours("Section contours");
+		unsigned cloudCount = 0;
+		QString errorStr;
+		for (size_t i = 0; i < sections.size(); ++i)
+		{
+			ccBatchSectionExtractor::Section& section = sections[i];
+
+			if (section.cloud && errorStr.isEmpty())
+			{
+				section.cloud->setName(QString("Section cloud #%1").arg(i + 1));
+				CLCloudDesc desc(section.cloud, QString("%1_SECTION_%2").arg(firstDesc.basename).arg(i + 1), firstDesc.path);
+				errorStr = cmd.exportEntity(desc);
+				++cloudCount;
+			}
+
+			for (size_t p = 0; p < section.contours.size(); ++p)
+			{
+				ccPolyline* contourPart = section.contours[p];
+				QString name = QString("Section contour #%1").arg(i + 1);
+				if (section.contours.size() > 1)
+					name += QString("(part %1/%2)").arg(p + 1).arg(section.contours.size());
+				contourPart->setName(name);
+				//copy meta-data (import for Mascaret export!)
+				const QVariantMap& metaData = polylines[i]->metaData();
+				for (QVariantMap::const_iterator it = metaData.begin(); it != metaData.end(); ++it)
+				{
+					contourPart->setMetaData(it.key(), it.value());
+				}
+				contours.addChild(contourPart);
+			}
+			section.contours.clear();
+		}
+		ccBatchSectionExtractor::ReleaseSections(sections);
+
+		if (!errorStr.isEmpty())
+			return cmd.error(errorStr);
+
+		cmd.print(QString("%1 section cloud(s) saved").arg(cloudCount));
+
+		if (contours.getChildrenNumber() != 0)
+		{
+			CLGroupDesc desc(&contours, QString("%1_SECTION_CONTOURS").arg(firstDesc.basename), firstDesc.path);
+			errorStr = cmd.exportEntity(desc);
+			if (!errorStr.isEmpty())
+				return cmd.error(errorStr);
+
+			cmd.print(QString("%1 contour(s) saved").arg(contours.getChildrenNumber()));
+		}
+		else if (params.extractContours)
+		{
+			cmd.warning("No contour could be extracted (check the parameters)");
+		}
+
+		return true;
+	}
+};
+
+#endif //COMMAND_EXTRACT_SECTIONS_HEADER
@@ -95,6 +95,7 @@ static const char COMMAND_DELAUNAY[]						= "DELAUNAY";
 static const char COMMAND_DELAUNAY_AA[]						= "AA";
 static const char COMMAND_DELAUNAY_BF[]						= "BEST_FIT";
 static const char COMMAND_DELAUNAY_MAX_EDGE_LENGTH[]		= "MAX_EDGE_LENGTH";
+static const char COMMAND_DELAUNAY_POINTS_PER_TILE[]		= "POINTS_PER_TILE";
 static const char COMMAND_SF_ARITHMETIC[]					= "SF_ARITHMETIC";
 static const char COMMAND_SF_OP[]							= "SF_OP";
 static const char COMMAND_COORD_TO_SF[]						= "COORD_TO_SF";
@@ -117,6 +118,10 @@ static const char COMMAND_ICP_USE_DATA_SF_AS_WEIGHT[]		= "DATA_SF_AS_WEIGHTS";
 static const char COMMAND_FBX_EXPORT_FORMAT[]				= "FBX_EXPORT_FMT";
 static const char COMMAND_PLY_EXPORT_FORMAT[]				= "PLY_EXPORT_FMT";
 static const char COMMAND_COMPUTE_GRIDDED_NORMALS[]			= "COMPUTE_NORMALS";
+static const char COMMAND_STREAM[]							= "STREAM";			//+ input file + output file + operations
+static const char COMMAND_RENDER[]							= "RENDER";			//+ options (see ccCommandRender.h)
+static const char COMMAND_RASTERIZE[]						= "RASTERIZE";		//+ options (see ccCommandRasterize.h)
+static const char COMMAND_EXTRACT_SECTIONS[]					= "EXTRACT_SECTIONS";	//+ polylines file + options (see ccCommandExtractSections.h)
 static const char COMMAND_SAVE_CLOUDS[]						= "SAVE_CLOUDS";
 static const char COMMAND_SAVE_MESHES[]						= "SAVE_MESHES";
 static const char COMMAND_AUTO_SAVE[]						= "AUTO_SAVE";
@@ -1924,9 +1929,16 @@ struct CommandCrop : public ccCommandLineInterface::Command
 		ccBBox cropBox(boxMin, boxMax);
 		//crop clouds
 		{
+			QScopedPointer<ccProgressDialog> progressDialog(0);
+			if (!cmd.silentMode())
+			{
+				progressDialog.reset(new ccProgressDialog(true, cmd.widgetParent()));
+				progressDialog->setAutoClose(false);
+			}
+
 			for (size_t i = 0; i < cmd.clouds().size(); ++i)
 			{
-				ccHObject* croppedCloud = ccCropTool::Crop(cmd.clouds()[i].pc, cropBox, inside);
+				ccHObject* croppedCloud = ccCropTool::Crop(cmd.clouds()[i].pc, cropBox, inside, 0, progressDialog.data());
 				if (croppedCloud)
 				{
 					delete cmd.clouds()[i].pc;
@@ -2111,10 +2123,17 @@ struct CommandCrop2D : public ccCommandLineInterface::Command
 		}
 	}
 
+	QScopedPointer<ccProgressDialog> progressDialog(0);
+	if (!cmd.silentMode())
+	{
+		progressDialog.reset(new ccProgressDialog(true, cmd.widgetParent()));
+		progressDialog->setAutoClose(false);
+	}
+
 	//now we can crop the loaded cloud(s)
 	for (size_t i = 0; i < cmd.clouds().size(); ++i)
 	{
-		CCLib::ReferenceCloud* ref = cmd.clouds()[i].pc->crop2D(&poly, orthoDim, inside);
+		CCLib::ReferenceCloud* ref = cmd.clouds()[i].pc->crop2D(&poly, orthoDim, inside, progressDialog.data());
 		if (ref)
 		{
 			if (ref->size() != 0)
@@ -2766,6 +2785,8 @@ struct CommandDelaunayTri : public ccCommandLineInterface::Command
 
 		bool axisAligned = true;
 		double maxEdgeLength = 0;
+		//the axis-aligned triangulation is computed tile by tile
+		ccTiledDelaunay::Parameters tiledParams;
 
 		while (!cmd.arguments().empty())
 		{
@@ -2795,6 +2816,19 @@ struct CommandDelaunayTri : public ccCommandLineInterface::Command
 					return cmd.error(QString("Invalid value for max edge length! (after %1)").arg(COMMAND_DELAUNAY_MAX_EDGE_LENGTH));
 				cmd.print(QString("Max edge length: %1").arg(maxEdgeLength));
 			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_DELAUNAY_POINTS_PER_TILE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (cmd.arguments().empty())
+					return cmd.error(QString("Missing parameter: number of points after '%1'").arg(COMMAND_DELAUNAY_POINTS_PER_TILE));
+				bool ok;
+				tiledParams.pointsPerTile = cmd.arguments().takeFirst().toUInt(&ok);
+				if (!ok || tiledParams.pointsPerTile == 0)
+					return cmd.error(QString("Invalid number of points per tile! (after %1)").arg(COMMAND_DELAUNAY_POINTS_PER_TILE));
+				cmd.print(QString("Points per tile: %1").arg(tiledParams.pointsPerTile));
+			}
 			else
 			{
 				break;
@@ -2802,6 +2836,8 @@ struct CommandDelaunayTri : public ccCommandLineInterface::Command
 		}
 
 		cmd.print(QString("Axis aligned: %1").arg(axisAligned ? "yes" : "no"));
+		tiledParams.dim = 2; //XY plane by default
+		tiledParams.maxEdgeLength = static_cast<PointCoordinateType>(maxEdgeLength);
 
 		//try to triangulate each cloud
 		for (size_t i = 0; i < cmd.clouds().size(); ++i)
@@ -2809,12 +2845,20 @@ struct CommandDelaunayTri : public ccCommandLineInterface::Command
 			ccPointCloud* cloud = cmd.clouds()[i].pc;
 			cmd.print(QString("\tProcessing cloud #%1 (%2)").arg(i + 1).arg(!cloud->getName().isEmpty() ? cloud->getName() : "no name"));
 
-			ccMesh* mesh = ccMesh::Triangulate(cloud,
-				axisAligned ? DELAUNAY_2D_AXIS_ALIGNED : DELAUNAY_2D_BEST_LS_PLANE,
-				false,
-				static_cast<PointCoordinateType>(maxEdgeLength),
-				2 //XY plane by default
-				);
+			ccMesh* mesh = 0;
+			if (axisAligned)
+			{
+				mesh = ccLibAlgorithms::ComputeTiledDelaunay(cloud, tiledParams, false, cmd.widgetParent(), !cmd.silentMode());
+			}
+			else
+			{
+				mesh = ccMesh::Triangulate(cloud,
+					DELAUNAY_2D_BEST_LS_PLANE,
+					false,
+					static_cast<PointCoordinateType>(maxEdgeLength),
+					2 //XY plane by default
+					);
+			}
 
 			if (mesh)
 			{
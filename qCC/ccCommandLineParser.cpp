@@ -3,6 +3,10 @@
 //Local
 #include "ccCommandLineCommands.h"
 #include "ccCommandCrossSection.h"
+#include "ccCommandStream.h"
+#include "ccCommandRender.h"
+#include "ccCommandRasterize.h"
+#include "ccCommandExtractSections.h"
 
 //qCC_db
 #include <ccProgressDialog.h>
@@ -187,6 +191,10 @@ ccCommandLineParser::ccCommandLineParser()
 	registerCommand(Command::Shared(new CommandPopMeshes));
 	registerCommand(Command::Shared(new CommandSetNoTimestamp));
 	registerCommand(Command::Shared(new CommandVolume25D));
+	registerCommand(Command::Shared(new CommandStream));
+	registerCommand(Command::Shared(new CommandRender));
+	registerCommand(Command::Shared(new CommandRasterize));
+	registerCommand(Command::Shared(new CommandExtractSections));
 	//registerCommand(Command::Shared(new XXX));
 	//registerCommand(Command::Shared(new XXX));
 	//registerCommand(Command::Shared(new XXX));
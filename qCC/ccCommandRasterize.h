@@ -0,0 +1,328 @@
+#ifndef COMMAND_RASTERIZE_HEADER
+#define COMMAND_RASTERIZE_HEADER
+
+#include "ccCommandLineInterface.h"
+
+//Local
+#include "ccTiledRasterExport.h"
+
+//qCC_db
+#include <ccPointCloud.h>
+#include <ccProgressDialog.h>
+
+//Qt
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QStringList>
+
+//sub-options
+static const char COMMAND_RASTERIZE_GRID_STEP[]				= "GRID_STEP";		//+ grid step
+static const char COMMAND_RASTERIZE_VERT_DIR[]				= "VERT_DIR";		//+ vertical dimension (0 = X, 1 = Y, 2 = Z)
+static const char COMMAND_RASTERIZE_PROJ[]					= "PROJ";			//+ MIN/AVG/MAX/MED/PERC
+static const char COMMAND_RASTERIZE_PERCENTILE[]			= "PERCENTILE";		//+ percentile (between 0 and 100)
+static const char COMMAND_RASTERIZE_SF_PROJ[]				= "SF_PROJ";		//+ MIN/AVG/MAX
+static const char COMMAND_RASTERIZE_EMPTY_FILL[]			= "EMPTY_FILL";		//+ EMPTY/CUSTOM_H/INTERP
+static const char COMMAND_RASTERIZE_CUSTOM_HEIGHT[]			= "CUSTOM_HEIGHT";	//+ height of the empty cells
+static const char COMMAND_RASTERIZE_TILE_SIZE[]				= "TILE_SIZE";		//+ tile size (in cells, multiple of 16)
+static const char COMMAND_RASTERIZE_HALO[]					= "HALO";			//+ halo size (in cells)
+static const char COMMAND_RASTERIZE_TILE_COUNT[]			= "TILE_COUNT";		//+ max number of concurrent tiles
+static const char COMMAND_RASTERIZE_BANDS[]					= "BANDS";			//+ comma separated list of bands (HEIGHT,RGB,DENSITY,SF)
+static const char COMMAND_RASTERIZE_PYRAMID[]				= "PYRAMID";		//build the overviews
+static const char COMMAND_RASTERIZE_STREAM[]				= "STREAM";			//+ input file (read block by block instead of the loaded clouds)
+static const char COMMAND_RASTERIZE_BLOCK_SIZE[]			= "BLOCK_SIZE";		//+ number of points per block (with '-STREAM')
+
+//! Rasterizes the loaded clouds in tiled GeoTIFF files ('-RASTERIZE -GRID_STEP {value} [options]')
+/** The grid is processed tile by tile (see ccTiledRasterExport), so that very
+	large rasters can be generated with a bounded amount of memory.
+	With '-STREAM {file}', the file is rasterized block by block instead of the
+	loaded clouds (see ccTiledRasterExport::ExportStream), so that clouds that
+	don't fit in memory can be rasterized.
+**/
+struct CommandRasterize : public ccCommandLineInterface::Command
+{
+	CommandRasterize() : ccCommandLineInterface::Command("Rasterize", COMMAND_RASTERIZE) {}
+
+	//! Reads a number
+	static bool ReadNumber(ccCommandLineInterface& cmd, const char* keyword, const QString& what, double& value)
+	{
+		if (cmd.arguments().empty())
+			return cmd.error(QString("Missing parameter: %1 after \"-%2\"").arg(what, keyword));
+
+		bool ok = false;
+		QString valueStr = cmd.arguments().takeFirst();
+		value = valueStr.toDouble(&ok);
+		if (!ok)
+			return cmd.error(QString("Invalid parameter: %1 after \"-%2\" (got '%3')").arg(what, keyword, valueStr));
+
+		return true;
+	}
+
+	//! Reads a projection type
+	static bool ReadProjectionType(ccCommandLineInterface& cmd, const char* keyword, bool sfMode, ccRasterGrid::ProjectionType& type)
+	{
+		if (cmd.arguments().empty())
+			return cmd.error(QString("Missing parameter: projection type after \"-%1\"").arg(keyword));
+
+		QString name = cmd.arguments().takeFirst().toUpper();
+		if (name == "MIN")
+			type = ccRasterGrid::PROJ_MINIMUM_VALUE;
+		else if (name == "AVG")
+			type = ccRasterGrid::PROJ_AVERAGE_VALUE;
+		else if (name == "MAX")
+			type = ccRasterGrid::PROJ_MAXIMUM_VALUE;
+		else if (name == "MED" && !sfMode)
+			type = ccRasterGrid::PROJ_MEDIAN_VALUE;
+		else if (name == "PERC" && !sfMode)
+			type = ccRasterGrid::PROJ_PERCENTILE_VALUE;
+		else
+			return cmd.error(QString("Invalid projection type after \"-%1\" (got '%2')").arg(keyword, name));
+
+		return true;
+	}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		cmd.print("[RASTERIZE]");
+
+		ccTiledRasterExport::Parameters params;
+		params.gridStep = 0;
+		bool sfBands = false;
+		QString streamFilename;
+		unsigned blockSize = 1000000;
+
+		//optional parameters
+		while (!cmd.arguments().empty())
+		{
+			QString argument = cmd.arguments().front();
+			if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTERIZE_GRID_STEP))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (!ReadNumber(cmd, COMMAND_RASTERIZE_GRID_STEP, "grid step", params.gridStep))
+					return false;
+				if (params.gridStep <= 0)
+					return cmd.error(QString("Invalid grid step after \"-%1\"").arg(COMMAND_RASTERIZE_GRID_STEP));
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTERIZE_VERT_DIR))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				double dim = 2;
+				if (!ReadNumber(cmd, COMMAND_RASTERIZE_VERT_DIR, "vertical dimension", dim))
+					return false;
+				if (dim != 0 && dim != 1 && dim != 2)
+					return cmd.error(QString("Invalid vertical dimension after \"-%1\" (0, 1 or 2 expected)").arg(COMMAND_RASTERIZE_VERT_DIR));
+				params.Z = static_cast<unsigned char>(dim);
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTERIZE_PROJ))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (!ReadProjectionType(cmd, COMMAND_RASTERIZE_PROJ, false, params.projectionType))
+					return false;
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTERIZE_PERCENTILE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (!ReadNumber(cmd, COMMAND_RASTERIZE_PERCENTILE, "percentile", params.percentile))
+					return false;
+				if (params.percentile < 0 || params.percentile > 100)
+					return cmd.error(QString("Invalid percentile after \"-%1\" (between 0 and 100 expected)").arg(COMMAND_RASTERIZE_PERCENTILE));
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTERIZE_SF_PROJ))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (!ReadProjectionType(cmd, COMMAND_RASTERIZE_SF_PROJ, true, params.sfInterpolation))
+					return false;
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTERIZE_EMPTY_FILL))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (cmd.arguments().empty())
+					return cmd.error(QString("Missing parameter: empty cells strategy after \"-%1\"").arg(COMMAND_RASTERIZE_EMPTY_FILL));
+
+				QString name = cmd.arguments().takeFirst().toUpper();
+				if (name == "EMPTY")
+					params.emptyCellsStrategy = ccRasterGrid::LEAVE_EMPTY;
+				else if (name == "CUSTOM_H")
+					params.emptyCellsStrategy = ccRasterGrid::FILL_CUSTOM_HEIGHT;
+				else if (name == "INTERP")
+					params.emptyCellsStrategy = ccRasterGrid::INTERPOLATE;
+				else
+					return cmd.error(QString("Invalid empty cells strategy after \"-%1\" (got '%2')").arg(COMMAND_RASTERIZE_EMPTY_FILL, name));
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTERIZE_CUSTOM_HEIGHT))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (!ReadNumber(cmd, COMMAND_RASTERIZE_CUSTOM_HEIGHT, "custom height", params.customHeight))
+					return false;
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTERIZE_TILE_SIZE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				double tileSize = 0;
+				if (!ReadNumber(cmd, COMMAND_RASTERIZE_TILE_SIZE, "tile size", tileSize))
+					return false;
+				if (tileSize < 16 || static_cast<int>(tileSize) % 16 != 0)
+					return cmd.error(QString("Invalid tile size after \"-%1\" (multiple of 16 expected)").arg(COMMAND_RASTERIZE_TILE_SIZE));
+				params.tileSize = static_cast<unsigned>(tileSize);
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTERIZE_HALO))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				double haloSize = 0;
+				if (!ReadNumber(cmd, COMMAND_RASTERIZE_HALO, "halo size", haloSize))
+					return false;
+				if (haloSize < 0)
+					return cmd.error(QString("Invalid halo size after \"-%1\"").arg(COMMAND_RASTERIZE_HALO));
+				params.haloSize = static_cast<unsigned>(haloSize);
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTERIZE_TILE_COUNT))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				double tileCount = 0;
+				if (!ReadNumber(cmd, COMMAND_RASTERIZE_TILE_COUNT, "max number of concurrent tiles", tileCount))
+					return false;
+				if (tileCount < 1)
+					return cmd.error(QString("Invalid number of concurrent tiles after \"-%1\"").arg(COMMAND_RASTERIZE_TILE_COUNT));
+				params.maxThreadCount = static_cast<int>(tileCount);
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTERIZE_BANDS))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (cmd.arguments().empty())
+					return cmd.error(QString("Missing parameter: list of bands after \"-%1\"").arg(COMMAND_RASTERIZE_BANDS));
+
+				params.exportHeights = params.exportRGB = params.exportDensity = false;
+				QStringList bands = cmd.arguments().takeFirst().toUpper().split(',', QString::SkipEmptyParts);
+				for (const QString& band : bands)
+				{
+					if (band == "HEIGHT")
+						params.exportHeights = true;
+					else if (band == "RGB")
+						params.exportRGB = true;
+					else if (band == "DENSITY")
+						params.exportDensity = true;
+					else if (band == "SF")
+						sfBands = true;
+					else
+						return cmd.error(QString("Invalid band after \"-%1\" (got '%2')").arg(COMMAND_RASTERIZE_BANDS, band));
+				}
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTERIZE_PYRAMID))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				params.buildOverviews = true;
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTERIZE_STREAM))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (cmd.arguments().empty())
+					return cmd.error(QString("Missing parameter: input filename after \"-%1\"").arg(COMMAND_RASTERIZE_STREAM));
+				streamFilename = cmd.arguments().takeFirst();
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTERIZE_BLOCK_SIZE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				double count = 0;
+				if (!ReadNumber(cmd, COMMAND_RASTERIZE_BLOCK_SIZE, "number of points", count))
+					return false;
+				if (count < 1)
+					return cmd.error(QString("Invalid block size after \"-%1\"").arg(COMMAND_RASTERIZE_BLOCK_SIZE));
+				blockSize = static_cast<unsigned>(count);
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		if (params.gridStep <= 0)
+			return cmd.error(QString("Missing parameter: grid step (\"-%1 {value}\")").arg(COMMAND_RASTERIZE_GRID_STEP));
+
+		if (streamFilename.isEmpty() && cmd.clouds().empty())
+			return cmd.error(QString("No point cloud loaded (be sure to open at least one file with \"-%1 [filename]\" before \"-%2\")").arg(COMMAND_OPEN, COMMAND_RASTERIZE));
+
+		//scalar fields are only exported if a projection type has been set
+		params.exportSFs = sfBands;
+		if (sfBands && params.sfInterpolation == ccRasterGrid::INVALID_PROJECTION_TYPE)
+		{
+			params.sfInterpolation = ccRasterGrid::PROJ_AVERAGE_VALUE;
+		}
+
+		if (!streamFilename.isEmpty())
+		{
+			//the file is never loaded as a whole
+			QFileInfo fi(streamFilename);
+			QString baseName = QString("%1_RASTER").arg(fi.completeBaseName());
+			if (cmd.addTimestamp())
+				baseName += QString("_%1").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd_hh'h'mm"));
+			QString outputFilename = fi.absoluteDir().absoluteFilePath(baseName + ".tif");
+
+			QScopedPointer<ccProgressDialog> progressDialog(0);
+			if (!cmd.silentMode())
+			{
+				progressDialog.reset(new ccProgressDialog(true, cmd.widgetParent()));
+				progressDialog->setAutoClose(false);
+			}
+
+			cmd.print(QString("Streaming file: '%1'").arg(streamFilename));
+			if (!ccTiledRasterExport::ExportStream(streamFilename, cmd.fileLoadingParams(), blockSize, params, outputFilename, progressDialog.data()))
+				return cmd.error(QString("Failed to rasterize file '%1'").arg(streamFilename));
+
+			cmd.print(QString("Raster '%1' saved").arg(outputFilename));
+			return true;
+		}
+
+		for (CLCloudDesc& desc : cmd.clouds())
+		{
+			QString baseName = QString("%1_RASTER").arg(desc.basename);
+			if (cmd.addTimestamp())
+				baseName += QString("_%1").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd_hh'h'mm"));
+			QString outputFilename = QDir(desc.path).absoluteFilePath(baseName + ".tif");
+
+			QScopedPointer<ccProgressDialog> progressDialog(0);
+			if (!cmd.silentMode())
+			{
+				progressDialog.reset(new ccProgressDialog(false, cmd.widgetParent()));
+				progressDialog->setAutoClose(false);
+			}
+
+			if (!ccTiledRasterExport::Export(desc.pc, params, outputFilename, progressDialog.data()))
+				return cmd.error(QString("Failed to rasterize cloud '%1'").arg(desc.pc->getName()));
+
+			cmd.print(QString("Raster '%1' saved").arg(outputFilename));
+		}
+
+		return true;
+	}
+};
+
+#endif //COMMAND_RASTERIZE_HEADER
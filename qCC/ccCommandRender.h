@@ -0,0 +1,263 @@
+#ifndef COMMAND_RENDER_HEADER
+#define COMMAND_RENDER_HEADER
+
+#include "ccCommandLineInterface.h"
+
+//qCC_db
+#include <ccGenericMesh.h>
+#include <ccPointCloud.h>
+
+//qCC_glWindow
+#include <ccOffscreenRenderer.h>
+
+//Qt
+#include <QDateTime>
+#include <QDir>
+
+//System
+#include <assert.h>
+#include <vector>
+
+//sub-options
+static const char COMMAND_RENDER_SIZE[]						= "SIZE";			//+ width + height (in pixels)
+static const char COMMAND_RENDER_VIEW[]						= "VIEW";			//+ TOP/BOTTOM/FRONT/BACK/LEFT/RIGHT/ISO1/ISO2
+static const char COMMAND_RENDER_CAMERA[]					= "CAMERA";			//+ center (X Y Z) + target (X Y Z)
+static const char COMMAND_RENDER_PERSPECTIVE[]				= "PERSPECTIVE";	//+ F.O.V. (in degrees)
+static const char COMMAND_RENDER_ZOOM[]						= "ZOOM";			//+ zoom factor
+static const char COMMAND_RENDER_POINT_SIZE[]				= "POINT_SIZE";		//+ point size (in pixels)
+static const char COMMAND_RENDER_FORMAT[]					= "FORMAT";			//+ image format (PNG, JPG, BMP, etc.)
+
+//! Renders the loaded entities in image files ('-RENDER [options]')
+/** The rendering is done offscreen (no window is displayed). All the loaded
+	clouds and meshes are rendered together, once per view. Each image name
+	ends with the view index, so that identical views don't overwrite each
+	other. Run CloudCompare with an EGL based Qt platform (e.g. '-platform
+	eglfs' with Mesa's surfaceless EGL platform) to use it on a machine without
+	any display.
+**/
+struct CommandRender : public ccCommandLineInterface::Command
+{
+	CommandRender() : ccCommandLineInterface::Command("Render", COMMAND_RENDER) {}
+
+	//! Reads a number
+	static bool ReadNumber(ccCommandLineInterface& cmd, const char* keyword, const QString& what, double& value)
+	{
+		if (cmd.arguments().empty())
+			return cmd.error(QString("Missing parameter: %1 after \"-%2\"").arg(what, keyword));
+
+		bool ok = false;
+		QString valueStr = cmd.arguments().takeFirst();
+		value = valueStr.toDouble(&ok);
+		if (!ok)
+			return cmd.error(QString("Invalid parameter: %1 after \"-%2\" (got '%3')").arg(what, keyword, valueStr));
+
+		return true;
+	}
+
+	//! Reads a standard view orientation
+	static bool ReadView(ccCommandLineInterface& cmd, ccOffscreenRenderer::View& view)
+	{
+		if (cmd.arguments().empty())
+			return cmd.error(QString("Missing parameter: view orientation after \"-%1\"").arg(COMMAND_RENDER_VIEW));
+
+		QString name = cmd.arguments().takeFirst().toUpper();
+		if (name == "TOP")
+			view.orientation = CC_TOP_VIEW;
+		else if (name == "BOTTOM")
+			view.orientation = CC_BOTTOM_VIEW;
+		else if (name == "FRONT")
+			view.orientation = CC_FRONT_VIEW;
+		else if (name == "BACK")
+			view.orientation = CC_BACK_VIEW;
+		else if (name == "LEFT")
+			view.orientation = CC_LEFT_VIEW;
+		else if (name == "RIGHT")
+			view.orientation = CC_RIGHT_VIEW;
+		else if (name == "ISO1")
+			view.orientation = CC_ISO_VIEW_1;
+		else if (name == "ISO2")
+			view.orientation = CC_ISO_VIEW_2;
+		else
+			return cmd.error(QString("Invalid view orientation after \"-%1\" (got '%2')").arg(COMMAND_RENDER_VIEW, name));
+
+		view.name = name;
+		return true;
+	}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		cmd.print("[RENDER]");
+
+		int width = 1024;
+		int height = 768;
+		bool perspective = false;
+		double fov_deg = 30.0;
+		double zoomFactor = 1.0;
+		double pointSize = 0.0;
+		QString format = "png";
+		std::vector<ccOffscreenRenderer::View> views;
+
+		//optional parameters
+		while (!cmd.arguments().empty())
+		{
+			QString argument = cmd.arguments().front();
+			if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_SIZE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				double w = 0, h = 0;
+				if (	!ReadNumber(cmd, COMMAND_RENDER_SIZE, "image width", w)
+					||	!ReadNumber(cmd, COMMAND_RENDER_SIZE, "image height", h))
+				{
+					return false;
+				}
+				if (w < 1 || h < 1)
+					return cmd.error(QString("Invalid image size after \"-%1\"").arg(COMMAND_RENDER_SIZE));
+				width = static_cast<int>(w);
+				height = static_cast<int>(h);
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_VIEW))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				ccOffscreenRenderer::View view;
+				if (!ReadView(cmd, view))
+					return false;
+				views.push_back(view);
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_CAMERA))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				ccOffscreenRenderer::View view;
+				view.customCamera = true;
+				if (	!ReadNumber(cmd, COMMAND_RENDER_CAMERA, "camera center (X)", view.cameraCenter.x)
+					||	!ReadNumber(cmd, COMMAND_RENDER_CAMERA, "camera center (Y)", view.cameraCenter.y)
+					||	!ReadNumber(cmd, COMMAND_RENDER_CAMERA, "camera center (Z)", view.cameraCenter.z)
+					||	!ReadNumber(cmd, COMMAND_RENDER_CAMERA, "camera target (X)", view.target.x)
+					||	!ReadNumber(cmd, COMMAND_RENDER_CAMERA, "camera target (Y)", view.target.y)
+					||	!ReadNumber(cmd, COMMAND_RENDER_CAMERA, "camera target (Z)", view.target.z))
+				{
+					return false;
+				}
+
+				CCVector3d forward = view.target - view.cameraCenter;
+				if (forward.norm2() == 0)
+					return cmd.error(QString("Camera center and target can't be the same (\"-%1\")").arg(COMMAND_RENDER_CAMERA));
+				if (forward.cross(view.up).norm2() == 0)
+				{
+					//vertical viewing direction
+					view.up = CCVector3d(0, 1, 0);
+				}
+
+				view.name = "CAMERA";
+				views.push_back(view);
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_PERSPECTIVE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (!ReadNumber(cmd, COMMAND_RENDER_PERSPECTIVE, "F.O.V. (in degrees)", fov_deg))
+					return false;
+				if (fov_deg <= 0 || fov_deg >= 180.0)
+					return cmd.error(QString("Invalid F.O.V. after \"-%1\"").arg(COMMAND_RENDER_PERSPECTIVE));
+				perspective = true;
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_ZOOM))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (!ReadNumber(cmd, COMMAND_RENDER_ZOOM, "zoom factor", zoomFactor))
+					return false;
+				if (zoomFactor <= 0)
+					return cmd.error(QString("Invalid zoom factor after \"-%1\"").arg(COMMAND_RENDER_ZOOM));
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_POINT_SIZE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (!ReadNumber(cmd, COMMAND_RENDER_POINT_SIZE, "point size", pointSize))
+					return false;
+				if (pointSize < 1)
+					return cmd.error(QString("Invalid point size after \"-%1\"").arg(COMMAND_RENDER_POINT_SIZE));
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RENDER_FORMAT))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (cmd.arguments().empty())
+					return cmd.error(QString("Missing parameter: image format after \"-%1\"").arg(COMMAND_RENDER_FORMAT));
+				format = cmd.arguments().takeFirst().toLower();
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		if (cmd.clouds().empty() && cmd.meshes().empty())
+			return cmd.error(QString("No entity loaded (be sure to open at least one file with \"-%1 [filename]\" before \"-%2\")").arg(COMMAND_OPEN, COMMAND_RENDER));
+
+		if (views.empty())
+		{
+			ccOffscreenRenderer::View view;
+			view.name = "ISO1";
+			views.push_back(view);
+		}
+
+		ccOffscreenRenderer renderer;
+		QString errorStr;
+		if (!renderer.init(width, height, errorStr))
+			return cmd.error(QString("Failed to initialize the offscreen renderer: %1").arg(errorStr));
+
+		renderer.setPerspective(perspective, static_cast<float>(fov_deg));
+		if (pointSize > 0)
+			renderer.setPointSize(static_cast<float>(pointSize));
+
+		//all the entities are rendered together (they are only uploaded once)
+		CLEntityDesc* firstDesc = 0;
+		for (CLCloudDesc& desc : cmd.clouds())
+		{
+			renderer.addEntity(desc.pc);
+			if (!firstDesc)
+				firstDesc = &desc;
+		}
+		for (CLMeshDesc& desc : cmd.meshes())
+		{
+			renderer.addEntity(desc.mesh);
+			if (!firstDesc)
+				firstDesc = &desc;
+		}
+		assert(firstDesc);
+
+		for (size_t i = 0; i < views.size(); ++i)
+		{
+			const ccOffscreenRenderer::View& view = views[i];
+			QImage image = renderer.render(view, static_cast<float>(zoomFactor));
+			if (image.isNull())
+				return cmd.error(QString("Failed to render view #%1 ('%2')").arg(i + 1).arg(view.name));
+
+			//the view index makes the name unique (the same view can be requested twice)
+			QString baseName = QString("%1_RENDER_%2_%3").arg(firstDesc->basename, view.name).arg(i + 1);
+			if (cmd.addTimestamp())
+				baseName += QString("_%1").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd_hh'h'mm"));
+			QString outputFilename = QDir(firstDesc->path).absoluteFilePath(baseName + "." + format);
+
+			if (!image.save(outputFilename))
+				return cmd.error(QString("Failed to save image '%1'").arg(outputFilename));
+
+			cmd.print(QString("Image '%1' saved (%2 x %3)").arg(outputFilename).arg(image.width()).arg(image.height()));
+		}
+
+		return true;
+	}
+};
+
+#endif //COMMAND_RENDER_HEADER
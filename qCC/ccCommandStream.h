@@ -0,0 +1,609 @@
+#ifndef COMMAND_STREAM_HEADER
+#define COMMAND_STREAM_HEADER
+
+#include "ccCommandLineInterface.h"
+
+//CCLib
+#include <CloudSamplingTools.h>
+#include <ManualSegmentationTools.h>
+#include <ReferenceCloud.h>
+
+//qCC_db
+#include <ccPointCloud.h>
+
+//qCC_io
+#include <ccPointStream.h>
+
+//qCC
+#include "ccScalarFieldArithmeticsDlg.h"
+
+//Qt
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QSharedPointer>
+
+//System
+#include <functional>
+#include <limits>
+#include <unordered_set>
+#include <vector>
+
+//sub-options
+static const char COMMAND_STREAM_BLOCK_SIZE[]				= "BLOCK_SIZE";		//+ number of points per block
+static const char COMMAND_STREAM_MAX_CELLS[]				= "MAX_CELLS";		//+ max number of cells (after '-SS SPATIAL step')
+
+//! Out-of-core conversion ('-STREAM input output [operations]')
+/** The input file is read block by block, each block is processed and
+	written to the output file right away: the whole cloud is never loaded
+	in memory. Only point-local operations are supported (they are applied
+	in the order they appear on the command line). The only exception is the
+	spatial subsampling ('-SS SPATIAL step [-MAX_CELLS count]'): the set of
+	occupied cells grows with the number of output points (it is capped).
+	An out-of-core LOD file (*.ooc) can be created this way (see OocFilter).
+**/
+struct CommandStream : public ccCommandLineInterface::Command
+{
+	CommandStream() : ccCommandLineInterface::Command("Stream", COMMAND_STREAM) {}
+
+	//! Default max number of cells for the streamed spatial subsampling (~ 1 GB)
+	static const size_t c_spatialSubsamplingMaxCellCount = (1 << 24);
+
+	//! Cell of the streamed spatial subsampling grid
+	struct CellKey
+	{
+		CellKey() { pos[0] = pos[1] = pos[2] = 0; }
+
+		int pos[3];
+
+		bool operator == (const CellKey& other) const { return pos[0] == other.pos[0] && pos[1] == other.pos[1] && pos[2] == other.pos[2]; }
+
+		struct Hash
+		{
+			size_t operator () (const CellKey& key) const
+			{
+				quint64 h = static_cast<quint32>(key.pos[0]);
+				h = h * 0x9E3779B97F4A7C15ULL + static_cast<quint32>(key.pos[1]);
+				h = h * 0x9E3779B97F4A7C15ULL + static_cast<quint32>(key.pos[2]);
+				return static_cast<size_t>(h ^ (h >> 32));
+			}
+		};
+	};
+
+	//! Block operation
+	/** \return false if an error occurred (the message is stored in 'error')
+	**/
+	typedef std::function<bool(ccPointCloud*& block, QString& error)> Operation;
+
+	//! Replaces a block by a subset of its points (or empties it)
+	static bool ReplaceBlock(ccPointCloud*& block, CCLib::ReferenceCloud* subset, QString& error)
+	{
+		if (!subset)
+		{
+			error = "Not enough memory";
+			return false;
+		}
+
+		if (subset->size() == block->size())
+		{
+			//nothing to do
+			return true;
+		}
+
+		if (subset->size() == 0)
+		{
+			block->clear();
+			return true;
+		}
+
+		ccPointCloud* newBlock = block->partialClone(subset);
+		if (!newBlock)
+		{
+			error = "Not enough memory";
+			return false;
+		}
+
+		delete block;
+		block = newBlock;
+		return true;
+	}
+
+	//! Reads a dimension (X, Y or Z)
+	static bool ReadDimension(ccCommandLineInterface& cmd, const char* keyword, unsigned char& dim, QString& dimStr)
+	{
+		if (cmd.arguments().empty())
+			return cmd.error(QString("Missing parameter: dimension after \"-%1\"").arg(keyword));
+
+		dimStr = cmd.arguments().takeFirst().toUpper();
+		if (dimStr == "X")
+			dim = 0;
+		else if (dimStr == "Y")
+			dim = 1;
+		else if (dimStr == "Z")
+			dim = 2;
+		else
+			return cmd.error(QString("Invalid parameter: dimension after \"-%1\" (expected: X, Y or Z)").arg(keyword));
+
+		return true;
+	}
+
+	//! Reads a number
+	static bool ReadNumber(ccCommandLineInterface& cmd, const char* keyword, const QString& what, double& value)
+	{
+		if (cmd.arguments().empty())
+			return cmd.error(QString("Missing parameter: %1 after \"-%2\"").arg(what, keyword));
+
+		bool ok = false;
+		QString valueStr = cmd.arguments().takeFirst();
+		value = valueStr.toDouble(&ok);
+		if (!ok)
+			return cmd.error(QString("Invalid parameter: %1 after \"-%2\" (got '%3')").arg(what, keyword, valueStr));
+
+		return true;
+	}
+
+	//! Reads a SF index (or 'LAST')
+	static bool ReadSFIndex(ccCommandLineInterface& cmd, const char* keyword, int& sfIndex)
+	{
+		if (cmd.arguments().empty())
+			return cmd.error(QString("Missing parameter: SF index after \"-%1\"").arg(keyword));
+
+		QString sfIndexStr = cmd.arguments().takeFirst();
+		if (sfIndexStr.toUpper() == OPTION_LAST)
+		{
+			sfIndex = -1;
+			return true;
+		}
+
+		bool ok = false;
+		sfIndex = sfIndexStr.toInt(&ok);
+		if (!ok || sfIndex < 0)
+			return cmd.error(QString("Invalid SF index! (after \"-%1\")").arg(keyword));
+
+		return true;
+	}
+
+	//! Converts a SF index (-1 = last) to an actual index
+	static int ActualSFIndex(const ccPointCloud* block, int sfIndex)
+	{
+		int sfCount = static_cast<int>(block->getNumberOfScalarFields());
+		if (sfIndex < 0)
+			return sfCount - 1;
+		return (sfIndex < sfCount ? sfIndex : -1);
+	}
+
+	virtual bool process(ccCommandLineInterface& cmd) override
+	{
+		cmd.print("[STREAM]");
+
+		if (cmd.arguments().size() < 2)
+			return cmd.error(QString("Missing parameter(s): input and output filenames after \"-%1\"").arg(COMMAND_STREAM));
+
+		QString inputFilename = cmd.arguments().takeFirst();
+		QString outputFilename = cmd.arguments().takeFirst();
+
+		unsigned blockSize = 1000000;
+		//local copy of the loading parameters (so that '-GLOBAL_SHIFT' only applies to this command)
+		ccCommandLineInterface::CLLoadParameters loadParams = cmd.fileLoadingParams();
+		loadParams.coordinatesShiftEnabled = &loadParams.m_coordinatesShiftEnabled;
+		loadParams.coordinatesShift = &loadParams.m_coordinatesShift;
+		std::vector<Operation> operations;
+
+		//random subsampling (the ratio depends on the number of points in the input file)
+		double randomTargetCount = -1.0;
+
+		//operations (applied in this order)
+		while (!cmd.arguments().empty())
+		{
+			QString argument = cmd.arguments().front();
+			if (ccCommandLineInterface::IsCommand(argument, COMMAND_STREAM_BLOCK_SIZE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				double count = 0;
+				if (!ReadNumber(cmd, COMMAND_STREAM_BLOCK_SIZE, "number of points", count))
+					return false;
+				if (count < 1)
+					return cmd.error(QString("Invalid block size (after \"-%1\")").arg(COMMAND_STREAM_BLOCK_SIZE));
+				blockSize = static_cast<unsigned>(count);
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_OPEN_SHIFT_ON_LOAD))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (cmd.arguments().empty())
+					return cmd.error(QString("Missing parameter: global shift vector or %1 after '%2'").arg(COMMAND_OPEN_SHIFT_ON_LOAD_AUTO).arg(COMMAND_OPEN_SHIFT_ON_LOAD));
+
+				loadParams.shiftHandlingMode = ccGlobalShiftManager::NO_DIALOG;
+				loadParams.m_coordinatesShiftEnabled = false;
+				loadParams.m_coordinatesShift = CCVector3d(0, 0, 0);
+
+				if (cmd.arguments().front().toUpper() == COMMAND_OPEN_SHIFT_ON_LOAD_AUTO)
+				{
+					cmd.arguments().pop_front();
+					loadParams.shiftHandlingMode = ccGlobalShiftManager::NO_DIALOG_AUTO_SHIFT;
+				}
+				else
+				{
+					CCVector3d shift;
+					if (	!ReadNumber(cmd, COMMAND_OPEN_SHIFT_ON_LOAD, "X coordinate of the global shift vector", shift.x)
+						||	!ReadNumber(cmd, COMMAND_OPEN_SHIFT_ON_LOAD, "Y coordinate of the global shift vector", shift.y)
+						||	!ReadNumber(cmd, COMMAND_OPEN_SHIFT_ON_LOAD, "Z coordinate of the global shift vector", shift.z))
+					{
+						return false;
+					}
+					loadParams.m_coordinatesShiftEnabled = true;
+					loadParams.m_coordinatesShift = shift;
+				}
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_DROP_GLOBAL_SHIFT))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				operations.push_back([](ccPointCloud*& block, QString&) -> bool
+				{
+					block->setGlobalShift(0, 0, 0);
+					return true;
+				});
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_APPLY_TRANSFORMATION))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (cmd.arguments().empty())
+					return cmd.error(QString("Missing parameter: transformation file after \"-%1\"").arg(COMMAND_APPLY_TRANSFORMATION));
+
+				QString filename = cmd.arguments().takeFirst();
+				ccGLMatrix mat;
+				if (!mat.fromAsciiFile(filename))
+					return cmd.error(QString("Failed to read transformation matrix file '%1'!").arg(filename));
+
+				cmd.print(QString("Transformation:\n") + mat.toString(6));
+				operations.push_back([mat](ccPointCloud*& block, QString&) -> bool
+				{
+					ccGLMatrix trans = mat;
+					block->applyGLTransformation_recursive(&trans);
+					return true;
+				});
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_SF_OP))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				int sfIndex = -1;
+				if (!ReadSFIndex(cmd, COMMAND_SF_OP, sfIndex))
+					return false;
+
+				if (cmd.arguments().empty())
+					return cmd.error(QString("Missing parameter: operation after \"-%1\"").arg(COMMAND_SF_OP));
+				QString opName = cmd.arguments().takeFirst();
+				ccScalarFieldArithmeticsDlg::Operation operation = ccScalarFieldArithmeticsDlg::GetOperationByName(opName);
+				if (operation == ccScalarFieldArithmeticsDlg::INVALID)
+					return cmd.error(QString("Unknown operation! (%1)").arg(opName));
+				else if (operation > ccScalarFieldArithmeticsDlg::DIVIDE)
+					return cmd.error(QString("Operation %1 can't be applied with %2").arg(opName, COMMAND_SF_OP));
+
+				double value = 0;
+				if (!ReadNumber(cmd, COMMAND_SF_OP, "scalar value", value))
+					return false;
+
+				operations.push_back([sfIndex, operation, value](ccPointCloud*& block, QString& error) -> bool
+				{
+					int index = ActualSFIndex(block, sfIndex);
+					if (index < 0)
+					{
+						error = QString("Invalid SF index (%1)").arg(sfIndex);
+						return false;
+					}
+
+					ccScalarFieldArithmeticsDlg::SF2 sf2;
+					sf2.isConstantValue = true;
+					sf2.constantValue = value;
+					if (!ccScalarFieldArithmeticsDlg::Apply(block, operation, index, true, &sf2))
+					{
+						error = "Failed to apply the SF operation";
+						return false;
+					}
+					return true;
+				});
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_SET_ACTIVE_SF))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				int sfIndex = -1;
+				if (!ReadSFIndex(cmd, COMMAND_SET_ACTIVE_SF, sfIndex))
+					return false;
+
+				operations.push_back([sfIndex](ccPointCloud*& block, QString& error) -> bool
+				{
+					int index = ActualSFIndex(block, sfIndex);
+					if (index < 0)
+					{
+						error = QString("Invalid SF index (%1)").arg(sfIndex);
+						return false;
+					}
+					block->setCurrentScalarField(index);
+					return true;
+				});
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_FILTER_SF_BY_VALUE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				//only explicit values can be used here (the SF statistics are unknown)
+				double minVal = 0, maxVal = 0;
+				if (	!ReadNumber(cmd, COMMAND_FILTER_SF_BY_VALUE, "min value", minVal)
+					||	!ReadNumber(cmd, COMMAND_FILTER_SF_BY_VALUE, "max value", maxVal))
+				{
+					return false;
+				}
+
+				operations.push_back([minVal, maxVal](ccPointCloud*& block, QString& error) -> bool
+				{
+					if (!block->getCurrentOutScalarField())
+					{
+						//use the last SF by default
+						if (block->getNumberOfScalarFields() == 0)
+						{
+							error = "No active scalar field";
+							return false;
+						}
+						block->setCurrentScalarField(static_cast<int>(block->getNumberOfScalarFields()) - 1);
+					}
+
+					QSharedPointer<CCLib::ReferenceCloud> subset(CCLib::ManualSegmentationTools::segment(block, static_cast<ScalarType>(minVal), static_cast<ScalarType>(maxVal)));
+					return ReplaceBlock(block, subset.data(), error);
+				});
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_SUBSAMPLE))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				if (cmd.arguments().empty())
+					return cmd.error(QString("Missing parameter: resampling method after \"-%1\"").arg(COMMAND_SUBSAMPLE));
+
+				QString method = cmd.arguments().takeFirst().toUpper();
+				if (method == "RANDOM")
+				{
+					if (randomTargetCount >= 0)
+						return cmd.error("Random subsampling can only be used once");
+					if (!ReadNumber(cmd, COMMAND_SUBSAMPLE, "number of points", randomTargetCount))
+						return false;
+
+					//the ratio will be set once the input file is opened
+					operations.push_back(Operation());
+				}
+				else if (method == "SPATIAL")
+				{
+					double step = 0;
+					if (!ReadNumber(cmd, COMMAND_SUBSAMPLE, "spatial step", step))
+						return false;
+					if (step <= 0)
+						return cmd.error(QString("Invalid step value for spatial resampling!"));
+
+					//we keep the first point of each cell of a regular grid
+					//(the set of occupied cells is shared by all the blocks)
+					//Warning: contrarily to the other operations, the memory consumption is not bounded
+					//by the block size: it grows with the number of output points (one cell per kept point).
+					//Hence the max number of cells (to fail properly instead of swapping)
+					size_t maxCellCount = c_spatialSubsamplingMaxCellCount;
+					if (!cmd.arguments().empty() && ccCommandLineInterface::IsCommand(cmd.arguments().front(), COMMAND_STREAM_MAX_CELLS))
+					{
+						//local option confirmed, we can move on
+						cmd.arguments().pop_front();
+
+						double count = 0;
+						if (!ReadNumber(cmd, COMMAND_STREAM_MAX_CELLS, "number of cells", count))
+							return false;
+						if (count < 1)
+							return cmd.error(QString("Invalid number of cells (after \"-%1\")").arg(COMMAND_STREAM_MAX_CELLS));
+						maxCellCount = static_cast<size_t>(count);
+					}
+					cmd.warning(QString("Streamed spatial subsampling: the memory consumption grows with the number of output points (%1 cells max.)").arg(maxCellCount));
+
+					QSharedPointer< std::unordered_set<CellKey, CellKey::Hash> > occupiedCells(new std::unordered_set<CellKey, CellKey::Hash>);
+					operations.push_back([step, maxCellCount, occupiedCells](ccPointCloud*& block, QString& error) -> bool
+					{
+						CCLib::ReferenceCloud subset(block);
+						try
+						{
+							for (unsigned i = 0; i < block->size(); ++i)
+							{
+								CCVector3d P = block->toGlobal3d<PointCoordinateType>(*block->getPoint(i));
+								CellKey cellKey;
+								for (unsigned d = 0; d < 3; ++d)
+								{
+									double cellPos = floor(P.u[d] / step);
+									if (cellPos < std::numeric_limits<int>::min() || cellPos > std::numeric_limits<int>::max())
+									{
+										error = "Spatial step too small (the grid is too large)";
+										return false;
+									}
+									cellKey.pos[d] = static_cast<int>(cellPos);
+								}
+								if (occupiedCells->insert(cellKey).second)
+								{
+									if (occupiedCells->size() > maxCellCount)
+									{
+										error = QString("Too many cells (> %1): increase the spatial step or the \"-%2\" option").arg(maxCellCount).arg(COMMAND_STREAM_MAX_CELLS);
+										return false;
+									}
+									if (!subset.addPointIndex(i))
+									{
+										error = "Not enough memory";
+										return false;
+									}
+								}
+							}
+						}
+						catch (const std::bad_alloc&)
+						{
+							error = "Not enough memory";
+							return false;
+						}
+
+						return ReplaceBlock(block, &subset, error);
+					});
+				}
+				else
+				{
+					return cmd.error(QString("Unknown or unhandled method (%1) for streamed resampling").arg(method));
+				}
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_COLOR_BANDING))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				unsigned char dim = 2;
+				QString dimStr;
+				double freq = 0;
+				if (	!ReadDimension(cmd, COMMAND_COLOR_BANDING, dim, dimStr)
+					||	!ReadNumber(cmd, COMMAND_COLOR_BANDING, "frequency", freq))
+				{
+					return false;
+				}
+
+				operations.push_back([dim, freq](ccPointCloud*& block, QString& error) -> bool
+				{
+					if (!block->setRGBColorByBanding(dim, freq))
+					{
+						error = "Not enough memory";
+						return false;
+					}
+					return true;
+				});
+			}
+			else if (ccCommandLineInterface::IsCommand(argument, COMMAND_COORD_TO_SF))
+			{
+				//local option confirmed, we can move on
+				cmd.arguments().pop_front();
+
+				unsigned char dim = 2;
+				QString dimStr;
+				if (!ReadDimension(cmd, COMMAND_COORD_TO_SF, dim, dimStr))
+					return false;
+
+				operations.push_back([dim, dimStr](ccPointCloud*& block, QString& error) -> bool
+				{
+					bool exportDims[3] = { false, false, false };
+					exportDims[dim] = true;
+					if (!block->exportCoordToSF(exportDims))
+					{
+						error = QString("Failed to export coord. %1 to SF").arg(dimStr);
+						return false;
+					}
+					return true;
+				});
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		//input file
+		FileIOFilter::Shared inputFilter = FileIOFilter::FindBestFilterForExtension(QFileInfo(inputFilename).suffix());
+		if (!inputFilter)
+			return cmd.error(QString("Can't guess file format: unhandled file extension '%1'").arg(QFileInfo(inputFilename).suffix()));
+
+		cmd.print(QString("Opening file: '%1'").arg(inputFilename));
+		CC_FILE_ERROR result = CC_FERR_NO_ERROR;
+		QScopedPointer<ccPointStreamReader> reader(inputFilter->openStreamReader(inputFilename, loadParams, result));
+		if (!reader)
+		{
+			if (result == CC_FERR_NOT_IMPLEMENTED)
+				return cmd.error(QString("Format '%1' can't be streamed").arg(inputFilter->getDefaultExtension()));
+			FileIOFilter::DisplayErrorMessage(result, "opening", inputFilename);
+			return false;
+		}
+
+		//output file
+		FileIOFilter::Shared outputFilter = FileIOFilter::FindBestFilterForExtension(QFileInfo(outputFilename).suffix());
+		if (!outputFilter)
+			return cmd.error(QString("Can't guess file format: unhandled file extension '%1'").arg(QFileInfo(outputFilename).suffix()));
+
+		QScopedPointer<ccPointStreamWriter> writer(outputFilter->openStreamWriter(outputFilename, result));
+		if (!writer)
+		{
+			if (result == CC_FERR_NOT_IMPLEMENTED)
+				return cmd.error(QString("Format '%1' can't be streamed").arg(outputFilter->getDefaultExtension()));
+			FileIOFilter::DisplayErrorMessage(result, "saving", outputFilename);
+			return false;
+		}
+
+		//now we can set the random subsampling ratio
+		if (randomTargetCount >= 0)
+		{
+			qint64 pointCount = reader->pointCount();
+			if (pointCount <= 0)
+				return cmd.error(QString("The number of points in '%1' is unknown: random subsampling can't be streamed").arg(inputFilename));
+
+			double ratio = std::min(1.0, randomTargetCount / pointCount);
+			cmd.print(QString("Random subsampling: %1% of the points will be kept").arg(ratio * 100.0));
+
+			//the fractional part of the expected count is carried from one block to the next
+			QSharedPointer<double> remainder(new double(0.0));
+			for (Operation& op : operations)
+			{
+				if (!op)
+				{
+					op = [ratio, remainder](ccPointCloud*& block, QString& error) -> bool
+					{
+						double expectedCount = ratio * block->size() + *remainder;
+						unsigned count = static_cast<unsigned>(expectedCount);
+						*remainder = expectedCount - count;
+
+						QSharedPointer<CCLib::ReferenceCloud> subset(CCLib::CloudSamplingTools::subsampleCloudRandomly(block, count));
+						return ReplaceBlock(block, subset.data(), error);
+					};
+				}
+			}
+		}
+
+		//process
+		QString errorStr;
+		qint64 blockIndex = 0;
+		qint64 pointsProcessed = 0;
+		ccPointStreamPipeline pipeline(blockSize);
+		result = pipeline.run(reader.data(), writer.data(), [&](ccPointCloud*& block) -> bool
+		{
+			pointsProcessed += block->size();
+			for (Operation& op : operations)
+			{
+				if (block->size() == 0)
+					break;
+				if (!op(block, errorStr))
+					return false;
+			}
+
+			if ((++blockIndex % 10) == 0)
+			{
+				cmd.print(QString("\t%1 points processed").arg(pointsProcessed));
+			}
+			return true;
+		});
+
+		if (!errorStr.isEmpty())
+			return cmd.error(QString("Failed to process block #%1: %2").arg(blockIndex + 1).arg(errorStr));
+		if (result != CC_FERR_NO_ERROR)
+		{
+			FileIOFilter::DisplayErrorMessage(result, "streaming", inputFilename);
+			return false;
+		}
+
+		cmd.print(QString("%1 points read, %2 points written to '%3'").arg(pipeline.pointsRead()).arg(pipeline.pointsWritten()).arg(outputFilename));
+
+		return true;
+	}
+};
+
+#endif //COMMAND_STREAM_HEADER
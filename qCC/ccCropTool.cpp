@@ -30,7 +30,7 @@
 #include <ManualSegmentationTools.h>
 #include <SimpleMesh.h>
 
-ccHObject* ccCropTool::Crop(ccHObject* entity, const ccBBox& box, bool inside/*=true*/, const ccGLMatrix* meshRotation/*=0*/)
+ccHObject* ccCropTool::Crop(ccHObject* entity, const ccBBox& box, bool inside/*=true*/, const ccGLMatrix* meshRotation/*=0*/, CCLib::GenericProgressCallback* progressCb/*=0*/)
 {
 	assert(entity);
 	if (!entity)
@@ -42,7 +42,7 @@ ccHObject* ccCropTool::Crop(ccHObject* entity, const ccBBox& box, bool inside/*=
 	{
 		ccPointCloud* cloud = static_cast<ccPointCloud*>(entity);
 
-		CCLib::ReferenceCloud* selection = cloud->crop(box, inside);
+		CCLib::ReferenceCloud* selection = cloud->crop(box, inside, progressCb);
 		if (!selection)
 		{
 			//process failed!
@@ -18,6 +18,9 @@
 #ifndef CC_CROP_TOOL_HEADER
 #define CC_CROP_TOOL_HEADER
 
+//CCLib
+#include <GenericProgressCallback.h>
+
 //qCC_db
 #include <ccBBox.h>
 
@@ -35,9 +38,10 @@ public:
 		\param box cropping box
 		\param inside whether to keep the points/triangles inside or outside the input box
 		\param meshRotation optional rotation (for meshes only)
+		\param progressCb optional progress callback (for clouds only)
 		\return cropped entity (if any)
 	**/
-	static ccHObject* Crop(ccHObject* entity, const ccBBox& box, bool inside = true, const ccGLMatrix* meshRotation = 0);
+	static ccHObject* Crop(ccHObject* entity, const ccBBox& box, bool inside = true, const ccGLMatrix* meshRotation = 0, CCLib::GenericProgressCallback* progressCb = 0);
 
 };
 
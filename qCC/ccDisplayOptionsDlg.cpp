@@ -20,6 +20,9 @@
 //local
 #include "ccQtHelpers.h"
 
+//qCC_db
+#include <ccPointCloud.h>
+
 //Qt
 #include <QColor>
 #include <QColorDialog>
@@ -54,6 +57,7 @@ ccDisplayOptionsDlg::ccDisplayOptionsDlg(QWidget* parent)
 	connect(decimateMeshBox,                 &QCheckBox::clicked, [&]() { parameters.decimateMeshOnMove = decimateMeshBox->isChecked(); });
 	connect(decimateCloudBox,                &QCheckBox::clicked, [&]() { parameters.decimateCloudOnMove = decimateCloudBox->isChecked(); });
 	connect(drawRoundedPointsCheckBox,       &QCheckBox::clicked, [&]() { parameters.drawRoundedPoints = drawRoundedPointsCheckBox->isChecked(); });
+	connect(saveLODWithCloudsCheckBox,       &QCheckBox::clicked, [&]() { parameters.saveLODWithClouds = saveLODWithCloudsCheckBox->isChecked(); });
 
 	connect(useVBOCheckBox,                  SIGNAL(clicked()),         this, SLOT(changeVBOUsage()));
 
@@ -140,6 +144,7 @@ void ccDisplayOptionsDlg::refresh()
 	decimateCloudBox->setChecked(parameters.decimateCloudOnMove);
 	drawRoundedPointsCheckBox->setChecked(parameters.drawRoundedPoints);
 	maxCloudSizeDoubleSpinBox->setValue(static_cast<double>(parameters.minLoDCloudSize)/1000000.0);
+	saveLODWithCloudsCheckBox->setChecked(parameters.saveLODWithClouds);
 	useVBOCheckBox->setChecked(parameters.useVBOs);
 	showCrossCheckBox->setChecked(parameters.displayCross);
 
@@ -434,6 +439,7 @@ void ccDisplayOptionsDlg::changeLabelMarkerSize(int val)
 void ccDisplayOptionsDlg::doReject()
 {
 	ccGui::Set(oldParameters);
+	ccPointCloud::SetLODSavedWithCloud(oldParameters.saveLODWithClouds);
 
 	emit aspectHasChanged();
 
@@ -449,6 +455,7 @@ void ccDisplayOptionsDlg::reset()
 void ccDisplayOptionsDlg::apply()
 {
 	ccGui::Set(parameters);
+	ccPointCloud::SetLODSavedWithCloud(parameters.saveLODWithClouds);
 
 	emit aspectHasChanged();
 }
@@ -0,0 +1,457 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: CloudCompare project                               #
+//#                                                                        #
+//##########################################################################
+
+#include "ccFileLoadQueue.h"
+
+//qCC_db
+#include <ccHObject.h>
+#include <ccLog.h>
+
+//qCC_glWindow
+#include <ccGLWindow.h>
+
+//Qt
+#include <QAction>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QMenu>
+#include <QMutexLocker>
+#include <QProgressBar>
+#include <QRunnable>
+#include <QThread>
+#include <QTimer>
+#include <QToolButton>
+
+//System
+#include <assert.h>
+#include <algorithm>
+#include <vector>
+
+//! Max number of files loaded at the same time in background
+static const int s_maxBackgroundLoads = 4;
+
+//! Loads a single file in a background thread
+class ccFileLoadQueue::BackgroundTask : public QRunnable
+{
+public:
+
+	BackgroundTask(ccFileLoadQueue* queue, JobPtr job)
+		: m_queue(queue)
+		, m_job(job)
+	{}
+
+	virtual void run() override
+	{
+		bool canceled = false;
+		{
+			QMutexLocker locker(&m_queue->m_mutex);
+			canceled = (m_job->state == JOB_CANCELED);
+			if (!canceled)
+			{
+				m_job->state = JOB_RUNNING;
+			}
+		}
+
+		if (!canceled)
+		{
+			//no dialog in background threads (except the 'global shift' one, which is displayed by the main thread)
+			FileIOFilter::LoadParameters parameters = m_job->batch->parameters;
+			parameters.alwaysDisplayLoadDialog = false;
+			parameters.parentWidget = 0;
+
+			CC_FILE_ERROR error = CC_FERR_NO_ERROR;
+			ccHObject* result = FileIOFilter::LoadFromFile(m_job->filename, parameters, m_job->filter, error);
+
+			QMutexLocker locker(&m_queue->m_mutex);
+			m_job->result = result;
+			m_job->error = error;
+		}
+
+		QMetaObject::invokeMethod(m_queue, "onBackgroundJobFinished", Qt::QueuedConnection, Q_ARG(int, m_job->id));
+	}
+
+protected:
+
+	ccFileLoadQueue* m_queue;
+	JobPtr m_job;
+};
+
+ccFileLoadQueue::ccFileLoadQueue(QWidget* parent)
+	: QObject(parent)
+	, m_nextJobID(1)
+	, m_foregroundJobRunning(false)
+	, m_fileCount(0)
+	, m_processedCount(0)
+	, m_loadedCount(0)
+	, m_parentWidget(parent)
+	, m_statusWidget(new QWidget)
+	, m_progressBar(new QProgressBar)
+	, m_cancelButton(new QToolButton)
+	, m_cancelMenu(new QMenu(m_cancelButton))
+{
+	m_pool.setMaxThreadCount(std::max(1, std::min(QThread::idealThreadCount(), s_maxBackgroundLoads)));
+
+	//status widget (overall progress + per-file cancellation)
+	QHBoxLayout* layout = new QHBoxLayout(m_statusWidget);
+	layout->setContentsMargins(0, 0, 0, 0);
+	layout->setSpacing(2);
+
+	m_progressBar->setFormat("Loading: %v / %m file(s)");
+	m_progressBar->setMaximumWidth(220);
+	m_progressBar->setMaximumHeight(16);
+	layout->addWidget(m_progressBar);
+
+	m_cancelButton->setText("Cancel");
+	m_cancelButton->setToolTip("Cancel the loading of one or all files");
+	m_cancelButton->setPopupMode(QToolButton::InstantPopup);
+	m_cancelButton->setMenu(m_cancelMenu);
+	layout->addWidget(m_cancelButton);
+
+	connect(m_cancelMenu, &QMenu::aboutToShow, this, &ccFileLoadQueue::updateCancelMenu);
+
+	m_statusWidget->setVisible(false);
+}
+
+ccFileLoadQueue::~ccFileLoadQueue()
+{
+	//no more entity should be sent
+	disconnect(this, 0, 0, 0);
+
+	cancelAll();
+
+	//we can't simply wait: a background thread may be waiting for the main thread (global shift dialog)
+	while (!m_pool.waitForDone(50))
+	{
+		QCoreApplication::processEvents();
+	}
+
+	for (JobPtr& job : m_jobs)
+	{
+		delete job->result;
+		job->result = 0;
+	}
+	m_jobs.clear();
+}
+
+void ccFileLoadQueue::load(const QStringList& filenames, QString fileFilter/*=QString()*/, ccGLWindow* destWin/*=0*/)
+{
+	if (filenames.isEmpty())
+		return;
+
+	//to use the same 'global shift' for multiple files
+	BatchPtr batch(new Batch);
+	{
+		batch->parameters.alwaysDisplayLoadDialog = true;
+		batch->parameters.shiftHandlingMode = ccGlobalShiftManager::DIALOG_IF_NECESSARY;
+		batch->parameters.coordinatesShift = &batch->coordinatesShift;
+		batch->parameters.coordinatesShiftEnabled = &batch->coordinatesShiftEnabled;
+		batch->parameters.parentWidget = m_parentWidget;
+		batch->destWin = destWin;
+	}
+
+	//if the right filter is specified by the caller
+	FileIOFilter::Shared selectedFilter(0);
+	if (!fileFilter.isEmpty())
+	{
+		selectedFilter = FileIOFilter::GetFilter(fileFilter, true);
+		if (!selectedFilter)
+		{
+			ccLog::Error(QString("[Load] Internal error: no I/O filter corresponds to filter '%1'").arg(fileFilter));
+			return;
+		}
+	}
+
+	bool foregroundJobs = false;
+	for (const QString& filename : filenames)
+	{
+		FileIOFilter::Shared filter = selectedFilter;
+		if (!filter) //we need to guess the I/O filter based on the file format
+		{
+			QString extension = QFileInfo(filename).suffix();
+			if (extension.isEmpty())
+			{
+				ccLog::Error(QString("[Load] Can't guess the format of file '%1': no file extension").arg(filename));
+				continue;
+			}
+
+			filter = FileIOFilter::FindBestFilterForExtension(extension);
+			if (!filter)
+			{
+				ccLog::Error(QString("[Load] Can't guess file format: unhandled file extension '%1'").arg(extension));
+				continue;
+			}
+		}
+
+		JobPtr job(new Job);
+		job->id = m_nextJobID++;
+		//the jobs may run after the current directory has changed (see main.cpp)
+		job->filename = QFileInfo(filename).absoluteFilePath();
+		job->filter = filter;
+		job->batch = batch;
+		job->background = filter->backgroundImportSupported();
+
+		{
+			QMutexLocker locker(&m_mutex);
+			m_jobs.push_back(job);
+		}
+		++m_fileCount;
+
+		if (job->background)
+		{
+			m_pool.start(new BackgroundTask(this, job));
+		}
+		else
+		{
+			foregroundJobs = true;
+		}
+	}
+
+	if (foregroundJobs)
+	{
+		QTimer::singleShot(0, this, SLOT(runNextForegroundJob()));
+	}
+
+	updateProgress();
+}
+
+void ccFileLoadQueue::runNextForegroundJob()
+{
+	if (m_foregroundJobRunning)
+	{
+		//will be called again once the current file is loaded
+		return;
+	}
+
+	JobPtr job;
+	{
+		QMutexLocker locker(&m_mutex);
+		for (const JobPtr& j : m_jobs)
+		{
+			if (!j->background && j->state == JOB_QUEUED)
+			{
+				job = j;
+				job->state = JOB_RUNNING;
+				break;
+			}
+		}
+	}
+	if (!job)
+	{
+		//nothing left to do
+		return;
+	}
+
+	m_foregroundJobRunning = true;
+	updateProgress();
+
+	//the loaders may process events in the meantime (progress dialogs, etc.)
+	CC_FILE_ERROR error = CC_FERR_NO_ERROR;
+	ccHObject* result = FileIOFilter::LoadFromFile(job->filename, job->batch->parameters, job->filter, error);
+	{
+		QMutexLocker locker(&m_mutex);
+		job->result = result;
+		job->error = error;
+	}
+
+	m_foregroundJobRunning = false;
+
+	if (error == CC_FERR_CANCELED_BY_USER)
+	{
+		//stop importing the other files of the same batch if the user has cancelled the current process!
+		std::vector<int> toCancel;
+		{
+			QMutexLocker locker(&m_mutex);
+			for (const JobPtr& j : m_jobs)
+			{
+				if (j != job && j->batch == job->batch && j->state == JOB_QUEUED)
+				{
+					toCancel.push_back(j->id);
+				}
+			}
+		}
+		for (int id : toCancel)
+		{
+			cancel(id);
+		}
+	}
+
+	finishJob(job);
+
+	QTimer::singleShot(0, this, SLOT(runNextForegroundJob()));
+}
+
+void ccFileLoadQueue::onBackgroundJobFinished(int jobID)
+{
+	JobPtr job;
+	{
+		QMutexLocker locker(&m_mutex);
+		for (const JobPtr& j : m_jobs)
+		{
+			if (j->id == jobID)
+			{
+				job = j;
+				break;
+			}
+		}
+	}
+
+	if (job)
+	{
+		finishJob(job);
+	}
+	else
+	{
+		assert(false);
+	}
+}
+
+void ccFileLoadQueue::finishJob(JobPtr job)
+{
+	ccHObject* result = 0;
+	bool canceled = false;
+	{
+		QMutexLocker locker(&m_mutex);
+		m_jobs.remove(job);
+		result = job->result;
+		job->result = 0;
+		canceled = (job->state == JOB_CANCELED);
+	}
+	++m_processedCount;
+
+	if (canceled)
+	{
+		if (result)
+		{
+			ccLog::Print(QString("[Load] File '%1' discarded (canceled by user)").arg(job->filename));
+			delete result;
+			result = 0;
+		}
+	}
+	else if (result)
+	{
+		++m_loadedCount;
+		emit fileLoaded(result, job->filename, job->batch->destWin.data());
+	}
+
+	if (m_jobs.empty())
+	{
+		int loadedCount = m_loadedCount;
+		int fileCount = m_fileCount;
+		m_fileCount = m_processedCount = m_loadedCount = 0;
+
+		emit allFilesProcessed(loadedCount, fileCount);
+	}
+
+	updateProgress();
+}
+
+void ccFileLoadQueue::cancel(int jobID)
+{
+	JobPtr job;
+	bool removeNow = false;
+	{
+		QMutexLocker locker(&m_mutex);
+		for (const JobPtr& j : m_jobs)
+		{
+			if (j->id == jobID)
+			{
+				job = j;
+				break;
+			}
+		}
+		if (!job || job->state == JOB_CANCELED)
+		{
+			return;
+		}
+
+		//the loaders can't be interrupted: if the file is being loaded, its content will simply be discarded
+		if (job->state == JOB_RUNNING)
+		{
+			ccLog::Print(QString("[Load] File '%1' will be discarded once loaded").arg(job->filename));
+		}
+		//queued files that are not handled by a thread can be removed right away
+		removeNow = (job->state == JOB_QUEUED && !job->background);
+		job->state = JOB_CANCELED;
+	}
+
+	if (removeNow)
+	{
+		finishJob(job);
+	}
+	else
+	{
+		updateProgress();
+	}
+}
+
+void ccFileLoadQueue::cancelAll()
+{
+	std::vector<int> ids;
+	{
+		QMutexLocker locker(&m_mutex);
+		for (const JobPtr& job : m_jobs)
+		{
+			ids.push_back(job->id);
+		}
+	}
+
+	for (int id : ids)
+	{
+		cancel(id);
+	}
+}
+
+void ccFileLoadQueue::updateProgress()
+{
+	if (m_jobs.empty())
+	{
+		m_statusWidget->setVisible(false);
+		return;
+	}
+
+	m_progressBar->setRange(0, m_fileCount);
+	m_progressBar->setValue(m_processedCount);
+	m_statusWidget->setVisible(true);
+}
+
+void ccFileLoadQueue::updateCancelMenu()
+{
+	m_cancelMenu->clear();
+
+	QAction* cancelAllAction = m_cancelMenu->addAction("Cancel all");
+	connect(cancelAllAction, &QAction::triggered, this, &ccFileLoadQueue::cancelAll);
+	m_cancelMenu->addSeparator();
+
+	QMutexLocker locker(&m_mutex);
+	for (const JobPtr& job : m_jobs)
+	{
+		if (job->state == JOB_CANCELED)
+			continue;
+
+		QString text = QFileInfo(job->filename).fileName();
+		if (job->state == JOB_RUNNING)
+		{
+			text += " (loading)";
+		}
+
+		int jobID = job->id;
+		QAction* action = m_cancelMenu->addAction(text);
+		action->setToolTip(job->filename);
+		connect(action, &QAction::triggered, this, [=]() { cancel(jobID); });
+	}
+}
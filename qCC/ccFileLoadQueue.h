@@ -0,0 +1,182 @@
+#ifndef CC_FILE_LOAD_QUEUE_HEADER
+#define CC_FILE_LOAD_QUEUE_HEADER
+
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: CloudCompare project                               #
+//#                                                                        #
+//##########################################################################
+
+//qCC_io
+#include <FileIOFilter.h>
+
+//Qt
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QThreadPool>
+
+//System
+#include <list>
+
+class QMenu;
+class QProgressBar;
+class QToolButton;
+class QWidget;
+class ccGLWindow;
+class ccHObject;
+
+//! Asynchronous file loading queue
+/** Files handled by a filter that supports background loading (see
+	FileIOFilter::backgroundImportSupported) are loaded concurrently by a
+	bounded pool of threads. The other files are loaded one after the other
+	by the main thread (with their usual dialogs).
+
+	Each loaded file is sent (in the main thread) as soon as it is ready.
+	A single progress indicator (with per-file cancellation) is provided.
+**/
+class ccFileLoadQueue : public QObject
+{
+	Q_OBJECT
+
+public:
+
+	//! Default constructor
+	/** \param parent parent widget (used for the dialogs)
+	**/
+	ccFileLoadQueue(QWidget* parent);
+
+	//! Destructor
+	/** Cancels all the pending files and waits for the running ones.
+	**/
+	virtual ~ccFileLoadQueue();
+
+	//! Queues a batch of files
+	/** All the files of a batch share the same loading parameters
+		(i.e. the same global shift if the user chooses to).
+		\param filenames files to load
+		\param fileFilter selected file filter (i.e. type) - empty to guess it from each file extension
+		\param destWin destination window (0 = active one)
+	**/
+	void load(const QStringList& filenames, QString fileFilter = QString(), ccGLWindow* destWin = 0);
+
+	//! Returns whether files are being loaded (or are waiting to be loaded)
+	bool isBusy() const { return !m_jobs.empty(); }
+
+	//! Returns the (status bar) widget displaying the overall progress
+	QWidget* statusWidget() { return m_statusWidget; }
+
+public slots:
+
+	//! Cancels all the files (queued or being loaded)
+	void cancelAll();
+
+signals:
+
+	//! Emitted (in the main thread) each time a file has been loaded
+	/** The receiver takes the ownership of the entity.
+	**/
+	void fileLoaded(ccHObject* entity, QString filename, ccGLWindow* destWin);
+
+	//! Emitted when all the queued files have been processed
+	void allFilesProcessed(int loadedCount, int fileCount);
+
+protected slots:
+
+	//! Called (in the main thread) when a file has been loaded by a background thread
+	void onBackgroundJobFinished(int jobID);
+
+	//! Loads the next file that must be loaded by the main thread
+	void runNextForegroundJob();
+
+	//! Updates the content of the cancel menu
+	void updateCancelMenu();
+
+protected:
+
+	//! Files sharing the same loading parameters
+	struct Batch
+	{
+		Batch() : coordinatesShiftEnabled(false), coordinatesShift(0, 0, 0) {}
+
+		FileIOFilter::LoadParameters parameters;
+		bool coordinatesShiftEnabled;
+		CCVector3d coordinatesShift;
+		QPointer<ccGLWindow> destWin;
+	};
+	typedef QSharedPointer<Batch> BatchPtr;
+
+	//! Job state
+	enum JobState { JOB_QUEUED, JOB_RUNNING, JOB_CANCELED };
+
+	//! Single file to load
+	struct Job
+	{
+		Job() : id(0), background(false), state(JOB_QUEUED), result(0), error(CC_FERR_NO_ERROR) {}
+
+		int id;
+		QString filename;
+		FileIOFilter::Shared filter;
+		BatchPtr batch;
+		bool background;
+		JobState state;
+		ccHObject* result;
+		CC_FILE_ERROR error;
+	};
+	typedef QSharedPointer<Job> JobPtr;
+
+	class BackgroundTask;
+
+	//! Cancels a single file
+	void cancel(int jobID);
+
+	//! Removes a job (and dispatches its result)
+	void finishJob(JobPtr job);
+
+	//! Updates the progress indicator
+	void updateProgress();
+
+	//! Jobs (queued or running)
+	std::list<JobPtr> m_jobs;
+	//! Mutex protecting the state of the jobs
+	QMutex m_mutex;
+	//! Thread pool for background loading
+	QThreadPool m_pool;
+	//! Next job ID
+	int m_nextJobID;
+	//! Whether a file is currently loaded by the main thread
+	bool m_foregroundJobRunning;
+
+	//! Number of files queued since the queue was last empty
+	int m_fileCount;
+	//! Number of files processed since the queue was last empty
+	int m_processedCount;
+	//! Number of files loaded since the queue was last empty
+	int m_loadedCount;
+
+	//! Parent widget
+	QWidget* m_parentWidget;
+	//! Status widget
+	QWidget* m_statusWidget;
+	//! Progress bar
+	QProgressBar* m_progressBar;
+	//! Cancel button
+	QToolButton* m_cancelButton;
+	//! Cancel menu (one entry per file)
+	QMenu* m_cancelMenu;
+};
+
+#endif //CC_FILE_LOAD_QUEUE_HEADER
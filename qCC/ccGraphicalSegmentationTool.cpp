@@ -23,6 +23,7 @@
 
 //CCLib
 #include <ManualSegmentationTools.h>
+#include <PolygonMask.h>
 #include <SquareMatrix.h>
 
 //qCC_db
@@ -31,6 +32,7 @@
 #include <ccGenericPointCloud.h>
 #include <ccPointCloud.h>
 #include <ccMesh.h>
+#include <ccOctree.h>
 #include <ccHObjectCaster.h>
 #include <cc2DViewportObject.h>
 
@@ -44,6 +46,7 @@
 
 //System
 #include <assert.h>
+#include <algorithm>
 
 ccGraphicalSegmentationTool::ccGraphicalSegmentationTool(QWidget* parent)
 	: ccOverlayDialog(parent)
@@ -606,6 +609,143 @@ void ccGraphicalSegmentationTool::segmentOut()
 	segment(false);
 }
 
+//! Octree cells with fewer points are directly tested point by point
+static const unsigned MIN_POINTS_PER_SEGMENTATION_CELL = 256;
+
+//! Set of points (contiguous range of octree codes) with the same relative position to the segmentation polygon
+struct SegmentationRange
+{
+	unsigned begin;
+	unsigned end; //excluded
+	CCLib::PolygonMask::State state;
+};
+
+//! Projects an octree cell on the screen and classifies it relatively to the segmentation polygon
+static CCLib::PolygonMask::State ClassifyOctreeCell(const CCLib::DgmOctree& octree,
+													CCLib::DgmOctree::CellCode truncatedCode,
+													unsigned char level,
+													const ccGLCameraParameters& camera,
+													const CCLib::PolygonMask& mask)
+{
+	CCVector3 cellMin, cellMax;
+	octree.computeCellLimits(truncatedCode, level, cellMin, cellMax, true);
+
+	const double half_w = camera.viewport[2] / 2.0;
+	const double half_h = camera.viewport[3] / 2.0;
+	const double* M = camera.modelViewMat.data();
+
+	CCVector2 rectMin, rectMax;
+	for (unsigned i = 0; i < 8; ++i)
+	{
+		CCVector3 corner(	(i & 1) ? cellMax.x : cellMin.x,
+							(i & 2) ? cellMax.y : cellMin.y,
+							(i & 4) ? cellMax.z : cellMin.z);
+
+		if (camera.perspective)
+		{
+			//the projection of a cell that is (partly) behind the camera can't be bounded
+			double zEye = M[2] * corner.x + M[6] * corner.y + M[10] * corner.z + M[14];
+			if (zEye >= 0)
+			{
+				return CCLib::PolygonMask::STRADDLING;
+			}
+		}
+
+		CCVector3d Q2D;
+		if (!camera.project(corner, Q2D))
+		{
+			return CCLib::PolygonMask::STRADDLING;
+		}
+
+		CCVector2 P2D(static_cast<PointCoordinateType>(Q2D.x - half_w), static_cast<PointCoordinateType>(Q2D.y - half_h));
+		if (i == 0)
+		{
+			rectMin = rectMax = P2D;
+		}
+		else
+		{
+			rectMin.x = std::min(rectMin.x, P2D.x);
+			rectMin.y = std::min(rectMin.y, P2D.y);
+			rectMax.x = std::max(rectMax.x, P2D.x);
+			rectMax.y = std::max(rectMax.y, P2D.y);
+		}
+	}
+
+	return mask.classify(rectMin, rectMax);
+}
+
+//! Walks the octree and sorts its cells (fully inside, fully outside or straddling the polygon)
+static bool ClassifyOctreeCells(const CCLib::DgmOctree& octree,
+								const ccGLCameraParameters& camera,
+								const CCLib::PolygonMask& mask,
+								std::vector<SegmentationRange>& ranges)
+{
+	const CCLib::DgmOctree::cellsContainer& codes = octree.pointsAndTheirCellCodes();
+	if (codes.empty())
+	{
+		return false;
+	}
+
+	struct Cell
+	{
+		unsigned begin;
+		unsigned end; //excluded
+		unsigned char level;
+	};
+
+	try
+	{
+		std::vector<Cell> cells;
+		Cell root = { 0, static_cast<unsigned>(codes.size()), 0 };
+		cells.push_back(root);
+
+		while (!cells.empty())
+		{
+			Cell cell = cells.back();
+			cells.pop_back();
+
+			unsigned char bitShift = CCLib::DgmOctree::GET_BIT_SHIFT(cell.level);
+			CCLib::DgmOctree::CellCode truncatedCode = (codes[cell.begin].theCode >> bitShift);
+
+			SegmentationRange range = { cell.begin, cell.end, ClassifyOctreeCell(octree, truncatedCode, cell.level, camera, mask) };
+			if (	range.state != CCLib::PolygonMask::STRADDLING
+				||	cell.level == CCLib::DgmOctree::MAX_OCTREE_LEVEL
+				||	cell.end - cell.begin <= MIN_POINTS_PER_SEGMENTATION_CELL)
+			{
+				ranges.push_back(range);
+				continue;
+			}
+
+			//split the cell (the codes of its children are contiguous)
+			unsigned char childLevel = cell.level + 1;
+			unsigned char childBitShift = CCLib::DgmOctree::GET_BIT_SHIFT(childLevel);
+			unsigned childBegin = cell.begin;
+			while (childBegin < cell.end)
+			{
+				CCLib::DgmOctree::CellCode childCode = (codes[childBegin].theCode >> childBitShift);
+				unsigned childEnd = static_cast<unsigned>(std::upper_bound(	codes.begin() + childBegin,
+																			codes.begin() + cell.end,
+																			childCode,
+																			[childBitShift](CCLib::DgmOctree::CellCode code, const CCLib::DgmOctree::IndexAndCode& ic)
+																			{
+																				return code < (ic.theCode >> childBitShift);
+																			}) - codes.begin());
+				Cell child = { childBegin, childEnd, childLevel };
+				cells.push_back(child);
+				childBegin = childEnd;
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		ranges.clear();
+		return false;
+	}
+
+	return true;
+}
+
 void ccGraphicalSegmentationTool::segment(bool keepPointsInside)
 {
 	if (!m_associatedWin)
@@ -623,12 +763,27 @@ void ccGraphicalSegmentationTool::segment(bool keepPointsInside)
 		return;
 	}
 
+	if (m_segmentationPoly->size() < 3)
+	{
+		ccLog::Error("The segmentation polygon must have at least 3 vertices!");
+		return;
+	}
+
 	//viewing parameters
 	ccGLCameraParameters camera;
 	m_associatedWin->getGLCameraParameters(camera);
 	const double half_w = camera.viewport[2] / 2.0;
 	const double half_h = camera.viewport[3] / 2.0;
 
+	//rasterized polygon (the points are only tested against the polygon edges near its border)
+	//(the vertex count has been checked: it can only fail if there's not enough memory)
+	CCLib::PolygonMask mask;
+	if (!mask.init(m_segmentationPoly))
+	{
+		ccLog::Error("Not enough memory!");
+		return;
+	}
+
 	//for each selected entity
 	for (QSet<ccHObject*>::const_iterator p = m_toSegment.begin(); p != m_toSegment.end(); ++p)
 	{
@@ -640,26 +795,67 @@ void ccGraphicalSegmentationTool::segment(bool keepPointsInside)
 
 		unsigned cloudSize = cloud->size();
 
-		//we project each point and we check if it falls inside the segmentation polyline
-		//ǶÿͶӰǼǷָ
+		//if an octree is available, we can classify whole cells at once
+		ccOctree::Shared octree = cloud->getPickingOctree();
+		std::vector<SegmentationRange> ranges;
+		if (	octree
+			&&	octree->getNumberOfProjectedPoints() == cloudSize
+			&&	ClassifyOctreeCells(*octree, camera, mask, ranges))
+		{
+			const CCLib::DgmOctree::cellsContainer& codes = octree->pointsAndTheirCellCodes();
+
 #if defined(_OPENMP)
-#pragma omp parallel for
+			#pragma omp parallel for schedule(dynamic)
 #endif
-		for (int i = 0; i < static_cast<int>(cloudSize); ++i)
+			for (int r = 0; r < static_cast<int>(ranges.size()); ++r)
+			{
+				const SegmentationRange& range = ranges[r];
+				for (unsigned j = range.begin; j < range.end; ++j)
+				{
+					unsigned pointIndex = codes[j].theIndex;
+					if (visibilityArray->getValue(pointIndex) != POINT_VISIBLE)
+					{
+						continue;
+					}
+
+					bool pointInside = (range.state == CCLib::PolygonMask::INSIDE);
+					if (range.state == CCLib::PolygonMask::STRADDLING)
+					{
+						CCVector3d Q2D;
+						camera.project(*cloud->getPoint(pointIndex), Q2D);
+
+						CCVector2 P2D(	static_cast<PointCoordinateType>(Q2D.x - half_w),
+										static_cast<PointCoordinateType>(Q2D.y - half_h));
+
+						pointInside = mask.isInside(P2D);
+					}
+
+					visibilityArray->setValue(pointIndex, keepPointsInside != pointInside ? POINT_HIDDEN : POINT_VISIBLE);
+				}
+			}
+		}
+		else
 		{
-			if (visibilityArray->getValue(i) == POINT_VISIBLE)
+			//we project each point and we check if it falls inside the segmentation polyline
+#if defined(_OPENMP)
+			#pragma omp parallel for
+#endif
+			for (int i = 0; i < static_cast<int>(cloudSize); ++i)
 			{
-				const CCVector3* P3D = cloud->getPoint(i);
+				if (visibilityArray->getValue(i) == POINT_VISIBLE)
+				{
+					const CCVector3* P3D = cloud->getPoint(i);
 
-				CCVector3d Q2D;
-				camera.project(*P3D, Q2D);
+					CCVector3d Q2D;
+					camera.project(*P3D, Q2D);
 
-				CCVector2 P2D(static_cast<PointCoordinateType>(Q2D.x - half_w),
-					static_cast<PointCoordinateType>(Q2D.y - half_h));
+					CCVector2 P2D(static_cast<PointCoordinateType>(Q2D.x - half_w),
+						static_cast<PointCoordinateType>(Q2D.y - half_h));
 
-				bool pointInside = CCLib::ManualSegmentationTools::isPointInsidePoly(P2D, m_segmentationPoly);
+					bool pointInside = mask.isInside(P2D);
 
-				visibilityArray->setValue(i, keepPointsInside != pointInside ? POINT_HIDDEN : POINT_VISIBLE);
+					visibilityArray->setValue(i, keepPointsInside != pointInside ? POINT_HIDDEN : POINT_VISIBLE);
+				}
 			}
 		}
 	}
@@ -18,6 +18,7 @@
 #include <QElapsedTimer>
 #include <QInputDialog>
 #include <QMessageBox>
+#include <QScopedPointer>
 
 #include "ScalarField.h"
 #include "ScalarFieldTools.h"
@@ -25,6 +26,7 @@
 #include "ccCommon.h"
 #include "ccConsole.h"
 
+#include "ccMesh.h"
 #include "ccOctree.h"
 #include "ccPointCloud.h"
 
@@ -722,4 +724,53 @@ namespace ccLibAlgorithms
 		
 		return true;
 	}
+	
+	ccMesh* ComputeTiledDelaunay(	ccGenericPointCloud* cloud,
+									const ccTiledDelaunay::Parameters& params,
+									bool updateNormals/*=false*/,
+									QWidget* parent/*=0*/,
+									bool showProgress/*=true*/,
+									bool* canceled/*=0*/)
+	{
+		if (canceled)
+			*canceled = false;
+
+		if (!cloud)
+		{
+			ccLog::Error("[ComputeTiledDelaunay] Invalid input cloud");
+			return 0;
+		}
+		
+		QScopedPointer<ccProgressDialog> pDlg(0);
+		if (showProgress)
+		{
+			pDlg.reset(new ccProgressDialog(true, parent));
+			pDlg->setAutoClose(false);
+		}
+		
+		QElapsedTimer eTimer;
+		eTimer.start();
+		
+		QString errorStr;
+		bool wasCanceled = false;
+		ccMesh* mesh = ccTiledDelaunay::Triangulate(cloud, params, updateNormals, pDlg.data(), &errorStr, &wasCanceled);
+		if (mesh)
+		{
+			ccConsole::Print(QString("[ComputeTiledDelaunay] Cloud '%1' triangulated in %2 s. (%3 triangles)").arg(cloud->getName()).arg(eTimer.elapsed() / 1000.0, 0, 'f', 3).arg(mesh->size()));
+		}
+		else if (wasCanceled)
+		{
+			ccConsole::Warning("[ComputeTiledDelaunay] Process cancelled by the user");
+		}
+		else
+		{
+			//the caller only reports that an error occurred
+			ccConsole::Warning(QString("[ComputeTiledDelaunay] Failed to triangulate cloud '%1': %2").arg(cloud->getName(), errorStr.isEmpty() ? QString("unknown error") : errorStr));
+		}
+
+		if (canceled)
+			*canceled = wasCanceled;
+		
+		return mesh;
+	}
 }
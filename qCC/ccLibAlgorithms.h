@@ -18,10 +18,12 @@
 //##########################################################################
 
 #include "ccHObject.h"
+#include "ccTiledDelaunay.h"
 
 class QWidget;
 
 class ccGenericPointCloud;
+class ccMesh;
 
 
 namespace ccLibAlgorithms
@@ -59,6 +61,22 @@ namespace ccLibAlgorithms
 												int icpFinalOverlap,
 												unsigned refEntityIndex = 0,
 												QWidget* parent = 0);
+	
+	//! Computes the 2.5D Delaunay triangulation of a (big) cloud tile by tile (see ccTiledDelaunay)
+	/** \param cloud input cloud (the mesh vertices)
+		\param params triangulation parameters
+		\param updateNormals whether to compute the mesh normals even if the cloud already has normals
+		\param parent parent widget (for the progress dialog)
+		\param showProgress whether to display a progress dialog or not
+		\param canceled whether the process has been cancelled by the user [optional]
+		\return the resulting mesh (or 0 if an error occurred or if the process has been cancelled)
+	**/
+	ccMesh* ComputeTiledDelaunay(	ccGenericPointCloud* cloud,
+									const ccTiledDelaunay::Parameters& params,
+									bool updateNormals = false,
+									QWidget* parent = 0,
+									bool showProgress = true,
+									bool* canceled = 0);
 }
 
 #endif
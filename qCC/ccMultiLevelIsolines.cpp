@@ -0,0 +1,498 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#include "ccMultiLevelIsolines.h"
+
+//Qt
+#include <QThread>
+
+//system
+#include <assert.h>
+#include <stdint.h>
+#include <algorithm>
+#include <utility>
+
+//! Chain of contour vertices
+/** Each vertex is identified by a key: level index * edge count + edge index.
+	The edge index is 2 * (y * w + x) for the horizontal edge between the
+	nodes (x,y) and (x+1,y), and 2 * (y * w + x) + 1 for the vertical edge
+	between the nodes (x,y) and (x,y+1).
+**/
+struct IsolineChain
+{
+	IsolineChain() : closed(false) {}
+
+	std::vector<uint64_t> keys;
+	bool closed;
+};
+
+//! Link between two consecutive items of a chain
+struct IsolineLink
+{
+	IsolineLink(unsigned i, bool r) : item(i), reversed(r) {}
+
+	unsigned item;
+	bool reversed;
+};
+
+//! Links the items (segments or chains) sharing an end point
+/** \param endKeys start and end keys of each item (2 per item)
+	\param links output item sequences
+	\param closed whether each output sequence is closed or not
+**/
+static void LinkItems(	const std::vector<uint64_t>& endKeys,
+						std::vector< std::vector<IsolineLink> >& links,
+						std::vector<bool>& closed)
+{
+	size_t endCount = endKeys.size();
+	size_t itemCount = endCount / 2;
+
+	//sort the end points by key to find the pairs
+	std::vector< std::pair<uint64_t, unsigned> > sortedEnds(endCount);
+	for (size_t i = 0; i < endCount; ++i)
+	{
+		sortedEnds[i] = std::make_pair(endKeys[i], static_cast<unsigned>(i));
+	}
+	std::sort(sortedEnds.begin(), sortedEnds.end());
+
+	//a vertex is shared by at most two items
+	std::vector<int> partner(endCount, -1);
+	for (size_t i = 0; i + 1 < endCount; ++i)
+	{
+		if (sortedEnds[i].first == sortedEnds[i + 1].first)
+		{
+			partner[sortedEnds[i].second] = static_cast<int>(sortedEnds[i + 1].second);
+			partner[sortedEnds[i + 1].second] = static_cast<int>(sortedEnds[i].second);
+			++i;
+		}
+	}
+
+	std::vector<bool> visited(itemCount, false);
+
+	//open sequences first (starting from the free end points), then the loops
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		for (size_t e = 0; e < endCount; ++e)
+		{
+			if (visited[e / 2])
+			{
+				continue;
+			}
+			if (pass == 0 ? partner[e] >= 0 : (e & 1) != 0)
+			{
+				continue;
+			}
+
+			links.resize(links.size() + 1);
+			std::vector<IsolineLink>& sequence = links.back();
+			bool isClosed = false;
+
+			int currentEnd = static_cast<int>(e);
+			while (true)
+			{
+				unsigned item = static_cast<unsigned>(currentEnd) / 2;
+				bool reversed = ((currentEnd & 1) != 0);
+				visited[item] = true;
+				sequence.push_back(IsolineLink(item, reversed));
+
+				//the next item is connected to the other end of this one
+				int nextEnd = partner[2 * item + (reversed ? 0 : 1)];
+				if (nextEnd < 0)
+				{
+					break;
+				}
+				if (visited[nextEnd / 2])
+				{
+					isClosed = true;
+					break;
+				}
+				currentEnd = nextEnd;
+			}
+
+			closed.push_back(isClosed);
+		}
+	}
+}
+
+//! Edges of a cell
+enum IsolineCellEdges { CELL_TOP = 0, CELL_RIGHT = 1, CELL_BOTTOM = 2, CELL_LEFT = 3 };
+
+//! Contour segments per marching squares configuration (pairs of edges, up to 2 segments)
+/** Bit 1 = bottom-left node below the level, bit 2 = bottom-right, bit 4 = top-right,
+	bit 8 = top-left. The saddle cases (5 and 10) are handled separately.
+**/
+static const int s_cellSegments[16][2] = {
+	{ -1, -1 },						//0
+	{ CELL_LEFT,	CELL_BOTTOM },	//1
+	{ CELL_BOTTOM,	CELL_RIGHT },	//2
+	{ CELL_LEFT,	CELL_RIGHT },	//3
+	{ CELL_TOP,		CELL_RIGHT },	//4
+	{ -1, -1 },						//5 (saddle)
+	{ CELL_TOP,		CELL_BOTTOM },	//6
+	{ CELL_TOP,		CELL_LEFT },	//7
+	{ CELL_TOP,		CELL_LEFT },	//8
+	{ CELL_TOP,		CELL_BOTTOM },	//9
+	{ -1, -1 },						//10 (saddle)
+	{ CELL_TOP,		CELL_RIGHT },	//11
+	{ CELL_LEFT,	CELL_RIGHT },	//12
+	{ CELL_BOTTOM,	CELL_RIGHT },	//13
+	{ CELL_LEFT,	CELL_BOTTOM },	//14
+	{ -1, -1 }						//15
+};
+
+//! Extracts and chains the contour segments of a tile (i.e. a set of rows of cells)
+/** \param edgeCount total number of edges of the grid (= 2 * w * h)
+**/
+static void ProcessTile(const double* grid,
+						const std::vector<unsigned>& bands,
+						int w,
+						int firstRow,
+						int lastRow,
+						uint64_t edgeCount,
+						const std::vector<double>& levels,
+						std::vector<IsolineChain>& chains)
+{
+	//extract the segments of all levels (2 keys per segment)
+	std::vector<uint64_t> segmentKeys;
+	for (int y = firstRow; y < lastRow; ++y)
+	{
+		for (int x = 0; x + 1 < w; ++x)
+		{
+			int n = y * w + x;
+			unsigned bTL = bands[n];
+			unsigned bTR = bands[n + 1];
+			unsigned bBL = bands[n + w];
+			unsigned bBR = bands[n + w + 1];
+			unsigned minBand = std::min(std::min(bTL, bTR), std::min(bBL, bBR));
+			unsigned maxBand = std::max(std::max(bTL, bTR), std::max(bBL, bBR));
+			if (minBand == maxBand)
+			{
+				//no level crosses this cell
+				continue;
+			}
+
+			//edge indexes
+			uint64_t edges[4];
+			edges[CELL_TOP] = 2 * static_cast<uint64_t>(n);
+			edges[CELL_RIGHT] = 2 * static_cast<uint64_t>(n + 1) + 1;
+			edges[CELL_BOTTOM] = 2 * static_cast<uint64_t>(n + w);
+			edges[CELL_LEFT] = 2 * static_cast<uint64_t>(n) + 1;
+
+			//a node is below level 't' if its band index is <= t
+			for (unsigned t = minBand; t < maxBand; ++t)
+			{
+				int code =	(bBL <= t ? 1 : 0)
+						|	(bBR <= t ? 2 : 0)
+						|	(bTR <= t ? 4 : 0)
+						|	(bTL <= t ? 8 : 0);
+
+				uint64_t base = t * edgeCount;
+				if (code == 5 || code == 10)
+				{
+					//saddle: disambiguation with the cell center value
+					double center = (grid[n] + grid[n + 1] + grid[n + w] + grid[n + w + 1]) / 4.0;
+					bool centerBelow = (center < levels[t]);
+					//either the top-left and bottom-right corners are isolated, or the other two
+					bool isolateTLandBR = (code == 5 ? centerBelow : !centerBelow);
+					if (isolateTLandBR)
+					{
+						segmentKeys.push_back(base + edges[CELL_TOP]);
+						segmentKeys.push_back(base + edges[CELL_LEFT]);
+						segmentKeys.push_back(base + edges[CELL_BOTTOM]);
+						segmentKeys.push_back(base + edges[CELL_RIGHT]);
+					}
+					else
+					{
+						segmentKeys.push_back(base + edges[CELL_LEFT]);
+						segmentKeys.push_back(base + edges[CELL_BOTTOM]);
+						segmentKeys.push_back(base + edges[CELL_TOP]);
+						segmentKeys.push_back(base + edges[CELL_RIGHT]);
+					}
+				}
+				else
+				{
+					assert(s_cellSegments[code][0] >= 0);
+					segmentKeys.push_back(base + edges[s_cellSegments[code][0]]);
+					segmentKeys.push_back(base + edges[s_cellSegments[code][1]]);
+				}
+			}
+		}
+	}
+
+	//chain the segments
+	std::vector< std::vector<IsolineLink> > links;
+	std::vector<bool> closed;
+	LinkItems(segmentKeys, links, closed);
+
+	chains.resize(links.size());
+	for (size_t i = 0; i < links.size(); ++i)
+	{
+		const std::vector<IsolineLink>& sequence = links[i];
+		IsolineChain& chain = chains[i];
+		chain.keys.reserve(sequence.size() + 1);
+		for (size_t j = 0; j < sequence.size(); ++j)
+		{
+			const IsolineLink& link = sequence[j];
+			uint64_t startKey = segmentKeys[2 * link.item + (link.reversed ? 1 : 0)];
+			uint64_t endKey = segmentKeys[2 * link.item + (link.reversed ? 0 : 1)];
+			if (j == 0)
+			{
+				chain.keys.push_back(startKey);
+			}
+			chain.keys.push_back(endKey);
+		}
+		if (closed[i])
+		{
+			//the last vertex is the same as the first one
+			chain.keys.pop_back();
+			chain.closed = true;
+		}
+	}
+}
+
+//! Interpolates the position of a level along an edge (between A and B)
+static inline double LERP(double A, double B, double level)
+{
+	double AB = A - B;
+	return AB == 0 ? 0 : (A - level) / AB;
+}
+
+bool ccMultiLevelIsolines::Extract(	const double* grid,
+									int w,
+									int h,
+									const std::vector<double>& levels,
+									std::vector<Contour>& contours,
+									CCLib::GenericProgressCallback* progressCb/*=0*/,
+									int tileHeight/*=0*/)
+{
+	contours.clear();
+
+	if (!grid || w < 2 || h < 2)
+	{
+		assert(false);
+		return false;
+	}
+	if (levels.empty())
+	{
+		return true;
+	}
+
+	const int cellRows = h - 1;
+	if (tileHeight <= 0)
+	{
+		int tileCount = std::max(1, QThread::idealThreadCount()) * 4;
+		tileHeight = std::max(16, (cellRows + tileCount - 1) / tileCount);
+	}
+	const int tileCount = (cellRows + tileHeight - 1) / tileHeight;
+
+	const uint64_t edgeCount = 2 * static_cast<uint64_t>(w) * static_cast<uint64_t>(h);
+
+	CCLib::NormalizedProgress nProgress(progressCb, static_cast<unsigned>(tileCount + 1));
+
+	try
+	{
+		//classify each node against all the levels at once (= number of levels below or equal to its value)
+		std::vector<unsigned> bands(static_cast<size_t>(w) * h);
+#if defined(_OPENMP)
+		#pragma omp parallel for
+#endif
+		for (int j = 0; j < h; ++j)
+		{
+			const double* row = grid + static_cast<size_t>(j) * w;
+			unsigned* rowBands = &bands[static_cast<size_t>(j) * w];
+			for (int i = 0; i < w; ++i)
+			{
+				rowBands[i] = static_cast<unsigned>(std::upper_bound(levels.begin(), levels.end(), row[i]) - levels.begin());
+			}
+		}
+
+		if (progressCb && !nProgress.oneStep())
+		{
+			//process cancelled by the user
+			return false;
+		}
+
+		//process the tiles (by batches so as to be able to cancel the process)
+		std::vector< std::vector<IsolineChain> > tileChains(tileCount);
+		const int batchSize = std::max(1, QThread::idealThreadCount()) * 2;
+		for (int firstTile = 0; firstTile < tileCount; firstTile += batchSize)
+		{
+			int lastTile = std::min(firstTile + batchSize, tileCount);
+			bool memoryError = false;
+
+#if defined(_OPENMP)
+			#pragma omp parallel for schedule(dynamic)
+#endif
+			for (int k = firstTile; k < lastTile; ++k)
+			{
+				int firstRow = k * tileHeight;
+				int lastRow = std::min(firstRow + tileHeight, cellRows);
+				try
+				{
+					ProcessTile(grid, bands, w, firstRow, lastRow, edgeCount, levels, tileChains[k]);
+				}
+				catch (const std::bad_alloc&)
+				{
+					//not enough memory
+					memoryError = true;
+				}
+			}
+
+			if (memoryError)
+			{
+				return false;
+			}
+
+			if (progressCb && !nProgress.steps(static_cast<unsigned>(lastTile - firstTile)))
+			{
+				//process cancelled by the user
+				return false;
+			}
+		}
+
+		//stitch the open chains at the tile borders
+		std::vector<IsolineChain> finalChains;
+		{
+			std::vector<const IsolineChain*> openChains;
+			for (int k = 0; k < tileCount; ++k)
+			{
+				const std::vector<IsolineChain>& chains = tileChains[k];
+				for (size_t i = 0; i < chains.size(); ++i)
+				{
+					if (chains[i].closed)
+					{
+						finalChains.push_back(chains[i]);
+					}
+					else
+					{
+						openChains.push_back(&chains[i]);
+					}
+				}
+			}
+
+			std::vector<uint64_t> endKeys(openChains.size() * 2);
+			for (size_t i = 0; i < openChains.size(); ++i)
+			{
+				endKeys[2 * i] = openChains[i]->keys.front();
+				endKeys[2 * i + 1] = openChains[i]->keys.back();
+			}
+
+			std::vector< std::vector<IsolineLink> > links;
+			std::vector<bool> closed;
+			LinkItems(endKeys, links, closed);
+
+			for (size_t i = 0; i < links.size(); ++i)
+			{
+				const std::vector<IsolineLink>& sequence = links[i];
+				IsolineChain chain;
+				for (size_t j = 0; j < sequence.size(); ++j)
+				{
+					const std::vector<uint64_t>& keys = openChains[sequence[j].item]->keys;
+					//the first vertex of each chain is the last vertex of the previous one
+					size_t start = (j == 0 ? 0 : 1);
+					if (sequence[j].reversed)
+					{
+						for (size_t v = start; v < keys.size(); ++v)
+						{
+							chain.keys.push_back(keys[keys.size() - 1 - v]);
+						}
+					}
+					else
+					{
+						chain.keys.insert(chain.keys.end(), keys.begin() + start, keys.end());
+					}
+				}
+				if (closed[i])
+				{
+					//the last vertex is the same as the first one
+					chain.keys.pop_back();
+					chain.closed = true;
+				}
+				finalChains.push_back(chain);
+			}
+		}
+		tileChains.clear();
+
+		//sort the chains by level (the order is stable for a given level)
+		std::vector< std::pair<uint64_t, size_t> > chainOrder(finalChains.size());
+		for (size_t i = 0; i < finalChains.size(); ++i)
+		{
+			chainOrder[i] = std::make_pair(finalChains[i].keys.front() / edgeCount, i);
+		}
+		std::sort(chainOrder.begin(), chainOrder.end());
+
+		//eventually compute the vertices coordinates
+		contours.resize(finalChains.size());
+		for (size_t i = 0; i < chainOrder.size(); ++i)
+		{
+			const IsolineChain& chain = finalChains[chainOrder[i].second];
+			Contour& contour = contours[i];
+			contour.levelIndex = static_cast<unsigned>(chainOrder[i].first);
+			contour.closed = chain.closed;
+			contour.x.resize(chain.keys.size());
+			contour.y.resize(chain.keys.size());
+
+			const double level = levels[contour.levelIndex];
+			for (size_t v = 0; v < chain.keys.size(); ++v)
+			{
+				uint64_t edge = chain.keys[v] % edgeCount;
+				size_t n = static_cast<size_t>(edge / 2);
+				double x = static_cast<double>(n % w);
+				double y = static_cast<double>(n / w);
+				if ((edge & 1) == 0)
+				{
+					//horizontal edge
+					contour.x[v] = x + LERP(grid[n], grid[n + 1], level);
+					contour.y[v] = y;
+				}
+				else
+				{
+					//vertical edge
+					contour.x[v] = x;
+					contour.y[v] = y + LERP(grid[n], grid[n + w], level);
+				}
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		contours.clear();
+		return false;
+	}
+
+	return true;
+}
+
+void ccMultiLevelIsolines::CreateOnePixelBorder(double* grid, int w, int h, double borderValue)
+{
+	//rows
+	{
+		int shift = (h - 1) * w;
+		for (int i = 0; i < w; i++)
+		{
+			grid[i] = grid[i + shift] = borderValue;
+		}
+	}
+	//columns
+	{
+		for (int j = 0; j < h; j++)
+		{
+			grid[j*w] = grid[(j + 1)*w - 1] = borderValue;
+		}
+	}
+}
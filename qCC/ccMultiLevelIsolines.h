@@ -0,0 +1,81 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_MULTI_LEVEL_ISOLINES_HEADER
+#define CC_MULTI_LEVEL_ISOLINES_HEADER
+
+//CCLib
+#include <GenericProgressCallback.h>
+
+//system
+#include <vector>
+
+//! Multi-level isolines (contour lines) extraction
+/** Marching squares variant that handles all the levels in a single pass:
+	each grid node is classified once against all the levels (i.e. we compute
+	the number of levels below or equal to its value), so that each cell
+	directly knows the range of levels crossing it.
+	The grid is split in horizontal tiles that are processed in parallel.
+	The contour segments are chained per tile, and the chains are then
+	stitched at the tile borders (always in the same order).
+**/
+class ccMultiLevelIsolines
+{
+public:
+
+	//! Contour line
+	struct Contour
+	{
+		//! Default constructor
+		Contour()
+			: levelIndex(0)
+			, closed(false)
+		{}
+
+		//! Index of the corresponding level
+		unsigned levelIndex;
+		//! Whether the contour is closed or not
+		bool closed;
+		//! Vertices X coordinates (in grid coordinates)
+		std::vector<double> x;
+		//! Vertices Y coordinates (in grid coordinates)
+		std::vector<double> y;
+	};
+
+	//! Extracts the contour lines of a grid for multiple levels at once
+	/** \param grid grid values (row by row)
+		\param w grid width
+		\param h grid height
+		\param levels contour levels (sorted in ascending order)
+		\param contours output contours (sorted by level)
+		\param progressCb optional progress callback
+		\param tileHeight height (in cells) of the tiles processed in parallel (0 = automatic)
+		\return success (false if there's not enough memory or if the process has been cancelled)
+	**/
+	static bool Extract(const double* grid,
+						int w,
+						int h,
+						const std::vector<double>& levels,
+						std::vector<Contour>& contours,
+						CCLib::GenericProgressCallback* progressCb = 0,
+						int tileHeight = 0);
+
+	//! Creates a single pixel border around the grid
+	static void CreateOnePixelBorder(double* grid, int w, int h, double borderValue);
+};
+
+#endif //CC_MULTI_LEVEL_ISOLINES_HEADER
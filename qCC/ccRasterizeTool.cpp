@@ -21,7 +21,8 @@
 #include "ccPersistentSettings.h"
 #include "ccCommon.h"
 #include "mainwindow.h"
-#include "ccIsolines.h"
+#include "ccMultiLevelIsolines.h"
+#include "ccTiledRasterExport.h"
 
 //qCC_db
 #include <ccFileUtils.h>
@@ -62,6 +63,7 @@ ccRasterizeTool::ccRasterizeTool(ccGenericPointCloud* cloud, QWidget* parent/*=0
 #ifndef CC_GDAL_SUPPORT
 	generateRasterPushButton->setDisabled(true);
 	generateRasterPushButton->setChecked(false);
+	generateTiledRasterPushButton->setDisabled(true);
 #endif
 
 	//force update
@@ -81,6 +83,7 @@ ccRasterizeTool::ccRasterizeTool(ccGenericPointCloud* cloud, QWidget* parent/*=0
 	connect(generateCloudPushButton,	SIGNAL(clicked()),					this,	SLOT(generateCloud()));
 	connect(generateImagePushButton,	SIGNAL(clicked()),					this,	SLOT(generateImage()));
 	connect(generateRasterPushButton,	SIGNAL(clicked()),					this,	SLOT(generateRaster()));
+	connect(generateTiledRasterPushButton,	SIGNAL(clicked()),				this,	SLOT(generateTiledRaster()));
 	connect(generateASCIIPushButton,	SIGNAL(clicked()),					this,	SLOT(generateASCIIMatrix()));
 	connect(generateMeshPushButton,		SIGNAL(clicked()),					this,	SLOT(generateMesh()));
 	connect(generateContoursPushButton,	SIGNAL(clicked()),					this,	SLOT(generateContours()));
@@ -215,9 +218,15 @@ unsigned char ccRasterizeTool::getProjectionDimension() const
 	return static_cast<unsigned char>(dim);
 }
 
+//! Returns whether the cell height is the height of the point that represents the cell
+static bool ProjectionKeepsPointHeight(ccRasterGrid::ProjectionType projectionType)
+{
+	return (projectionType == ccRasterGrid::PROJ_MINIMUM_VALUE || projectionType == ccRasterGrid::PROJ_MAXIMUM_VALUE);
+}
+
 void ccRasterizeTool::resampleOptionToggled(bool state)
 {
-	warningResampleWithAverageLabel->setVisible(resampleCloudCheckBox->isChecked() && getTypeOfProjection() == ccRasterGrid::PROJ_AVERAGE_VALUE);
+	warningResampleWithAverageLabel->setVisible(resampleCloudCheckBox->isChecked() && !ProjectionKeepsPointHeight(getTypeOfProjection()));
 	gridOptionChanged();
 }
 
@@ -226,7 +235,7 @@ void ccRasterizeTool::projectionTypeChanged(int index)
 	//we can't use the 'resample origin cloud' option with 'average height' projection
 	//resampleCloudCheckBox->setEnabled(index != PROJ_AVERAGE_VALUE);
 	//DGM: now we can! We simply display a warning message
-	warningResampleWithAverageLabel->setVisible(resampleCloudCheckBox->isChecked() && index == ccRasterGrid::PROJ_AVERAGE_VALUE);
+	warningResampleWithAverageLabel->setVisible(resampleCloudCheckBox->isChecked() && !ProjectionKeepsPointHeight(getTypeOfProjection()));
 	gridIsUpToDate(false);
 }
 
@@ -340,6 +349,8 @@ ccRasterGrid::ProjectionType ccRasterizeTool::getTypeOfProjection() const
 		return ccRasterGrid::PROJ_AVERAGE_VALUE;
 	case 2:
 		return ccRasterGrid::PROJ_MAXIMUM_VALUE;
+	case 3:
+		return ccRasterGrid::PROJ_MEDIAN_VALUE;
 	default:
 		//shouldn't be possible for this option!
 		assert(false);
@@ -512,7 +523,7 @@ ccPointCloud* ccRasterizeTool::convertGridToCloud(	const std::vector<ccRasterGri
 																		interpolateSF,
 																		interpolateColors,
 																		/*resampleInputCloudXY=*/resampleOriginalCloud(),
-																		/*resampleInputCloudZ=*/getTypeOfProjection() != ccRasterGrid::PROJ_AVERAGE_VALUE,
+																		/*resampleInputCloudZ=*/ProjectionKeepsPointHeight(getTypeOfProjection()),
 																		/*inputCloud=*/m_cloud,
 																		/*fillEmptyCells=*/fillEmptyCellsStrategy != ccRasterGrid::LEAVE_EMPTY,
 																		emptyCellsHeight,
@@ -933,6 +944,7 @@ void ccRasterizeTool::generateRaster() const
 	static bool allSFBands = false;
 
 	RasterExportOptionsDlg reoDlg;
+	reoDlg.tilingFrame->setVisible(false);
 	reoDlg.dimensionsLabel->setText(QString("%1 x %2").arg(m_grid.width).arg(m_grid.height));
 	reoDlg.exportRGBCheckBox->setEnabled(m_grid.hasColors);
 	reoDlg.exportRGBCheckBox->setChecked(rgbBand);
@@ -1338,6 +1350,108 @@ void ccRasterizeTool::generateRaster() const
 #endif
 }
 
+void ccRasterizeTool::generateTiledRaster()
+{
+#ifdef CC_GDAL_SUPPORT
+
+	if (!m_cloud)
+	{
+		return;
+	}
+
+	ccTiledRasterExport::Parameters params;
+	params.box = getCustomBBox();
+	params.gridStep = getGridStep();
+	params.Z = getProjectionDimension();
+	params.projectionType = getTypeOfProjection();
+	params.sfInterpolation = getTypeOfSFInterpolation();
+	params.emptyCellsStrategy = getFillEmptyCellsStrategy(fillEmptyCellsComboBox);
+	params.customHeight = getCustomHeightForEmptyCells();
+
+	if (	params.emptyCellsStrategy != ccRasterGrid::LEAVE_EMPTY
+		&&	params.emptyCellsStrategy != ccRasterGrid::FILL_CUSTOM_HEIGHT
+		&&	params.emptyCellsStrategy != ccRasterGrid::INTERPOLATE)
+	{
+		ccLog::Error("Tiled export only supports the 'leave empty', 'custom height' and 'interpolate' strategies for empty cells");
+		return;
+	}
+
+	unsigned gridWidth = 0, gridHeight = 0;
+	if (!params.box.isValid() || !getGridSize(gridWidth, gridHeight))
+	{
+		return;
+	}
+
+	//which (and how many) bands shall we create?
+	static bool heightBand = true; //height by default
+	static bool rgbBand = false; //not a good idea to mix RGB and height values!
+	static bool densityBand = false;
+	static bool allSFBands = false;
+	static int tileSize = 1024;
+	static bool buildOverviews = false;
+
+	RasterExportOptionsDlg reoDlg;
+	reoDlg.dimensionsLabel->setText(QString("%1 x %2").arg(gridWidth).arg(gridHeight));
+	reoDlg.exportRGBCheckBox->setEnabled(m_cloud->hasColors());
+	reoDlg.exportRGBCheckBox->setChecked(rgbBand);
+	reoDlg.exportHeightsCheckBox->setChecked(heightBand);
+	reoDlg.exportDensityCheckBox->setChecked(densityBand);
+	reoDlg.exportActiveLayerCheckBox->setChecked(false);
+	reoDlg.exportActiveLayerCheckBox->setEnabled(false);
+	reoDlg.exportAllSFCheckBox->setEnabled(params.sfInterpolation != ccRasterGrid::INVALID_PROJECTION_TYPE);
+	reoDlg.exportAllSFCheckBox->setChecked(allSFBands);
+	reoDlg.tileSizeSpinBox->setValue(tileSize);
+	reoDlg.buildOverviewsCheckBox->setChecked(buildOverviews);
+
+	if (!reoDlg.exec())
+	{
+		//cancelled by user
+		return;
+	}
+
+	//we ask the output filename AFTER displaying the export parameters ;)
+	QString outputFilename;
+	{
+		QSettings settings;
+		settings.beginGroup(ccPS::HeightGridGeneration());
+		QString imageSavePath = settings.value("savePathImage", ccFileUtils::defaultDocPath()).toString();
+		outputFilename = QFileDialog::getSaveFileName(	this,
+														"Save height grid raster",
+														imageSavePath + QString("/raster.tif"),
+														"geotiff (*.tif)");
+
+		if (outputFilename.isNull())
+		{
+			return;
+		}
+
+		//save current export path to persistent settings
+		settings.setValue("savePathImage", QFileInfo(outputFilename).absolutePath());
+	}
+
+	heightBand     = reoDlg.exportHeightsCheckBox->isChecked();
+	rgbBand        = reoDlg.exportRGBCheckBox->isEnabled() && reoDlg.exportRGBCheckBox->isChecked();
+	densityBand    = reoDlg.exportDensityCheckBox->isChecked();
+	allSFBands     = reoDlg.exportAllSFCheckBox->isEnabled() && reoDlg.exportAllSFCheckBox->isChecked();
+	tileSize       = (reoDlg.tileSizeSpinBox->value() / 16) * 16;
+	buildOverviews = reoDlg.buildOverviewsCheckBox->isChecked();
+
+	params.exportHeights = heightBand;
+	params.exportRGB = rgbBand;
+	params.exportDensity = densityBand;
+	params.exportSFs = allSFBands;
+	params.tileSize = static_cast<unsigned>(tileSize);
+	params.buildOverviews = buildOverviews;
+
+	ccProgressDialog pDlg(true, this);
+	ccTiledRasterExport::Export(m_cloud, params, outputFilename, &pDlg);
+
+#else
+	assert(false);
+	ccLog::Error("[Rasterize] GDAL not supported by this version! Can't generate a raster...");
+#endif
+}
+
 //See http://edndoc.esri.com/arcobjects/9.2/net/shared/geoprocessing/spatial_analyst_tools/how_hillshade_works.htm
 void ccRasterizeTool::generateHillshade()
 {
@@ -1581,10 +1695,9 @@ void ccRasterizeTool::generateContours()
 
 	try
 	{
-		Isolines<double> iso(static_cast<int>(xDim), static_cast<int>(yDim));
 		if (!ignoreBorders)
 		{
-			iso.createOnePixelBorder(&(grid.front()), activeLayer->getMin() - 1.0);
+			ccMultiLevelIsolines::CreateOnePixelBorder(&(grid.front()), static_cast<int>(xDim), static_cast<int>(yDim), activeLayer->getMin() - 1.0);
 		}
 		//bounding box
 		ccBBox box = getCustomBBox();
@@ -1599,131 +1712,144 @@ void ccRasterizeTool::generateContours()
 		int minVertexCount = minVertexCountSpinBox->value();
 		assert(minVertexCount >= 3);
 
+		//contour levels
+		std::vector<double> levels(levelCount);
+		for (unsigned k = 0; k < levelCount; ++k)
+		{
+			levels[k] = startValue + k * step;
+		}
+
 		ccProgressDialog pDlg(true,this);
 		pDlg.setMethodTitle(tr("Contour plot"));
 		pDlg.setInfo(tr("Levels: %1\nCells: %2 x %3").arg(levelCount).arg(m_grid.width).arg(m_grid.height));
 		pDlg.start();
 		pDlg.show();
 		QApplication::processEvents();
-		CCLib::NormalizedProgress nProgress(&pDlg, levelCount);
+
+		//extract the contour lines of all levels at once
+		std::vector<ccMultiLevelIsolines::Contour> contours;
+		if (!ccMultiLevelIsolines::Extract(&(grid.front()), static_cast<int>(xDim), static_cast<int>(yDim), levels, contours, &pDlg))
+		{
+			if (!pDlg.wasCanceled())
+			{
+				ccLog::Error("Not enough memory!");
+			}
+			contours.clear();
+		}
+		pDlg.stop();
+
+		ccLog::PrintDebug(QString("[Rasterize][Isolines] %1 lines (%2 levels)").arg(contours.size()).arg(levelCount));
 
 		int lineWidth = contourWidthSpinBox->value();
 		bool colorize = colorizeContoursCheckBox->isChecked();
 
-		double v = startValue;
-		while (v <= activeLayer->getMax() && !memoryError)
+		//convert them to poylines
+		int realCount = 0;
+		unsigned currentLevelIndex = 0;
+		for (size_t i = 0; i < contours.size() && !memoryError; ++i)
 		{
-			//extract contour lines for the current level
-			iso.setThreshold(v);
-			int lineCount = iso.find(&(grid.front()));
-
-			ccLog::PrintDebug(QString("[Rasterize][Isolines] value=%1 : %2 lines").arg(v).arg(lineCount));
+			const ccMultiLevelIsolines::Contour& contour = contours[i];
+			double v = levels[contour.levelIndex];
+			if (contour.levelIndex != currentLevelIndex)
+			{
+				//the contours are sorted by level
+				currentLevelIndex = contour.levelIndex;
+				realCount = 0;
+			}
 
-			//convert them to poylines
-			int realCount = 0;
-			for (int i = 0; i < lineCount; ++i)
+			int vertCount = static_cast<int>(contour.x.size());
+			if (vertCount >= minVertexCount)
 			{
-				int vertCount = iso.getContourLength(i);
-				if (vertCount >= minVertexCount)
+				int startVi = 0; //we may have to split the polyline in multiple chunks
+				while (startVi < vertCount)
 				{
-					int startVi = 0; //we may have to split the polyline in multiple chunks
-					while (startVi < vertCount)
+					ccPointCloud* vertices = new ccPointCloud("vertices");
+					ccPolyline* poly = new ccPolyline(vertices);
+					poly->addChild(vertices);
+					bool isClosed = (startVi == 0 ? contour.closed : false);
+					if (poly->reserve(vertCount - startVi) && vertices->reserve(vertCount - startVi))
 					{
-						ccPointCloud* vertices = new ccPointCloud("vertices");
-						ccPolyline* poly = new ccPolyline(vertices);
-						poly->addChild(vertices);
-						bool isClosed = (startVi == 0 ? iso.isContourClosed(i) : false);
-						if (poly->reserve(vertCount - startVi) && vertices->reserve(vertCount - startVi))
+						unsigned localIndex = 0;
+						for (int vi = startVi; vi < vertCount; ++vi)
 						{
-							unsigned localIndex = 0;
-							for (int vi = startVi; vi < vertCount; ++vi)
+							++startVi;
+
+							double x = contour.x[vi] - margin;
+							double y = contour.y[vi] - margin;
+
+							CCVector3 P;
+							//DGM: we will only do the dimension mapping at export time
+							//(otherwise the contour lines appear in the wrong orientation compared to the grid/raster which
+							// is in the XY plane by default!)
+							/*P.u[X] = */P.x = static_cast<PointCoordinateType>((x + 0.5) * m_grid.gridStep + box.minCorner().u[X]);
+							/*P.u[Y] = */P.y = static_cast<PointCoordinateType>((y + 0.5) * m_grid.gridStep + box.minCorner().u[Y]);
+							if (projectContourOnAltitudes)
 							{
-								++startVi;
-								
-								double x = iso.getContourX(i, vi) - margin;
-								double y = iso.getContourY(i, vi) - margin;
-
-								CCVector3 P;
-								//DGM: we will only do the dimension mapping at export time
-								//(otherwise the contour lines appear in the wrong orientation compared to the grid/raster which
-								// is in the XY plane by default!)
-								/*P.u[X] = */P.x = static_cast<PointCoordinateType>((x + 0.5) * m_grid.gridStep + box.minCorner().u[X]);
-								/*P.u[Y] = */P.y = static_cast<PointCoordinateType>((y + 0.5) * m_grid.gridStep + box.minCorner().u[Y]);
-								if (projectContourOnAltitudes)
+								int xi = std::min(std::max(static_cast<int>(x), 0), static_cast<int>(m_grid.width) - 1);
+								int yi = std::min(std::max(static_cast<int>(y), 0), static_cast<int>(m_grid.height) - 1);
+								double h = m_grid.rows[yi][xi].h;
+								if (std::isfinite(h))
 								{
-									int xi = std::min(std::max(static_cast<int>(x), 0), static_cast<int>(m_grid.width) - 1);
-									int yi = std::min(std::max(static_cast<int>(y), 0), static_cast<int>(m_grid.height) - 1);
-									double h = m_grid.rows[y][x].h;
-									if (std::isfinite(h))
-									{
-										/*P.u[Z] = */P.z = static_cast<PointCoordinateType>(h);
-									}
-									else
-									{
-										//DGM: we stop the current polyline
-										isClosed = false;
-										break;
-									}
+									/*P.u[Z] = */P.z = static_cast<PointCoordinateType>(h);
 								}
 								else
 								{
-									/*P.u[Z] = */P.z = static_cast<PointCoordinateType>(v);
+									//DGM: we stop the current polyline
+									isClosed = false;
+									break;
 								}
-
-								vertices->addPoint(P);
-								assert(localIndex < vertices->size());
-								poly->addPointIndex(localIndex++);
 							}
-
-							assert(poly);
-							if (poly->size() > 1)
+							else
 							{
-								poly->setName(QString("Contour line value = %1 (#%2)").arg(v).arg(++realCount));
-								poly->setGlobalScale(m_cloud->getGlobalScale());
-								poly->setGlobalShift(m_cloud->getGlobalShift());
-								poly->setWidth(lineWidth);
-								poly->setClosed(isClosed); //if we have less vertices, it means we have 'chopped' the original contour
-								poly->setColor(ccColor::darkGrey);
-								if (colorize)
-								{
-									const ColorCompType* col = activeLayer->getColor(v);
-									if (col)
-										poly->setColor(ccColor::Rgb(col));
-								}
-								poly->showColors(true);
-								vertices->setEnabled(false);
-								//add the 'const altitude' meta-data as well
-								poly->setMetaData(ccPolyline::MetaKeyConstAltitude(), QVariant(v));
+								/*P.u[Z] = */P.z = static_cast<PointCoordinateType>(v);
+							}
 
-								if (m_glWindow)
-									m_glWindow->addToOwnDB(poly);
+							vertices->addPoint(P);
+							assert(localIndex < vertices->size());
+							poly->addPointIndex(localIndex++);
+						}
 
-								m_contourLines.push_back(poly);
-							}
-							else
+						assert(poly);
+						if (poly->size() > 1)
+						{
+							poly->setName(QString("Contour line value = %1 (#%2)").arg(v).arg(++realCount));
+							poly->setGlobalScale(m_cloud->getGlobalScale());
+							poly->setGlobalShift(m_cloud->getGlobalShift());
+							poly->setWidth(lineWidth);
+							poly->setClosed(isClosed); //if we have less vertices, it means we have 'chopped' the original contour
+							poly->setColor(ccColor::darkGrey);
+							if (colorize)
 							{
-								delete poly;
-								poly = 0;
+								const ColorCompType* col = activeLayer->getColor(v);
+								if (col)
+									poly->setColor(ccColor::Rgb(col));
 							}
+							poly->showColors(true);
+							vertices->setEnabled(false);
+							//add the 'const altitude' meta-data as well
+							poly->setMetaData(ccPolyline::MetaKeyConstAltitude(), QVariant(v));
+
+							if (m_glWindow)
+								m_glWindow->addToOwnDB(poly);
+
+							m_contourLines.push_back(poly);
 						}
 						else
 						{
 							delete poly;
 							poly = 0;
-							ccLog::Error("Not enough memory!");
-							memoryError = true; //early stop
-							break;
 						}
 					}
+					else
+					{
+						delete poly;
+						poly = 0;
+						ccLog::Error("Not enough memory!");
+						memoryError = true; //early stop
+						break;
+					}
 				}
 			}
-			v += step;
-
-			if (!nProgress.oneStep())
-			{
-				//process cancelled by user
-				break;
-			}
 		}
 	}
 	catch (const std::bad_alloc&)
@@ -50,6 +50,9 @@ protected slots:
 	//! Exports the grid as a raster
 	void generateRaster() const;
 
+	//! Exports the grid as a tiled raster (without computing the whole grid)
+	void generateTiledRaster();
+
 	//! Exports the grid as a mesh
 	void generateMesh() const;
 
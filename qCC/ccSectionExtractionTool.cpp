@@ -23,6 +23,7 @@
 #include "ccOrthoSectionGenerationDlg.h"
 #include "ccSectionExtractionSubDlg.h"
 #include "ccContourExtractor.h"
+#include "ccBatchSectionExtractor.h"
 
 //qCC_db
 #include <ccLog.h>
@@ -1240,249 +1241,64 @@ void ccSectionExtractionTool::exportSections()
 	ccLog::Print(QString("[ccSectionExtractionTool] %1 sections exported").arg(exportCount));
 }
 
-bool ccSectionExtractionTool::extractSectionContour(const ccPolyline* originalSection,
-													const ccPointCloud* originalSectionCloud,
-													ccPointCloud* unrolledSectionCloud,
-													unsigned sectionIndex,
-													ccContourExtractor::ContourType contourType,
-													PointCoordinateType maxEdgeLength,
-													bool multiPass,
-													bool splitContour,
-													bool& contourGenerated,
-													bool visualDebugMode/*=false*/)
+void ccSectionExtractionTool::exportSectionContours(const ccPolyline* originalSection,
+													std::vector<ccPolyline*>& parts,
+													unsigned sectionIndex)
 {
-	contourGenerated = false;
-
-	if (!originalSectionCloud || !unrolledSectionCloud)
-	{
-		ccLog::Warning("[ccSectionExtractionTool][extract contour] Internal error: invalid input parameter(s)");
-		return false;
-	}
-	
-	if (originalSectionCloud->size() < 2)
-	{
-		//nothing to do
-		ccLog::Warning(QString("[ccSectionExtractionTool][extract contour] Section #%1 contains less than 2 points and will be ignored").arg(sectionIndex));
-		return true;
-	}
-
-	//by default, the points in 'unrolledSectionCloud' are 2D (X = curvilinear coordinate, Y = height, Z = 0)
-	CCVector3 N(0,0,1);
-	CCVector3 Y(0,1,0);
+	//create output group if necessary
+	ccHObject* destEntity = getExportGroup(s_profileExportGroupID,"Extracted profiles");
+	assert(destEntity);
 
-	std::vector<unsigned> vertIndexes;
-	ccPolyline* contour = ccContourExtractor::ExtractFlatContour(	unrolledSectionCloud,
-																	multiPass,
-																	maxEdgeLength,
-																	N.u,
-																	Y.u,
-																	contourType,
-																	&vertIndexes,
-																	visualDebugMode);
-	if (contour)
+	for (size_t p=0; p<parts.size(); ++p)
 	{
-		//update vertices (to replace 'unrolled' points by 'original' ones
+		ccPolyline* contourPart = parts[p];
+		QString name = QString("Section contour #%1").arg(sectionIndex);
+		if (parts.size() > 1)
+			name += QString("(part %1/%2)").arg(p+1).arg(parts.size());
+		contourPart->setName(name);
+		contourPart->setColor(s_defaultContourColor);
+		contourPart->showColors(true);
+		//copy meta-data (import for Mascaret export!)
 		{
-			CCLib::GenericIndexedCloud* vertices = contour->getAssociatedCloud();
-			if (vertIndexes.size() == static_cast<size_t>(vertices->size()))
+			const QVariantMap& metaData = originalSection->metaData();
+			for (QVariantMap::const_iterator it = metaData.begin(); it != metaData.end(); ++it)
 			{
-				for (unsigned i=0; i<vertices->size(); ++i)
-				{
-					const CCVector3* P = vertices->getPoint(i);
-					assert(vertIndexes[i] < originalSectionCloud->size());
-					*const_cast<CCVector3*>(P) = *originalSectionCloud->getPoint(vertIndexes[i]);
-				}
-			
-				ccPointCloud* verticesAsPC = dynamic_cast<ccPointCloud*>(vertices);
-				if (verticesAsPC)
-					verticesAsPC->refreshBB();
-			}
-			else
-			{
-				ccLog::Warning("[ccSectionExtractionTool][extract contour] Internal error (couldn't fetch original points indexes?!)");
-				delete contour;
-				return false;
-			}
-		}
-
-		std::vector<ccPolyline*> parts;
-		if (splitContour)
-		{
-#ifdef QT_DEBUG
-			//compute some stats on the contour
-			{
-				double minLength = 0;
-				double maxLength = 0;
-				double sumLength = 0;
-				unsigned count = contour->size();
-				if (!contour->isClosed())
-					--count;
-				for (unsigned i=0; i<count; ++i)
-				{
-					const CCVector3* A = contour->getPoint(i);
-					const CCVector3* B = contour->getPoint((i+1) % contour->size());
-					CCVector3 e = *B - *A;
-					double l = e.norm();
-					if (i != 0)
-					{
-						minLength = std::min(minLength,l);
-						maxLength = std::max(maxLength,l);
-						sumLength += l;
-					}
-					else
-					{
-						minLength = maxLength = sumLength = l;
-					}
-				}
-				ccLog::PrintDebug(QString("Contour: min = %1 / avg = %2 / max = %3").arg(minLength).arg(sumLength/count).arg(maxLength));
+				contourPart->setMetaData(it.key(),it.value());
 			}
-#endif
-
-			/*bool success = */contour->split(maxEdgeLength,parts);
-			delete contour;
-			contour = 0;
 		}
-		else
-		{
-			parts.push_back(contour);
-		}
-
-		//create output group if necessary
-		ccHObject* destEntity = getExportGroup(s_profileExportGroupID,"Extracted profiles");
-		assert(destEntity);
 
-		for (size_t p=0; p<parts.size(); ++p)
+		//add to main DB
+		if (destEntity)
 		{
-			ccPolyline* contourPart = parts[p];
-			QString name = QString("Section contour #%1").arg(sectionIndex);
-			if (parts.size() > 1)
-				name += QString("(part %1/%2)").arg(p+1).arg(parts.size());
-			contourPart->setName(name);
-			contourPart->setGlobalScale(originalSectionCloud->getGlobalScale());
-			contourPart->setGlobalShift(originalSectionCloud->getGlobalShift());
-			contourPart->setColor(s_defaultContourColor);
-			contourPart->showColors(true);
-			//copy meta-data (import for Mascaret export!)
-			{
-				const QVariantMap& metaData = originalSection->metaData();
-				for (QVariantMap::const_iterator it = metaData.begin(); it != metaData.end(); ++it)
-				{
-					contourPart->setMetaData(it.key(),it.value());
-				}
-			}
-
-			//add to main DB
 			destEntity->addChild(contourPart);
 			contourPart->setDisplay_recursive(destEntity->getDisplay());
-			MainWindow::TheInstance()->addToDB(contourPart,false,false);
 		}
-
-		contourGenerated = true;
+		MainWindow::TheInstance()->addToDB(contourPart,false,false);
 	}
 
-	return true;
+	//the parts now belong to the DB
+	parts.clear();
 }
 
-bool ccSectionExtractionTool::extractSectionCloud(	const std::vector<CCLib::ReferenceCloud*>& refClouds,
-													unsigned sectionIndex,
-													bool& cloudGenerated)
+void ccSectionExtractionTool::exportSectionCloud(ccPointCloud* sectionCloud, unsigned sectionIndex)
 {
-	cloudGenerated = false;
+	assert(sectionCloud);
 
-	ccPointCloud* sectionCloud = 0;
-	for (int i=0; i<static_cast<int>(refClouds.size()); ++i)
-	{
-		if (!refClouds[i])
-			continue;
-		assert(m_clouds[i].entity); //a valid ref. cloud must have a valid counterpart!
-		
-		//extract part/section from each cloud
-		ccPointCloud* part = 0;
-		{
-			//if the cloud is a ccPointCloud, we can keep a lot more information
-			//when extracting the section cloud
-			ccPointCloud* pc = dynamic_cast<ccPointCloud*>(m_clouds[i].entity);
-			if (pc)
-			{
-				part = pc->partialClone(refClouds[i]);
-			}
-			else
-			{
-				part = ccPointCloud::From(refClouds[i],m_clouds[i].entity);
-			}
-		}
+	//create output group if necessary
+	ccHObject* destEntity = getExportGroup(s_cloudExportGroupID, "Extracted section clouds");
+	assert(destEntity);
 
-		if (part)
-		{
-			if (i == 0)
-			{
-				//we simply use this 'part' cloud as the section cloud
-				sectionCloud = part;
-			}
-			else
-			{
-				//fuse it with the global cloud
-				unsigned cloudSizeBefore = sectionCloud->size();
-				unsigned partSize        = part->size();
-				sectionCloud->append(part,cloudSizeBefore,true);
-
-				//don't need it anymore
-				delete part;
-				part = 0;
-				//check that it actually worked!
-				if (sectionCloud->size() != cloudSizeBefore + partSize)
-				{
-					//not enough memory
-					ccLog::Warning("[ccSectionExtractionTool][extract cloud] Not enough memory");
-					if (sectionCloud)
-						delete sectionCloud;
-					return false;
-				}
-			}
-		}
-		else
-		{
-			//not enough memory
-			ccLog::Warning("[ccSectionExtractionTool][extract cloud] Not enough memory");
-			if (sectionCloud)
-				delete sectionCloud;
-			return false;
-		}
-	}
+	sectionCloud->setName(QString("Section cloud #%1").arg(sectionIndex));
 
-	if (sectionCloud)
+	//add to main DB
+	if (destEntity)
 	{
-		//create output group if necessary
-		ccHObject* destEntity = getExportGroup(s_cloudExportGroupID, "Extracted section clouds");
-		assert(destEntity);
-
-		sectionCloud->setName(QString("Section cloud #%1").arg(sectionIndex));
 		sectionCloud->setDisplay(destEntity->getDisplay());
-
-		//add to main DB
 		destEntity->addChild(sectionCloud);
-		MainWindow::TheInstance()->addToDB(sectionCloud,false,false);
-
-		cloudGenerated  = true;
 	}
-
-	return true;
+	MainWindow::TheInstance()->addToDB(sectionCloud,false,false);
 }
 
-struct Segment
-{
-	Segment()
-		: A(0,0)
-		, B(0,0)
-		, u(0,0)
-		, d(0)
-		, curvPos(0)
-	{}
-
-	CCVector2 A, B, u;
-	PointCoordinateType d, curvPos;
-};
-
 void ccSectionExtractionTool::unfoldPoints()
 {
 	if (!m_selectedPoly || !m_selectedPoly->entity)
@@ -1529,59 +1345,42 @@ void ccSectionExtractionTool::unfoldPoints()
 	//projection direction
 	int vertDim = vertAxisComboBox->currentIndex();
 	int xDim = (vertDim < 2 ? vertDim+1 : 0);
-	int yDim = (xDim    < 2 ? xDim+1    : 0);
 
-	//we consider half of the total thickness as points can be on both sides!
-	double maxSquareDistToPolyline = (thickness/2) * (thickness/2);
-
-	//prepare the computation of 2D distances
-	std::vector<Segment> segments;
-	unsigned polyMaxCount = poly->isClosed() ? polyVertCount : polyVertCount-1;
+	//the clouds are indexed once (in 2D)
+	std::vector<ccGenericPointCloud*> clouds;
+	try
 	{
-		try
-		{
-			segments.reserve(polyMaxCount);
-		}
-		catch (const std::bad_alloc&)
-		{
-			//not enough memory
-			ccLog::Error("Not enough memory");
-			return;
-		}
-
-		PointCoordinateType curvPos = 0;
-		for (unsigned j=0; j<polyMaxCount; ++j)
-		{
-			//current polyline segment
-			const CCVector3* A = poly->getPoint(j);
-			const CCVector3* B = poly->getPoint((j+1) % polyVertCount);
-
-			Segment s;
-			{
-				s.A = CCVector2(A->u[xDim],A->u[yDim]);
-				s.B = CCVector2(B->u[xDim],B->u[yDim]);
-				s.u = s.B - s.A;
-				s.d = s.u.norm();
-				if (s.d > ZERO_TOLERANCE)
-				{
-					s.curvPos = curvPos;
-					s.u /= s.d;
-					segments.push_back(s);
-				}
-			}
-
-			//update curvilinear pos
-			curvPos += (*B-*A).norm();
-		}
+		clouds.reserve(m_clouds.size());
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		ccLog::Error("Not enough memory");
+		return;
+	}
+	for (int c=0; c<m_clouds.size(); ++c)
+	{
+		clouds.push_back(m_clouds[c].entity);
 	}
 
+	unsigned polyMaxCount = poly->isClosed() ? polyVertCount : polyVertCount-1;
+
 	ccProgressDialog pdlg(true);
-	CCLib::NormalizedProgress nprogress(&pdlg, totalPointCount);
 	pdlg.setMethodTitle(tr("Unfold cloud(s)"));
 	pdlg.setInfo(tr("Number of segments: %1\nNumber of points: %2").arg(polyMaxCount).arg(totalPointCount));
 	pdlg.start();
 	QCoreApplication::processEvents();
 
+	ccBatchSectionExtractor extractor(static_cast<unsigned char>(vertDim));
+	if (!extractor.setClouds(clouds, thickness, &pdlg))
+	{
+		if (pdlg.wasCanceled())
+			ccLog::Warning("[Unfold] Process cancelled by the user");
+		else
+			ccLog::Error("Not enough memory");
+		return;
+	}
+
 	unsigned exportedClouds = 0;
 
 	//for each cloud
@@ -1594,98 +1393,18 @@ void ccSectionExtractionTool::unfoldPoints()
 			continue;
 		}
 
+		//now find the points close to the polyline (in 2D)
 		CCLib::ReferenceCloud unfoldedIndexes(cloud);
-		if (!unfoldedIndexes.reserve(cloud->size()))
-		{
-			ccLog::Error("Not enough memory");
-			return;
-		}
 		std::vector<CCVector3> unfoldedPoints;
-		try
-		{
-			unfoldedPoints.reserve(cloud->size());
-		}
-		catch (const std::bad_alloc&)
+		if (!extractor.unfold(static_cast<size_t>(c), poly, thickness, unfoldedIndexes, unfoldedPoints, &pdlg))
 		{
-			ccLog::Error("Not enough memory");
+			if (pdlg.wasCanceled())
+				ccLog::Warning("[Unfold] Process cancelled by the user");
+			else
+				ccLog::Error("Not enough memory");
 			return;
 		}
 
-		//now test each point and see if it's close to the current polyline (in 2D)
-		for (unsigned i=0; i<cloud->size(); ++i)
-		{
-			const CCVector3* P = cloud->getPoint(i);
-			CCVector2 P2D(P->u[xDim],P->u[yDim]);
-
-			//test each segment
-			int closestSegment = -1;
-			PointCoordinateType minSquareDist = -PC_ONE;
-			for (unsigned j=0; j<polyMaxCount; ++j)
-			{
-				const Segment& s = segments[j];
-				CCVector2 AP2D = P2D - s.A;
-
-				//longitudinal 'distance'
-				PointCoordinateType dotprod = s.u.dot(AP2D);
-
-				PointCoordinateType squareDist = 0;
-				if (dotprod < 0)
-				{
-					//dist to nearest vertex
-					squareDist = AP2D.norm2();
-				}
-				else if (dotprod > s.d)
-				{
-					//dist to nearest vertex
-					squareDist = (P2D - s.B).norm2();
-				}
-				else
-				{
-					//orthogonal distance
-					squareDist = (AP2D - s.u*dotprod).norm2();
-				}
-				
-				if (squareDist <= maxSquareDistToPolyline)
-				{
-					if (closestSegment < 0 || squareDist < minSquareDist)
-					{
-						minSquareDist = squareDist;
-						closestSegment = static_cast<int>(j);
-					}
-				}
-			}
-
-			if (closestSegment >= 0)
-			{
-				const Segment& s = segments[closestSegment];
-
-				//we use the curvilinear position of the point in the X dimension (and Y is 0)
-				CCVector3 Q;
-				{
-					CCVector2 AP2D = P2D - s.A;
-					PointCoordinateType dotprod = s.u.dot(AP2D);
-					PointCoordinateType d = (AP2D - s.u*dotprod).norm();
-
-					//compute the sign of 'minDist'
-					PointCoordinateType crossprod = AP2D.y * s.u.x - AP2D.x * s.u.y;
-
-					Q.u[xDim]    = s.curvPos + dotprod;
-					Q.u[yDim]    = crossprod < 0 ? -d : d; //signed orthogonal distance to the polyline
-					Q.u[vertDim] = P->u[vertDim];
-				}
-
-				unfoldedIndexes.addPointIndex(i);
-				unfoldedPoints.push_back(Q);
-			}
-
-			if (!nprogress.oneStep())
-			{
-				ccLog::Warning("[Unfold] Process cancelled by the user");
-				return;
-			}
-
-		} //for each point
-
 		if (unfoldedIndexes.size() != 0)
 		{
 			//assign the default global shift & scale info
@@ -1803,7 +1522,6 @@ void ccSectionExtractionTool::extractPoints()
 
 	//progress dialog
 	ccProgressDialog pdlg(true);
-	CCLib::NormalizedProgress nprogress(&pdlg, static_cast<unsigned>(sectionCount));
 	if (!visualDebugMode)
 	{
 		pdlg.setMethodTitle(tr("Extract sections"));
@@ -1813,257 +1531,99 @@ void ccSectionExtractionTool::extractPoints()
 	}
 
 	int vertDim = vertAxisComboBox->currentIndex();
-	int xDim = (vertDim < 2 ? vertDim+1 : 0);
-	int yDim = (xDim    < 2 ? xDim+1    : 0);
-
-	//we consider half of the total thickness as points can be on both sides!
-	double sectionThicknessSq = pow(s_defaultSectionThickness/2,2.0);
-	bool error = false;
-
-	unsigned generatedContours = 0;
-	unsigned generatedClouds = 0;
 
+	//eligible sections
+	std::vector<ccPolyline*> polylines;
+	std::vector<unsigned> sectionIndexes;
+	std::vector<ccGenericPointCloud*> clouds;
 	try
 	{
-		//for each slice
+		polylines.reserve(sectionCount);
+		sectionIndexes.reserve(sectionCount);
 		for (int s=0; s<m_sections.size(); ++s)
 		{
-			ccPolyline* poly = m_sections[s].entity;
-			if (poly)
-			{
-				unsigned polyVertCount = poly->size();
-				if (polyVertCount < 2)
-				{
-					assert(false);
-					continue;
-				}
-				unsigned polyMaxCount = poly->isClosed() ? polyVertCount : polyVertCount-1;
-
-				int cloudCount = m_clouds.size();
-				std::vector<CCLib::ReferenceCloud*> refClouds;
-				if (s_extractSectionsAsClouds)
-				{
-					refClouds.resize(cloudCount,0);
-				}
-
-				//for contour extraction as a polyline
-				ccPointCloud* originalSlicePoints = 0;
-				ccPointCloud* unrolledSlicePoints = 0;
-				if (s_extractSectionsAsContours)
-				{
-					originalSlicePoints = new ccPointCloud("section.orig");
-					unrolledSlicePoints = new ccPointCloud("section.unroll");
-
-					//assign them the default (first!) global shift & scale info
-					assert(!m_clouds.empty());
-					ccGenericPointCloud* cloud = m_clouds.front().entity;
-					originalSlicePoints->setGlobalScale(cloud->getGlobalScale());
-					originalSlicePoints->setGlobalShift(cloud->getGlobalShift());
-				}
-
-				//for each cloud
-				for (int c=0; c<cloudCount; ++c)
-				{
-					ccGenericPointCloud* cloud = m_clouds[c].entity;
-					if (cloud)
-					{
-						//for contour extraction as a cloud
-						CCLib::ReferenceCloud* refCloud = 0;
-						if (s_extractSectionsAsClouds)
-						{
-							refCloud = new CCLib::ReferenceCloud(cloud);
-						}
-
-						//now test each point and see if it's close to the current polyline (in 2D)
-						PointCoordinateType s = 0;
-						for (unsigned j=0; j<polyMaxCount; ++j)
-						{
-							//current polyline segment
-							const CCVector3* A = poly->getPoint(j);
-							const CCVector3* B = poly->getPoint((j+1) % polyVertCount);
-							CCVector2 A2D(A->u[xDim],A->u[yDim]);
-							CCVector2 B2D(B->u[xDim],B->u[yDim]);
-
-							CCVector2 u = B2D-A2D;
-							PointCoordinateType d = u.norm();
-							if (d < ZERO_TOLERANCE)
-								continue;
-							u /= d;
-
-							//compute the distance of each point to the current polyline segment
-							for (unsigned i=0; i<cloud->size(); ++i)
-							{
-								const CCVector3* P = cloud->getPoint(i);
-								CCVector2 P2D(P->u[xDim],P->u[yDim]);
-								CCVector2 AP2D = P2D-A2D;
-								
-								//longitudinal 'distance'
-								PointCoordinateType dotprod = u.dot(AP2D);
-								if (dotprod < 0 || dotprod > d)
-									continue;
-
-								//orthogonal distance
-								PointCoordinateType h = (AP2D - u*dotprod).norm2();
-								if (h <= sectionThicknessSq)
-								{
-									//if we extract the section as cloud(s), we add the point to the (current) ref. cloud
-									if (s_extractSectionsAsClouds)
-									{
-										assert(refCloud);
-										unsigned refCloudSize = refCloud->size();
-										if (refCloudSize == refCloud->capacity())
-										{
-											refCloudSize += (refCloudSize/2 + 1);
-											if (!refCloud->reserve(refCloudSize))
-											{
-												//not enough memory
-												ccLog::Warning("[ccSectionExtractionTool] Not enough memory");
-												error = true;
-												break;
-											}
-										}
-										refCloud->addPointIndex(i);
-									}
-
-									//if we extract the section as contour(s), we add it to the 2D points set
-									if (s_extractSectionsAsContours)
-									{
-										assert(originalSlicePoints && unrolledSlicePoints);
-										assert(originalSlicePoints->size() == unrolledSlicePoints->size());
-										
-										unsigned cloudSize = originalSlicePoints->size();
-										if (cloudSize == originalSlicePoints->capacity())
-										{
-											cloudSize += (cloudSize/2 + 1);
-											if (	!originalSlicePoints->reserve(cloudSize)
-												||	!unrolledSlicePoints->reserve(cloudSize))
-											{
-												//not enough memory
-												ccLog::Warning("[ccSectionExtractionTool] Not enough memory");
-												error = true;
-												break;
-											}
-										}
-
-										//we project the 'real' 3D point in the section plane
-										CCVector3 Pproj3D;
-										{
-											Pproj3D.u[xDim]    = A2D.x + u.x * dotprod;
-											Pproj3D.u[yDim]    = A2D.y + u.y * dotprod;
-											Pproj3D.u[vertDim] = P->u[vertDim];
-										}
-										originalSlicePoints->addPoint(Pproj3D);
-										unrolledSlicePoints->addPoint(CCVector3(s+dotprod,P->u[vertDim],0));
-									}
-								}
-							}
-
-							if (error)
-								break;
-
-							//update curvilinear length
-							CCVector3 AB = *B - *A;
-							s += AB.norm();
-						
-						} //for (unsigned j=0; j<polyMaxCount; ++j)
-
-						if (refCloud)
-						{
-							assert(s_extractSectionsAsClouds);
-							if (error || refCloud->size() == 0)
-							{
-								delete refCloud;
-								refCloud = 0;
-							}
-							else
-							{
-								refClouds[c] = refCloud;
-							}
-						}
-
-					} //if (cloud)
-
-					if (error)
-						break;
-				
-				} //for (int c=0; c<cloudCount; ++c)
-
-				if (!error)
-				{
-					//Extract sections as (polyline) contours
-					if (/*!error && */s_extractSectionsAsContours)
-					{
-						assert(originalSlicePoints && unrolledSlicePoints);
-						bool contourGenerated = false;
-						error = !extractSectionContour(	poly,
-														originalSlicePoints,
-														unrolledSlicePoints,
-														s+1,
-														s_extractSectionsType,
-														s_contourMaxEdgeLength,
-														s_multiPass,
-														s_splitContour,
-														contourGenerated,
-														visualDebugMode);
-
-						if (contourGenerated)
-							++generatedContours;
-					}
-					
-					//Extract sections as clouds
-					if (!error && s_extractSectionsAsClouds)
-					{
-						assert(static_cast<int>(refClouds.size()) == cloudCount);
-						bool cloudGenerated = false;
-						error = !extractSectionCloud(refClouds,s+1,cloudGenerated);
-						if (cloudGenerated)
-							++generatedClouds;
-					}
-				}
-				
-				//release memory
-				{
-					for (size_t i=0; i<refClouds.size(); ++i)
-					{
-						if (refClouds[i])
-							delete refClouds[i];
-						refClouds[i] = 0;
-					}
-
-					if (originalSlicePoints)
-					{
-						delete originalSlicePoints;
-						originalSlicePoints = 0;
-					}
-					if (unrolledSlicePoints)
-					{
-						delete unrolledSlicePoints;
-						unrolledSlicePoints = 0;
-					}
-				}
-			} //if (poly)
-
-			if (!nprogress.oneStep())
+			if (m_sections[s].entity && m_sections[s].entity->size() > 1)
 			{
-				ccLog::Warning("[ccSectionExtractionTool] Canceled by user");
-				error = true;
+				polylines.push_back(m_sections[s].entity);
+				sectionIndexes.push_back(static_cast<unsigned>(s+1));
 			}
+		}
 
-			if (error)
-				break;
-		} //for (int s=0; s<m_sections.size(); ++s)
+		for (int c=0; c<m_clouds.size(); ++c)
+		{
+			if (m_clouds[c].entity)
+				clouds.push_back(m_clouds[c].entity);
+		}
 	}
 	catch (const std::bad_alloc&)
 	{
-		error = true;
+		//not enough memory
+		ccLog::Error("Not enough memory");
+		return;
 	}
 
-	if (error)
-	{
-		ccLog::Error("An error occurred (see console)");
+	ccBatchSectionExtractor::Parameters params;
+	params.thickness       = s_defaultSectionThickness;
+	params.extractClouds   = s_extractSectionsAsClouds;
+	params.extractContours = s_extractSectionsAsContours;
+	params.contourType     = s_extractSectionsType;
+	params.maxEdgeLength   = static_cast<PointCoordinateType>(s_contourMaxEdgeLength);
+	params.multiPass       = s_multiPass;
+	params.splitContours   = s_splitContour;
+	params.visualDebugMode = visualDebugMode;
+
+	//the clouds are indexed once (in 2D), then all the sections are extracted at once
+	ccBatchSectionExtractor extractor(static_cast<unsigned char>(vertDim));
+	std::vector<ccBatchSectionExtractor::Section> sections;
+	CCLib::GenericProgressCallback* progressCb = visualDebugMode ? 0 : &pdlg;
+	if (	!extractor.setClouds(clouds, s_defaultSectionThickness, progressCb)
+		||	!extractor.extractSections(polylines, params, sections, progressCb))
+	{
+		if (!pdlg.wasCanceled())
+		{
+			ccLog::Error("An error occurred (see console)");
+			return;
+		}
+
+		//the sections extracted before the cancellation are still exported
+		ccLog::Warning(QString("[ccSectionExtractionTool] Process cancelled by the user (%1 section(s) out of %2 extracted)").arg(sections.size()).arg(polylines.size()));
+		if (sections.empty())
+		{
+			return;
+		}
 	}
-	else
+	pdlg.stop();
+
+	unsigned generatedContours = 0;
+	unsigned generatedClouds = 0;
+
+	for (size_t i=0; i<sections.size(); ++i)
 	{
-		ccLog::Print(QString("[ccSectionExtractionTool] Job done (%1 contour(s) and %2 cloud(s) were generated)").arg(generatedContours).arg(generatedClouds));
+		ccBatchSectionExtractor::Section& section = sections[i];
+		unsigned sectionIndex = sectionIndexes[i];
+
+		//Extract sections as (polyline) contours
+		if (s_extractSectionsAsContours)
+		{
+			if (section.pointCount < 2)
+			{
+				ccLog::Warning(QString("[ccSectionExtractionTool][extract contour] Section #%1 contains less than 2 points and will be ignored").arg(sectionIndex));
+			}
+			else if (!section.contours.empty())
+			{
+				exportSectionContours(polylines[i], section.contours, sectionIndex);
+				++generatedContours;
+			}
+		}
+
+		//Extract sections as clouds
+		if (section.cloud)
+		{
+			exportSectionCloud(section.cloud, sectionIndex);
+			section.cloud = 0;
+			++generatedClouds;
+		}
 	}
+
+	ccLog::Print(QString("[ccSectionExtractionTool] Job done (%1 contour(s) and %2 cloud(s) were generated)").arg(generatedContours).arg(generatedClouds));
 }
@@ -94,22 +94,13 @@ protected:
 	//! Adds a 'step' on the undo stack
 	void addUndoStep();
 
-	//! Convert one or several ReferenceCloud instances to a single cloud and add it to the main DB
-	bool extractSectionCloud(	const std::vector<CCLib::ReferenceCloud*>& refClouds,
-								unsigned sectionIndex,
-								bool& cloudGenerated);
-
-	//! Extract the contour from a set of 2D points and add it to the main DB
-	bool extractSectionContour(	const ccPolyline* originalSection,
-								const ccPointCloud* originalSectionCloud,
-								ccPointCloud* unrolledSectionCloud, //'2D' cloud with Z = 0
-								unsigned sectionIndex,
-								ccContourExtractor::ContourType type,
-								PointCoordinateType maxEdgeLength,
-								bool multiPass,
-								bool splitContour,
-								bool& contourGenerated,
-								bool visualDebugMode = false);
+	//! Adds the contour part(s) of a section to the main DB (the DB takes their ownership)
+	void exportSectionContours(	const ccPolyline* originalSection,
+								std::vector<ccPolyline*>& parts,
+								unsigned sectionIndex);
+
+	//! Adds a section cloud to the main DB (the DB takes its ownership)
+	void exportSectionCloud(ccPointCloud* sectionCloud, unsigned sectionIndex);
 
 	//! Creates (if necessary) and returns a group to store entities in the main DB
 	ccHObject* getExportGroup(unsigned& defaultGroupID, QString defaultName);
@@ -0,0 +1,1244 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#include "ccTiledDelaunay.h"
+
+//CCLib
+#include <Delaunay2dMesh.h>
+#include <PointProjectionTools.h>
+
+//qCC_db
+#include <ccGenericPointCloud.h>
+#include <ccLog.h>
+#include <ccMesh.h>
+
+//Qt
+#include <QThread>
+
+//system
+#include <assert.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <list>
+#include <utility>
+#include <vector>
+
+//! Max number of tiles along each dimension
+static const unsigned MAX_TILE_COUNT_PER_DIM = 4096;
+
+//! 2D rectangle
+struct TileRect
+{
+	TileRect(double x0 = 0, double y0 = 0, double x1 = 0, double y1 = 0)
+		: minX(x0), minY(y0), maxX(x1), maxY(y1)
+	{}
+
+	inline bool intersects(double x0, double y0, double x1, double y1) const
+	{
+		return x0 <= maxX && x1 >= minX && y0 <= maxY && y1 >= minY;
+	}
+
+	double minX, minY, maxX, maxY;
+};
+
+//! Shared data of the tiled triangulation
+struct TiledDelaunayContext
+{
+	TiledDelaunayContext()
+		: cloud(0)
+		, X(0)
+		, Y(1)
+		, tileWidth(0)
+		, tileHeight(0)
+		, tileCountX(1)
+		, tileCountY(1)
+		, initialOverlap(0)
+		, maxOverlap(0)
+		, epsilon(0)
+		, squareMaxEdgeLength(0)
+	{}
+
+	//! Returns the index of the tile (along one dimension) of a given value
+	static inline unsigned TileCoord(double value, double origin, double step, unsigned count)
+	{
+		if (step <= 0)
+			return 0;
+		double c = std::floor((value - origin) / step);
+		if (c <= 0)
+			return 0;
+		return std::min(static_cast<unsigned>(c), count - 1);
+	}
+
+	inline unsigned tileCoordX(double x) const { return TileCoord(x, box.minX, tileWidth, tileCountX); }
+	inline unsigned tileCoordY(double y) const { return TileCoord(y, box.minY, tileHeight, tileCountY); }
+
+	//! Returns the core rectangle of a tile
+	TileRect tileRect(unsigned i, unsigned j) const
+	{
+		return TileRect(box.minX + i * tileWidth,
+						box.minY + j * tileHeight,
+						i + 1 == tileCountX ? box.maxX : box.minX + (i + 1) * tileWidth,
+						j + 1 == tileCountY ? box.maxY : box.minY + (j + 1) * tileHeight);
+	}
+
+	ccGenericPointCloud* cloud;
+	//! Horizontal dimensions
+	unsigned char X, Y;
+	//! 2D bounding-box of the points
+	TileRect box;
+	double tileWidth, tileHeight;
+	unsigned tileCountX, tileCountY;
+	//! Index of the first point of each tile (+ the total number of points)
+	std::vector<unsigned> tileStart;
+	//! Point indexes (sorted by tile)
+	std::vector<unsigned> pointIndexes;
+	//! Global convex hull (counter-clockwise)
+	std::vector<CCVector2d> hull;
+	//! Indexes of the global convex hull vertices
+	std::vector<unsigned> hullIndexes;
+	//! Initial overlap band width
+	double initialOverlap;
+	//! Max overlap band width
+	double maxOverlap;
+	//! Geometrical tolerance
+	double epsilon;
+	//! Squared max edge length (0 = ignored)
+	double squareMaxEdgeLength;
+};
+
+//! Tile processing status
+enum TileStatus { TILE_OK = 0, TILE_NOT_ENOUGH_MEMORY, TILE_TRIANGULATION_ERROR, TILE_DEFERRED };
+
+//! Returns whether a rectangle intersects the global convex hull (conservative)
+static bool IntersectsHull(const TiledDelaunayContext& ctx, const TileRect& rect)
+{
+	const std::vector<CCVector2d>& hull = ctx.hull;
+	size_t vertCount = hull.size();
+
+	//separating axis test (the rectangle axes have already been tested by the caller)
+	for (size_t i = 0; i < vertCount; ++i)
+	{
+		const CCVector2d& A = hull[i];
+		CCVector2d AB = hull[(i + 1) % vertCount] - A;
+		double tol = ctx.epsilon * AB.norm();
+		if (	AB.cross(CCVector2d(rect.minX, rect.minY) - A) < -tol
+			&&	AB.cross(CCVector2d(rect.maxX, rect.minY) - A) < -tol
+			&&	AB.cross(CCVector2d(rect.maxX, rect.maxY) - A) < -tol
+			&&	AB.cross(CCVector2d(rect.minX, rect.maxY) - A) < -tol)
+		{
+			//all the corners are outside of the hull
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//! Returns whether the line of a segment supports the global convex hull
+/** \param A first segment vertex
+	\param B second segment vertex
+	\param C a point on the inner side of the segment
+**/
+static bool IsGlobalHullEdge(const TiledDelaunayContext& ctx, const CCVector2d& A, const CCVector2d& B, const CCVector2d& C)
+{
+	CCVector2d AB = B - A;
+	double inner = AB.cross(C - A);
+	if (inner == 0)
+		return false;
+	double sign = (inner < 0 ? -1.0 : 1.0);
+	double tol = ctx.epsilon * AB.norm();
+
+	for (size_t i = 0; i < ctx.hull.size(); ++i)
+	{
+		if (sign * AB.cross(ctx.hull[i] - A) < -tol)
+		{
+			//this hull vertex is on the outer side
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//! Computes the circumcircle of a triangle (slightly enlarged, to be conservative)
+/** \return false if the triangle is degenerate
+**/
+static bool GetCircumcircle(const TiledDelaunayContext& ctx,
+							const CCVector2d& A,
+							const CCVector2d& B,
+							const CCVector2d& C,
+							CCVector2d& O,
+							double& r)
+{
+	CCVector2d AB = B - A;
+	CCVector2d AC = C - A;
+	double d = 2.0 * AB.cross(AC);
+	if (d == 0)
+	{
+		//degenerate triangle
+		return false;
+	}
+
+	double ab2 = AB.norm2();
+	double ac2 = AC.norm2();
+	CCVector2d u((AC.y * ab2 - AB.y * ac2) / d, (AB.x * ac2 - AC.x * ab2) / d);
+	O = A + u;
+	r = u.norm() * (1.0 + 1.0e-6) + ctx.epsilon;
+
+	return true;
+}
+
+//! Returns whether the circumcircle of a triangle is inside the region covered by the local points
+/** Only the part of the circle inside the global bounding-box matters.
+	\param region region covered by the local points
+	\param open for each side of the region (-X, +X, -Y, +Y), whether it extends beyond the global bounding-box
+**/
+static bool HasSafeCircumcircle(const TiledDelaunayContext& ctx,
+								const TileRect& region,
+								const bool open[4],
+								const CCVector2d& A,
+								const CCVector2d& B,
+								const CCVector2d& C)
+{
+	CCVector2d O;
+	double r = 0;
+	if (!GetCircumcircle(ctx, A, B, C, O, r))
+		return false;
+
+	const TileRect& box = ctx.box;
+
+	//bounding-box of the intersection between the disk and the global bounding-box
+	double dy = std::max(0.0, std::max(box.minY - O.y, O.y - box.maxY));
+	double dx = std::max(0.0, std::max(box.minX - O.x, O.x - box.maxX));
+	if (dx > r || dy > r)
+	{
+		//the disk doesn't intersect the global bounding-box (shouldn't happen)
+		return true;
+	}
+	double halfWidth = std::sqrt(r * r - dy * dy);
+	double halfHeight = std::sqrt(r * r - dx * dx);
+
+	return	(open[0] || std::max(O.x - halfWidth, box.minX) >= region.minX)
+		&&	(open[1] || std::min(O.x + halfWidth, box.maxX) <= region.maxX)
+		&&	(open[2] || std::max(O.y - halfHeight, box.minY) >= region.minY)
+		&&	(open[3] || std::min(O.y + halfHeight, box.maxY) <= region.maxY);
+}
+
+//! Returns whether the circumcircle of a triangle contains none of the points outside of the local triangulation
+/** The points of the local triangulation are already outside of the circle (by construction).
+	The points (nearly) on the circle are considered as inside.
+	\param region region covered by the local points
+	\param localTiles tiles whose points are all part of the local triangulation (may be empty)
+	\param vertIndexes global indexes of the triangle vertices
+	\param conflictTiles if not null, the (not local) tiles overlapping a non-empty circle are flagged
+**/
+static bool HasEmptyCircumcircle(	const TiledDelaunayContext& ctx,
+									const TileRect& region,
+									const std::vector<char>& localTiles,
+									const CCVector2d& A,
+									const CCVector2d& B,
+									const CCVector2d& C,
+									const unsigned vertIndexes[3],
+									std::vector<char>* conflictTiles = 0)
+{
+	CCVector2d O;
+	double r = 0;
+	if (!GetCircumcircle(ctx, A, B, C, O, r))
+		return false;
+	double r2 = r * r;
+
+	//tiles overlapping the circle
+	double x0 = std::max(O.x - r, ctx.box.minX);
+	double x1 = std::min(O.x + r, ctx.box.maxX);
+	double y0 = std::max(O.y - r, ctx.box.minY);
+	double y1 = std::min(O.y + r, ctx.box.maxY);
+	if (x0 > x1 || y0 > y1)
+		return true;
+	unsigned i0 = ctx.tileCoordX(x0);
+	unsigned i1 = ctx.tileCoordX(x1);
+	unsigned j0 = ctx.tileCoordY(y0);
+	unsigned j1 = ctx.tileCoordY(y1);
+
+	bool empty = true;
+	for (unsigned j = j0; j <= j1 && empty; ++j)
+	{
+		for (unsigned i = i0; i <= i1 && empty; ++i)
+		{
+			unsigned t = j * ctx.tileCountX + i;
+			if (!localTiles.empty() && localTiles[t])
+				continue;
+
+			TileRect rect = ctx.tileRect(i, j);
+			if (	rect.minX - ctx.epsilon >= region.minX && rect.maxX + ctx.epsilon <= region.maxX
+				&&	rect.minY - ctx.epsilon >= region.minY && rect.maxY + ctx.epsilon <= region.maxY)
+			{
+				//all the points of this tile are local
+				continue;
+			}
+			double dx = std::max(0.0, std::max(rect.minX - O.x, O.x - rect.maxX));
+			double dy = std::max(0.0, std::max(rect.minY - O.y, O.y - rect.maxY));
+			if (dx * dx + dy * dy > r2)
+				continue;
+
+			for (unsigned k = ctx.tileStart[t]; k < ctx.tileStart[t + 1]; ++k)
+			{
+				unsigned pointIndex = ctx.pointIndexes[k];
+				const CCVector3* P = ctx.cloud->getPoint(pointIndex);
+				double x = P->u[ctx.X];
+				double y = P->u[ctx.Y];
+				if (	(x >= region.minX && x <= region.maxX && y >= region.minY && y <= region.maxY)
+					||	pointIndex == vertIndexes[0] || pointIndex == vertIndexes[1] || pointIndex == vertIndexes[2])
+				{
+					continue;
+				}
+				if ((x - O.x) * (x - O.x) + (y - O.y) * (y - O.y) <= r2)
+				{
+					empty = false;
+					break;
+				}
+			}
+		}
+	}
+
+	if (!empty && conflictTiles)
+	{
+		//flag all the tiles that may contain points inside the circle
+		for (unsigned j = j0; j <= j1; ++j)
+		{
+			for (unsigned i = i0; i <= i1; ++i)
+			{
+				unsigned t = j * ctx.tileCountX + i;
+				if (!localTiles.empty() && localTiles[t])
+					continue;
+				TileRect rect = ctx.tileRect(i, j);
+				double dx = std::max(0.0, std::max(rect.minX - O.x, O.x - rect.maxX));
+				double dy = std::max(0.0, std::max(rect.minY - O.y, O.y - rect.maxY));
+				if (dx * dx + dy * dy <= r2)
+					(*conflictTiles)[t] = 1;
+			}
+		}
+	}
+
+	return empty;
+}
+
+//! Returns whether 4 points are (nearly) cocircular
+static bool AreCocircular(const CCVector2d& A, const CCVector2d& B, const CCVector2d& C, const CCVector2d& D)
+{
+	CCVector2d AD = A - D;
+	CCVector2d BD = B - D;
+	CCVector2d CD = C - D;
+
+	double det =	AD.norm2() * BD.cross(CD)
+				+	BD.norm2() * CD.cross(AD)
+				+	CD.norm2() * AD.cross(BD);
+
+	//tolerance (the input coordinates are rounded)
+	double L = std::max(std::max(AD.norm(), BD.norm()), CD.norm());
+	double M = std::max(std::max(std::abs(D.x), std::abs(D.y)), L);
+	double tol = (4.0 * std::numeric_limits<PointCoordinateType>::epsilon() * M + 1.0e-12 * L) * L * L * L;
+
+	return std::abs(det) <= tol;
+}
+
+//! Computes the adjacency of the triangles
+/** \param neighbors for each triangle edge, the index of the adjacent triangle (or -1)
+**/
+static void ComputeAdjacency(	const int* tri,
+								unsigned triCount,
+								std::vector<std::pair<uint64_t, unsigned> >& edges,
+								std::vector<int>& neighbors)
+{
+	edges.resize(static_cast<size_t>(triCount) * 3);
+	for (unsigned t = 0; t < triCount; ++t)
+	{
+		for (unsigned k = 0; k < 3; ++k)
+		{
+			uint64_t a = static_cast<uint64_t>(tri[3 * t + k]);
+			uint64_t b = static_cast<uint64_t>(tri[3 * t + (k + 1) % 3]);
+			edges[3 * t + k] = std::make_pair(a < b ? ((a << 32) | b) : ((b << 32) | a), 3 * t + k);
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+
+	neighbors.clear();
+	neighbors.resize(edges.size(), -1);
+	for (size_t e = 0; e + 1 < edges.size(); )
+	{
+		if (edges[e].first == edges[e + 1].first)
+		{
+			neighbors[edges[e].second] = static_cast<int>(edges[e + 1].second / 3);
+			neighbors[edges[e + 1].second] = static_cast<int>(edges[e].second / 3);
+			e += 2;
+		}
+		else
+		{
+			++e;
+		}
+	}
+}
+
+//! Chooses the diagonal of the cocircular quads the same way in all tiles
+/** The one that starts from the vertex with the smallest global index is kept.
+**/
+static void SetCanonicalDiagonals(	int* tri,
+									unsigned triCount,
+									const std::vector<int>& neighbors,
+									const std::vector<unsigned>& globalIndexes,
+									const std::vector<CCVector2d>& localPoints,
+									std::vector<char>& flags)
+{
+	flags.clear();
+	flags.resize(triCount, 0);
+	for (unsigned t = 0; t < triCount; ++t)
+	{
+		for (unsigned k = 0; k < 3 && !flags[t]; ++k)
+		{
+			int n = neighbors[3 * t + k];
+			if (n <= static_cast<int>(t) || flags[n])
+				continue;
+
+			int a = tri[3 * t + k];
+			int b = tri[3 * t + (k + 1) % 3];
+			int c = tri[3 * t + (k + 2) % 3];
+			int* nTri = tri + 3 * n;
+			int d = nTri[0];
+			if (d == a || d == b)
+				d = nTri[1];
+			if (d == a || d == b)
+				d = nTri[2];
+
+			unsigned minIndex = std::min(std::min(globalIndexes[a], globalIndexes[b]), std::min(globalIndexes[c], globalIndexes[d]));
+			if (minIndex == globalIndexes[a] || minIndex == globalIndexes[b])
+				continue;
+			if (!AreCocircular(localPoints[a], localPoints[b], localPoints[c], localPoints[d]))
+				continue;
+
+			//flip the diagonal
+			int* tTri = tri + 3 * t;
+			tTri[0] = a; tTri[1] = d; tTri[2] = c;
+			nTri[0] = d; nTri[1] = b; nTri[2] = c;
+			flags[t] = flags[n] = 1;
+		}
+	}
+}
+
+//! Returns the index of the tile in which the center of mass of a triangle falls
+/** The center of mass is computed the same way in all tiles.
+**/
+static unsigned OwnerTile(	const TiledDelaunayContext& ctx,
+							const int* tTri,
+							const std::vector<unsigned>& globalIndexes,
+							const std::vector<CCVector2d>& localPoints)
+{
+	unsigned v[3] = { globalIndexes[tTri[0]], globalIndexes[tTri[1]], globalIndexes[tTri[2]] };
+	int order[3] = { tTri[0], tTri[1], tTri[2] };
+	for (unsigned m = 0; m < 2; ++m)
+	{
+		for (unsigned l = 0; l + 1 < 3 - m; ++l)
+		{
+			if (v[l] > v[l + 1])
+			{
+				std::swap(v[l], v[l + 1]);
+				std::swap(order[l], order[l + 1]);
+			}
+		}
+	}
+	double Gx = ((localPoints[order[0]].x + localPoints[order[1]].x) + localPoints[order[2]].x) / 3;
+	double Gy = ((localPoints[order[0]].y + localPoints[order[1]].y) + localPoints[order[2]].y) / 3;
+
+	return ctx.tileCoordY(Gy) * ctx.tileCountX + ctx.tileCoordX(Gx);
+}
+
+//! Adds a triangle to the output (unless it has too long edges)
+static void AddTriangle(const TiledDelaunayContext& ctx,
+						const int* tTri,
+						const std::vector<unsigned>& globalIndexes,
+						std::vector<unsigned>& triangles)
+{
+	unsigned i1 = globalIndexes[tTri[0]];
+	unsigned i2 = globalIndexes[tTri[1]];
+	unsigned i3 = globalIndexes[tTri[2]];
+
+	//remove triangles with too long edges
+	if (ctx.squareMaxEdgeLength > 0)
+	{
+		const CCVector3* A = ctx.cloud->getPoint(i1);
+		const CCVector3* B = ctx.cloud->getPoint(i2);
+		const CCVector3* C = ctx.cloud->getPoint(i3);
+		if (	(*B - *A).norm2d() > ctx.squareMaxEdgeLength
+			||	(*C - *A).norm2d() > ctx.squareMaxEdgeLength
+			||	(*C - *B).norm2d() > ctx.squareMaxEdgeLength)
+		{
+			return;
+		}
+	}
+
+	triangles.push_back(i1);
+	triangles.push_back(i2);
+	triangles.push_back(i3);
+}
+
+//! Triangulates a tile
+/** The overlap band is enlarged until the local triangulation matches the
+	global one inside the tile. If it doesn't with the largest band (e.g. in
+	the concave parts of the cloud, where the triangles filling the convex
+	hull are huge), the tile is deferred (see TriangulateDeferredTiles).
+	\param ctx shared data
+	\param tileI tile index along X
+	\param tileJ tile index along Y
+	\param triangles output triangles (global indexes)
+	\param errorStr error message (if any)
+**/
+static TileStatus ProcessTile(	const TiledDelaunayContext& ctx,
+								unsigned tileI,
+								unsigned tileJ,
+								std::vector<unsigned>& triangles,
+								QString& errorStr)
+{
+	TileRect core = ctx.tileRect(tileI, tileJ);
+	if (!core.intersects(ctx.box.minX, ctx.box.minY, ctx.box.maxX, ctx.box.maxY) || !IntersectsHull(ctx, core))
+	{
+		//no triangle can fall in this tile
+		return TILE_OK;
+	}
+
+	//enlarged core (to test the triangles overlapping it)
+	TileRect testRect(core.minX - ctx.epsilon, core.minY - ctx.epsilon, core.maxX + ctx.epsilon, core.maxY + ctx.epsilon);
+	unsigned tileIndex = tileJ * ctx.tileCountX + tileI;
+
+	std::vector<CCVector2> points2D;
+	std::vector<CCVector2d> localPoints;
+	std::vector<unsigned> globalIndexes;
+	std::vector<int> neighbors;
+	std::vector<std::pair<uint64_t, unsigned> > edges;
+	std::vector<char> flags;
+	const std::vector<char> noLocalTiles;
+
+	try
+	{
+		for (double overlap = ctx.initialOverlap; ; overlap = (overlap > 0 ? std::min(2 * overlap, ctx.maxOverlap) : ctx.maxOverlap))
+		{
+			//region covered by the local points
+			TileRect region(core.minX - overlap, core.minY - overlap, core.maxX + overlap, core.maxY + overlap);
+			bool open[4] = {	region.minX <= ctx.box.minX,
+								region.maxX >= ctx.box.maxX,
+								region.minY <= ctx.box.minY,
+								region.maxY >= ctx.box.maxY };
+			//whether the region covers the whole cloud
+			bool global = (open[0] && open[1] && open[2] && open[3]);
+			//whether the overlap band can't be enlarged anymore
+			bool lastTry = (overlap >= ctx.maxOverlap);
+
+			//gather the local points
+			points2D.clear();
+			localPoints.clear();
+			globalIndexes.clear();
+			{
+				unsigned i0 = ctx.tileCoordX(region.minX);
+				unsigned i1 = ctx.tileCoordX(region.maxX);
+				unsigned j0 = ctx.tileCoordY(region.minY);
+				unsigned j1 = ctx.tileCoordY(region.maxY);
+				for (unsigned j = j0; j <= j1; ++j)
+				{
+					for (unsigned i = i0; i <= i1; ++i)
+					{
+						unsigned t = j * ctx.tileCountX + i;
+						for (unsigned k = ctx.tileStart[t]; k < ctx.tileStart[t + 1]; ++k)
+						{
+							unsigned pointIndex = ctx.pointIndexes[k];
+							const CCVector3* P = ctx.cloud->getPoint(pointIndex);
+							double x = P->u[ctx.X];
+							double y = P->u[ctx.Y];
+							if (x >= region.minX && x <= region.maxX && y >= region.minY && y <= region.maxY)
+							{
+								points2D.push_back(CCVector2(P->u[ctx.X], P->u[ctx.Y]));
+								localPoints.push_back(CCVector2d(x, y));
+								globalIndexes.push_back(pointIndex);
+							}
+						}
+					}
+				}
+			}
+
+			//add the global convex hull vertices (so that the local convex hull matches the global one)
+			if (!global)
+			{
+				for (size_t h = 0; h < ctx.hullIndexes.size(); ++h)
+				{
+					const CCVector2d& H = ctx.hull[h];
+					if (H.x < region.minX || H.x > region.maxX || H.y < region.minY || H.y > region.maxY)
+					{
+						unsigned pointIndex = ctx.hullIndexes[h];
+						const CCVector3* P = ctx.cloud->getPoint(pointIndex);
+						points2D.push_back(CCVector2(P->u[ctx.X], P->u[ctx.Y]));
+						localPoints.push_back(H);
+						globalIndexes.push_back(pointIndex);
+					}
+				}
+			}
+
+			if (points2D.size() < 3)
+			{
+				if (global)
+					return TILE_OK;
+				if (lastTry)
+					return TILE_DEFERRED;
+				continue;
+			}
+
+			//local triangulation
+			CCLib::Delaunay2dMesh dm;
+			char triLibErrorStr[1024];
+			if (!dm.buildMesh(points2D, 0, triLibErrorStr))
+			{
+				errorStr = QString(triLibErrorStr);
+				return TILE_TRIANGULATION_ERROR;
+			}
+			points2D.clear();
+
+			unsigned triCount = dm.size();
+			int* tri = dm.getTriangleVertIndexesArray();
+			if (triCount == 0)
+			{
+				//collinear points
+				if (global)
+					return TILE_OK;
+				if (lastTry)
+					return TILE_DEFERRED;
+				continue;
+			}
+
+			ComputeAdjacency(tri, triCount, edges, neighbors);
+
+			//check that the local triangulation matches the global one inside the tile
+			if (!global)
+			{
+				bool safe = true;
+				bool covered = false;
+
+				//flag the triangles overlapping the tile (and their neighbors)
+				flags.clear();
+				flags.resize(triCount, 0);
+				for (unsigned t = 0; t < triCount && safe; ++t)
+				{
+					const CCVector2d& A = localPoints[tri[3 * t]];
+					const CCVector2d& B = localPoints[tri[3 * t + 1]];
+					const CCVector2d& C = localPoints[tri[3 * t + 2]];
+					if (!testRect.intersects(	std::min(A.x, std::min(B.x, C.x)),
+												std::min(A.y, std::min(B.y, C.y)),
+												std::max(A.x, std::max(B.x, C.x)),
+												std::max(A.y, std::max(B.y, C.y))))
+					{
+						continue;
+					}
+
+					covered = true;
+					flags[t] = 1;
+					for (unsigned k = 0; k < 3; ++k)
+					{
+						int n = neighbors[3 * t + k];
+						if (n >= 0)
+						{
+							flags[n] = 1;
+						}
+						else
+						{
+							//the local convex hull must match the global one
+							const CCVector2d& P = localPoints[tri[3 * t + k]];
+							const CCVector2d& Q = localPoints[tri[3 * t + (k + 1) % 3]];
+							const CCVector2d& R = localPoints[tri[3 * t + (k + 2) % 3]];
+							if (!IsGlobalHullEdge(ctx, P, Q, R))
+							{
+								safe = false;
+								break;
+							}
+						}
+					}
+				}
+
+				//their circumcircle must be empty
+				for (unsigned t = 0; t < triCount && safe; ++t)
+				{
+					if (flags[t])
+					{
+						const CCVector2d& A = localPoints[tri[3 * t]];
+						const CCVector2d& B = localPoints[tri[3 * t + 1]];
+						const CCVector2d& C = localPoints[tri[3 * t + 2]];
+						if (!HasSafeCircumcircle(ctx, region, open, A, B, C))
+						{
+							//the circle exceeds the region: we check the points outside of it
+							unsigned vertIndexes[3] = { globalIndexes[tri[3 * t]], globalIndexes[tri[3 * t + 1]], globalIndexes[tri[3 * t + 2]] };
+							safe = HasEmptyCircumcircle(ctx, region, noLocalTiles, A, B, C, vertIndexes);
+						}
+					}
+				}
+
+				if (!safe || !covered)
+				{
+					if (lastTry)
+						return TILE_DEFERRED;
+					//we need a larger overlap band
+					continue;
+				}
+			}
+
+			SetCanonicalDiagonals(tri, triCount, neighbors, globalIndexes, localPoints, flags);
+
+			//keep the triangles whose center of mass falls inside this tile
+			for (unsigned t = 0; t < triCount; ++t)
+			{
+				const int* tTri = tri + 3 * t;
+				if (OwnerTile(ctx, tTri, globalIndexes, localPoints) == tileIndex)
+				{
+					AddTriangle(ctx, tTri, globalIndexes, triangles);
+				}
+			}
+
+			return TILE_OK;
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		triangles.clear();
+		return TILE_NOT_ENOUGH_MEMORY;
+	}
+
+	return TILE_OK;
+}
+
+//! Triangulates all the deferred tiles at once
+/** A single triangulation is shared by all the tiles that couldn't be processed
+	with the largest overlap band. It starts with the points of the deferred tiles
+	(and of their neighbors, up to the largest overlap band) and is enlarged with
+	the tiles that contain points inside the circumcircle of the triangles overlapping
+	the deferred tiles, until the triangulation matches the global one there.
+	\param ctx shared data
+	\param tileStatus status of each tile
+	\param tileTriangles output triangles of each tile (global indexes)
+	\param errorStr error message (if any)
+**/
+static TileStatus TriangulateDeferredTiles(	const TiledDelaunayContext& ctx,
+											const std::vector<int>& tileStatus,
+											std::vector< std::vector<unsigned> >& tileTriangles,
+											QString& errorStr)
+{
+	unsigned tileCount = ctx.tileCountX * ctx.tileCountY;
+
+	try
+	{
+		//tiles whose points are part of the triangulation
+		std::vector<char> localTiles(tileCount, 0);
+		for (unsigned t = 0; t < tileCount; ++t)
+		{
+			if (tileStatus[t] != TILE_DEFERRED)
+				continue;
+
+			TileRect core = ctx.tileRect(t % ctx.tileCountX, t / ctx.tileCountX);
+			unsigned i0 = ctx.tileCoordX(core.minX - ctx.maxOverlap);
+			unsigned i1 = ctx.tileCoordX(core.maxX + ctx.maxOverlap);
+			unsigned j0 = ctx.tileCoordY(core.minY - ctx.maxOverlap);
+			unsigned j1 = ctx.tileCoordY(core.maxY + ctx.maxOverlap);
+			for (unsigned j = j0; j <= j1; ++j)
+				for (unsigned i = i0; i <= i1; ++i)
+					localTiles[j * ctx.tileCountX + i] = 1;
+		}
+
+		//no region (the local points are defined by the local tiles only)
+		const TileRect noRegion(1, 1, 0, 0);
+
+		std::vector<CCVector2> points2D;
+		std::vector<CCVector2d> localPoints;
+		std::vector<unsigned> globalIndexes;
+		std::vector<int> neighbors;
+		std::vector<std::pair<uint64_t, unsigned> > edges;
+		std::vector<char> flags;
+		std::vector<char> conflictTiles;
+
+		while (true)
+		{
+			bool global = (std::find(localTiles.begin(), localTiles.end(), 0) == localTiles.end());
+
+			//gather the local points
+			points2D.clear();
+			localPoints.clear();
+			globalIndexes.clear();
+			for (unsigned t = 0; t < tileCount; ++t)
+			{
+				if (!localTiles[t])
+					continue;
+				for (unsigned k = ctx.tileStart[t]; k < ctx.tileStart[t + 1]; ++k)
+				{
+					unsigned pointIndex = ctx.pointIndexes[k];
+					const CCVector3* P = ctx.cloud->getPoint(pointIndex);
+					points2D.push_back(CCVector2(P->u[ctx.X], P->u[ctx.Y]));
+					localPoints.push_back(CCVector2d(P->u[ctx.X], P->u[ctx.Y]));
+					globalIndexes.push_back(pointIndex);
+				}
+			}
+			//and the global convex hull vertices
+			for (size_t h = 0; h < ctx.hullIndexes.size(); ++h)
+			{
+				const CCVector2d& H = ctx.hull[h];
+				if (!localTiles[ctx.tileCoordY(H.y) * ctx.tileCountX + ctx.tileCoordX(H.x)])
+				{
+					unsigned pointIndex = ctx.hullIndexes[h];
+					const CCVector3* P = ctx.cloud->getPoint(pointIndex);
+					points2D.push_back(CCVector2(P->u[ctx.X], P->u[ctx.Y]));
+					localPoints.push_back(H);
+					globalIndexes.push_back(pointIndex);
+				}
+			}
+
+			if (points2D.size() < 3)
+				return TILE_OK;
+
+			CCLib::Delaunay2dMesh dm;
+			char triLibErrorStr[1024];
+			if (!dm.buildMesh(points2D, 0, triLibErrorStr))
+			{
+				errorStr = QString(triLibErrorStr);
+				return TILE_TRIANGULATION_ERROR;
+			}
+			points2D.clear();
+
+			unsigned triCount = dm.size();
+			int* tri = dm.getTriangleVertIndexesArray();
+
+			ComputeAdjacency(tri, triCount, edges, neighbors);
+
+			//check that the triangulation matches the global one inside the deferred tiles
+			if (!global)
+			{
+				bool complete = true;
+
+				//flag the triangles overlapping the deferred tiles (and their neighbors)
+				flags.clear();
+				flags.resize(triCount, 0);
+				for (unsigned t = 0; t < triCount && complete; ++t)
+				{
+					const CCVector2d& A = localPoints[tri[3 * t]];
+					const CCVector2d& B = localPoints[tri[3 * t + 1]];
+					const CCVector2d& C = localPoints[tri[3 * t + 2]];
+					unsigned i0 = ctx.tileCoordX(std::min(A.x, std::min(B.x, C.x)) - ctx.epsilon);
+					unsigned i1 = ctx.tileCoordX(std::max(A.x, std::max(B.x, C.x)) + ctx.epsilon);
+					unsigned j0 = ctx.tileCoordY(std::min(A.y, std::min(B.y, C.y)) - ctx.epsilon);
+					unsigned j1 = ctx.tileCoordY(std::max(A.y, std::max(B.y, C.y)) + ctx.epsilon);
+					bool overlapsDeferredTile = false;
+					for (unsigned j = j0; j <= j1 && !overlapsDeferredTile; ++j)
+						for (unsigned i = i0; i <= i1 && !overlapsDeferredTile; ++i)
+							overlapsDeferredTile = (tileStatus[j * ctx.tileCountX + i] == TILE_DEFERRED);
+					if (!overlapsDeferredTile)
+						continue;
+
+					flags[t] = 1;
+					for (unsigned k = 0; k < 3; ++k)
+					{
+						int n = neighbors[3 * t + k];
+						if (n >= 0)
+						{
+							flags[n] = 1;
+						}
+						else if (!IsGlobalHullEdge(ctx, localPoints[tri[3 * t + k]], localPoints[tri[3 * t + (k + 1) % 3]], localPoints[tri[3 * t + (k + 2) % 3]]))
+						{
+							//shouldn't happen (the global convex hull vertices are part of the triangulation)
+							complete = false;
+							break;
+						}
+					}
+				}
+
+				if (!complete)
+				{
+					//we triangulate all the points
+					std::fill(localTiles.begin(), localTiles.end(), 1);
+					continue;
+				}
+
+				//their circumcircle must be empty (otherwise we add the tiles that may contain the missing points)
+				conflictTiles.clear();
+				conflictTiles.resize(tileCount, 0);
+				for (unsigned t = 0; t < triCount; ++t)
+				{
+					if (flags[t])
+					{
+						unsigned vertIndexes[3] = { globalIndexes[tri[3 * t]], globalIndexes[tri[3 * t + 1]], globalIndexes[tri[3 * t + 2]] };
+						if (!HasEmptyCircumcircle(ctx, noRegion, localTiles, localPoints[tri[3 * t]], localPoints[tri[3 * t + 1]], localPoints[tri[3 * t + 2]], vertIndexes, &conflictTiles))
+						{
+							complete = false;
+						}
+					}
+				}
+
+				if (!complete)
+				{
+					for (unsigned t = 0; t < tileCount; ++t)
+					{
+						if (conflictTiles[t])
+							localTiles[t] = 1;
+					}
+					continue;
+				}
+			}
+
+			SetCanonicalDiagonals(tri, triCount, neighbors, globalIndexes, localPoints, flags);
+
+			//dispatch the triangles whose center of mass falls inside a deferred tile
+			for (unsigned t = 0; t < triCount; ++t)
+			{
+				const int* tTri = tri + 3 * t;
+				unsigned tileIndex = OwnerTile(ctx, tTri, globalIndexes, localPoints);
+				if (tileStatus[tileIndex] == TILE_DEFERRED)
+				{
+					AddTriangle(ctx, tTri, globalIndexes, tileTriangles[tileIndex]);
+				}
+			}
+
+			return TILE_OK;
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		return TILE_NOT_ENOUGH_MEMORY;
+	}
+
+	return TILE_OK;
+}
+
+ccMesh* ccTiledDelaunay::Triangulate(	ccGenericPointCloud* cloud,
+										const Parameters& params,
+										bool updateNormals/*=false*/,
+										CCLib::GenericProgressCallback* progressCb/*=0*/,
+										QString* errorStr/*=0*/,
+										bool* canceled/*=0*/)
+{
+	if (canceled)
+		*canceled = false;
+
+	if (!cloud || params.dim > 2)
+	{
+		if (errorStr)
+			*errorStr = "Invalid input parameters";
+		return 0;
+	}
+
+	unsigned pointCount = cloud->size();
+	if (pointCount < 3)
+	{
+		if (errorStr)
+			*errorStr = "Not enough points";
+		return 0;
+	}
+
+	TiledDelaunayContext ctx;
+	ctx.cloud = cloud;
+	ctx.X = (params.dim == 2 ? 0 : params.dim + 1);
+	ctx.Y = (ctx.X == 2 ? 0 : ctx.X + 1);
+	ctx.squareMaxEdgeLength = static_cast<double>(params.maxEdgeLength) * params.maxEdgeLength;
+
+	//2D bounding-box
+	{
+		CCVector3 bbMin, bbMax;
+		cloud->getBoundingBox(bbMin, bbMax);
+		ctx.box = TileRect(bbMin.u[ctx.X], bbMin.u[ctx.Y], bbMax.u[ctx.X], bbMax.u[ctx.Y]);
+	}
+	double width = ctx.box.maxX - ctx.box.minX;
+	double height = ctx.box.maxY - ctx.box.minY;
+	{
+		double maxCoord = std::max(	std::max(std::abs(ctx.box.minX), std::abs(ctx.box.maxX)),
+									std::max(std::abs(ctx.box.minY), std::abs(ctx.box.maxY)));
+		ctx.epsilon = 1.0e-6 * std::max(maxCoord, std::max(width, height));
+	}
+
+	//tiles
+	unsigned targetTileCount = std::max(1u, pointCount / std::max(1u, params.pointsPerTile));
+	if (targetTileCount > 1 && width > 0 && height > 0)
+	{
+		double tileSize = std::sqrt(width * height / targetTileCount);
+		ctx.tileCountX = std::min(MAX_TILE_COUNT_PER_DIM, std::max(1u, static_cast<unsigned>(std::ceil(width / tileSize))));
+		ctx.tileCountY = std::min(MAX_TILE_COUNT_PER_DIM, std::max(1u, static_cast<unsigned>(std::ceil(height / tileSize))));
+	}
+	ctx.tileWidth = width / ctx.tileCountX;
+	ctx.tileHeight = height / ctx.tileCountY;
+	unsigned tileCount = ctx.tileCountX * ctx.tileCountY;
+
+	//initial overlap band width (a few times the average point spacing)
+	if (tileCount > 1)
+	{
+		double spacing = std::sqrt(width * height / pointCount);
+		//the band is enlarged up to the size of a tile (i.e. the local points cover 3 x 3 tiles at most)
+		ctx.maxOverlap = std::max(ctx.tileWidth, ctx.tileHeight);
+		ctx.initialOverlap = std::min(std::max(4.0 * spacing, 0.05 * ctx.maxOverlap), ctx.maxOverlap);
+	}
+
+	if (progressCb)
+	{
+		if (progressCb->textCanBeEdited())
+		{
+			progressCb->setMethodTitle("Triangulation");
+			progressCb->setInfo(qPrintable(QString("Points: %1\nTiles: %2 x %3").arg(pointCount).arg(ctx.tileCountX).arg(ctx.tileCountY)));
+		}
+		progressCb->update(0);
+		progressCb->start();
+	}
+
+	std::vector< std::vector<unsigned> > tileTriangles;
+	QString lastError;
+	bool success = true;
+
+	try
+	{
+		//sort the points by tile (counting sort)
+		{
+			std::vector<unsigned> pointTiles(pointCount);
+#if defined(_OPENMP)
+			#pragma omp parallel for
+#endif
+			for (int i = 0; i < static_cast<int>(pointCount); ++i)
+			{
+				const CCVector3* P = cloud->getPoint(static_cast<unsigned>(i));
+				pointTiles[i] = ctx.tileCoordY(P->u[ctx.Y]) * ctx.tileCountX + ctx.tileCoordX(P->u[ctx.X]);
+			}
+
+			ctx.tileStart.resize(tileCount + 1, 0);
+			for (unsigned i = 0; i < pointCount; ++i)
+				++ctx.tileStart[pointTiles[i] + 1];
+			for (unsigned t = 0; t < tileCount; ++t)
+				ctx.tileStart[t + 1] += ctx.tileStart[t];
+
+			ctx.pointIndexes.resize(pointCount);
+			std::vector<unsigned> fillPos(ctx.tileStart.begin(), ctx.tileStart.end() - 1);
+			for (unsigned i = 0; i < pointCount; ++i)
+				ctx.pointIndexes[fillPos[pointTiles[i]]++] = i;
+		}
+
+		//global convex hull (from the convex hull of each tile)
+		if (tileCount > 1)
+		{
+			std::vector< std::vector<CCLib::PointProjectionTools::IndexedCCVector2> > tileHulls(tileCount);
+			std::vector<int> tileHullStatus(tileCount, 1);
+
+#if defined(_OPENMP)
+			#pragma omp parallel for schedule(dynamic)
+#endif
+			for (int t = 0; t < static_cast<int>(tileCount); ++t)
+			{
+				try
+				{
+					std::vector<CCLib::PointProjectionTools::IndexedCCVector2> tilePoints;
+					tilePoints.reserve(ctx.tileStart[t + 1] - ctx.tileStart[t]);
+					for (unsigned k = ctx.tileStart[t]; k < ctx.tileStart[t + 1]; ++k)
+					{
+						const CCVector3* P = cloud->getPoint(ctx.pointIndexes[k]);
+						tilePoints.push_back(CCLib::PointProjectionTools::IndexedCCVector2(P->u[ctx.X], P->u[ctx.Y], ctx.pointIndexes[k]));
+					}
+
+					if (tilePoints.size() < 3)
+					{
+						tileHulls[t].assign(tilePoints.begin(), tilePoints.end());
+						continue;
+					}
+
+					std::list<CCLib::PointProjectionTools::IndexedCCVector2*> hullPoints;
+					if (!CCLib::PointProjectionTools::extractConvexHull2D(tilePoints, hullPoints))
+					{
+						tileHullStatus[t] = 0;
+						continue;
+					}
+					for (std::list<CCLib::PointProjectionTools::IndexedCCVector2*>::const_iterator it = hullPoints.begin(); it != hullPoints.end(); ++it)
+						tileHulls[t].push_back(**it);
+				}
+				catch (const std::bad_alloc&)
+				{
+					tileHullStatus[t] = 0;
+				}
+			}
+
+			std::vector<CCLib::PointProjectionTools::IndexedCCVector2> hullCandidates;
+			for (unsigned t = 0; t < tileCount; ++t)
+			{
+				if (!tileHullStatus[t])
+					throw std::bad_alloc();
+				for (size_t k = 0; k < tileHulls[t].size(); ++k)
+					hullCandidates.push_back(tileHulls[t][k]);
+				std::vector<CCLib::PointProjectionTools::IndexedCCVector2>().swap(tileHulls[t]);
+			}
+
+			std::list<CCLib::PointProjectionTools::IndexedCCVector2*> hullPoints;
+			if (!CCLib::PointProjectionTools::extractConvexHull2D(hullCandidates, hullPoints))
+				throw std::bad_alloc();
+			for (std::list<CCLib::PointProjectionTools::IndexedCCVector2*>::const_iterator it = hullPoints.begin(); it != hullPoints.end(); ++it)
+			{
+				ctx.hull.push_back(CCVector2d((*it)->x, (*it)->y));
+				ctx.hullIndexes.push_back((*it)->index);
+			}
+
+			if (ctx.hull.size() < 3)
+			{
+				//all the points are (nearly) collinear: we process them at once
+				ctx.tileCountX = ctx.tileCountY = 1;
+				ctx.tileWidth = width;
+				ctx.tileHeight = height;
+				tileCount = 1;
+				ctx.tileStart.resize(2);
+				ctx.tileStart[0] = 0;
+				ctx.tileStart[1] = pointCount;
+				for (unsigned i = 0; i < pointCount; ++i)
+					ctx.pointIndexes[i] = i;
+				ctx.initialOverlap = 0;
+				ctx.maxOverlap = 0;
+			}
+		}
+
+		//triangulate the tiles (by batches, so that the process can be cancelled)
+		tileTriangles.resize(tileCount);
+		std::vector<int> tileStatus(tileCount, TILE_OK);
+		std::vector<QString> tileErrors(tileCount);
+
+		unsigned deferredCount = 0;
+
+		CCLib::NormalizedProgress nProgress(progressCb, tileCount);
+		const int batchSize = std::max(1, QThread::idealThreadCount()) * 2;
+		for (unsigned firstTile = 0; firstTile < tileCount && success; firstTile += static_cast<unsigned>(batchSize))
+		{
+			int currentBatchSize = static_cast<int>(std::min(tileCount - firstTile, static_cast<unsigned>(batchSize)));
+
+#if defined(_OPENMP)
+			#pragma omp parallel for schedule(dynamic)
+#endif
+			for (int b = 0; b < currentBatchSize; ++b)
+			{
+				unsigned t = firstTile + static_cast<unsigned>(b);
+				tileStatus[t] = ProcessTile(ctx, t % ctx.tileCountX, t / ctx.tileCountX, tileTriangles[t], tileErrors[t]);
+			}
+
+			for (int b = 0; b < currentBatchSize; ++b)
+			{
+				unsigned t = firstTile + static_cast<unsigned>(b);
+				if (tileStatus[t] == TILE_NOT_ENOUGH_MEMORY)
+				{
+					throw std::bad_alloc();
+				}
+				else if (tileStatus[t] == TILE_DEFERRED)
+				{
+					++deferredCount;
+				}
+				else if (tileStatus[t] != TILE_OK)
+				{
+					lastError = tileErrors[t];
+					success = false;
+					break;
+				}
+			}
+
+			if (success && progressCb && !nProgress.steps(static_cast<unsigned>(currentBatchSize)))
+			{
+				lastError = "Process cancelled by user";
+				success = false;
+				if (canceled)
+					*canceled = true;
+			}
+		}
+
+		//the tiles that would need a too large overlap band share a single triangulation
+		if (success && deferredCount != 0)
+		{
+			ccLog::Print(QString("[ccTiledDelaunay] %1 tile(s) can't be triangulated locally (concave footprint?): they will be triangulated together").arg(deferredCount));
+			if (progressCb && progressCb->textCanBeEdited())
+			{
+				progressCb->setInfo(qPrintable(QString("Points: %1\nTiles: %2 x %3\nDeferred tiles: %4").arg(pointCount).arg(ctx.tileCountX).arg(ctx.tileCountY).arg(deferredCount)));
+			}
+
+			QString error;
+			TileStatus status = TriangulateDeferredTiles(ctx, tileStatus, tileTriangles, error);
+			if (status == TILE_NOT_ENOUGH_MEMORY)
+			{
+				throw std::bad_alloc();
+			}
+			else if (status != TILE_OK)
+			{
+				lastError = error;
+				success = false;
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		lastError = "Not enough memory";
+		success = false;
+	}
+
+	if (progressCb)
+	{
+		progressCb->stop();
+	}
+
+	//merge the tiles triangles (in order)
+	ccMesh* mesh = 0;
+	if (success)
+	{
+		size_t triCount = 0;
+		for (size_t t = 0; t < tileTriangles.size(); ++t)
+			triCount += tileTriangles[t].size() / 3;
+
+		if (triCount == 0)
+		{
+			lastError = (params.maxEdgeLength > 0 ? "No triangle left after pruning" : "No triangle");
+		}
+		else
+		{
+			mesh = new ccMesh(cloud);
+			if (triCount > std::numeric_limits<unsigned>::max() || !mesh->reserve(static_cast<unsigned>(triCount)))
+			{
+				lastError = "Not enough memory";
+				delete mesh;
+				mesh = 0;
+			}
+			else
+			{
+				for (size_t t = 0; t < tileTriangles.size(); ++t)
+				{
+					const std::vector<unsigned>& triangles = tileTriangles[t];
+					for (size_t k = 0; k < triangles.size(); k += 3)
+						mesh->addTriangle(triangles[k], triangles[k + 1], triangles[k + 2]);
+					std::vector<unsigned>().swap(tileTriangles[t]);
+				}
+			}
+		}
+	}
+
+	if (!mesh)
+	{
+		if (errorStr)
+			*errorStr = lastError;
+		return 0;
+	}
+
+	mesh->setName(cloud->getName() + QString(".mesh"));
+	mesh->setDisplay(cloud->getDisplay());
+	bool cloudHadNormals = cloud->hasNormals();
+	//compute per-vertex normals if necessary
+	if (!cloudHadNormals || updateNormals)
+	{
+		mesh->computeNormals(true);
+	}
+	mesh->showNormals(cloudHadNormals || !cloud->hasColors());
+
+	return mesh;
+}
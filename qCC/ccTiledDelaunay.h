@@ -0,0 +1,85 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_TILED_DELAUNAY_HEADER
+#define CC_TILED_DELAUNAY_HEADER
+
+//CCLib
+#include <CCGeom.h>
+#include <GenericProgressCallback.h>
+
+//Qt
+#include <QString>
+
+class ccGenericPointCloud;
+class ccMesh;
+
+//! Tiled 2.5D Delaunay triangulation (for big clouds)
+/** The points are projected on an axis-aligned plane and sorted in tiles.
+	Each tile is triangulated (in parallel) with the points of an overlap band
+	around it. A tile only keeps the triangles whose center of mass falls
+	inside it, and only once it has checked that its local triangulation
+	matches the global one: the triangles overlapping the tile must have an
+	empty circumcircle (i.e. a circumcircle inside the tile and its overlap band)
+	and the local convex hull must match the global convex hull. Otherwise the
+	overlap band is enlarged (up to the size of a tile) and the tile is
+	triangulated again. The tiles that still don't match (e.g. in the concave
+	parts of the cloud) share a single triangulation, enlarged only where
+	needed. The diagonal
+	of the quads with 4 cocircular vertices (e.g. regular grids) is chosen the
+	same way by all the tiles. The tiles are eventually merged in a fixed order.
+**/
+class ccTiledDelaunay
+{
+public:
+
+	//! Triangulation parameters
+	struct Parameters
+	{
+		//! Default constructor
+		Parameters()
+			: dim(2)
+			, maxEdgeLength(0)
+			, pointsPerTile(1 << 19)
+		{}
+
+		//! Projection dimension (0 = X, 1 = Y, 2 = Z)
+		unsigned char dim;
+		//! Max edge length for output triangles (0 = ignored)
+		PointCoordinateType maxEdgeLength;
+		//! Average number of points per tile (without the overlap band)
+		unsigned pointsPerTile;
+	};
+
+	//! Triangulates a cloud
+	/** \param cloud input cloud (the mesh vertices)
+		\param params triangulation parameters
+		\param updateNormals whether to compute the mesh normals even if the cloud already has normals
+		\param progressCb optional progress callback
+		\param errorStr error message (if any) [optional]
+		\param canceled whether the process has been cancelled by the user [optional]
+		\return the resulting mesh (or 0 if an error occurred or if the process has been cancelled)
+	**/
+	static ccMesh* Triangulate(	ccGenericPointCloud* cloud,
+								const Parameters& params,
+								bool updateNormals = false,
+								CCLib::GenericProgressCallback* progressCb = 0,
+								QString* errorStr = 0,
+								bool* canceled = 0);
+};
+
+#endif //CC_TILED_DELAUNAY_HEADER
@@ -0,0 +1,1080 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#include "ccTiledRasterExport.h"
+
+//CCLib
+#include <ReferenceCloud.h>
+
+//qCC_db
+#include <ccGenericPointCloud.h>
+#include <ccLog.h>
+#include <ccPointCloud.h>
+#include <ccProgressDialog.h>
+
+//qCC_io
+#include <ccPointStream.h>
+
+//Qt
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QThread>
+
+#ifdef CC_GDAL_SUPPORT
+//GDAL
+#include <gdal.h>
+#include <gdal_priv.h>
+#include <cpl_string.h>
+#endif
+
+//System
+#include <assert.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#ifdef CC_GDAL_SUPPORT
+
+//! Rasterized tile (ready to be written)
+struct RasterTile
+{
+	RasterTile()
+		: i0(0)
+		, j0(0)
+		, width(0)
+		, height(0)
+		, error(false)
+	{}
+
+	//! First column of the tile (in the whole grid)
+	unsigned i0;
+	//! First row of the tile (in the whole grid)
+	unsigned j0;
+	//! Tile width (without the halo)
+	unsigned width;
+	//! Tile height (without the halo)
+	unsigned height;
+	//! Bands data (north-up, row by row)
+	std::vector< std::vector<double> > bands;
+	//! Whether an error occurred
+	bool error;
+};
+
+//! Band layout of the output raster
+struct RasterBandLayout
+{
+	RasterBandLayout()
+		: rgb(false)
+		, alpha(false)
+		, heights(false)
+		, density(false)
+		, sfCount(0)
+	{}
+
+	//! Returns the total number of bands
+	int count() const { return (rgb ? 3 : 0) + (alpha ? 1 : 0) + (heights ? 1 : 0) + (density ? 1 : 0) + static_cast<int>(sfCount); }
+	//! Returns whether the raster only has RGB(A) bands
+	bool onlyRGBA() const { return (rgb && !heights && !density && sfCount == 0); }
+
+	bool rgb;
+	bool alpha;
+	bool heights;
+	bool density;
+	unsigned sfCount;
+};
+
+//! Allocates the output bands of a tile
+static bool AllocateTileBands(const RasterBandLayout& layout, RasterTile& tile)
+{
+	const size_t cellCount = static_cast<size_t>(tile.width) * tile.height;
+
+	try
+	{
+		tile.bands.resize(layout.count());
+		for (std::vector<double>& band : tile.bands)
+		{
+			band.resize(cellCount, 0);
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		tile.error = true;
+		return false;
+	}
+
+	return true;
+}
+
+//! Copies the (core) cells of a tile in its output bands
+/** \param grid grid covering the tile (or 0 if the tile has no point)
+	\param ei0 first column of the grid (in the whole raster)
+	\param ej0 first row of the grid (in the whole raster)
+	\param layout bands layout
+	\param noDataHeight height of the empty cells
+	\param tile output tile
+**/
+static void CopyTileCells(	const ccRasterGrid* grid,
+							unsigned ei0,
+							unsigned ej0,
+							const RasterBandLayout& layout,
+							double noDataHeight,
+							RasterTile& tile)
+{
+	for (unsigned r = 0; r < tile.height; ++r)
+	{
+		unsigned j = tile.j0 + tile.height - 1 - r; //the first row is the northest one (i.e. Ymax)
+		const ccRasterGrid::Row* row = grid ? &grid->rows[j - ej0] : 0;
+		for (unsigned c = 0; c < tile.width; ++c)
+		{
+			size_t pos = static_cast<size_t>(r) * tile.width + c;
+			unsigned i = tile.i0 + c;
+			const ccRasterCell* cell = row ? &(*row)[i - ei0] : 0;
+			bool validCell = (cell && std::isfinite(cell->h));
+
+			size_t bandIndex = 0;
+			if (layout.rgb)
+			{
+				for (unsigned k = 0; k < 3; ++k)
+				{
+					tile.bands[bandIndex++][pos] = (validCell ? std::max(0.0, std::min(255.0, cell->color.u[k])) : 0);
+				}
+			}
+			if (layout.alpha)
+			{
+				tile.bands[bandIndex++][pos] = (validCell ? 255 : 0);
+			}
+			if (layout.heights)
+			{
+				tile.bands[bandIndex++][pos] = (validCell ? cell->h : noDataHeight);
+			}
+			if (layout.density)
+			{
+				tile.bands[bandIndex++][pos] = (cell ? cell->nbPoints : 0);
+			}
+			for (unsigned k = 0; k < layout.sfCount; ++k)
+			{
+				double sfValue = std::numeric_limits<ccRasterGrid::SF::value_type>::quiet_NaN();
+				if (cell && cell->nbPoints && k < grid->scalarFields.size())
+				{
+					sfValue = grid->scalarFields[k][static_cast<size_t>(j - ej0) * grid->width + (i - ei0)];
+				}
+				tile.bands[bandIndex++][pos] = sfValue;
+			}
+			assert(bandIndex == tile.bands.size());
+		}
+	}
+}
+
+static void ComputeTile(ccGenericPointCloud* cloud,
+						const ccTiledRasterExport::Parameters& params,
+						const RasterBandLayout& layout,
+						const CCVector3d& gridMinCorner,
+						unsigned gridWidth,
+						unsigned gridHeight,
+						const unsigned* tilePointIndexes,
+						unsigned tilePointCount,
+						double noDataHeight,
+						RasterTile& tile)
+{
+	const unsigned char Z = params.Z;
+	const unsigned char X = Z == 2 ? 0 : Z + 1;
+	const unsigned char Y = X == 2 ? 0 : X + 1;
+
+	const unsigned halo = (params.emptyCellsStrategy == ccRasterGrid::INTERPOLATE ? std::min(params.haloSize, params.tileSize) : 0);
+
+	//extended tile (with its halo)
+	unsigned ei0 = tile.i0 > halo ? tile.i0 - halo : 0;
+	unsigned ej0 = tile.j0 > halo ? tile.j0 - halo : 0;
+	unsigned ei1 = std::min(tile.i0 + tile.width + halo, gridWidth);
+	unsigned ej1 = std::min(tile.j0 + tile.height + halo, gridHeight);
+
+	if (!AllocateTileBands(layout, tile))
+	{
+		return;
+	}
+
+	ccRasterGrid grid;
+	bool hasPoints = false;
+	if (tilePointCount != 0)
+	{
+		//extract the tile points
+		ccPointCloud* tileCloud = 0;
+		{
+			CCLib::ReferenceCloud refCloud(cloud);
+			if (!refCloud.reserve(tilePointCount))
+			{
+				tile.error = true;
+				return;
+			}
+			for (unsigned k = 0; k < tilePointCount; ++k)
+			{
+				refCloud.addPointIndex(tilePointIndexes[k]);
+			}
+
+			tileCloud = cloud->isA(CC_TYPES::POINT_CLOUD) ? static_cast<ccPointCloud*>(cloud)->partialClone(&refCloud) : ccPointCloud::From(&refCloud, cloud);
+			if (!tileCloud)
+			{
+				tile.error = true;
+				return;
+			}
+		}
+
+		CCVector3d tileMinCorner = gridMinCorner;
+		tileMinCorner.u[X] += ei0 * params.gridStep;
+		tileMinCorner.u[Y] += ej0 * params.gridStep;
+
+		grid.projectionPercentile = params.percentile;
+		if (	!grid.init(ei1 - ei0, ej1 - ej0, params.gridStep, tileMinCorner)
+			||	!grid.fillWith(	tileCloud,
+								Z,
+								params.projectionType,
+								params.emptyCellsStrategy == ccRasterGrid::INTERPOLATE,
+								layout.sfCount != 0 ? params.sfInterpolation : ccRasterGrid::INVALID_PROJECTION_TYPE))
+		{
+			tile.error = true;
+		}
+
+		delete tileCloud;
+		tileCloud = 0;
+
+		if (tile.error)
+		{
+			return;
+		}
+
+		hasPoints = true;
+	}
+
+	//copy the (core) cells in the output bands
+	CopyTileCells(hasPoints ? &grid : 0, ei0, ej0, layout, noDataHeight, tile);
+}
+
+//! Checks the export parameters
+static bool CheckParameters(const ccTiledRasterExport::Parameters& params)
+{
+	if (params.Z > 2 || params.gridStep <= 0)
+	{
+		assert(false);
+		return false;
+	}
+
+	if (	params.emptyCellsStrategy != ccRasterGrid::LEAVE_EMPTY
+		&&	params.emptyCellsStrategy != ccRasterGrid::FILL_CUSTOM_HEIGHT
+		&&	params.emptyCellsStrategy != ccRasterGrid::INTERPOLATE)
+	{
+		//the min/max/average heights of the whole grid are not known in advance
+		ccLog::Error("[Tiled raster] Only the 'leave empty', 'custom height' and 'interpolate' strategies are supported for empty cells");
+		return false;
+	}
+
+	if (params.tileSize < 16 || (params.tileSize % 16) != 0)
+	{
+		ccLog::Error("[Tiled raster] The tile size must be a multiple of 16");
+		return false;
+	}
+
+	return true;
+}
+
+//! Creates the output (tiled) GeoTIFF file
+static GDALDataset* CreateRaster(	const QString& outputFilename,
+									const ccTiledRasterExport::Parameters& params,
+									const RasterBandLayout& layout,
+									const ccBBox& box,
+									unsigned gridWidth,
+									unsigned gridHeight,
+									const CCVector3d& globalShift,
+									double globalScale,
+									double noDataHeight)
+{
+	const unsigned char X = params.Z == 2 ? 0 : params.Z + 1;
+	const unsigned char Y = X == 2 ? 0 : X + 1;
+
+	GDALAllRegister();
+	const char *pszFormat = "GTiff";
+	GDALDriver *poDriver = GetGDALDriverManager()->GetDriverByName(pszFormat);
+	if (!poDriver)
+	{
+		ccLog::Error("[GDAL] Driver %s is not supported", pszFormat);
+		return 0;
+	}
+
+	QByteArray blockSizeStr = QByteArray::number(params.tileSize);
+	char **papszOptions = NULL;
+	papszOptions = CSLSetNameValue(papszOptions, "TILED", "YES");
+	papszOptions = CSLSetNameValue(papszOptions, "BLOCKXSIZE", blockSizeStr.constData());
+	papszOptions = CSLSetNameValue(papszOptions, "BLOCKYSIZE", blockSizeStr.constData());
+	papszOptions = CSLSetNameValue(papszOptions, "BIGTIFF", "IF_SAFER");
+
+	GDALDataset* poDstDS = poDriver->Create(qPrintable(outputFilename),
+											static_cast<int>(gridWidth),
+											static_cast<int>(gridHeight),
+											layout.count(),
+											layout.onlyRGBA() ? GDT_Byte : GDT_Float64,
+											papszOptions);
+	CSLDestroy(papszOptions);
+
+	if (!poDstDS)
+	{
+		ccLog::Error("[GDAL] Failed to create output raster");
+		return 0;
+	}
+
+	//geo-referencing (same convention as the Rasterize tool)
+	{
+		double shiftX = box.minCorner().u[X];
+		double shiftY = box.maxCorner().u[Y];
+		double stepX = params.gridStep;
+		double stepY = params.gridStep;
+
+		shiftX -= globalShift.u[X];
+		shiftY -= globalShift.u[Y];
+
+		assert(globalScale != 0);
+		stepX /= globalScale;
+		stepY /= globalScale;
+
+		poDstDS->SetMetadataItem("AREA_OR_POINT", "AREA");
+
+		double adfGeoTransform[6] = { shiftX, stepX, 0, shiftY, 0, -stepY };
+		poDstDS->SetGeoTransform(adfGeoTransform);
+	}
+
+	//bands properties
+	{
+		int bandIndex = 0;
+		if (layout.rgb)
+		{
+			poDstDS->GetRasterBand(++bandIndex)->SetColorInterpretation(GCI_RedBand);
+			poDstDS->GetRasterBand(++bandIndex)->SetColorInterpretation(GCI_GreenBand);
+			poDstDS->GetRasterBand(++bandIndex)->SetColorInterpretation(GCI_BlueBand);
+		}
+		if (layout.alpha)
+		{
+			poDstDS->GetRasterBand(++bandIndex)->SetColorInterpretation(GCI_AlphaBand);
+		}
+		if (layout.heights)
+		{
+			GDALRasterBand* poBand = poDstDS->GetRasterBand(++bandIndex);
+			poBand->SetColorInterpretation(GCI_Undefined);
+			if (params.emptyCellsStrategy == ccRasterGrid::LEAVE_EMPTY)
+			{
+				poBand->SetNoDataValue(noDataHeight); //should be transparent!
+			}
+		}
+		if (layout.density)
+		{
+			poDstDS->GetRasterBand(++bandIndex)->SetColorInterpretation(GCI_Undefined);
+		}
+		for (unsigned k = 0; k < layout.sfCount; ++k)
+		{
+			GDALRasterBand* poBand = poDstDS->GetRasterBand(++bandIndex);
+			poBand->SetColorInterpretation(GCI_Undefined);
+			poBand->SetNoDataValue(std::numeric_limits<ccRasterGrid::SF::value_type>::quiet_NaN());
+		}
+	}
+
+	return poDstDS;
+}
+
+//! Writes a tile in the output raster (and releases its bands)
+static bool WriteTile(GDALDataset* poDstDS, unsigned gridHeight, RasterTile& tile)
+{
+	bool success = true;
+
+	//the first raster row is the northest one
+	int yOff = static_cast<int>(gridHeight - tile.j0 - tile.height);
+	for (size_t b = 0; b < tile.bands.size(); ++b)
+	{
+		GDALRasterBand* poBand = poDstDS->GetRasterBand(static_cast<int>(b) + 1);
+		if (poBand->RasterIO(	GF_Write,
+								static_cast<int>(tile.i0),
+								yOff,
+								static_cast<int>(tile.width),
+								static_cast<int>(tile.height),
+								tile.bands[b].data(),
+								static_cast<int>(tile.width),
+								static_cast<int>(tile.height),
+								GDT_Float64, 0, 0) != CE_None)
+		{
+			ccLog::Error("[GDAL] An error occurred while writing a tile!");
+			success = false;
+			break;
+		}
+	}
+
+	//release the memory as soon as possible
+	std::vector< std::vector<double> >().swap(tile.bands);
+
+	return success;
+}
+
+//! Builds the overviews (image pyramid) of the output raster
+static void BuildOverviews(	GDALDataset* poDstDS,
+							const RasterBandLayout& layout,
+							unsigned gridWidth,
+							unsigned gridHeight,
+							unsigned tileSize,
+							ccProgressDialog* progressDialog)
+{
+	std::vector<int> overviewLevels;
+	for (unsigned level = 2; gridWidth / level >= tileSize / 2 || gridHeight / level >= tileSize / 2; level *= 2)
+	{
+		overviewLevels.push_back(static_cast<int>(level));
+	}
+
+	if (overviewLevels.empty())
+	{
+		return;
+	}
+
+	if (progressDialog)
+	{
+		progressDialog->setInfo(QObject::tr("Building overviews"));
+		QCoreApplication::processEvents();
+	}
+
+	if (poDstDS->BuildOverviews(layout.onlyRGBA() ? "AVERAGE" : "NEAREST",
+								static_cast<int>(overviewLevels.size()),
+								&overviewLevels.front(),
+								0, NULL, NULL, NULL) != CE_None)
+	{
+		ccLog::Warning("[GDAL] Failed to build the overviews");
+	}
+}
+
+#endif
+
+bool ccTiledRasterExport::Export(	ccGenericPointCloud* cloud,
+									const Parameters& params,
+									const QString& outputFilename,
+									ccProgressDialog* progressDialog/*=0*/)
+{
+#ifdef CC_GDAL_SUPPORT
+
+	if (!cloud)
+	{
+		assert(false);
+		return false;
+	}
+
+	if (!CheckParameters(params))
+	{
+		return false;
+	}
+
+	const unsigned char Z = params.Z;
+	const unsigned char X = Z == 2 ? 0 : Z + 1;
+	const unsigned char Y = X == 2 ? 0 : X + 1;
+
+	ccBBox box = params.box.isValid() ? params.box : cloud->getOwnBB();
+	unsigned gridWidth = 0, gridHeight = 0;
+	if (!ccRasterGrid::ComputeGridSize(Z, box, params.gridStep, gridWidth, gridHeight))
+	{
+		return false;
+	}
+	CCVector3d gridMinCorner = CCVector3d::fromArray(box.minCorner().u);
+
+	//bands
+	RasterBandLayout layout;
+	layout.rgb = (params.exportRGB && cloud->hasColors());
+	layout.alpha = (layout.rgb && params.emptyCellsStrategy == ccRasterGrid::LEAVE_EMPTY);
+	layout.heights = params.exportHeights;
+	layout.density = params.exportDensity;
+	if (params.exportSFs && params.sfInterpolation != ccRasterGrid::INVALID_PROJECTION_TYPE && cloud->isA(CC_TYPES::POINT_CLOUD))
+	{
+		layout.sfCount = static_cast<ccPointCloud*>(cloud)->getNumberOfScalarFields();
+	}
+	if (layout.count() == 0)
+	{
+		ccLog::Error("Can't output a raster with no band! (check export parameters)");
+		return false;
+	}
+
+	//empty cells height
+	double noDataHeight = params.customHeight;
+	if (params.emptyCellsStrategy == ccRasterGrid::LEAVE_EMPTY)
+	{
+		noDataHeight = box.minCorner().u[Z] - 1.0;
+	}
+
+	//tiles
+	const unsigned tileSize = params.tileSize;
+	const unsigned halo = (params.emptyCellsStrategy == ccRasterGrid::INTERPOLATE ? std::min(params.haloSize, tileSize) : 0);
+	const unsigned tileCountX = (gridWidth + tileSize - 1) / tileSize;
+	const unsigned tileCountY = (gridHeight + tileSize - 1) / tileSize;
+	const size_t tileCount = static_cast<size_t>(tileCountX) * tileCountY;
+
+	//create the output raster
+	GDALDataset* poDstDS = CreateRaster(outputFilename,
+										params,
+										layout,
+										box,
+										gridWidth,
+										gridHeight,
+										cloud->getGlobalShift(),
+										cloud->getGlobalScale(),
+										noDataHeight);
+	if (!poDstDS)
+	{
+		return false;
+	}
+
+	if (progressDialog)
+	{
+		progressDialog->setMethodTitle(QObject::tr("Tiled raster export"));
+		progressDialog->setInfo(QObject::tr("Cells: %1 x %2\nTiles: %3 x %4").arg(gridWidth).arg(gridHeight).arg(tileCountX).arg(tileCountY));
+		progressDialog->start();
+		progressDialog->show();
+		QCoreApplication::processEvents();
+	}
+
+	//dispatch the points in the tiles (counting sort, a point may belong to several tiles because of the halo)
+	//(with an extra margin of one cell as the tiles cell positions are computed from a different origin)
+	const int dispatchMargin = static_cast<int>(halo) + 1;
+	std::vector<unsigned> tilePointIndexes;
+	std::vector<size_t> tileStarts;
+	{
+		const unsigned pointCount = cloud->size();
+		const int sliceCount = std::max(1, QThread::idealThreadCount()) * 4;
+
+		std::vector<size_t> slicePopulations;
+		try
+		{
+			slicePopulations.resize(static_cast<size_t>(sliceCount) * tileCount, 0);
+			tileStarts.resize(tileCount + 1, 0);
+		}
+		catch (const std::bad_alloc&)
+		{
+			ccLog::Error("Not enough memory");
+			GDALClose((GDALDatasetH)poDstDS);
+			return false;
+		}
+
+		ccRasterGrid dummyGrid;
+		dummyGrid.gridStep = params.gridStep;
+		dummyGrid.minCorner = gridMinCorner;
+
+		for (int pass = 0; pass < 2; ++pass)
+		{
+#if defined(_OPENMP)
+			#pragma omp parallel for
+#endif
+			for (int s = 0; s < sliceCount; ++s)
+			{
+				size_t* sliceTilePopulations = &slicePopulations[static_cast<size_t>(s) * tileCount];
+				unsigned sliceStart = static_cast<unsigned>((static_cast<uint64_t>(pointCount) * s) / sliceCount);
+				unsigned sliceStop = static_cast<unsigned>((static_cast<uint64_t>(pointCount) * (s + 1)) / sliceCount);
+				for (unsigned n = sliceStart; n < sliceStop; ++n)
+				{
+					std::pair<int, int> cellPos = dummyGrid.computeCellPos(*cloud->getPoint(n), X, Y);
+					int i = cellPos.first;
+					int j = cellPos.second;
+					if (	i < 0 || i >= static_cast<int>(gridWidth)
+						||	j < 0 || j >= static_cast<int>(gridHeight))
+					{
+						//we skip points that fall outside of the grid!
+						continue;
+					}
+
+					//tiles that contain this cell (including their halo)
+					int tx0 = std::max(0, i - dispatchMargin) / static_cast<int>(tileSize);
+					int tx1 = std::min(static_cast<int>(gridWidth) - 1, i + dispatchMargin) / static_cast<int>(tileSize);
+					int ty0 = std::max(0, j - dispatchMargin) / static_cast<int>(tileSize);
+					int ty1 = std::min(static_cast<int>(gridHeight) - 1, j + dispatchMargin) / static_cast<int>(tileSize);
+					for (int ty = ty0; ty <= ty1; ++ty)
+					{
+						for (int tx = tx0; tx <= tx1; ++tx)
+						{
+							size_t tileIndex = static_cast<size_t>(ty) * tileCountX + tx;
+							if (pass == 0)
+							{
+								++sliceTilePopulations[tileIndex];
+							}
+							else
+							{
+								tilePointIndexes[sliceTilePopulations[tileIndex]++] = n;
+							}
+						}
+					}
+				}
+			}
+
+			if (pass == 0)
+			{
+				//compute the start position of each (tile, slice) pair
+				size_t position = 0;
+				for (size_t t = 0; t < tileCount; ++t)
+				{
+					tileStarts[t] = position;
+					for (int s = 0; s < sliceCount; ++s)
+					{
+						size_t& population = slicePopulations[static_cast<size_t>(s) * tileCount + t];
+						size_t sliceTileCount = population;
+						population = position;
+						position += sliceTileCount;
+					}
+				}
+				tileStarts[tileCount] = position;
+
+				try
+				{
+					tilePointIndexes.resize(position);
+				}
+				catch (const std::bad_alloc&)
+				{
+					ccLog::Error("Not enough memory to dispatch the points in the tiles");
+					GDALClose((GDALDatasetH)poDstDS);
+					return false;
+				}
+			}
+		}
+	}
+
+	//process the tiles by batches (to bound the memory consumption)
+	const int batchSize = (params.maxThreadCount > 0 ? params.maxThreadCount : std::max(1, QThread::idealThreadCount()));
+	CCLib::NormalizedProgress nProgress(progressDialog, static_cast<unsigned>(tileCount));
+	bool error = false;
+
+	std::vector<RasterTile> tiles;
+	for (size_t batchStart = 0; batchStart < tileCount && !error; batchStart += static_cast<size_t>(batchSize))
+	{
+		int currentBatchSize = static_cast<int>(std::min(tileCount - batchStart, static_cast<size_t>(batchSize)));
+		tiles.clear();
+		tiles.resize(currentBatchSize);
+
+#if defined(_OPENMP)
+		#pragma omp parallel for schedule(dynamic) num_threads(batchSize)
+#endif
+		for (int bi = 0; bi < currentBatchSize; ++bi)
+		{
+			size_t tileIndex = batchStart + bi;
+			RasterTile& tile = tiles[bi];
+			tile.i0 = static_cast<unsigned>(tileIndex % tileCountX) * tileSize;
+			tile.j0 = static_cast<unsigned>(tileIndex / tileCountX) * tileSize;
+			tile.width = std::min(tileSize, gridWidth - tile.i0);
+			tile.height = std::min(tileSize, gridHeight - tile.j0);
+
+			try
+			{
+				ComputeTile(cloud,
+							params,
+							layout,
+							gridMinCorner,
+							gridWidth,
+							gridHeight,
+							tilePointIndexes.data() + tileStarts[tileIndex],
+							static_cast<unsigned>(tileStarts[tileIndex + 1] - tileStarts[tileIndex]),
+							noDataHeight,
+							tile);
+			}
+			catch (const std::bad_alloc&)
+			{
+				//exceptions can't cross the parallel region boundary
+				tile.error = true;
+			}
+		}
+
+		//write the tiles (GDAL datasets can't be written concurrently)
+		for (RasterTile& tile : tiles)
+		{
+			if (tile.error)
+			{
+				ccLog::Error(QString("[Tiled raster] Failed to compute the tile at (%1 ; %2) (not enough memory?)").arg(tile.i0).arg(tile.j0));
+				error = true;
+				break;
+			}
+
+			if (!WriteTile(poDstDS, gridHeight, tile))
+			{
+				error = true;
+				break;
+			}
+
+			if (!nProgress.oneStep())
+			{
+				ccLog::Warning("[Tiled raster] Process cancelled by the user");
+				error = true;
+				break;
+			}
+		}
+	}
+
+	//release memory
+	std::vector<unsigned>().swap(tilePointIndexes);
+
+	//image pyramid
+	if (!error && params.buildOverviews)
+	{
+		BuildOverviews(poDstDS, layout, gridWidth, gridHeight, tileSize, progressDialog);
+	}
+
+	GDALClose((GDALDatasetH)poDstDS);
+
+	if (progressDialog)
+	{
+		progressDialog->stop();
+	}
+
+	if (error)
+	{
+		return false;
+	}
+
+	ccLog::Print(QString("[Tiled raster] Raster '%1' successfully saved (%2 x %3 cells, %4 tile(s))").arg(outputFilename).arg(gridWidth).arg(gridHeight).arg(tileCount));
+	return true;
+
+#else
+	ccLog::Error("[Tiled raster] GDAL not supported by this version! Can't generate a raster...");
+	return false;
+#endif
+}
+
+bool ccTiledRasterExport::ExportStream(	const QString& inputFilename,
+										const FileIOFilter::LoadParameters& loadParameters,
+										unsigned blockSize,
+										const Parameters& params,
+										const QString& outputFilename,
+										ccProgressDialog* progressDialog/*=0*/)
+{
+#ifdef CC_GDAL_SUPPORT
+
+	if (blockSize == 0)
+	{
+		assert(false);
+		return false;
+	}
+
+	if (!CheckParameters(params))
+	{
+		return false;
+	}
+
+	if (	params.projectionType == ccRasterGrid::PROJ_MEDIAN_VALUE
+		||	params.projectionType == ccRasterGrid::PROJ_PERCENTILE_VALUE)
+	{
+		ccLog::Error("[Tiled raster] The median and percentile projections can't be computed block by block");
+		return false;
+	}
+
+	FileIOFilter::Shared filter = FileIOFilter::FindBestFilterForExtension(QFileInfo(inputFilename).suffix());
+	if (!filter)
+	{
+		ccLog::Error(QString("[Tiled raster] Can't guess file format: unhandled file extension '%1'").arg(QFileInfo(inputFilename).suffix()));
+		return false;
+	}
+
+	//local copy of the loading parameters (so that both passes use the same global shift)
+	FileIOFilter::LoadParameters localParams = loadParameters;
+	bool coordinatesShiftEnabled = (loadParameters.coordinatesShiftEnabled && *loadParameters.coordinatesShiftEnabled);
+	CCVector3d coordinatesShift = (loadParameters.coordinatesShift ? *loadParameters.coordinatesShift : CCVector3d(0, 0, 0));
+	localParams.coordinatesShiftEnabled = &coordinatesShiftEnabled;
+	localParams.coordinatesShift = &coordinatesShift;
+
+	const unsigned char Z = params.Z;
+
+	if (progressDialog)
+	{
+		progressDialog->setMethodTitle(QObject::tr("Tiled raster export"));
+		progressDialog->setInfo(QObject::tr("Computing the extents of '%1'").arg(QFileInfo(inputFilename).fileName()));
+		progressDialog->start();
+		progressDialog->show();
+		QCoreApplication::processEvents();
+	}
+
+	//first pass: extents and layout of the input file
+	ccBBox box;
+	CCVector3d globalShift(0, 0, 0);
+	double globalScale = 1.0;
+	bool hasColors = false;
+	unsigned sfCount = 0;
+	bool firstBlock = true;
+	{
+		CC_FILE_ERROR result = CC_FERR_NO_ERROR;
+		QScopedPointer<ccPointStreamReader> reader(filter->openStreamReader(inputFilename, localParams, result));
+		if (!reader)
+		{
+			if (result == CC_FERR_NOT_IMPLEMENTED)
+				ccLog::Error(QString("[Tiled raster] Format '%1' can't be streamed").arg(filter->getDefaultExtension()));
+			else
+				FileIOFilter::DisplayErrorMessage(result, "opening", inputFilename);
+			return false;
+		}
+
+		result = reader->read(blockSize, [&](ccPointCloud* block) -> bool
+		{
+			QScopedPointer<ccPointCloud> blockHolder(block);
+			if (block->size() == 0)
+			{
+				return true;
+			}
+
+			if (firstBlock)
+			{
+				globalShift = block->getGlobalShift();
+				globalScale = block->getGlobalScale();
+				hasColors = block->hasColors();
+				sfCount = block->getNumberOfScalarFields();
+				firstBlock = false;
+			}
+			box += block->getOwnBB();
+
+			return !(progressDialog && progressDialog->wasCanceled());
+		});
+
+		if (result != CC_FERR_NO_ERROR)
+		{
+			if (result == CC_FERR_CANCELED_BY_USER)
+				ccLog::Warning("[Tiled raster] Process cancelled by the user");
+			else
+				FileIOFilter::DisplayErrorMessage(result, "reading", inputFilename);
+			if (progressDialog)
+				progressDialog->stop();
+			return false;
+		}
+	}
+
+	if (firstBlock)
+	{
+		ccLog::Error(QString("[Tiled raster] File '%1' has no point").arg(inputFilename));
+		if (progressDialog)
+			progressDialog->stop();
+		return false;
+	}
+
+	if (params.box.isValid())
+	{
+		box = params.box;
+	}
+	unsigned gridWidth = 0, gridHeight = 0;
+	if (!ccRasterGrid::ComputeGridSize(Z, box, params.gridStep, gridWidth, gridHeight))
+	{
+		if (progressDialog)
+			progressDialog->stop();
+		return false;
+	}
+
+	//bands
+	RasterBandLayout layout;
+	layout.rgb = (params.exportRGB && hasColors);
+	layout.alpha = (layout.rgb && params.emptyCellsStrategy == ccRasterGrid::LEAVE_EMPTY);
+	layout.heights = params.exportHeights;
+	layout.density = params.exportDensity;
+	if (params.exportSFs && params.sfInterpolation != ccRasterGrid::INVALID_PROJECTION_TYPE)
+	{
+		layout.sfCount = sfCount;
+	}
+	if (layout.count() == 0)
+	{
+		ccLog::Error("Can't output a raster with no band! (check export parameters)");
+		if (progressDialog)
+			progressDialog->stop();
+		return false;
+	}
+
+	//second pass: the points are projected in the (whole) grid, block by block
+	ccRasterGrid grid;
+	grid.projectionPercentile = params.percentile;
+	if (	!grid.init(gridWidth, gridHeight, params.gridStep, CCVector3d::fromArray(box.minCorner().u))
+		||	!grid.beginFill(Z,
+							params.projectionType,
+							layout.sfCount != 0 ? params.sfInterpolation : ccRasterGrid::INVALID_PROJECTION_TYPE,
+							layout.sfCount,
+							layout.rgb))
+	{
+		ccLog::Error("[Tiled raster] Not enough memory to create the grid");
+		if (progressDialog)
+			progressDialog->stop();
+		return false;
+	}
+
+	{
+		//make sure the blocks are read with the same global shift as during the first pass
+		if (globalShift.norm2() != 0)
+		{
+			coordinatesShiftEnabled = true;
+			coordinatesShift = globalShift;
+		}
+
+		CC_FILE_ERROR result = CC_FERR_NO_ERROR;
+		QScopedPointer<ccPointStreamReader> reader(filter->openStreamReader(inputFilename, localParams, result));
+		if (!reader)
+		{
+			FileIOFilter::DisplayErrorMessage(result, "opening", inputFilename);
+			if (progressDialog)
+				progressDialog->stop();
+			return false;
+		}
+
+		qint64 pointsProcessed = 0;
+		QString errorStr;
+		result = reader->read(blockSize, [&](ccPointCloud* block) -> bool
+		{
+			QScopedPointer<ccPointCloud> blockHolder(block);
+			if (block->size() == 0)
+			{
+				return true;
+			}
+
+			if ((block->getGlobalShift() - globalShift).norm2() != 0 || block->getGlobalScale() != globalScale)
+			{
+				errorStr = "Inconsistent global shift between the blocks";
+				return false;
+			}
+
+			if (progressDialog)
+			{
+				progressDialog->setInfo(QObject::tr("Points: %1\nCells: %2 x %3").arg(pointsProcessed).arg(gridWidth).arg(gridHeight));
+			}
+
+			unsigned indexOffset = static_cast<unsigned>(std::min<qint64>(pointsProcessed, std::numeric_limits<unsigned>::max()));
+			pointsProcessed += block->size();
+			if (!grid.addPoints(block, indexOffset, progressDialog))
+			{
+				//process cancelled by the user (or not enough memory)
+				if (!progressDialog || !progressDialog->wasCanceled())
+				{
+					errorStr = "Failed to project the points (not enough memory?)";
+				}
+				return false;
+			}
+
+			return true;
+		});
+
+		if (result != CC_FERR_NO_ERROR)
+		{
+			if (!errorStr.isEmpty())
+				ccLog::Error(QString("[Tiled raster] %1").arg(errorStr));
+			else if (result == CC_FERR_CANCELED_BY_USER)
+				ccLog::Warning("[Tiled raster] Process cancelled by the user");
+			else
+				FileIOFilter::DisplayErrorMessage(result, "reading", inputFilename);
+			if (progressDialog)
+				progressDialog->stop();
+			return false;
+		}
+	}
+
+	if (!grid.endFill(params.emptyCellsStrategy == ccRasterGrid::INTERPOLATE))
+	{
+		ccLog::Error("[Tiled raster] Failed to finalize the grid (not enough memory?)");
+		if (progressDialog)
+			progressDialog->stop();
+		return false;
+	}
+
+	//empty cells height
+	double noDataHeight = params.customHeight;
+	if (params.emptyCellsStrategy == ccRasterGrid::LEAVE_EMPTY)
+	{
+		noDataHeight = box.minCorner().u[Z] - 1.0;
+	}
+
+	//create the output raster
+	GDALDataset* poDstDS = CreateRaster(outputFilename,
+										params,
+										layout,
+										box,
+										gridWidth,
+										gridHeight,
+										globalShift,
+										globalScale,
+										noDataHeight);
+	if (!poDstDS)
+	{
+		if (progressDialog)
+			progressDialog->stop();
+		return false;
+	}
+
+	//write the grid tile by tile
+	const unsigned tileSize = params.tileSize;
+	const unsigned tileCountX = (gridWidth + tileSize - 1) / tileSize;
+	const unsigned tileCountY = (gridHeight + tileSize - 1) / tileSize;
+	const size_t tileCount = static_cast<size_t>(tileCountX) * tileCountY;
+
+	if (progressDialog)
+	{
+		progressDialog->setInfo(QObject::tr("Cells: %1 x %2\nTiles: %3 x %4").arg(gridWidth).arg(gridHeight).arg(tileCountX).arg(tileCountY));
+		QCoreApplication::processEvents();
+	}
+	CCLib::NormalizedProgress nProgress(progressDialog, static_cast<unsigned>(tileCount));
+
+	bool error = false;
+	for (size_t tileIndex = 0; tileIndex < tileCount; ++tileIndex)
+	{
+		RasterTile tile;
+		tile.i0 = static_cast<unsigned>(tileIndex % tileCountX) * tileSize;
+		tile.j0 = static_cast<unsigned>(tileIndex / tileCountX) * tileSize;
+		tile.width = std::min(tileSize, gridWidth - tile.i0);
+		tile.height = std::min(tileSize, gridHeight - tile.j0);
+
+		if (!AllocateTileBands(layout, tile))
+		{
+			ccLog::Error("Not enough memory");
+			error = true;
+			break;
+		}
+		CopyTileCells(&grid, 0, 0, layout, noDataHeight, tile);
+
+		if (!WriteTile(poDstDS, gridHeight, tile))
+		{
+			error = true;
+			break;
+		}
+
+		if (!nProgress.oneStep())
+		{
+			ccLog::Warning("[Tiled raster] Process cancelled by the user");
+			error = true;
+			break;
+		}
+	}
+
+	//release memory
+	grid.clear();
+
+	//image pyramid
+	if (!error && params.buildOverviews)
+	{
+		BuildOverviews(poDstDS, layout, gridWidth, gridHeight, tileSize, progressDialog);
+	}
+
+	GDALClose((GDALDatasetH)poDstDS);
+
+	if (progressDialog)
+	{
+		progressDialog->stop();
+	}
+
+	if (error)
+	{
+		return false;
+	}
+
+	ccLog::Print(QString("[Tiled raster] Raster '%1' successfully saved (%2 x %3 cells, %4 tile(s))").arg(outputFilename).arg(gridWidth).arg(gridHeight).arg(tileCount));
+	return true;
+
+#else
+	ccLog::Error("[Tiled raster] GDAL not supported by this version! Can't generate a raster...");
+	return false;
+#endif
+}
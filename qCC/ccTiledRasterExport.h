@@ -0,0 +1,140 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_TILED_RASTER_EXPORT_HEADER
+#define CC_TILED_RASTER_EXPORT_HEADER
+
+//qCC_db
+#include <ccBBox.h>
+#include <ccRasterGrid.h>
+
+//qCC_io
+#include <FileIOFilter.h>
+
+//Qt
+#include <QString>
+
+class ccGenericPointCloud;
+class ccProgressDialog;
+
+//! Tiled rasterization and GeoTIFF export of a point cloud
+/** The grid is never built as a whole: it is processed by fixed-size tiles
+	(with a halo of extra cells around each tile for the empty cells
+	interpolation). Several tiles are computed in parallel and each one is
+	written as soon as it is done (as an internal tile of the output GeoTIFF).
+	Therefore the memory consumption only depends on the tile size and on
+	the number of concurrent tiles (plus one index per point and per tile).
+	Files that don't fit in memory can be rasterized with ExportStream.
+	Requires GDAL support.
+**/
+class ccTiledRasterExport
+{
+public:
+
+	//! Export parameters
+	struct Parameters
+	{
+		//! Default constructor
+		Parameters()
+			: Z(2)
+			, gridStep(1.0)
+			, projectionType(ccRasterGrid::PROJ_AVERAGE_VALUE)
+			, percentile(50.0)
+			, sfInterpolation(ccRasterGrid::INVALID_PROJECTION_TYPE)
+			, emptyCellsStrategy(ccRasterGrid::LEAVE_EMPTY)
+			, customHeight(0)
+			, tileSize(1024)
+			, haloSize(16)
+			, maxThreadCount(0)
+			, exportHeights(true)
+			, exportDensity(false)
+			, exportRGB(false)
+			, exportSFs(false)
+			, buildOverviews(false)
+		{}
+
+		//! Projection dimension
+		unsigned char Z;
+		//! Grid step
+		double gridStep;
+		//! Grid extents (the cloud bounding-box is used if invalid)
+		ccBBox box;
+		//! Height projection type
+		ccRasterGrid::ProjectionType projectionType;
+		//! Percentile (for the PROJ_PERCENTILE_VALUE projection)
+		double percentile;
+		//! Scalar fields projection type (INVALID_PROJECTION_TYPE = no scalar field)
+		ccRasterGrid::ProjectionType sfInterpolation;
+		//! Empty cells strategy (only LEAVE_EMPTY, FILL_CUSTOM_HEIGHT and INTERPOLATE are supported)
+		ccRasterGrid::EmptyCellFillOption emptyCellsStrategy;
+		//! Custom height (for FILL_CUSTOM_HEIGHT, or the cells that can't be interpolated)
+		double customHeight;
+		//! Tile size (in cells, must be a multiple of 16)
+		unsigned tileSize;
+		//! Halo size (in cells, only used with the INTERPOLATE strategy)
+		unsigned haloSize;
+		//! Max number of tiles processed concurrently (0 = number of cores)
+		int maxThreadCount;
+
+		//! Whether to export the heights band
+		bool exportHeights;
+		//! Whether to export the density (population per cell) band
+		bool exportDensity;
+		//! Whether to export the RGB bands
+		bool exportRGB;
+		//! Whether to export the scalar fields bands
+		bool exportSFs;
+		//! Whether to build overviews (i.e. an image pyramid) once the tiles are written
+		bool buildOverviews;
+	};
+
+	//! Rasterizes a cloud and exports the result as a tiled GeoTIFF file
+	/** \param cloud input cloud
+		\param params export parameters
+		\param outputFilename output filename
+		\param progressDialog optional progress dialog
+		\return success
+	**/
+	static bool Export(	ccGenericPointCloud* cloud,
+						const Parameters& params,
+						const QString& outputFilename,
+						ccProgressDialog* progressDialog = 0);
+
+	//! Rasterizes a file without loading it and exports the result as a tiled GeoTIFF file
+	/** The file is read block by block (see FileIOFilter::openStreamReader) twice:
+		once to get its extents, and once to project the points in the grid.
+		Contrary to Export, the whole grid is kept in memory (but not the points),
+		so the memory consumption only depends on the number of cells. The halo size
+		and the number of concurrent tiles are ignored, and the median and percentile
+		projections are not supported.
+		\param inputFilename input file (its format must support streaming)
+		\param loadParameters loading parameters (for the global shift)
+		\param blockSize max number of points per block
+		\param params export parameters
+		\param outputFilename output filename
+		\param progressDialog optional progress dialog
+		\return success
+	**/
+	static bool ExportStream(	const QString& inputFilename,
+								const FileIOFilter::LoadParameters& loadParameters,
+								unsigned blockSize,
+								const Parameters& params,
+								const QString& outputFilename,
+								ccProgressDialog* progressDialog = 0);
+};
+
+#endif //CC_TILED_RASTER_EXPORT_HEADER
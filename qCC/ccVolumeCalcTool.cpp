@@ -50,6 +50,7 @@
 
 //System
 #include <assert.h>
+#include <algorithm>
 
 ccVolumeCalcTool::ccVolumeCalcTool(ccGenericPointCloud* cloud1, ccGenericPointCloud* cloud2, QWidget* parent/*=0*/)
 	: QDialog(parent, Qt::WindowMaximizeButtonHint | Qt::WindowCloseButtonHint)
@@ -258,6 +259,8 @@ ccRasterGrid::ProjectionType ccVolumeCalcTool::getTypeOfProjection() const
 		return ccRasterGrid::PROJ_AVERAGE_VALUE;
 	case 2:
 		return ccRasterGrid::PROJ_MAXIMUM_VALUE;
+	case 3:
+		return ccRasterGrid::PROJ_MEDIAN_VALUE;
 	default:
 		//shouldn't be possible for this option!
 		assert(false);
@@ -426,31 +429,41 @@ ccPointCloud* ccVolumeCalcTool::convertGridToCloud(bool exportToOriginalCS) cons
 	return rasterCloud;
 }
 
+void ccVolumeCalcTool::displayGrid()
+{
+	if (!m_glWindow)
+	{
+		return;
+	}
+
+	//convert grid to point cloud
+	if (m_rasterCloud)
+	{
+		m_glWindow->removeFromOwnDB(m_rasterCloud);
+		delete m_rasterCloud;
+		m_rasterCloud = 0;
+	}
+
+	m_rasterCloud = convertGridToCloud(false);
+	if (m_rasterCloud)
+	{
+		m_glWindow->addToOwnDB(m_rasterCloud);
+		ccBBox box = m_rasterCloud->getDisplayBB_recursive(false, m_glWindow);
+		update2DDisplayZoom(box);
+	}
+	else
+	{
+		ccLog::Error("Not enough memory!");
+		m_glWindow->redraw();
+	}
+}
+
 void ccVolumeCalcTool::updateGridAndDisplay()
 {
 	bool success = updateGrid();
-	if (success && m_glWindow)
+	if (success)
 	{
-		//convert grid to point cloud
-		if (m_rasterCloud)
-		{
-			m_glWindow->removeFromOwnDB(m_rasterCloud);
-			delete m_rasterCloud;
-			m_rasterCloud = 0;
-		}
-
-		m_rasterCloud = convertGridToCloud(false);
-		if (m_rasterCloud)
-		{
-			m_glWindow->addToOwnDB(m_rasterCloud);
-			ccBBox box = m_rasterCloud->getDisplayBB_recursive(false, m_glWindow);
-			update2DDisplayZoom(box);
-		}
-		else
-		{
-			ccLog::Error("Not enough memory!");
-			m_glWindow->redraw();
-		}
+		displayGrid();
 	}
 
 	gridIsUpToDate(success);
@@ -502,6 +515,23 @@ bool SendError(const QString& message, QWidget* parentWidget)
 	return false;
 }
 
+//! Asks for a confirmation if the grid size is unexpected (only if a parent widget is defined)
+static bool ConfirmGridSize(unsigned gridTotalSize, QWidget* parentWidget)
+{
+	if (gridTotalSize == 1)
+	{
+		if (parentWidget && QMessageBox::question(parentWidget, "Unexpected grid size", "The generated grid will only have 1 cell! Do you want to proceed anyway?", QMessageBox::Yes, QMessageBox::No) == QMessageBox::No)
+			return false;
+	}
+	else if (gridTotalSize > 10000000)
+	{
+		if (parentWidget && QMessageBox::question(parentWidget, "Big grid size", "The generated grid will have more than 10.000.000 cells! Do you want to proceed anyway?", QMessageBox::Yes, QMessageBox::No) == QMessageBox::No)
+			return false;
+	}
+
+	return true;
+}
+
 bool ccVolumeCalcTool::ComputeVolume(	ccRasterGrid& grid,
 										ccGenericPointCloud* ground,
 										ccGenericPointCloud* ceil,
@@ -541,16 +571,9 @@ bool ccVolumeCalcTool::ComputeVolume(	ccRasterGrid& grid,
 	}
 
 	//grid size
-	unsigned gridTotalSize = gridWidth * gridHeight;
-	if (gridTotalSize == 1)
+	if (!ConfirmGridSize(gridWidth * gridHeight, parentWidget))
 	{
-		if (parentWidget && QMessageBox::question(parentWidget, "Unexpected grid size", "The generated grid will only have 1 cell! Do you want to proceed anyway?", QMessageBox::Yes, QMessageBox::No) == QMessageBox::No)
-			return false;
-	}
-	else if (gridTotalSize > 10000000)
-	{
-		if (parentWidget && QMessageBox::question(parentWidget, "Big grid size", "The generated grid will have more than 10.000.000 cells! Do you want to proceed anyway?", QMessageBox::Yes, QMessageBox::No) == QMessageBox::No)
-			return false;
+		return false;
 	}
 
 	//memory allocation
@@ -569,94 +592,263 @@ bool ccVolumeCalcTool::ComputeVolume(	ccRasterGrid& grid,
 	}
 
 	ccRasterGrid groundRaster;
-	if (ground)
+	if (ground && !groundRaster.init(gridWidth, gridHeight, gridStep, minCorner))
+	{
+		//not enough memory
+		return SendError("Not enough memory", parentWidget);
+	}
+
+	ccRasterGrid ceilRaster;
+	if (ceil && !ceilRaster.init(gridWidth, gridHeight, gridStep, minCorner))
+	{
+		//not enough memory
+		return SendError("Not enough memory", parentWidget);
+	}
+
+	bool interpolate = (emptyCellFillStrategy == ccRasterGrid::INTERPOLATE);
+	if (!RasterizeLayers(	ground ? &groundRaster : 0,
+							ground,
+							interpolate,
+							ceil ? &ceilRaster : 0,
+							ceil,
+							interpolate,
+							vertDim,
+							projectionType,
+							pDlg.data()))
+	{
+		return false;
+	}
+
+	return ComputeDifference(	grid,
+								ground ? &groundRaster : 0,
+								emptyCellFillStrategy,
+								groundHeight,
+								ceil ? &ceilRaster : 0,
+								emptyCellFillStrategy,
+								ceilHeight,
+								reportInfo,
+								pDlg.data());
+}
+
+bool ccVolumeCalcTool::RasterizeLayers(	ccRasterGrid* groundRaster,
+										ccGenericPointCloud* ground,
+										bool groundInterpolation,
+										ccRasterGrid* ceilRaster,
+										ccGenericPointCloud* ceil,
+										bool ceilInterpolation,
+										unsigned char vertDim,
+										ccRasterGrid::ProjectionType projectionType,
+										ccProgressDialog* progressDialog/*=0*/)
+{
+	ccRasterGrid* rasters[2] = { ground ? groundRaster : 0, ceil ? ceilRaster : 0 };
+	ccGenericPointCloud* clouds[2] = { ground, ceil };
+	bool interpolate[2] = { groundInterpolation, ceilInterpolation };
+	const char* layerNames[2] = { "Ground", "Ceil" };
+
+	//project the points (the rasterizer already uses all the cores)
+	for (int k = 0; k < 2; ++k)
 	{
-		if (!groundRaster.init(gridWidth, gridHeight, gridStep, minCorner))
+		ccRasterGrid* raster = rasters[k];
+		if (!raster)
 		{
-			//not enough memory
-			return SendError("Not enough memory", parentWidget);
+			continue;
 		}
+		assert(raster->width != 0 && raster->height != 0);
 
-		if (groundRaster.fillWith(	ground,
-									vertDim,
-									projectionType,
-									emptyCellFillStrategy == ccRasterGrid::INTERPOLATE,
-									ccRasterGrid::INVALID_PROJECTION_TYPE,
-									pDlg.data()))
+		if (!raster->beginFill(vertDim, projectionType))
 		{
-			groundRaster.fillEmptyCells(emptyCellFillStrategy, groundHeight);
-			ccLog::Print(QString("[Volume] Ground raster grid: size: %1 x %2 / heights: [%3 ; %4]").arg(groundRaster.width).arg(groundRaster.height).arg(groundRaster.minHeight).arg(groundRaster.maxHeight));
+			ccLog::Warning("[Volume] Not enough memory");
+			return false;
+		}
+
+		if (progressDialog)
+		{
+			progressDialog->setMethodTitle(QObject::tr("%1 grid generation").arg(layerNames[k]));
+			progressDialog->setInfo(QObject::tr("Points: %1\nCells: %2 x %3").arg(clouds[k]->size()).arg(raster->width).arg(raster->height));
+			progressDialog->start();
+			progressDialog->show();
+			QCoreApplication::processEvents();
 		}
-		else
+
+		if (!raster->addPoints(clouds[k], 0, progressDialog))
 		{
+			//process cancelled by the user (or not enough memory)
 			return false;
 		}
 	}
 
-	//ceil
-	ccRasterGrid ceilRaster;
-	if (ceil)
+	//finalize both grids concurrently (the interpolation of the empty cells is sequential)
+	bool success[2] = { true, true };
+	bool concurrent = (rasters[0] && rasters[1] && (groundInterpolation || ceilInterpolation));
+#if defined(_OPENMP)
+	#pragma omp parallel for num_threads(2) if(concurrent)
+#endif
+	for (int k = 0; k < 2; ++k)
 	{
-		if (!ceilRaster.init(gridWidth, gridHeight, gridStep, minCorner))
+		if (rasters[k])
 		{
-			//not enough memory
-			return SendError("Not enough memory", parentWidget);
-			return false;
+			try
+			{
+				success[k] = rasters[k]->endFill(interpolate[k]);
+			}
+			catch (const std::bad_alloc&)
+			{
+				//not enough memory
+				success[k] = false;
+			}
 		}
+	}
 
-		if (ceilRaster.fillWith(ceil,
-								vertDim,
-								projectionType,
-								emptyCellFillStrategy == ccRasterGrid::INTERPOLATE,
-								ccRasterGrid::INVALID_PROJECTION_TYPE,
-								pDlg.data()))
+	for (int k = 0; k < 2; ++k)
+	{
+		if (!rasters[k])
 		{
-			ceilRaster.fillEmptyCells(emptyCellFillStrategy, ceilHeight);
-			ccLog::Print(QString("[Volume] Ceil raster grid: size: %1 x %2 / heights: [%3 ; %4]").arg(ceilRaster.width).arg(ceilRaster.height).arg(ceilRaster.minHeight).arg(ceilRaster.maxHeight));
+			continue;
 		}
-		else
+		if (!success[k])
 		{
+			ccLog::Warning(QString("[Volume] Failed to generate the %1 grid (not enough memory?)").arg(QString(layerNames[k]).toLower()));
 			return false;
 		}
+		ccLog::Print(QString("[Volume] %1 raster grid: size: %2 x %3 / heights: [%4 ; %5]").arg(layerNames[k]).arg(rasters[k]->width).arg(rasters[k]->height).arg(rasters[k]->minHeight).arg(rasters[k]->maxHeight));
+	}
+
+	return true;
+}
+
+//! Returns the height of the empty cells of a raster (NaN = the cells remain empty)
+static double EmptyCellHeight(	const ccRasterGrid& raster,
+								ccRasterGrid::EmptyCellFillOption fillStrategy,
+								double customHeight)
+{
+	switch (fillStrategy)
+	{
+	case ccRasterGrid::FILL_MINIMUM_HEIGHT:
+		return raster.minHeight;
+	case ccRasterGrid::FILL_MAXIMUM_HEIGHT:
+		return raster.maxHeight;
+	case ccRasterGrid::FILL_CUSTOM_HEIGHT:
+		return customHeight;
+	case ccRasterGrid::FILL_AVERAGE_HEIGHT:
+		return raster.meanHeight;
+	default:
+		//LEAVE_EMPTY or INTERPOLATE (already done when the raster is generated)
+		break;
+	}
+
+	return std::numeric_limits<double>::quiet_NaN();
+}
+
+//! Number of grid rows processed between two progress updates
+static const int VOLUME_ROWS_PER_BATCH = 64;
+
+//! Per-row statistics of the volume computation
+struct VolumeRowStats
+{
+	VolumeRowStats()
+		: volume(0)
+		, addedVolume(0)
+		, removedVolume(0)
+		, matchingCount(0)
+		, groundNonMatchingCount(0)
+		, ceilNonMatchingCount(0)
+		, validNeighborsCount(0)
+		, neighborsTestCount(0)
+	{}
+
+	double volume;
+	double addedVolume;
+	double removedVolume;
+	unsigned matchingCount;
+	unsigned groundNonMatchingCount;
+	unsigned ceilNonMatchingCount;
+	unsigned validNeighborsCount;
+	unsigned neighborsTestCount;
+};
+
+bool ccVolumeCalcTool::ComputeDifference(	ccRasterGrid& grid,
+											const ccRasterGrid* groundRaster,
+											ccRasterGrid::EmptyCellFillOption groundFillStrategy,
+											double groundHeight,
+											const ccRasterGrid* ceilRaster,
+											ccRasterGrid::EmptyCellFillOption ceilFillStrategy,
+											double ceilHeight,
+											ccVolumeCalcTool::ReportInfo& reportInfo,
+											ccProgressDialog* progressDialog/*=0*/)
+{
+	if (	grid.width == 0
+		||	grid.height == 0
+		||	(groundRaster && (groundRaster->width != grid.width || groundRaster->height != grid.height))
+		||	(ceilRaster && (ceilRaster->width != grid.width || ceilRaster->height != grid.height)))
+	{
+		assert(false);
+		ccLog::Warning("[Volume] Inconsistent grid dimensions");
+		return false;
+	}
+
+	//height of the empty cells
+	double groundEmptyCellHeight = (groundRaster ? EmptyCellHeight(*groundRaster, groundFillStrategy, groundHeight) : groundHeight);
+	double ceilEmptyCellHeight = (ceilRaster ? EmptyCellHeight(*ceilRaster, ceilFillStrategy, ceilHeight) : ceilHeight);
+
+	//the statistics are computed per row, and summed afterwards (always in the same order)
+	std::vector<VolumeRowStats> rowStats;
+	try
+	{
+		rowStats.resize(grid.height);
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[Volume] Not enough memory");
+		return false;
+	}
+
+	if (progressDialog)
+	{
+		progressDialog->setMethodTitle(QObject::tr("Volume computation"));
+		progressDialog->setInfo(QObject::tr("Cells: %1 x %2").arg(grid.width).arg(grid.height));
+		progressDialog->start();
+		progressDialog->show();
+		QCoreApplication::processEvents();
 	}
+	CCLib::NormalizedProgress nProgress(progressDialog, grid.height);
 
 	//update grid and compute volume
+	const int rowCount = static_cast<int>(grid.height);
+	for (int firstRow = 0; firstRow < rowCount; firstRow += VOLUME_ROWS_PER_BATCH)
 	{
-		if (pDlg)
-		{
-			pDlg->setMethodTitle(QObject::tr("Volume computation"));
-			pDlg->setInfo(QObject::tr("Cells: %1 x %2").arg(grid.width).arg(grid.height));
-			pDlg->start();
-			pDlg->show();
-			QCoreApplication::processEvents();
-		}
-		CCLib::NormalizedProgress nProgress(pDlg.data(), grid.width * grid.height);
-		
-		size_t ceilNonMatchingCount = 0;
-		size_t groundNonMatchingCount = 0;
-		size_t cellCount = 0;
-
-		//at least one of the grid is based on a cloud
-		grid.nonEmptyCellCount = 0;
-		for (unsigned i = 0; i < grid.height; ++i)
+		int lastRow = std::min(firstRow + VOLUME_ROWS_PER_BATCH, rowCount);
+
+#if defined(_OPENMP)
+		#pragma omp parallel for
+#endif
+		for (int i = firstRow; i < lastRow; ++i)
 		{
+			VolumeRowStats& stats = rowStats[i];
 			for (unsigned j = 0; j < grid.width; ++j)
 			{
 				ccRasterCell& cell = grid.rows[i][j];
 
 				bool validGround = true;
 				cell.minHeight = groundHeight;
-				if (ground)
+				if (groundRaster)
 				{
-					cell.minHeight = groundRaster.rows[i][j].h;
+					cell.minHeight = groundRaster->rows[i][j].h;
+					if (!std::isfinite(cell.minHeight))
+					{
+						cell.minHeight = groundEmptyCellHeight;
+					}
 					validGround = std::isfinite(cell.minHeight);
 				}
 
 				bool validCeil = true;
 				cell.maxHeight = ceilHeight;
-				if (ceil)
+				if (ceilRaster)
 				{
-					cell.maxHeight = ceilRaster.rows[i][j].h;
+					cell.maxHeight = ceilRaster->rows[i][j].h;
+					if (!std::isfinite(cell.maxHeight))
+					{
+						cell.maxHeight = ceilEmptyCellHeight;
+					}
 					validCeil = std::isfinite(cell.maxHeight);
 				}
 
@@ -665,30 +857,26 @@ bool ccVolumeCalcTool::ComputeVolume(	ccRasterGrid& grid,
 					cell.h = cell.maxHeight - cell.minHeight;
 					cell.nbPoints = 1;
 
-					reportInfo.volume += cell.h;
+					stats.volume += cell.h;
 					if (cell.h < 0)
 					{
-						reportInfo.removedVolume -= cell.h;
+						stats.removedVolume -= cell.h;
 					}
 					else if (cell.h > 0)
 					{
-						reportInfo.addedVolume += cell.h;
+						stats.addedVolume += cell.h;
 					}
-					reportInfo.surface += 1.0;
-					++grid.nonEmptyCellCount; //= matching count
-					++cellCount;
+					++stats.matchingCount;
 				}
 				else
 				{
 					if (validGround)
 					{
-						++cellCount;
-						++groundNonMatchingCount;
+						++stats.groundNonMatchingCount;
 					}
 					else if (validCeil)
 					{
-						++cellCount;
-						++ceilNonMatchingCount;
+						++stats.ceilNonMatchingCount;
 					}
 					cell.h = std::numeric_limits<double>::quiet_NaN();
 					cell.nbPoints = 0;
@@ -696,68 +884,206 @@ bool ccVolumeCalcTool::ComputeVolume(	ccRasterGrid& grid,
 
 				cell.avgHeight = (groundHeight + ceilHeight) / 2;
 				cell.stdDevHeight = 0;
-
-				if (pDlg && !nProgress.oneStep())
-				{
-					ccLog::Warning("[Volume] Process cancelled by the user");
-					return false;
-				}
 			}
 		}
-		grid.validCellCount = grid.nonEmptyCellCount;
 
-		//count the average number of valid neighbors
+		if (progressDialog && !nProgress.steps(static_cast<unsigned>(lastRow - firstRow)))
+		{
+			ccLog::Warning("[Volume] Process cancelled by the user");
+			return false;
+		}
+	}
+
+	//count the average number of valid neighbors
+#if defined(_OPENMP)
+	#pragma omp parallel for
+#endif
+	for (int i = 1; i < rowCount - 1; ++i)
+	{
+		VolumeRowStats& stats = rowStats[i];
+		for (unsigned j = 1; j < grid.width - 1; ++j)
 		{
-			size_t validNeighborsCount = 0;
-			size_t count = 0;
-			for (unsigned i = 1; i < grid.height - 1; ++i)
+			const ccRasterCell& cell = grid.rows[i][j];
+			if (cell.h == cell.h)
 			{
-				for (unsigned j = 1; j < grid.width - 1; ++j)
+				for (int k = i - 1; k <= i + 1; ++k)
 				{
-					ccRasterCell& cell = grid.rows[i][j];
-					if (cell.h == cell.h)
+					for (unsigned l = j - 1; l <= j + 1; ++l)
 					{
-						for (unsigned k = i - 1; k <= i + 1; ++k)
+						if (k != i || l != j)
 						{
-							for (unsigned l = j - 1; l <= j + 1; ++l)
+							const ccRasterCell& otherCell = grid.rows[k][l];
+							if (std::isfinite(otherCell.h))
 							{
-								if (k != i || l != j)
-								{
-									ccRasterCell& otherCell = grid.rows[k][l];
-									if (std::isfinite(otherCell.h))
-									{
-										++validNeighborsCount;
-									}
-								}
+								++stats.validNeighborsCount;
 							}
 						}
-
-						++count;
 					}
 				}
-			}
 
-			if (count)
-			{
-				reportInfo.averageNeighborsPerCell = static_cast<double>(validNeighborsCount) / count;
+				++stats.neighborsTestCount;
 			}
 		}
+	}
 
-		reportInfo.matchingPrecent = static_cast<float>(grid.validCellCount * 100) / cellCount;
-		reportInfo.groundNonMatchingPercent = static_cast<float>(groundNonMatchingCount * 100) / cellCount;
-		reportInfo.ceilNonMatchingPercent = static_cast<float>(ceilNonMatchingCount * 100) / cellCount;
-		float cellArea = static_cast<float>(grid.gridStep * grid.gridStep);
-		reportInfo.volume *= cellArea;
-		reportInfo.addedVolume *= cellArea;
-		reportInfo.removedVolume *= cellArea;
-		reportInfo.surface *= cellArea;
+	//sum the per-row statistics
+	size_t matchingCount = 0;
+	size_t groundNonMatchingCount = 0;
+	size_t ceilNonMatchingCount = 0;
+	size_t validNeighborsCount = 0;
+	size_t neighborsTestCount = 0;
+	for (size_t i = 0; i < rowStats.size(); ++i)
+	{
+		const VolumeRowStats& stats = rowStats[i];
+		reportInfo.volume += stats.volume;
+		reportInfo.addedVolume += stats.addedVolume;
+		reportInfo.removedVolume += stats.removedVolume;
+		matchingCount += stats.matchingCount;
+		groundNonMatchingCount += stats.groundNonMatchingCount;
+		ceilNonMatchingCount += stats.ceilNonMatchingCount;
+		validNeighborsCount += stats.validNeighborsCount;
+		neighborsTestCount += stats.neighborsTestCount;
+	}
+	size_t cellCount = matchingCount + groundNonMatchingCount + ceilNonMatchingCount;
+
+	grid.nonEmptyCellCount = static_cast<unsigned>(matchingCount);
+	grid.validCellCount = grid.nonEmptyCellCount;
+
+	reportInfo.surface += static_cast<double>(matchingCount);
+	if (neighborsTestCount)
+	{
+		reportInfo.averageNeighborsPerCell = static_cast<double>(validNeighborsCount) / neighborsTestCount;
 	}
 
+	reportInfo.matchingPrecent = static_cast<float>(grid.validCellCount * 100) / cellCount;
+	reportInfo.groundNonMatchingPercent = static_cast<float>(groundNonMatchingCount * 100) / cellCount;
+	reportInfo.ceilNonMatchingPercent = static_cast<float>(ceilNonMatchingCount * 100) / cellCount;
+	float cellArea = static_cast<float>(grid.gridStep * grid.gridStep);
+	reportInfo.volume *= cellArea;
+	reportInfo.addedVolume *= cellArea;
+	reportInfo.removedVolume *= cellArea;
+	reportInfo.surface *= cellArea;
+
 	grid.setValid(true);
 
 	return true;
 }
 
+bool ccVolumeCalcTool::LayerCache::matches(	ccGenericPointCloud* _cloud,
+											unsigned char _vertDim,
+											ccRasterGrid::ProjectionType _projectionType,
+											bool _interpolate,
+											unsigned gridWidth,
+											unsigned gridHeight,
+											double gridStep,
+											const CCVector3d& minCorner) const
+{
+	return	upToDate
+		&&	cloud == _cloud
+		&&	vertDim == _vertDim
+		&&	projectionType == _projectionType
+		&&	interpolate == _interpolate
+		&&	raster.width == gridWidth
+		&&	raster.height == gridHeight
+		&&	raster.gridStep == gridStep
+		&&	raster.minCorner.x == minCorner.x
+		&&	raster.minCorner.y == minCorner.y
+		&&	raster.minCorner.z == minCorner.z;
+}
+
+//! Grid step multiplier (and point sampling step) of the coarse preview
+static const unsigned PREVIEW_STEP_FACTOR = 4;
+//! Minimum number of points to rasterize above which a coarse preview is displayed first
+static const unsigned PREVIEW_MIN_POINT_COUNT = 2000000;
+//! Minimum number of cells above which a coarse preview is displayed first
+static const unsigned PREVIEW_MIN_CELL_COUNT = 1000000;
+
+//! Returns a regular sampling of a cloud (only the point coordinates are copied)
+static ccPointCloud* SampleCloud(ccGenericPointCloud* cloud, unsigned samplingStep)
+{
+	assert(cloud && samplingStep != 0);
+
+	unsigned pointCount = cloud->size();
+	ccPointCloud* sample = new ccPointCloud(cloud->getName());
+	if (!sample->reserve((pointCount + samplingStep - 1) / samplingStep))
+	{
+		//not enough memory
+		delete sample;
+		return 0;
+	}
+
+	for (unsigned i = 0; i < pointCount; i += samplingStep)
+	{
+		sample->addPoint(*cloud->getPoint(i));
+	}
+
+	return sample;
+}
+
+bool ccVolumeCalcTool::computePreview(	ccGenericPointCloud* groundCloud,
+										double groundHeight,
+										ccGenericPointCloud* ceilCloud,
+										double ceilHeight,
+										const ccBBox& box,
+										ccProgressDialog* progressDialog)
+{
+	unsigned char vertDim = getProjectionDimension();
+	double previewStep = getGridStep() * PREVIEW_STEP_FACTOR;
+	unsigned previewWidth = 0, previewHeight = 0;
+	if (!ccRasterGrid::ComputeGridSize(vertDim, box, previewStep, previewWidth, previewHeight))
+	{
+		//no preview
+		return true;
+	}
+
+	//the clouds are subsampled as well (the preview cells are much bigger anyway)
+	QScopedPointer<ccPointCloud> groundSample(groundCloud ? SampleCloud(groundCloud, PREVIEW_STEP_FACTOR) : 0);
+	QScopedPointer<ccPointCloud> ceilSample(ceilCloud ? SampleCloud(ceilCloud, PREVIEW_STEP_FACTOR) : 0);
+
+	CCVector3d minCorner = CCVector3d::fromArray(box.minCorner().u);
+	ccRasterGrid groundRaster, ceilRaster;
+	if (	(groundCloud && (!groundSample || !groundRaster.init(previewWidth, previewHeight, previewStep, minCorner)))
+		||	(ceilCloud && (!ceilSample || !ceilRaster.init(previewWidth, previewHeight, previewStep, minCorner)))
+		||	!m_grid.init(previewWidth, previewHeight, previewStep, minCorner))
+	{
+		//not enough memory: no preview
+		return true;
+	}
+
+	ccRasterGrid::EmptyCellFillOption groundFillStrategy = getFillEmptyCellsStrategy(fillGroundEmptyCellsComboBox);
+	ccRasterGrid::EmptyCellFillOption ceilFillStrategy = getFillEmptyCellsStrategy(fillCeilEmptyCellsComboBox);
+
+	ReportInfo reportInfo;
+	if (	!RasterizeLayers(	groundCloud ? &groundRaster : 0,
+								groundSample.data(),
+								groundFillStrategy == ccRasterGrid::INTERPOLATE,
+								ceilCloud ? &ceilRaster : 0,
+								ceilSample.data(),
+								ceilFillStrategy == ccRasterGrid::INTERPOLATE,
+								vertDim,
+								getTypeOfProjection(),
+								progressDialog)
+		||	!ComputeDifference(	m_grid,
+								groundCloud ? &groundRaster : 0,
+								groundFillStrategy,
+								groundHeight,
+								ceilCloud ? &ceilRaster : 0,
+								ceilFillStrategy,
+								ceilHeight,
+								reportInfo,
+								progressDialog))
+	{
+		//no preview
+		return !(progressDialog && progressDialog->wasCanceled());
+	}
+
+	displayGrid();
+	reportPlainTextEdit->setPlainText(QString("Preview (grid step = %1)\n\n").arg(previewStep) + reportInfo.toText(precisionSpinBox->value()));
+	QCoreApplication::processEvents();
+
+	return true;
+}
+
 bool ccVolumeCalcTool::updateGrid()
 {
 	if (!m_cloud2)
@@ -783,13 +1109,12 @@ bool ccVolumeCalcTool::updateGrid()
 	double gridStep = getGridStep();
 	assert(gridStep != 0);
 
-	//ground
+	//ground (the height is either the constant height or the custom height of the empty cells)
 	ccGenericPointCloud* groundCloud = 0;
-	double groundHeight = 0;
+	double groundHeight = groundEmptyValueDoubleSpinBox->value();
 	switch (groundComboBox->currentIndex())
 	{
 	case 0:
-		groundHeight = groundEmptyValueDoubleSpinBox->value();
 		break;
 	case 1:
 		groundCloud = m_cloud1 ? m_cloud1 : m_cloud2;
@@ -802,13 +1127,12 @@ bool ccVolumeCalcTool::updateGrid()
 		return false;
 	}
 
-	//ceil
+	//ceil (the height is either the constant height or the custom height of the empty cells)
 	ccGenericPointCloud* ceilCloud = 0;
-	double ceilHeight = 0;
+	double ceilHeight = ceilEmptyValueDoubleSpinBox->value();
 	switch (ceilComboBox->currentIndex())
 	{
 	case 0:
-		ceilHeight = ceilEmptyValueDoubleSpinBox->value();
 		break;
 	case 1:
 		ceilCloud = m_cloud1 ? m_cloud1 : m_cloud2;
@@ -821,22 +1145,104 @@ bool ccVolumeCalcTool::updateGrid()
 		return false;
 	}
 
+	//grid size
+	if (!ConfirmGridSize(gridWidth * gridHeight, this))
+	{
+		return false;
+	}
+
+	unsigned char vertDim = getProjectionDimension();
+	ccRasterGrid::ProjectionType projectionType = getTypeOfProjection();
+	ccRasterGrid::EmptyCellFillOption groundFillStrategy = getFillEmptyCellsStrategy(fillGroundEmptyCellsComboBox);
+	ccRasterGrid::EmptyCellFillOption ceilFillStrategy = getFillEmptyCellsStrategy(fillCeilEmptyCellsComboBox);
+	bool groundInterpolation = (groundFillStrategy == ccRasterGrid::INTERPOLATE);
+	bool ceilInterpolation = (ceilFillStrategy == ccRasterGrid::INTERPOLATE);
+	CCVector3d minCorner = CCVector3d::fromArray(box.minCorner().u);
+
+	//which layers should be generated again?
+	bool updateGround = (groundCloud && !m_groundLayer.matches(groundCloud, vertDim, projectionType, groundInterpolation, gridWidth, gridHeight, gridStep, minCorner));
+	bool updateCeil = (ceilCloud && !m_ceilLayer.matches(ceilCloud, vertDim, projectionType, ceilInterpolation, gridWidth, gridHeight, gridStep, minCorner));
+
+	ccProgressDialog pDlg(true, this);
+
+	if (updateGround || updateCeil)
+	{
+		//display a coarse preview first if it's worth it
+		unsigned pointCount = (updateGround ? groundCloud->size() : 0) + (updateCeil ? ceilCloud->size() : 0);
+		if (	pointCount >= PREVIEW_MIN_POINT_COUNT
+			||	static_cast<size_t>(gridWidth) * gridHeight >= PREVIEW_MIN_CELL_COUNT)
+		{
+			if (!computePreview(groundCloud, groundHeight, ceilCloud, ceilHeight, box, &pDlg))
+			{
+				//process cancelled by the user
+				return false;
+			}
+		}
+
+		if (updateGround)
+		{
+			m_groundLayer.upToDate = false;
+		}
+		if (updateCeil)
+		{
+			m_ceilLayer.upToDate = false;
+		}
+		if (	(updateGround && !m_groundLayer.raster.init(gridWidth, gridHeight, gridStep, minCorner))
+			||	(updateCeil && !m_ceilLayer.raster.init(gridWidth, gridHeight, gridStep, minCorner)))
+		{
+			//not enough memory
+			ccLog::Error("Not enough memory");
+			return false;
+		}
+
+		if (!RasterizeLayers(	updateGround ? &m_groundLayer.raster : 0,
+								groundCloud,
+								groundInterpolation,
+								updateCeil ? &m_ceilLayer.raster : 0,
+								ceilCloud,
+								ceilInterpolation,
+								vertDim,
+								projectionType,
+								&pDlg))
+		{
+			return false;
+		}
+
+		LayerCache* updatedLayers[2] = { updateGround ? &m_groundLayer : 0, updateCeil ? &m_ceilLayer : 0 };
+		ccGenericPointCloud* updatedClouds[2] = { groundCloud, ceilCloud };
+		bool updatedInterpolation[2] = { groundInterpolation, ceilInterpolation };
+		for (int k = 0; k < 2; ++k)
+		{
+			if (updatedLayers[k])
+			{
+				updatedLayers[k]->cloud = updatedClouds[k];
+				updatedLayers[k]->vertDim = vertDim;
+				updatedLayers[k]->projectionType = projectionType;
+				updatedLayers[k]->interpolate = updatedInterpolation[k];
+				updatedLayers[k]->upToDate = true;
+			}
+		}
+	}
+
+	//the difference stage is always computed again (it's fast)
+	if (!m_grid.init(gridWidth, gridHeight, gridStep, minCorner))
+	{
+		//not enough memory
+		ccLog::Error("Not enough memory");
+		return false;
+	}
+
 	ccVolumeCalcTool::ReportInfo reportInfo;
 
-	if (ComputeVolume(	m_grid,
-						groundCloud,
-						ceilCloud,
-						box,
-						getProjectionDimension(),
-						gridStep,
-						gridWidth,
-						gridHeight,
-						getTypeOfProjection(),
-						getFillEmptyCellsStrategy(fillGroundEmptyCellsComboBox),
-						reportInfo,
-						groundHeight,
-						ceilHeight,
-						this))
+	if (ComputeDifference(	m_grid,
+							groundCloud ? &m_groundLayer.raster : 0,
+							groundFillStrategy,
+							groundHeight,
+							ceilCloud ? &m_ceilLayer.raster : 0,
+							ceilFillStrategy,
+							ceilHeight,
+							reportInfo,
+							&pDlg))
 	{	
 		outputReport(reportInfo);
 		return true;
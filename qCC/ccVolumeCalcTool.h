@@ -29,6 +29,7 @@
 class ccGenericPointCloud;
 class ccPointCloud;
 class ccPolyline;
+class ccProgressDialog;
 class QComboBox;
 
 //! Volume calculation tool (dialog)
@@ -90,6 +91,46 @@ public:
 								double ceilHeight,
 								QWidget* parentWidget = 0);
 
+	//! Rasterizes the ground and/or the ceil clouds (first stage of the volume computation)
+	/** Both rasters must be initialized beforehand (a null raster is simply ignored).
+		The points are projected with the parallel rasterizer, and the post-processing
+		of both grids (i.e. the interpolation of the empty cells) is done concurrently.
+		Apart from the interpolation, the empty cells are left as is (see ComputeDifference).
+		\return success
+	**/
+	static bool RasterizeLayers(ccRasterGrid* groundRaster,
+								ccGenericPointCloud* ground,
+								bool groundInterpolation,
+								ccRasterGrid* ceilRaster,
+								ccGenericPointCloud* ceil,
+								bool ceilInterpolation,
+								unsigned char vertDim,
+								ccRasterGrid::ProjectionType projectionType,
+								ccProgressDialog* progressDialog = 0);
+
+	//! Computes the height difference grid and the corresponding volume (second stage of the volume computation)
+	/** The (initialized) output grid must have the same dimensions as the input rasters.
+		\param grid output grid
+		\param groundRaster ground raster (or 0 to use a constant height)
+		\param groundFillStrategy empty cells strategy for the ground raster
+		\param groundHeight constant ground height (or custom height for empty cells)
+		\param ceilRaster ceil raster (or 0 to use a constant height)
+		\param ceilFillStrategy empty cells strategy for the ceil raster
+		\param ceilHeight constant ceil height (or custom height for empty cells)
+		\param reportInfo output report
+		\param progressDialog optional progress dialog
+		\return success
+	**/
+	static bool ComputeDifference(	ccRasterGrid& grid,
+									const ccRasterGrid* groundRaster,
+									ccRasterGrid::EmptyCellFillOption groundFillStrategy,
+									double groundHeight,
+									const ccRasterGrid* ceilRaster,
+									ccRasterGrid::EmptyCellFillOption ceilFillStrategy,
+									double ceilHeight,
+									ccVolumeCalcTool::ReportInfo& reportInfo,
+									ccProgressDialog* progressDialog = 0);
+
 	//! Converts a (volume) grid to a point cloud
 	static ccPointCloud* ConvertGridToCloud(	ccRasterGrid& grid,
 												const ccBBox& gridBox,
@@ -154,8 +195,24 @@ protected: //standard methods
 	void loadSettings();
 
 	//! Updates the grid
+	/** Only the layers (ground or ceil) whose parameters have changed are
+		rasterized again. In this case, a coarse preview may be displayed first.
+	**/
 	bool updateGrid();
 
+	//! Computes and displays a coarse preview of the volume grid
+	/** \return false if the process has been cancelled by the user
+	**/
+	bool computePreview(ccGenericPointCloud* groundCloud,
+						double groundHeight,
+						ccGenericPointCloud* ceilCloud,
+						double ceilHeight,
+						const ccBBox& box,
+						ccProgressDialog* progressDialog);
+
+	//! Displays the current grid (as a cloud) in the 2D view
+	void displayGrid();
+
 	//! Converts the grid to a point cloud
 	ccPointCloud* convertGridToCloud(bool exportToOriginalCS) const;
 
@@ -173,6 +230,44 @@ protected: //members
 	/** Only valid if clipboardPushButton is enabled
 	**/
 	ReportInfo m_lastReport;
+
+	//! Rasterized layer (ground or ceil)
+	/** Only the interpolation of the empty cells is applied to the cached
+		raster: the other filling strategies are handled by the difference
+		stage, so that changing them doesn't require to rasterize the cloud again.
+	**/
+	struct LayerCache
+	{
+		LayerCache()
+			: cloud(0)
+			, vertDim(0)
+			, projectionType(ccRasterGrid::INVALID_PROJECTION_TYPE)
+			, interpolate(false)
+			, upToDate(false)
+		{}
+
+		//! Returns whether the cached raster corresponds to the given parameters
+		bool matches(	ccGenericPointCloud* cloud,
+						unsigned char vertDim,
+						ccRasterGrid::ProjectionType projectionType,
+						bool interpolate,
+						unsigned gridWidth,
+						unsigned gridHeight,
+						double gridStep,
+						const CCVector3d& minCorner) const;
+
+		ccGenericPointCloud* cloud;
+		unsigned char vertDim;
+		ccRasterGrid::ProjectionType projectionType;
+		bool interpolate;
+		bool upToDate;
+		ccRasterGrid raster;
+	};
+
+	//! Cached ground layer
+	LayerCache m_groundLayer;
+	//! Cached ceil layer
+	LayerCache m_ceilLayer;
 };
 
 #endif //CC_VOLUME_CALC_TOOL_HEADER
@@ -39,6 +39,7 @@
 #include <ccNormalVectors.h>
 #include <ccColorScalesManager.h>
 #include <ccMaterial.h>
+#include <ccPointCloud.h>
 
 //qCC_io
 #include <FileIOFilter.h>
@@ -176,6 +177,9 @@ int main(int argc, char **argv)
 		
 		ccGlobalShiftManager::SetMaxCoordinateAbsValue(maxAbsCoord);
 		ccGlobalShiftManager::SetMaxBoundgBoxDiagonal(maxAbsDiag);
+
+		//whether the LOD structure is saved with the clouds in BIN files (see the display options)
+		ccPointCloud::SetLODSavedWithCloud(ccGui::Parameters().saveLODWithClouds);
 	}
 
 	//Command line mode?
@@ -114,6 +114,8 @@
 
 //other
 #include "ccCropTool.h"
+#include "ccFileLoadQueue.h"
+#include "ccLibAlgorithms.h"
 #include "ccPersistentSettings.h"
 #include "ccRecentFiles.h"
 #include "ccRegistrationTools.h"
@@ -149,6 +151,7 @@ MainWindow::MainWindow()
 	: m_ccRoot(0)
 	, m_uiFrozen(false)
 	, m_recentFiles(new ccRecentFiles(this))
+	, m_loadQueue(new ccFileLoadQueue(this))
 	, m_3DMouseManager(nullptr)
 	, m_gamepadManager(nullptr)
 	, m_viewModePopupButton(0)
@@ -266,12 +269,21 @@ MainWindow::MainWindow()
 
 	updateUIWithSelection();
 
+	//asynchronous file loading
+	QMainWindow::statusBar()->addPermanentWidget(m_loadQueue->statusWidget());
+	connect(m_loadQueue, &ccFileLoadQueue::fileLoaded, this, &MainWindow::handleLoadedFile);
+	connect(m_loadQueue, &ccFileLoadQueue::allFilesProcessed, this, &MainWindow::handleAllFilesProcessed);
+
 	QMainWindow::statusBar()->showMessage(QString("Ready"));
 	ccConsole::Print("CloudCompare started!");
 }
 
 MainWindow::~MainWindow()
 {
+	//stop loading files (before anything else)
+	delete m_loadQueue;
+	m_loadQueue = 0;
+
 	destroyInputDevices();
 
 	cancelPreviousPickingOperation(false); //just in case
@@ -737,6 +749,8 @@ void MainWindow::connectActions()
 	connect(actionExclusiveFullScreen, SIGNAL(toggled(bool)), this, SLOT(toggleExclusiveFullScreen(bool)));
 	connect(actionRefresh, SIGNAL(triggered()), this, SLOT(refreshAll()));
 	connect(actionTestFrameRate, SIGNAL(triggered()), this, SLOT(testFrameRate()));
+	connect(actionShowFrameStats, SIGNAL(toggled(bool)), this, SLOT(toggleFrameStats(bool)));
+	connect(actionSaveFrameStats, SIGNAL(triggered()), this, SLOT(saveFrameStats()));
 	connect(actionToggleCenteredPerspective, SIGNAL(triggered()), this, SLOT(toggleActiveWindowCenteredPerspective()));
 	connect(actionToggleViewerBasedPerspective, SIGNAL(triggered()), this, SLOT(toggleActiveWindowViewerBasedPerspective()));
 	connect(actionShowCursor3DCoordinates, SIGNAL(toggled(bool)), this, SLOT(toggleActiveWindowShowCursorCoords(bool)));
@@ -4677,8 +4691,12 @@ void MainWindow::doActionComputeMesh(CC_TRIANGULATION_TYPES type)
 	pDlg.setWindowTitle(tr("Triangulation"));
 	pDlg.setInfo(tr("Triangulation in progress..."));
 	pDlg.setRange(0, 0);
-	pDlg.show();
-	QApplication::processEvents();
+	//the axis-aligned triangulation is computed tile by tile (with its own progress dialog)
+	if (type != DELAUNAY_2D_AXIS_ALIGNED)
+	{
+		pDlg.show();
+		QApplication::processEvents();
+	}
 
 	bool errors = false;
 	for (size_t i = 0; i < clouds.size(); ++i)
@@ -4688,12 +4706,29 @@ void MainWindow::doActionComputeMesh(CC_TRIANGULATION_TYPES type)
 
 		//compute mesh
 		ccGenericPointCloud* cloud = ccHObjectCaster::ToGenericPointCloud(ent);
-		ccMesh* mesh = ccMesh::Triangulate(cloud,
-			type,
-			updateNormals,
-			static_cast<PointCoordinateType>(s_meshMaxEdgeLength),
-			2 //XY plane by default
-		);
+		ccMesh* mesh = 0;
+		if (type == DELAUNAY_2D_AXIS_ALIGNED)
+		{
+			ccTiledDelaunay::Parameters params;
+			params.dim = 2; //XY plane by default
+			params.maxEdgeLength = static_cast<PointCoordinateType>(s_meshMaxEdgeLength);
+			bool canceled = false;
+			mesh = ccLibAlgorithms::ComputeTiledDelaunay(cloud, params, updateNormals, this, true, &canceled);
+			if (canceled)
+			{
+				//the user doesn't want to process the other clouds either
+				break;
+			}
+		}
+		else
+		{
+			mesh = ccMesh::Triangulate(cloud,
+				type,
+				updateNormals,
+				static_cast<PointCoordinateType>(s_meshMaxEdgeLength),
+				2 //XY plane by default
+			);
+		}
 		if (mesh)
 		{
 			cloud->setVisible(false); //can't disable the cloud as the resulting mesh will be its child!
@@ -6803,6 +6838,42 @@ void MainWindow::testFrameRate()
 		win->startFrameRateTest();
 }
 
+void MainWindow::toggleFrameStats(bool state)
+{
+	ccGLWindow* win = getActiveGLWindow();
+	if (win)
+		win->enableFrameStats(state);
+}
+
+void MainWindow::saveFrameStats()
+{
+	ccGLWindow* win = getActiveGLWindow();
+	if (!win)
+		return;
+
+	if (win->frameStats().size() == 0)
+	{
+		ccConsole::Error("No rendering statistics available (enable them first: 'Display > Show Rendering Statistics')");
+		return;
+	}
+
+	//persistent settings
+	QSettings settings;
+	settings.beginGroup(ccPS::SaveFile());
+	QString currentPath = settings.value(ccPS::CurrentPath(), ccFileUtils::defaultDocPath()).toString();
+
+	QString outputFilename = QFileDialog::getSaveFileName(this, "Select output file", currentPath, "Trace file (*.json)");
+	if (outputFilename.isEmpty())
+		return;
+
+	if (win->saveFrameStats(outputFilename))
+	{
+		//save last saving location
+		settings.setValue(ccPS::CurrentPath(), QFileInfo(outputFilename).absolutePath());
+	}
+	settings.endGroup();
+}
+
 void MainWindow::setTopView()
 {
 	ccGLWindow* win = getActiveGLWindow();
@@ -7592,13 +7663,14 @@ void MainWindow::doActionCrop()
 	ccBBox box = bbeDlg.getBox();
 
 	//process cloud/meshes
+	ccProgressDialog pDlg(true, this);
 	bool errors = false;
 	bool successes = false;
 	{
 		for (size_t i = 0; i < candidates.size(); ++i)
 		{
 			ccHObject* ent = candidates[i];
-			ccHObject* croppedEnt = ccCropTool::Crop(ent, box, true);
+			ccHObject* croppedEnt = ccCropTool::Crop(ent, box, true, 0, &pDlg);
 			if (croppedEnt)
 			{
 				croppedEnt->setName(ent->getName() + QString(".cropped"));
@@ -9123,46 +9195,45 @@ void MainWindow::addToDB(const QStringList& filenames,
 	QString fileFilter/*=QString()*/,
 	ccGLWindow* destWin/*=0*/)
 {
-	//to use the same 'global shift' for multiple files
-	CCVector3d loadCoordinatesShift(0, 0, 0);
-	bool loadCoordinatesTransEnabled = false;
+	//files are loaded asynchronously (see handleLoadedFile)
+	m_loadQueue->load(filenames, fileFilter, destWin);
+}
 
-	FileIOFilter::LoadParameters parameters;
+void MainWindow::handleLoadedFile(ccHObject* entity, QString filename, ccGLWindow* destWin)
+{
+	if (!entity)
 	{
-		parameters.alwaysDisplayLoadDialog = true;
-		parameters.shiftHandlingMode = ccGlobalShiftManager::DIALOG_IF_NECESSARY;
-		parameters.coordinatesShift = &loadCoordinatesShift;
-		parameters.coordinatesShiftEnabled = &loadCoordinatesTransEnabled;
-		parameters.parentWidget = this;
+		assert(false);
+		return;
 	}
 
-	//the same for 'addToDB' (if the first one is not supported, or if the scale remains too big)
-	CCVector3d addCoordinatesShift(0, 0, 0);
-
-	for (int i = 0; i < filenames.size(); ++i)
+	if (destWin)
 	{
-		CC_FILE_ERROR result = CC_FERR_NO_ERROR;
-		ccHObject* newGroup = FileIOFilter::LoadFromFile(filenames[i], parameters, result, fileFilter);
+		entity->setDisplay_recursive(destWin);
+	}
+	addToDB(entity, true, true, false);
 
-		if (newGroup)
+	//prepare the picking acceleration structures right away
+	if (ccGui::Parameters().autoComputeOctree == ccGui::ParamStruct::IN_BACKGROUND)
+	{
+		ccHObject::Container clouds;
+		entity->filterChildren(clouds, true, CC_TYPES::POINT_CLOUD);
+		if (entity->isKindOf(CC_TYPES::POINT_CLOUD))
 		{
-			if (destWin)
-			{
-				newGroup->setDisplay_recursive(destWin);
-			}
-			addToDB(newGroup, true, true, false);
-
-			m_recentFiles->addFilePath(filenames[i]);
+			clouds.push_back(entity);
 		}
-
-		if (result == CC_FERR_CANCELED_BY_USER)
+		for (ccHObject* cloud : clouds)
 		{
-			//stop importing the file if the user has cancelled the current process!
-			break;
+			static_cast<ccGenericPointCloud*>(cloud)->computePickingOctreeInBackground();
 		}
 	}
 
-	QMainWindow::statusBar()->showMessage(QString("%1 file(s) loaded").arg(filenames.size()), 2000);
+	m_recentFiles->addFilePath(filename);
+}
+
+void MainWindow::handleAllFilesProcessed(int loadedCount, int fileCount)
+{
+	QMainWindow::statusBar()->showMessage(QString("%1 file(s) loaded").arg(loadedCount), 2000);
 }
 
 void MainWindow::handleNewLabel(ccHObject* entity)
@@ -9614,9 +9685,15 @@ void MainWindow::on3DViewActivated(QMdiSubWindow* mdiWin)
 		actionAutoPickRotationCenter->blockSignals(true);
 		actionAutoPickRotationCenter->setChecked(win->autoPickPivotAtCenter());
 		actionAutoPickRotationCenter->blockSignals(false);
+
+		actionShowFrameStats->blockSignals(true);
+		actionShowFrameStats->setChecked(win->frameStatsEnabled());
+		actionShowFrameStats->blockSignals(false);
 	}
 
 	actionLockRotationVertAxis->setEnabled(win != 0);
+	actionShowFrameStats->setEnabled(win != 0);
+	actionSaveFrameStats->setEnabled(win != 0);
 	actionEnableStereo->setEnabled(win != 0);
 	actionExclusiveFullScreen->setEnabled(win != 0);
 }
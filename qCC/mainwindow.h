@@ -68,6 +68,7 @@ class QMdiSubWindow;
 class cc3DMouseManager;
 class ccGamepadManager;
 class ccRecentFiles;
+class ccFileLoadQueue;
 
 //! Main window
 class MainWindow : public QMainWindow, public ccMainAppInterface, public ccPickingListener, public Ui::MainWindow
@@ -277,10 +278,17 @@ protected slots:
 	//! Handles new label
 	void handleNewLabel(ccHObject*);
 
+	//! Handles a file loaded by the loading queue
+	void handleLoadedFile(ccHObject* entity, QString filename, ccGLWindow* destWin);
+	//! Handles the end of the loading queue
+	void handleAllFilesProcessed(int loadedCount, int fileCount);
+
 	void setActiveSubWindow(QWidget* window);
 	void setLightsAndMaterials();
 	void showSelectedEntitiesHistogram();
 	void testFrameRate();
+	void toggleFrameStats(bool state);
+	void saveFrameStats();
 	void toggleFullScreen(bool state);
 	void toggleVisualDebugTraces();
 	void toggleExclusiveFullScreen(bool state);
@@ -579,6 +587,9 @@ protected:
 
 	//! Recent files menu
 	ccRecentFiles* m_recentFiles;
+
+	//! Asynchronous file loading queue
+	ccFileLoadQueue* m_loadQueue;
 	
 	//! 3D mouse
 	cc3DMouseManager* m_3DMouseManager;
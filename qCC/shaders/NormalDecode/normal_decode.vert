@@ -0,0 +1,69 @@
+#version 110
+
+// Compressed normals decoding shader (CloudCompare)
+// Same lighting as the fixed-function pipeline (lights 0 and 1, color material
+// on the diffuse component) but the normals are read from a table of all the
+// compressed normals (see ccNormalVectors) instead of being sent by the CPU.
+
+attribute float a_normalCode;			//compressed normal (as sent by the CPU - exact up to 2^24)
+
+uniform sampler2D s_normalTable;		//normals table (RGB = (N + 1) / 2)
+uniform float uf_tableWidth;			//table width (in texels)
+uniform float uf_tableHeight;			//table height (in texels)
+uniform float uf_colorMaterial;			//whether the diffuse color is given by gl_Color (1.0) or not (0.0)
+uniform vec2 uv_lightEnabled;			//whether lights 0 and 1 are enabled (1.0) or not (0.0)
+
+vec4 lightContribution(int i, vec3 N, vec3 ecPos, vec4 diffuseColor)
+{
+	vec3 L;
+	if (gl_LightSource[i].position.w == 0.0)
+		L = normalize(gl_LightSource[i].position.xyz);
+	else
+		L = normalize(gl_LightSource[i].position.xyz - ecPos);
+
+	vec4 color = gl_FrontLightProduct[i].ambient;
+
+	float NdotL = dot(N, L);
+	if (NdotL > 0.0)
+	{
+		color += NdotL * diffuseColor * gl_LightSource[i].diffuse;
+
+		float NdotH = max(dot(N, normalize(gl_LightSource[i].halfVector.xyz)), 0.0);
+		if (NdotH > 0.0)
+		{
+			color += pow(NdotH, gl_FrontMaterial.shininess) * gl_FrontLightProduct[i].specular;
+		}
+	}
+
+	return color;
+}
+
+void main(void)
+{
+	//look for the normal in the table
+	float row = floor(a_normalCode / uf_tableWidth);
+	float col = a_normalCode - row * uf_tableWidth;
+	vec2 texCoord = vec2((col + 0.5) / uf_tableWidth, (row + 0.5) / uf_tableHeight);
+	vec3 N = texture2DLod(s_normalTable, texCoord, 0.0).xyz * 2.0 - 1.0;
+
+	//null normals only get the ambient light
+	if (dot(N, N) > 0.25)
+		N = normalize(gl_NormalMatrix * N);
+	else
+		N = vec3(0.0);
+
+	vec4 ecPos = gl_ModelViewMatrix * gl_Vertex;
+	vec4 diffuseColor = mix(gl_FrontMaterial.diffuse, gl_Color, uf_colorMaterial);
+
+	vec4 color = gl_FrontLightModelProduct.sceneColor;
+	if (uv_lightEnabled.x > 0.5)
+		color += lightContribution(0, N, ecPos.xyz, diffuseColor);
+	if (uv_lightEnabled.y > 0.5)
+		color += lightContribution(1, N, ecPos.xyz, diffuseColor);
+	color.a = diffuseColor.a;
+
+	gl_FrontColor = clamp(color, 0.0, 1.0);
+	gl_BackColor = gl_FrontColor;
+	gl_ClipVertex = ecPos;
+	gl_Position = ftransform();
+}